@@ -9,6 +9,7 @@
 // BigBuf and functions to allocate/free parts of it.
 //-----------------------------------------------------------------------------
 #include "BigBuf.h"
+#include "cmd.h"
 
 // BigBuf is the large multi-purpose buffer, typically used to hold A/D samples or traces.
 // Also used to hold various smaller buffers and the Mifare Emulator Memory.
@@ -33,6 +34,15 @@ static uint8_t *emulator_memory = NULL;
 static uint16_t traceLen = 0;
 int tracing = 1; //Last global one.. todo static?
 
+// compact trace encoding,  start of the record before
+static bool compact = false;
+static uint32_t compactLast = 0;
+
+// trace streaming,  the trace area is a double buffer sent to the client while sniffing
+static tracestream_t traceStream;
+static bool streaming = false;
+static uint32_t streamLast = 0;		// tick of the last chunk sent
+
 // get the address of BigBuf
 uint8_t *BigBuf_get_addr(void)
 {
@@ -123,6 +133,7 @@ uint16_t BigBuf_max_traceLen(void)
 
 void clear_trace() {
 	traceLen = 0;
+	compact = false;
 }
 void set_tracelen(uint16_t value) {
     traceLen = value;
@@ -131,6 +142,12 @@ void set_tracing(bool enable) {
 	tracing = enable;
 }
 
+// records are written compact from the trace start,  set after clear_trace().
+// Not while streaming,  the client syncs on classic records.
+void set_tracing_compact(bool enable) {
+	compact = enable;
+}
+
 bool get_tracing(void) {
 	return tracing;
 }
@@ -154,59 +171,87 @@ bool RAMFUNC LogTrace(const uint8_t *btBytes, uint16_t iLen, uint32_t timestamp_
 {
 	if (!tracing) return false;
 
-	uint8_t *trace = BigBuf_get_addr();
-
-	uint16_t num_paritybytes = (iLen-1)/8 + 1;	// number of valid paritybytes in *parity
+	uint16_t num_paritybytes = tracelog_paritybytes(iLen);	// number of valid paritybytes in *parity
 	uint16_t duration = timestamp_end - timestamp_start;
-
-	// Return when trace is full
-	if (traceLen + sizeof(iLen) + sizeof(timestamp_start) + sizeof(duration) + num_paritybytes + iLen >= BigBuf_max_traceLen()) {
-		tracing = false;	// don't trace any more
-		return false;
+	uint16_t recordLen = TRACELOG_HDR + num_paritybytes + iLen;
+	uint8_t *trace;
+
+	if (streaming) {
+		// a dropped record is counted,  the sniff goes on
+		trace = tracestream_reserve(&traceStream, recordLen);
+		if (trace == NULL)
+			return true;
+	} else if (compact) {
+		// room for the longest header,  TRACECOMPACT_MAX_HDR is 4 bytes more than the
+		// classic one.  Most records need far less.
+		uint16_t room = (traceLen == 0 ? TRACECOMPACT_MAGIC_LEN : 0) + TRACECOMPACT_MAX_HDR + iLen + num_paritybytes;
+		if (traceLen + room >= BigBuf_max_traceLen()) {
+			tracing = false;	// don't trace any more
+			return false;
+		}
+		uint8_t *start = BigBuf_get_addr();
+		if (traceLen == 0) {
+			memcpy(start, TRACECOMPACT_MAGIC, TRACECOMPACT_MAGIC_LEN);
+			traceLen = TRACECOMPACT_MAGIC_LEN;
+			compactLast = 0;
+		}
+		trace = tracecompact_put(start + traceLen, &compactLast, btBytes, iLen, timestamp_start, duration, parity, readerToTag);
+		traceLen = trace - start;
+		return true;
+	} else {
+		// Return when trace is full
+		if (traceLen + recordLen >= BigBuf_max_traceLen()) {
+			tracing = false;	// don't trace any more
+			return false;
+		}
+		trace = BigBuf_get_addr() + traceLen;
+		traceLen += recordLen;
 	}
-	// Traceformat:
-	// 32 bits timestamp (little endian)
-	// 16 bits duration (little endian)
-	// 16 bits data length (little endian, Highest Bit used as readerToTag flag)
-	// y Bytes data
-	// x Bytes parity (one byte per 8 bytes data)
-
-	// timestamp (start)
-	trace[traceLen++] = ((timestamp_start >> 0) & 0xff);
-	trace[traceLen++] = ((timestamp_start >> 8) & 0xff);
-	trace[traceLen++] = ((timestamp_start >> 16) & 0xff);
-	trace[traceLen++] = ((timestamp_start >> 24) & 0xff);
 
-	// duration
-	trace[traceLen++] = ((duration >> 0) & 0xff);
-	trace[traceLen++] = ((duration >> 8) & 0xff);
+	tracelog_put(trace, btBytes, iLen, timestamp_start, duration, parity, readerToTag);
+	return true;
+}
 
-	// data length
-	trace[traceLen++] = ((iLen >> 0) & 0xff);
-	trace[traceLen++] = ((iLen >> 8) & 0xff);
+void BigBuf_trace_stream_start(void)
+{
+	clear_trace();
+	tracestream_init(&traceStream, BigBuf_get_addr(), BigBuf_max_traceLen());
+	streamLast = GetTickCount();
+	streaming = true;
+}
 
-	// readerToTag flag
-	if (!readerToTag) {
-		trace[traceLen - 1] |= 0x80;
+// sends one chunk,  about half a ms on the USB.  Call it when the sniff loop is idle.
+// The half being filled goes out too after flush_ms without a full one.
+bool BigBuf_trace_stream_send(uint32_t flush_ms)
+{
+	if (!streaming) return false;
+
+	uint8_t *data;
+	uint32_t arg0, arg1, arg2;
+	if (!tracestream_next(&traceStream, &data, &arg0, &arg1, &arg2)) {
+		if (GetTickCount() - streamLast < flush_ms || !tracestream_flush(&traceStream))
+			return false;
+		if (!tracestream_next(&traceStream, &data, &arg0, &arg1, &arg2))
+			return false;
 	}
+	streamLast = GetTickCount();
 
-	// data bytes
-	if (btBytes != NULL && iLen != 0) {
-		memcpy(trace + traceLen, btBytes, iLen);
-	}
-	traceLen += iLen;
+	cmd_send(CMD_DOWNLOADED_TRACE_STREAM, arg0, arg1, arg2, data, arg1 & TRACESTREAM_LENMASK);
+	tracestream_sent(&traceStream);
+	return true;
+}
 
-	// parity bytes
-	if (num_paritybytes != 0) {
-		if (parity != NULL) {
-			memcpy(trace + traceLen, parity, num_paritybytes);
-		} else {
-			memset(trace + traceLen, 0x00, num_paritybytes);
-		}
-	}
-	traceLen += num_paritybytes;
+// the rest of the trace,  then the end packet
+void BigBuf_trace_stream_end(void)
+{
+	if (!streaming) return;
 
-	return true;
+	while (BigBuf_trace_stream_send(0))
+		WDT_HIT();
+
+	cmd_send(CMD_DOWNLOADED_TRACE_STREAM, traceStream.offset, TRACESTREAM_END, traceStream.dropped, &traceStream.records, sizeof(traceStream.records));
+	streaming = false;
+	clear_trace();
 }
 
 
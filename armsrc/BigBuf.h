@@ -16,6 +16,8 @@
 #include "proxmark3.h"
 #include "string.h"
 #include "ticks.h"
+#include "tracestream.h"	// TRACESTREAM_FLUSH_MS
+#include "tracecompact.h"	// trace record writers
 
 #define BIGBUF_SIZE				40000
 #define MAX_FRAME_SIZE			256		// maximum allowed ISO14443 frame
@@ -39,9 +41,13 @@ extern void BigBuf_print_status(void);
 extern uint16_t BigBuf_get_traceLen(void);
 extern void clear_trace(void);
 extern void set_tracing(bool enable);
+extern void set_tracing_compact(bool enable);
 extern void set_tracelen(uint16_t value);
 extern bool get_tracing(void);
 extern bool RAMFUNC LogTrace(const uint8_t *btBytes, uint16_t iLen, uint32_t timestamp_start, uint32_t timestamp_end, uint8_t *parity, bool readerToTag);
+extern void BigBuf_trace_stream_start(void);
+extern bool BigBuf_trace_stream_send(uint32_t flush_ms);
+extern void BigBuf_trace_stream_end(void);
 extern int LogTraceHitag(const uint8_t * btBytes, int iBits, int iSamples, uint32_t dwParity, int bReader);
 extern uint8_t emlSet(uint8_t *data, uint32_t offset, uint32_t length);
 #endif /* __BIGBUF_H */
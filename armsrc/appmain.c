@@ -977,7 +977,7 @@ void UsbPacketReceived(uint8_t *packet, int len) {
 #ifdef WITH_ICLASS
 		// Makes use of ISO14443a FPGA Firmware
 		case CMD_SNOOP_ICLASS:
-			SniffIClass();
+			SniffIClass(c->arg[0]);
 			break;
 		case CMD_SIMULATE_TAG_ICLASS:
 			SimulateIClass(c->arg[0], c->arg[1], c->arg[2], c->d.asBytes);
@@ -204,7 +204,7 @@ void DirectTag15693Command(uint32_t datalen,uint32_t speed, uint32_t recv, uint8
 void Iso15693InitReader(void);
 
 // iclass.h
-void RAMFUNC SniffIClass(void);
+void RAMFUNC SniffIClass(uint8_t param);
 void SimulateIClass(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint8_t *datain);
 void ReaderIClass(uint8_t arg0);
 void ReaderIClass_Replay(uint8_t arg0,uint8_t *MAC);
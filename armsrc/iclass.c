@@ -45,6 +45,7 @@
 #include "protocols.h"
 #include "optimized_cipher.h"
 #include "usb_cdc.h" // for usb_poll_validate_length
+#include "iclass_decode.h"
 
 static int timeout = 4096;
 static int SendIClassAnswer(uint8_t *resp, int respLen, uint16_t delay);
@@ -94,164 +95,9 @@ typedef struct {
     uint8_t *output;
 } tUart;
 */
-typedef struct {
-    enum {
-        DEMOD_UNSYNCD,
-		DEMOD_START_OF_COMMUNICATION,
-		DEMOD_START_OF_COMMUNICATION2,
-		DEMOD_START_OF_COMMUNICATION3,
-		DEMOD_SOF_COMPLETE,
-		DEMOD_MANCHESTER_D,
-		DEMOD_MANCHESTER_E,
-		DEMOD_END_OF_COMMUNICATION,
-		DEMOD_END_OF_COMMUNICATION2,
-		DEMOD_MANCHESTER_F,
-        DEMOD_ERROR_WAIT
-    }       state;
-    int     bitCount;
-    int     posCount;
-	int     syncBit;
-    uint16_t    shiftReg;
-	uint32_t buffer;
-	uint32_t buffer2;
-	uint32_t buffer3;
-	int     buff;
-	int     samples;
-    int     len;
-	enum {
-		SUB_NONE,
-		SUB_FIRST_HALF,
-		SUB_SECOND_HALF,
-		SUB_BOTH
-	}		sub;
-    uint8_t   *output;
-} tDemod;
-
-/*
-* Abrasive's uart implementation
-* https://github.com/abrasive/proxmark3/commit/2b8bff7daea8ae1193bf7ee29b1fa46e95218902
-*/
-// Static vars for UART
-typedef struct {
-	bool synced;
-	bool frame;
-	bool frame_done;
-	uint8_t *buf;
-	int len;
-} tUart;
-static tUart Uart;
-
-static void uart_reset(void){
-	Uart.frame_done = false;
-	Uart.synced = false;
-	Uart.frame = false;
-}
-static void uart_init(uint8_t *data){
-	Uart.buf = data;
-	uart_reset();
-}
-static void uart_bit(uint8_t bit) {
-    static uint8_t buf = 0xff;
-    static uint8_t n_buf;
-    static uint8_t msg_byte;
-    static int nmsg_byte;
-    buf <<= 1;
-    buf |= bit ? 1 : 0;
-
-    if (!Uart.frame) {
-        if (buf == 0x7b) {	// 0b0111 1011
-            Uart.frame = true;
-            n_buf = 0;
-            Uart.len = 0;
-            nmsg_byte = 0;
-        }
-    } else {
-        n_buf++;
-        if (n_buf == 8) {
-            msg_byte >>= 2;
-            switch (buf) {
-                case 0xbf:    // 0 - 1011 1111
-                    break;
-                case 0xef:    // 1 - 1110 1111 
-                    msg_byte |= (1<<6);
-                    break;
-                case 0xfb:    // 2 - 1111 1011
-                    msg_byte |= (2<<6);
-                    break;
-                case 0xfe:    // 3 - 1111 1110
-                    msg_byte |= (3<<6);
-                    break;
-                case 0xdf:    // eof - 1101 1111
-                    Uart.frame = false;
-                    Uart.synced = false;
-                    Uart.frame_done = true;
-                    break;
-                default:
-                    Uart.frame = false;
-					Uart.synced = false;
-                    Dbprintf("[-] bad %02X at %d:%d", buf, Uart.len, nmsg_byte);
-            }
-
-            if (Uart.frame) {   // data bits
-                nmsg_byte += 2;
-                if (nmsg_byte >= 8) {
-                    Uart.buf[Uart.len++] = msg_byte;
-                    nmsg_byte = 0;
-                }
-            }
-            n_buf = 0;
-            buf = 0xff;
-        }
-    }
-}
-
-static void uart_samples(uint8_t byte) {
-    static uint32_t buf;
-    static int window;
-    static int drop_next = 0;
-
-    uint32_t falling;
-    int lz;
-
-    if (!Uart.synced) {
-        if (byte == 0xFF)
-            return;
-        buf = 0xFFFFFFFF;
-        window = 0;
-        drop_next = 0;
-        Uart.synced = true;
-    }
-
-    buf <<= 8;
-    buf |= byte;
-
-    if (drop_next) {
-        drop_next = 0;
-        return;
-    }
-
-again:
-    falling = ~buf & ((buf >> 1) ^ buf) & (0xFF << window);
-
-    uart_bit(!falling);
-
-    if (!falling)
-        return;
-
-    lz = __builtin_clz(falling) - 24 + window;
-
-    // aim to get falling edge on fourth-leftmost bit of window
-    window += 3 - lz;
-
-    if (window < 0) {
-        window += 8;
-        drop_next = 1;
-    } else if (window >= 8) {
-        window -= 8;
-        goto again;
-    }
-}
-
+// The reader 1 out of 4 and tag Manchester decoders are in common/iclass_decode.c
+static tUartIclass Uart;
+static tDemodIclass Demod;
 
 /*
 static void UartReset(){
@@ -496,296 +342,6 @@ static RAMFUNC int OutOfNDecoding(int bit) {
     return false;
 }
 */
-//=============================================================================
-// Manchester
-//=============================================================================
-static tDemod Demod;
-static void DemodReset() {
-	Demod.bitCount = 0;
-	Demod.posCount = 0;
-	Demod.syncBit = 0;
-	Demod.shiftReg = 0;
-	Demod.buffer = 0;
-	Demod.buffer2 = 0;
-	Demod.buffer3 = 0;
-	Demod.buff = 0;
-	Demod.samples = 0;
-	Demod.len = 0;
-	Demod.sub = SUB_NONE;
-	Demod.state = DEMOD_UNSYNCD;
-}
-static void DemodInit(uint8_t *data) {
-	Demod.output = data;
-	DemodReset();
-}
-
-// UART debug 
-// it adds the debug values which will be put in the tracelog,
-// visible on client when running  'hf list iclass'
-/*
-pm3 --> hf li iclass
-Recorded Activity (TraceLen = 162 bytes)
-      Start |        End | Src | Data (! denotes parity error)                                   | CRC | Annotation         |
-------------|------------|-----|-----------------------------------------------------------------|-----|--------------------|
-          0 |          0 | Rdr |0a                                                               |     | ACTALL
-       1280 |       1280 | Tag |bb! 33! bb! 01  02  04  08  bb!                                  |  ok |
-       1280 |       1280 | Rdr |0c                                                               |     | IDENTIFY
-       1616 |       1616 | Tag |bb! 33! bb! 00! 02  00! 02  bb!                                  |  ok |
-       1616 |       1616 | Rdr |0a                                                               |     | ACTALL
-       2336 |       2336 | Tag |bb! d4! bb! 02  08  00! 08  bb!                                  |  ok |
-       2336 |       2336 | Rdr |0c                                                               |     | IDENTIFY
-       2448 |       2448 | Tag |bb! 33! bb! 00! 00! 00! 02  bb!                                  |  ok |
-       2448 |       2448 | Rdr |0a                                                               |     | ACTALL
-       2720 |       2720 | Tag |bb! d4! bb! 08  0b  01  04  bb!                                  |  ok |
-       2720 |       2720 | Rdr |0c                                                               |     | IDENTIFY
-       3232 |       3232 | Tag |bb! d4! bb! 02  02  08  04  bb!                                  |  ok |
-*/
-static void uart_debug(int error, int bit) {
-	Demod.output[Demod.len] = 0xBB;
-	Demod.len++;
-	Demod.output[Demod.len] = error & 0xFF;
-	Demod.len++;
-	Demod.output[Demod.len] = 0xBB;
-	Demod.len++;
-	Demod.output[Demod.len] = bit & 0xFF;
-	Demod.len++;
-	Demod.output[Demod.len] = Demod.buffer & 0xFF;
-	Demod.len++;
-	// Look harder ;-)
-	Demod.output[Demod.len] = Demod.buffer2 & 0xFF;
-	Demod.len++;
-	Demod.output[Demod.len] = Demod.syncBit & 0xFF;
-	Demod.len++;
-	Demod.output[Demod.len] = 0xBB;
-	Demod.len++;
-}
-
-/*
-* CARD TO READER
-* in ISO15693-2 mode -  Manchester 
-* in ISO 14443b - BPSK coding
-*
-* Timings:
-*  ISO 15693-2 
-*           Tout = 330 µs, Tprog 1 = 4 to 15 ms, Tslot = 330 µs + (number of slots x 160 µs)
-*  ISO 14443a
-*			Tout = 100 µs, Tprog = 4 to 15 ms, Tslot = 100 µs+ (number of slots x 80 µs)
-*  ISO 14443b
-			 Tout = 76 µs, Tprog = 4 to 15 ms, Tslot = 119 µs+ (number of slots x 150 µs)
-*
-*
-*  So for current implementation in ISO15693, its 330 µs from end of reader, to start of card.
-*/
-static RAMFUNC int ManchesterDecoding_iclass( uint32_t v) {
-	int bit;
-	int modulation;
-	int error = 0;
-
-	bit = Demod.buffer;
-	Demod.buffer = Demod.buffer2;
-	Demod.buffer2 = Demod.buffer3;
-	Demod.buffer3 = v;
-
-	// too few bits?
-	if (Demod.buff < 3) {
-		Demod.buff++;
-		return false;
-	}
-
-	if (Demod.state == DEMOD_UNSYNCD) {
-		Demod.output[Demod.len] = 0xfa;
-		Demod.syncBit = 0;
-		//Demod.samples = 0;
-		Demod.posCount = 1;		// This is the first half bit period, so after syncing handle the second part
-
-		if (bit & 0x08)
-			Demod.syncBit = 0x08;
-
-		if (bit & 0x04) {
-			if (Demod.syncBit)
-				bit <<= 4;
-
-			Demod.syncBit = 0x04;
-		}
-
-		if (bit & 0x02) {
-			if (Demod.syncBit)
-				bit <<= 2;
-
-			Demod.syncBit = 0x02;
-		}
-
-		if (bit & 0x01 && Demod.syncBit)
-			Demod.syncBit = 0x01;
-
-		if (Demod.syncBit) {
-			Demod.len = 0;
-			Demod.state = DEMOD_START_OF_COMMUNICATION;
-			Demod.sub = SUB_FIRST_HALF;
-			Demod.bitCount = 0;
-			Demod.shiftReg = 0;
-			Demod.samples = 0;
-
-			if (Demod.posCount) {
-
-				switch (Demod.syncBit) {
-					case 0x08: Demod.samples = 3; break;
-					case 0x04: Demod.samples = 2; break;
-					case 0x02: Demod.samples = 1; break;
-					case 0x01: Demod.samples = 0; break;
-				}
-				// SOF must be long burst... otherwise stay unsynced!!!
-				if (!(Demod.buffer & Demod.syncBit) || !(Demod.buffer2 & Demod.syncBit))
-					Demod.state = DEMOD_UNSYNCD;
-
-			} else {
-				// SOF must be long burst... otherwise stay unsynced!!!
-				if (!(Demod.buffer2 & Demod.syncBit) || !(Demod.buffer3 & Demod.syncBit)) {
-					Demod.state = DEMOD_UNSYNCD;
-					error = 0x88;
-					uart_debug(error, bit);
-					return false;
-				}				
-			}
-			error = 0;
-		}
-		return false;
-	}
-
-	// state is DEMOD is in SYNC from here on.
-	
-	modulation = bit & Demod.syncBit;
-	modulation |= ((bit << 1) ^ ((Demod.buffer & 0x08) >> 3)) & Demod.syncBit;
-	Demod.samples += 4;
-
-	if (Demod.posCount == 0) {
-		Demod.posCount = 1;
-		Demod.sub = (modulation) ? SUB_FIRST_HALF : SUB_NONE;
-		return false;
-	}
-
-	Demod.posCount = 0;
-
-	if (modulation) {
-		
-		if (Demod.sub == SUB_FIRST_HALF)
-			Demod.sub = SUB_BOTH;
-		else
-			Demod.sub = SUB_SECOND_HALF;
-	}
-	
-	if (Demod.sub == SUB_NONE) {
-		if (Demod.state == DEMOD_SOF_COMPLETE) {
-			Demod.output[Demod.len] = 0x0f;
-			Demod.len++;
-			Demod.state = DEMOD_UNSYNCD;
-			return true;
-		} else {
-			Demod.state = DEMOD_ERROR_WAIT;
-			error = 0x33;
-		}
-	}
-
-	switch (Demod.state) {
-		
-		case DEMOD_START_OF_COMMUNICATION:
-			if (Demod.sub == SUB_BOTH) {
-
-				Demod.state = DEMOD_START_OF_COMMUNICATION2;
-				Demod.posCount = 1;
-				Demod.sub = SUB_NONE;
-			} else {
-				Demod.output[Demod.len] = 0xab;
-				Demod.state = DEMOD_ERROR_WAIT;
-				error = 0xd2;
-			}
-			break;
-			
-		case DEMOD_START_OF_COMMUNICATION2:
-			if (Demod.sub == SUB_SECOND_HALF) {
-				Demod.state = DEMOD_START_OF_COMMUNICATION3;
-			} else {
-				Demod.output[Demod.len] = 0xab;
-				Demod.state = DEMOD_ERROR_WAIT;
-				error = 0xd3;
-			}
-			break;
-			
-		case DEMOD_START_OF_COMMUNICATION3:
-			if (Demod.sub == SUB_SECOND_HALF) {
-				Demod.state = DEMOD_SOF_COMPLETE;
-			} else {
-				Demod.output[Demod.len] = 0xab;
-				Demod.state = DEMOD_ERROR_WAIT;
-				error = 0xd4;
-			}
-			break;
-			
-		case DEMOD_SOF_COMPLETE:
-		case DEMOD_MANCHESTER_D:
-		case DEMOD_MANCHESTER_E:
-			// OPPOSITE FROM ISO14443 - 11110000 = 0 (1 in 14443)
-			//                          00001111 = 1 (0 in 14443)
-			if (Demod.sub == SUB_SECOND_HALF) { // SUB_FIRST_HALF
-				Demod.bitCount++;
-				Demod.shiftReg = (Demod.shiftReg >> 1) ^ 0x100;
-				Demod.state = DEMOD_MANCHESTER_D;
-			} else if (Demod.sub == SUB_FIRST_HALF) { // SUB_SECOND_HALF
-				Demod.bitCount++;
-				Demod.shiftReg >>= 1;
-				Demod.state = DEMOD_MANCHESTER_E;
-			} else if (Demod.sub == SUB_BOTH) {
-				Demod.state = DEMOD_MANCHESTER_F;
-			} else {
-				Demod.state = DEMOD_ERROR_WAIT;
-				error = 0x55;
-			}
-			break;
-
-		case DEMOD_MANCHESTER_F:
-			// Tag response does not need to be a complete byte!
-			if (Demod.len > 0 || Demod.bitCount > 0) {
-				if (Demod.bitCount > 1) {  // was > 0, do not interpret last closing bit, is part of EOF
-					Demod.shiftReg >>= (9 - Demod.bitCount);	// right align data
-					Demod.output[Demod.len] = Demod.shiftReg & 0xff;
-					Demod.len++;
-				}
-
-				Demod.state = DEMOD_UNSYNCD;
-				return true;
-			} else {
-				Demod.output[Demod.len] = 0xad;
-				Demod.state = DEMOD_ERROR_WAIT;
-				error = 0x03;
-			}
-			break;
-
-		case DEMOD_ERROR_WAIT:
-			Demod.state = DEMOD_UNSYNCD;
-			break;
-
-		default:
-			Demod.output[Demod.len] = 0xdd;
-			Demod.state = DEMOD_UNSYNCD;
-			break;
-	}
-
-	if (Demod.bitCount >= 8) {
-		Demod.shiftReg >>= 1;
-		Demod.output[Demod.len] = (Demod.shiftReg & 0xff);
-		Demod.len++;
-		Demod.bitCount = 0;
-		Demod.shiftReg = 0;
-	}
-
-	if (error) {
-		uart_debug(error, bit);
-		return true;
-	}
-	
-    return false;
-}
-
 //=============================================================================
 // Finally, a `sniffer' for iClass communication
 // Both sides of communication!
@@ -810,9 +366,9 @@ static void iclass_setup_sniff(void){
 	set_tracing(true);
 
 	// Initialize Demod and Uart structs
-	DemodInit(BigBuf_malloc(ICLASS_BUFFER_SIZE));
+	DemodIclassInit(&Demod, BigBuf_malloc(ICLASS_BUFFER_SIZE));
 
-	uart_init(BigBuf_malloc(ICLASS_BUFFER_SIZE));
+	uart_init(&Uart, BigBuf_malloc(ICLASS_BUFFER_SIZE));
 	//UartInit(BigBuf_malloc(ICLASS_BUFFER_SIZE));
 
 	if (MF_DBGLEVEL > 1) {
@@ -842,7 +398,7 @@ static void iclass_setup_sniff(void){
 // near the reader.
 //-----------------------------------------------------------------------------
 // turn off afterwards
-void RAMFUNC SniffIClass(void) {
+void RAMFUNC SniffIClass(uint8_t param) {
 
 	//int datalen = 0; 
 	uint32_t previous_data = 0;	
@@ -865,6 +421,11 @@ void RAMFUNC SniffIClass(void) {
 		return;
 	}
 
+	// param bit 0,  stream the trace to the client.  The rest of BigBuf is the double buffer
+	bool stream = param & 0x01;
+	if (stream)
+		BigBuf_trace_stream_start();
+
 	// time ZERO, the point from which it all is calculated.
 	time_0 = GetCountSspClk();
 
@@ -879,6 +440,14 @@ void RAMFUNC SniffIClass(void) {
 	while (!BUTTON_PRESS()) {
         WDT_HIT();
 
+		// a trace chunk to the client while the air is quiet,  the DMA buffer has room for it
+		if (stream && !TagIsActive && !ReaderIsActive) {
+			int dataLen = ICLASS_DMA_BUFFER_SIZE - AT91C_BASE_PDC_SSC->PDC_RCR - (data - dmaBuf);
+			if (dataLen < 0) dataLen += ICLASS_DMA_BUFFER_SIZE;
+			if (dataLen < ICLASS_DMA_BUFFER_SIZE / 4)
+				BigBuf_trace_stream_send(TRACESTREAM_FLUSH_MS);
+		}
+
 		previous_data <<= 8;
 		previous_data |= *data;
 		
@@ -907,12 +476,12 @@ void RAMFUNC SniffIClass(void) {
 				LED_C_INV();
 				// HIGH nibble is always reader data.
 				uint8_t reader_byte = (previous_data & 0xF0) | (*data >> 4);
-				uart_samples(reader_byte);
+				uart_samples(&Uart, reader_byte);
 				if (Uart.frame_done) {
 					time_stop = GetCountSspClk() - time_0;
 					LogTrace( Uart.buf, Uart.len, time_start, time_stop, NULL, true);
-					DemodReset();
-					uart_reset();
+					DemodIclassReset(&Demod);
+					uart_reset(&Uart);
 				} else {
 					time_start = GetCountSspClk() - time_0;
 				}
@@ -940,11 +509,11 @@ void RAMFUNC SniffIClass(void) {
 				
 						
 				//uint8_t tag_byte = ((previous_data & 0xF) << 4 ) | (*data & 0xF);
-				if (ManchesterDecoding_iclass(foo)) {
+				if (ManchesterDecoding_iclass(&Demod, foo)) {
 					time_stop = GetCountSspClk() - time_0;
 					LogTrace(Demod.output, Demod.len, time_start, time_stop, NULL, false);
-					DemodReset();
-					uart_reset();					
+					DemodIclassReset(&Demod);
+					uart_reset(&Uart);					
 				} else {
 					time_start = GetCountSspClk() - time_0;
 				}
@@ -956,6 +525,8 @@ void RAMFUNC SniffIClass(void) {
 		}
 	} // end main loop
 
+	BigBuf_trace_stream_end();
+
 	if (MF_DBGLEVEL >= 1) {	
 		DbpString("[+] Sniff statistics:");	
 		Dbhexdump(ICLASS_DMA_BUFFER_SIZE, data, false);
@@ -981,7 +552,7 @@ static bool GetIClassCommandFromReader(uint8_t *received, int *len, int maxLen)
     // only, since we are receiving, not transmitting).
     // Signal field is off with the appropriate LED
     LED_D_OFF();
-	uart_init(received);
+	uart_init(&Uart, received);
 	
     FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_ISO14443A | FPGA_HF_ISO14443A_TAGSIM_LISTEN);
 	// clear RXRDY:
@@ -996,7 +567,7 @@ static bool GetIClassCommandFromReader(uint8_t *received, int *len, int maxLen)
         if (AT91C_BASE_SSC->SSC_SR & (AT91C_SSC_RXRDY)) {
             b = (uint8_t)AT91C_BASE_SSC->SSC_RHR;
 
-            uart_samples(b);
+            uart_samples(&Uart, b);
             if (Uart.frame_done) {
                 *len = Uart.len;
 				return true;
@@ -1236,6 +807,7 @@ int doIClassSimulation( int simulationMode, uint8_t *reader_mac_buf) {
 	BigBuf_free_keep_EM();
 	
 	State cipher_state;
+	opt_key_t *cipher_key = NULL;
 
 	uint8_t *csn = BigBuf_get_EM_addr();
 	uint8_t *emulator = csn;
@@ -1264,8 +836,10 @@ int doIClassSimulation( int simulationMode, uint8_t *reader_mac_buf) {
 
 		//Card challenge, a.k.a e-purse is on block 2
 		memcpy(card_challenge_data, emulator + (8 * 2) ,8);
-		//Precalculate the cipher state, feeding it the CC
-		cipher_state = opt_doTagMAC_1(card_challenge_data, diversified_key);
+		//Precalculate the key table and the cipher state, feeding it the CC
+		cipher_key = (opt_key_t *)BigBuf_malloc(sizeof(opt_key_t));
+		opt_init_key(cipher_key, diversified_key);
+		cipher_state = opt_doTagMAC_1_key(card_challenge_data, cipher_key);
 	}
 	// set epurse of sim2,4 attack
 	if (reader_mac_buf != NULL)	{
@@ -1457,7 +1031,7 @@ int doIClassSimulation( int simulationMode, uint8_t *reader_mac_buf) {
 			// Reader random and reader MAC!!!
 			if (simulationMode == MODE_FULLSIM) {
 				// NR, from reader, is in receivedCmd +1
-				opt_doTagMAC_2(cipher_state, receivedCmd+1, data_generic_trace, diversified_key);
+				opt_doTagMAC_2_key(cipher_state, receivedCmd+1, data_generic_trace, cipher_key);
 
 				trace_data = data_generic_trace;
 				trace_data_size = 4;
@@ -1732,7 +1306,7 @@ static int GetIClassAnswer(uint8_t* receivedResponse, int maxLen, int *samples,
 	bool skip = false;
 
 	// Setup UART/DEMOD to receive 
-	DemodInit(receivedResponse);
+	DemodIclassInit(&Demod, receivedResponse);
 
 	if (elapsed) *elapsed = 0;
 
@@ -1763,7 +1337,7 @@ static int GetIClassAnswer(uint8_t* receivedResponse, int maxLen, int *samples,
 			skip = !skip;			
 			if (skip) continue;
 		
-			if (ManchesterDecoding_iclass(b & 0x0f)) {
+			if (ManchesterDecoding_iclass(&Demod, b & 0x0f)) {
 				if (samples) 
 					*samples = c << 3;
 				return true;
@@ -29,61 +29,8 @@ extern "C" {
 #include "parity.h"
 #include "random.h"
 #include "mifare.h"  // structs
-
-typedef struct {
-	enum {
-		DEMOD_UNSYNCD,
-		// DEMOD_HALF_SYNCD,
-		// DEMOD_MOD_FIRST_HALF,
-		// DEMOD_NOMOD_FIRST_HALF,
-		DEMOD_MANCHESTER_DATA
-	} state;
-	uint16_t twoBits;
-	uint16_t highCnt;
-	uint16_t bitCount;
-	uint16_t collisionPos;
-	uint16_t syncBit;
-	uint8_t  parityBits;
-	uint8_t  parityLen;
-	uint16_t shiftReg;
-	uint16_t samples;
-	uint16_t len;
-	uint32_t startTime, endTime;
-	uint8_t  *output;
-	uint8_t  *parity;
-} tDemod;
-/*
-typedef enum {
-	MOD_NOMOD = 0,
-	MOD_SECOND_HALF,
-	MOD_FIRST_HALF,
-	MOD_BOTH_HALVES
-	} Modulation_t;
-*/
-
-typedef struct {
-	enum {
-		STATE_UNSYNCD,
-		STATE_START_OF_COMMUNICATION,
-		STATE_MILLER_X,
-		STATE_MILLER_Y,
-		STATE_MILLER_Z,
-		// DROP_NONE,
-		// DROP_FIRST_HALF,
-		} state;
-	uint16_t shiftReg;
-	int16_t	 bitCount;
-	uint16_t len;
-	//uint16_t byteCntMax;
-	uint16_t posCnt;
-	uint16_t syncBit;
-	uint8_t  parityBits;
-	uint8_t  parityLen;
-	uint32_t fourBits;
-	uint32_t startTime, endTime;
-    uint8_t *output;
-	uint8_t *parity;
-} tUart;
+#include "aidprobe.h"
+#include "iso14443a_decode.h"	// Miller / Manchester decoders
 
 #ifndef AddCrc14A
 # define	AddCrc14A(data, len)	compute_crc(CRC_14443_A, (data), (len), (data)+(len), (data)+(len)+1)
@@ -95,14 +42,6 @@ typedef struct {
 
 extern void GetParity(const uint8_t *pbtCmd, uint16_t len, uint8_t *par);
 
-extern tDemod* GetDemod(void);
-extern void DemodReset(void);
-extern void DemodInit(uint8_t *data, uint8_t *parity);
-extern tUart* GetUart(void);
-extern void UartReset(void);
-extern void UartInit(uint8_t *data, uint8_t *parity);
-extern RAMFUNC bool MillerDecoding(uint8_t bit, uint32_t non_real_time);
-extern RAMFUNC int ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_time);
 
 extern void RAMFUNC SniffIso14443a(uint8_t param);
 extern void SimulateIso14443aTag(int tagType, int flags, uint8_t *data);
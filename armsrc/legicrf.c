@@ -21,7 +21,6 @@ static enum {
   STATE_CON,
 } legic_state;
 
-static crc_t    legic_crc;
 static int      legic_read_count;
 static uint32_t legic_prng_bc;
 static uint32_t legic_prng_iv;
@@ -351,7 +350,6 @@ void LegicCommonInit(bool clear_mem) {
 
 	clear_trace();
 	set_tracing(true);
-	crc_init(&legic_crc, 4, 0x19 >> 1, 0x5, 0);
 	
 	StartTicks();
 }
@@ -365,10 +363,8 @@ static void switch_off_tag_rwd(void) {
 
 // calculate crc4 for a legic READ command 
 static uint32_t legic4Crc(uint8_t cmd, uint16_t byte_index, uint8_t value, uint8_t cmd_sz) {
-	crc_clear(&legic_crc);	
 	uint32_t temp =  (value << cmd_sz) | (byte_index << 1) | cmd;
-	crc_update(&legic_crc, temp, cmd_sz + 8 );
-	return crc_finish(&legic_crc);
+	return crc4_legic(temp, cmd_sz + 8);
 }
 
 int legic_read_byte( uint16_t index, uint8_t cmd_sz) {
@@ -835,8 +831,6 @@ void LegicRfSimulate(int phase, int frame, int reqresp)
 	clear_trace();
 	set_tracing(true);
 
-	crc_init(&legic_crc, 4, 0x19 >> 1, 0x5, 0);
-
 	StartTicks();
 
 	LED_B_ON();
@@ -1613,9 +1607,6 @@ void ice_legic_setup() {
 	// Start the timer
 	//StartCountSspClk();
 	
-	// initalize CRC 
-	crc_init(&legic_crc, 4, 0x19 >> 1, 0x5, 0);
-
 	// initalize prng
 	legic_prng_init(0);
 }
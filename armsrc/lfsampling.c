@@ -7,6 +7,7 @@
 //-----------------------------------------------------------------------------
 
 #include "lfsampling.h"
+#include "lfpack.h"
 
 /*
 Default LF config is set to:
@@ -15,8 +16,9 @@ Default LF config is set to:
 	averaging = YES
 	divisor = 95 (125khz)
 	trigger_threshold = 0
+	compression = NO
 	*/
-sample_config config = { 1, 8, 1, 95, 0 } ;
+sample_config config = { 1, 8, 1, 95, 0, 0 } ;
 
 void printConfig() {
 	Dbprintf("LF Sampling config:");
@@ -25,6 +27,7 @@ void printConfig() {
 	Dbprintf("  [d] decimation..........%d", config.decimation);
 	Dbprintf("  [a] averaging...........%s", (config.averaging) ? "Yes" : "No");
 	Dbprintf("  [t] trigger threshold...%d", config.trigger_threshold);
+	Dbprintf("  [c] compression.........%s", (config.compression) ? "Yes" : "No");
 }
 
 /**
@@ -45,6 +48,7 @@ void setSamplingConfig(sample_config *sc) {
 	
 	config.decimation = (sc->decimation != 0) ? sc->decimation : 1;
 	config.averaging = sc->averaging;
+	config.compression = sc->compression;
 	if(config.bits_per_sample > 8)	config.bits_per_sample = 8;
 
 	printConfig();
@@ -54,25 +58,6 @@ sample_config* getSamplingConfig() {
 	return &config;
 }
 
-struct BitstreamOut {
-	uint8_t * buffer;
-	uint32_t numbits;
-	uint32_t position;
-};
-
-/**
- * @brief Pushes bit onto the stream
- * @param stream
- * @param bit
- */
-void pushBit( BitstreamOut* stream, uint8_t bit) {
-	int bytepos = stream->position >> 3; // divide by 8
-	int bitpos = stream->position & 7;
-	*(stream->buffer+bytepos) |= (bit > 0) <<  (7 - bitpos);
-	stream->position++;
-	stream->numbits++;
-}
-
 /**
 * Setup the FPGA to listen for samples. This method downloads the FPGA bitstream
 * if not already loaded, sets divisor and starts up the antenna.
@@ -101,6 +86,37 @@ void LFSetupFPGAForADC(int divisor, bool lf_field) {
 	StartTicks();
 }
 
+/**
+ * The sampling loop past the trigger,  inlined with the lfpack mode a constant
+ * so every decimation / averaging / storing combination gets a loop of its own.
+ * @return the number of samples seen
+ */
+static inline __attribute__((always_inline)) uint32_t DoAcquisitionLoop(lfpack_t *pack, const uint8_t mode) {
+	// a local copy,  the byte stores to BigBuf can't alias it and the state stays in registers
+	lfpack_t p = *pack;
+	uint32_t seen = 0;
+	while (!BUTTON_PRESS() && !usb_poll_validate_length() ) {
+		WDT_HIT();
+		if (AT91C_BASE_SSC->SSC_SR & AT91C_SSC_TXRDY) {
+			AT91C_BASE_SSC->SSC_THR = 0x43;
+			LED_D_ON();
+		}
+		if (AT91C_BASE_SSC->SSC_SR & AT91C_SSC_RXRDY) {
+			uint8_t sample = (uint8_t)AT91C_BASE_SSC->SSC_RHR;
+			LED_D_OFF();
+			seen++;
+			if (!lfpack_put_mode(&p, mode, sample)) break;
+		}
+	}
+	*pack = p;
+	return seen;
+}
+
+#define LF_ACQUISITION_LOOP(dec, store) \
+	case LFPACK_MODE(dec, store): \
+		sample_total_numbers += DoAcquisitionLoop(&pack, LFPACK_MODE(dec, store)); \
+		break;
+
 /**
  * Does the sample acquisition. If threshold is specified, the actual sampling
  * is not commenced until the threshold has been reached.
@@ -114,29 +130,24 @@ void LFSetupFPGAForADC(int divisor, bool lf_field) {
  * @param trigger_threshold - a threshold. The sampling won't commence until this threshold has been reached. Set
  * to -1 to ignore threshold.
  * @param silent - is true, now outputs are made. If false, dbprints the status
+ * @param compression - delta / run length code the samples (lfcompress.h) instead of packing them,
+ * BigBuf then holds many more of them
  * @return the number of bits occupied by the samples.
  */
-uint32_t DoAcquisition(uint8_t decimation, uint32_t bits_per_sample, bool averaging, int trigger_threshold, bool silent, int bufsize, uint32_t cancel_after) {
+uint32_t DoAcquisition(uint8_t decimation, uint32_t bits_per_sample, bool averaging, int trigger_threshold, bool silent, int bufsize, uint32_t cancel_after, bool compression) {
 	//bigbuf, to hold the aquired raw data signal
 	uint8_t *dest = BigBuf_get_addr();
     bufsize = (bufsize > 0 && bufsize < BigBuf_max_traceLen()) ? bufsize : BigBuf_max_traceLen();
 
-
-	if (bits_per_sample < 1) bits_per_sample = 1;
-	if (bits_per_sample > 8) bits_per_sample = 8;
-
-	if (decimation < 1) decimation = 1;
-
-	// Use a bit stream to handle the output
-	BitstreamOut data = { dest , 0, 0};
-	int sample_counter = 0;
+	// decimation, averaging and storing of the samples,  bits per sample
+	// gather in a word before they go to BigBuf
+	lfpack_t pack;
+	lfpack_init(&pack, dest, bufsize, (bits_per_sample > 8) ? 8 : bits_per_sample, decimation, averaging, compression);
 	uint8_t sample = 0;
-	//If we want to do averaging
-	uint32_t sample_sum =0 ;
 	uint32_t sample_total_numbers = 0;
-	uint32_t sample_total_saved = 0;
 	uint32_t cancel_counter = 0;
 	
+	// wait for the trigger,  the sample that passes it is the first one stored
 	while (!BUTTON_PRESS() && !usb_poll_validate_length() ) {
 		WDT_HIT();
 		if (AT91C_BASE_SSC->SSC_SR & AT91C_SSC_TXRDY) {
@@ -156,53 +167,35 @@ uint32_t DoAcquisition(uint8_t decimation, uint32_t bits_per_sample, bool averag
 				continue;
 			}
 			
-			trigger_threshold = 0;
 			sample_total_numbers++;
+			break;
+		}
+	}
 
-			if (averaging)
-				sample_sum += sample;
-
-			//Check decimation
-			if (decimation > 1)	{
-				sample_counter++;
-				if (sample_counter < decimation) continue;
-				sample_counter = 0;
-			}
-			
-			//Averaging
-			if (averaging && decimation > 1) {
-				sample = sample_sum / decimation;
-				sample_sum =0;
-			}
-			
-			//Store the sample
-			sample_total_saved ++;
-			if (bits_per_sample == 8){
-				dest[sample_total_saved-1] = sample;
-				data.numbits = sample_total_saved << 3;//Get the return value correct
-				if (sample_total_saved >= bufsize) break;
-				
-			} else {
-				pushBit(&data, sample & 0x80);
-				if (bits_per_sample > 1)	pushBit(&data, sample & 0x40);
-				if (bits_per_sample > 2)	pushBit(&data, sample & 0x20);
-				if (bits_per_sample > 3)	pushBit(&data, sample & 0x10);
-				if (bits_per_sample > 4)	pushBit(&data, sample & 0x08);
-				if (bits_per_sample > 5)	pushBit(&data, sample & 0x04);
-				if (bits_per_sample > 6)	pushBit(&data, sample & 0x02);
-				//Not needed, 8bps is covered above
-				//if (bits_per_sample > 7)	pushBit(&data, sample & 0x01);
-				if ((data.numbits >> 3) +1  >= bufsize) break;
-			}
+	if (sample_total_numbers && lfpack_put(&pack, sample)) {
+		switch (pack.mode) {
+			LF_ACQUISITION_LOOP(LFPACK_DEC_NONE, LFPACK_STORE_BYTE)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_NONE, LFPACK_STORE_BITS)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_NONE, LFPACK_STORE_CODED)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_KEEP, LFPACK_STORE_BYTE)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_KEEP, LFPACK_STORE_BITS)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_KEEP, LFPACK_STORE_CODED)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_AVERAGE, LFPACK_STORE_BYTE)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_AVERAGE, LFPACK_STORE_BITS)
+			LF_ACQUISITION_LOOP(LFPACK_DEC_AVERAGE, LFPACK_STORE_CODED)
 		}
 	}
 
+	uint32_t numbits = lfpack_finish(&pack);
+
 	if (!silent) {
-		Dbprintf("Done, saved %d out of %d seen samples at %d bits/sample", sample_total_saved, sample_total_numbers, bits_per_sample);
+		Dbprintf("Done, saved %d out of %d seen samples at %d bits/sample", pack.saved, sample_total_numbers, pack.bps);
+		if (compression)
+			Dbprintf("compressed into %d bytes", numbits >> 3);
 		Dbprintf("buffer samples: %02x %02x %02x %02x %02x %02x %02x %02x ...",
 					dest[0], dest[1], dest[2], dest[3], dest[4], dest[5], dest[6], dest[7]);
 	}
-	return data.numbits;
+	return numbits;
 }
 /**
  * @brief Does sample acquisition, ignoring the config values set in the sample_config.
@@ -213,7 +206,7 @@ uint32_t DoAcquisition(uint8_t decimation, uint32_t bits_per_sample, bool averag
  * @return number of bits sampled
  */
 uint32_t DoAcquisition_default(int trigger_threshold, bool silent) {
-	return DoAcquisition(1, 8, 0,trigger_threshold, silent, 0, 0);
+	return DoAcquisition(1, 8, 0,trigger_threshold, silent, 0, 0, false);
 }
 uint32_t DoAcquisition_config( bool silent, int sample_size) {
 	return DoAcquisition(config.decimation
@@ -222,11 +215,12 @@ uint32_t DoAcquisition_config( bool silent, int sample_size) {
 				  ,config.trigger_threshold
 				  ,silent
 				  ,sample_size
-				  ,0);
+				  ,0
+				  ,config.compression);
 }
 
 uint32_t DoPartialAcquisition(int trigger_threshold, bool silent, int sample_size, uint32_t cancel_after) {
-	return DoAcquisition(1, 8, 0, trigger_threshold, silent, sample_size, cancel_after);
+	return DoAcquisition(1, 8, 0, trigger_threshold, silent, sample_size, cancel_after, false);
 }
 
 uint32_t ReadLF(bool activeField, bool silent, int sample_size) {
@@ -8,8 +8,6 @@
 #include "usb_cdc.h"	// for usb_poll_validate_length
 #include "ticks.h"		// for StartTicks
 
-typedef struct BitstreamOut BitstreamOut;
-
 /**
 * acquisition of Cotag LF signal. Similar to other LF,  since the Cotag has such long datarate RF/384
 * and is Manchester?,  we directly gather the manchester data into bigbuff
@@ -0,0 +1,315 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Host side AES-128 / DES backends: polarssl,  AES-NI and bitsliced DES.
+//-----------------------------------------------------------------------------
+
+#include "blockcipher.h"
+
+#include <string.h>
+#include "aes.h"
+#include "des.h"
+
+//-----------------------------------------------------------------------------
+// polarssl,  always there
+//-----------------------------------------------------------------------------
+static bool polarssl_available(void) {
+	return true;
+}
+
+static void polarssl_aes_ecb(const uint8_t *key, int mode, const uint8_t *in, uint8_t *out, size_t blocks) {
+	aes_context ctx;
+	aes_init(&ctx);
+	if (mode == BC_ENCRYPT)
+		aes_setkey_enc(&ctx, key, 128);
+	else
+		aes_setkey_dec(&ctx, key, 128);
+
+	for (size_t i = 0; i < blocks; i++)
+		aes_crypt_ecb(&ctx, mode == BC_ENCRYPT ? AES_ENCRYPT : AES_DECRYPT, in + 16 * i, out + 16 * i);
+	aes_free(&ctx);
+}
+
+static void polarssl_aes_cbc(const uint8_t *key, int mode, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks) {
+	aes_context ctx;
+	aes_init(&ctx);
+	if (mode == BC_ENCRYPT)
+		aes_setkey_enc(&ctx, key, 128);
+	else
+		aes_setkey_dec(&ctx, key, 128);
+
+	aes_crypt_cbc(&ctx, mode == BC_ENCRYPT ? AES_ENCRYPT : AES_DECRYPT, 16 * blocks, iv, in, out);
+	aes_free(&ctx);
+}
+
+static void polarssl_aes_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n) {
+	for (size_t i = 0; i < n; i++)
+		polarssl_aes_ecb(keys + 16 * i, mode, in + 16 * i, out + 16 * i, 1);
+}
+
+static void polarssl_des_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n) {
+	des_context ctx;
+	for (size_t i = 0; i < n; i++) {
+		if (mode == BC_ENCRYPT)
+			des_setkey_enc(&ctx, keys + 8 * i);
+		else
+			des_setkey_dec(&ctx, keys + 8 * i);
+		des_crypt_ecb(&ctx, in + 8 * i, out + 8 * i);
+	}
+}
+
+static const bc_aes_backend_t bc_aes_polarssl = {
+	"polarssl",
+	polarssl_available,
+	polarssl_aes_ecb,
+	polarssl_aes_cbc,
+	polarssl_aes_batch
+};
+
+static const bc_des_backend_t bc_des_polarssl = {
+	"polarssl",
+	polarssl_available,
+	polarssl_des_batch
+};
+
+//-----------------------------------------------------------------------------
+// bitsliced DES.  Lane l of every bs_t word is block l of a 64 block chunk,
+// word d holds DES bit d + 1 of all lanes.  Tables are the FIPS 46 ones.
+//-----------------------------------------------------------------------------
+typedef uint64_t bs_t;
+#include "des_bitslice_sbox.h"
+
+static const uint8_t des_ip[64] = {
+	58, 50, 42, 34, 26, 18, 10,  2, 60, 52, 44, 36, 28, 20, 12,  4,
+	62, 54, 46, 38, 30, 22, 14,  6, 64, 56, 48, 40, 32, 24, 16,  8,
+	57, 49, 41, 33, 25, 17,  9,  1, 59, 51, 43, 35, 27, 19, 11,  3,
+	61, 53, 45, 37, 29, 21, 13,  5, 63, 55, 47, 39, 31, 23, 15,  7
+};
+
+static const uint8_t des_fp[64] = {
+	40,  8, 48, 16, 56, 24, 64, 32, 39,  7, 47, 15, 55, 23, 63, 31,
+	38,  6, 46, 14, 54, 22, 62, 30, 37,  5, 45, 13, 53, 21, 61, 29,
+	36,  4, 44, 12, 52, 20, 60, 28, 35,  3, 43, 11, 51, 19, 59, 27,
+	34,  2, 42, 10, 50, 18, 58, 26, 33,  1, 41,  9, 49, 17, 57, 25
+};
+
+static const uint8_t des_e[48] = {
+	32,  1,  2,  3,  4,  5,  4,  5,  6,  7,  8,  9,  8,  9, 10, 11,
+	12, 13, 12, 13, 14, 15, 16, 17, 16, 17, 18, 19, 20, 21, 20, 21,
+	22, 23, 24, 25, 24, 25, 26, 27, 28, 29, 28, 29, 30, 31, 32,  1
+};
+
+// position in f() of S-box output bit q + 1,  the inverse of the P table
+static const uint8_t des_p_inv[32] = {
+	 8, 16, 22, 30, 12, 27,  1, 17, 23, 15, 29,  5, 25, 19,  9,  0,
+	 7, 13, 24,  2,  3, 28, 10, 18, 31, 11, 21,  6,  4, 26, 14, 20
+};
+
+static const uint8_t des_pc1[56] = {
+	57, 49, 41, 33, 25, 17,  9,  1, 58, 50, 42, 34, 26, 18,
+	10,  2, 59, 51, 43, 35, 27, 19, 11,  3, 60, 52, 44, 36,
+	63, 55, 47, 39, 31, 23, 15,  7, 62, 54, 46, 38, 30, 22,
+	14,  6, 61, 53, 45, 37, 29, 21, 13,  5, 28, 20, 12,  4
+};
+
+static const uint8_t des_pc2[48] = {
+	14, 17, 11, 24,  1,  5,  3, 28, 15,  6, 21, 10,
+	23, 19, 12,  4, 26,  8, 16,  7, 27, 20, 13,  2,
+	41, 52, 31, 37, 47, 55, 30, 40, 51, 45, 33, 48,
+	44, 49, 39, 56, 34, 53, 46, 42, 50, 36, 29, 32
+};
+
+static const uint8_t des_shifts[16] = { 1, 1, 2, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 2, 1 };
+
+// ks[r][k] = key bit (0 based) that ends up as bit k of round key r
+static void des_bs_schedule(uint8_t ks[16][48]) {
+	uint8_t c[28], d[28], t;
+	memcpy(c, des_pc1, 28);
+	memcpy(d, des_pc1 + 28, 28);
+
+	for (int r = 0; r < 16; r++) {
+		for (int s = 0; s < des_shifts[r]; s++) {
+			t = c[0];
+			memmove(c, c + 1, 27);
+			c[27] = t;
+			t = d[0];
+			memmove(d, d + 1, 27);
+			d[27] = t;
+		}
+		for (int k = 0; k < 48; k++) {
+			int i = des_pc2[k] - 1;
+			ks[r][k] = (i < 28 ? c[i] : d[i - 28]) - 1;
+		}
+	}
+}
+
+// 64 x 64 bit transpose: a[i] bit (63 - j) <-> a[j] bit (63 - i)
+static void des_bs_transpose(uint64_t a[64]) {
+	uint64_t m = 0x00000000FFFFFFFFULL;
+	for (int j = 32; j; j >>= 1, m ^= m << j) {
+		for (int k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			uint64_t t = (a[k] ^ (a[k | j] >> j)) & m;
+			a[k] ^= t;
+			a[k | j] ^= t << j;
+		}
+	}
+}
+
+static void des_bs_load(uint64_t a[64], const uint8_t *buf, size_t n) {
+	memset(a, 0, 64 * sizeof(uint64_t));
+	for (size_t l = 0; l < n; l++)
+		for (int i = 0; i < 8; i++)
+			a[l] = (a[l] << 8) | buf[8 * l + i];
+	des_bs_transpose(a);
+}
+
+// up to 64 blocks,  each under its own key
+static void des_bs_chunk(uint8_t ks[16][48], const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n) {
+	bs_t key[64], blk[64], lr[64], x[6], y[4];
+
+	des_bs_load(key, keys, n);
+	des_bs_load(blk, in, n);
+
+	for (int i = 0; i < 64; i++)
+		lr[i] = blk[des_ip[i] - 1];
+
+	bs_t *l = lr, *r = lr + 32;
+	for (int round = 0; round < 16; round++) {
+		const uint8_t *k = ks[mode == BC_ENCRYPT ? round : 15 - round];
+
+		for (int s = 0; s < 8; s++) {
+			for (int j = 0; j < 6; j++)
+				x[j] = r[des_e[6 * s + j] - 1] ^ key[k[6 * s + j]];
+
+			switch (s) {
+				case 0: des_bs_s1(x, y); break;
+				case 1: des_bs_s2(x, y); break;
+				case 2: des_bs_s3(x, y); break;
+				case 3: des_bs_s4(x, y); break;
+				case 4: des_bs_s5(x, y); break;
+				case 5: des_bs_s6(x, y); break;
+				case 6: des_bs_s7(x, y); break;
+				case 7: des_bs_s8(x, y); break;
+			}
+
+			for (int j = 0; j < 4; j++)
+				l[des_p_inv[4 * s + j]] ^= y[j];
+		}
+
+		bs_t *t = l;
+		l = r;
+		r = t;
+	}
+
+	// pre output is R16 L16
+	for (int i = 0; i < 64; i++) {
+		int b = des_fp[i] - 1;
+		blk[i] = b < 32 ? r[b] : l[b - 32];
+	}
+	des_bs_transpose(blk);
+
+	for (size_t j = 0; j < n; j++)
+		for (int i = 0; i < 8; i++)
+			out[8 * j + i] = blk[j] >> (56 - 8 * i);
+}
+
+static void bitslice_des_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n) {
+	uint8_t ks[16][48];
+	des_bs_schedule(ks);
+
+	for (size_t i = 0; i < n; i += 64) {
+		size_t m = n - i < 64 ? n - i : 64;
+		des_bs_chunk(ks, keys + 8 * i, mode, in + 8 * i, out + 8 * i, m);
+	}
+}
+
+static const bc_des_backend_t bc_des_bitslice = {
+	"bitslice",
+	polarssl_available,
+	bitslice_des_batch
+};
+
+//-----------------------------------------------------------------------------
+// selection
+//-----------------------------------------------------------------------------
+extern const bc_aes_backend_t bc_aes_aesni;
+
+// fastest first
+const bc_aes_backend_t *const bc_aes_backends[] = { &bc_aes_aesni, &bc_aes_polarssl, NULL };
+const bc_des_backend_t *const bc_des_backends[] = { &bc_des_bitslice, &bc_des_polarssl, NULL };
+
+static const bc_aes_backend_t *aes_backend = NULL;
+static const bc_des_backend_t *des_backend = NULL;
+
+const bc_aes_backend_t *bc_aes_backend(void) {
+	if (aes_backend) return aes_backend;
+
+	for (int i = 0; bc_aes_backends[i]; i++) {
+		if (bc_aes_backends[i]->available()) {
+			aes_backend = bc_aes_backends[i];
+			break;
+		}
+	}
+	return aes_backend;
+}
+
+const bc_des_backend_t *bc_des_backend(void) {
+	if (des_backend) return des_backend;
+
+	for (int i = 0; bc_des_backends[i]; i++) {
+		if (bc_des_backends[i]->available()) {
+			des_backend = bc_des_backends[i];
+			break;
+		}
+	}
+	return des_backend;
+}
+
+bool bc_set_backend(const char *name) {
+	bool found = false;
+
+	if (!name) {
+		aes_backend = NULL;
+		des_backend = NULL;
+		return true;
+	}
+
+	for (int i = 0; bc_aes_backends[i]; i++) {
+		if (!strcmp(bc_aes_backends[i]->name, name) && bc_aes_backends[i]->available()) {
+			aes_backend = bc_aes_backends[i];
+			found = true;
+		}
+	}
+	for (int i = 0; bc_des_backends[i]; i++) {
+		if (!strcmp(bc_des_backends[i]->name, name) && bc_des_backends[i]->available()) {
+			des_backend = bc_des_backends[i];
+			found = true;
+		}
+	}
+	return found;
+}
+
+int bc_aes128_ecb(const uint8_t key[16], int mode, const uint8_t *in, uint8_t *out, size_t len) {
+	if (len % 16) return -1;
+	bc_aes_backend()->ecb(key, mode, in, out, len / 16);
+	return 0;
+}
+
+int bc_aes128_cbc(const uint8_t key[16], int mode, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t len) {
+	if (len % 16) return -1;
+	bc_aes_backend()->cbc(key, mode, iv, in, out, len / 16);
+	return 0;
+}
+
+void bc_aes128_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n) {
+	bc_aes_backend()->batch(keys, mode, in, out, n);
+}
+
+void bc_des_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n) {
+	const bc_des_backend_t *be = bc_des_backend();
+	if (be == &bc_des_bitslice && n < BC_DES_BITSLICE_MIN)
+		be = &bc_des_polarssl;
+	be->batch(keys, mode, in, out, n);
+}
@@ -0,0 +1,57 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Host side AES-128 / DES with the backend picked at runtime.
+// AES uses AES-NI when the CPU has it,  polarssl otherwise.  Batches of DES
+// blocks,  each under its own key,  go through a 64 lane bitsliced DES where
+// the key schedule is only a choice of wires.
+//-----------------------------------------------------------------------------
+
+#ifndef BLOCKCIPHER_H__
+#define BLOCKCIPHER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BC_DECRYPT	0
+#define BC_ENCRYPT	1
+
+typedef struct {
+	const char *name;
+	bool (*available)(void);
+	// one key,  blocks of 16 bytes.  iv is updated like aes_crypt_cbc() does
+	void (*ecb)(const uint8_t *key, int mode, const uint8_t *in, uint8_t *out, size_t blocks);
+	void (*cbc)(const uint8_t *key, int mode, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks);
+	// block i under key i
+	void (*batch)(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n);
+} bc_aes_backend_t;
+
+typedef struct {
+	const char *name;
+	bool (*available)(void);
+	// block i under key i,  8 byte keys,  parity bits ignored
+	void (*batch)(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n);
+} bc_des_backend_t;
+
+// every backend built in,  NULL terminated.  For tests and benchmarks
+extern const bc_aes_backend_t *const bc_aes_backends[];
+extern const bc_des_backend_t *const bc_des_backends[];
+
+// fastest available,  unless one was forced by name.  NULL name back to auto
+const bc_aes_backend_t *bc_aes_backend(void);
+const bc_des_backend_t *bc_des_backend(void);
+bool bc_set_backend(const char *name);
+
+// len is a multiple of 16
+int bc_aes128_ecb(const uint8_t key[16], int mode, const uint8_t *in, uint8_t *out, size_t len);
+int bc_aes128_cbc(const uint8_t key[16], int mode, uint8_t iv[16], const uint8_t *in, uint8_t *out, size_t len);
+void bc_aes128_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n);
+
+// small batches stay on polarssl,  the bitsliced DES always runs 64 lanes
+#define BC_DES_BITSLICE_MIN	8
+void bc_des_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n);
+
+#endif
@@ -0,0 +1,132 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// AES-128 with AES-NI.  Built with -maes on x86 (see Makefile),  only used
+// when the CPU reports the instructions.  Elsewhere it is an empty backend.
+//-----------------------------------------------------------------------------
+
+#include "blockcipher.h"
+
+#if defined(__AES__) && defined(__SSE2__)
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+
+#define AESNI_EXPAND(k, rcon) aesni_expand_step(k, _mm_aeskeygenassist_si128(k, rcon))
+
+static inline __m128i aesni_expand_step(__m128i k, __m128i t) {
+	t = _mm_shuffle_epi32(t, 0xff);
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+	return _mm_xor_si128(k, t);
+}
+
+static void aesni_setkey(const uint8_t *key, int mode, __m128i rk[11]) {
+	rk[0] = _mm_loadu_si128((const __m128i *)key);
+	rk[1] = AESNI_EXPAND(rk[0], 0x01);
+	rk[2] = AESNI_EXPAND(rk[1], 0x02);
+	rk[3] = AESNI_EXPAND(rk[2], 0x04);
+	rk[4] = AESNI_EXPAND(rk[3], 0x08);
+	rk[5] = AESNI_EXPAND(rk[4], 0x10);
+	rk[6] = AESNI_EXPAND(rk[5], 0x20);
+	rk[7] = AESNI_EXPAND(rk[6], 0x40);
+	rk[8] = AESNI_EXPAND(rk[7], 0x80);
+	rk[9] = AESNI_EXPAND(rk[8], 0x1b);
+	rk[10] = AESNI_EXPAND(rk[9], 0x36);
+
+	if (mode == BC_ENCRYPT)
+		return;
+
+	// equivalent inverse cipher: reversed order,  InvMixColumns on the middle keys
+	__m128i t;
+	t = rk[0]; rk[0] = rk[10]; rk[10] = t;
+	for (int i = 1; i < 5; i++) {
+		t = rk[i];
+		rk[i] = _mm_aesimc_si128(rk[10 - i]);
+		rk[10 - i] = _mm_aesimc_si128(t);
+	}
+	rk[5] = _mm_aesimc_si128(rk[5]);
+}
+
+static inline __m128i aesni_enc(const __m128i rk[11], __m128i b) {
+	b = _mm_xor_si128(b, rk[0]);
+	for (int r = 1; r < 10; r++)
+		b = _mm_aesenc_si128(b, rk[r]);
+	return _mm_aesenclast_si128(b, rk[10]);
+}
+
+static inline __m128i aesni_dec(const __m128i rk[11], __m128i b) {
+	b = _mm_xor_si128(b, rk[0]);
+	for (int r = 1; r < 10; r++)
+		b = _mm_aesdec_si128(b, rk[r]);
+	return _mm_aesdeclast_si128(b, rk[10]);
+}
+
+static bool aesni_available(void) {
+#if !defined(__APPLE__) || (defined(__APPLE__) && (__clang_major__ > 8 || __clang_major__ == 8 && __clang_minor__ >= 1))
+	return __builtin_cpu_supports("aes");
+#else
+	return false;
+#endif
+}
+
+static void aesni_ecb(const uint8_t *key, int mode, const uint8_t *in, uint8_t *out, size_t blocks) {
+	__m128i rk[11];
+	aesni_setkey(key, mode, rk);
+
+	for (size_t i = 0; i < blocks; i++) {
+		__m128i b = _mm_loadu_si128((const __m128i *)(in + 16 * i));
+		b = (mode == BC_ENCRYPT) ? aesni_enc(rk, b) : aesni_dec(rk, b);
+		_mm_storeu_si128((__m128i *)(out + 16 * i), b);
+	}
+}
+
+static void aesni_cbc(const uint8_t *key, int mode, uint8_t *iv, const uint8_t *in, uint8_t *out, size_t blocks) {
+	__m128i rk[11];
+	aesni_setkey(key, mode, rk);
+
+	__m128i chain = _mm_loadu_si128((const __m128i *)iv);
+	for (size_t i = 0; i < blocks; i++) {
+		__m128i b = _mm_loadu_si128((const __m128i *)(in + 16 * i));
+		if (mode == BC_ENCRYPT) {
+			chain = aesni_enc(rk, _mm_xor_si128(b, chain));
+			_mm_storeu_si128((__m128i *)(out + 16 * i), chain);
+		} else {
+			_mm_storeu_si128((__m128i *)(out + 16 * i), _mm_xor_si128(aesni_dec(rk, b), chain));
+			chain = b;
+		}
+	}
+	_mm_storeu_si128((__m128i *)iv, chain);
+}
+
+static void aesni_batch(const uint8_t *keys, int mode, const uint8_t *in, uint8_t *out, size_t n) {
+	for (size_t i = 0; i < n; i++)
+		aesni_ecb(keys + 16 * i, mode, in + 16 * i, out + 16 * i, 1);
+}
+
+const bc_aes_backend_t bc_aes_aesni = {
+	"aesni",
+	aesni_available,
+	aesni_ecb,
+	aesni_cbc,
+	aesni_batch
+};
+
+#else
+
+static bool aesni_available(void) {
+	return false;
+}
+
+const bc_aes_backend_t bc_aes_aesni = {
+	"aesni",
+	aesni_available,
+	NULL,
+	NULL,
+	NULL
+};
+
+#endif
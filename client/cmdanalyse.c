@@ -54,6 +54,43 @@ int usage_analyse_crc(void){
 	return 0;
 }
 
+int usage_analyse_crcsearch(void){
+	PrintAndLogEx(NORMAL, "Brute force search for the CRC model of some frames, the crc is expected at the end of each frame.");
+	PrintAndLogEx(NORMAL, "The polynomial range is split over a pool of threads. Known presets are tried first.");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "Usage:  analyse crcsearch [h] [w <width>] [j <threads>] [n <count>] <frame> [<frame>...]");
+	PrintAndLogEx(NORMAL, "        analyse crcsearch t [j <threads>]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "           h            This help");
+	PrintAndLogEx(NORMAL, "           w <width>    crc width in bits (default 16)");
+	PrintAndLogEx(NORMAL, "           j <threads>  search threads (default one per CPU)");
+	PrintAndLogEx(NORMAL, "           n <count>    stop after <count> models per bit order");
+	PrintAndLogEx(NORMAL, "           t            time the search on sample frames with known CRC-16 and CRC-32 models,");
+	PrintAndLogEx(NORMAL, "                        one thread against <threads>");
+	PrintAndLogEx(NORMAL, "           <frame>      hex bytes with the crc appended");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "      analyse crcsearch w 8 01020304e3 010204039d");
+	PrintAndLogEx(NORMAL, "      analyse crcsearch w 16 n 1 0102030405cebf 0a0b0c0d0e7856");
+	PrintAndLogEx(NORMAL, "      analyse crcsearch t");
+	return 0;
+}
+
+int usage_analyse_cipher(void){
+	PrintAndLogEx(NORMAL, "Known answer tests and a cross check against polarssl for every AES / DES backend");
+	PrintAndLogEx(NORMAL, "built in,  then their throughput.  The fastest available backend is used by default.");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "Usage:  analyse cipher [h] [u <backend>]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "           h              This help");
+	PrintAndLogEx(NORMAL, "           u <backend>    use this backend from now on,  'auto' goes back to the default");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "      analyse cipher");
+	PrintAndLogEx(NORMAL, "      analyse cipher u polarssl");
+	return 0;
+}
+
 int usage_analyse_nuid(void){
 	PrintAndLogEx(NORMAL, "Generate 4byte NUID from 7byte UID");
 	PrintAndLogEx(NORMAL, "");
@@ -832,6 +869,407 @@ void generate4bNUID(uint8_t *uid, uint8_t *nuid){
 	nuid[3] = crc & 0xFF;
 }
 
+typedef struct {
+	const char *name;
+	uint8_t width;
+	uint64_t poly;
+	uint64_t init;
+	bool reflected;
+	uint64_t xorout;
+	uint64_t from;          // search range, to == 0 is the full range
+	uint64_t to;
+} crcsearch_sample_t;
+
+static const crcsearch_sample_t crcsearch_samples[] = {
+	{"CRC-16/CCITT-FALSE", 16, 0x1021, 0xFFFF, false, 0x0000, 0, 0},
+	{"CRC-16/KERMIT", 16, 0x1021, 0x0000, true, 0x0000, 0, 0},
+	{"CRC-16/ARC", 16, 0x8005, 0x0000, true, 0x0000, 0, 0},
+	{"CRC-32", 32, 0x04C11DB7, 0xFFFFFFFF, true, 0xFFFFFFFF, 0x04000000, 0x05000000},
+};
+
+static void crcsearch_hexpoly(poly_t *p, uint64_t v, uint8_t width) {
+	char hex[20];
+	snprintf(hex, sizeof(hex), "%0*" PRIx64, (width + 3) / 4, v);
+	*p = strtop(hex, P_BE, 4);
+	praloc(p, width);
+}
+
+static uint64_t crcsearch_polyval(const poly_t p) {
+	char *hex = ptostr(p, P_RTJUST, 4);
+	uint64_t v = strtoull(hex, NULL, 16);
+	free(hex);
+	return v;
+}
+
+// search sample frames of a known model,  returns models found or -1 if the model isn't among them
+static int crcsearch_run(const crcsearch_sample_t *cs, int threads, model_t **found, uint64_t *ms) {
+	enum { FRAMES = 6, FRAMELEN = 12 };
+	model_t guess = MZERO;
+	poly_t qpoly = PZERO, apolys[FRAMES];
+	uint8_t frame[FRAMELEN + 8];
+	uint32_t lfsr = 0x1234567 * cs->width;
+	int cb = cs->width / 8, rflags = R_HAVERI | R_HAVERO, n, hit = 0;
+
+	const crcengine_table_t *tbl = crcengine_table(cs->width, cs->poly, cs->reflected);
+	if (!tbl) return -1;
+
+	for (int i = 0; i < FRAMES; i++) {
+		for (int j = 0; j < FRAMELEN; j++) {
+			lfsr = lfsr * 1103515245 + 12345;
+			frame[j] = lfsr >> 16;
+		}
+		// pairs of equal length give the differences the poly must divide,
+		// different lengths let the Init value be solved
+		int len = FRAMELEN - i / 2;
+		uint64_t crc = crcengine_calc(tbl, cs->init, frame, len);
+		if (cs->reflected) crc = crcengine_reflect(crc, cs->width);
+		crc ^= cs->xorout;
+		for (int k = 0; k < cb; k++)
+			frame[len + k] = cs->reflected ? (crc >> (8 * k)) : (crc >> (8 * (cb - 1 - k)));
+		apolys[i] = strtop(sprint_hex_inrow(frame, len + cb), cs->reflected ? P_LE : P_BE, 8);
+	}
+
+	guess.flags = cs->reflected ? P_LE : P_BE;
+	if (cs->to) {
+		crcsearch_hexpoly(&guess.spoly, cs->from, cs->width);
+		crcsearch_hexpoly(&qpoly, cs->to, cs->width);
+		rflags |= R_HAVEQ;
+	} else {
+		palloc(&guess.spoly, cs->width);
+	}
+	praloc(&guess.init, cs->width);
+	praloc(&guess.xorout, cs->width);
+
+	reveng_opts_t opts = {threads, 0, 1, NULL, NULL};
+	uint64_t t1 = msclock();
+	*found = reveng_mt(&guess, qpoly, rflags, FRAMES, apolys, &opts);
+	*ms = msclock() - t1;
+
+	for (n = 0; *found && plen((*found)[n].spoly); n++) {
+		if (crcsearch_polyval((*found)[n].spoly) == cs->poly
+				&& crcsearch_polyval((*found)[n].init) == cs->init
+				&& crcsearch_polyval((*found)[n].xorout) == cs->xorout)
+			hit = 1;
+	}
+
+	for (int i = 0; i < FRAMES; i++)
+		pfree(&apolys[i]);
+	pfree(&qpoly);
+	mfree(&guess);
+	return hit ? n : -1;
+}
+
+static void crcsearch_freemodels(model_t *models) {
+	for (model_t *m = models; m && plen(m->spoly); m++)
+		mfree(m);
+	free(models);
+}
+
+static int crcsearch_bench(int threads) {
+	if (threads <= 0) threads = num_CPUs();
+	bool allok = true;
+
+	PrintAndLogEx(NORMAL, "Search timing on 6 sample frames per model, %d CPU(s)\n", num_CPUs());
+	PrintAndLogEx(NORMAL, "model              | poly range            | 1 thread ms | %2d threads ms | speedup | found | result", threads);
+	PrintAndLogEx(NORMAL, "-------------------+-----------------------+-------------+---------------+---------+-------+-------");
+
+	for (int i = 0; i < sizeof(crcsearch_samples) / sizeof(crcsearch_samples[0]); i++) {
+		const crcsearch_sample_t *cs = &crcsearch_samples[i];
+		model_t *m1 = NULL, *mn = NULL;
+		uint64_t ms1 = 0, msn = 0;
+		// width is a uint8_t,  both ends padded to width / 4 digits
+		char range[2 * (255 / 4) + 3];
+
+		int n1 = crcsearch_run(cs, 1, &m1, &ms1);
+		int nn = crcsearch_run(cs, threads, &mn, &msn);
+
+		// both runs must agree model for model,  in the same order
+		bool ok = n1 > 0 && n1 == nn;
+		for (int k = 0; ok && k < n1; k++)
+			ok = !mcmp(&m1[k], &mn[k]);
+		allok &= ok;
+
+		if (cs->to)
+			snprintf(range, sizeof(range), "%0*" PRIx64 "..%0*" PRIx64, cs->width / 4, cs->from, cs->width / 4, cs->to);
+		else
+			snprintf(range, sizeof(range), "full");
+
+		PrintAndLogEx(NORMAL, "%-18s | %-21s | %11" PRIu64 " | %13" PRIu64 " | %6.2fx | %5d | %s",
+			cs->name, range, ms1, msn, msn ? (double)ms1 / msn : 0.0, nn,
+			ok ? _GREEN_(ok) : _RED_(fail));
+
+		crcsearch_freemodels(m1);
+		crcsearch_freemodels(mn);
+	}
+	return allok ? 0 : 1;
+}
+
+int CmdAnalyseCrcSearch(const char *Cmd) {
+	enum { MAXFRAMES = 32 };
+	char *argv[8 + MAXFRAMES];
+	char width[8] = "16", threads[8] = "0", count[8] = "0";
+	char frames[MAXFRAMES][256];
+	int argc = 0, nframes = 0, j = 0;
+	bool errors = false, bench = false;
+	uint8_t cmdp = 0;
+
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		char c = param_getchar(Cmd, cmdp);
+		if (param_getlength(Cmd, cmdp) == 1) {
+			switch (tolower(c)) {
+			case 'h':
+				return usage_analyse_crcsearch();
+			case 'w':
+				snprintf(width, sizeof(width), "%u", param_get8ex(Cmd, cmdp + 1, 16, 10));
+				cmdp += 2;
+				continue;
+			case 'j':
+				j = param_get32ex(Cmd, cmdp + 1, 0, 10);
+				snprintf(threads, sizeof(threads), "%d", j);
+				cmdp += 2;
+				continue;
+			case 'n':
+				snprintf(count, sizeof(count), "%u", param_get32ex(Cmd, cmdp + 1, 0, 10));
+				cmdp += 2;
+				continue;
+			case 't':
+				bench = true;
+				cmdp++;
+				continue;
+			}
+		}
+		if (nframes == MAXFRAMES || param_getstr(Cmd, cmdp, frames[nframes], sizeof(frames[0])) == 0)
+			errors = true;
+		else
+			nframes++;
+		cmdp++;
+	}
+	if (errors) return usage_analyse_crcsearch();
+	if (bench) return crcsearch_bench(j);
+	if (nframes < 2) return usage_analyse_crcsearch();
+
+	argv[argc++] = "reveng";
+	argv[argc++] = "-w";
+	argv[argc++] = width;
+	argv[argc++] = "-j";
+	argv[argc++] = threads;
+	argv[argc++] = "-n";
+	argv[argc++] = count;
+	argv[argc++] = "-s";
+	for (int i = 0; i < nframes; i++)
+		argv[argc++] = frames[i];
+
+	uint64_t t1 = msclock();
+	int res = reveng_main(argc, argv);
+	PrintAndLogEx(NORMAL, "\nsearch time %" PRIu64 " ms", msclock() - t1);
+	return res ? 0 : 1;
+}
+
+static const bc_aes_backend_t *cipher_aes_ref(void) {
+	for (int i = 0; bc_aes_backends[i]; i++)
+		if (!strcmp(bc_aes_backends[i]->name, "polarssl"))
+			return bc_aes_backends[i];
+	return NULL;
+}
+
+static const bc_des_backend_t *cipher_des_ref(void) {
+	for (int i = 0; bc_des_backends[i]; i++)
+		if (!strcmp(bc_des_backends[i]->name, "polarssl"))
+			return bc_des_backends[i];
+	return NULL;
+}
+
+static void cipher_random(uint8_t *buf, size_t len) {
+	for (size_t i = 0; i < len; i++)
+		buf[i] = rand() & 0xFF;
+}
+
+// known answers,  then random data against polarssl in both directions
+static bool cipher_check_aes(const bc_aes_backend_t *be) {
+	static const size_t counts[] = { 1, 7, 63, 64, 65, 200 };
+	const uint8_t key[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+	const uint8_t pt[16] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+	const uint8_t ct[16] = { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+	const bc_aes_backend_t *ref = cipher_aes_ref();
+	uint8_t keys[200 * 16], in[200 * 16], out[200 * 16], exp[200 * 16], iv1[16], iv2[16];
+
+	be->ecb(key, BC_ENCRYPT, pt, out, 1);
+	if (memcmp(out, ct, 16)) return false;
+	be->ecb(key, BC_DECRYPT, ct, out, 1);
+	if (memcmp(out, pt, 16)) return false;
+
+	for (int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+		size_t n = counts[i];
+		for (int mode = BC_DECRYPT; mode <= BC_ENCRYPT; mode++) {
+			cipher_random(keys, sizeof(keys));
+			cipher_random(in, sizeof(in));
+			cipher_random(iv1, sizeof(iv1));
+			memcpy(iv2, iv1, sizeof(iv1));
+
+			be->ecb(keys, mode, in, out, n);
+			ref->ecb(keys, mode, in, exp, n);
+			if (memcmp(out, exp, n * 16)) return false;
+
+			be->cbc(keys, mode, iv1, in, out, n);
+			ref->cbc(keys, mode, iv2, in, exp, n);
+			if (memcmp(out, exp, n * 16) || memcmp(iv1, iv2, 16)) return false;
+
+			be->batch(keys, mode, in, out, n);
+			ref->batch(keys, mode, in, exp, n);
+			if (memcmp(out, exp, n * 16)) return false;
+		}
+	}
+	return true;
+}
+
+static bool cipher_check_des(const bc_des_backend_t *be) {
+	static const size_t counts[] = { 1, 7, 63, 64, 65, 200 };
+	// FIPS 46 worked example and the iClass master key on a default CSN
+	const uint8_t kat[2][3][8] = {
+		{
+			{ 0x13, 0x34, 0x57, 0x79, 0x9B, 0xBC, 0xDF, 0xF1 },
+			{ 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF },
+			{ 0x85, 0xE8, 0x13, 0x54, 0x0F, 0x0A, 0xB4, 0x05 }
+		}, {
+			{ 0x6c, 0x8d, 0x44, 0xf9, 0x2a, 0x2d, 0x01, 0xbf },
+			{ 0xbb, 0xbb, 0xaa, 0xaa, 0xbb, 0xbb, 0xee, 0xee },
+			{ 0xd6, 0xad, 0x3c, 0xa6, 0x19, 0x65, 0x9e, 0x6b }
+		}
+	};
+	const bc_des_backend_t *ref = cipher_des_ref();
+	uint8_t keys[200 * 8], in[200 * 8], out[200 * 8], exp[200 * 8];
+
+	for (int i = 0; i < 2; i++) {
+		// every lane the same,  so a bitsliced backend gets a full batch
+		for (int k = 0; k < 64; k++) {
+			memcpy(keys + 8 * k, kat[i][0], 8);
+			memcpy(in + 8 * k, kat[i][1], 8);
+		}
+		be->batch(keys, BC_ENCRYPT, in, out, 64);
+		for (int k = 0; k < 64; k++)
+			if (memcmp(out + 8 * k, kat[i][2], 8)) return false;
+	}
+
+	for (int i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+		size_t n = counts[i];
+		for (int mode = BC_DECRYPT; mode <= BC_ENCRYPT; mode++) {
+			cipher_random(keys, sizeof(keys));
+			cipher_random(in, sizeof(in));
+			be->batch(keys, mode, in, out, n);
+			ref->batch(keys, mode, in, exp, n);
+			if (memcmp(out, exp, n * 8)) return false;
+		}
+	}
+	return true;
+}
+
+#define CIPHER_BENCH_BLOCKS	4096
+
+// MB/s for one key over the whole buffer
+static double cipher_bench_aes(const bc_aes_backend_t *be, bool cbc, uint8_t *buf, uint8_t *keys) {
+	uint8_t iv[16] = {0};
+	int rounds = 0;
+	uint64_t t1 = msclock(), t2;
+	do {
+		for (int i = 0; i < 16; i++) {
+			if (cbc)
+				be->cbc(keys, BC_DECRYPT, iv, buf, buf, CIPHER_BENCH_BLOCKS);
+			else
+				be->ecb(keys, BC_ENCRYPT, buf, buf, CIPHER_BENCH_BLOCKS);
+		}
+		rounds += 16;
+		t2 = msclock();
+	} while (t2 - t1 < 200);
+	return (double)rounds * CIPHER_BENCH_BLOCKS * 16 / 1000.0 / (t2 - t1);
+}
+
+// thousand keys/s,  one block under each key
+static double cipher_bench_batch(void (*batch)(const uint8_t *, int, const uint8_t *, uint8_t *, size_t), uint8_t *keys, uint8_t *buf) {
+	int rounds = 0;
+	uint64_t t1 = msclock(), t2;
+	do {
+		for (int i = 0; i < 4; i++)
+			batch(keys, BC_ENCRYPT, buf, buf, CIPHER_BENCH_BLOCKS);
+		rounds += 4;
+		t2 = msclock();
+	} while (t2 - t1 < 200);
+	return (double)rounds * CIPHER_BENCH_BLOCKS / (t2 - t1);
+}
+
+int CmdAnalyseCipher(const char *Cmd) {
+	char name[32] = {0};
+	bool allok = true;
+	uint8_t cmdp = 0;
+
+	while (param_getchar(Cmd, cmdp) != 0x00) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+		case 'u':
+			if (param_getstr(Cmd, cmdp + 1, name, sizeof(name)) == 0)
+				return usage_analyse_cipher();
+			cmdp += 2;
+			break;
+		case 'h':
+		default:
+			return usage_analyse_cipher();
+		}
+	}
+
+	if (name[0]) {
+		if (!bc_set_backend(strcmp(name, "auto") ? name : NULL)) {
+			PrintAndLogEx(WARNING, "no available backend named %s", name);
+			return 1;
+		}
+		PrintAndLogEx(SUCCESS, "using AES %s, DES %s", bc_aes_backend()->name, bc_des_backend()->name);
+		return 0;
+	}
+
+	uint8_t *keys = calloc(CIPHER_BENCH_BLOCKS, 16);
+	uint8_t *buf = calloc(CIPHER_BENCH_BLOCKS, 16);
+	if (!keys || !buf) {
+		free(keys);
+		free(buf);
+		return 1;
+	}
+	cipher_random(keys, CIPHER_BENCH_BLOCKS * 16);
+	cipher_random(buf, CIPHER_BENCH_BLOCKS * 16);
+
+	PrintAndLogEx(NORMAL, "in use: AES %s, DES %s\n", bc_aes_backend()->name, bc_des_backend()->name);
+	PrintAndLogEx(NORMAL, "cipher | backend  | ECB MB/s | CBC dec MB/s | batch kkeys/s | result");
+	PrintAndLogEx(NORMAL, "-------+----------+----------+--------------+---------------+-------");
+
+	for (int i = 0; bc_aes_backends[i]; i++) {
+		const bc_aes_backend_t *be = bc_aes_backends[i];
+		if (!be->available()) {
+			PrintAndLogEx(NORMAL, "AES    | %-8s | %8s | %12s | %13s | n/a", be->name, "-", "-", "-");
+			continue;
+		}
+		bool ok = cipher_check_aes(be);
+		allok &= ok;
+		PrintAndLogEx(NORMAL, "AES    | %-8s | %8.1f | %12.1f | %13.1f | %s", be->name,
+			cipher_bench_aes(be, false, buf, keys),
+			cipher_bench_aes(be, true, buf, keys),
+			cipher_bench_batch(be->batch, keys, buf),
+			ok ? _GREEN_(ok) : _RED_(fail));
+	}
+
+	for (int i = 0; bc_des_backends[i]; i++) {
+		const bc_des_backend_t *be = bc_des_backends[i];
+		if (!be->available()) {
+			PrintAndLogEx(NORMAL, "DES    | %-8s | %8s | %12s | %13s | n/a", be->name, "-", "-", "-");
+			continue;
+		}
+		bool ok = cipher_check_des(be);
+		allok &= ok;
+		PrintAndLogEx(NORMAL, "DES    | %-8s | %8s | %12s | %13.1f | %s", be->name, "-", "-",
+			cipher_bench_batch(be->batch, keys, buf),
+			ok ? _GREEN_(ok) : _RED_(fail));
+	}
+
+	free(keys);
+	free(buf);
+	return allok ? 0 : 1;
+}
+
 int CmdAnalyseNuid(const char *Cmd){
 	uint8_t nuid[4] = {0};	
 	uint8_t uid[7] = {0};
@@ -863,9 +1301,11 @@ static command_t CommandTable[] = {
 	{"help",	CmdHelp,            1, "This help"},
 	{"lcr",		CmdAnalyseLCR,		1, "Generate final byte for XOR LRC"},
 	{"crc",		CmdAnalyseCRC,		1, "Stub method for CRC evaluations"},
+	{"crcsearch",	CmdAnalyseCrcSearch,	1, "Multithreaded search for the CRC model of some frames"},
 	{"chksum",	CmdAnalyseCHKSUM,	1, "Checksum with adding, masking and one's complement"},
 	{"dates",	CmdAnalyseDates,	1, "Look for datestamps in a given array of bytes"},
 	{"tea",   	CmdAnalyseTEASelfTest,	1, "Crypto TEA test"},
+	{"cipher",	CmdAnalyseCipher,	1, "AES / DES backend self test and benchmark"},
 	{"lfsr",	CmdAnalyseLfsr,		1,	"LFSR tests"},
 	{"a",		CmdAnalyseA,		1,	"num bits test"},
 	{"nuid",	CmdAnalyseNuid,		1,	"create NUID from 7byte UID"},
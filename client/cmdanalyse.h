@@ -25,12 +25,16 @@
 #include "loclass/elite_crack.h"
 #include "mfkey.h"  //nonce2key 
 #include "util_posix.h" // msclock
+#include "cmdcrc.h"     // reveng
+#include "blockcipher.h"
 
 
 int usage_analyse_lcr(void);
 int usage_analyse_checksum(void);
 int usage_analyse_crc(void);
+int usage_analyse_crcsearch(void);
 int usage_analyse_hid(void);
+int usage_analyse_cipher(void);
 int usage_analyse_nuid(void);
 
 int CmdAnalyse(const char *Cmd);
@@ -38,7 +42,9 @@ int CmdAnalyseLCR(const char *Cmd);
 int CmdAnalyseCHKSUM(const char *Cmd);
 int CmdAnalyseDates(const char *Cmd);
 int CmdAnalyseCRC(const char *Cmd);
+int CmdAnalyseCrcSearch(const char *Cmd);
 int CmdAnalyseTEASelfTest(const char *Cmd);
+int CmdAnalyseCipher(const char *Cmd);
 int CmdAnalyseLfsr(const char *Cmd);
 int CmdAnalyseHid(const char *Cmd);
 int CmdAnalyseNuid(const char *Cmd);
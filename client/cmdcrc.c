@@ -42,14 +42,16 @@ int split(char *str, char *arr[MAX_ARGS]){
 int CmdCrc(const char *Cmd)
 {
 	char name[] = {"reveng "};
-	char Cmd2[100 + 7];
+	char Cmd2[100 + 7 + 1] = {0};
 	memcpy(Cmd2, name, 7);
-	memcpy(Cmd2 + 7, Cmd, 100);
+	strncpy(Cmd2 + 7, Cmd, 100);
 	char *argv[MAX_ARGS];
 	int argc = split(Cmd2, argv);
 
 	if (argc == 3 && memcmp(argv[1],"-g",2)==0) {
 		CmdrevengSearch(argv[2]);
+	} else if (argc >= 2 && argc <= 3 && memcmp(argv[1],"-T",2)==0) {
+		CmdrevengBench(argc == 3 ? argv[2] : "");
 	} else {
 		reveng_main(argc, argv);
 	}
@@ -235,23 +237,11 @@ int GetModels(char *Models[], int *count, uint8_t *width){
 	return 1;
 }
 
-//-c || -v
-//inModel = valid model name string - CRC-8
-//inHexStr = input hex string to calculate crc on
-//reverse = reverse calc option if true
-//endian = {0 = calc default endian input and output, b = big endian input and output, B = big endian output, r = right justified
-//          l = little endian input and output, L = little endian output only, t = left justified}
-//result = calculated crc hex string
-int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *result){
-	/* default values */
-	static model_t model = MZERO;
-	
-	int ibperhx = 8, obperhx = 8;
+// apply the RunModel options to a preset,  the model is ready for pcrc() after this
+static int SetupModel(model_t *model, const char *inModel, bool reverse, char endian) {
 	int rflags = 0; // search flags 
 	int c;
-	poly_t apoly, crc;
-
-	char *string;
+	poly_t apoly;
 
 	// stdin must be binary
 	#ifdef _WIN32
@@ -260,7 +250,7 @@ int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *res
 
 	SETBMP();
 	//set model
-	if (!(c = mbynam(&model, inModel))) {
+	if (!(c = mbynam(model, inModel))) {
 		PrintAndLogEx(WARNING, "error: preset model '%s' not found.  Use reveng -D to list presets.", inModel);
 		return 0;
 	}
@@ -273,35 +263,35 @@ int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *res
 	//set flags
 	switch (endian) {
 		case 'b': /* b  big-endian (RefIn = false, RefOut = false ) */
-			model.flags &= ~P_REFIN;
+			model->flags &= ~P_REFIN;
 			rflags |= R_HAVERI;
 			/* fall through: */
 		case 'B': /* B  big-endian output (RefOut = false) */
-			model.flags &= ~P_REFOUT;
+			model->flags &= ~P_REFOUT;
 			rflags |= R_HAVERO;
-			mnovel(&model);
+			mnovel(model);
 			/* fall through: */
 		case 'r': /* r  right-justified */
-			model.flags |= P_RTJUST;
+			model->flags |= P_RTJUST;
 			break;
 		case 'l': /* l  little-endian input and output */
-			model.flags |= P_REFIN;
+			model->flags |= P_REFIN;
 			rflags |= R_HAVERI;
 			/* fall through: */
 		case 'L': /* L  little-endian output */
-			model.flags |= P_REFOUT;
+			model->flags |= P_REFOUT;
 			rflags |= R_HAVERO;
-			mnovel(&model);
+			mnovel(model);
 			/* fall through: */
 		case 't': /* t  left-justified */
-			model.flags &= ~P_RTJUST;
+			model->flags &= ~P_RTJUST;
 			break;
 	}
 	/* canonicalise the model, so the one we dump is the one we
 	 * calculate with (not with -s, spoly may be blank which will
 	 * normalise to zero and clear init and xorout.)
 	 */
-	mcanon(&model);
+	mcanon(model);
 
 
 	if (reverse) {
@@ -310,7 +300,7 @@ int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *res
 		 * the arguments and output to be reversed as well.
 		 */
 		// reciprocate Poly
-		prcp(&model.spoly);
+		prcp(&model->spoly);
 
 		/* mrev() does:
 		 *   if(refout) prev(init); else prev(xorout);
@@ -320,23 +310,273 @@ int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *res
 		 * Consequently Init is the mirror image of the
 		 * one resulting from -V, and so we have:
 		 */
-		if (~model.flags & P_REFOUT) {
-			prev(&model.init);
-			prev(&model.xorout);
+		if (~model->flags & P_REFOUT) {
+			prev(&model->init);
+			prev(&model->xorout);
 		}
 
 		// swap init and xorout
-		apoly = model.init;
-		model.init = model.xorout;
-		model.xorout = apoly;
+		apoly = model->init;
+		model->init = model->xorout;
+		model->xorout = apoly;
 	}
 	// c  calculate CRC
 
 	/* in the Williams model, xorout is applied after the refout stage.
 	 * as refout is part of ptostr(), we reverse xorout here.
 	 */
-	if (model.flags & P_REFOUT)
-		prev(&model.xorout);
+	if (model->flags & P_REFOUT)
+		prev(&model->xorout);
+
+	return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Precompiled presets for the table driven engine.
+// Every preset/reverse/endian combination is run through SetupModel() once,
+// the resulting spoly/init/xorout are kept as integers with a slice-by-8
+// table.  Models wider than 64 bits or not Williams compliant stay on pcrc().
+//-----------------------------------------------------------------------------
+typedef struct {
+	char *name;                     // upper case key
+	bool reverse;
+	char endian;
+	bool fast;
+	int flags;
+	uint8_t width;
+	uint64_t poly;
+	uint64_t init;
+	uint64_t xorout;
+	const crcengine_table_t *tbl;   // built on first use
+} crcpreset_t;
+
+#define CRCPRESET_HASH 1024
+
+static crcpreset_t *crcpresets = NULL;
+static int crcpresets_count = 0, crcpresets_size = 0;
+static int crcpresets_hash[CRCPRESET_HASH];
+
+static uint32_t crcpreset_key(const char *name, bool reverse, char endian) {
+	uint32_t h = 5381;
+	for (; *name; name++)
+		h = h * 33 + toupper((unsigned char)*name);
+	return (h * 33 + (reverse ? 1 : 0)) * 33 + (uint8_t)endian;
+}
+
+// poly_t to integer,  a shorter poly is aligned to the top like pcrc() does
+static bool poly_to_u64(const poly_t p, uint8_t width, uint64_t *v) {
+	if (p.length > width) return false;
+	*v = 0;
+	for (unsigned long i = 0; i < p.length; i++)
+		*v = (*v << 1) | ((p.bitmap[i / BMP_BIT] >> (BMP_BIT - 1 - (i % BMP_BIT))) & 1);
+	*v <<= (width - p.length);
+	return true;
+}
+
+static poly_t u64_to_poly(uint64_t v, uint8_t width) {
+	poly_t p = PZERO;
+	palloc(&p, width);
+	for (unsigned long i = 0; i < width; i++)
+		if ((v >> (width - 1 - i)) & 1)
+			p.bitmap[i / BMP_BIT] |= BMP_C(1) << (BMP_BIT - 1 - (i % BMP_BIT));
+	return p;
+}
+
+static bool crcpreset_name_eq(const char *upper, const char *name) {
+	for (; *upper && toupper((unsigned char)*name) == *upper; upper++, name++);
+	return *upper == 0 && *name == 0;
+}
+
+static crcpreset_t *crcpreset_find(const char *name, bool reverse, char endian) {
+	if (!crcpresets) return NULL;
+	uint32_t h = crcpreset_key(name, reverse, endian);
+	for (uint32_t i = 0; i < CRCPRESET_HASH; i++) {
+		int idx = crcpresets_hash[(h + i) % CRCPRESET_HASH];
+		if (idx < 0) return NULL;
+		crcpreset_t *p = &crcpresets[idx];
+		if (p->reverse == reverse && p->endian == endian && crcpreset_name_eq(p->name, name))
+			return p;
+	}
+	return NULL;
+}
+
+static crcpreset_t *crcpreset_add(const char *name, bool reverse, char endian) {
+	if (crcpresets_count >= CRCPRESET_HASH / 2)
+		return NULL;
+
+	if (!crcpresets) {
+		for (int i = 0; i < CRCPRESET_HASH; i++)
+			crcpresets_hash[i] = -1;
+	}
+	if (crcpresets_count == crcpresets_size) {
+		int size = crcpresets_size ? crcpresets_size * 2 : 128;
+		crcpreset_t *tmp = realloc(crcpresets, size * sizeof(crcpreset_t));
+		if (!tmp) return NULL;
+		crcpresets = tmp;
+		crcpresets_size = size;
+	}
+
+	model_t model = MZERO;
+	if (!SetupModel(&model, name, reverse, endian)) {
+		mfree(&model);
+		return NULL;
+	}
+
+	crcpreset_t *p = &crcpresets[crcpresets_count];
+	memset(p, 0, sizeof(crcpreset_t));
+	p->name = calloc(strlen(name) + 1, sizeof(char));
+	if (!p->name) {
+		mfree(&model);
+		return NULL;
+	}
+	for (size_t i = 0; name[i]; i++)
+		p->name[i] = toupper((unsigned char)name[i]);
+	p->reverse = reverse;
+	p->endian = endian;
+	p->flags = model.flags;
+	unsigned long width = plen(model.spoly);
+	if (width > 0 && width <= CRCENGINE_MAX_WIDTH && (model.flags & P_MULXN)) {
+		p->width = (uint8_t)width;
+		p->fast = poly_to_u64(model.spoly, p->width, &p->poly)
+		       && poly_to_u64(model.init, p->width, &p->init)
+		       && poly_to_u64(model.xorout, p->width, &p->xorout);
+	}
+	mfree(&model);
+
+	uint32_t h = crcpreset_key(name, reverse, endian);
+	for (uint32_t i = 0; i < CRCPRESET_HASH; i++) {
+		if (crcpresets_hash[(h + i) % CRCPRESET_HASH] < 0) {
+			crcpresets_hash[(h + i) % CRCPRESET_HASH] = crcpresets_count;
+			break;
+		}
+	}
+	return &crcpresets[crcpresets_count++];
+}
+
+// precompile all presets in the modes CmdrevengSearch uses
+static void crcpresets_init(void) {
+	static bool done = false;
+	if (done) return;
+	done = true;
+
+	model_t model = MZERO;
+	SETBMP();
+	int count = mcount();
+	for (int i = 0; i < count; i++) {
+		mbynum(&model, i);
+		if (model.name && *model.name) {
+			if (!crcpreset_find(model.name, false, 0)) crcpreset_add(model.name, false, 0);
+			if (!crcpreset_find(model.name, true, 0)) crcpreset_add(model.name, true, 0);
+		}
+	}
+	mfree(&model);
+}
+
+// hex string to bytes with the strtop() rules for bperhx = 8.
+// false on characters strtop() would complain about
+static bool crc_hex_to_bytes(const char *s, uint8_t **out, size_t *outlen) {
+	// 0..15 nibble,  16 skipped whitespace,  17 invalid
+	static uint8_t hexval[256];
+	if (!hexval[0]) {
+		for (int c = 0; c < 256; c++)
+			hexval[c] = isxdigit(c) ? (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10) : 17;
+		hexval[' '] = hexval['\t'] = hexval['\r'] = hexval['\n'] = 16;
+	}
+
+	if (*s == '$' || *s == '&')
+		++s;
+	else if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+		s += 2;
+
+	uint8_t *buf = calloc(strlen(s) / 2 + 1, sizeof(uint8_t));
+	if (!buf) return false;
+
+	size_t n = 0;
+	int count = 0, accu = 0;
+	for (; *s; s++) {
+		// plain digit pairs in one go
+		if (count == 0) {
+			uint8_t hi = hexval[(uint8_t)s[0]], lo;
+			while (hi < 16 && (lo = hexval[(uint8_t)s[1]]) < 16) {
+				buf[n++] = (hi << 4) | lo;
+				s += 2;
+				hi = hexval[(uint8_t)s[0]];
+			}
+			if (!*s) break;
+		}
+		uint8_t v = hexval[(uint8_t)*s];
+		if (v > 15) {
+			if (v == 16) continue;
+			free(buf);
+			return false;
+		}
+		accu = (accu << 4) | v;
+		if (++count == 2) {
+			buf[n++] = accu & 0xff;
+			count = 0;
+			accu = 0;
+		}
+	}
+	*out = buf;
+	*outlen = n;
+	return true;
+}
+
+static int RunModelFast(crcpreset_t *p, const char *inHexStr, char *result) {
+	uint8_t *data;
+	size_t len;
+	if (!crc_hex_to_bytes(inHexStr, &data, &len))
+		return -1;
+
+	if (!p->tbl) {
+		// the bytes go in reflected when RefIn,  reverse flips the whole
+		// message so the bytes are also taken last to first and bit reversed
+		bool reflected = ((p->flags & P_REFIN) != 0) ^ p->reverse;
+		p->tbl = crcengine_table(p->width, p->poly, reflected);
+		if (!p->tbl) {
+			free(data);
+			return -1;
+		}
+	}
+
+	if (p->reverse) {
+		for (size_t i = 0; i < len / 2; i++) {
+			uint8_t t = data[i];
+			data[i] = data[len - 1 - i];
+			data[len - 1 - i] = t;
+		}
+	}
+
+	uint64_t crc = crcengine_calc(p->tbl, p->init, data, len) ^ p->xorout;
+	free(data);
+
+	if (p->reverse)
+		crc = crcengine_reflect(crc, p->width);
+
+	poly_t pcrc = u64_to_poly(crc, p->width);
+	char *string = ptostr(pcrc, p->flags, 8);
+	pfree(&pcrc);
+	if (!string) return -1;
+	for (int i = 0; i < 50; i++){
+		result[i] = string[i];
+		if (result[i]==0) break;
+	}
+	free(string);
+	return 1;
+}
+
+// the original bit serial evaluation
+static int RunModelPoly(char *inModel, char *inHexStr, bool reverse, char endian, char *result){
+	/* default values */
+	static model_t model = MZERO;
+	
+	int ibperhx = 8, obperhx = 8;
+	poly_t apoly, crc;
+
+	char *string;
+
+	if (!SetupModel(&model, inModel, reverse, endian))
+		return 0;
 
 	apoly = strtop(inHexStr, model.flags, ibperhx);
 
@@ -359,6 +599,33 @@ int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *res
 	return 1;
 }
 
+//-c || -v
+//inModel = valid model name string - CRC-8
+//inHexStr = input hex string to calculate crc on
+//reverse = reverse calc option if true
+//endian = {0 = calc default endian input and output, b = big endian input and output, B = big endian output, r = right justified
+//          l = little endian input and output, L = little endian output only, t = left justified}
+//result = calculated crc hex string
+int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *result){
+
+	crcpresets_init();
+
+	crcpreset_t *p = crcpreset_find(inModel, reverse, endian);
+	if (!p) {
+		// cache full,  evaluate without it
+		if (crcpresets_count >= CRCPRESET_HASH / 2)
+			return RunModelPoly(inModel, inHexStr, reverse, endian, result);
+		// unknown models are reported by SetupModel()
+		p = crcpreset_add(inModel, reverse, endian);
+		if (!p) return 0;
+	}
+
+	if (p->fast && RunModelFast(p, inHexStr, result) > 0)
+		return 1;
+
+	return RunModelPoly(inModel, inHexStr, reverse, endian, result);
+}
+
 //test call to RunModel
 int CmdrevengTestC(const char *Cmd){
 	int cmdp = 0;
@@ -382,6 +649,92 @@ int CmdrevengTestC(const char *Cmd){
 	return 1;
 }
 
+// compares the table engine with pcrc() for every preset and option,  then
+// measures evaluations/s of both on inputs of the given size
+int CmdrevengBench(const char *Cmd){
+	uint32_t size = param_get32ex(Cmd, 0, 1024, 10);
+	if (size == 0 || size > 0x10000) size = 1024;
+
+	crcpresets_init();
+
+	model_t model = MZERO;
+	SETBMP();
+	int count = mcount();
+	char *hex = calloc(size * 2 + 1, sizeof(char));
+	if (!hex) return 0;
+
+	static const char endians[] = { 0, 'b', 'B', 'r', 'l', 'L', 't' };
+	static const int lens[] = { 0, 1, 3, 8, 9, 17, 64 };
+	char fast[60], slow[60];
+	int checked = 0, failed = 0;
+
+	srand(0x1d0f);
+	for (int i = 0; i < count; i++) {
+		mbynum(&model, i);
+		char *name = (char *)model.name;
+		if (!name || !*name) continue;
+		for (int r = 0; r < 2; r++) {
+			for (size_t e = 0; e < sizeof(endians); e++) {
+				for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+					for (int j = 0; j < lens[l]; j++)
+						sprintf(hex + j * 2, "%02x", rand() & 0xff);
+					hex[lens[l] * 2] = 0;
+					memset(fast, 0, sizeof(fast));
+					memset(slow, 0, sizeof(slow));
+					RunModel(name, hex, r, endians[e], fast);
+					RunModelPoly(name, hex, r, endians[e], slow);
+					checked++;
+					if (strcmp(fast, slow)) {
+						failed++;
+						PrintAndLogEx(FAILED, "%s%s endian '%c' len %d : table %s  poly %s",
+							name, r ? " reversed" : "", endians[e] ? endians[e] : '0', lens[l], fast, slow);
+					}
+				}
+			}
+		}
+	}
+	PrintAndLogEx(NORMAL, "self test %d evaluations : %s", checked, failed ? _RED_(failed) : _GREEN_(ok));
+
+	for (uint32_t j = 0; j < size; j++)
+		sprintf(hex + j * 2, "%02x", rand() & 0xff);
+
+	PrintAndLogEx(NORMAL, "\n%u byte input", size);
+	PrintAndLogEx(NORMAL, "  model                  | width | engine | poly eval/s | table eval/s");
+	PrintAndLogEx(NORMAL, "  -----------------------+-------+--------+-------------+-------------");
+	double tot_poly = 0, tot_table = 0;
+	int models = 0;
+	for (int i = 0; i < count; i++) {
+		mbynum(&model, i);
+		char *name = (char *)model.name;
+		if (!name || !*name) continue;
+		crcpreset_t *p = crcpreset_find(name, false, 0);
+
+		double rate[2];
+		for (int k = 0; k < 2; k++) {
+			uint64_t t1 = msclock(), t2;
+			int n = 0;
+			do {
+				for (int m = 0; m < 16; m++)
+					(k ? RunModel : RunModelPoly)(name, hex, false, 0, fast);
+				n += 16;
+				t2 = msclock();
+			} while (t2 - t1 < 40);
+			rate[k] = n * 1000.0 / (t2 - t1);
+		}
+		tot_poly += 1.0 / rate[0];
+		tot_table += 1.0 / rate[1];
+		models++;
+		PrintAndLogEx(NORMAL, "  %-22s | %5lu | %-6s | %11.0f | %12.0f", name, plen(model.spoly),
+			(p && p->fast) ? "table" : "poly", rate[0], rate[1]);
+	}
+	PrintAndLogEx(NORMAL, "\nall %d presets once : poly %.0f/s  table %.0f/s  (%.1fx)",
+		models, 1.0 / tot_poly, 1.0 / tot_table, tot_poly / tot_table);
+
+	mfree(&model);
+	free(hex);
+	return 1;
+}
+
 //returns a calloced string (needs to be freed)
 char *SwapEndianStr(const char *inStr, const size_t len, const uint8_t blockSize){
 	char *tmp = calloc(len+1, sizeof(char));
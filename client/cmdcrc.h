@@ -25,6 +25,8 @@
 #include <ctype.h>
 #include "cmdmain.h"
 #include "reveng/reveng.h"
+#include "crcengine.h"
+#include "util_posix.h"
 #include "ui.h"
 #include "util.h"
 
@@ -33,6 +35,7 @@
 extern int CmdCrc(const char *Cmd);
 
 extern int CmdrevengSearch(const char *Cmd);
+extern int CmdrevengBench(const char *Cmd);
 extern int GetModels(char *Models[], int *count, uint8_t *width);
 extern int RunModel(char *inModel, char *inHexStr, bool reverse, char endian, char *result);
 #endif
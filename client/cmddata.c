@@ -235,6 +235,91 @@ int usage_data_fsktonrz() {
 		return 0;	
 }
 
+int usage_data_streamdemod(void) {
+	PrintAndLogEx(NORMAL, "Demodulate GraphBuffer with the streaming demod, samples are pushed in chunks");
+	PrintAndLogEx(NORMAL, "Usage: data streamdemod <ar|am|nr|fs|p1> [c <clock>] [i] [s <chunk>] [t [iterations]]");
+	PrintAndLogEx(NORMAL, "       data streamdemod t [iterations]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "       h               This help");
+	PrintAndLogEx(NORMAL, "       <modulation>    'ar' ask/raw, 'am' ask/manchester, 'nr' nrz, 'fs' fsk, 'p1' psk1");
+	PrintAndLogEx(NORMAL, "       c <clock>       enter the clock (omit to autodetect)");
+	PrintAndLogEx(NORMAL, "       i               invert output");
+	PrintAndLogEx(NORMAL, "       s <chunk>       chunk size in samples (default 512)");
+	PrintAndLogEx(NORMAL, "       t [iterations]  trained on the whole trace, fed in random chunk sizes the bits must be the ones of");
+	PrintAndLogEx(NORMAL, "                       askdemod / nrzRawDemod / fskdemod / pskRawDemod (default 50 iterations)");
+	PrintAndLogEx(NORMAL, "                       without a modulation every one is checked");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "   Example: data streamdemod am");
+	PrintAndLogEx(NORMAL, "            data streamdemod fs c 50 t 100");
+	PrintAndLogEx(NORMAL, "            data streamdemod t");
+	return 0;
+}
+
+int usage_data_filter(void) {
+	PrintAndLogEx(NORMAL, "Apply a chain of filters to GraphBuffer, block wise in as few passes as possible");
+	PrintAndLogEx(NORMAL, "Usage: data filter [h] [t] <filter> [<filter> ...]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "       h                  This help");
+	PrintAndLogEx(NORMAL, "       t                  self test and benchmark of filter chains over the max graph length");
+	PrintAndLogEx(NORMAL, "Filters:");
+	PrintAndLogEx(NORMAL, "       hpf                remove DC offset (data hpf)");
+	PrintAndLogEx(NORMAL, "       norm               normalize max/min to +/-128 (data norm)");
+	PrintAndLogEx(NORMAL, "       dt <up> <down>     directional threshold (data dirthreshold)");
+	PrintAndLogEx(NORMAL, "       ed <threshold>     ask edge detect (data askedgedetect)");
+	PrintAndLogEx(NORMAL, "       lp <k>             simple lowpass filter (data iir)");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "   Example: data filter hpf norm ed 25");
+	PrintAndLogEx(NORMAL, "            data filter t");
+	return 0;
+}
+int usage_data_plot(void) {
+	PrintAndLogEx(NORMAL, "Show graph window (hit 'h' in window for keystroke help)");
+	PrintAndLogEx(NORMAL, "Usage: data plot [h] [b] [w <width>] [n <frames>]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "       h                  This help");
+	PrintAndLogEx(NORMAL, "       b                  headless render benchmark at several zoom levels, no window is shown");
+	PrintAndLogEx(NORMAL, "                          uses GraphBuffer if loaded, else a synthetic max length trace");
+	PrintAndLogEx(NORMAL, "       w <width>          plot width in pixels (default 1024)");
+	PrintAndLogEx(NORMAL, "       n <frames>         frames per zoom level (default 100)");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "   Example: data plot");
+	PrintAndLogEx(NORMAL, "            data plot b w 1920");
+	return 0;
+}
+
+int usage_data_compress(void) {
+	PrintAndLogEx(NORMAL, "Tests the delta / run length coding of 'lf config c 1' on .pm3 traces and shows the compression ratio");
+	PrintAndLogEx(NORMAL, "and the encode / decode cost per sample, against the bits per sample packing of BigBuf");
+	PrintAndLogEx(NORMAL, "Usage: data compress [h] [v] [f <file>] [d <dir>] [b <bps>] [r <rounds>]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "       h                  This help");
+	PrintAndLogEx(NORMAL, "       f <file>           ratio and cost of one .pm3 trace");
+	PrintAndLogEx(NORMAL, "       d <dir>            ratio and cost of the .pm3 traces in dir (default traces/)");
+	PrintAndLogEx(NORMAL, "       b <bps>            bits per sample, as 'lf config b' (default 8)");
+	PrintAndLogEx(NORMAL, "       r <rounds>         encode / decode rounds per trace (default 200)");
+	PrintAndLogEx(NORMAL, "       v                  verbose");
+	PrintAndLogEx(NORMAL, "Without f, d, b or r the tests run, synthetic streams and the traces at all bits per sample");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "   Example: data compress");
+	PrintAndLogEx(NORMAL, "            data compress b 4");
+	PrintAndLogEx(NORMAL, "            data compress f ../traces/em4x50.pm3 r 1000");
+	return 0;
+}
+
+int usage_data_pack(void) {
+	PrintAndLogEx(NORMAL, "Tests the word wide sample packing of DoAcquisition against the bit by bit pushBit one it replaced");
+	PrintAndLogEx(NORMAL, "Usage: data pack [h] [v] [b [<rounds>]]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "       h                  This help");
+	PrintAndLogEx(NORMAL, "       b [<rounds>]       throughput of both over the max graph length (default 20 rounds)");
+	PrintAndLogEx(NORMAL, "       v                  verbose");
+	PrintAndLogEx(NORMAL, "Without b the tests run, all bits per sample, decimations and buffer sizes");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "   Example: data pack");
+	PrintAndLogEx(NORMAL, "            data pack b 100");
+	return 0;
+}
+
 //set the demod buffer with given array of binary (one bit per byte)
 //by marshmellow
 void setDemodBuf(uint8_t *buf, size_t size, size_t startIdx) {
@@ -897,14 +982,7 @@ int CmdGraphShiftZero(const char *Cmd) {
 }
 
 int AskEdgeDetect(const int *in, int *out, int len, int threshold) {
-	int last = 0;
-	for(int i = 1; i<len; i++) {
-		if (in[i] - in[i-1] >= threshold) //large jump up
-			last = 127;
-		else if (in[i] - in[i-1] <= -1 * threshold) //large jump down
-			last = -127;
-		out[i-1] = last;
-	}
+	lffilter_edge(in, out, len, threshold);
 	return 0;
 }
 
@@ -1364,17 +1442,7 @@ int CmdHide(const char *Cmd)
 //zero mean GraphBuffer
 int CmdHpf(const char *Cmd)
 {
-	int i;
-	int accum = 0;
-
-	for (i = 10; i < GraphTraceLen; ++i)
-		accum += GraphBuffer[i];
-	
-	accum /= (GraphTraceLen - 10);
-	
-	for (i = 0; i < GraphTraceLen; ++i)
-		GraphBuffer[i] -= accum;
-
+	lffilter_hpf(GraphBuffer, GraphTraceLen);
 	RepaintGraphWindow();
 	return 0;
 }
@@ -1417,14 +1485,39 @@ int getSamples(int n, bool silent) {
 	if (!silent) PrintAndLogEx(NORMAL, "Data fetched");
 	
 	uint8_t bits_per_sample = 8;
+	bool compression = false;
 
 	//Old devices without this feature would send 0 at arg[0]
 	if (response.arg[0] > 0) {
 		sample_config *sc = (sample_config *) response.d.asBytes;
-		if (!silent) PrintAndLogEx(NORMAL, "Samples @ %d bits/smpl, decimation 1:%d ", sc->bits_per_sample, sc->decimation);
+		if (!silent) PrintAndLogEx(NORMAL, "Samples @ %d bits/smpl, decimation 1:%d %s", sc->bits_per_sample, sc->decimation, (sc->compression) ? "compressed" : "");
 		bits_per_sample = sc->bits_per_sample;
+		compression = sc->compression;
 	}
 	
+	if (compression) {
+		uint8_t *samples = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+		if (!samples) {
+			PrintAndLogEx(WARNING, "Cannot allocate memory for the samples");
+			return 2;
+		}
+		size_t j = lfcompress_decode(got, n, samples, MAX_GRAPH_TRACE_LEN);
+		for (size_t i = 0; i < j; i++) {
+			samples[i] <<= (8 - bits_per_sample);
+			GraphBuffer[i] = ((int)samples[i]) - 128;
+		}
+		GraphTraceLen = j;
+		if (!silent) PrintAndLogEx(NORMAL, "Decompressed %u samples from %d bytes" , (uint32_t)j, n);
+
+		justNoise(samples, j);
+		free(samples);
+
+		setClockGrid(0, 0);
+		DemodBufferLen = 0;
+		RepaintGraphWindow();
+		return 0;
+	}
+
 	if (bits_per_sample < 8) {
 		if (!silent) PrintAndLogEx(NORMAL, "Unpacking...");
 		BitstreamOut bout = { got, bits_per_sample * n,  0};
@@ -1538,6 +1631,7 @@ int CmdTuneSamples(const char *Cmd) {
 		GraphBuffer[i] = resp.d.asBytes[i] - 128;
 		test += resp.d.asBytes[i];
 	}
+	graphlod_touch();
 	if ( test > 0 ) {
 		PrintAndLogEx(SUCCESS, "\nDisplaying LF tuning graph. Divisor 89 is 134khz, 95 is 125khz.\n\n");
 		GraphTraceLen = 256;
@@ -1624,30 +1718,143 @@ int CmdMtrim(const char *Cmd) {
 
 int CmdNorm(const char *Cmd)
 {
-	int i;
-	int max = INT_MIN, min = INT_MAX;
-
-	for (i = 10; i < GraphTraceLen; ++i) {
-		if (GraphBuffer[i] > max) max = GraphBuffer[i];
-		if (GraphBuffer[i] < min) min = GraphBuffer[i];
-	}
-
-	if (max != min) {
-		for (i = 0; i < GraphTraceLen; ++i) {
-			GraphBuffer[i] = ((long)(GraphBuffer[i] - ((max + min) / 2)) * 256) / (max - min);
-			//marshmelow: adjusted *1000 to *256 to make +/- 128 so demod commands still work
-		}
-	}
+	//marshmelow: adjusted *1000 to *256 to make +/- 128 so demod commands still work
+	lffilter_norm(GraphBuffer, GraphTraceLen);
 	RepaintGraphWindow();
 	return 0;
 }
 
 int CmdPlot(const char *Cmd)
 {
+	bool bench = false, errors = false;
+	uint32_t width = 1024, frames = 100;
+	uint8_t cmdp = 0;
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+		case 'h':
+			return usage_data_plot();
+		case 'b':
+			bench = true;
+			cmdp++;
+			break;
+		case 'w':
+			width = param_get32ex(Cmd, cmdp + 1, 1024, 10);
+			cmdp += 2;
+			break;
+		case 'n':
+			frames = param_get32ex(Cmd, cmdp + 1, 100, 10);
+			cmdp += 2;
+			break;
+		default:
+			PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
+			errors = true;
+			break;
+		}
+	}
+	if (errors) return usage_data_plot();
+
+	if (bench)
+		return graphlod_bench(GraphBuffer, GraphTraceLen, width, frames);
+
 	ShowGraphWindow();
 	return 0;
 }
 
+int CmdDataCompress(const char *Cmd)
+{
+	char filename[FILE_PATH_SIZE] = {0x00};
+	char dir[FILE_PATH_SIZE] = {0x00};
+	bool bench = false, verbose = false, errors = false;
+	uint8_t bps = 8;
+	uint32_t rounds = 200;
+	uint8_t cmdp = 0;
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+		case 'h':
+			return usage_data_compress();
+		case 'f':
+			errors = param_getstr(Cmd, cmdp + 1, filename, sizeof(filename)) == 0;
+			bench = true;
+			cmdp += 2;
+			break;
+		case 'd':
+			errors = param_getstr(Cmd, cmdp + 1, dir, sizeof(dir) - 1) == 0;
+			bench = true;
+			cmdp += 2;
+			break;
+		case 'b':
+			bps = param_get8ex(Cmd, cmdp + 1, 8, 10);
+			errors = (bps < 1 || bps > 8);
+			bench = true;
+			cmdp += 2;
+			break;
+		case 'r':
+			rounds = param_get32ex(Cmd, cmdp + 1, 200, 10);
+			errors = (rounds == 0);
+			bench = true;
+			cmdp += 2;
+			break;
+		case 'v':
+			verbose = true;
+			cmdp++;
+			break;
+		default:
+			PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
+			errors = true;
+			break;
+		}
+	}
+	if (errors) return usage_data_compress();
+
+	if (dir[0]) {
+		size_t len = strlen(dir);
+		if (dir[len - 1] != '/' && dir[len - 1] != '\\')
+			strcat(dir, "/");
+	} else {
+		snprintf(dir, sizeof(dir), "%s../traces/", get_my_executable_directory());
+	}
+
+	if (!bench)
+		return lfcompress_test(dir, verbose);
+
+	return lfcompress_bench(dir, (filename[0]) ? filename : NULL, bps, rounds);
+}
+
+int CmdDataPack(const char *Cmd)
+{
+	bool verbose = false, errors = false;
+	uint32_t rounds = 0;
+	uint8_t cmdp = 0;
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+		case 'h':
+			return usage_data_pack();
+		case 'b':
+			rounds = 20;
+			cmdp++;
+			if (isdigit((unsigned char)param_getchar(Cmd, cmdp))) {
+				rounds = param_get32ex(Cmd, cmdp, 0, 10);
+				errors = (rounds == 0);
+				cmdp++;
+			}
+			break;
+		case 'v':
+			verbose = true;
+			cmdp++;
+			break;
+		default:
+			PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
+			errors = true;
+			break;
+		}
+	}
+	if (errors) return usage_data_pack();
+
+	if (rounds)
+		return lfpack_bench(rounds);
+	return lfpack_test(verbose);
+}
+
 int CmdSave(const char *Cmd)
 {
 	char filename[FILE_PATH_SIZE] = {0x00};
@@ -1686,29 +1893,8 @@ int CmdScale(const char *Cmd)
 
 int directionalThreshold(const int* in, int *out, size_t len, int8_t up, int8_t down)
 {
-	int lastValue = in[0];
-	out[0] = 0; // Will be changed at the end, but init 0 as we adjust to last samples value if no threshold kicks in.
-
-	for (size_t i = 1; i < len; ++i) {
-		// Apply first threshold to samples heading up
-		if (in[i] >= up && in[i] > lastValue)
-		{
-			lastValue = out[i]; // Buffer last value as we overwrite it.
-			out[i] = 1;
-		}
-		// Apply second threshold to samples heading down
-		else if (in[i] <= down && in[i] < lastValue)
-		{
-			lastValue = out[i]; // Buffer last value as we overwrite it.
-			out[i] = -1;
-		}
-		else
-		{
-			lastValue = out[i]; // Buffer last value as we overwrite it.
-			out[i] = out[i-1];
-		}
-	}
-	out[0] = out[1]; // Align with first edited sample.
+	// Max rising higher up-thres / Min falling lower down-thres, keep rest as prev.
+	lffilter_dirthreshold(in, out, len, up, down);
 	return 0;
 }
 
@@ -2008,10 +2194,257 @@ int CmdFSKToNRZ(const char *Cmd) {
 }
 
 
+static const char *StreamDemodName(uint8_t mod) {
+	static const char *names[] = {"ask/raw", "ask/manchester", "nrz", "fsk", "psk1"};
+	return (mod <= LFS_PSK1) ? names[mod] : "?";
+}
+
+// the whole capture demod of mod on bits,  returns the number of bits or -1 when it found none.
+// capped is set when it stopped at its own limit of bits.
+static int StreamDemodReference(uint8_t mod, uint8_t *bits, size_t size, int clk, int invert, lfstream_t *trained, bool *capped) {
+	int startIdx = 0;
+	size_t len = size;
+	*capped = false;
+	switch (mod) {
+		case LFS_ASK_RAW:
+		case LFS_ASK_MAN:
+			if (askdemod_ext(bits, &size, &clk, &invert, 100, 0, (mod == LFS_ASK_MAN), &startIdx) < 0) return -1;
+			// manrawdecode stops after 513 bits,  the peak sampling after 3072
+			*capped = (trained->clean) ? (mod == LFS_ASK_MAN && size == 513) : (size == 3072);
+			break;
+		case LFS_NRZ:
+			if (nrzRawDemod(bits, &size, &clk, &invert, &startIdx) < 0) return -1;
+			break;
+		case LFS_FSK:
+			// fsk rawdemod uses the field clocks and clock lfstream_train found the same way
+			size = fskdemod(bits, size, trained->clk, invert, trained->fchigh, trained->fclow, &startIdx);
+			break;
+		case LFS_PSK1:
+			// on too many short waves it gives up and leaves size as it is
+			if (pskRawDemod_ext(bits, &size, &clk, &invert, &startIdx) < 0 || size == len) return -1;
+			break;
+		default:
+			return -1;
+	}
+	return (size) ? (int)size : -1;
+}
+
+// trained on all samples,  the stream fed in random chunks must give the bits of the whole capture demod.
+// returns 1 when they differ,  0 when they are the same or there is nothing to compare.
+static int StreamDemodCheck(uint8_t mod, uint8_t *samples, size_t size, int clk, int invert, uint32_t iterations, uint8_t *ref, uint8_t *out) {
+	const char *name = StreamDemodName(mod);
+
+	lfstream_t trained;
+	lfstream_init(&trained, mod, clk, invert, 0, 0);
+	if (!lfstream_train(&trained, samples, size)) {
+		PrintAndLogEx(NORMAL, "  %-15s no clock / thresholds found, skipped", name);
+		return 0;
+	}
+
+	memcpy(ref, samples, size);
+	bool capped = false;
+	int refLen = StreamDemodReference(mod, ref, size, clk, invert, &trained, &capped);
+	if (refLen < 0) {
+		PrintAndLogEx(NORMAL, "  %-15s no reference demod, skipped", name);
+		return 0;
+	}
+
+	uint32_t failed = 0;
+	size_t outLen = 0;
+	for (uint32_t n = 0; n < iterations; n++) {
+		lfstream_t st = trained;
+		outLen = 0;
+		for (size_t i = 0; i < size; ) {
+			size_t len = (rand() % 4096) + 1;
+			if (len > size - i) len = size - i;
+			outLen += lfstream_push(&st, samples + i, len, out + outLen, MAX_DEMOD_BUF_LEN - outLen);
+			i += len;
+		}
+		outLen += lfstream_finish(&st, out + outLen, MAX_DEMOD_BUF_LEN - outLen);
+
+		// a capped reference only has the first bits
+		bool sameLen = (capped) ? (outLen >= (size_t)refLen) : (outLen == (size_t)refLen);
+		if (sameLen && !memcmp(out, ref, refLen)) continue;
+
+		if (failed == 0) {
+			size_t d = 0;
+			while (d < outLen && d < (size_t)refLen && out[d] == ref[d]) d++;
+			PrintAndLogEx(WARNING, "  %-15s iteration %u: %u bits, reference %d, first difference at bit %u", name, n, (uint32_t)outLen, refLen, (uint32_t)d);
+		}
+		failed++;
+	}
+
+	PrintAndLogEx(NORMAL, "  %-15s clock %3u  reference %5d bits%s  stream %5u bits  %s",
+		name, trained.clk, refLen, (capped) ? " (capped)" : "", (uint32_t)outLen, (failed) ? _RED_(fail) : _GREEN_(ok));
+	return (failed) ? 1 : 0;
+}
+
+// streaming demod of GraphBuffer,  samples are pushed in chunks like they come from the device.
+// 't' checks the stream against the whole capture demods,  for any chunking.
+int CmdStreamDemod(const char *Cmd) {
+	bool errors = false;
+	bool test = false;
+	int clk = 0, invert = 0;
+	uint32_t chunk = 512, iterations = 50;
+	uint8_t mod = 0xFF;
+	char modstr[3] = {0};
+	char cmdp = 0;
+
+	if (param_getstr(Cmd, cmdp, modstr, sizeof(modstr)) == 2) {
+		if (!strcmp(modstr, "ar")) mod = LFS_ASK_RAW;
+		else if (!strcmp(modstr, "am")) mod = LFS_ASK_MAN;
+		else if (!strcmp(modstr, "nr")) mod = LFS_NRZ;
+		else if (!strcmp(modstr, "fs")) mod = LFS_FSK;
+		else if (!strcmp(modstr, "p1")) mod = LFS_PSK1;
+	}
+	if (mod != 0xFF) cmdp++;
+
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+		case 'h':
+			return usage_data_streamdemod();
+		case 'c':
+			clk = param_get32ex(Cmd, cmdp+1, 0, 10);
+			cmdp += 2;
+			break;
+		case 'i':
+			invert = 1;
+			cmdp++;
+			break;
+		case 's':
+			chunk = param_get32ex(Cmd, cmdp+1, 512, 10);
+			if (chunk == 0) chunk = 512;
+			cmdp += 2;
+			break;
+		case 't':
+			test = true;
+			iterations = param_get32ex(Cmd, cmdp+1, 50, 10);
+			cmdp += (param_getchar(Cmd, cmdp+1) != 0x00 && isdigit(param_getchar(Cmd, cmdp+1))) ? 2 : 1;
+			break;
+		default:
+			PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
+			errors = true;
+			break;
+		}
+	}
+	if (errors || (mod == 0xFF && !test)) return usage_data_streamdemod();
+	if (!HasGraphData()) return 0;
+
+	uint8_t *samples = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+	uint8_t *ref = calloc(MAX_GRAPH_TRACE_LEN, sizeof(uint8_t));
+	uint8_t *out = calloc(MAX_DEMOD_BUF_LEN, sizeof(uint8_t));
+	if (!samples || !ref || !out) {
+		PrintAndLogEx(WARNING, "Failed to allocate memory");
+		free(samples); free(ref); free(out);
+		return 1;
+	}
+
+	size_t size = getFromGraphBuf(samples);
+
+	if (test) {
+		int failed = 0;
+		srand(msclock());
+		PrintAndLogEx(NORMAL, "Stream demod against the whole capture demods, %u samples, %u iterations", (uint32_t)size, iterations);
+		for (uint8_t m = LFS_ASK_RAW; m <= LFS_PSK1; m++) {
+			if (mod != 0xFF && m != mod) continue;
+			failed += StreamDemodCheck(m, samples, size, clk, invert, iterations, ref, out);
+		}
+		if (failed)
+			PrintAndLogEx(ERR, "Stream demod test [ERROR]  %d modulation(s) differ", failed);
+		else
+			PrintAndLogEx(SUCCESS, "Stream demod test [OK]");
+		free(samples); free(ref); free(out);
+		return (failed) ? 1 : 0;
+	}
+
+	lfstream_t st;
+	lfstream_init(&st, mod, clk, invert, 0, 0);
+	if (!lfstream_train(&st, samples, MIN(size, 4096))) {
+		PrintAndLogEx(WARNING, "Could not learn clock / thresholds from first samples");
+		free(samples); free(ref); free(out);
+		return 1;
+	}
+
+	size_t outLen = 0;
+	uint64_t t1 = msclock();
+	for (size_t i = 0; i < size; i += chunk)
+		outLen += lfstream_push(&st, samples + i, MIN(chunk, size - i), out + outLen, MAX_DEMOD_BUF_LEN - outLen);
+	outLen += lfstream_finish(&st, out + outLen, MAX_DEMOD_BUF_LEN - outLen);
+	t1 = msclock() - t1;
+
+	PrintAndLogEx(NORMAL, "Stream demod: clock %u, fc %u/%u, high %d, low %d", st.clk, st.fchigh, st.fclow, st.high, st.low);
+	PrintAndLogEx(NORMAL, "  %u samples in chunks of %u -> %u bits, %u errors (%" PRIu64 " ms)", (uint32_t)size, chunk, (uint32_t)outLen, st.errors, t1);
+
+	setDemodBuf(out, outLen, 0);
+	setClockGrid(st.clk, 0);
+	printDemodBuff();
+
+	free(samples);
+	free(ref);
+	free(out);
+	return 0;
+}
+
 int CmdDataIIR(const char *Cmd){
 	uint8_t k = param_get8(Cmd,0);
 	//iceIIR_Butterworth(GraphBuffer, GraphTraceLen);
-	iceSimple_Filter(GraphBuffer, GraphTraceLen, k);
+	lffilter_op_t op = { LFF_LOWPASS, k, 0 };
+	lffilter_run(GraphBuffer, GraphTraceLen, &op, 1);
+	RepaintGraphWindow();
+	return 0;
+}
+
+int CmdDataFilter(const char *Cmd) {
+	lffilter_op_t ops[LFF_MAX_CHAIN];
+	size_t nops = 0;
+	char name[5];
+	int cmdp = 0;
+
+	while (param_getchar(Cmd, cmdp) != 0x00) {
+		if (nops >= LFF_MAX_CHAIN) {
+			PrintAndLogEx(WARNING, "Too many filters, max %d", LFF_MAX_CHAIN);
+			return 1;
+		}
+		memset(name, 0, sizeof(name));
+		param_getstr(Cmd, cmdp, name, sizeof(name));
+		lffilter_op_t *op = &ops[nops];
+		memset(op, 0, sizeof(lffilter_op_t));
+
+		if (!strcmp(name, "h")) {
+			return usage_data_filter();
+		} else if (!strcmp(name, "t")) {
+			return lffilter_selftest(MAX_GRAPH_TRACE_LEN, true);
+		} else if (!strcmp(name, "hpf")) {
+			op->type = LFF_HPF;
+			cmdp++;
+		} else if (!strcmp(name, "norm")) {
+			op->type = LFF_NORM;
+			cmdp++;
+		} else if (!strcmp(name, "dt")) {
+			op->type = LFF_DIRTHRESHOLD;
+			op->a = (int8_t)param_get8(Cmd, cmdp+1);
+			op->b = (int8_t)param_get8(Cmd, cmdp+2);
+			cmdp += 3;
+		} else if (!strcmp(name, "ed")) {
+			op->type = LFF_EDGE;
+			op->a = param_get32ex(Cmd, cmdp+1, 25, 10);
+			cmdp += 2;
+		} else if (!strcmp(name, "lp")) {
+			op->type = LFF_LOWPASS;
+			op->a = param_get8(Cmd, cmdp+1);
+			cmdp += 2;
+		} else {
+			PrintAndLogEx(WARNING, "Unknown filter '%s'", name);
+			return usage_data_filter();
+		}
+		nops++;
+	}
+	if (nops == 0) return usage_data_filter();
+	if (!HasGraphData()) return 0;
+
+	uint64_t t1 = msclock();
+	lffilter_run(GraphBuffer, GraphTraceLen, ops, nops);
+	PrintAndLogEx(DEBUG, "filtered %d samples in %" PRIu64 " ms (%s)", GraphTraceLen, msclock() - t1, lffilter_kernel_name());
 	RepaintGraphWindow();
 	return 0;
 }
@@ -2025,8 +2458,10 @@ static command_t CommandTable[] =
 	{"bin2hex",         Cmdbin2hex,         1, "<digits> -- Converts binary to hexadecimal"},
 	{"bitsamples",      CmdBitsamples,      0, "Get raw samples as bitstring"},
 	{"buffclear",       CmdBuffClear,       1, "Clears bigbuff on deviceside and graph window"},
+	{"compress",        CmdDataCompress,    1, "[f <file>] [b <bps>] -- Test the LF sample compression of 'lf config c 1', ratio and cost on .pm3 traces"},
 	{"dec",             CmdDec,             1, "Decimate samples"},
 	{"detectclock",     CmdDetectClockRate, 1, "[<a|f|n|p>] Detect ASK, FSK, NRZ, PSK clock rate of wave in GraphBuffer"},
+	{"filter",          CmdDataFilter,      1, "<hpf|norm|dt|ed|lp> ... -- Apply a chain of filters to GraphBuffer in one go, 't' for self test/benchmark"},
 	{"fsktonrz",        CmdFSKToNRZ,        1, "Convert fsk2 to nrz wave for alternate fsk demodulating (for weak fsk)"},
 
 	{"getbitstream",    CmdGetBitStream,    1, "Convert GraphBuffer's >=1 values to 1 and <1 to 0"},
@@ -2041,7 +2476,8 @@ static command_t CommandTable[] =
 	{"mtrim",           CmdMtrim,           1, "<start> <stop> -- Trim out samples from the specified start to the specified stop"},
 	{"manrawdecode",    Cmdmandecoderaw,    1, "[invert] [maxErr] -- Manchester decode binary stream in DemodBuffer"},
 	{"norm",            CmdNorm,            1, "Normalize max/min to +/-128"},
-	{"plot",            CmdPlot,            1, "Show graph window (hit 'h' in window for keystroke help)"},
+	{"plot",            CmdPlot,            1, "[b] -- Show graph window (hit 'h' in window for keystroke help), 'b' benchmarks plot rendering"},
+	{"pack",            CmdDataPack,        1, "[b [<rounds>]] -- Test the word wide LF sample packing of DoAcquisition against pushBit, 'b' benchmarks"},
 	{"printdemodbuffer",CmdPrintDemodBuff,  1, "[x] [o] <offset> [l] <length> -- print the data in the DemodBuffer - 'x' for hex output"},
 	{"rawdemod",        CmdRawDemod,        1, "[modulation] ... <options> -see help (h option) -- Demodulate the data in the GraphBuffer and output binary"},  
 	{"samples",         CmdSamples,         0, "[512 - 40000] -- Get raw samples for graph window (GraphBuffer)"},
@@ -2049,6 +2485,7 @@ static command_t CommandTable[] =
 	{"setgraphmarkers", CmdSetGraphMarkers, 1, "[orange_marker] [blue_marker] (in graph window)"},
 	{"scale",           CmdScale,           1, "<int> -- Set cursor display scale"},
 	{"setdebugmode",    CmdSetDebugMode,    1, "<0|1|2> -- Turn on or off Debugging Level for lf demods"},
+	{"streamdemod",     CmdStreamDemod,     1, "<ar|am|nr|fs|p1> [c <clock>] [t] -- Demodulate GraphBuffer incrementally with the streaming demod"},
 	{"shiftgraphzero",  CmdGraphShiftZero,  1, "<shift> -- Shift 0 for Graphed wave + or - shift value"},
 	{"dirthreshold",    CmdDirectionalThreshold,   1, "<thres up> <thres down> -- Max rising higher up-thres/ Min falling lower down-thres, keep rest as prev."},
 	{"tune",            CmdTuneSamples,     0, "Get hw tune samples for graph window"},
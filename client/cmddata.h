@@ -27,10 +27,16 @@
 #include "graph.h"    // for graph data
 #include "usb_cmd.h"  // already included in cmdmain.h and proxmark3.h
 #include "lfdemod.h"  // for demod code
+#include "lffilter.h" // for sample filters
+#include "graphlod.h" // for plot benchmark
+#include "lfcompress.h" // for compressed samples in getsamples
+#include "lfcompresstest.h" // for compression test and benchmark
+#include "lfpacktest.h" // for sample packing test and benchmark
 #include "crc.h"      // for pyramid checksum maxim
 #include "crc16.h"    // for FDXB demod checksum
 #include "loclass/cipherutils.h" // for decimating samples in getsamples
 #include "cmdlfem4x.h" // askem410xdecode
+#include "util_posix.h" // msclock
 
 command_t * CmdDataCommands();
 
@@ -67,11 +73,14 @@ int Cmdmandecoderaw(const char *Cmd);
 int CmdNorm(const char *Cmd);
 int CmdNRZrawDemod(const char *Cmd);
 int CmdPlot(const char *Cmd);
+int CmdDataCompress(const char *Cmd);
+int CmdDataPack(const char *Cmd);
 int CmdPrintDemodBuff(const char *Cmd);
 int CmdRawDemod(const char *Cmd);
 int CmdSamples(const char *Cmd);
 int CmdTuneSamples(const char *Cmd);
 int CmdSave(const char *Cmd);
+int CmdStreamDemod(const char *Cmd);
 int CmdScale(const char *Cmd);
 int CmdDirectionalThreshold(const char *Cmd);
 int CmdZerocrossings(const char *Cmd);
@@ -87,6 +96,7 @@ int directionalThreshold(const int* in, int *out, size_t len, int8_t up, int8_t
 extern int AskEdgeDetect(const int *in, int *out, int len, int threshold);
 
 int CmdDataIIR(const char *Cmd);
+int CmdDataFilter(const char *Cmd);
 
 #define MAX_DEMOD_BUF_LEN (1024*128)
 #define BIGBUF_SIZE 40000
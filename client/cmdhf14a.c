@@ -135,11 +135,34 @@ int usage_hf_14a_sim(void) {
 int usage_hf_14a_sniff(void) {
 	PrintAndLogEx(NORMAL, "It get data from the field and saves it into command buffer.");
 	PrintAndLogEx(NORMAL, "Buffer accessible from command 'hf list 14a'");
-	PrintAndLogEx(NORMAL, "Usage:  hf 14a sniff [c][r]");
+	PrintAndLogEx(NORMAL, "Usage:  hf 14a sniff [c][r][p][s <filename>]");
 	PrintAndLogEx(NORMAL, "c - triggered by first data from card");
 	PrintAndLogEx(NORMAL, "r - triggered by first 7-bit request from reader (REQ,WUP,...)");
+	PrintAndLogEx(NORMAL, "p - compact trace records,  about a third more frames fit in BigBuf.  Saves space at");
+	PrintAndLogEx(NORMAL, "    a speed cost,  a record takes about twice as long to write,  see 'trace compact'.");
+	PrintAndLogEx(NORMAL, "    Not with s");
+	PrintAndLogEx(NORMAL, "s - stream the trace to a raw trace file while sniffing,  no BigBuf limit.");
+	PrintAndLogEx(NORMAL, "    Records are appended,  the dropped ones counted.  'trace load' lists it");
 	PrintAndLogEx(NORMAL, "Examples:");
 	PrintAndLogEx(NORMAL, "        hf 14a sniff c r");
+	PrintAndLogEx(NORMAL, "        hf 14a sniff r p");
+	PrintAndLogEx(NORMAL, "        hf 14a sniff r s mysniff.trace");
+	return 0;
+}
+int usage_hf_14a_decode(void) {
+	PrintAndLogEx(NORMAL, "Runs the Miller and Manchester decoders of the firmware on sniff samples,  as 'hf 14a sniff' gets them from the FPGA.");
+	PrintAndLogEx(NORMAL, "A sample file has one byte per 4 ticks,  the reader field in the high nibble,  the tag modulation in the low one.");
+	PrintAndLogEx(NORMAL, "Usage:  hf 14a decode [h] [v] [f <samples>] [o <trace>] [w <dir>] [b [<rounds>]]");
+	PrintAndLogEx(NORMAL, "  f <samples>  : decode a sample file and list the frames");
+	PrintAndLogEx(NORMAL, "  o <trace>    : save the decoded frames as a raw trace,  for 'trace load'");
+	PrintAndLogEx(NORMAL, "  w <dir>      : write the sample files of the tests,  name.raw and the frames as name.trace");
+	PrintAndLogEx(NORMAL, "  b [<rounds>] : cycles and throughput of the decoders,  on the file or the built-in session.  Default 20000 rounds");
+	PrintAndLogEx(NORMAL, "  v            : verbose");
+	PrintAndLogEx(NORMAL, "Without f,  w or b the decoder tests run,  the synthetic sessions and the sample files in traces/iso14443a");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "        hf 14a decode");
+	PrintAndLogEx(NORMAL, "        hf 14a decode f ../traces/iso14443a/mifare_classic.raw o mfc.trace");
+	PrintAndLogEx(NORMAL, "        hf 14a decode b 1000");
 	return 0;
 }
 int usage_hf_14a_raw(void) {
@@ -656,15 +679,137 @@ int CmdHF14ASim(const char *Cmd) {
 int CmdHF14ASniff(const char *Cmd) {
 	int param = 0;	
 	uint8_t ctmp;
-	for (int i = 0; i < 2; i++) {
+	char filename[FILE_PATH_SIZE] = {0};
+	for (int i = 0; param_getchar(Cmd, i) != 0x00; i++) {
 		ctmp = param_getchar(Cmd, i);
 		if (ctmp == 'h' || ctmp == 'H') return usage_hf_14a_sniff();
 		if (ctmp == 'c' || ctmp == 'C') param |= 0x01;
 		if (ctmp == 'r' || ctmp == 'R') param |= 0x02;
+		if (ctmp == 'p' || ctmp == 'P') param |= 0x08;
+		if (ctmp == 's' || ctmp == 'S') {
+			if (param_getstr(Cmd, ++i, filename, sizeof(filename)) == 0) return usage_hf_14a_sniff();
+			param |= 0x04;
+		}
 	}
 	UsbCommand c = {CMD_SNOOP_ISO_14443a, {param, 0, 0}};
 	clearCommandBuffer();
 	SendCommand(&c);
+	if (param & 0x04)
+		return CmdTraceStreamReceive(filename);
+	return 0;
+}
+
+int CmdHF14ADecode(const char *Cmd) {
+	char filename[FILE_PATH_SIZE] = {0};
+	char tracename[FILE_PATH_SIZE] = {0};
+	char dirname[FILE_PATH_SIZE] = {0};
+	uint32_t rounds = 0;
+	bool verbose = false;
+	bool errors = false;
+
+	uint8_t cmdp = 0;
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+			case 'h':
+				return usage_hf_14a_decode();
+			case 'f':
+				errors = param_getstr(Cmd, cmdp+1, filename, sizeof(filename)) == 0;
+				cmdp += 2;
+				break;
+			case 'o':
+				errors = param_getstr(Cmd, cmdp+1, tracename, sizeof(tracename)) == 0;
+				cmdp += 2;
+				break;
+			case 'w':
+				errors = param_getstr(Cmd, cmdp+1, dirname, sizeof(dirname)) == 0;
+				cmdp += 2;
+				break;
+			case 'b':
+				rounds = 20000;
+				cmdp++;
+				if (isdigit((unsigned char)param_getchar(Cmd, cmdp))) {
+					rounds = param_get32ex(Cmd, cmdp, 0, 10);
+					errors = (rounds == 0);
+					cmdp++;
+				}
+				break;
+			case 'v':
+				verbose = true;
+				cmdp++;
+				break;
+			default:
+				PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
+				errors = true;
+				break;
+		}
+	}
+	if (errors) return usage_hf_14a_decode();
+
+	if (dirname[0]) {
+		size_t len = strlen(dirname);
+		if (dirname[len - 1] != '/' && dirname[len - 1] != '\\' && len + 1 < sizeof(dirname))
+			strcat(dirname, "/");
+		return hf14a_replay_write(dirname);
+	}
+
+	if (!filename[0] && !rounds) {
+		char dir[FILE_PATH_SIZE];
+		snprintf(dir, sizeof(dir), "%s../traces/iso14443a/", get_my_executable_directory());
+		return hf14a_replay_test(dir, verbose);
+	}
+
+	uint8_t *samples = NULL;
+	size_t len = 0;
+	if (filename[0]) {
+		FILE *f = fopen(filename, "rb");
+		if (f == NULL) {
+			PrintAndLogEx(FAILED, "Could not open file %s", filename);
+			return 1;
+		}
+		fseek(f, 0, SEEK_END);
+		long fsize = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		samples = (fsize > 0) ? malloc(fsize) : NULL;
+		if (samples)
+			len = fread(samples, 1, fsize, f);
+		fclose(f);
+		if (len == 0) {
+			PrintAndLogEx(FAILED, "error, %s is empty or can't be read", filename);
+			free(samples);
+			return 1;
+		}
+	} else {
+		len = hf14a_replay_session(&samples, 0, 2, 0, 0);
+		if (len == 0) {
+			PrintAndLogEx(FAILED, "Cannot allocate memory for the samples");
+			return 2;
+		}
+	}
+
+	if (filename[0]) {
+		hf14a_replay_t r;
+		if (hf14a_replay(samples, len, false, &r)) {
+			PrintAndLogEx(FAILED, "Cannot allocate memory for the trace");
+			free(samples);
+			return 2;
+		}
+		PrintAndLogEx(SUCCESS, "%u samples,  %u reader and %u tag frames,  %u with a collision", (uint32_t)len, r.reader, r.tag, r.collisions);
+		if (tracename[0]) {
+			saveFile(tracename, "trace", r.trace, r.traceLen);
+		} else if (r.traceLen) {
+			tracelist_t tl = {0};
+			tl.protocol = ISO_14443A;
+			tl.threads = 1;
+			tracelist_begin(&tl);
+			tracelist_run(&tl, 0, r.trace, r.traceLen, 0, r.traceLen, NULL, 0, 0);
+			tracelist_end(&tl);
+		}
+		hf14a_replay_free(&r);
+	}
+
+	if (rounds)
+		hf14a_replay_bench(samples, len, rounds);
+	free(samples);
 	return 0;
 }
 
@@ -745,6 +890,46 @@ int ExchangeAPDU14a(uint8_t *datain, int datainlen, bool activateField, bool lea
 	return 0;
 }
 
+// SELECT every AID of list on the card with one command,  see aidprobe.h.
+// Returns how many AIDs were probed,  -1 on a proxmark or card select error
+int ExchangeAIDProbe14a(uint8_t *list, int listlen, int aidcnt, bool activateField, uint8_t *hits, int *hitslen, int *status) {
+	uint16_t cmdc = ISO14A_AID_PROBE | ISO14A_NO_DISCONNECT;
+
+	*hitslen = 0;
+	*status = AIDPROBE_OK;
+
+	if (activateField)
+		cmdc |= ISO14A_CONNECT;
+
+	UsbCommand c = {CMD_READER_ISO_14443a, {cmdc, (listlen & 0xFFFF), 0}};
+	memcpy(c.d.asBytes, list, listlen);
+	SendCommand(&c);
+
+	UsbCommand resp;
+
+	if (activateField) {
+		if (!WaitForResponseTimeout(CMD_ACK, &resp, 1500)) {
+			PrintAndLogEx(NORMAL, "APDU ERROR: Proxmark connection timeout.");
+			return -1;
+		}
+		if (resp.arg[0] != 1) {
+			PrintAndLogEx(NORMAL, "APDU ERROR: Proxmark error %d.", resp.arg[0]);
+			return -1;
+		}
+	}
+
+	// the card gets its frame waiting time for every SELECT
+	if (!WaitForResponseTimeout(CMD_ACK, &resp, 1500 + 100 * aidcnt)) {
+		PrintAndLogEx(NORMAL, "APDU ERROR: Reply timeout.");
+		return -1;
+	}
+
+	*status = resp.arg[1];
+	*hitslen = MIN(resp.arg[2], USB_CMD_DATA_SIZE);
+	memcpy(hits, resp.d.asBytes, *hitslen);
+	return resp.arg[0];
+}
+
 int CmdHF14AAPDU(const char *cmd) {
 	uint8_t data[USB_CMD_DATA_SIZE];
 	int datalen = 0;
@@ -1020,6 +1205,7 @@ static command_t CommandTable[] = {
 	{"cuids",		CmdHF14ACUIDs,        0, "<n> Collect n>0 ISO14443-a UIDs in one go"},
 	{"sim",		CmdHF14ASim,          0, "<UID> -- Simulate ISO 14443-a tag"},
 	{"sniff",		CmdHF14ASniff,        0, "sniff ISO 14443-a traffic"},
+	{"decode",	CmdHF14ADecode,       1, "Decode sniff samples with the firmware decoders,  tests and bench"},
 	{"apdu",		CmdHF14AAPDU,         0, "Send ISO 14443-4 APDU to tag"},
 	{"raw",		CmdHF14ACmdRaw,       0, "Send raw hex data to tag"},
 	{"antifuzz",	CmdHF14AAntiFuzz,     0, "Fuzzing the anticollision phase.  Warning! Readers may react strange"},
@@ -26,12 +26,15 @@
 #include "cmdmain.h"
 #include "iso14443crc.h"
 #include "mifare.h"
+#include "aidprobe.h"
 #include "cmdhfmf.h"
 #include "cmdhfmfu.h"
 #include "cmdhf.h"		// list cmd
+#include "cmdtrace.h"	// sniff streaming
 #include "mifarehost.h"
 #include "emv/apduinfo.h"
 #include "emv/emvcore.h"						  
+#include "hf14areplay.h"	// decoder replay
 
 // structure and database for uid -> tagtype lookups 
 typedef struct { 
@@ -45,15 +48,18 @@ extern int CmdHF14AReader(const char *Cmd);
 extern int CmdHF14AInfo(const char *Cmd);
 extern int CmdHF14ASim(const char *Cmd);
 extern int CmdHF14ASniff(const char *Cmd);
+extern int CmdHF14ADecode(const char *Cmd);
 extern int CmdHF14ACmdRaw(const char *Cmd);
 extern int CmdHF14ACUIDs(const char *Cmd);
 extern int CmdHF14AAntiFuzz(const char *cmd);
 
 extern char* getTagInfo(uint8_t uid);
 extern int ExchangeAPDU14a(uint8_t *datain, int datainlen, bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen);									
+extern int ExchangeAIDProbe14a(uint8_t *list, int listlen, int aidcnt, bool activateField, uint8_t *hits, int *hitslen, int *status);
 
 extern int usage_hf_14a_sim(void);
 extern int usage_hf_14a_sniff(void);
+extern int usage_hf_14a_decode(void);
 extern int usage_hf_14a_raw(void);
 extern int usage_hf_14a_antifuzz(void);
 #endif
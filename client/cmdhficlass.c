@@ -197,9 +197,28 @@ int usage_hf_iclass_replay(void) {
 }
 int usage_hf_iclass_sniff(void) {
 	PrintAndLogEx(NORMAL, "Sniff the communication between reader and tag");
-	PrintAndLogEx(NORMAL, "Usage:  hf iclass sniff [h]");
+	PrintAndLogEx(NORMAL, "Usage:  hf iclass sniff [h] [s <filename>]");
+	PrintAndLogEx(NORMAL, "  s <filename>  stream the trace to a raw trace file while sniffing,  no BigBuf limit");
 	PrintAndLogEx(NORMAL, "Examples:");
 	PrintAndLogEx(NORMAL, "		 hf iclass sniff");	
+	PrintAndLogEx(NORMAL, "		 hf iclass sniff s mysniff.trace");
+	return 0;
+}
+int usage_hf_iclass_decode(void) {
+	PrintAndLogEx(NORMAL, "Runs the 1 out of 4 and Manchester decoders of the firmware on sniff samples,  as 'hf iclass sniff' gets them from the FPGA.");
+	PrintAndLogEx(NORMAL, "A sample file has one byte per 4 ticks,  the reader field in the high nibble,  the tag modulation in the low one.");
+	PrintAndLogEx(NORMAL, "Usage:  hf iclass decode [h] [v] [r] [f <samples>] [o <trace>] [w <dir>] [b [<rounds>]]");
+	PrintAndLogEx(NORMAL, "  f <samples>  : decode a sample file and list the frames");
+	PrintAndLogEx(NORMAL, "  r            : with f,  the reference decoders,  bit by bit as before the lookup tables");
+	PrintAndLogEx(NORMAL, "  o <trace>    : save the decoded frames as a raw trace,  for 'trace load'");
+	PrintAndLogEx(NORMAL, "  w <dir>      : write the sample files of the tests,  name.raw and the frames as name.trace");
+	PrintAndLogEx(NORMAL, "  b [<rounds>] : throughput of the decoders and the reference,  on the file or the built-in session.  Default 5000 rounds");
+	PrintAndLogEx(NORMAL, "  v            : verbose");
+	PrintAndLogEx(NORMAL, "Without f,  w or b the decoder tests run,  the synthetic sessions,  random samples against the reference and the sample files in traces/iclass");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "        hf iclass decode");
+	PrintAndLogEx(NORMAL, "        hf iclass decode f ../traces/iclass/iclass_read.raw o read.trace");
+	PrintAndLogEx(NORMAL, "        hf iclass decode b 1000");
 	return 0;
 }
 int usage_hf_iclass_loclass(void) {
@@ -207,6 +226,7 @@ int usage_hf_iclass_loclass(void) {
 	PrintAndLogEx(NORMAL, "Options:");
 	PrintAndLogEx(NORMAL, "h             Show this help");
 	PrintAndLogEx(NORMAL, "t             Perform self-test");
+	PrintAndLogEx(NORMAL, "b             Benchmark the optimized MAC (as the simulation uses it) against the reference");
 	PrintAndLogEx(NORMAL, "f <filename>  Bruteforce iclass dumpfile");
 	PrintAndLogEx(NORMAL, "                   An iclass dumpfile is assumed to consist of an arbitrary number of");
 	PrintAndLogEx(NORMAL, "                   malicious CSNs, and their protocol responses");
@@ -279,8 +299,135 @@ int CmdHFiClassList(const char *Cmd) {
 int CmdHFiClassSniff(const char *Cmd) {
 	char cmdp = param_getchar(Cmd, 0);
 	if (cmdp == 'h' || cmdp == 'H')	return usage_hf_iclass_sniff();
-	UsbCommand c = {CMD_SNOOP_ICLASS};
+
+	char filename[FILE_PATH_SIZE] = {0};
+	bool stream = (cmdp == 's' || cmdp == 'S');
+	if (stream && param_getstr(Cmd, 1, filename, sizeof(filename)) == 0) return usage_hf_iclass_sniff();
+
+	UsbCommand c = {CMD_SNOOP_ICLASS, {stream, 0, 0}};
+	clearCommandBuffer();
 	SendCommand(&c);
+	if (stream)
+		return CmdTraceStreamReceive(filename);
+	return 0;
+}
+
+int CmdHFiClassDecode(const char *Cmd) {
+	char filename[FILE_PATH_SIZE] = {0};
+	char tracename[FILE_PATH_SIZE] = {0};
+	char dirname[FILE_PATH_SIZE] = {0};
+	uint32_t rounds = 0;
+	bool verbose = false;
+	bool reference = false;
+	bool errors = false;
+
+	uint8_t cmdp = 0;
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+			case 'h':
+				return usage_hf_iclass_decode();
+			case 'f':
+				errors = param_getstr(Cmd, cmdp+1, filename, sizeof(filename)) == 0;
+				cmdp += 2;
+				break;
+			case 'o':
+				errors = param_getstr(Cmd, cmdp+1, tracename, sizeof(tracename)) == 0;
+				cmdp += 2;
+				break;
+			case 'w':
+				errors = param_getstr(Cmd, cmdp+1, dirname, sizeof(dirname)) == 0;
+				cmdp += 2;
+				break;
+			case 'b':
+				rounds = 5000;
+				cmdp++;
+				if (isdigit((unsigned char)param_getchar(Cmd, cmdp))) {
+					rounds = param_get32ex(Cmd, cmdp, 0, 10);
+					errors = (rounds == 0);
+					cmdp++;
+				}
+				break;
+			case 'r':
+				reference = true;
+				cmdp++;
+				break;
+			case 'v':
+				verbose = true;
+				cmdp++;
+				break;
+			default:
+				PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
+				errors = true;
+				break;
+		}
+	}
+	if (errors) return usage_hf_iclass_decode();
+
+	if (dirname[0]) {
+		size_t len = strlen(dirname);
+		if (dirname[len - 1] != '/' && dirname[len - 1] != '\\' && len + 1 < sizeof(dirname))
+			strcat(dirname, "/");
+		return hficlass_replay_write(dirname);
+	}
+
+	if (!filename[0] && !rounds) {
+		char dir[FILE_PATH_SIZE];
+		snprintf(dir, sizeof(dir), "%s../traces/iclass/", get_my_executable_directory());
+		return hficlass_replay_test(dir, verbose);
+	}
+
+	uint8_t *samples = NULL;
+	size_t len = 0;
+	if (filename[0]) {
+		FILE *f = fopen(filename, "rb");
+		if (f == NULL) {
+			PrintAndLogEx(FAILED, "Could not open file %s", filename);
+			return 1;
+		}
+		fseek(f, 0, SEEK_END);
+		long fsize = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		samples = (fsize > 0) ? malloc(fsize) : NULL;
+		if (samples)
+			len = fread(samples, 1, fsize, f);
+		fclose(f);
+		if (len == 0) {
+			PrintAndLogEx(FAILED, "error, %s is empty or can't be read", filename);
+			free(samples);
+			return 1;
+		}
+	} else {
+		len = hficlass_replay_session(&samples, 0, 6, 0, 0);
+		if (len == 0) {
+			PrintAndLogEx(FAILED, "Cannot allocate memory for the samples");
+			return 2;
+		}
+	}
+
+	if (filename[0]) {
+		hficlass_replay_t r;
+		if (hficlass_replay(samples, len, reference, &r)) {
+			PrintAndLogEx(FAILED, "Cannot allocate memory for the trace");
+			free(samples);
+			return 2;
+		}
+		PrintAndLogEx(SUCCESS, "%u samples,  %u reader and %u tag frames,  %u decoder errors", (uint32_t)len, r.reader, r.tag, r.errors);
+		if (tracename[0]) {
+			saveFile(tracename, "trace", r.trace, r.traceLen);
+		} else if (r.traceLen) {
+			tracelist_t tl = {0};
+			tl.protocol = ICLASS;
+			tl.threads = 1;
+			tracelist_begin(&tl);
+			tracelist_run(&tl, 0, r.trace, r.traceLen, 0, r.traceLen, NULL, 0, 0);
+			tracelist_end(&tl);
+		}
+		hficlass_replay_free(&r);
+	}
+
+	if (rounds)
+		hficlass_replay_bench(samples, len, rounds);
+	free(samples);
 	return 0;
 }
 
@@ -1540,6 +1687,128 @@ int CmdHFiClass_ReadBlock(const char *Cmd) {
 	return ReadBlock(KEY, blockno, keyType, elite, rawkey, verbose, auth);
 }
 
+// optimized_cipher.c against the reference MAC in loclass/cipher.c
+static int iclass_opt_selftest(void) {
+	int errors = 0;
+	uint8_t mac[4], ref[4];
+	opt_key_t kt;
+
+	// from the "dismantling iClass" paper,  as testMAC()
+	uint8_t cc_nr[16] = {0xFE,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0,0,0,0};
+	uint8_t div_key[8] = {0xE0,0x33,0xCA,0x41,0x9A,0xEE,0x43,0xF9};
+	uint8_t correct_MAC[4] = {0x1d,0x49,0xC9,0xDA};
+	opt_doReaderMAC(cc_nr, div_key, mac);
+	errors += memcmp(mac, correct_MAC, 4) != 0;
+
+	srand(msclock());
+	for (int i = 0; i < 2000 && !errors; i++) {
+		for (int j = 0; j < 8; j++) div_key[j] = rand();
+		for (int j = 0; j < 12; j++) cc_nr[j] = rand();
+
+		// reader MAC
+		doMAC(cc_nr, div_key, ref);
+		opt_doReaderMAC(cc_nr, div_key, mac);
+		errors += memcmp(mac, ref, 4) != 0;
+
+		// tag MAC,  the reference gets the 32 zeroes as data
+		memset(cc_nr + 12, 0, 4);
+		doMAC_N(cc_nr, 16, div_key, ref);
+		opt_doTagMAC(cc_nr, div_key, mac);
+		errors += memcmp(mac, ref, 4) != 0;
+
+		State s = opt_doTagMAC_1(cc_nr, div_key);
+		opt_doTagMAC_2(s, cc_nr + 8, mac, div_key);
+		errors += memcmp(mac, ref, 4) != 0;
+
+		opt_init_key(&kt, div_key);
+		s = opt_doTagMAC_1_key(cc_nr, &kt);
+		opt_doTagMAC_2_key(s, cc_nr + 8, mac, &kt);
+		errors += memcmp(mac, ref, 4) != 0;
+	}
+
+	if (errors)
+		PrintAndLogDevice(FAILED, "Optimized MAC differs from the reference MAC");
+	else
+		PrintAndLogDevice(SUCCESS, "Optimized MAC calculation OK! (paper vector + 2000 random keys)");
+	return errors;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define ICLASS_TICKS()	__rdtsc()
+#else
+#define ICLASS_TICKS()	0
+#endif
+
+#define ICLASS_BENCH_MACS	100000
+
+static void iclass_bench_line(const char *name, int n, uint64_t ms, uint64_t ticks, int steps) {
+	PrintAndLogEx(NORMAL, "%-20s | %7d | %6" PRIu64 " | %8.3f | %9.0f | %6.1f",
+		name, n, ms, n ? ms * 1000.0 / n : 0, n ? (double)ticks / n : 0, n ? (double)ticks / n / steps : 0);
+}
+
+// the tag MAC in the simulation feeds 4 bytes NR,  32 zeroes and clocks 32 bits out
+static int iclass_opt_bench(void) {
+	uint8_t div_key[8], cc_nr[16] = {0}, mac[4];
+	opt_key_t kt;
+	uint64_t ms, ticks;
+	volatile uint8_t sink = 0;
+
+	int errors = iclass_opt_selftest();
+
+	for (int j = 0; j < 8; j++) div_key[j] = rand();
+	for (int j = 0; j < 8; j++) cc_nr[j] = rand();
+
+	PrintAndLogEx(NORMAL, "\nMAC                  |    MACs |     ms | us / MAC | ticks/MAC | /step");
+	PrintAndLogEx(NORMAL, "---------------------+---------+--------+----------+-----------+-------");
+
+	int n = ICLASS_BENCH_MACS / 10;
+	ms = msclock(); ticks = ICLASS_TICKS();
+	for (int i = 0; i < n; i++) {
+		cc_nr[8] = i;
+		doMAC(cc_nr, div_key, mac);
+		sink ^= mac[0];
+	}
+	ticks = ICLASS_TICKS() - ticks; ms = msclock() - ms;
+	iclass_bench_line("cipher.c doMAC", n, ms, ticks, 128);
+
+	n = ICLASS_BENCH_MACS;
+	ms = msclock(); ticks = ICLASS_TICKS();
+	for (int i = 0; i < n; i++) {
+		cc_nr[8] = i;
+		opt_doReaderMAC(cc_nr, div_key, mac);
+		sink ^= mac[0];
+	}
+	ticks = ICLASS_TICKS() - ticks; ms = msclock() - ms;
+	iclass_bench_line("opt_doReaderMAC", n, ms, ticks, 128);
+
+	State s = opt_doTagMAC_1(cc_nr, div_key);
+	ms = msclock(); ticks = ICLASS_TICKS();
+	for (int i = 0; i < n; i++) {
+		cc_nr[8] = i;
+		opt_doTagMAC_2(s, cc_nr + 8, mac, div_key);
+		sink ^= mac[0];
+	}
+	ticks = ICLASS_TICKS() - ticks; ms = msclock() - ms;
+	iclass_bench_line("opt_doTagMAC_2", n, ms, ticks, 96);
+
+	opt_init_key(&kt, div_key);
+	s = opt_doTagMAC_1_key(cc_nr, &kt);
+	ms = msclock(); ticks = ICLASS_TICKS();
+	for (int i = 0; i < n; i++) {
+		cc_nr[8] = i;
+		opt_doTagMAC_2_key(s, cc_nr + 8, mac, &kt);
+		sink ^= mac[0];
+	}
+	ticks = ICLASS_TICKS() - ticks; ms = msclock() - ms;
+	iclass_bench_line("opt_doTagMAC_2_key", n, ms, ticks, 96);
+
+	(void)sink;
+	if (ICLASS_TICKS() == 0)
+		PrintAndLogEx(NORMAL, "(no tick counter on this platform)");
+	return errors;
+}
+
 int CmdHFiClass_loclass(const char *Cmd) {
 	char opt = param_getchar(Cmd, 0);
 
@@ -1558,11 +1827,15 @@ int CmdHFiClass_loclass(const char *Cmd) {
 	else if (opt == 't') {
 		int errors = testCipherUtils();
 		errors += testMAC();
+		errors += iclass_opt_selftest();
 		errors += doKeyTests(0);
 		errors += testElite();
 		if (errors) PrintAndLogDevice(WARNING, "There were errors!!!");
 		return errors;
 	}
+	else if (opt == 'b') {
+		return iclass_opt_bench();
+	}
 	return 0;
 }
 
@@ -2341,42 +2614,96 @@ int LoadDictionaryKeyFile( char* filename, uint8_t **keys, int *keycnt) {
 	return 0;
 }
 
+// diversify a whole key list for one CSN,  the DES(CSN, key) of every key runs as one batch
+int HFiClassCalcDivKeys(uint8_t *CSN, uint8_t *keys, int keycnt, uint8_t *div_keys, bool elite) {
+	if (keycnt <= 0)
+		return 0;
+
+	uint8_t *des_keys = calloc(keycnt, 8);
+	uint8_t *csns = calloc(keycnt, 8);
+	uint8_t *crypted = calloc(keycnt, 8);
+	if (!des_keys || !csns || !crypted) {
+		free(des_keys);
+		free(csns);
+		free(crypted);
+		return 1;
+	}
+
+	uint8_t keytable[128] = {0};
+	uint8_t key_index[8] = {0};
+	uint8_t key_sel[8] = {0};
+	if (elite)
+		hash1(CSN, key_index);
+
+	for (int i = 0; i < keycnt; i++) {
+		if (elite) {
+			hash2(keys + 8 * i, keytable);
+			for (uint8_t j = 0; j < 8; j++)
+				key_sel[j] = keytable[key_index[j]] & 0xFF;
+			permutekey_rev(key_sel, des_keys + 8 * i);
+		} else {
+			memcpy(des_keys + 8 * i, keys + 8 * i, 8);
+		}
+		memcpy(csns + 8 * i, CSN, 8);
+	}
+
+	bc_des_batch(des_keys, BC_ENCRYPT, csns, crypted, keycnt);
+
+	for (int i = 0; i < keycnt; i++)
+		hash0(x_bytes_to_num(crypted + 8 * i, 8), div_keys + 8 * i);
+
+	free(des_keys);
+	free(csns);
+	free(crypted);
+	return 0;
+}
+
 // precalc diversified keys and their MAC
 int GenerateMacFromKeyFile( uint8_t* CSN, uint8_t* CCNR, bool use_raw, bool use_elite, uint8_t* keys, int keycnt, iclass_premac_t* list ) {
-	uint8_t key[8] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
-	uint8_t div_key[8] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+	if (keycnt <= 0)
+		return 0;
 
-	for ( int i=0; i < keycnt; i++) {
+	uint8_t *div_keys = calloc(keycnt, 8);
+	if (!div_keys)
+		return 1;
 
-		memcpy(key, keys + 8 * i , 8); 
-		
-		if (use_raw)
-			memcpy(div_key, key, 8);
-		else
-			HFiClassCalcDivKey(CSN, key, div_key, use_elite);
+	if (use_raw)
+		memcpy(div_keys, keys, 8 * keycnt);
+	else if (HFiClassCalcDivKeys(CSN, keys, keycnt, div_keys, use_elite)) {
+		free(div_keys);
+		return 1;
+	}
 
-		doMAC(CCNR, div_key, list[i].mac);
-	}	
+	for ( int i=0; i < keycnt; i++)
+		doMAC(CCNR, div_keys + 8 * i, list[i].mac);
+
+	free(div_keys);
 	return 0;
 }
 
 int GenerateFromKeyFile( uint8_t* CSN, uint8_t* CCNR, bool use_raw, bool use_elite, uint8_t* keys, int keycnt, iclass_prekey_t* list ) {
+	if (keycnt <= 0)
+		return 0;
 
-	uint8_t div_key[8] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
+	uint8_t *div_keys = calloc(keycnt, 8);
+	if (!div_keys)
+		return 1;
+
+	// generate diversifed keys
+	if (use_raw)
+		memcpy(div_keys, keys, 8 * keycnt);
+	else if (HFiClassCalcDivKeys(CSN, keys, keycnt, div_keys, use_elite)) {
+		free(div_keys);
+		return 1;
+	}
 
 	for ( int i=0; i < keycnt; i++) {
-				
 		memcpy(list[i].key, keys + 8 * i , 8); 
-		
-		// generate diversifed key
-		if (use_raw)
-			memcpy(div_key, list[i].key, 8);
-		else
-			HFiClassCalcDivKey(CSN, list[i].key, div_key, use_elite);
 
 		// generate MAC
-		doMAC(CCNR, div_key, list[i].mac);
+		doMAC(CCNR, div_keys + 8 * i, list[i].mac);
 	}	
+	free(div_keys);
 	return 0;
 }
 
@@ -2516,6 +2843,7 @@ static command_t CommandTable[] = {
 	{"calcnewkey",  CmdHFiClassCalcNewKey,     	1,	"[options..] Calc Diversified keys (blocks 3 & 4) to write new keys"},
 	{"chk",         CmdHFiClassCheckKeys,      	1,	"            Check keys"},
 	{"clone",       CmdHFiClassCloneTag,       	0,	"[options..] Authenticate and Clone from iClass bin file"},
+	{"decode",      CmdHFiClassDecode,         	1,	"[options..] Replay sniff samples through the firmware decoders,  tests and bench"},
 	{"decrypt",     CmdHFiClassDecrypt,        	1,	"[f <fname>] Decrypt tagdump" },
 	{"dump",        CmdHFiClassReader_Dump,    	0,	"[options..] Authenticate and Dump iClass tag's AA1"},
 	{"eload",       CmdHFiClassELoad,          	0,	"[f <fname>] (experimental) Load data into iClass emulator memory"},
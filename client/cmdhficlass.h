@@ -23,17 +23,22 @@
 #include "util.h"
 #include "cmdmain.h"
 #include "des.h"
+#include "blockcipher.h"
 #include "loclass/cipherutils.h"
 #include "loclass/cipher.h"
+#include "optimized_cipher.h"
 #include "loclass/ikeys.h"
 #include "loclass/elite_crack.h"
 #include "loclass/fileutils.h"
+#include "cmdtrace.h"		// sniff streaming
 #include "protocols.h"
 #include "usb_cmd.h"
 #include "cmdhfmfu.h"
 #include "cmdhf.h"
+#include "util_posix.h"
 #include "protocols.h"	// picopass structs,
 #include "usb_cdc.h" // for usb_poll_validate_length
+#include "hficlassreplay.h"	// decoder replay
 
 
 
@@ -69,6 +74,7 @@ extern int CmdHFiClass_TestMac(const char *Cmd);
 extern int CmdHFiClassManageKeys(const char *Cmd);
 extern int CmdHFiClass_loclass(const char *Cmd);
 extern int CmdHFiClassSniff(const char *Cmd);
+extern int CmdHFiClassDecode(const char *Cmd);
 extern int CmdHFiClassSim(const char *Cmd);
 extern int CmdHFiClassWriteKeyFile(const char *Cmd);
 extern int CmdHFiClass_WriteBlock(const char *Cmd);
@@ -78,6 +84,7 @@ extern int CmdHFiClassPermuteKey(const char *Cmd);
 
 void printIclassDumpContents(uint8_t *iclass_dump, uint8_t startblock, uint8_t endblock, size_t filesize);
 void HFiClassCalcDivKey(uint8_t	*CSN, uint8_t	*KEY, uint8_t *div_key, bool elite);
+int HFiClassCalcDivKeys(uint8_t *CSN, uint8_t *keys, int keycnt, uint8_t *div_keys, bool elite);
 
 int LoadDictionaryKeyFile( char* filename, uint8_t **keys, int *keycnt);
 int GenerateMacFromKeyFile( uint8_t* CSN, uint8_t* CCNR, bool use_raw, bool use_elite, uint8_t* keys, int keycnt, iclass_premac_t* list );
@@ -16,9 +16,10 @@ static int CmdHelp(const char *Cmd);
 int usage_legic_calccrc(void){
 	PrintAndLogEx(NORMAL, "Calculates the legic crc8/crc16 on the given data.");
 	PrintAndLogEx(NORMAL, "There must be an even number of hexsymbols as input.");
-	PrintAndLogEx(NORMAL, "Usage:  hf legic crc [h] d <data> u <uidcrc> c <8|16>");
+	PrintAndLogEx(NORMAL, "Usage:  hf legic crc [h] [b] d <data> u <uidcrc> c <8|16>");
 	PrintAndLogEx(NORMAL, "Options:");
 	PrintAndLogEx(NORMAL, "      h             : this help");
+	PrintAndLogEx(NORMAL, "      b             : self test and benchmark of the crc tables and prng jumps against the bitwise code");
 	PrintAndLogEx(NORMAL, "      d <data>      : (hex symbols) bytes to calculate crc over");
 	PrintAndLogEx(NORMAL, "      u <uidcrc>    : MCC hexbyte");
 	PrintAndLogEx(NORMAL, "      c <8|16>      : Crc type");
@@ -26,6 +27,23 @@ int usage_legic_calccrc(void){
 	PrintAndLogEx(NORMAL, "Examples:");
 	PrintAndLogEx(NORMAL, "      hf legic crc d deadbeef1122");
 	PrintAndLogEx(NORMAL, "      hf legic crc d deadbeef1122 u 9A c 16");
+	PrintAndLogEx(NORMAL, "      hf legic crc b");
+	return 0;
+}
+int usage_legic_check(void){
+	PrintAndLogEx(NORMAL, "Checks MCC and segment header crcs of LEGIC Prime dumps offline.");
+	PrintAndLogEx(NORMAL, "The file holds one or more dumps of the same size back to back.");
+	PrintAndLogEx(NORMAL, "Usage:  hf legic check [h] [v] f <file> [s <size>] [o <file>]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "      h             : this help");
+	PrintAndLogEx(NORMAL, "      v             : one line per dump");
+	PrintAndLogEx(NORMAL, "      f <file>      : binary file with dumps,  as `hf legic dump` saves them");
+	PrintAndLogEx(NORMAL, "      s <size>      : size of one dump, 22, 256 or 1024 (default: guess from file size)");
+	PrintAndLogEx(NORMAL, "      o <file>      : save the dumps with the segments deobfuscated");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "      hf legic check f mydumps.bin v");
+	PrintAndLogEx(NORMAL, "      hf legic check f mydump.bin o mydump_plain.bin");
 	return 0;
 }
 int usage_legic_rdmem(void){	
@@ -649,6 +667,157 @@ int CmdLegicRfWrite(const char *Cmd) {
     return 0;
 }
 
+// bit serial references for the self test,  the way crc.c / legic_prng.c did it before the tables
+static uint32_t legic_crc8_ref(uint8_t *buff, size_t size) {
+	crc_t crc;
+	crc_init_ref(&crc, 8, 0x63, 0x55, 0, true, true);
+	for (size_t i = 0; i < size; ++i)
+		crc_update2(&crc, buff[i], 8);
+	return reflect8(crc_finish(&crc));
+}
+
+static uint32_t legic_crc4_ref(uint32_t data, uint8_t bits) {
+	crc_t crc;
+	crc_init(&crc, 4, 0x19 >> 1, 0x5, 0);
+	crc_update(&crc, data, bits);
+	return crc_finish(&crc);
+}
+
+static void legic_prng_step_ref(int count) {
+	while (count-- > 0)
+		legic_prng_forward(1);
+}
+
+#define LEGIC_BENCH_LEN		0x100000
+#define LEGIC_BENCH_LOOPS	0x40000
+
+static void legic_bench_line(const char *name, uint64_t n, uint64_t ref_ms, uint64_t fast_ms, bool ok) {
+	PrintAndLogEx(NORMAL, "%-10s | %9" PRIu64 " | %9" PRIu64 " | %9" PRIu64 " | %7.1fx | %s",
+		name, n, ref_ms, fast_ms,
+		(double)ref_ms / (fast_ms ? fast_ms : 1),
+		ok ? _GREEN_(ok) : _RED_(fail));
+}
+
+static int legic_bench(void) {
+	uint8_t *buf = malloc(LEGIC_BENCH_LEN);
+	if (!buf) {
+		PrintAndLogEx(WARNING, "Cannot allocate memory");
+		return 2;
+	}
+
+	srand(msclock());
+	for (uint32_t i = 0; i < LEGIC_BENCH_LEN; i++)
+		buf[i] = rand();
+
+	bool allok = true, ok;
+	uint64_t t0, t1, t2;
+	volatile uint32_t sink = 0;
+
+	PrintAndLogEx(NORMAL, "           |     items |    ref ms |   fast ms |  speedup | result");
+	PrintAndLogEx(NORMAL, "-----------+-----------+-----------+-----------+----------+-------");
+
+	// crc8,  a uid and random slices of the buffer
+	uint8_t uid[] = {0x0B, 0xAD, 0xC0, 0xDE};
+	ok = CRC8Legic(uid, 4) == legic_crc8_ref(uid, 4);
+	for (int i = 0; i < 1000 && ok; i++) {
+		size_t off = rand() % (LEGIC_BENCH_LEN - 64), n = rand() % 64;
+		ok = CRC8Legic(buf + off, n) == legic_crc8_ref(buf + off, n);
+	}
+	t0 = msclock();
+	sink = legic_crc8_ref(buf, LEGIC_BENCH_LEN);
+	t1 = msclock();
+	sink = CRC8Legic(buf, LEGIC_BENCH_LEN);
+	t2 = msclock();
+	ok &= sink == legic_crc8_ref(buf, LEGIC_BENCH_LEN);
+	allok &= ok;
+	legic_bench_line("crc8", LEGIC_BENCH_LEN, t1 - t0, t2 - t1, ok);
+
+	// crc16,  against the generic bit loop
+	ok = true;
+	for (int i = 0; i < 1000 && ok; i++) {
+		size_t off = rand() % (LEGIC_BENCH_LEN - 64), n = rand() % 64;
+		uint8_t mcc = rand();
+		ok = crc16_legic(buf + off, n, mcc) == crc16(buf + off, n, mcc << 8 | mcc, CRC16_POLY_LEGIC, true, true);
+	}
+	t0 = msclock();
+	sink = crc16(buf, LEGIC_BENCH_LEN, 0x9A9A, CRC16_POLY_LEGIC, true, true);
+	t1 = msclock();
+	sink = crc16_legic(buf, LEGIC_BENCH_LEN, 0x9A);
+	t2 = msclock();
+	ok &= sink == crc16(buf, LEGIC_BENCH_LEN, 0x9A9A, CRC16_POLY_LEGIC, true, true);
+	allok &= ok;
+	legic_bench_line("crc16", LEGIC_BENCH_LEN, t1 - t0, t2 - t1, ok);
+
+	// crc4 of reader commands,  19 bits as the MIM1024 read sends them
+	uint32_t *cmds = (uint32_t *)buf;
+	uint32_t ncmds = LEGIC_BENCH_LEN / sizeof(uint32_t);
+	ok = true;
+	for (uint32_t i = 0; i < ncmds; i++) {
+		cmds[i] &= 0x7FFFF;
+		if (i < 10000)
+			ok &= crc4_legic(cmds[i], 19) == legic_crc4_ref(cmds[i], 19);
+	}
+	uint32_t x = 0;
+	t0 = msclock();
+	for (uint32_t i = 0; i < ncmds; i++)
+		x += legic_crc4_ref(cmds[i], 19);
+	t1 = msclock();
+	sink = x;
+	x = 0;
+	for (uint32_t i = 0; i < ncmds; i++)
+		x += crc4_legic(cmds[i], 19);
+	t2 = msclock();
+	ok &= sink == x;
+	allok &= ok;
+	legic_bench_line("crc4", ncmds, t1 - t0, t2 - t1, ok);
+
+	// prng jumps of up to 0x800 steps,  same state after both
+	ok = true;
+	for (int i = 0; i < 1000 && ok; i++) {
+		uint8_t iv = rand();
+		int n = rand() % 0x800;
+		legic_prng_init(iv);
+		legic_prng_step_ref(n);
+		uint32_t ref = legic_prng_get_bits(32);
+		legic_prng_init(iv);
+		legic_prng_forward(n);
+		ok = ref == legic_prng_get_bits(32);
+	}
+	legic_prng_init(0x55);
+	t0 = msclock();
+	for (int i = 0; i < LEGIC_BENCH_LOOPS; i++)
+		legic_prng_step_ref(buf[i] << 3);
+	t1 = msclock();
+	x = legic_prng_get_bits(32);
+	legic_prng_init(0x55);
+	for (int i = 0; i < LEGIC_BENCH_LOOPS; i++)
+		legic_prng_forward(buf[i] << 3);
+	t2 = msclock();
+	ok &= x == legic_prng_get_bits(32);
+	allok &= ok;
+	legic_bench_line("prng jump", LEGIC_BENCH_LOOPS, t1 - t0, t2 - t1, ok);
+
+	// keystream bytes,  get_bits(8) in a loop against the batch call
+	ok = true;
+	t0 = msclock();
+	legic_prng_init(0x55);
+	legic_prng_forward(0x1234);
+	for (uint32_t i = 0; i < LEGIC_BENCH_LEN; i++)
+		buf[i] = legic_prng_get_bits(8);
+	t1 = msclock();
+	uint8_t ks[256];
+	for (uint32_t i = 0; i < LEGIC_BENCH_LEN; i += sizeof(ks)) {
+		legic_prng_keystream(0x55, 0x1234 + i * 8, ks, sizeof(ks));
+		ok &= !memcmp(ks, buf + i, sizeof(ks));
+	}
+	t2 = msclock();
+	allok &= ok;
+	legic_bench_line("keystream", LEGIC_BENCH_LEN, t1 - t0, t2 - t1, ok);
+
+	free(buf);
+	return allok ? 0 : 1;
+}
+
 int CmdLegicCalcCrc(const char *Cmd){
 
 	uint8_t *data = NULL;
@@ -705,6 +874,10 @@ int CmdLegicCalcCrc(const char *Cmd){
 			type = param_get8ex(Cmd, cmdp+1, 0, 10);
 			cmdp += 2;
 			break;
+		case 'b':
+		case 'B':
+			if (data) free(data);
+			return legic_bench();
 		case 'h':
 		case 'H':
 			errors = true;
@@ -723,7 +896,6 @@ int CmdLegicCalcCrc(const char *Cmd){
 	
 	switch (type){
 		case 16:
-			init_table(CRC_LEGIC);
 			PrintAndLogEx(NORMAL, "Legic crc16: %X", crc16_legic(data, len, uidcrc));
 			break;
 		default:
@@ -735,6 +907,138 @@ int CmdLegicCalcCrc(const char *Cmd){
 	return 0;
 } 
 
+static const char *legic_dump_type_str(legic_dump_type_t type) {
+	switch (type) {
+		case LEGIC_DUMP_NM: return "NM";
+		case LEGIC_DUMP_MASTER: return "master";
+		case LEGIC_DUMP_IM: return "IM";
+		case LEGIC_DUMP_IMS: return "IM-S";
+	}
+	return "?";
+}
+
+int CmdLegicCheck(const char *Cmd) {
+	char filename[FILE_PATH_SIZE] = {0};
+	char outname[FILE_PATH_SIZE] = {0};
+	uint32_t dumplen = 0;
+	bool verbose = false, errors = false;
+	uint8_t cmdp = 0;
+
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+		case 'f':
+			if (param_getstr(Cmd, cmdp + 1, filename, sizeof(filename)) == 0)
+				errors = true;
+			cmdp += 2;
+			break;
+		case 'o':
+			if (param_getstr(Cmd, cmdp + 1, outname, sizeof(outname)) == 0)
+				errors = true;
+			cmdp += 2;
+			break;
+		case 's':
+			dumplen = param_get32ex(Cmd, cmdp + 1, 0, 10);
+			cmdp += 2;
+			break;
+		case 'v':
+			verbose = true;
+			cmdp++;
+			break;
+		case 'h':
+			return usage_legic_check();
+		default:
+			PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
+			errors = true;
+			break;
+		}
+	}
+	if (errors || !filename[0])
+		return usage_legic_check();
+
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		PrintAndLogEx(WARNING, "File %s not found or locked", filename);
+		return 1;
+	}
+	fseek(f, 0, SEEK_END);
+	long fsize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	// without a size the largest card that fits the file
+	if (dumplen == 0) {
+		if (fsize % LEGIC_DUMP_MAXSIZE == 0)
+			dumplen = LEGIC_DUMP_MAXSIZE;
+		else if (fsize % 256 == 0)
+			dumplen = 256;
+		else
+			dumplen = 22;
+	}
+	if (fsize <= 0 || dumplen < 22 || dumplen > LEGIC_DUMP_MAXSIZE || fsize % dumplen) {
+		PrintAndLogEx(WARNING, "File size %ld is not a multiple of the dump size %u", fsize, dumplen);
+		fclose(f);
+		return 1;
+	}
+
+	size_t n = fsize / dumplen;
+	uint8_t *dumps = malloc(fsize);
+	legic_dump_info_t *infos = calloc(n, sizeof(legic_dump_info_t));
+	if (!dumps || !infos) {
+		PrintAndLogEx(WARNING, "Cannot allocate memory");
+		free(dumps);
+		free(infos);
+		fclose(f);
+		return 2;
+	}
+	size_t bytes_read = fread(dumps, 1, fsize, f);
+	fclose(f);
+	if (bytes_read != (size_t)fsize) {
+		PrintAndLogEx(WARNING, "File reading error");
+		free(dumps);
+		free(infos);
+		return 2;
+	}
+
+	uint64_t start = msclock();
+	size_t good = legic_dump_check_batch(dumps, dumplen, n, outname[0] != 0, infos);
+	uint64_t msecs = msclock() - start;
+
+	if (verbose || n == 1) {
+		PrintAndLogEx(NORMAL, "  # | uid      | MCC     | type   | segments  | result");
+		PrintAndLogEx(NORMAL, "----+----------+---------+--------+-----------+-------");
+		for (size_t i = 0; i < n; i++) {
+			legic_dump_info_t *info = &infos[i];
+			bool ok = info->mcc_ok && info->segments_ok == info->segments && !info->truncated;
+			PrintAndLogEx(NORMAL, "%3zu | %s | %02X (%s) | %-6s | %3u / %-3u | %s%s",
+				i,
+				sprint_hex_inrow(dumps + i * dumplen, 4),
+				info->mcc,
+				info->mcc_ok ? "ok" : "--",
+				legic_dump_type_str(info->type),
+				info->segments_ok,
+				info->segments,
+				ok ? _GREEN_(ok) : _RED_(fail),
+				info->truncated ? " truncated" : "");
+		}
+	}
+
+	PrintAndLogEx(SUCCESS, "%zu of %zu dumps (%u bytes) valid,  %" PRIu64 " ms", good, n, dumplen, msecs);
+
+	if (outname[0]) {
+		f = fopen(outname, "wb");
+		if (!f) {
+			PrintAndLogEx(WARNING, "Could not create file %s", outname);
+		} else {
+			fwrite(dumps, 1, fsize, f);
+			fclose(f);
+			PrintAndLogEx(SUCCESS, "Deobfuscated dumps saved to %s", outname);
+		}
+	}
+
+	free(dumps);
+	free(infos);
+	return good == n ? 0 : 1;
+}
+
 int legic_read_mem(uint32_t offset, uint32_t len, uint32_t iv, uint8_t *out, uint16_t *outlen) {
 	
 	legic_chk_iv(&iv);
@@ -1266,6 +1570,7 @@ static command_t CommandTable[] =  {
 	{"sim",		CmdLegicRfSim,		0, "Start tag simulator"},
 	{"write",	CmdLegicRfWrite,	0, "Write data to a LEGIC Prime tag"},
 	{"crc",		CmdLegicCalcCrc,	1, "Calculate Legic CRC over given bytes"},	
+	{"check",	CmdLegicCheck,		1, "Check MCC and segment crcs of dump files offline"},
 	{"eload",	CmdLegicELoad,		1, "Load binary dump to emulator memory"},
 	{"esave",	CmdLegicESave,		1, "Save emulator memory to binary file"},
 	{"list",	CmdLegicList,		1, "[Deprecated] List LEGIC history"},
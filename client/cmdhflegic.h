@@ -19,6 +19,9 @@
 #include "cmdmain.h"
 #include "util.h"
 #include "crc.h"
+#include "crc16.h"
+#include "util_posix.h"
+#include "legic_dump.h"
 #include "legic_prng.h"
 #include "legic.h" // legic_card_select_t struct
 #include "cmdhf.h" // "hf list"
@@ -31,6 +34,7 @@ extern int CmdLegicLoad(const char *Cmd);
 extern int CmdLegicRfSim(const char *Cmd);
 extern int CmdLegicRfWrite(const char *Cmd);
 extern int CmdLegicCalcCrc(const char *Cmd);
+extern int CmdLegicCheck(const char *Cmd);
 extern int CmdLegicDump(const char *Cmd);
 extern int CmdLegicRestore(const char *Cmd);
 extern int CmdLegicReader(const char *Cmd);
@@ -47,6 +51,7 @@ void legic_seteml(uint8_t *src, uint32_t offset, uint32_t numofbytes);
 int legic_read_mem(uint32_t offset, uint32_t len, uint32_t iv, uint8_t *out, uint16_t *outlen);
 
 int usage_legic_calccrc(void);
+int usage_legic_check(void);
 int usage_legic_load(void);
 int usage_legic_rdmem(void);
 int usage_legic_sim(void);
@@ -10,6 +10,7 @@
 //-----------------------------------------------------------------------------
 
 #include "cmdhflist.h"
+#include "mifaretrace.h"
 
 enum MifareAuthSeq {
 	masNone,
@@ -21,9 +22,32 @@ enum MifareAuthSeq {
 	masData,
 	masError,
 };
-static enum MifareAuthSeq MifareAuthState;
+// per thread,  the annotation of a listing can run on several threads
+static __thread enum MifareAuthSeq MifareAuthState;
 static TAuthData AuthData;
 
+// auth sessions of the listed trace,  resolved in the first pass
+typedef struct {
+	uint32_t nr_enc;
+	uint32_t ar_enc;
+	uint32_t at_enc;
+	mf_trace_auth_t res;
+} mfTraceSession_t;
+
+static struct {
+	mfTraceSession_t *sessions;
+	int count;
+	int size;
+	int next;
+	bool resolve;
+	bool hard;
+	int threads;
+	mf_trace_pool_t *pool;
+} mfTrace = { .resolve = true };
+
+static struct Crypto1State *traceCrypto1;
+static uint64_t mfLastKey;
+
 void ClearAuthData() {
 	AuthData.uid = 0;
 	AuthData.nt = 0;
@@ -348,6 +372,15 @@ void annotateIso7816(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize){
 	}
 }
 
+// last I-block of a response: SW1 SW2 sit in front of the CRC
+void annotateIso7816Response(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize){
+	if ( (cmd[0] & 0xD2) != 0x02 || cmdsize < 5 )
+		return;
+
+	uint8_t sw1 = cmd[cmdsize - 4], sw2 = cmd[cmdsize - 3];
+	snprintf(exp, size, "%02X%02X %s", sw1, sw2, GetAPDUCodeDescription(sw1, sw2));
+}
+
 // MIFARE DESFire
 void annotateMfDesfire(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize){
 	
@@ -602,10 +635,90 @@ void annotateMifare(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize, uint8
 	
 }
 
-bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isResponse, uint8_t *mfData, size_t *mfDataLen) {
-	static struct Crypto1State *traceCrypto1;	
-	static uint64_t mfLastKey;
-	
+static mfTraceSession_t *MifareSession(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity) {
+	// print pass,  the sessions come in the same order
+	if (!mfTrace.resolve && mfTrace.next < mfTrace.count) {
+		mfTraceSession_t *s = &mfTrace.sessions[mfTrace.next];
+		if (s->nr_enc == AuthData.nr_enc && s->ar_enc == AuthData.ar_enc && s->at_enc == AuthData.at_enc) {
+			mfTrace.next++;
+			return s;
+		}
+	}
+
+	if (mfTrace.count == mfTrace.size) {
+		int size = mfTrace.size ? mfTrace.size * 2 : 16;
+		mfTraceSession_t *p = realloc(mfTrace.sessions, size * sizeof(mfTraceSession_t));
+		if (!p)
+			return NULL;
+		mfTrace.sessions = p;
+		mfTrace.size = size;
+	}
+
+	if (!mfTrace.pool && !AuthData.first_auth)
+		mfTrace.pool = mf_trace_pool_create(mfTrace.threads);
+
+	mfTraceSession_t *s = &mfTrace.sessions[mfTrace.count];
+	s->nr_enc = AuthData.nr_enc;
+	s->ar_enc = AuthData.ar_enc;
+	s->at_enc = AuthData.at_enc;
+	mf_trace_resolve(mfTrace.pool, &AuthData, mfLastKey, mfTrace.hard, cmd, cmdsize, parity, &s->res);
+
+	mfTrace.count++;
+	if (!mfTrace.resolve)
+		mfTrace.next = mfTrace.count;
+	return s;
+}
+
+void MifareTraceResolve(int threads, bool hard) {
+	MifareTraceDone();
+	mfTrace.threads = threads;
+	mfTrace.hard = hard;
+	mfTrace.resolve = true;
+	MifareAuthState = masNone;
+	ClearAuthData();
+}
+
+void MifareTracePrint(void) {
+	if (traceCrypto1) {
+		crypto1_destroy(traceCrypto1);
+		traceCrypto1 = NULL;
+	}
+	mfLastKey = 0;
+	mfTrace.resolve = false;
+	mfTrace.next = 0;
+	MifareAuthState = masNone;
+	ClearAuthData();
+}
+
+void MifareTraceDone(void) {
+	if (traceCrypto1) {
+		crypto1_destroy(traceCrypto1);
+		traceCrypto1 = NULL;
+	}
+	mfLastKey = 0;
+	mf_trace_pool_free(mfTrace.pool);
+	free(mfTrace.sessions);
+	memset(&mfTrace, 0, sizeof(mfTrace));
+}
+
+void MifareTraceStats(TMifareTraceStats *stats) {
+	memset(stats, 0, sizeof(TMifareTraceStats));
+	stats->threads = mf_trace_pool_threads(mfTrace.pool);
+	stats->sessions = mfTrace.count;
+	for (int i = 0; i < mfTrace.count; i++) {
+		mf_trace_auth_t *r = &mfTrace.sessions[i].res;
+		if (r->src == MF_TRACE_KEY_NESTED)
+			stats->nested++;
+		if (r->src == MF_TRACE_KEY_HARD)
+			stats->hard++;
+		if (r->src == MF_TRACE_KEY_NONE)
+			stats->unresolved++;
+		stats->candidates += r->candidates;
+		stats->msecs += r->msecs;
+	}
+}
+
+bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isResponse, uint8_t *mfData, size_t *mfDataLen, char *note, size_t notesize) {
 	*mfDataLen = 0;
 	
 	if (MifareAuthState == masAuthComplete) {
@@ -622,107 +735,57 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
 		return false;
 	
 	if (MifareAuthState == masFirstData) {
-		if (AuthData.first_auth) {
-			AuthData.ks2 = AuthData.ar_enc ^ prng_successor(AuthData.nt, 64);
-			AuthData.ks3 = AuthData.at_enc ^ prng_successor(AuthData.nt, 96);
-
-			mfLastKey = GetCrypto1ProbableKey(&AuthData);
-			PrintAndLogEx(NORMAL, "            |            |  *  |%49s %012"PRIx64" prng %s |     |", 
-				"key", 
-				mfLastKey,
-				validate_prng_nonce(AuthData.nt) ? "WEAK": "HARD");
-			
-			AuthData.first_auth = false;
+		mfTraceSession_t *s = MifareSession(cmd, cmdsize, parity);
+		mf_trace_auth_t *r = s ? &s->res : NULL;
+
+		switch (r ? r->src : MF_TRACE_KEY_NONE) {
+			case MF_TRACE_KEY_FIRST:
+				snprintf(note, notesize, "            |            |  *  |%49s %012"PRIx64" prng %s |     |", 
+					"key", 
+					r->key,
+					validate_prng_nonce(AuthData.nt) ? "WEAK": "HARD");
+				break;
+			case MF_TRACE_KEY_LAST:
+				snprintf(note, notesize, "            |            |  *  |%60s %012"PRIx64"|     |", "last used key", r->key);
+				break;
+			case MF_TRACE_KEY_DEFAULT:
+				snprintf(note, notesize, "            |            |  *  |%61s %012"PRIx64"|     |", "key", r->key);
+				break;
+			case MF_TRACE_KEY_NESTED:
+				snprintf(note, notesize, "            |            |  *  | nested probable key:%012"PRIx64"      ks2:%08x ks3:%08x |     |", 
+					r->key,
+					r->ks2,
+					r->ks3);
+				break;
+			case MF_TRACE_KEY_HARD:
+				snprintf(note, notesize, "            |            |  *  | hard probable key:%012"PRIx64"        ks2:%08x ks3:%08x |     |", 
+					r->key,
+					r->ks2,
+					r->ks3);
+				break;
+			default:
+				if (r && r->hard)
+					snprintf(note, notesize, "key not found. uid:%x nt:%x ar_enc:%x at_enc:%x\n", AuthData.uid, AuthData.nt, AuthData.ar_enc, AuthData.at_enc);
+				else
+					snprintf(note, notesize, "hardnested, list with x to search the key. uid:%x nt:%x ar_enc:%x at_enc:%x\n", AuthData.uid, AuthData.nt, AuthData.ar_enc, AuthData.at_enc);
+				break;
+		}
 
-			traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
+		AuthData.first_auth = false;
+		if (r && r->src != MF_TRACE_KEY_NONE) {
+			AuthData.nt = r->nt;
+			AuthData.ks2 = r->ks2;
+			AuthData.ks3 = r->ks3;
+			mfLastKey = r->key;
+			traceCrypto1 = malloc(sizeof(struct Crypto1State));
+			if (traceCrypto1)
+				*traceCrypto1 = r->state;
+			MifareAuthState = masData;
 		} else {
-			if (traceCrypto1) {
-				crypto1_destroy(traceCrypto1);
-				traceCrypto1 = NULL;
-			}
-
-			// check last used key
-			if (mfLastKey) {
-				if (NestedCheckKey(mfLastKey, &AuthData, cmd, cmdsize, parity)) {
-					PrintAndLogEx(NORMAL, "            |            |  *  |%60s %012"PRIx64"|     |", "last used key", mfLastKey);
-					traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-				};
-			}
-			
-			// check default keys
-			if (!traceCrypto1) {
-				for (int i = 0; i < MIFARE_DEFAULTKEYS_SIZE; i++){
-					if (NestedCheckKey(g_mifare_default_keys[i], &AuthData, cmd, cmdsize, parity)) {
-						PrintAndLogEx(NORMAL, "            |            |  *  |%61s %012"PRIx64"|     |", "key", g_mifare_default_keys[i]);
-
-						mfLastKey = g_mifare_default_keys[i];
-						traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-						break;
-					};
-				}
-			}
-			
-			// nested
-			if (!traceCrypto1 && validate_prng_nonce(AuthData.nt)) {
-				uint32_t ntx = prng_successor(AuthData.nt, 90); 
-				for (int i = 0; i < 16383; i++) {
-					ntx = prng_successor(ntx, 1);
-					if (NTParityChk(&AuthData, ntx)){
-
-						uint32_t ks2 = AuthData.ar_enc ^ prng_successor(ntx, 64);
-						uint32_t ks3 = AuthData.at_enc ^ prng_successor(ntx, 96);
-						struct Crypto1State *pcs = lfsr_recovery64(ks2, ks3);
-						memcpy(mfData, cmd, cmdsize);
-						mf_crypto1_decrypt(pcs, mfData, cmdsize, 0);				
-						crypto1_destroy(pcs);
-						
-						if (CheckCrypto1Parity(cmd, cmdsize, mfData, parity) && check_crc(CRC_14443_A, mfData, cmdsize)) {
-							AuthData.ks2 = ks2;
-							AuthData.ks3 = ks3;
-							AuthData.nt = ntx;
-							mfLastKey = GetCrypto1ProbableKey(&AuthData);
-							PrintAndLogEx(NORMAL, "            |            |  *  | nested probable key:%012"PRIx64"      ks2:%08x ks3:%08x |     |", 
-								mfLastKey,
-								AuthData.ks2,
-								AuthData.ks3);
-
-							traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-							break;
-						}
-					}						
-				}
-			}
-			
-			//hardnested
-			if (!traceCrypto1) {
-				PrintAndLogEx(NORMAL, "hardnested not implemented. uid:%x nt:%x ar_enc:%x at_enc:%x\n", AuthData.uid, AuthData.nt, AuthData.ar_enc, AuthData.at_enc);
-				MifareAuthState = masError;
-
-				/* TOO SLOW( needs to have more strong filter. with this filter - aprox 4 mln tests
-				uint32_t t = msclock();
-				uint32_t t1 = t;
-				int n = 0;
-				for (uint32_t i = 0; i < 0xFFFFFFFF; i++) {
-					if (NTParityChk(&AuthData, i)){
-
-						uint32_t ks2 = AuthData.ar_enc ^ prng_successor(i, 64);
-						uint32_t ks3 = AuthData.at_enc ^ prng_successor(i, 96);
-						struct Crypto1State *pcs = lfsr_recovery64(ks2, ks3);
-
-						n++;
-
-						if (!(n % 100000)) {
-							PrintAndLogEx(NORMAL, "delta=%d n=%d ks2=%x ks3=%x \n", msclock() - t1 , n, ks2, ks3);
-							t1 = msclock();
-						}
-
-					}
-				}
-				PrintAndLogEx(NORMAL, "delta=%d n=%d\n", msclock() - t, n);
-				*/
-			}
+			AuthData.ks2 = 0;
+			AuthData.ks3 = 0;
+			MifareAuthState = masError;
 		}
-		MifareAuthState = masData;
 	}
 	
 	if (MifareAuthState == masData && traceCrypto1) {
@@ -742,7 +805,11 @@ bool NTParityChk(TAuthData *ad, uint32_t ntx) {
 		)
 		return false;
 	
-	uint32_t ar = prng_successor(ntx, 64);
+	return ArAtParityChk(ad, prng_successor(ntx, 64), prng_successor(ntx, 96));
+}
+
+// the parity checks on ar and at only,  they depend on the low 16 bits of nt
+bool ArAtParityChk(TAuthData *ad, uint32_t ar, uint32_t at) {
 	if (
 		(oddparity8(ar >> 8 & 0xff) ^ (ar & 0x01) ^ ((ad->ar_enc_par >> 5) & 0x01) ^ (ad->ar_enc & 0x01)) ||
 		(oddparity8(ar >> 16 & 0xff) ^ (ar >> 8 & 0x01) ^ ((ad->ar_enc_par >> 6) & 0x01) ^ (ad->ar_enc >> 8 & 0x01)) ||
@@ -750,7 +817,6 @@ bool NTParityChk(TAuthData *ad, uint32_t ntx) {
 		)
 		return false;
 
-	uint32_t at = prng_successor(ntx, 96);
 	if (
 		(oddparity8(ar & 0xff) ^ (at >> 24 & 0x01) ^ ((ad->ar_enc_par >> 4) & 0x01) ^ (ad->at_enc >> 24 & 0x01)) ||
 		(oddparity8(at >> 8 & 0xff) ^ (at & 0x01) ^ ((ad->at_enc_par >> 5) & 0x01) ^ (ad->at_enc & 0x01)) ||
@@ -766,8 +832,8 @@ bool NestedCheckKey(uint64_t key, TAuthData *ad, uint8_t *cmd, uint8_t cmdsize,
 	uint8_t buf[32] = {0};
 	struct Crypto1State *pcs;
 	
-	AuthData.ks2 = 0;
-	AuthData.ks3 = 0;
+	ad->ks2 = 0;
+	ad->ks3 = 0;
 
 	pcs = crypto1_create(key);
 	uint32_t nt1 = crypto1_word(pcs, ad->nt_enc ^ ad->uid, 1) ^ ad->nt_enc;
@@ -794,9 +860,9 @@ bool NestedCheckKey(uint64_t key, TAuthData *ad, uint8_t *cmd, uint8_t cmdsize,
 	if (!check_crc(CRC_14443_A, buf, cmdsize)) 
 		return false;
 	
-	AuthData.nt = nt1;
-	AuthData.ks2 = AuthData.ar_enc ^ ar;
-	AuthData.ks3 = AuthData.at_enc ^ at;
+	ad->nt = nt1;
+	ad->ks2 = ad->ar_enc ^ ar;
+	ad->ks3 = ad->at_enc ^ at;
 	return true;
 }
 
@@ -53,6 +53,24 @@ typedef struct {
 } TAuthData;
 extern void ClearAuthData();
 
+typedef struct {
+	int sessions;			// auths with a first data frame
+	int nested;				// found by the nonce search
+	int hard;				// found by the hard search
+	int unresolved;
+	uint32_t candidates;	// nonces passing the parity check
+	uint64_t msecs;			// spent in key recovery
+	int threads;
+} TMifareTraceStats;
+
+// two pass listing:  the first pass (muted) resolves the keys of all auth sessions,
+// the second one prints with them.  threads <= 0 uses all CPUs,  hard also searches
+// the sessions of hardened cards (minutes each).
+extern void MifareTraceResolve(int threads, bool hard);
+extern void MifareTracePrint(void);
+extern void MifareTraceDone(void);
+extern void MifareTraceStats(TMifareTraceStats *stats);
+
 extern uint8_t iso14443A_CRC_check(bool isResponse, uint8_t* data, uint8_t len);
 extern uint8_t iso14443B_CRC_check(uint8_t* d, uint8_t n);
 extern uint8_t mifare_CRC_check(bool isResponse, uint8_t* data, uint8_t len);
@@ -67,13 +85,16 @@ extern void annotateTopaz(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize)
 extern void annotateLegic(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize);
 extern void annotateFelica(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize);
 extern void annotateIso7816(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize);
+extern void annotateIso7816Response(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize);
 extern void annotateIso14443b(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize);
 extern void annotateIso14443a(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize);
 extern void annotateMfDesfire(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize);
 extern void annotateMifare(char *exp, size_t size, uint8_t* cmd, uint8_t cmdsize, uint8_t* parity, uint8_t paritysize, bool isResponse);
 
-extern bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isResponse, uint8_t *mfData, size_t *mfDataLen);
+// the key line of a new auth session goes to note
+extern bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isResponse, uint8_t *mfData, size_t *mfDataLen, char *note, size_t notesize);
 extern bool NTParityChk(TAuthData *ad, uint32_t ntx);
+extern bool ArAtParityChk(TAuthData *ad, uint32_t ar, uint32_t at);
 extern bool NestedCheckKey(uint64_t key, TAuthData *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity);
 extern bool CheckCrypto1Parity(uint8_t *cmd_enc, uint8_t cmdsize, uint8_t *cmd, uint8_t *parity_enc);
 extern uint64_t GetCrypto1ProbableKey(TAuthData *ad);
@@ -9,6 +9,7 @@
 //-----------------------------------------------------------------------------
 
 #include "cmdhfmf.h"
+#include "mifaretrace.h"
 
 #define MIFARE_4K_MAXBLOCK 255
 #define MIFARE_2K_MAXBLOCK 128 
@@ -214,8 +215,11 @@ int usage_hf14_restore(void){
 int usage_hf14_decryptbytes(void){
 	PrintAndLogEx(NORMAL, "Decrypt Crypto-1 encrypted bytes given some known state of crypto. See tracelog to gather needed values\n");
 	PrintAndLogEx(NORMAL, "Usage:   hf mf decrypt [h] <nt> <ar_enc> <at_enc> <data>");
+	PrintAndLogEx(NORMAL, "     or  hf mf decrypt t [<key (12 hex symbols)>]");
 	PrintAndLogEx(NORMAL, "Options:");
 	PrintAndLogEx(NORMAL, "      h            this help");
+	PrintAndLogEx(NORMAL, "      t            self test and benchmark of the hardened card search used by `hf list mf x`,");
+	PrintAndLogEx(NORMAL, "                   recovers a known key from a synthetic session");
 	PrintAndLogEx(NORMAL, "      <nt>         reader nonce");
 	PrintAndLogEx(NORMAL, "      <ar_enc>     encrypted reader response");
 	PrintAndLogEx(NORMAL, "      <at_enc>     encrypted tag response");
@@ -223,6 +227,7 @@ int usage_hf14_decryptbytes(void){
 	PrintAndLogEx(NORMAL, "Examples:");
 	PrintAndLogEx(NORMAL, "         hf mf decrypt b830049b 9248314a 9280e203 41e586f9\n");
 	PrintAndLogEx(NORMAL, "  this sample decrypts 41e586f9 -> 3003999a  Annotated: 30 03 [99 9a]  auth block 3 [crc]");
+	PrintAndLogEx(NORMAL, "         hf mf decrypt t a0a1a2a3a4a5");
 	return 0;
 }
 
@@ -2968,11 +2973,40 @@ int CmdHF14AMfCSave(const char *Cmd) {
 	return 0;
 }
 
+static int DecryptHardSelftest(const char *Cmd) {
+	uint8_t keyblock[6] = {0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5};
+	if (param_getlength(Cmd, 1) && param_gethex(Cmd, 1, keyblock, 12)) {
+		PrintAndLogEx(WARNING, "key must include 12 HEX symbols");
+		return 1;
+	}
+	uint64_t key = bytes_to_num(keyblock, 6);
+
+	mf_trace_pool_t *pool = mf_trace_pool_create(0);
+	if (!pool) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory");
+		return 1;
+	}
+
+	PrintAndLogEx(NORMAL, "hardened card session, key %012"PRIx64", %d thread(s)", key, mf_trace_pool_threads(pool));
+	uint64_t msecs = 0;
+	uint32_t candidates = 0;
+	bool ok = mf_trace_hard_selftest(pool, key, &msecs, &candidates);
+	mf_trace_pool_free(pool);
+
+	PrintAndLogEx(NORMAL, "%u nonce candidates, %"PRIu64" ms, %.1f ms per candidate", candidates, msecs, (double)msecs / (candidates ? candidates : 1));
+	if (ok)
+		PrintAndLogEx(SUCCESS, "key recovered");
+	else
+		PrintAndLogEx(FAILED, "key not recovered");
+	return ok ? 0 : 1;
+}
+
 //needs nt, ar, at, Data to decrypt
 int CmdHf14AMfDecryptBytes(const char *Cmd){
 	
 	char ctmp = param_getchar(Cmd, 0);
 	if (strlen(Cmd) < 1 || ctmp == 'h' || ctmp == 'H') return usage_hf14_decryptbytes();
+	if (ctmp == 't' || ctmp == 'T') return DecryptHardSelftest(Cmd);
 	
 	uint32_t nt 	= param_get32ex(Cmd,0,0,16);
 	uint32_t ar_enc = param_get32ex(Cmd,1,0,16);
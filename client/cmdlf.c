@@ -51,7 +51,7 @@ int usage_lf_snoop(void) {
 	return 0;
 }
 int usage_lf_config(void) {
-	PrintAndLogEx(NORMAL, "Usage: lf config [h] [H|<divisor>] [b <bps>] [d <decim>] [a 0|1]");
+	PrintAndLogEx(NORMAL, "Usage: lf config [h] [H|<divisor>] [b <bps>] [d <decim>] [a 0|1] [c 0|1]");
 	PrintAndLogEx(NORMAL, "Options:");
 	PrintAndLogEx(NORMAL, "       h             This help");
 	PrintAndLogEx(NORMAL, "       L             Low frequency (125 KHz)");
@@ -61,12 +61,16 @@ int usage_lf_config(void) {
 	PrintAndLogEx(NORMAL, "       d <decim>     Sets decimation. A value of N saves only 1 in N samples. Default: 1");
 	PrintAndLogEx(NORMAL, "       a [0|1]       Averaging - if set, will average the stored sample value when decimating. Default: 1");
 	PrintAndLogEx(NORMAL, "       t <threshold> Sets trigger threshold. 0 means no threshold (range: 0-128)");
+	PrintAndLogEx(NORMAL, "       c [0|1]       Compression - delta / run length code the samples on device, BigBuf holds more of them. Default: 0");
+	PrintAndLogEx(NORMAL, "                     Pays off on ASK tags, FSK / PSK samples come out larger. 'data compress' shows the ratio on traces");
 	PrintAndLogEx(NORMAL, "Examples:");
 	PrintAndLogEx(NORMAL, "      lf config b 8 L");
 	PrintAndLogEx(NORMAL, "                    Samples at 125KHz, 8bps.");
 	PrintAndLogEx(NORMAL, "      lf config H b 4 d 3");
 	PrintAndLogEx(NORMAL, "                    Samples at 134KHz, averages three samples into one, stored with ");
 	PrintAndLogEx(NORMAL, "                    a resolution of 4 bits per sample.");
+	PrintAndLogEx(NORMAL, "      lf config L b 8 c 1");
+	PrintAndLogEx(NORMAL, "                    Samples at 125KHz, 8bps, compressed.");
 	PrintAndLogEx(NORMAL, "      lf read");
 	PrintAndLogEx(NORMAL, "                    Performs a read (active field)");
 	PrintAndLogEx(NORMAL, "      lf snoop");
@@ -206,6 +210,8 @@ int CmdFlexdemod(const char *Cmd) {
 	}
 	
 	if (start == GraphTraceLen - LONG_WAIT) {
+		// the samples are squared already
+		graphlod_touch();
 		PrintAndLogEx(NORMAL, "nothing to wait for");
 		return 0;
 	}
@@ -256,6 +262,7 @@ int CmdLFSetConfig(const char *Cmd) {
 	uint8_t bps = 0; // Bits per sample
 	uint8_t decimation = 0; //How many to keep
 	bool averaging = 1; // Defaults to true
+	bool compression = 0;
 	bool errors = false;
 	int trigger_threshold = -1;//Means no change
 	uint8_t unsigned_trigg = 0;
@@ -297,6 +304,10 @@ int CmdLFSetConfig(const char *Cmd) {
 			averaging = param_getchar(Cmd, cmdp+1) == '1';
 			cmdp+=2;
 			break;
+		case 'c':
+			compression = param_getchar(Cmd, cmdp+1) == '1';
+			cmdp+=2;
+			break;
 		default:
 			PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar(Cmd, cmdp));
 			errors = 1;
@@ -310,7 +321,7 @@ int CmdLFSetConfig(const char *Cmd) {
 	//Bps is limited to 8
 	if (bps >> 4) bps = 8;
 
-	sample_config config = { decimation, bps, averaging, divisor, trigger_threshold };
+	sample_config config = { decimation, bps, averaging, divisor, trigger_threshold, compression };
 
 	UsbCommand c = {CMD_SET_LF_SAMPLING_CONFIG, {0,0,0} };
 	memcpy(c.d.asBytes, &config, sizeof(sample_config));
@@ -11,6 +11,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
 #include "proxmark3.h"
 #include "ui.h"
 #include "cmdparser.h"
@@ -22,18 +24,48 @@
 #include "util_posix.h"
 #include "cmdmain.h"
 #include "cmddata.h"
+#include "hitag2/hitag2_crypto.h"
+#include "hitag2/hitag2_crack.h"
 
 static int CmdHelp(const char *Cmd);
 
+#define HITAG2_CRACK_MAXPAIRS	16
+#define HITAG2_CRACK_MAXKEYS	16
+#define HITAG2_BENCH_BITS	28
+
+int usage_hitag_crack(void) {
+	PrintAndLogEx(NORMAL, "Recover a Hitag2 key from reader authentications,  the UID the tag sent and the");
+	PrintAndLogEx(NORMAL, "nR aR the reader answered.  Two of them pin down the key.  Without f or n the pairs");
+	PrintAndLogEx(NORMAL, "come from the trace of 'lf hitag snoop'.  A full search tries 2^48 keys,  known key");
+	PrintAndLogEx(NORMAL, "bits cut that down.  Press a key to abort.");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "Usage:  lf hitag crack [h] [f <file>] [u <uid>] [n <nR> <aR>] [k <key> <bits>] [t <threads>] [b]");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "           h               This help");
+	PrintAndLogEx(NORMAL, "           f <file>        pairs from a file written by 'lf hitag list <file>'");
+	PrintAndLogEx(NORMAL, "           u <uid>         tag UID,  4 hex bytes");
+	PrintAndLogEx(NORMAL, "           n <nR> <aR>     reader nonce and answer,  4 hex bytes each.  Repeat for more pairs");
+	PrintAndLogEx(NORMAL, "           k <key> <bits>  the first <bits> bits of the 6 byte <key> are known");
+	PrintAndLogEx(NORMAL, "           t <threads>     default one per CPU");
+	PrintAndLogEx(NORMAL, "           b               self test and keystreams/s of every search core");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "      lf hitag crack f snoop.txt");
+	PrintAndLogEx(NORMAL, "      lf hitag crack u 49435769 n 656e4572 e16405ac n 1a2b3c4d 5aa3fcae k 4f4e4d490000 32");
+	PrintAndLogEx(NORMAL, "      lf hitag crack b");
+	return 0;
+}
+
 size_t nbytes(size_t nbits) {
 	return (nbits/8) + ((nbits%8) > 0);
 }
 
-int CmdLFHitagList(const char *Cmd) {
- 	uint8_t *got = calloc(USB_CMD_DATA_SIZE, sizeof(uint8_t));
+// the hitag trace from BigBuf,  NULL on failure
+static uint8_t *getHitagTrace(uint16_t *traceLen) {
+	uint8_t *got = calloc(USB_CMD_DATA_SIZE, sizeof(uint8_t));
 	if ( !got ) {
 		PrintAndLogEx(WARNING, "Cannot allocate memory for trace");
-		return 2;
+		return NULL;
 	}
 
 	// Query for the actual size of the trace
@@ -41,24 +73,32 @@ int CmdLFHitagList(const char *Cmd) {
 	if ( !GetFromDevice(BIG_BUF, got, USB_CMD_DATA_SIZE, 0, &response, 2500, false) ) {
 		PrintAndLogEx(WARNING, "command execution time out");
 		free(got);
-		return 2;
+		return NULL;
 	}
 	
-	uint16_t traceLen = response.arg[2];
-	if (traceLen > USB_CMD_DATA_SIZE) {
-		uint8_t *p = realloc(got, traceLen);
+	*traceLen = response.arg[2];
+	if (*traceLen > USB_CMD_DATA_SIZE) {
+		uint8_t *p = realloc(got, *traceLen);
 		if (p == NULL) {
 			PrintAndLogEx(WARNING, "Cannot allocate memory for trace");
 			free(got);
-			return 2;
+			return NULL;
 		}
 		got = p;
-		if ( !GetFromDevice(BIG_BUF, got, traceLen, 0, NULL, 2500, false) ) {
+		if ( !GetFromDevice(BIG_BUF, got, *traceLen, 0, NULL, 2500, false) ) {
 			PrintAndLogEx(WARNING, "command execution time out");
 			free(got);
-			return 2;
+			return NULL;
 		}
 	}
+	return got;
+}
+
+int CmdLFHitagList(const char *Cmd) {
+	uint16_t traceLen = 0;
+	uint8_t *got = getHitagTrace(&traceLen);
+	if ( !got )
+		return 2;
 	
 	PrintAndLogEx(NORMAL, "recorded activity (TraceLen = %d bytes):");
 	PrintAndLogEx(NORMAL, " ETU     :nbits: who bytes");
@@ -401,6 +441,207 @@ int CmdLFHitagWP(const char *Cmd) {
 	return 0;
 }
 
+static uint64_t hitag2_random48(void) {
+	uint64_t r = 0;
+	for (int i = 0; i < 6; i++)
+		r = (r << 8) | (rand() & 0xFF);
+	return r;
+}
+
+// the search over 2^HITAG2_BENCH_BITS keys with a random key inside
+static bool hitag2_bench_core(const hitag2_bs_core_t *core, int threads, double *rate) {
+	hitag2_nrar_t pairs[2];
+	uint64_t key = hitag2_random48();
+	uint64_t keys[HITAG2_CRACK_MAXKEYS];
+	hitag2_crack_stats_t stats;
+	hitag2_crack_opts_t opts = { core, threads, false };
+
+	uint32_t uid = hitag2_random48();
+	for (int i = 0; i < 2; i++) {
+		pairs[i].uid = uid;
+		pairs[i].nR = hitag2_random48();
+		pairs[i].aR = hitag2_authenticator(key, pairs[i].uid, pairs[i].nR);
+	}
+
+	int n = hitag2_crack(pairs, 2, key, 48 - HITAG2_BENCH_BITS, &opts, keys, HITAG2_CRACK_MAXKEYS, &stats);
+	*rate = stats.msecs ? (double)stats.tried / (stats.msecs * 1000.0) : 0;
+	return n == 1 && keys[0] == key && stats.tried == (1ULL << HITAG2_BENCH_BITS);
+}
+
+static int hitag2_bench(int threads) {
+	const hitag2_bs_core_t *cores[6];
+	int ncores = hitag2_bs_cores(cores);
+	bool allok = true;
+	double rate, best = 0;
+
+	if (threads <= 0) threads = num_CPUs();
+	srand(msclock());
+
+	// the keystream from the comments of the original cipher code
+	bool ok = hitag2_authenticator(0x4F4E4D494B52ULL, 0x49435769, 0x656E4572) == 0x28DC8031;
+	uint64_t state = hitag2_init(0x4F4E4D494B52ULL, 0x49435769, 0x656E4572);
+	hitag2_bits(&state, 32);
+	ok &= hitag2_bits(&state, 32) == 0x8CD037A9;
+	allok &= ok;
+
+	uint64_t start = msclock();
+	volatile uint32_t aR = 0;
+	for (uint32_t i = 0; i < 0x40000; i++)
+		aR = hitag2_authenticator(i, 0x49435769, 0x656E4572);
+	(void)aR;
+	uint64_t msecs = msclock() - start;
+
+	PrintAndLogEx(NORMAL, "core     | lanes | threads | Mkeystreams/s | result");
+	PrintAndLogEx(NORMAL, "---------+-------+---------+---------------+-------");
+	PrintAndLogEx(NORMAL, "%-8s | %5d | %7d | %13.2f | %s", "scalar", 1, 1,
+		msecs ? 0x40000 / (msecs * 1000.0) : 0, ok ? _GREEN_(ok) : _RED_(fail));
+
+	for (int i = 0; i < ncores; i++) {
+		ok = hitag2_bench_core(cores[i], 1, &rate);
+		allok &= ok;
+		if (i == 0) best = rate;
+		PrintAndLogEx(NORMAL, "%-8s | %5d | %7d | %13.2f | %s", cores[i]->name, 1 << cores[i]->lanebits, 1,
+			rate, ok ? _GREEN_(ok) : _RED_(fail));
+	}
+
+	if (threads > 1) {
+		ok = hitag2_bench_core(cores[0], threads, &rate);
+		allok &= ok;
+		best = rate;
+		PrintAndLogEx(NORMAL, "%-8s | %5d | %7d | %13.2f | %s", cores[0]->name, 1 << cores[0]->lanebits, threads,
+			rate, ok ? _GREEN_(ok) : _RED_(fail));
+	}
+
+	PrintAndLogEx(NORMAL, "\nsearch uses %s,  a full 2^48 search about %.1f hours at the rate above",
+		hitag2_bs_get_core()->name, best > 0 ? (double)(1ULL << 48) / (best * 1e6) / 3600 : 0);
+	return allok ? 0 : 1;
+}
+
+int CmdLFHitagCrack(const char *Cmd) {
+	hitag2_nrar_t pairs[HITAG2_CRACK_MAXPAIRS];
+	int npairs = 0;
+	uint32_t uid = 0;
+	bool have_uid = false;
+	char filename[FILE_PATH_SIZE] = {0};
+	uint64_t key = 0;
+	int fixed = 0;
+	int threads = 0;
+	bool bench = false;
+	uint8_t cmdp = 0;
+
+	while (param_getchar(Cmd, cmdp) != 0x00) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+		case 'f':
+			if (param_getstr(Cmd, cmdp + 1, filename, sizeof(filename)) == 0)
+				return usage_hitag_crack();
+			cmdp += 2;
+			break;
+		case 'u':
+			if (param_getchar(Cmd, cmdp + 1) == 0x00)
+				return usage_hitag_crack();
+			uid = param_get32ex(Cmd, cmdp + 1, 0, 16);
+			have_uid = true;
+			cmdp += 2;
+			break;
+		case 'n':
+			if (param_getchar(Cmd, cmdp + 2) == 0x00 || npairs == HITAG2_CRACK_MAXPAIRS)
+				return usage_hitag_crack();
+			pairs[npairs].nR = param_get32ex(Cmd, cmdp + 1, 0, 16);
+			pairs[npairs].aR = param_get32ex(Cmd, cmdp + 2, 0, 16);
+			npairs++;
+			cmdp += 3;
+			break;
+		case 'k':
+			if (param_getchar(Cmd, cmdp + 2) == 0x00)
+				return usage_hitag_crack();
+			key = param_get64ex(Cmd, cmdp + 1, 0, 16) & HITAG2_KEY_MASK;
+			fixed = param_get32ex(Cmd, cmdp + 2, 0, 10);
+			if (fixed < 0 || fixed > 48)
+				return usage_hitag_crack();
+			cmdp += 3;
+			break;
+		case 't':
+			threads = param_get32ex(Cmd, cmdp + 1, 0, 10);
+			cmdp += 2;
+			break;
+		case 'b':
+			bench = true;
+			cmdp++;
+			break;
+		case 'h':
+		default:
+			return usage_hitag_crack();
+		}
+	}
+
+	if (bench)
+		return hitag2_bench(threads);
+
+	if (npairs) {
+		if (!have_uid) {
+			PrintAndLogEx(WARNING, "the tag UID is missing");
+			return usage_hitag_crack();
+		}
+		for (int i = 0; i < npairs; i++)
+			pairs[i].uid = uid;
+	} else if (filename[0]) {
+		npairs = hitag2_nrar_from_list(filename, pairs, HITAG2_CRACK_MAXPAIRS);
+		if (npairs < 0) {
+			PrintAndLogEx(WARNING, "Error: Could not open file [%s]", filename);
+			return 1;
+		}
+	} else {
+		uint16_t traceLen = 0;
+		uint8_t *trace = getHitagTrace(&traceLen);
+		if (!trace)
+			return 2;
+		npairs = hitag2_nrar_from_trace(trace, traceLen, pairs, HITAG2_CRACK_MAXPAIRS);
+		free(trace);
+	}
+
+	// pairs of the first UID seen
+	int n = 0;
+	for (int i = 0; i < npairs; i++) {
+		if (have_uid && pairs[i].uid != uid)
+			continue;
+		uid = pairs[i].uid;
+		have_uid = true;
+		pairs[n++] = pairs[i];
+	}
+	npairs = n;
+
+	if (npairs == 0) {
+		PrintAndLogEx(WARNING, "no reader authentication found");
+		return 1;
+	}
+	for (int i = 0; i < npairs; i++)
+		PrintAndLogEx(NORMAL, "UID %08x  nR %08x  aR %08x", pairs[i].uid, pairs[i].nR, pairs[i].aR);
+	if (npairs == 1)
+		PrintAndLogEx(WARNING, "only one pair,  about 2^%d keys will fit it", 48 - 32 - fixed > 0 ? 48 - 32 - fixed : 0);
+
+	hitag2_crack_opts_t opts = { NULL, threads, true };
+	hitag2_crack_stats_t stats;
+	uint64_t keys[HITAG2_CRACK_MAXKEYS];
+
+	PrintAndLogEx(NORMAL, "searching 2^%d keys with %s,  %d thread(s)", 48 - fixed, hitag2_bs_get_core()->name,
+		threads > 0 ? threads : num_CPUs());
+	int found = hitag2_crack(pairs, npairs, key, fixed, &opts, keys, HITAG2_CRACK_MAXKEYS, &stats);
+	if (found < 0) {
+		PrintAndLogEx(WARNING, "search failed");
+		return 1;
+	}
+
+	PrintAndLogEx(NORMAL, "%" PRIu64 " keys in %.1f s,  %.2f Mkeystreams/s", stats.tried, stats.msecs / 1000.0,
+		stats.msecs ? (double)stats.tried / (stats.msecs * 1000.0) : 0);
+	for (int i = 0; i < found; i++)
+		PrintAndLogEx(SUCCESS, "found key: %012" PRIx64, keys[i]);
+	if (stats.found > found)
+		PrintAndLogEx(NORMAL, "... %d more", stats.found - found);
+	if (stats.found == 0)
+		PrintAndLogEx(FAILED, "no key found%s", stats.aborted ? " before the abort" : "");
+	return stats.found ? 0 : 1;
+}
+
 static command_t CommandTable[] = {
 	{"help",	CmdHelp,           1, "This help"},
 	{"list",	CmdLFHitagList,    1, "<outfile> List Hitag trace history"},
@@ -410,6 +651,7 @@ static command_t CommandTable[] = {
 	{"snoop",	CmdLFHitagSnoop,   1, "Eavesdrop Hitag communication"},
 	{"writer",	CmdLFHitagWP,      1, "Act like a Hitag Writer" },
 	{"check_challenges",	CmdLFHitagCheckChallenges,   1, "<challenges.cc> test all challenges" },
+	{"crack",	CmdLFHitagCrack,   1, "Recover a Hitag2 key from reader authentications" },
 	{ NULL,NULL, 0, NULL }
 };
 
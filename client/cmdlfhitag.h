@@ -20,5 +20,6 @@ extern int CmdLFHitagSimS(const char *Cmd);
 extern int CmdLFHitagSnoop(const char *Cmd);
 extern int CmdLFHitagWP(const char *Cmd);
 extern int CmdLFHitagCheckChallenges(const char *Cmd);
+extern int CmdLFHitagCrack(const char *Cmd);
 
 #endif
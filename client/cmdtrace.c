@@ -11,16 +11,23 @@
 
 static int CmdHelp(const char *Cmd);
 
-// trace pointer
-static uint8_t *trace;
-long traceLen = 0;
+// trace buffer,  one session per capture
+static tracefile_t traceFile;
 bool preRDV40 = true;
 	
 int usage_trace_list(){
 	PrintAndLogEx(NORMAL, "List protocol data in trace buffer.");
-	PrintAndLogEx(NORMAL, "Usage:  trace list <protocol> [f][c| <0|1>");
+	PrintAndLogEx(NORMAL, "Usage:  trace list <protocol> [f][c][b][x][s <n>][r <first> <count>][t <from> <to>][j|v][o <file>] <0|1>");
 	PrintAndLogEx(NORMAL, "    f      - show frame delay times as well");
 	PrintAndLogEx(NORMAL, "    c      - mark CRC bytes");
+	PrintAndLogEx(NORMAL, "    s <n>  - only session n of a merged trace,  sessions are counted from 0");
+	PrintAndLogEx(NORMAL, "    r <first> <count> - only records first .. first + count - 1,  counted over all sessions");
+	PrintAndLogEx(NORMAL, "    t <from> <to>     - only records starting in [from, to),  in ticks from the session start");
+	PrintAndLogEx(NORMAL, "    b      - mf only, benchmark the auth key recovery, one thread against all");
+	PrintAndLogEx(NORMAL, "    x      - mf only, also recover the keys of hardened card sessions (minutes each)");
+	PrintAndLogEx(NORMAL, "    j      - JSON output,  an array of records");
+	PrintAndLogEx(NORMAL, "    v      - CSV output,  one line per record");
+	PrintAndLogEx(NORMAL, "    o <file> - write the listing to file instead of the console");
 	PrintAndLogEx(NORMAL, "    <0|1>  - use data from Tracebuffer, if not set, try reading data from tag.");
 	PrintAndLogEx(NORMAL, "Supported <protocol> values:");
 	PrintAndLogEx(NORMAL, "    raw    - just show raw data without annotations");
@@ -37,260 +44,90 @@ int usage_trace_list(){
 	PrintAndLogEx(NORMAL, "    7816   - interpret data as iso7816-4 communications");
 	PrintAndLogEx(NORMAL, "    legic  - interpret data as LEGIC communications");
 	PrintAndLogEx(NORMAL, "    felica - interpret data as ISO18092 / FeliCa communications");
+	PrintAndLogEx(NORMAL, "Sessions loaded with another protocol are skipped,  14a and mf go together,  raw lists all.");
 	PrintAndLogEx(NORMAL, "");
 	PrintAndLogEx(NORMAL, "Examples:");
 	PrintAndLogEx(NORMAL, "        trace list 14a f");
+	PrintAndLogEx(NORMAL, "        trace list 14a r 20000 100 1");
+	PrintAndLogEx(NORMAL, "        trace list mf s 2 t 0 5000000 1");
 	PrintAndLogEx(NORMAL, "        trace list iclass");
+	PrintAndLogEx(NORMAL, "        trace list mf b 1");
+	PrintAndLogEx(NORMAL, "        trace list mf x 1");
+	PrintAndLogEx(NORMAL, "        trace list 14a j o sniff.json 1");
 	return 0;
 }
 int usage_trace_load(){
 	PrintAndLogEx(NORMAL, "Load protocol data from file to trace buffer.");
-	PrintAndLogEx(NORMAL, "Usage:  trace load <filename>");
+	PrintAndLogEx(NORMAL, "A raw trace or an indexed .trc file,  the indexed file is mapped and not read.");
+	PrintAndLogEx(NORMAL, "Usage:  trace load <filename> [a] [<protocol>]");
+	PrintAndLogEx(NORMAL, "    a          - append as new session(s) instead of replacing the trace buffer");
+	PrintAndLogEx(NORMAL, "    <protocol> - tag the new session(s),  see trace list");
 	PrintAndLogEx(NORMAL, "Examples:");
-	PrintAndLogEx(NORMAL, "        trace lload mytracefile.bin");
+	PrintAndLogEx(NORMAL, "        trace load mytracefile.bin");
+	PrintAndLogEx(NORMAL, "        trace load othertrace.bin a iclass");
 	return 0;
 }
-int usage_trace_save(){
-	PrintAndLogEx(NORMAL, "Save protocol data from trace buffer to file.");
-	PrintAndLogEx(NORMAL, "Usage:  trace save <filename>");
+int usage_trace_stream(){
+	PrintAndLogEx(NORMAL, "Self test of the sniff stream receiver against a simulated device feed.");
+	PrintAndLogEx(NORMAL, "The feed stalls every 10000 records and loses a packet,  all records that");
+	PrintAndLogEx(NORMAL, "arrive must be whole and in order,  the dropped and lost ones counted right.");
+	PrintAndLogEx(NORMAL, "Usage:  trace stream t [<records>]");
+	PrintAndLogEx(NORMAL, "    <records> - default 100000");
 	PrintAndLogEx(NORMAL, "Examples:");
-	PrintAndLogEx(NORMAL, "        trace save mytracefile.bin");
+	PrintAndLogEx(NORMAL, "        trace stream t");
 	return 0;
 }
-
-bool is_last_record(uint16_t tracepos, uint8_t *trace, uint16_t traceLen) {
-	return(tracepos + sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t) >= traceLen);
+int usage_trace_file(){
+	PrintAndLogEx(NORMAL, "Round trip self test of the indexed trace file.  Two sessions of a synthetic");
+	PrintAndLogEx(NORMAL, "iso14443a trace are saved to <file>,  its header is checked to be little endian");
+	PrintAndLogEx(NORMAL, "byte by byte,  and the loaded trace must be the saved one.  <file> is removed.");
+	PrintAndLogEx(NORMAL, "Usage:  trace file t [<records>] [f <file>]");
+	PrintAndLogEx(NORMAL, "    <records> - default 10000");
+	PrintAndLogEx(NORMAL, "    f <file>  - default tracefile_test.trace");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "        trace file t");
+	return 0;
 }
-
-bool next_record_is_response(uint16_t tracepos, uint8_t *trace) {
-	uint16_t next_records_datalen = *((uint16_t *)(trace + tracepos + sizeof(uint32_t) + sizeof(uint16_t)));	
-	return(next_records_datalen & 0x8000);
+int usage_trace_bench(){
+	PrintAndLogEx(NORMAL, "Benchmark of the trace listing on a synthetic iso14443a trace.");
+	PrintAndLogEx(NORMAL, "Each output format is written to a temporary file with one thread and with");
+	PrintAndLogEx(NORMAL, "all threads,  the two outputs must be the same.");
+	PrintAndLogEx(NORMAL, "Usage:  trace bench [<records>] [t <threads>]");
+	PrintAndLogEx(NORMAL, "    <records>   - default 200000");
+	PrintAndLogEx(NORMAL, "    t <threads> - default the number of CPUs");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "        trace bench");
+	PrintAndLogEx(NORMAL, "        trace bench 1000000 t 4");
+	return 0;
 }
-
-bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint16_t *tracepos, uint16_t traceLen,
-								uint8_t *trace, uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
-
-#define MAX_TOPAZ_READER_CMD_LEN	16
-
-	uint32_t last_timestamp = timestamp + *duration;
-
-	if ((*data_len != 1) || (frame[0] == TOPAZ_WUPA) || (frame[0] == TOPAZ_REQA)) return false;
-
-	memcpy(topaz_reader_command, frame, *data_len);
-
-	while (!is_last_record(*tracepos, trace, traceLen) && !next_record_is_response(*tracepos, trace)) {
-		uint32_t next_timestamp = *((uint32_t *)(trace + *tracepos));
-		*tracepos += sizeof(uint32_t);
-		uint16_t next_duration = *((uint16_t *)(trace + *tracepos));
-		*tracepos += sizeof(uint16_t);
-		uint16_t next_data_len = *((uint16_t *)(trace + *tracepos)) & 0x7FFF;
-		*tracepos += sizeof(uint16_t);
-		uint8_t *next_frame = (trace + *tracepos);
-		*tracepos += next_data_len;
-		if ((next_data_len == 1) && (*data_len + next_data_len <= MAX_TOPAZ_READER_CMD_LEN)) {
-			memcpy(topaz_reader_command + *data_len, next_frame, next_data_len);
-			*data_len += next_data_len;
-			last_timestamp = next_timestamp + next_duration;
-		} else {
-			// rewind and exit
-			*tracepos = *tracepos - next_data_len - sizeof(uint16_t) - sizeof(uint16_t) - sizeof(uint32_t);
-			break;
-		}
-		uint16_t next_parity_len = (next_data_len-1)/8 + 1;
-		*tracepos += next_parity_len;
-	}
-
-	*duration = last_timestamp - timestamp;
-	
-	return true;
+int usage_trace_compact(){
+	PrintAndLogEx(NORMAL, "Benchmark of the trace record writers of LogTrace on a synthetic iso14443a sniff,");
+	PrintAndLogEx(NORMAL, "the classic record against the compact one,  with and without parity.  'classic, old'");
+	PrintAndLogEx(NORMAL, "is the byte by byte header LogTrace wrote before,  the classic writer stores the header");
+	PrintAndLogEx(NORMAL, "as two words only where the record starts on a word,  see 'aligned'.  The compact");
+	PrintAndLogEx(NORMAL, "record fits more frames at a lower write speed.  The compact trace is decoded again");
+	PrintAndLogEx(NORMAL, "and must give the classic trace.");
+	PrintAndLogEx(NORMAL, "Usage:  trace compact [<records>]");
+	PrintAndLogEx(NORMAL, "    <records> - default 1000000");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "        trace compact");
+	return 0;
 }
-
-uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes) {
-	// sanity check
-	if (tracepos + sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t) > traceLen) return traceLen;
-
-	bool isResponse;
-	uint16_t data_len, parity_len;
-	uint32_t duration, timestamp, first_timestamp, EndOfTransmissionTimestamp;
-	uint8_t topaz_reader_command[9];
-	char explanation[30] = {0};
-	uint8_t mfData[32] = {0};
-	size_t mfDataLen = 0;
-
-		
-	first_timestamp = *((uint32_t *)(trace));
-	timestamp = *((uint32_t *)(trace + tracepos));
-	tracepos += 4;
-
-	duration = *((uint16_t *)(trace + tracepos));
-	tracepos += 2;
-
-	data_len = *((uint16_t *)(trace + tracepos));
-	tracepos += 2;
-
-	if (data_len & 0x8000) {
-		data_len &= 0x7fff;
-		isResponse = true;
-	} else {
-		isResponse = false;
-	}
-	parity_len = (data_len-1)/8 + 1;
-
-	if (tracepos + data_len + parity_len > traceLen) {
-		return traceLen;
-	}
-	uint8_t *frame = trace + tracepos;
-	tracepos += data_len;
-	uint8_t *parityBytes = trace + tracepos;
-	tracepos += parity_len;
-
-	if (protocol == TOPAZ && !isResponse) {
-		// topaz reader commands come in 1 or 9 separate frames with 7 or 8 Bits each.
-		// merge them:
-		if (merge_topaz_reader_frames(timestamp, &duration, &tracepos, traceLen, trace, frame, topaz_reader_command, &data_len)) {
-			frame = topaz_reader_command;
-		}
-	}
-	
-	//Check the CRC status
-	uint8_t crcStatus = 2;
-
-	if (data_len > 2) {
-		switch (protocol) {
-			case ICLASS:
-				crcStatus = iclass_CRC_check(isResponse, frame, data_len);
-				break;
-			case ISO_14443B:
-			case TOPAZ:
-			case FELICA:
-				crcStatus = iso14443B_CRC_check(frame, data_len);
-				break;
-			case PROTO_MIFARE:
-				crcStatus = mifare_CRC_check(isResponse, frame, data_len);		
-			case ISO_14443A:
-			case MFDES:
-				crcStatus = iso14443A_CRC_check(isResponse, frame, data_len);
-				break;
-			case ISO_15693:
-				crcStatus = iso15693_CRC_check(frame, data_len);
-				break;
-			default: 
-				break;
-		}
-	}
-	//0 CRC-command, CRC not ok
-	//1 CRC-command, CRC ok
-	//2 Not crc-command
-
-	//--- Draw the data column
-	char line[18][110];
-
-	for (int j = 0; j < data_len && j/18 < 18; j++) {
-
-		uint8_t parityBits = parityBytes[j >> 3];
-		if (protocol != LEGIC &&
-			protocol != ISO_14443B && 
-			protocol != ISO_7816_4 &&
-			(isResponse || protocol == ISO_14443A) &&
-			(oddparity8(frame[j]) != ((parityBits >> (7-(j&0x0007))) & 0x01))) {
-				
-			snprintf(line[j/18]+(( j % 18) * 4),110, "%02x! ", frame[j]);
-		} else {
-			snprintf(line[j/18]+(( j % 18) * 4),110, "%02x  ", frame[j]);
-		}
-
-	}
-
-	if (markCRCBytes) {
-		//CRC-command
-		if(crcStatus == 0 || crcStatus == 1) {
-			char *pos1 = line[(data_len-2)/18]+(((data_len-2) % 18) * 4);
-			(*pos1) = '[';
-			char *pos2 = line[(data_len)/18]+(((data_len) % 18) * 4);
-			sprintf(pos2, "%c", ']');
-		}
-	}
-
-	if (data_len == 0 ) {
-		sprintf(line[0],"<empty trace - possible error>");
-		return tracepos;
-	}
-
-	// Draw the CRC column
-	char *crc = (crcStatus == 0 ? "!crc" : (crcStatus == 1 ? " ok " : "    "));
-
-	EndOfTransmissionTimestamp = timestamp + duration;
-
-	// Always annotate LEGIC read/tag
-	if ( protocol == LEGIC )
-		annotateLegic(explanation, sizeof(explanation), frame, data_len);
-
-	if ( protocol == PROTO_MIFARE )
-		annotateMifare(explanation, sizeof(explanation), frame, data_len, parityBytes, parity_len, isResponse);
-		
-	if (!isResponse)	{
-		switch(protocol) {
-			case ICLASS:		annotateIclass(explanation,sizeof(explanation),frame,data_len); break;
-			case ISO_14443A:	annotateIso14443a(explanation,sizeof(explanation),frame,data_len); break;
-			case MFDES:			annotateMfDesfire(explanation,sizeof(explanation),frame,data_len); break;
-			case ISO_14443B:	annotateIso14443b(explanation,sizeof(explanation),frame,data_len); break;
-			case TOPAZ:			annotateTopaz(explanation,sizeof(explanation),frame,data_len); break;
-			case ISO_7816_4:	annotateIso7816(explanation,sizeof(explanation),frame,data_len); break;
-			case ISO_15693:		annotateIso15693(explanation,sizeof(explanation),frame,data_len); break;
-			case FELICA:		annotateFelica(explanation,sizeof(explanation),frame,data_len); break;
-			default:			break;
-		}
-	}
-
-	int num_lines = MIN((data_len - 1)/18 + 1, 18);
-	for (int j = 0; j < num_lines ; j++) {
-		if (j == 0) {
-			PrintAndLogEx(NORMAL, " %10u | %10u | %s |%-72s | %s| %s",
-				(timestamp - first_timestamp),
-				(EndOfTransmissionTimestamp - first_timestamp),
-				(isResponse ? "Tag" : "Rdr"),
-				line[j],
-				(j == num_lines-1) ? crc : "    ",
-				(j == num_lines-1) ? explanation : "");
-		} else {
-			PrintAndLogEx(NORMAL, "            |            |     |%-72s | %s| %s",
-				line[j],
-				(j == num_lines-1) ? crc : "    ",
-				(j == num_lines-1) ? explanation : "");
-		}
-	}
-
-	if (DecodeMifareData(frame, data_len, parityBytes, isResponse, mfData, &mfDataLen)) {
-		memset(explanation, 0x00, sizeof(explanation));
-		if (!isResponse) {
-			annotateIso14443a(explanation, sizeof(explanation), mfData, mfDataLen);
-		}
-		uint8_t crcc = iso14443A_CRC_check(isResponse, mfData, mfDataLen);
-		PrintAndLogEx(NORMAL, "            |            |  *  |%-72s | %-4s| %s",
-			sprint_hex_inrow_spaces(mfData, mfDataLen, 2),
-			(crcc == 0 ? "!crc" : (crcc == 1 ? " ok " : "    ")),
-			explanation);
-	};
-
-	if (is_last_record(tracepos, trace, traceLen)) return traceLen;
-	
-	if (showWaitCycles && !isResponse && next_record_is_response(tracepos, trace)) {
-		uint32_t next_timestamp = *((uint32_t *)(trace + tracepos));
-			PrintAndLogEx(NORMAL, " %10u | %10u | %s |fdt (Frame Delay Time): %d",
-				(EndOfTransmissionTimestamp - first_timestamp),
-				(next_timestamp - first_timestamp),
-				"   ",
-				(next_timestamp - EndOfTransmissionTimestamp));
-		}
-
-	return tracepos;
+int usage_trace_save(){
+	PrintAndLogEx(NORMAL, "Save protocol data from trace buffer to file.");
+	PrintAndLogEx(NORMAL, "Usage:  trace save <filename> [c]");
+	PrintAndLogEx(NORMAL, "    c      - indexed .trc file with the sessions,  default is the raw trace");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, "        trace save mytracefile");
+	PrintAndLogEx(NORMAL, "        trace save mytracefile c");
+	return 0;
 }
 
-void printFelica(uint16_t traceLen, uint8_t *trace) {
+void printFelica(uint32_t traceLen, uint8_t *trace) {
 
 	PrintAndLogEx(NORMAL, "    Gap | Src | Data                            | CRC      | Annotation        |");
 	PrintAndLogEx(NORMAL, "--------|-----|---------------------------------|----------|-------------------|");
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
 
     while( tracepos < traceLen) {
 
@@ -404,16 +241,118 @@ static int SanityOfflineCheck( bool useTraceBuffer ){
 	return 1;
 }
 
+// first pass of the mf listing,  decoded only.  Resolves the keys of all auth sessions up to len
+static void resolveMifareTrace(uint8_t *trace, uint32_t traceLen, int threads, bool hard, TMifareTraceStats *stats) {
+	uint64_t start = msclock();
+	trace_line_t line;
+
+	MifareTraceResolve(threads, hard);
+	uint32_t tracepos = 0;
+	while (tracepos < traceLen)
+		tracepos = tracelist_decode(tracepos, traceLen, trace, PROTO_MIFARE, false, &line);
+
+	MifareTraceStats(stats);
+	stats->msecs = msclock() - start;
+}
+
+static bool getTraceProtocol(char *type, uint8_t *protocol) {
+	str_lower(type);
+	if (strcmp(type,     "iclass") == 0)	*protocol = ICLASS;
+	else if(strcmp(type, "14a") == 0)		*protocol = ISO_14443A;
+	else if(strcmp(type, "14b") == 0)		*protocol = ISO_14443B;
+	else if(strcmp(type, "topaz") == 0)		*protocol = TOPAZ;
+	else if(strcmp(type, "7816") == 0)		*protocol = ISO_7816_4;
+	else if(strcmp(type, "des") == 0)		*protocol = MFDES;
+	else if(strcmp(type, "legic") == 0)		*protocol = LEGIC;
+	else if(strcmp(type, "15") == 0)		*protocol = ISO_15693;
+	else if(strcmp(type, "felica") == 0)	*protocol = FELICA;
+	else if(strcmp(type, "mf") == 0)		*protocol = PROTO_MIFARE;
+	else if(strcmp(type, "raw") == 0)		*protocol = -1;//No crc, no annotations
+	else return false;
+	return true;
+}
+
+// sessions loaded with another protocol are not listed
+static bool matchTraceProtocol(uint32_t tag, uint8_t protocol) {
+	if (tag == TRACEFILE_PROTO_ANY || protocol == (uint8_t)-1 || tag == protocol)
+		return true;
+	bool tag14a = (tag == ISO_14443A || tag == PROTO_MIFARE);
+	bool proto14a = (protocol == ISO_14443A || protocol == PROTO_MIFARE);
+	return tag14a && proto14a;
+}
+
+// lists records [from, to) of session s.  The mf decryption needs the session
+// from its start,  the records before the window are decoded only.
+static void printTraceSession(tracelist_t *tl, uint32_t s, uint32_t from, uint32_t to, bool benchMifare, bool hardMifare, TMifareTraceStats *total) {
+	uint32_t start, end, first, last;
+	tracefile_session_bytes(&traceFile, s, &start, &end);
+	tracefile_session_range(&traceFile, s, &first, &last);
+
+	uint8_t *trace = traceFile.data + start;
+	uint32_t traceLen = end - start;
+	uint32_t tracepos = tracefile_offset(&traceFile, from) - start;
+	uint32_t stop = (to < last) ? tracefile_offset(&traceFile, to) - start : traceLen;
+	// the structured formats carry the session in each record
+	if (traceFile.nsessions > 1) {
+		char hdr[80];
+		snprintf(hdr, sizeof(hdr), "--- session %u,  records %u .. %u,  %u bytes", s, first, (last > first) ? last - 1 : first, traceLen);
+		tracelist_text(tl, hdr);
+	}
+
+	TMifareTraceStats stats = {0};
+	if (tl->protocol == PROTO_MIFARE) {
+		if (benchMifare)
+			resolveMifareTrace(trace, stop, 1, hardMifare, &stats);
+		uint64_t single = stats.msecs;
+
+		resolveMifareTrace(trace, stop, 0, hardMifare, &stats);
+		if (benchMifare && (tl->format == TRACELIST_TEXT || tl->f))
+			PrintAndLogEx(NORMAL, "auth sessions %d, nested %d, hard %d, %u nonce candidates | 1 thread %"PRIu64" ms | %d thread(s) %"PRIu64" ms | x%.1f",
+				stats.sessions, stats.nested, stats.hard, stats.candidates, single, stats.threads, stats.msecs,
+				(double)single / (stats.msecs ? stats.msecs : 1));
+		MifareTracePrint();
+
+		trace_line_t line;
+		uint32_t pos = 0;
+		while (pos < tracepos)
+			pos = tracelist_decode(pos, traceLen, trace, PROTO_MIFARE, false, &line);
+		tracepos = pos;
+	} else {
+		ClearAuthData();
+	}
+
+	uint32_t records = ((to < last) ? to : last) - from;
+	tracelist_run(tl, s, trace, traceLen, tracepos, stop, traceFile.index + from, start, records);
+
+	if (tl->protocol == PROTO_MIFARE) {
+		total->sessions += stats.sessions;
+		total->nested += stats.nested;
+		total->hard += stats.hard;
+		total->unresolved += stats.unresolved;
+		total->candidates += stats.candidates;
+		total->msecs += stats.msecs;
+		total->threads = stats.threads;
+		MifareTraceDone();
+	}
+}
+
 int CmdTraceList(const char *Cmd) {
 
 	clearCommandBuffer();
 		
 	bool showWaitCycles = false;
 	bool markCRCBytes = false;
+	bool benchMifare = false;
+	bool hardMifare = false;
 	bool isOnline = true;
 	bool errors = false;
 	uint8_t protocol = 0;
 	char type[10] = {0};
+	uint32_t session = UINT32_MAX;
+	uint32_t recFirst = 0, recCount = UINT32_MAX;
+	uint32_t timeFrom = 0, timeTo = UINT32_MAX;
+	tracelist_format_t format = TRACELIST_TEXT;
+	char filename[FILE_PATH_SIZE] = {0};
 
 	//int tlen = param_getstr(Cmd,0,type);
 	//char param1 = param_getchar(Cmd, 1);
@@ -436,6 +375,43 @@ int CmdTraceList(const char *Cmd) {
 				markCRCBytes = true;
 				cmdp++;
 				break;
+			case 'b':
+				benchMifare = true;
+				cmdp++;
+				break;
+			case 'x':
+				hardMifare = true;
+				cmdp++;
+				break;
+			case 'j':
+				format = TRACELIST_JSON;
+				cmdp++;
+				break;
+			case 'v':
+				format = TRACELIST_CSV;
+				cmdp++;
+				break;
+			case 'o':
+				errors = (param_getstr(Cmd, cmdp+1, filename, sizeof(filename)) == 0);
+				cmdp += 2;
+				break;
+			case 's':
+				session = param_get32ex(Cmd, cmdp+1, UINT32_MAX, 10);
+				errors = (session == UINT32_MAX);
+				cmdp += 2;
+				break;
+			case 'r':
+				recFirst = param_get32ex(Cmd, cmdp+1, 0, 10);
+				recCount = param_get32ex(Cmd, cmdp+2, 0, 10);
+				errors = (recCount == 0);
+				cmdp += 3;
+				break;
+			case 't':
+				timeFrom = param_get32ex(Cmd, cmdp+1, 0, 10);
+				timeTo = param_get32ex(Cmd, cmdp+2, 0, 10);
+				errors = (timeTo <= timeFrom);
+				cmdp += 3;
+				break;
 			case '0':
 				isOnline = true;
 				cmdp++;
@@ -452,21 +428,9 @@ int CmdTraceList(const char *Cmd) {
 			
 		} else {			
 			
-			str_lower(type);
-			
 			// validate type of output
-			if (strcmp(type,     "iclass") == 0)	protocol = ICLASS;
-			else if(strcmp(type, "14a") == 0)		protocol = ISO_14443A;
-			else if(strcmp(type, "14b") == 0)		protocol = ISO_14443B;
-			else if(strcmp(type, "topaz") == 0)		protocol = TOPAZ;
-			else if(strcmp(type, "7816") == 0)		protocol = ISO_7816_4;	
-			else if(strcmp(type, "des") == 0)		protocol = MFDES;
-			else if(strcmp(type, "legic") == 0)		protocol = LEGIC;
-			else if(strcmp(type, "15") == 0)		protocol = ISO_15693;
-			else if(strcmp(type, "felica") == 0)	protocol = FELICA;
-			else if(strcmp(type, "mf") == 0)		protocol = PROTO_MIFARE;
-			else if(strcmp(type, "raw") == 0)		protocol = -1;//No crc, no annotations
-			else errors = true;
+			if (!getTraceProtocol(type, &protocol))
+				errors = true;
 			
 			cmdp++;
 		}		
@@ -477,22 +441,21 @@ int CmdTraceList(const char *Cmd) {
 	//Validations
 	if (errors) return usage_trace_list();
 	
-	uint16_t tracepos = 0;
-	// reserv some space.
-	if (!trace) {
-		printf("trace pointer not allocated\n");
-		trace = calloc(USB_CMD_DATA_SIZE, sizeof(uint8_t));
-	}
-	
 	if ( isOnline ) {
 		// Query for the size of the trace,  downloading USB_CMD_DATA_SIZE
+		uint8_t *trace = calloc(USB_CMD_DATA_SIZE, sizeof(uint8_t));
+		if (!trace) {
+			PrintAndLogEx(FAILED, "Cannot allocate memory for trace");
+			return 2;
+		}
 		UsbCommand response;
 		if ( !GetFromDevice(BIG_BUF, trace, USB_CMD_DATA_SIZE, 0, &response, 4000, true)) {
 			PrintAndLogEx(WARNING, "timeout while waiting for reply.");
+			free(trace);
 			return 1;
 		}
 		
-		traceLen = response.arg[2];
+		uint32_t traceLen = response.arg[2];
 		if (traceLen > USB_CMD_DATA_SIZE) {
 			uint8_t *p = realloc(trace, traceLen);
 			if (p == NULL) {
@@ -506,88 +469,173 @@ int CmdTraceList(const char *Cmd) {
 				free(trace);
 				return 3;
 			}
-		}		
+		}
+
+		tracefile_free(&traceFile);
+		if (traceLen && tracefile_append_raw(&traceFile, trace, traceLen, TRACEFILE_PROTO_ANY)) {
+			PrintAndLogEx(FAILED, "Cannot allocate memory for trace");
+			free(trace);
+			return 2;
+		}
+		free(trace);
 	}
 
-	PrintAndLogEx(NORMAL, "Recorded Activity (TraceLen = %d bytes)", traceLen);
-	PrintAndLogEx(NORMAL, "");
+	if (session != UINT32_MAX && session >= traceFile.nsessions) {
+		PrintAndLogEx(WARNING, "no session %u, the trace has %u", session, traceFile.nsessions);
+		return 1;
+	}
+
+	// JSON and CSV on the console are the listing only
+	bool quiet = (format != TRACELIST_TEXT && protocol != FELICA && filename[0] == '\0');
+
+	if (!quiet) {
+		PrintAndLogEx(NORMAL, "Recorded Activity (TraceLen = %u bytes)", traceFile.len);
+		if (traceFile.nsessions > 1)
+			PrintAndLogEx(NORMAL, "%u records in %u sessions", traceFile.records, traceFile.nsessions);
+		PrintAndLogEx(NORMAL, "");
+	}
 	if (protocol == FELICA) {
-		printFelica(traceLen, trace);
+		for (uint32_t s = 0; s < traceFile.nsessions; s++) {
+			if ((session != UINT32_MAX && s != session) || !matchTraceProtocol(traceFile.sessions[s].protocol, protocol))
+				continue;
+			uint32_t start, end;
+			tracefile_session_bytes(&traceFile, s, &start, &end);
+			printFelica(end - start, traceFile.data + start);
+		}
 	} else { 
-		PrintAndLogEx(NORMAL, "Start = Start of Start Bit, End = End of last modulation. Src = Source of Transfer");
-		if ( protocol == ISO_14443A || protocol == PROTO_MIFARE)
-			PrintAndLogEx(NORMAL, "iso14443a - All times are in carrier periods (1/13.56Mhz)");
-		if ( protocol == ICLASS )
-			PrintAndLogEx(NORMAL, "iClass    - Timings are not as accurate");
-		if ( protocol == LEGIC )
-			PrintAndLogEx(NORMAL, "LEGIC    - Timings are in ticks (1us == 1.5ticks)");
-		if ( protocol == ISO_15693 )
-			PrintAndLogEx(NORMAL, "ISO15693 - Timings are not as accurate");
-		if ( protocol == FELICA )
-			PrintAndLogEx(NORMAL, "ISO18092 / FeliCa - Timings are not as accurate");	
-		
-		PrintAndLogEx(NORMAL, "");
-		PrintAndLogEx(NORMAL, "      Start |        End | Src | Data (! denotes parity error)                                           | CRC | Annotation");
-		PrintAndLogEx(NORMAL, "------------+------------+-----+-------------------------------------------------------------------------+-----+--------------------");
+		tracelist_t tl = {0};
+		tl.protocol = protocol;
+		tl.showWaitCycles = showWaitCycles;
+		tl.markCRCBytes = markCRCBytes;
+		tl.format = format;
+		if (filename[0]) {
+			tl.f = fopen(filename, "w");
+			if (tl.f == NULL) {
+				PrintAndLogEx(FAILED, "Cannot open file %s", filename);
+				return 1;
+			}
+		}
 
-		ClearAuthData();
-		while (tracepos < traceLen) {
-			tracepos = printTraceLine(tracepos, traceLen, trace, protocol, showWaitCycles, markCRCBytes);
+		if (!quiet) {
+			PrintAndLogEx(NORMAL, "Start = Start of Start Bit, End = End of last modulation. Src = Source of Transfer");
+			if ( protocol == ISO_14443A || protocol == PROTO_MIFARE)
+				PrintAndLogEx(NORMAL, "iso14443a - All times are in carrier periods (1/13.56Mhz)");
+			if ( protocol == ICLASS )
+				PrintAndLogEx(NORMAL, "iClass    - Timings are not as accurate");
+			if ( protocol == LEGIC )
+				PrintAndLogEx(NORMAL, "LEGIC    - Timings are in ticks (1us == 1.5ticks)");
+			if ( protocol == ISO_15693 )
+				PrintAndLogEx(NORMAL, "ISO15693 - Timings are not as accurate");
+			PrintAndLogEx(NORMAL, "");
+		}
+		tracelist_begin(&tl);
+
+		// the window,  only the index and a few timestamps are read to find it
+		uint64_t recEnd = (uint64_t)recFirst + recCount;
+		uint32_t skipped = 0;
+		TMifareTraceStats stats = {0};
+		for (uint32_t s = 0; s < traceFile.nsessions; s++) {
+			if (session != UINT32_MAX && s != session)
+				continue;
+			if (!matchTraceProtocol(traceFile.sessions[s].protocol, protocol)) {
+				skipped++;
+				continue;
+			}
+
+			uint32_t first, last;
+			tracefile_session_range(&traceFile, s, &first, &last);
+			uint32_t from = (recFirst > first) ? recFirst : first;
+			uint32_t to = (recEnd < last) ? (uint32_t)recEnd : last;
+			if (timeFrom)
+				from = MAX(from, tracefile_find_time(&traceFile, s, timeFrom));
+			if (timeTo != UINT32_MAX)
+				to = MIN(to, tracefile_find_time(&traceFile, s, timeTo));
+
+			if (from >= to)
+				continue;
+
+			printTraceSession(&tl, s, from, to, benchMifare, hardMifare, &stats);
 		}
+		tracelist_end(&tl);
+
+		if (tl.f) {
+			fclose(tl.f);
+			PrintAndLogEx(SUCCESS, "%"PRIu64" records written to %s", tl.lines, filename);
+		}
+		if (quiet)
+			return 0;
+		if (skipped)
+			PrintAndLogEx(NORMAL, "\n%u session(s) of another protocol not listed", skipped);
+		if (protocol == PROTO_MIFARE && (stats.nested || stats.hard))
+			PrintAndLogEx(NORMAL, "\n%d auth sessions, %d nested, %d hard, keys recovered in %"PRIu64" ms on %d thread(s)", stats.sessions, stats.nested, stats.hard, stats.msecs, stats.threads);
 	}
 	return 0;
 }
 
 int CmdTraceLoad(const char *Cmd) {
 	
-	FILE *f = NULL;
 	char filename[FILE_PATH_SIZE];
+	char type[10] = {0};
+	bool append = false;
+	uint32_t tag = TRACEFILE_PROTO_ANY;
 	char cmdp = param_getchar(Cmd, 0);
 	if (strlen(Cmd) < 1 || cmdp == 'h' || cmdp == 'H') return usage_trace_load();	
 	
 	param_getstr(Cmd, 0, filename, sizeof(filename));	
-	
-	if ((f = fopen(filename, "rb")) == NULL) { 
+
+	for (int i = 1; param_getchar(Cmd, i) != 0x00; i++) {
+		int slen = param_getstr(Cmd, i, type, sizeof(type));
+		uint8_t protocol;
+		if (slen == 1 && tolower(type[0]) == 'a')
+			append = true;
+		else if (getTraceProtocol(type, &protocol))
+			tag = protocol;
+		else
+			return usage_trace_load();
+	}
+
+	tracefile_t t;
+	int res = tracefile_load(&t, filename);
+	if (res == 1) {
 		PrintAndLogEx(FAILED, "Could not open file %s", filename);
 		return 0;
 	}
-	
-	// get filesize in order to malloc memory
-	fseek(f, 0, SEEK_END);
-	long fsize = ftell(f);
-	fseek(f, 0, SEEK_SET);	
-	
-	if (fsize < 0) 	{
-		PrintAndLogEx(FAILED, "error, when getting filesize");
-		fclose(f);
-		return 3;
-	}
-	if (fsize < 4 ) 	{
-		PrintAndLogEx(FAILED, "error, file is too small");
-		fclose(f);
+	if (res == 2) {
+		PrintAndLogEx(FAILED, "error, file is too small or not a trace");
 		return 4;
-	}	
-
-	if ( trace )
-		free(trace);
-
-	trace = calloc(fsize, sizeof(uint8_t));
-	if (!trace) {
+	}
+	if (res) {
 		PrintAndLogEx(FAILED, "Cannot allocate memory for trace");
-		fclose(f);		
 		return 2;
 	}
-	
-	size_t bytes_read = fread(trace, 1, fsize, f);
-	traceLen = bytes_read;
-	fclose(f);
-	PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = %d bytes) loaded from file %s", traceLen, filename);	
+
+	// a mapped file is private,  the tag is not written back
+	if (tag != TRACEFILE_PROTO_ANY)
+		for (uint32_t s = 0; s < t.nsessions; s++)
+			if (t.sessions[s].protocol == TRACEFILE_PROTO_ANY)
+				t.sessions[s].protocol = tag;
+
+	if (append && traceFile.nsessions) {
+		res = tracefile_append(&traceFile, &t);
+		tracefile_free(&t);
+		if (res) {
+			PrintAndLogEx(FAILED, "Cannot append trace, %s", (res == 2) ? "over 4 GB" : "no memory");
+			return 2;
+		}
+	} else {
+		tracefile_free(&traceFile);
+		traceFile = t;
+	}
+
+	PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = %u bytes) loaded from file %s", traceFile.len, filename);
+	if (traceFile.nsessions > 1)
+		PrintAndLogEx(SUCCESS, "%u records in %u sessions", traceFile.records, traceFile.nsessions);
 	return 0;
 }
 
 int CmdTraceSave(const char *Cmd) {
 	
-	if (traceLen == 0 ) {
+	if (traceFile.len == 0 ) {
 		PrintAndLogEx(WARNING, "trace is empty, exiting...");
 		return 0;
 	}
@@ -597,15 +645,703 @@ int CmdTraceSave(const char *Cmd) {
 	if (strlen(Cmd) < 1 || cmdp == 'h' || cmdp == 'H') return usage_trace_save();
 	
 	param_getstr(Cmd, 0, filename, sizeof(filename));		
-	saveFile(filename, "bin", trace, traceLen);
+
+	if (tolower(param_getchar(Cmd, 1)) != 'c') {
+		if (traceFile.nsessions > 1)
+			PrintAndLogEx(WARNING, "raw trace, the %u sessions are saved back to back", traceFile.nsessions);
+		saveFile(filename, "bin", traceFile.data, traceFile.len);
+		return 0;
+	}
+
+	// same naming as saveFile()
+	char *fileName = calloc(strlen(filename) + 16, sizeof(char));
+	if (!fileName) return 1;
+	int num = 1;
+	sprintf(fileName, "%s.trc", filename);
+	while (fileExists(fileName)) {
+		sprintf(fileName, "%s-%d.trc", filename, num);
+		num++;
+	}
+
+	if (tracefile_save(&traceFile, fileName))
+		PrintAndLogEx(WARNING, "file not found or locked. '%s'", fileName);
+	else
+		PrintAndLogEx(SUCCESS, "saved %u records in %u sessions to indexed file %s", traceFile.records, traceFile.nsessions, fileName);
+	free(fileName);
 	return 0;
 }
 
+// Receives a streamed sniff,  see `hf 14a sniff s`.  The records are appended to
+// a raw trace file until the device sends its end packet.
+int CmdTraceStreamReceive(const char *filename) {
+	FILE *f = fopen(filename, "ab");
+	if (!f) {
+		PrintAndLogEx(FAILED, "Could not open file %s", filename);
+		return 1;
+	}
+
+	tracefile_rx_t rx;
+	if (tracefile_rx_open(&rx, f)) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for trace");
+		fclose(f);
+		return 2;
+	}
+
+	PrintAndLogEx(INFO, "streaming the sniff to %s,  press the pm3 button to stop", filename);
+	UsbCommand resp;
+	uint64_t shown = msclock();
+	int res = 0;
+	while (res == 0) {
+		if (ukbhit()) {
+			int gc = getchar(); (void)gc;
+			PrintAndLogEx(WARNING, "\naborted via keyboard!  The device sniffs on until its button is pressed");
+			break;
+		}
+		if (!WaitForResponseTimeout(CMD_DOWNLOADED_TRACE_STREAM, &resp, 500))
+			continue;
+
+		res = tracefile_rx_feed(&rx, resp.arg[0], resp.arg[1], resp.arg[2], resp.d.asBytes);
+		if (msclock() - shown > 5000) {
+			PrintAndLogEx(NORMAL, "%u records, %u dropped", rx.records, rx.dropped);
+			shown = msclock();
+		}
+	}
+	fclose(f);
+
+	if (res < 0)
+		PrintAndLogEx(FAILED, "error, writing %s", filename);
+	PrintAndLogEx(SUCCESS, "%u records, %"PRIu64" bytes appended to %s", rx.records, rx.bytes, filename);
+	if (rx.dropped || rx.lost)
+		PrintAndLogEx(WARNING, "%u records dropped on the device,  both halves full.  %"PRIu64" bytes lost on the USB", rx.dropped, rx.lost);
+	tracefile_rx_free(&rx);
+	return 0;
+}
+
+// Self test of the receiver.  The simulated device runs the firmware side of
+// tracestream.c,  its USB stalls every 10000 records and loses one packet.
+#define STREAMTEST_SIZE		16000
+#define STREAMTEST_LOST		40
+
+static uint32_t streamTestRand(uint32_t *x) {
+	*x = *x * 1103515245 + 12345;
+	return *x >> 16;
+}
+
+// record seq of the feed,  LogTrace format with seq in the first data bytes
+static uint16_t streamTestRecord(uint32_t seq, uint8_t *rec) {
+	uint32_t x = seq * 2654435761u;
+	uint16_t len = 4 + streamTestRand(&x) % 60;
+	uint16_t plen = (len - 1) / 8 + 1;
+	uint32_t ts = seq * 1000;
+	uint16_t duration = 100;
+	uint16_t flags = len | ((seq & 1) ? 0x8000 : 0);
+
+	memcpy(rec, &ts, 4);
+	memcpy(rec + 4, &duration, 2);
+	memcpy(rec + 6, &flags, 2);
+	memcpy(rec + 8, &seq, 4);
+	for (uint16_t i = 4; i < len + plen; i++)
+		rec[8 + i] = streamTestRand(&x);
+	return 8 + len + plen;
+}
+
+// as BigBuf_trace_stream_send(),  flush sends the half being filled too
+static bool streamTestSend(tracestream_t *ts, tracefile_rx_t *rx, uint32_t *packets, bool flush) {
+	uint8_t *data;
+	uint32_t arg0, arg1, arg2;
+	if (!tracestream_next(ts, &data, &arg0, &arg1, &arg2)) {
+		if (!flush || !tracestream_flush(ts) || !tracestream_next(ts, &data, &arg0, &arg1, &arg2))
+			return false;
+	}
+	if (++*packets != STREAMTEST_LOST)
+		tracefile_rx_feed(rx, arg0, arg1, arg2, data);
+	tracestream_sent(ts);
+	return true;
+}
+
+static int traceStreamTest(uint32_t n) {
+	uint8_t *devbuf = calloc(STREAMTEST_SIZE, sizeof(uint8_t));
+	uint8_t *dropped = calloc(n, sizeof(uint8_t));
+	FILE *f = tmpfile();
+	tracefile_rx_t rx;
+	if (!devbuf || !dropped || !f || tracefile_rx_open(&rx, f)) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the test");
+		free(devbuf);
+		free(dropped);
+		if (f) fclose(f);
+		return 2;
+	}
+
+	tracestream_t ts;
+	tracestream_init(&ts, devbuf, STREAMTEST_SIZE);
+	uint8_t rec[256];
+	uint32_t packets = 0;
+	uint64_t start = msclock();
+
+	for (uint32_t seq = 0; seq < n; seq++) {
+		uint16_t len = streamTestRecord(seq, rec);
+		uint8_t *p = tracestream_reserve(&ts, len);
+		if (p)
+			memcpy(p, rec, len);
+		else
+			dropped[seq] = 1;
+
+		// one chunk per record,  nothing while the USB stalls
+		if (seq % 10000 >= 2000)
+			streamTestSend(&ts, &rx, &packets, false);
+	}
+
+	// as BigBuf_trace_stream_end()
+	while (streamTestSend(&ts, &rx, &packets, true))
+		;
+	tracefile_rx_feed(&rx, ts.offset, TRACESTREAM_END, ts.dropped, (uint8_t *)&ts.records);
+	uint64_t msecs = msclock() - start;
+
+	// the file against the feed
+	uint32_t devdropped = 0, written = 0, lostrec = 0;
+	uint64_t lostbytes = 0;
+	bool ok = true;
+	for (uint32_t seq = 0; seq < n; seq++)
+		devdropped += dropped[seq];
+
+	rewind(f);
+	uint8_t hdr[TRACEFILE_RECORD_HDR], got[256];
+	uint32_t next = 0;
+	while (ok && fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr)) {
+		uint32_t rlen = tracefile_record_len(hdr);
+		memcpy(got, hdr, sizeof(hdr));
+		if (rlen > sizeof(got) || fread(got + sizeof(hdr), 1, rlen - sizeof(hdr), f) != rlen - sizeof(hdr)) {
+			ok = false;
+			break;
+		}
+		uint32_t seq;
+		memcpy(&seq, got + 8, 4);
+		if (seq < next || seq >= n) {
+			ok = false;
+			break;
+		}
+		for (; next < seq; next++) {
+			if (dropped[next])
+				continue;
+			lostrec++;
+			lostbytes += streamTestRecord(next, rec);
+		}
+		ok = !dropped[seq] && streamTestRecord(seq, rec) == rlen && memcmp(rec, got, rlen) == 0;
+		next = seq + 1;
+		written++;
+	}
+	for (; ok && next < n; next++) {
+		if (dropped[next])
+			continue;
+		lostrec++;
+		lostbytes += streamTestRecord(next, rec);
+	}
+
+	ok = ok && written == rx.records && rx.done;
+	ok = ok && rx.dropped == devdropped && ts.dropped == devdropped;
+	ok = ok && rx.devrecords == n - devdropped && rx.lost == lostbytes && (lostrec > 0) == (packets >= STREAMTEST_LOST);
+
+	PrintAndLogEx(NORMAL, "%u records, %u dropped on the device,  %u (%"PRIu64" bytes) lost with packet %u,  %u written",
+		n, devdropped, lostrec, lostbytes, STREAMTEST_LOST, written);
+	PrintAndLogEx(NORMAL, "%u packets in %"PRIu64" ms", packets, msecs);
+	PrintAndLogEx(ok ? SUCCESS : FAILED, "sniff stream self test: %s", ok ? "ok" : "failed");
+
+	tracefile_rx_free(&rx);
+	fclose(f);
+	free(dropped);
+	free(devbuf);
+	return ok ? 0 : 1;
+}
+
+int CmdTraceStream(const char *Cmd) {
+	char cmdp = param_getchar(Cmd, 0);
+	if (tolower(cmdp) != 't') return usage_trace_stream();
+
+	uint32_t n = param_get32ex(Cmd, 1, 100000, 10);
+	if (n == 0) return usage_trace_stream();
+	return traceStreamTest(n);
+}
+
+// synthetic iso14443a card sessions:  select,  rats,  reads,  halt
+#define BENCH_EXCHANGES		9
+
+static uint32_t benchRecord(uint32_t seq, uint32_t *ts, uint8_t *rec) {
+	uint32_t x = seq * 2654435761u + 1;
+	uint8_t uid[5] = {0x04, seq >> 16, seq >> 8, seq, 0};
+	uid[4] = uid[0] ^ uid[1] ^ uid[2] ^ uid[3];
+	uint8_t *data = rec + 8;
+	uint16_t len = 0;
+	bool isResponse = seq & 1;
+	bool crc = true;
+
+	switch ((seq >> 1) % BENCH_EXCHANGES) {
+		case 0:
+			if (isResponse) { data[0] = 0x44; data[1] = 0x00; len = 2; }
+			else { data[0] = ISO14443A_CMD_REQA; len = 1; }
+			crc = false;
+			break;
+		case 1:
+			if (isResponse) { memcpy(data, uid, 5); len = 5; }
+			else { data[0] = ISO14443A_CMD_ANTICOLL_OR_SELECT; data[1] = 0x20; len = 2; }
+			crc = false;
+			break;
+		case 2:
+			if (isResponse) { data[0] = 0x20; len = 1; }
+			else { data[0] = ISO14443A_CMD_ANTICOLL_OR_SELECT; data[1] = 0x70; memcpy(data + 2, uid, 5); len = 7; }
+			break;
+		case 3:
+			if (isResponse) { memcpy(data, "\x05\x78\x80\x70\x02", 5); len = 5; }
+			else { data[0] = ISO14443A_CMD_RATS; data[1] = 0x80; len = 2; }
+			break;
+		case 8:
+			if (isResponse) { len = 0; crc = false; }
+			else { data[0] = ISO14443A_CMD_HALT; data[1] = 0x00; len = 2; }
+			break;
+		default:
+			if (isResponse) {
+				for (len = 0; len < 16; len++)
+					data[len] = (x = x * 1103515245 + 12345) >> 16;
+			} else {
+				data[0] = ISO14443A_CMD_READBLOCK;
+				data[1] = (seq >> 1) % 64;
+				len = 2;
+			}
+			break;
+	}
+	if (crc) {
+		compute_crc(CRC_14443_A, data, len, data + len, data + len + 1);
+		len += 2;
+	}
+
+	uint16_t duration = len * 8 * 128;
+	memcpy(rec, ts, 4);
+	memcpy(rec + 4, &duration, 2);
+	uint16_t tag = len | (isResponse ? 0x8000 : 0);
+	memcpy(rec + 6, &tag, 2);
+
+	// a parity error now and then
+	uint16_t parity_len = (len - 1) / 8 + 1;
+	memset(data + len, 0, parity_len);
+	for (int j = 0; j < len; j++) {
+		uint8_t p = oddparity8(data[j]) ^ (seq % 97 == 0 && j == 0);
+		data[len + j / 8] |= p << (7 - (j & 7));
+	}
+
+	*ts += duration + (isResponse ? 2000 : 1236);
+	return 8 + len + parity_len;
+}
+
+static uint64_t benchList(tracefile_t *t, tracelist_format_t format, int threads, FILE *f) {
+	tracelist_t tl = {0};
+	tl.protocol = ISO_14443A;
+	tl.showWaitCycles = true;
+	tl.format = format;
+	tl.f = f;
+	tl.threads = threads;
+
+	uint64_t start = msclock();
+	tracelist_begin(&tl);
+	tracelist_run(&tl, 0, t->data, t->len, 0, t->len, t->index, 0, t->records);
+	tracelist_end(&tl);
+	return msclock() - start;
+}
+
+static bool benchSameFiles(FILE *a, FILE *b) {
+	uint8_t bufa[4096], bufb[4096];
+	rewind(a);
+	rewind(b);
+	for (;;) {
+		size_t na = fread(bufa, 1, sizeof(bufa), a);
+		size_t nb = fread(bufb, 1, sizeof(bufb), b);
+		if (na != nb || memcmp(bufa, bufb, na))
+			return false;
+		if (na == 0)
+			return true;
+	}
+}
+
+int CmdTraceBench(const char *Cmd) {
+	uint32_t n = 200000;
+	int threads = num_CPUs();
+	bool errors = false;
+
+	uint8_t cmdp = 0;
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+			case 'h':
+				return usage_trace_bench();
+			case 't':
+				threads = param_get32ex(Cmd, cmdp+1, 0, 10);
+				errors = (threads <= 0 || threads > 256);
+				cmdp += 2;
+				break;
+			default:
+				n = param_get32ex(Cmd, cmdp, 0, 10);
+				errors = (n == 0 || n > 5000000);
+				cmdp++;
+				break;
+		}
+	}
+	if (errors) return usage_trace_bench();
+
+	// about 20 bytes a record
+	uint8_t *buf = calloc(n, 32);
+	if (buf == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the trace");
+		return 2;
+	}
+	uint32_t len = 0, ts = 0;
+	for (uint32_t seq = 0; seq < n; seq++)
+		len += benchRecord(seq, &ts, buf + len);
+
+	tracefile_t t = {0};
+	int res = tracefile_append_raw(&t, buf, len, ISO_14443A);
+	free(buf);
+	if (res) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the trace");
+		return 2;
+	}
+
+	PrintAndLogEx(NORMAL, "Listing %u iso14443a records,  %u bytes,  1 thread against %d", t.records, t.len, threads);
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "format |    output | 1 thread | %2d thread(s) | speedup | records/s", threads);
+	PrintAndLogEx(NORMAL, "-------+-----------+----------+--------------+---------+----------");
+
+	static const char *names[] = {"text", "json", "csv"};
+	bool ok = true;
+	for (int format = TRACELIST_TEXT; format <= TRACELIST_CSV; format++) {
+		FILE *single = tmpfile();
+		FILE *multi = tmpfile();
+		if (single == NULL || multi == NULL) {
+			PrintAndLogEx(FAILED, "Cannot open a temporary file");
+			if (single) fclose(single);
+			if (multi) fclose(multi);
+			ok = false;
+			break;
+		}
+
+		uint64_t ms1 = benchList(&t, format, 1, single);
+		uint64_t msn = benchList(&t, format, threads, multi);
+		long size = ftell(single);
+		bool same = benchSameFiles(single, multi);
+		ok = ok && same;
+
+		PrintAndLogEx(NORMAL, "%-6s | %6ld kB | %5"PRIu64" ms | %9"PRIu64" ms |   x%4.1f | %9.0f%s",
+			names[format], size / 1024, ms1, msn,
+			(double)ms1 / (msn ? msn : 1),
+			(double)t.records * 1000 / (msn ? msn : 1),
+			same ? "" : "  output differs");
+		fclose(single);
+		fclose(multi);
+	}
+	tracefile_free(&t);
+
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(ok ? SUCCESS : FAILED, "trace listing bench: %s", ok ? "ok" : "failed");
+	return ok ? 0 : 1;
+}
+
+static uint64_t fileTestGet(const uint8_t *p, int n) {
+	uint64_t v = 0;
+	while (n--)
+		v = v << 8 | p[n];
+	return v;
+}
+
+int CmdTraceFile(const char *Cmd) {
+	char filename[FILE_PATH_SIZE] = "tracefile_test.trace";
+	uint32_t n = 10000;
+	bool errors = tolower(param_getchar(Cmd, 0)) != 't';
+
+	uint8_t cmdp = 1;
+	while (param_getchar(Cmd, cmdp) != 0x00 && !errors) {
+		switch (tolower(param_getchar(Cmd, cmdp))) {
+			case 'f':
+				errors = param_getstr(Cmd, cmdp+1, filename, sizeof(filename)) == 0;
+				cmdp += 2;
+				break;
+			default:
+				n = param_get32ex(Cmd, cmdp, 0, 10);
+				errors = (n < 2 || n > 5000000);
+				cmdp++;
+				break;
+		}
+	}
+	if (errors) return usage_trace_file();
+
+	uint8_t *buf = calloc(n, 32);
+	if (buf == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the trace");
+		return 2;
+	}
+	uint32_t len = 0, half = 0, ts = 0;
+	for (uint32_t seq = 0; seq < n; seq++) {
+		if (seq == n / 2)
+			half = len;
+		len += benchRecord(seq, &ts, buf + len);
+	}
+
+	tracefile_t t = {0}, l = {0};
+	int res = tracefile_append_raw(&t, buf, half, ISO_14443A);
+	if (res == 0)
+		res = tracefile_append_raw(&t, buf + half, len - half, TRACEFILE_PROTO_ANY);
+	free(buf);
+	if (res) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the trace");
+		tracefile_free(&t);
+		return 2;
+	}
+	if (tracefile_save(&t, filename)) {
+		PrintAndLogEx(FAILED, "Cannot write %s", filename);
+		tracefile_free(&t);
+		return 1;
+	}
+
+	// the header and first session as written,  little endian whatever the host
+	uint8_t hdr[56] = {0};
+	FILE *f = fopen(filename, "rb");
+	bool ok = f && fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr);
+	if (f) fclose(f);
+	ok = ok && memcmp(hdr, TRACEFILE_MAGIC, 8) == 0 && fileTestGet(hdr + 8, 4) == TRACEFILE_VERSION;
+	ok = ok && fileTestGet(hdr + 12, 4) == 2 && fileTestGet(hdr + 16, 8) == t.records && fileTestGet(hdr + 24, 8) == t.len;
+	ok = ok && fileTestGet(hdr + 32, 8) == 0 && fileTestGet(hdr + 40, 8) == 0 && fileTestGet(hdr + 48, 4) == ISO_14443A;
+	PrintAndLogEx(ok ? SUCCESS : FAILED, "header: %s", ok ? "little endian" : "differs");
+
+	res = tracefile_load(&l, filename);
+	bool same = res == 0 && l.nsessions == t.nsessions && l.records == t.records && l.len == t.len;
+	same = same && memcmp(l.data, t.data, t.len) == 0 && memcmp(l.index, t.index, t.records * sizeof(uint64_t)) == 0;
+	for (uint32_t s = 0; same && s < t.nsessions; s++)
+		same = l.sessions[s].record == t.sessions[s].record && l.sessions[s].offset == t.sessions[s].offset
+			&& l.sessions[s].protocol == t.sessions[s].protocol;
+	for (uint32_t s = 0; same && s < t.nsessions; s++) {
+		uint32_t first, end;
+		tracefile_session_range(&l, s, &first, &end);
+		same = tracefile_find_time(&l, s, tracefile_timestamp(&l, end - 1) - tracefile_timestamp(&l, first)) == end - 1;
+	}
+	PrintAndLogEx(same ? SUCCESS : FAILED, "%u records,  %u bytes in %u sessions:  %s", t.records, t.len, t.nsessions,
+		same ? "loaded as saved" : "loaded trace differs");
+	ok = ok && same;
+
+	tracefile_free(&l);
+	tracefile_free(&t);
+	remove(filename);
+	PrintAndLogEx(ok ? SUCCESS : FAILED, "trace file self test: %s", ok ? "ok" : "failed");
+	return ok ? 0 : 1;
+}
+
+// the LogTrace() arguments of a bench record
+typedef struct {
+	const uint8_t *data;
+	const uint8_t *parity;
+	uint32_t start;
+	uint16_t duration;
+	uint16_t len;
+	bool readerToTag;
+} compactFrame_t;
+
+#define COMPACT_BIGBUF		40000	// BIGBUF_SIZE,  the trace gets a bit less
+
+#define COMPACT_OLD			0		// the classic record byte by byte,  as LogTrace wrote it before
+#define COMPACT_CLASSIC		1
+#define COMPACT_COMPACT		2
+
+static uint8_t *compactOldPut(uint8_t *p, const uint8_t *data, uint16_t len, uint32_t start, uint16_t duration, const uint8_t *parity, bool readerToTag) {
+	*p++ = start;
+	*p++ = start >> 8;
+	*p++ = start >> 16;
+	*p++ = start >> 24;
+	*p++ = duration;
+	*p++ = duration >> 8;
+	*p++ = len;
+	*p++ = len >> 8;
+	if (!readerToTag)
+		p[-1] |= 0x80;
+
+	if (data != NULL && len != 0)
+		memcpy(p, data, len);
+	p += len;
+
+	uint16_t num_paritybytes = tracelog_paritybytes(len);
+	if (parity != NULL)
+		memcpy(p, parity, num_paritybytes);
+	else
+		memset(p, 0x00, num_paritybytes);
+	return p + num_paritybytes;
+}
+
+// writes all frames into a BigBuf sized buffer,  starting again when it is full,
+// with the room check of LogTrace.  Returns the bytes written,  fits is the number
+// of frames of the first fill,  aligned the records starting on a word.
+static uint64_t compactWrite(const compactFrame_t *frames, uint32_t n, int writer, bool parity, uint32_t *buf, uint32_t *fits, uint32_t *aligned) {
+	uint8_t *start = (uint8_t *)buf;
+	uint8_t *p = start;
+	uint32_t last = 0;
+	uint64_t total = 0;
+	*fits = 0;
+	*aligned = 0;
+
+	for (uint32_t i = 0; i < n; i++) {
+		const compactFrame_t *f = &frames[i];
+		uint16_t hdr = TRACELOG_HDR;
+		if (writer == COMPACT_COMPACT)
+			hdr = (p == start ? TRACECOMPACT_MAGIC_LEN : 0) + TRACECOMPACT_MAX_HDR;
+		uint16_t room = hdr + f->len + tracelog_paritybytes(f->len);
+		if (p - start + room >= COMPACT_BIGBUF) {
+			if (*fits == 0)
+				*fits = i;
+			total += p - start;
+			p = start;
+		}
+		*aligned += ((p - start) & 3) == 0;
+		if (writer == COMPACT_COMPACT) {
+			if (p == start) {
+				memcpy(p, TRACECOMPACT_MAGIC, TRACECOMPACT_MAGIC_LEN);
+				p += TRACECOMPACT_MAGIC_LEN;
+				last = 0;
+			}
+			p = tracecompact_put(p, &last, f->data, f->len, f->start, f->duration, parity ? f->parity : NULL, f->readerToTag);
+		} else if (writer == COMPACT_CLASSIC) {
+			p = tracelog_put(p, f->data, f->len, f->start, f->duration, parity ? f->parity : NULL, f->readerToTag);
+		} else {
+			p = compactOldPut(p, f->data, f->len, f->start, f->duration, parity ? f->parity : NULL, f->readerToTag);
+		}
+	}
+	if (*fits == 0)
+		*fits = n;
+	return total + (p - start);
+}
+
+int CmdTraceCompact(const char *Cmd) {
+	char ctmp = param_getchar(Cmd, 0);
+	if (ctmp == 'h' || ctmp == 'H') return usage_trace_compact();
+
+	uint32_t n = param_get32ex(Cmd, 0, 1000000, 10);
+	if (n == 0 || n > 5000000) return usage_trace_compact();
+
+	// the bench trace of trace bench,  classic
+	uint8_t *classic = calloc(n, 32);
+	compactFrame_t *frames = calloc(n, sizeof(compactFrame_t));
+	uint32_t *bigbuf = calloc(COMPACT_BIGBUF / sizeof(uint32_t), sizeof(uint32_t));
+	if (!classic || !frames || !bigbuf) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the bench");
+		free(classic);
+		free(frames);
+		free(bigbuf);
+		return 2;
+	}
+	uint32_t len = 0, ts = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		uint8_t *rec = classic + len;
+		len += benchRecord(i, &ts, rec);
+		uint16_t lenflag = rec[6] | rec[7] << 8;
+		frames[i].start = rec[0] | rec[1] << 8 | rec[2] << 16 | (uint32_t)rec[3] << 24;
+		frames[i].duration = rec[4] | rec[5] << 8;
+		frames[i].len = lenflag & 0x7FFF;
+		frames[i].readerToTag = !(lenflag & 0x8000);
+		frames[i].data = rec + TRACELOG_HDR;
+		frames[i].parity = rec + TRACELOG_HDR + frames[i].len;
+	}
+
+	PrintAndLogEx(NORMAL, "%u iso14443a frames,  written over and over to a %u bytes BigBuf", n, COMPACT_BIGBUF);
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "record          | frames/s | aligned | bytes/frame | frames/kB | frames in BigBuf");
+	PrintAndLogEx(NORMAL, "----------------+----------+---------+-------------+-----------+-----------------");
+
+	static const struct {
+		const char *name;
+		int writer;
+		bool parity;
+	} writers[] = {
+		{"classic, old", COMPACT_OLD, true},
+		{"classic", COMPACT_CLASSIC, true},
+		{"classic, no par", COMPACT_CLASSIC, false},
+		{"compact", COMPACT_COMPACT, true},
+		{"compact, no par", COMPACT_COMPACT, false},
+	};
+	for (int i = 0; i < (int)(sizeof(writers) / sizeof(writers[0])); i++) {
+		uint32_t fits = 0, aligned = 0;
+		uint64_t bytes = 0;
+		uint32_t rounds = 0;
+		uint64_t start = msclock();
+		// at least a quarter second
+		do {
+			bytes = compactWrite(frames, n, writers[i].writer, writers[i].parity, bigbuf, &fits, &aligned);
+			rounds++;
+		} while (msclock() - start < 250);
+		uint64_t msecs = msclock() - start;
+
+		char align[8] = "-";
+		if (writers[i].writer == COMPACT_CLASSIC)
+			snprintf(align, sizeof(align), "%.0f%%", 100.0 * aligned / n);
+		PrintAndLogEx(NORMAL, "%-15s | %7.1fM | %7s | %11.2f | %9.1f | %16u",
+			writers[i].name,
+			(double)n * rounds / (msecs ? msecs : 1) / 1000,
+			align,
+			(double)bytes / n,
+			(double)n * 1024 / bytes,
+			fits);
+	}
+
+	// round trip,  the whole trace compact and decoded again
+	bool ok = false;
+	uint8_t *packed = malloc(TRACECOMPACT_MAGIC_LEN + (uint64_t)n * (TRACECOMPACT_MAX_HDR + 32));
+	uint8_t *decoded = malloc(len);
+	if (packed && decoded) {
+		uint8_t *p = packed;
+		uint32_t last = 0;
+		memcpy(p, TRACECOMPACT_MAGIC, TRACECOMPACT_MAGIC_LEN);
+		p += TRACECOMPACT_MAGIC_LEN;
+		// LogTrace keeps TRACECOMPACT_MAX_HDR + len + parity bytes of room for a record
+		bool room = true;
+		for (uint32_t i = 0; i < n; i++) {
+			uint8_t *rec = p;
+			p = tracecompact_put(p, &last, frames[i].data, frames[i].len, frames[i].start, frames[i].duration, frames[i].parity, frames[i].readerToTag);
+			room = room && p - rec <= TRACECOMPACT_MAX_HDR + frames[i].len + tracelog_paritybytes(frames[i].len);
+		}
+		// and the longest header,  the longest frame with raw parity after the longest pause
+		uint16_t wpar = tracelog_paritybytes(0x7FFF);
+		uint8_t *worst = malloc(TRACECOMPACT_MAX_HDR + 0x7FFF + wpar);
+		uint8_t *par = malloc(wpar);
+		if (worst && par) {
+			uint32_t wlast = 0;
+			memset(par, 0xFF, wpar);
+			uint8_t *end = tracecompact_put(worst, &wlast, NULL, 0x7FFF, 0xFFFFFFFF, 0xFFFF, par, false);
+			room = room && end - worst == TRACECOMPACT_MAX_HDR + 0x7FFF + wpar;
+		}
+		free(worst);
+		free(par);
+		uint32_t packedlen = p - packed;
+
+		uint64_t start = msclock();
+		uint32_t declen = tracecompact_decode(packed, packedlen, decoded);
+		uint64_t msecs = msclock() - start;
+		ok = room && tracecompact_is(packed, packedlen) && declen == len && memcmp(decoded, classic, len) == 0;
+		// a cut record is left out
+		ok = ok && tracecompact_decode(packed, packedlen - 1, NULL) < len;
+
+		PrintAndLogEx(NORMAL, "");
+		PrintAndLogEx(NORMAL, "whole trace %u bytes,  compact %u bytes (%.0f%%),  decoded in %"PRIu64" ms",
+			len, packedlen, 100.0 * packedlen / len, msecs);
+	}
+	PrintAndLogEx(ok ? SUCCESS : FAILED, "compact trace round trip: %s", ok ? "ok" : "failed");
+
+	free(packed);
+	free(decoded);
+	free(classic);
+	free(frames);
+	free(bigbuf);
+	return ok ? 0 : 1;
+}
+
 static command_t CommandTable[] = {
 	{"help",	CmdHelp,          1, "This help"},
 	{"list",    CmdTraceList,     0, "List protocol data in trace buffer"},	
 	{"load",	CmdTraceLoad,     0, "Load trace from file"},
 	{"save",	CmdTraceSave,     0, "Save trace buffer to file"},
+	{"stream",	CmdTraceStream,   1, "Sniff stream receiver self test"},
+	{"file",	CmdTraceFile,     1, "Indexed trace file round trip self test"},
+	{"bench",	CmdTraceBench,    1, "Benchmark of the listing formats"},
+	{"compact",	CmdTraceCompact,  1, "Benchmark of the compact trace records"},
 	{NULL, NULL, 0, NULL}
 };
 
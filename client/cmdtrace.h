@@ -26,15 +26,28 @@
 #include "cmdparser.h"		// for getting cli commands included in cmdmain.h
 #include "cmdmain.h"		// for sending cmds to device. GetFromBigBuf
 #include "loclass/fileutils.h"		// for saveFile
+#include "tracefile.h"			// indexed trace files
+#include "tracestream.h"		// sniff streaming
+#include "tracecompact.h"		// trace record writers
+#include "tracelist.h"		// listing,  text / JSON / CSV
 
 extern int CmdTrace(const char *Cmd);
 
 extern int CmdTraceList(const char *Cmd);
 extern int CmdTraceLoad(const char *Cmd);
 extern int CmdTraceSave(const char *Cmd);
+extern int CmdTraceStream(const char *Cmd);
+extern int CmdTraceStreamReceive(const char *filename);
+extern int CmdTraceFile(const char *Cmd);
+extern int CmdTraceBench(const char *Cmd);
+extern int CmdTraceCompact(const char *Cmd);
 
 // usages helptext
 extern int usage_trace_list(void);					 
 extern int usage_trace_load(void);
 extern int usage_trace_save(void);
+extern int usage_trace_stream(void);
+extern int usage_trace_file(void);
+extern int usage_trace_bench(void);
+extern int usage_trace_compact(void);
 #endif
@@ -0,0 +1,117 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Table driven CRC engine
+//-----------------------------------------------------------------------------
+#include "crcengine.h"
+
+#include <stdlib.h>
+
+static crcengine_table_t *tables = NULL;
+
+uint64_t crcengine_reflect(uint64_t v, uint8_t width) {
+	uint64_t r = 0;
+	for (uint8_t i = 0; i < width; i++, v >>= 1)
+		r = (r << 1) | (v & 1);
+	return r;
+}
+
+static void crcengine_build(crcengine_table_t *tbl) {
+	if (tbl->reflected) {
+		uint64_t p = crcengine_reflect(tbl->poly, tbl->width);
+		for (int b = 0; b < 256; b++) {
+			uint64_t r = b;
+			for (int i = 0; i < 8; i++)
+				r = (r & 1) ? (r >> 1) ^ p : r >> 1;
+			tbl->t[0][b] = r;
+		}
+		for (int k = 1; k < 8; k++)
+			for (int b = 0; b < 256; b++)
+				tbl->t[k][b] = (tbl->t[k - 1][b] >> 8) ^ tbl->t[0][tbl->t[k - 1][b] & 0xff];
+	} else {
+		// register is kept left aligned in 64 bits,  so every width shares the same loop
+		uint64_t p = tbl->poly << (64 - tbl->width);
+		for (int b = 0; b < 256; b++) {
+			uint64_t r = (uint64_t)b << 56;
+			for (int i = 0; i < 8; i++)
+				r = (r >> 63) ? (r << 1) ^ p : r << 1;
+			tbl->t[0][b] = r;
+		}
+		for (int k = 1; k < 8; k++)
+			for (int b = 0; b < 256; b++)
+				tbl->t[k][b] = (tbl->t[k - 1][b] << 8) ^ tbl->t[0][tbl->t[k - 1][b] >> 56];
+	}
+}
+
+const crcengine_table_t *crcengine_table(uint8_t width, uint64_t poly, bool reflected) {
+	if (width == 0 || width > CRCENGINE_MAX_WIDTH)
+		return NULL;
+
+	if (width < 64)
+		poly &= (1ULL << width) - 1;
+
+	for (crcengine_table_t *tbl = tables; tbl; tbl = tbl->next)
+		if (tbl->width == width && tbl->poly == poly && tbl->reflected == reflected)
+			return tbl;
+
+	crcengine_table_t *tbl = calloc(1, sizeof(crcengine_table_t));
+	if (!tbl) return NULL;
+	tbl->width = width;
+	tbl->poly = poly;
+	tbl->reflected = reflected;
+	crcengine_build(tbl);
+	tbl->next = tables;
+	tables = tbl;
+	return tbl;
+}
+
+void crcengine_free(void) {
+	while (tables) {
+		crcengine_table_t *next = tables->next;
+		free(tables);
+		tables = next;
+	}
+}
+
+static inline uint64_t load_le64(const uint8_t *p) {
+	return (uint64_t)p[0]       | (uint64_t)p[1] << 8  | (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+	       (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 | (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+}
+
+static inline uint64_t load_be64(const uint8_t *p) {
+	return (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 | (uint64_t)p[2] << 40 | (uint64_t)p[3] << 32 |
+	       (uint64_t)p[4] << 24 | (uint64_t)p[5] << 16 | (uint64_t)p[6] << 8  | (uint64_t)p[7];
+}
+
+uint64_t crcengine_calc(const crcengine_table_t *tbl, uint64_t init, const uint8_t *data, size_t len) {
+	uint8_t w = tbl->width;
+	const uint64_t (*t)[256] = tbl->t;
+
+	if (tbl->reflected) {
+		uint64_t reg = crcengine_reflect(init, w);
+		for (; len >= 8; len -= 8, data += 8) {
+			uint64_t x = reg ^ load_le64(data);
+			reg = t[7][x & 0xff]         ^ t[6][(x >> 8) & 0xff]  ^
+			      t[5][(x >> 16) & 0xff] ^ t[4][(x >> 24) & 0xff] ^
+			      t[3][(x >> 32) & 0xff] ^ t[2][(x >> 40) & 0xff] ^
+			      t[1][(x >> 48) & 0xff] ^ t[0][x >> 56];
+		}
+		while (len--)
+			reg = (reg >> 8) ^ t[0][(reg ^ *data++) & 0xff];
+		return crcengine_reflect(reg, w);
+	}
+
+	uint64_t reg = init << (64 - w);
+	for (; len >= 8; len -= 8, data += 8) {
+		uint64_t x = reg ^ load_be64(data);
+		reg = t[7][x >> 56]          ^ t[6][(x >> 48) & 0xff] ^
+		      t[5][(x >> 40) & 0xff] ^ t[4][(x >> 32) & 0xff] ^
+		      t[3][(x >> 24) & 0xff] ^ t[2][(x >> 16) & 0xff] ^
+		      t[1][(x >> 8) & 0xff]  ^ t[0][x & 0xff];
+	}
+	while (len--)
+		reg = (reg << 8) ^ t[0][(reg >> 56) ^ *data++];
+	return reg >> (64 - w);
+}
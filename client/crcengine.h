@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Table driven CRC engine for widths up to 64 bits.
+// Slice-by-8 over byte input,  MSB first (normal) or LSB first (reflected).
+// Values are given and returned in normal form,  i.e. the way reveng holds
+// them in a poly_t: poly without the x^width term,  init and xorout aligned
+// to the top of the register.
+//-----------------------------------------------------------------------------
+
+#ifndef CRCENGINE_H__
+#define CRCENGINE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define CRCENGINE_MAX_WIDTH 64
+
+typedef struct crcengine_table {
+	uint8_t width;
+	bool reflected;                 // process the bits of each byte LSB first
+	uint64_t poly;
+	uint64_t t[8][256];
+	struct crcengine_table *next;
+} crcengine_table_t;
+
+// returns a cached table for width/poly,  NULL if width is not supported
+const crcengine_table_t *crcengine_table(uint8_t width, uint64_t poly, bool reflected);
+void crcengine_free(void);
+
+// CRC register after feeding data into init,  normal form,  no xorout.
+// With a reflected table every data byte is taken bit reversed.
+uint64_t crcengine_calc(const crcengine_table_t *tbl, uint64_t init, const uint8_t *data, size_t len);
+
+// reverse the low width bits of v
+uint64_t crcengine_reflect(uint64_t v, uint8_t width);
+
+#endif
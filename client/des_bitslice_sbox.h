@@ -0,0 +1,862 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// DES S-boxes as gates for the bitsliced DES.  Generated, do not edit:
+//   python tools/des_bitslice_sbox.py > client/des_bitslice_sbox.h
+// in[0..5] are S-box inputs b1..b6,  out[0..3] the outputs,  msb first.
+//-----------------------------------------------------------------------------
+
+#ifndef DES_BITSLICE_SBOX_H__
+#define DES_BITSLICE_SBOX_H__
+
+// 108 gates
+static inline void des_bs_s1(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[0], x1 = in[5], x2 = in[3], x3 = in[2], x4 = in[1], x5 = in[4];
+	const bs_t t0 = ~x5;
+	const bs_t t1 = t0 ^ x4;
+	const bs_t t2 = ~x4;
+	const bs_t t3 = t2 & x3;
+	const bs_t t4 = t1 ^ t3;
+	const bs_t t5 = x5 & x3;
+	const bs_t t6 = t1 ^ t5;
+	const bs_t t7 = t4 ^ t6;
+	const bs_t t8 = t7 & x2;
+	const bs_t t9 = t4 ^ t8;
+	const bs_t t10 = ~t4;
+	const bs_t t11 = t0 & x3;
+	const bs_t t12 = x4 ^ t11;
+	const bs_t t13 = t10 ^ t12;
+	const bs_t t14 = t13 & x2;
+	const bs_t t15 = t10 ^ t14;
+	const bs_t t16 = t9 ^ t15;
+	const bs_t t17 = t16 & x1;
+	const bs_t t18 = t9 ^ t17;
+	const bs_t t19 = t0 | ~x4;
+	const bs_t t20 = x5 & ~x4;
+	const bs_t t21 = t19 ^ t11;
+	const bs_t t22 = t12 ^ t21;
+	const bs_t t23 = t22 & x2;
+	const bs_t t24 = t12 ^ t23;
+	const bs_t t25 = ~t1;
+	const bs_t t26 = ~t20;
+	const bs_t t27 = t26 & x3;
+	const bs_t t28 = t22 ^ t27;
+	const bs_t t29 = ~t19;
+	const bs_t t30 = t1 ^ t29;
+	const bs_t t31 = t30 & x3;
+	const bs_t t32 = t1 ^ t31;
+	const bs_t t33 = t28 ^ t32;
+	const bs_t t34 = t33 & x2;
+	const bs_t t35 = t28 ^ t34;
+	const bs_t t36 = t24 ^ t35;
+	const bs_t t37 = t36 & x1;
+	const bs_t t38 = t24 ^ t37;
+	const bs_t t39 = t18 ^ t38;
+	const bs_t t40 = t39 & x0;
+	const bs_t t41 = t18 ^ t40;
+	const bs_t t42 = ~t12;
+	const bs_t t43 = t26 ^ t11;
+	const bs_t t44 = ~t30;
+	const bs_t t45 = t44 & x2;
+	const bs_t t46 = t42 ^ t45;
+	const bs_t t47 = x5 ^ t3;
+	const bs_t t48 = t25 & x3;
+	const bs_t t49 = t19 ^ t48;
+	const bs_t t50 = t43 & x2;
+	const bs_t t51 = t47 ^ t50;
+	const bs_t t52 = t46 ^ t51;
+	const bs_t t53 = t52 & x1;
+	const bs_t t54 = t46 ^ t53;
+	const bs_t t55 = t44 & x3;
+	const bs_t t56 = t26 ^ t55;
+	const bs_t t57 = ~t22;
+	const bs_t t58 = t1 ^ t27;
+	const bs_t t59 = t56 ^ t58;
+	const bs_t t60 = t59 & x2;
+	const bs_t t61 = t56 ^ t60;
+	const bs_t t62 = t49 ^ x2;
+	const bs_t t63 = t61 ^ t62;
+	const bs_t t64 = t63 & x1;
+	const bs_t t65 = t61 ^ t64;
+	const bs_t t66 = t54 ^ t65;
+	const bs_t t67 = t66 & x0;
+	const bs_t t68 = t54 ^ t67;
+	const bs_t t70 = t4 & x2;
+	const bs_t t71 = t56 ^ t70;
+	const bs_t t72 = t44 ^ t27;
+	const bs_t t73 = t19 & x2;
+	const bs_t t74 = t72 ^ t73;
+	const bs_t t75 = t71 ^ t74;
+	const bs_t t76 = t75 & x1;
+	const bs_t t77 = t71 ^ t76;
+	const bs_t t78 = t57 ^ t5;
+	const bs_t t79 = t26 & x2;
+	const bs_t t80 = t78 ^ t79;
+	const bs_t t83 = t21 & x2;
+	const bs_t t84 = t58 ^ t83;
+	const bs_t t85 = t80 ^ t84;
+	const bs_t t86 = t85 & x1;
+	const bs_t t87 = t80 ^ t86;
+	const bs_t t88 = t77 ^ t87;
+	const bs_t t89 = t88 & x0;
+	const bs_t t90 = t77 ^ t89;
+	const bs_t t91 = t2 ^ t5;
+	const bs_t t92 = t78 ^ t73;
+	const bs_t t93 = ~t56;
+	const bs_t t95 = t93 ^ t23;
+	const bs_t t96 = t92 ^ t95;
+	const bs_t t97 = t96 & x1;
+	const bs_t t98 = t92 ^ t97;
+	const bs_t t99 = ~t91;
+	const bs_t t100 = t10 ^ t99;
+	const bs_t t101 = t100 & x2;
+	const bs_t t102 = t10 ^ t101;
+	const bs_t t103 = t26 ^ x3;
+	const bs_t t105 = t1 & x2;
+	const bs_t t106 = t103 ^ t105;
+	const bs_t t107 = t102 ^ t106;
+	const bs_t t108 = t107 & x1;
+	const bs_t t109 = t102 ^ t108;
+	const bs_t t110 = t98 ^ t109;
+	const bs_t t111 = t110 & x0;
+	const bs_t t112 = t98 ^ t111;
+	out[0] = t41;
+	out[1] = t68;
+	out[2] = t90;
+	out[3] = t112;
+}
+
+// 99 gates
+static inline void des_bs_s2(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[1], x1 = in[0], x2 = in[3], x3 = in[5], x4 = in[2], x5 = in[4];
+	const bs_t t0 = ~x5;
+	const bs_t t1 = t0 ^ x4;
+	const bs_t t2 = t1 ^ x3;
+	const bs_t t3 = ~x4;
+	const bs_t t5 = x5 & x2;
+	const bs_t t6 = t2 ^ t5;
+	const bs_t t7 = ~t1;
+	const bs_t t8 = x5 | ~x4;
+	const bs_t t9 = t7 ^ t8;
+	const bs_t t10 = t9 & x3;
+	const bs_t t11 = t7 ^ t10;
+	const bs_t t12 = t0 & ~x4;
+	const bs_t t13 = t7 ^ t12;
+	const bs_t t14 = t13 & x3;
+	const bs_t t15 = t7 ^ t14;
+	const bs_t t16 = t11 ^ t15;
+	const bs_t t17 = t16 & x2;
+	const bs_t t18 = t11 ^ t17;
+	const bs_t t19 = t6 ^ t18;
+	const bs_t t20 = t19 & x1;
+	const bs_t t21 = t6 ^ t20;
+	const bs_t t22 = x4 & x3;
+	const bs_t t23 = t0 ^ t22;
+	const bs_t t24 = t23 ^ x2;
+	const bs_t t25 = t15 ^ x2;
+	const bs_t t26 = t24 ^ t25;
+	const bs_t t27 = t26 & x1;
+	const bs_t t28 = t24 ^ t27;
+	const bs_t t29 = t21 ^ t28;
+	const bs_t t30 = t29 & x0;
+	const bs_t t31 = t21 ^ t30;
+	const bs_t t32 = t3 & x3;
+	const bs_t t33 = t0 ^ t32;
+	const bs_t t34 = t12 & x3;
+	const bs_t t35 = x5 ^ t34;
+	const bs_t t36 = t33 ^ t35;
+	const bs_t t37 = t36 & x2;
+	const bs_t t38 = t33 ^ t37;
+	const bs_t t39 = t38 ^ x1;
+	const bs_t t40 = t7 ^ t32;
+	const bs_t t41 = ~t13;
+	const bs_t t45 = t10 & x2;
+	const bs_t t46 = t40 ^ t45;
+	const bs_t t47 = t8 & x3;
+	const bs_t t48 = t12 ^ t47;
+	const bs_t t49 = t8 ^ t22;
+	const bs_t t50 = t48 ^ t49;
+	const bs_t t51 = t50 & x2;
+	const bs_t t52 = t48 ^ t51;
+	const bs_t t53 = t46 ^ t52;
+	const bs_t t54 = t53 & x1;
+	const bs_t t55 = t46 ^ t54;
+	const bs_t t56 = t39 ^ t55;
+	const bs_t t57 = t56 & x0;
+	const bs_t t58 = t39 ^ t57;
+	const bs_t t60 = t49 & x2;
+	const bs_t t61 = t9 ^ t60;
+	const bs_t t62 = t7 ^ t16;
+	const bs_t t64 = t0 & x2;
+	const bs_t t65 = t62 ^ t64;
+	const bs_t t66 = t61 ^ t65;
+	const bs_t t67 = t66 & x1;
+	const bs_t t68 = t61 ^ t67;
+	const bs_t t69 = ~t9;
+	const bs_t t70 = ~t8;
+	const bs_t t71 = t7 & x3;
+	const bs_t t72 = t69 ^ t71;
+	const bs_t t73 = t72 ^ t2;
+	const bs_t t74 = t73 & x2;
+	const bs_t t75 = t72 ^ t74;
+	const bs_t t76 = t41 ^ t47;
+	const bs_t t78 = t7 & x2;
+	const bs_t t79 = t76 ^ t78;
+	const bs_t t80 = t75 ^ t79;
+	const bs_t t81 = t80 & x1;
+	const bs_t t82 = t75 ^ t81;
+	const bs_t t83 = t68 ^ t82;
+	const bs_t t84 = t83 & x0;
+	const bs_t t85 = t68 ^ t84;
+	const bs_t t87 = ~t16;
+	const bs_t t88 = t87 & x2;
+	const bs_t t89 = t49 ^ t88;
+	const bs_t t90 = t10 ^ x2;
+	const bs_t t91 = t89 ^ t90;
+	const bs_t t92 = t91 & x1;
+	const bs_t t93 = t89 ^ t92;
+	const bs_t t95 = t26 ^ t64;
+	const bs_t t96 = t70 & x3;
+	const bs_t t97 = t9 ^ t96;
+	const bs_t t98 = t41 ^ t34;
+	const bs_t t99 = t97 ^ t98;
+	const bs_t t100 = t99 & x2;
+	const bs_t t101 = t97 ^ t100;
+	const bs_t t102 = t95 ^ t101;
+	const bs_t t103 = t102 & x1;
+	const bs_t t104 = t95 ^ t103;
+	const bs_t t105 = t93 ^ t104;
+	const bs_t t106 = t105 & x0;
+	const bs_t t107 = t93 ^ t106;
+	out[0] = t31;
+	out[1] = t58;
+	out[2] = t85;
+	out[3] = t107;
+}
+
+// 101 gates
+static inline void des_bs_s3(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[0], x1 = in[3], x2 = in[2], x3 = in[1], x4 = in[4], x5 = in[5];
+	const bs_t t0 = ~x4;
+	const bs_t t1 = t0 ^ x3;
+	const bs_t t2 = x5 | ~x4;
+	const bs_t t3 = t2 & x3;
+	const bs_t t4 = t1 ^ t3;
+	const bs_t t5 = t4 & x2;
+	const bs_t t6 = t1 ^ t5;
+	const bs_t t7 = ~x5;
+	const bs_t t8 = t7 | x4;
+	const bs_t t9 = t7 ^ x4;
+	const bs_t t10 = ~t2;
+	const bs_t t11 = t10 & x3;
+	const bs_t t12 = t8 ^ t11;
+	const bs_t t13 = t9 ^ x3;
+	const bs_t t14 = t12 ^ t13;
+	const bs_t t15 = t14 & x2;
+	const bs_t t16 = t12 ^ t15;
+	const bs_t t17 = t6 ^ t16;
+	const bs_t t18 = t17 & x1;
+	const bs_t t19 = t6 ^ t18;
+	const bs_t t20 = ~t9;
+	const bs_t t22 = t9 ^ t15;
+	const bs_t t23 = t22 ^ x1;
+	const bs_t t24 = t19 ^ t23;
+	const bs_t t25 = t24 & x0;
+	const bs_t t26 = t19 ^ t25;
+	const bs_t t27 = x5 ^ t10;
+	const bs_t t28 = t27 & x3;
+	const bs_t t29 = x5 ^ t28;
+	const bs_t t30 = t29 ^ t13;
+	const bs_t t31 = t30 & x2;
+	const bs_t t32 = t29 ^ t31;
+	const bs_t t33 = t7 | ~x4;
+	const bs_t t35 = t7 & x3;
+	const bs_t t36 = t33 ^ t35;
+	const bs_t t37 = t14 ^ t36;
+	const bs_t t38 = t37 & x2;
+	const bs_t t39 = t14 ^ t38;
+	const bs_t t40 = t32 ^ t39;
+	const bs_t t41 = t40 & x1;
+	const bs_t t42 = t32 ^ t41;
+	const bs_t t43 = t7 ^ x3;
+	const bs_t t45 = t0 & x2;
+	const bs_t t46 = t43 ^ t45;
+	const bs_t t47 = t0 ^ t35;
+	const bs_t t49 = t2 & x2;
+	const bs_t t50 = t47 ^ t49;
+	const bs_t t51 = t46 ^ t50;
+	const bs_t t52 = t51 & x1;
+	const bs_t t53 = t46 ^ t52;
+	const bs_t t54 = t42 ^ t53;
+	const bs_t t55 = t54 & x0;
+	const bs_t t56 = t42 ^ t55;
+	const bs_t t57 = t9 ^ t3;
+	const bs_t t58 = t33 ^ t28;
+	const bs_t t59 = t57 ^ t58;
+	const bs_t t60 = t59 & x2;
+	const bs_t t61 = t57 ^ t60;
+	const bs_t t62 = ~t33;
+	const bs_t t63 = t62 & x3;
+	const bs_t t64 = t10 ^ t63;
+	const bs_t t65 = t64 ^ x2;
+	const bs_t t66 = t61 ^ t65;
+	const bs_t t67 = t66 & x1;
+	const bs_t t68 = t61 ^ t67;
+	const bs_t t69 = ~t47;
+	const bs_t t70 = t69 ^ t20;
+	const bs_t t71 = t70 & x2;
+	const bs_t t72 = t69 ^ t71;
+	const bs_t t73 = t9 ^ t28;
+	const bs_t t74 = t3 ^ t73;
+	const bs_t t75 = t74 & x2;
+	const bs_t t76 = t3 ^ t75;
+	const bs_t t77 = t72 ^ t76;
+	const bs_t t78 = t77 & x1;
+	const bs_t t79 = t72 ^ t78;
+	const bs_t t80 = t68 ^ t79;
+	const bs_t t81 = t80 & x0;
+	const bs_t t82 = t68 ^ t81;
+	const bs_t t83 = ~t43;
+	const bs_t t84 = x4 & x2;
+	const bs_t t85 = t83 ^ t84;
+	const bs_t t87 = t0 & x1;
+	const bs_t t88 = t85 ^ t87;
+	const bs_t t89 = t33 & x3;
+	const bs_t t90 = x4 ^ t89;
+	const bs_t t91 = t37 ^ t90;
+	const bs_t t92 = t91 & x2;
+	const bs_t t93 = t37 ^ t92;
+	const bs_t t94 = ~t73;
+	const bs_t t95 = t8 & x3;
+	const bs_t t96 = t9 ^ t95;
+	const bs_t t97 = t94 ^ t96;
+	const bs_t t98 = t97 & x2;
+	const bs_t t99 = t94 ^ t98;
+	const bs_t t100 = t93 ^ t99;
+	const bs_t t101 = t100 & x1;
+	const bs_t t102 = t93 ^ t101;
+	const bs_t t103 = t88 ^ t102;
+	const bs_t t104 = t103 & x0;
+	const bs_t t105 = t88 ^ t104;
+	out[0] = t26;
+	out[1] = t56;
+	out[2] = t82;
+	out[3] = t105;
+}
+
+// 70 gates
+static inline void des_bs_s4(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[5], x1 = in[0], x2 = in[1], x3 = in[4], x4 = in[2], x5 = in[3];
+	const bs_t t0 = ~x5;
+	const bs_t t1 = t0 ^ x4;
+	const bs_t t2 = ~x4;
+	const bs_t t3 = t2 & x3;
+	const bs_t t4 = x5 ^ t3;
+	const bs_t t5 = ~t1;
+	const bs_t t6 = x5 & x3;
+	const bs_t t7 = t5 ^ t6;
+	const bs_t t8 = t4 ^ t7;
+	const bs_t t9 = t8 & x2;
+	const bs_t t10 = t4 ^ t9;
+	const bs_t t11 = t0 | ~x4;
+	const bs_t t12 = t11 ^ x4;
+	const bs_t t13 = t12 & x3;
+	const bs_t t14 = t11 ^ t13;
+	const bs_t t15 = x5 & ~x4;
+	const bs_t t16 = t1 ^ t13;
+	const bs_t t17 = t14 ^ t16;
+	const bs_t t18 = t17 & x2;
+	const bs_t t19 = t14 ^ t18;
+	const bs_t t20 = t10 ^ t19;
+	const bs_t t21 = t20 & x1;
+	const bs_t t22 = t10 ^ t21;
+	const bs_t t23 = t5 & x3;
+	const bs_t t24 = t2 ^ t23;
+	const bs_t t27 = t12 & x2;
+	const bs_t t28 = t24 ^ t27;
+	const bs_t t29 = t0 & x3;
+	const bs_t t30 = x4 ^ t29;
+	const bs_t t32 = ~t7;
+	const bs_t t33 = t32 & x2;
+	const bs_t t34 = t30 ^ t33;
+	const bs_t t35 = t28 ^ t34;
+	const bs_t t36 = t35 & x1;
+	const bs_t t37 = t28 ^ t36;
+	const bs_t t38 = t22 ^ t37;
+	const bs_t t39 = t38 & x0;
+	const bs_t t40 = t22 ^ t39;
+	const bs_t t42 = ~t38;
+	const bs_t t43 = t42 & x0;
+	const bs_t t44 = t37 ^ t43;
+	const bs_t t45 = ~t15;
+	const bs_t t46 = t45 & x3;
+	const bs_t t47 = t2 ^ t46;
+	const bs_t t50 = t11 & x2;
+	const bs_t t51 = t47 ^ t50;
+	const bs_t t52 = x4 & x3;
+	const bs_t t53 = t1 ^ t52;
+	const bs_t t54 = ~t30;
+	const bs_t t55 = t53 ^ t54;
+	const bs_t t56 = t55 & x2;
+	const bs_t t57 = t53 ^ t56;
+	const bs_t t58 = t51 ^ t57;
+	const bs_t t59 = t58 & x1;
+	const bs_t t60 = t51 ^ t59;
+	const bs_t t62 = t30 & x2;
+	const bs_t t63 = t7 ^ t62;
+	const bs_t t64 = t0 ^ t23;
+	const bs_t t65 = t45 & x2;
+	const bs_t t66 = t64 ^ t65;
+	const bs_t t67 = t63 ^ t66;
+	const bs_t t68 = t67 & x1;
+	const bs_t t69 = t63 ^ t68;
+	const bs_t t70 = t60 ^ t69;
+	const bs_t t71 = t70 & x0;
+	const bs_t t72 = t60 ^ t71;
+	const bs_t t73 = ~t69;
+	const bs_t t74 = ~t70;
+	const bs_t t75 = t74 & x0;
+	const bs_t t76 = t73 ^ t75;
+	out[0] = t40;
+	out[1] = t44;
+	out[2] = t72;
+	out[3] = t76;
+}
+
+// 109 gates
+static inline void des_bs_s5(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[3], x1 = in[4], x2 = in[1], x3 = in[5], x4 = in[0], x5 = in[2];
+	const bs_t t0 = x5 & x4;
+	const bs_t t1 = ~x5;
+	const bs_t t2 = t0 ^ t1;
+	const bs_t t3 = t2 & x3;
+	const bs_t t4 = t0 ^ t3;
+	const bs_t t5 = ~t0;
+	const bs_t t6 = t5 ^ x3;
+	const bs_t t7 = t4 ^ t6;
+	const bs_t t8 = t7 & x2;
+	const bs_t t9 = t4 ^ t8;
+	const bs_t t10 = x5 | ~x4;
+	const bs_t t11 = t10 ^ t2;
+	const bs_t t12 = t11 & x3;
+	const bs_t t13 = t10 ^ t12;
+	const bs_t t14 = ~t10;
+	const bs_t t15 = ~t2;
+	const bs_t t16 = ~t7;
+	const bs_t t17 = t14 ^ t16;
+	const bs_t t18 = t13 ^ t17;
+	const bs_t t19 = t18 & x2;
+	const bs_t t20 = t13 ^ t19;
+	const bs_t t21 = t9 ^ t20;
+	const bs_t t22 = t21 & x1;
+	const bs_t t23 = t9 ^ t22;
+	const bs_t t24 = ~t18;
+	const bs_t t25 = t15 ^ t24;
+	const bs_t t26 = ~x4;
+	const bs_t t27 = t1 & x3;
+	const bs_t t28 = t11 ^ t27;
+	const bs_t t29 = t25 ^ t28;
+	const bs_t t30 = t29 & x2;
+	const bs_t t31 = t25 ^ t30;
+	const bs_t t32 = ~t11;
+	const bs_t t33 = x4 ^ t27;
+	const bs_t t34 = t10 ^ t1;
+	const bs_t t35 = t34 & x3;
+	const bs_t t36 = t10 ^ t35;
+	const bs_t t37 = t33 ^ t36;
+	const bs_t t38 = t37 & x2;
+	const bs_t t39 = t33 ^ t38;
+	const bs_t t40 = t31 ^ t39;
+	const bs_t t41 = t40 & x1;
+	const bs_t t42 = t31 ^ t41;
+	const bs_t t43 = t23 ^ t42;
+	const bs_t t44 = t43 & x0;
+	const bs_t t45 = t23 ^ t44;
+	const bs_t t46 = t10 & x3;
+	const bs_t t47 = t34 ^ t46;
+	const bs_t t48 = t28 ^ t47;
+	const bs_t t49 = t48 & x2;
+	const bs_t t50 = t28 ^ t49;
+	const bs_t t51 = t26 & x3;
+	const bs_t t56 = ~t12;
+	const bs_t t57 = t56 & x1;
+	const bs_t t58 = t50 ^ t57;
+	const bs_t t59 = t32 ^ x3;
+	const bs_t t60 = t59 ^ x2;
+	const bs_t t63 = t10 & x1;
+	const bs_t t64 = t60 ^ t63;
+	const bs_t t65 = t58 ^ t64;
+	const bs_t t66 = t65 & x0;
+	const bs_t t67 = t58 ^ t66;
+	const bs_t t68 = x4 ^ t16;
+	const bs_t t69 = t36 ^ t68;
+	const bs_t t70 = t69 & x2;
+	const bs_t t71 = t36 ^ t70;
+	const bs_t t72 = t11 ^ t3;
+	const bs_t t73 = ~t69;
+	const bs_t t74 = t72 ^ t73;
+	const bs_t t75 = t74 & x2;
+	const bs_t t76 = t72 ^ t75;
+	const bs_t t77 = t71 ^ t76;
+	const bs_t t78 = t77 & x1;
+	const bs_t t79 = t71 ^ t78;
+	const bs_t t80 = x5 ^ t51;
+	const bs_t t81 = ~t68;
+	const bs_t t82 = t80 ^ t81;
+	const bs_t t83 = t82 & x2;
+	const bs_t t84 = t80 ^ t83;
+	const bs_t t85 = t11 ^ t16;
+	const bs_t t86 = t85 ^ x2;
+	const bs_t t87 = t84 ^ t86;
+	const bs_t t88 = t87 & x1;
+	const bs_t t89 = t84 ^ t88;
+	const bs_t t90 = t79 ^ t89;
+	const bs_t t91 = t90 & x0;
+	const bs_t t92 = t79 ^ t91;
+	const bs_t t93 = t15 ^ t35;
+	const bs_t t94 = t93 ^ t28;
+	const bs_t t95 = t94 & x2;
+	const bs_t t96 = t93 ^ t95;
+	const bs_t t97 = ~t37;
+	const bs_t t99 = t1 & x2;
+	const bs_t t100 = t97 ^ t99;
+	const bs_t t101 = t96 ^ t100;
+	const bs_t t102 = t101 & x1;
+	const bs_t t103 = t96 ^ t102;
+	const bs_t t104 = x4 & x3;
+	const bs_t t105 = t34 ^ t104;
+	const bs_t t108 = t105 ^ t19;
+	const bs_t t109 = t1 ^ t46;
+	const bs_t t110 = t15 & x2;
+	const bs_t t111 = t109 ^ t110;
+	const bs_t t112 = t108 ^ t111;
+	const bs_t t113 = t112 & x1;
+	const bs_t t114 = t108 ^ t113;
+	const bs_t t115 = t103 ^ t114;
+	const bs_t t116 = t115 & x0;
+	const bs_t t117 = t103 ^ t116;
+	out[0] = t45;
+	out[1] = t67;
+	out[2] = t92;
+	out[3] = t117;
+}
+
+// 100 gates
+static inline void des_bs_s6(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[5], x1 = in[0], x2 = in[3], x3 = in[2], x4 = in[1], x5 = in[4];
+	const bs_t t0 = ~x5;
+	const bs_t t1 = t0 ^ x4;
+	const bs_t t2 = x4 & x3;
+	const bs_t t3 = t1 ^ t2;
+	const bs_t t4 = ~x4;
+	const bs_t t5 = t1 & x3;
+	const bs_t t6 = t4 ^ t5;
+	const bs_t t7 = t3 ^ t6;
+	const bs_t t8 = t7 & x2;
+	const bs_t t9 = t3 ^ t8;
+	const bs_t t11 = t7 & x1;
+	const bs_t t12 = t9 ^ t11;
+	const bs_t t13 = t0 & x3;
+	const bs_t t15 = ~t2;
+	const bs_t t16 = t15 & x2;
+	const bs_t t17 = t6 ^ t16;
+	const bs_t t18 = t0 & ~x4;
+	const bs_t t19 = x4 ^ t18;
+	const bs_t t20 = t19 & x3;
+	const bs_t t21 = x4 ^ t20;
+	const bs_t t24 = ~t18;
+	const bs_t t25 = t24 & x2;
+	const bs_t t26 = t21 ^ t25;
+	const bs_t t27 = t17 ^ t26;
+	const bs_t t28 = t27 & x1;
+	const bs_t t29 = t17 ^ t28;
+	const bs_t t30 = t12 ^ t29;
+	const bs_t t31 = t30 & x0;
+	const bs_t t32 = t12 ^ t31;
+	const bs_t t33 = t1 ^ t13;
+	const bs_t t34 = x5 ^ x3;
+	const bs_t t35 = t33 ^ t34;
+	const bs_t t36 = t35 & x2;
+	const bs_t t37 = t33 ^ t36;
+	const bs_t t38 = ~t1;
+	const bs_t t39 = x5 & x4;
+	const bs_t t40 = t24 & x3;
+	const bs_t t41 = t38 ^ t40;
+	const bs_t t42 = ~t39;
+	const bs_t t43 = t42 ^ t40;
+	const bs_t t44 = t18 & x2;
+	const bs_t t45 = t41 ^ t44;
+	const bs_t t46 = t37 ^ t45;
+	const bs_t t47 = t46 & x1;
+	const bs_t t48 = t37 ^ t47;
+	const bs_t t49 = ~t33;
+	const bs_t t50 = t19 ^ x3;
+	const bs_t t51 = t49 ^ t50;
+	const bs_t t52 = t51 & x2;
+	const bs_t t53 = t49 ^ t52;
+	const bs_t t54 = t1 ^ x3;
+	const bs_t t55 = t4 & x3;
+	const bs_t t56 = x5 ^ t55;
+	const bs_t t57 = t54 ^ t56;
+	const bs_t t58 = t57 & x2;
+	const bs_t t59 = t54 ^ t58;
+	const bs_t t60 = t53 ^ t59;
+	const bs_t t61 = t60 & x1;
+	const bs_t t62 = t53 ^ t61;
+	const bs_t t63 = t48 ^ t62;
+	const bs_t t64 = t63 & x0;
+	const bs_t t65 = t48 ^ t64;
+	const bs_t t66 = t42 & x2;
+	const bs_t t67 = t40 ^ t66;
+	const bs_t t68 = t42 & x3;
+	const bs_t t69 = t38 ^ t68;
+	const bs_t t70 = t69 ^ x2;
+	const bs_t t71 = t67 ^ t70;
+	const bs_t t72 = t71 & x1;
+	const bs_t t73 = t67 ^ t72;
+	const bs_t t76 = t19 & x2;
+	const bs_t t77 = t43 ^ t76;
+	const bs_t t78 = x5 & x3;
+	const bs_t t79 = t24 ^ t78;
+	const bs_t t81 = t79 ^ t66;
+	const bs_t t82 = t77 ^ t81;
+	const bs_t t83 = t82 & x1;
+	const bs_t t84 = t77 ^ t83;
+	const bs_t t85 = t73 ^ t84;
+	const bs_t t86 = t85 & x0;
+	const bs_t t87 = t73 ^ t86;
+	const bs_t t89 = ~t6;
+	const bs_t t90 = t89 & x2;
+	const bs_t t91 = t56 ^ t90;
+	const bs_t t92 = t0 ^ t5;
+	const bs_t t94 = ~t3;
+	const bs_t t95 = t94 & x2;
+	const bs_t t96 = t92 ^ t95;
+	const bs_t t97 = t91 ^ t96;
+	const bs_t t98 = t97 & x1;
+	const bs_t t99 = t91 ^ t98;
+	const bs_t t101 = t56 ^ t25;
+	const bs_t t102 = x5 & x2;
+	const bs_t t103 = t49 ^ t102;
+	const bs_t t104 = t101 ^ t103;
+	const bs_t t105 = t104 & x1;
+	const bs_t t106 = t101 ^ t105;
+	const bs_t t107 = t99 ^ t106;
+	const bs_t t108 = t107 & x0;
+	const bs_t t109 = t99 ^ t108;
+	out[0] = t32;
+	out[1] = t65;
+	out[2] = t87;
+	out[3] = t109;
+}
+
+// 96 gates
+static inline void des_bs_s7(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[5], x1 = in[0], x2 = in[2], x3 = in[3], x4 = in[1], x5 = in[4];
+	const bs_t t0 = x5 ^ x4;
+	const bs_t t1 = x4 & x3;
+	const bs_t t2 = x5 ^ t1;
+	const bs_t t3 = ~t0;
+	const bs_t t4 = ~x4;
+	const bs_t t5 = x5 & x3;
+	const bs_t t6 = t3 ^ t5;
+	const bs_t t7 = t2 ^ t6;
+	const bs_t t8 = t7 & x2;
+	const bs_t t9 = t2 ^ t8;
+	const bs_t t10 = x5 | ~x4;
+	const bs_t t11 = x4 ^ t10;
+	const bs_t t12 = t11 & x3;
+	const bs_t t13 = x4 ^ t12;
+	const bs_t t14 = ~x5;
+	const bs_t t15 = t14 & ~x4;
+	const bs_t t16 = t15 ^ t12;
+	const bs_t t17 = t13 ^ t16;
+	const bs_t t18 = t17 & x2;
+	const bs_t t19 = t13 ^ t18;
+	const bs_t t20 = t9 ^ t19;
+	const bs_t t21 = t20 & x1;
+	const bs_t t22 = t9 ^ t21;
+	const bs_t t23 = ~t2;
+	const bs_t t24 = t23 ^ x2;
+	const bs_t t25 = t17 & x3;
+	const bs_t t26 = t0 ^ t25;
+	const bs_t t29 = ~t17;
+	const bs_t t30 = t29 & x2;
+	const bs_t t31 = t26 ^ t30;
+	const bs_t t32 = t24 ^ t31;
+	const bs_t t33 = t32 & x1;
+	const bs_t t34 = t24 ^ t33;
+	const bs_t t35 = t22 ^ t34;
+	const bs_t t36 = t35 & x0;
+	const bs_t t37 = t22 ^ t36;
+	const bs_t t38 = t4 & x3;
+	const bs_t t39 = t3 ^ t38;
+	const bs_t t41 = x4 & x2;
+	const bs_t t42 = t39 ^ t41;
+	const bs_t t43 = t42 ^ t9;
+	const bs_t t44 = t43 & x1;
+	const bs_t t45 = t42 ^ t44;
+	const bs_t t46 = ~t15;
+	const bs_t t47 = t10 & x3;
+	const bs_t t48 = t14 ^ t47;
+	const bs_t t50 = t15 & x3;
+	const bs_t t51 = t3 ^ t50;
+	const bs_t t52 = t48 ^ t51;
+	const bs_t t53 = t52 & x2;
+	const bs_t t54 = t48 ^ t53;
+	const bs_t t56 = ~t1;
+	const bs_t t57 = t56 & x2;
+	const bs_t t58 = t3 ^ t57;
+	const bs_t t59 = t54 ^ t58;
+	const bs_t t60 = t59 & x1;
+	const bs_t t61 = t54 ^ t60;
+	const bs_t t62 = t45 ^ t61;
+	const bs_t t63 = t62 & x0;
+	const bs_t t64 = t45 ^ t63;
+	const bs_t t65 = t26 ^ x2;
+	const bs_t t66 = t3 & x3;
+	const bs_t t67 = x4 ^ t66;
+	const bs_t t69 = t46 & x2;
+	const bs_t t70 = t67 ^ t69;
+	const bs_t t71 = t65 ^ t70;
+	const bs_t t72 = t71 & x1;
+	const bs_t t73 = t65 ^ t72;
+	const bs_t t74 = x4 ^ x3;
+	const bs_t t76 = t66 & x2;
+	const bs_t t77 = t74 ^ t76;
+	const bs_t t78 = t4 ^ t47;
+	const bs_t t79 = t78 ^ x2;
+	const bs_t t80 = t77 ^ t79;
+	const bs_t t81 = t80 & x1;
+	const bs_t t82 = t77 ^ t81;
+	const bs_t t83 = t73 ^ t82;
+	const bs_t t84 = t83 & x0;
+	const bs_t t85 = t73 ^ t84;
+	const bs_t t86 = ~t6;
+	const bs_t t87 = t14 ^ x3;
+	const bs_t t88 = t86 ^ t87;
+	const bs_t t89 = t88 & x2;
+	const bs_t t90 = t86 ^ t89;
+	const bs_t t91 = t90 ^ x1;
+	const bs_t t92 = t46 & x3;
+	const bs_t t93 = t3 ^ t92;
+	const bs_t t95 = t93 ^ t89;
+	const bs_t t96 = ~t16;
+	const bs_t t97 = t96 ^ x2;
+	const bs_t t98 = t95 ^ t97;
+	const bs_t t99 = t98 & x1;
+	const bs_t t100 = t95 ^ t99;
+	const bs_t t101 = t91 ^ t100;
+	const bs_t t102 = t101 & x0;
+	const bs_t t103 = t91 ^ t102;
+	out[0] = t37;
+	out[1] = t64;
+	out[2] = t85;
+	out[3] = t103;
+}
+
+// 92 gates
+static inline void des_bs_s8(const bs_t *in, bs_t *out) {
+	const bs_t x0 = in[5], x1 = in[0], x2 = in[1], x3 = in[4], x4 = in[2], x5 = in[3];
+	const bs_t t0 = x5 | ~x4;
+	const bs_t t1 = t0 ^ x3;
+	const bs_t t2 = ~x5;
+	const bs_t t3 = t2 ^ x4;
+	const bs_t t4 = ~x4;
+	const bs_t t5 = x5 & x3;
+	const bs_t t6 = t3 ^ t5;
+	const bs_t t7 = t1 ^ t6;
+	const bs_t t8 = t7 & x2;
+	const bs_t t9 = t1 ^ t8;
+	const bs_t t10 = t3 & x3;
+	const bs_t t11 = x4 ^ t10;
+	const bs_t t12 = ~t3;
+	const bs_t t13 = x4 & x3;
+	const bs_t t14 = t12 ^ t13;
+	const bs_t t15 = t11 ^ t14;
+	const bs_t t16 = t15 & x2;
+	const bs_t t17 = t11 ^ t16;
+	const bs_t t18 = t9 ^ t17;
+	const bs_t t19 = t18 & x1;
+	const bs_t t20 = t9 ^ t19;
+	const bs_t t21 = t2 & x3;
+	const bs_t t22 = t12 ^ t21;
+	const bs_t t24 = ~t5;
+	const bs_t t25 = t24 & x2;
+	const bs_t t26 = t22 ^ t25;
+	const bs_t t27 = t12 & x3;
+	const bs_t t28 = x5 ^ t27;
+	const bs_t t30 = ~t14;
+	const bs_t t31 = t30 & x2;
+	const bs_t t32 = t28 ^ t31;
+	const bs_t t33 = t26 ^ t32;
+	const bs_t t34 = t33 & x1;
+	const bs_t t35 = t26 ^ t34;
+	const bs_t t36 = t20 ^ t35;
+	const bs_t t37 = t36 & x0;
+	const bs_t t38 = t20 ^ t37;
+	const bs_t t39 = t4 & x3;
+	const bs_t t40 = t2 ^ t39;
+	const bs_t t42 = ~t22;
+	const bs_t t43 = t42 & x2;
+	const bs_t t44 = t40 ^ t43;
+	const bs_t t45 = x4 ^ x3;
+	const bs_t t46 = t1 ^ t45;
+	const bs_t t47 = t46 & x2;
+	const bs_t t48 = t1 ^ t47;
+	const bs_t t49 = t44 ^ t48;
+	const bs_t t50 = t49 & x1;
+	const bs_t t51 = t44 ^ t50;
+	const bs_t t52 = ~t44;
+	const bs_t t53 = t14 ^ x2;
+	const bs_t t54 = t52 ^ t53;
+	const bs_t t55 = t54 & x1;
+	const bs_t t56 = t52 ^ t55;
+	const bs_t t57 = t51 ^ t56;
+	const bs_t t58 = t57 & x0;
+	const bs_t t59 = t51 ^ t58;
+	const bs_t t60 = t11 ^ x2;
+	const bs_t t62 = ~t39;
+	const bs_t t63 = t62 & x2;
+	const bs_t t64 = t3 ^ t63;
+	const bs_t t65 = t60 ^ t64;
+	const bs_t t66 = t65 & x1;
+	const bs_t t67 = t60 ^ t66;
+	const bs_t t68 = x5 & ~x4;
+	const bs_t t69 = x5 | x4;
+	const bs_t t70 = t68 ^ t13;
+	const bs_t t71 = t11 ^ t70;
+	const bs_t t72 = t71 & x2;
+	const bs_t t73 = t11 ^ t72;
+	const bs_t t74 = t4 ^ t21;
+	const bs_t t76 = t69 & x2;
+	const bs_t t77 = t74 ^ t76;
+	const bs_t t78 = t73 ^ t77;
+	const bs_t t79 = t78 & x1;
+	const bs_t t80 = t73 ^ t79;
+	const bs_t t81 = t67 ^ t80;
+	const bs_t t82 = t81 & x0;
+	const bs_t t83 = t67 ^ t82;
+	const bs_t t84 = ~t35;
+	const bs_t t85 = t69 & x3;
+	const bs_t t86 = t0 ^ t85;
+	const bs_t t88 = t0 & x3;
+	const bs_t t90 = t74 & x2;
+	const bs_t t91 = t86 ^ t90;
+	const bs_t t93 = t88 ^ t47;
+	const bs_t t94 = t91 ^ t93;
+	const bs_t t95 = t94 & x1;
+	const bs_t t96 = t91 ^ t95;
+	const bs_t t97 = t84 ^ t96;
+	const bs_t t98 = t97 & x0;
+	const bs_t t99 = t84 ^ t98;
+	out[0] = t38;
+	out[1] = t59;
+	out[2] = t83;
+	out[3] = t99;
+}
+
+// 775 gates in all
+#endif
@@ -10,6 +10,9 @@
 
 #include "apduinfo.h"
 
+#include <stdbool.h>
+#include <pthread.h>
+
 const APDUCode APDUCodeTable[] = {
 	//  ID             Type                  Description
 	{"XXXX", 	APDUCODE_TYPE_NONE,			""}, // blank string
@@ -277,36 +280,57 @@ int CodeCmp(const char *code1, const char *code2) {
 	return -1;
 }
 
-const APDUCode* const GetAPDUCode(uint8_t sw1, uint8_t sw2) {
-	char buf[6] = {0};
-	int res;
-	int mineq = 100;
-	int mineqindx = 0;
-	
-	sprintf(&buf[0], "%02X", sw1);
-	sprintf(&buf[2], "%02X", sw2);
-	
-	for (int i = 0; i < APDUCodeTableLen; i++) {
-		res = CodeCmp(APDUCodeTable[i].ID, buf);
-		
-		// equal
-		if (res == 0) { 
-			return &APDUCodeTable[i];
-		}
-		
-		// with some  'X'
-		if (res > 0 && mineq > res) {
-			mineq = res;
-			mineqindx = i;
+// table entry for every SW1 SW2,  built once from APDUCodeTable
+static uint16_t APDUCodeIndex[0x10000];
+static pthread_once_t APDUCodeIndexOnce = PTHREAD_ONCE_INIT;
+
+// fixed nibbles go to value,  'X' nibbles to mask.  Entries with other
+// characters ("6---" headers) never match a status word
+static bool APDUCodePattern(const char *id, uint16_t *value, uint16_t *mask, int *xsymb) {
+	*value = 0;
+	*mask = 0;
+	*xsymb = 0;
+	for (int i = 0; i < 4; i++) {
+		char c = id[i];
+		int shift = 12 - 4 * i;
+		if (c == 'X') {
+			*mask |= 0xF << shift;
+			(*xsymb)++;
+		} else if (c >= '0' && c <= '9') {
+			*value |= (c - '0') << shift;
+		} else if (c >= 'A' && c <= 'F') {
+			*value |= (c - 'A' + 10) << shift;
+		} else {
+			return false;
 		}
 	}
+	return true;
+}
 
-	// if we have not equal, but with some 'X'
-	if (mineqindx < 100) {
-		return &APDUCodeTable[mineqindx];
+// most 'X' first and later entries before earlier ones,  so the last write
+// for a code is the exact match,  else the first entry with the fewest 'X'
+static void APDUCodeIndexBuild(void) {
+	uint16_t value, mask;
+	int xsymb;
+
+	for (int x = 4; x >= 0; x--) {
+		for (int i = APDUCodeTableLen - 1; i >= 0; i--) {
+			if (!APDUCodePattern(APDUCodeTable[i].ID, &value, &mask, &xsymb) || xsymb != x)
+				continue;
+
+			// every subset of the mask bits
+			uint16_t sub = 0;
+			do {
+				APDUCodeIndex[value | sub] = i;
+				sub = (sub - mask) & mask;
+			} while (sub);
+		}
 	}
-	
-	return NULL;
+}
+
+const APDUCode* const GetAPDUCode(uint8_t sw1, uint8_t sw2) {
+	pthread_once(&APDUCodeIndexOnce, APDUCodeIndexBuild);
+	return &APDUCodeTable[APDUCodeIndex[(sw1 << 8) | sw2]];
 }
 
 const char* GetAPDUCodeDescription(uint8_t sw1, uint8_t sw2) {
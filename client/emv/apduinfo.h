@@ -28,6 +28,7 @@ typedef struct {
 	const char *Description;
 } APDUCode;
 	
+// constant time,  through a 64K index over APDUCodeTable
 extern const APDUCode* const GetAPDUCode(uint8_t sw1, uint8_t sw2);
 extern const char* GetAPDUCodeDescription(uint8_t sw1, uint8_t sw2);
 
@@ -8,8 +8,12 @@
 // EMV commands
 //-----------------------------------------------------------------------------
 
+// this define is needed for scandir/alphasort to work
+#define _GNU_SOURCE
 #include "cmdemv.h"
 #include "test/cryptotest.h"
+#include "emvreplay.h"
+#include "scandir.h"
 
 static int CmdHelp(const char *Cmd);
 
@@ -569,22 +573,10 @@ int CmdHFEMVExec(const char *cmd) {
 				}
 				
 				// Build Input list for Offline Data Authentication
-				// EMV 4.3 book3 10.3, page 96
-				if (SFIoffline) {
-					if (SFI < 11) {
-						const unsigned char *abuf = buf;
-						size_t elmlen = len;
-						struct tlv e;
-						if (tlv_parse_tl(&abuf, &elmlen, &e)) {
-							memcpy(&ODAiList[ODAiListLen], &buf[len - elmlen], elmlen);
-							ODAiListLen += elmlen;
-						} else {
-							PrintAndLogEx(WARNING, "Error SFI[%02x]. Creating input list for Offline Data Authentication error.", SFI);
-						}
-					} else {
-						memcpy(&ODAiList[ODAiListLen], buf, len);
-						ODAiListLen += len;
-					}
+				// the first SFIoffline records of the range take part in it
+				if (n < SFIstart + SFIoffline) {
+					if (!ODAiListAddRecord(SFI, buf, len, ODAiList, &ODAiListLen, sizeof(ODAiList)))
+						PrintAndLogEx(WARNING, "Error SFI[%02x]. Creating input list for Offline Data Authentication error.", SFI);
 				}
 			}
 		}
@@ -593,11 +585,7 @@ int CmdHFEMVExec(const char *cmd) {
 	}	
 	
 	// copy Input list for Offline Data Authentication
-	if (ODAiListLen) {
-		struct tlvdb *oda = tlvdb_fixed(0x21, ODAiListLen, ODAiList); // not a standard tag
-		tlvdb_add(tlvRoot, oda); 
-		PrintAndLogEx(NORMAL, "* Input list for Offline Data Authentication added to TLV. len=%d \n", ODAiListLen);
-	}	
+	ODAiListAddToTLV(tlvRoot, ODAiList, ODAiListLen, sizeof(ODAiList));
 	
 	// get AIP
 	const struct tlv *AIPtlv = tlvdb_get(tlvRoot, 0x82, NULL);	
@@ -708,7 +696,7 @@ int CmdHFEMVExec(const char *cmd) {
 			if (res) {	
 				PrintAndLogEx(NORMAL, "CDA error (%d)", res);
 			}
-			free(ac_tlv);
+			tlvdb_free(ac_tlv);
 			free(cdol_data_tlv);
 			
 			PrintAndLogEx(NORMAL, "\n* M/Chip transaction result:");
@@ -810,6 +798,173 @@ int CmdHFEMVExec(const char *cmd) {
 	return 0;
 }
 
+int usage_emv_replay(void) {
+	PrintAndLogEx(NORMAL, "Replays recorded EMV transactions offline and verifies SDA/DDA/CDA:\n");
+	PrintAndLogEx(NORMAL, "Usage:  hf emv replay [-a][-t][-j <threads>][-r <rounds>] <file or directory>\n");
+	PrintAndLogEx(NORMAL, "Options:");
+	PrintAndLogEx(NORMAL, "  -a       : show APDU reqests and responses\n");
+	PrintAndLogEx(NORMAL, "  -t       : TLV decode results\n");
+	PrintAndLogEx(NORMAL, "  -j <n>   : worker threads for a directory or -r, default one per CPU\n");
+	PrintAndLogEx(NORMAL, "  -r <n>   : replay every transaction n times, for benchmarking\n");
+	PrintAndLogEx(NORMAL, "A recording is a `hf emv exec -a` log (>>>> and <<<< lines) or a `trace save` file.");
+	PrintAndLogEx(NORMAL, "A single file is replayed like `hf emv exec`, a directory in parallel with a summary.\n");
+	PrintAndLogEx(NORMAL, "Examples:");
+	PrintAndLogEx(NORMAL, " hf emv replay -a -t proxmark3.log     -> replay a logged transaction");
+	PrintAndLogEx(NORMAL, " hf emv replay -r 1000 traces/           -> verify every recording 1000 times");
+	return 0;
+}
+
+static const char *emv_replay_res(char *buf, size_t len, int res) {
+	if (res == EMVREPLAY_NOTDONE)
+		snprintf(buf, len, "  -  ");
+	else if (res == 0)
+		snprintf(buf, len, " ok  ");
+	else
+		snprintf(buf, len, " E%-2d ", res);
+	return buf;
+}
+
+static void emv_replay_print(const char *name, const struct emv_replay_result *r) {
+	char sda[8], dda[8], cda[8];
+	if (r->res) {
+		PrintAndLogEx(NORMAL, "%-32s | %-16s | ---- | not rebuilt (%d)", name, sprint_hex_inrow(r->AID, r->AIDlen), r->res);
+		return;
+	}
+	PrintAndLogEx(NORMAL, "%-32s | %-16s | %04x |%s|%s|%s", name, sprint_hex_inrow(r->AID, r->AIDlen), r->AIP,
+		emv_replay_res(sda, sizeof(sda), r->sda),
+		emv_replay_res(dda, sizeof(dda), r->dda),
+		emv_replay_res(cda, sizeof(cda), r->cda));
+}
+
+int CmdHFEMVReplay(const char *cmd) {
+	char path[FILE_PATH_SIZE] = {0};
+	bool showAPDU = false;
+	bool decodeTLV = false;
+	int threads = 0;
+	int rounds = 1;
+
+	if (strlen(cmd) < 1)
+		return usage_emv_replay();
+
+	int cmdp = 0;
+	while(param_getchar(cmd, cmdp) != 0x00) {
+		char c = param_getchar(cmd, cmdp);
+		if ((c == '-') && (param_getlength(cmd, cmdp) == 2)) {
+			switch (param_getchar_indx(cmd, 1, cmdp)) {
+				case 'h':
+				case 'H':
+					return usage_emv_replay();
+				case 'a':
+				case 'A':
+					showAPDU = true;
+					break;
+				case 't':
+				case 'T':
+					decodeTLV = true;
+					break;
+				case 'j':
+				case 'J':
+					threads = param_get32ex(cmd, ++cmdp, 0, 10);
+					break;
+				case 'r':
+				case 'R':
+					rounds = param_get32ex(cmd, ++cmdp, 1, 10);
+					break;
+				default:
+					PrintAndLogEx(WARNING, "Unknown parameter '%c'", param_getchar_indx(cmd, 1, cmdp));
+					return 1;
+			}
+		} else {
+			param_getstr(cmd, cmdp, path, sizeof(path));
+		}
+		cmdp++;
+	}
+	if (!path[0] || rounds < 1)
+		return usage_emv_replay();
+
+	size_t count = 0;
+	struct emv_replay **recs = NULL;
+	struct dirent **namelist = NULL;
+	int n = scandir(path, &namelist, NULL, alphasort);
+	bool isDir = n >= 0;
+	if (!isDir)
+		n = 1;
+
+	recs = calloc(n, sizeof(*recs));
+	if (!recs) {
+		PrintAndLogEx(WARNING, "Error: can't allocate memory");
+		return 2;
+	}
+
+	for (int i = 0; i < n; i++) {
+		char fname[FILE_PATH_SIZE * 2];
+		if (isDir) {
+			if (namelist[i]->d_name[0] == '.') {
+				free(namelist[i]);
+				continue;
+			}
+			snprintf(fname, sizeof(fname), "%s/%s", path, namelist[i]->d_name);
+			free(namelist[i]);
+		} else {
+			snprintf(fname, sizeof(fname), "%s", path);
+		}
+
+		struct emv_replay *rec = EMVReplayLoad(fname);
+		if (!rec || !rec->count) {
+			if (!isDir)
+				PrintAndLogEx(WARNING, "Error: no APDU exchanges in %s", fname);
+			EMVReplayFree(rec);
+			continue;
+		}
+		recs[count++] = rec;
+	}
+	free(namelist);
+
+	if (!count) {
+		free(recs);
+		PrintAndLogEx(WARNING, "Error: nothing to replay.");
+		return 3;
+	}
+
+	struct emv_replay_result *results = calloc(count, sizeof(*results));
+	if (!results) {
+		for (size_t i = 0; i < count; i++)
+			EMVReplayFree(recs[i]);
+		free(recs);
+		PrintAndLogEx(WARNING, "Error: can't allocate memory");
+		return 2;
+	}
+
+	if (!isDir && rounds == 1) {
+		// one transaction,  shown the way `hf emv exec` does
+		SetAPDULogging(showAPDU);
+		PrintAndLogEx(NORMAL, "* Replay %s, %zu APDU exchanges.", recs[0]->name, recs[0]->count);
+		EMVReplayTransaction(recs[0], false, decodeTLV, &results[0]);
+		SetAPDULogging(false);
+		PrintAndLogEx(NORMAL, "\n* Replay completed.\n");
+	} else {
+		SetAPDULogging(false);
+		if (threads <= 0)
+			threads = num_CPUs();
+		PrintAndLogEx(NORMAL, "Replaying %zu recordings %d times on %d threads...", count, rounds, threads);
+		uint64_t t1 = msclock();
+		int total = EMVReplayBatch(recs, count, rounds, threads, results);
+		t1 = msclock() - t1;
+		PrintAndLogEx(SUCCESS, "%d transactions in %" PRIu64 " ms, %.0f transactions/s\n", total, t1, t1 ? total * 1000.0 / t1 : 0.0);
+	}
+
+	PrintAndLogEx(NORMAL, "%-32s | %-16s | AIP  | SDA | DDA | CDA", "recording", "AID");
+	PrintAndLogEx(NORMAL, "---------------------------------+------------------+------+-----+-----+-----");
+	for (size_t i = 0; i < count; i++) {
+		const char *name = strrchr(recs[i]->name, '/');
+		emv_replay_print(name ? name + 1 : recs[i]->name, &results[i]);
+		EMVReplayFree(recs[i]);
+	}
+	free(recs);
+	free(results);
+	return 0;
+}
+
 int usage_emv_getrnd(void){
 	PrintAndLogEx(NORMAL, "retrieve the UN number from a terminal");
 	PrintAndLogEx(NORMAL, "Usage:  hf emv getrnd [h]");
@@ -839,6 +994,7 @@ int CmdHFEMVTest(const char *cmd) {
 static command_t CommandTable[] =  {
 	{"help",	CmdHelp,		1,	"This help"},
 	{"exec",	CmdHFEMVExec,	0,	"Executes EMV contactless transaction."},
+	{"replay",	CmdHFEMVReplay,	1,	"Replays recorded transactions offline and verifies SDA/DDA/CDA."},
 	{"pse",		CmdHFEMVPPSE,	0,	"Execute PPSE. It selects 2PAY.SYS.DDF01 or 1PAY.SYS.DDF01 directory."},
 	{"search",	CmdHFEMVSearch,	0,	"Try to select all applets from applets list and print installed applets."},
 	{"select",	CmdHFEMVSelect,	0,	"Select applet."},
@@ -32,6 +32,7 @@ extern int CmdHFEMVSelect(const char *cmd);
 extern int CmdHFEMVSearch(const char *cmd);
 extern int CmdHFEMVPPSE(const char *cmd);
 extern int CmdHFEMVExec(const char *cmd);
+extern int CmdHFEMVReplay(const char *cmd);
 extern int CmdHfEMVGetrng(const char *Cmd);
 extern int CmdHfEMVList(const char *Cmd);
 
@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// RSA public key operation with Montgomery multiplication,  exponent 3.
+// Products are CIOS.  Nothing is allocated,  the key is never written to.
+//-----------------------------------------------------------------------------
+
+#include "crypto_mont.h"
+
+#include <string.h>
+
+#define LIMB_BYTES	(MONT_LIMB_BITS / 8)
+
+static void mont_from_bin(mont_limb *x, size_t n, const unsigned char *buf, size_t len)
+{
+	memset(x, 0, n * sizeof(mont_limb));
+	for (size_t i = 0; i < len; i++)
+		x[i / LIMB_BYTES] |= (mont_limb)buf[len - 1 - i] << (8 * (i % LIMB_BYTES));
+}
+
+static void mont_to_bin(const mont_limb *x, unsigned char *buf, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[len - 1 - i] = x[i / LIMB_BYTES] >> (8 * (i % LIMB_BYTES));
+}
+
+static int mont_cmp(const mont_limb *a, const mont_limb *b, size_t n)
+{
+	while (n--) {
+		if (a[n] != b[n])
+			return a[n] > b[n] ? 1 : -1;
+	}
+	return 0;
+}
+
+static void mont_sub(mont_limb *a, const mont_limb *b, size_t n)
+{
+	mont_limb borrow = 0;
+	for (size_t i = 0; i < n; i++) {
+		mont_dlimb d = (mont_dlimb)a[i] - b[i] - borrow;
+		a[i] = (mont_limb)d;
+		borrow = (mont_limb)(d >> MONT_LIMB_BITS) & 1;
+	}
+}
+
+// r = 2 a mod N,  a < N
+static void mont_dbl(const struct crypto_mont *m, mont_limb *r, const mont_limb *a)
+{
+	mont_limb carry = 0;
+	for (size_t i = 0; i < m->n; i++) {
+		mont_limb v = a[i];
+		r[i] = (v << 1) | carry;
+		carry = v >> (MONT_LIMB_BITS - 1);
+	}
+	if (carry || mont_cmp(r, m->N, m->n) >= 0)
+		mont_sub(r, m->N, m->n);
+}
+
+// r = a b R^-1 mod N,  a, b < N.  r may alias a or b
+static void mont_mul(const struct crypto_mont *m, mont_limb *r, const mont_limb *a, const mont_limb *b)
+{
+	const size_t n = m->n;
+	const mont_limb *N = m->N;
+	mont_limb t[MONT_MAX_LIMBS + 2];
+
+	memset(t, 0, (n + 2) * sizeof(mont_limb));
+
+	for (size_t i = 0; i < n; i++) {
+		mont_dlimb c = 0;
+		mont_limb bi = b[i];
+		for (size_t j = 0; j < n; j++) {
+			c += (mont_dlimb)a[j] * bi + t[j];
+			t[j] = (mont_limb)c;
+			c >>= MONT_LIMB_BITS;
+		}
+		c += t[n];
+		t[n] = (mont_limb)c;
+		t[n + 1] = (mont_limb)(c >> MONT_LIMB_BITS);
+
+		// add q N so the low limb drops out,  shift one limb down
+		mont_limb q = t[0] * m->n0;
+		c = ((mont_dlimb)q * N[0] + t[0]) >> MONT_LIMB_BITS;
+		for (size_t j = 1; j < n; j++) {
+			c += (mont_dlimb)q * N[j] + t[j];
+			t[j - 1] = (mont_limb)c;
+			c >>= MONT_LIMB_BITS;
+		}
+		c += t[n];
+		t[n - 1] = (mont_limb)c;
+		t[n] = t[n + 1] + (mont_limb)(c >> MONT_LIMB_BITS);
+	}
+
+	// t < 2N here
+	if (t[n] || mont_cmp(t, N, n) >= 0)
+		mont_sub(t, N, n);
+
+	memcpy(r, t, n * sizeof(mont_limb));
+}
+
+bool crypto_mont_init(struct crypto_mont *m, const unsigned char *mod, size_t modlen, const unsigned char *exp, size_t explen)
+{
+	memset(m, 0, sizeof(*m));
+
+	if (modlen < 2 || !mod[0] || modlen > MONT_MAX_BITS / 8 || !(mod[modlen - 1] & 1))
+		return false;
+
+	while (explen && !exp[0]) {
+		exp++;
+		explen--;
+	}
+	if (explen != 1 || exp[0] != 3)
+		return false;
+
+	m->len = modlen;
+	m->n = (modlen + LIMB_BYTES - 1) / LIMB_BYTES;
+	mont_from_bin(m->N, m->n, mod, modlen);
+
+	// Newton,  every step doubles the correct low bits: 3, 6, 12, 24, 48, 96
+	mont_limb inv = m->N[0];
+	for (int i = 0; i < 5; i++)
+		inv *= 2 - m->N[0] * inv;
+	m->n0 = -inv;
+
+	// R mod N by doubling up from the top bit of N,  then 2^t R with
+	// bits(R) = t 2^s,  and s Montgomery products with itself give R^2 mod N
+	size_t rbits = m->n * MONT_LIMB_BITS;
+	size_t bits = rbits;
+	while (!((m->N[(bits - 1) / MONT_LIMB_BITS] >> ((bits - 1) % MONT_LIMB_BITS)) & 1))
+		bits--;
+
+	mont_limb *x = m->RR;
+	x[(bits - 1) / MONT_LIMB_BITS] = (mont_limb)1 << ((bits - 1) % MONT_LIMB_BITS);
+
+	size_t t = rbits, s = 0;
+	while (!(t & 1)) {
+		t >>= 1;
+		s++;
+	}
+
+	for (size_t i = bits - 1; i < rbits + t; i++)
+		mont_dbl(m, x, x);
+	for (size_t i = 0; i < s; i++)
+		mont_mul(m, x, x, x);
+
+	return true;
+}
+
+bool crypto_mont_public(const struct crypto_mont *m, const unsigned char *in, unsigned char *out)
+{
+	mont_limb x[MONT_MAX_LIMBS], acc[MONT_MAX_LIMBS];
+
+	mont_from_bin(x, m->n, in, m->len);
+	if (mont_cmp(x, m->N, m->n) >= 0)
+		return false;
+
+	// x R,  x^2 R,  and the last product with the plain x leaves the domain: x^3
+	mont_mul(m, acc, x, m->RR);
+	mont_mul(m, acc, acc, acc);
+	mont_mul(m, acc, acc, x);
+
+	mont_to_bin(acc, out, m->len);
+
+	return true;
+}
@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// RSA public key operation for certificate verification with exponent 3.
+// EMV keys have the exponent 3 or 65537 and a 1024..1984 bit modulus.  The
+// Montgomery constants are computed once per key,  after that a verify is
+// three fixed width Montgomery multiplications.  65537 takes 17 of them,
+// about what polarssl rsa_public() needs too,  so it is left to polarssl.
+//-----------------------------------------------------------------------------
+
+#ifndef CRYPTO_MONT_H
+#define CRYPTO_MONT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// 64 bit limbs where the compiler has a 128 bit type,  as polarssl bignum.h does
+#if defined(__SIZEOF_INT128__)
+typedef uint64_t mont_limb;
+typedef unsigned int mont_dlimb __attribute__((mode(TI)));
+#define MONT_LIMB_BITS	64
+#else
+typedef uint32_t mont_limb;
+typedef uint64_t mont_dlimb;
+#define MONT_LIMB_BITS	32
+#endif
+
+#define MONT_MAX_BITS	2048
+#define MONT_MAX_LIMBS	(MONT_MAX_BITS / MONT_LIMB_BITS)
+
+// read only once initialised,  may be shared between threads
+struct crypto_mont {
+	size_t n;			// limbs in use
+	size_t len;			// modulus length in bytes
+	mont_limb n0;			// -N^-1 mod 2^MONT_LIMB_BITS
+	mont_limb N[MONT_MAX_LIMBS];	// little endian limbs
+	mont_limb RR[MONT_MAX_LIMBS];	// R^2 mod N,  R = 2^(MONT_LIMB_BITS n)
+};
+
+// false if the key is not suited: even modulus,  exponent other than 3 or too long
+bool crypto_mont_init(struct crypto_mont *m, const unsigned char *mod, size_t modlen, const unsigned char *exp, size_t explen);
+
+// out = in^3 mod N,  both m->len bytes big endian.  false if in >= N
+bool crypto_mont_public(const struct crypto_mont *m, const unsigned char *in, unsigned char *out);
+
+#endif
@@ -20,6 +20,7 @@
 
 #include "crypto.h"
 #include "crypto_backend.h"
+#include "crypto_mont.h"
 
 #include <stdarg.h>
 #include <stdio.h>
@@ -31,6 +32,7 @@
 struct crypto_hash_polarssl {
 	struct crypto_hash ch;
 	sha1_context ctx;
+	unsigned char sha1sum[20];
 };
 
 static void crypto_hash_polarssl_close(struct crypto_hash *_ch)
@@ -51,9 +53,8 @@ static unsigned char *crypto_hash_polarssl_read(struct crypto_hash *_ch)
 {
 	struct crypto_hash_polarssl *ch = (struct crypto_hash_polarssl *)_ch;
 
-	static unsigned char sha1sum[20];
-	sha1_finish(&(ch->ctx), sha1sum);
-	return sha1sum;
+	sha1_finish(&(ch->ctx), ch->sha1sum);
+	return ch->sha1sum;
 }
 
 static size_t crypto_hash_polarssl_get_size(const struct crypto_hash *ch)
@@ -84,8 +85,31 @@ static struct crypto_hash *crypto_hash_polarssl_open(enum crypto_algo_hash hash)
 struct crypto_pk_polarssl {
 	struct crypto_pk cp;
 	rsa_context ctx;
+	bool mont_ok;			// e = 3,  the Montgomery path
+	struct crypto_mont mont;
 };
 
+static void crypto_pk_polarssl_mont(struct crypto_pk_polarssl *cp)
+{
+	unsigned char n[MONT_MAX_BITS / 8], e[4];
+	size_t nlen = mpi_size(&cp->ctx.N);
+	size_t elen = mpi_size(&cp->ctx.E);
+
+	if (nlen <= sizeof(n) && elen <= sizeof(e)) {
+		mpi_write_binary(&cp->ctx.N, n, nlen);
+		mpi_write_binary(&cp->ctx.E, e, elen);
+		cp->mont_ok = crypto_mont_init(&cp->mont, n, nlen, e, elen);
+	}
+
+	// rsa_public() computes R^2 mod N on its first call,  done here so a
+	// key shared between threads is only read
+	if (!cp->mont_ok && cp->ctx.RN.p == NULL) {
+		mpi_lset(&cp->ctx.RN, 1);
+		mpi_shift_l(&cp->ctx.RN, cp->ctx.N.n * 2 * sizeof(t_uint) * 8);
+		mpi_mod_mpi(&cp->ctx.RN, &cp->ctx.RN, &cp->ctx.N);
+	}
+}
+
 static struct crypto_pk *crypto_pk_polarssl_open_rsa(va_list vl)
 {
 	struct crypto_pk_polarssl *cp = malloc(sizeof(*cp));
@@ -109,6 +133,8 @@ static struct crypto_pk *crypto_pk_polarssl_open_rsa(va_list vl)
 		return NULL;
 	}
 
+	crypto_pk_polarssl_mont(cp);
+
 	return &cp->cp;
 }
 
@@ -154,6 +180,8 @@ static struct crypto_pk *crypto_pk_polarssl_open_priv_rsa(va_list vl)
 		return NULL;
 	}
 
+	crypto_pk_polarssl_mont(cp);
+
 	return &cp->cp;
 }
 
@@ -188,6 +216,8 @@ static struct crypto_pk *crypto_pk_polarssl_genkey_rsa(va_list vl)
 		free(cp);		
 		return NULL;
 	}
+
+	crypto_pk_polarssl_mont(cp);
 	
 	return &cp->cp;
 }
@@ -215,6 +245,16 @@ static unsigned char *crypto_pk_polarssl_encrypt(const struct crypto_pk *_cp, co
 		return NULL;
 	}
 
+	if (cp->mont_ok && len == cp->mont.len) {
+		if (!crypto_mont_public(&cp->mont, buf, result)) {
+			printf("RSA encrypt failed. Data is not less than the modulus. data len: %zu key len: %zu\n", len, keylen);
+			free(result);
+			return NULL;
+		}
+		*clen = keylen;
+		return result;
+	}
+
 	res = rsa_public(&cp->ctx, buf, result);
 	if (res) {
 		printf("RSA encrypt failed. Error: %x data len: %zu key len: %zu\n", res * -1, len, keylen);
@@ -26,6 +26,7 @@
 #include "proxmark3.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -379,51 +380,30 @@ struct emv_pk *emv_pk_new(size_t modlen, size_t explen)
 	return pk;
 }
 
+/* Opens the key for the crypto backend once, emv_pki then reuses it for
+ * every certificate the key signed.
+ */
+bool emv_pk_prepare(struct emv_pk *pk)
+{
+	if (!pk->cp)
+		pk->cp = crypto_pk_open(pk->pk_algo,
+				pk->modulus, pk->mlen,
+				pk->exp, pk->elen);
+
+	return pk->cp != NULL;
+}
+
 void emv_pk_free(struct emv_pk *pk)
 {
 	if (!pk)
 		return;
 
+	if (pk->cp)
+		crypto_pk_close(pk->cp);
 	free(pk->modulus);
 	free(pk);
 }
 
-static struct emv_pk *emv_pk_get_ca_pk_from_file(const char *fname,
-		const unsigned char *rid,
-		unsigned char idx)
-{
-	if  (!fname)
-		return NULL;
-
-	FILE *f = fopen(fname, "r");
-	if (!f) {
-		perror("fopen");
-		return NULL;
-	}
-
-	while (!feof(f)) {
-		char buf[2048];
-		if (fgets(buf, sizeof(buf), f) == NULL)
-			break;
-
-		struct emv_pk *pk = emv_pk_parse_pk(buf);
-		if (!pk)
-			continue;
-		if (memcmp(pk->rid, rid, 5) || pk->index != idx) {
-			emv_pk_free(pk);
-			continue;
-		}
-
-		fclose(f);
-
-		return pk;
-	}
-
-	fclose(f);
-
-	return NULL;
-}
-
 char *emv_pk_get_ca_pk_file(const char *dirname, const unsigned char *rid, unsigned char idx)
 {
 	if (!dirname)
@@ -471,54 +451,169 @@ char *emv_pk_get_ca_pk_rid_file(const char *dirname, const unsigned char *rid)
 	return filename;
 }
 
-struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx)
+/*
+ * CA public key store.
+ * capk.txt is parsed and every key hash checked once, on the first lookup.
+ * Keys are then found through an open addressing index on (RID, index).
+ * The first line of the file wins for a duplicated (RID, index), as with
+ * the plain file scan.
+ */
+struct emv_pk_store_entry {
+	struct emv_pk *pk;
+	bool verified;
+};
+
+static struct {
+	bool loaded;
+	size_t count;
+	struct emv_pk_store_entry *entries;
+	int *index;		/* entry number, -1 for an empty slot */
+	size_t mask;
+} capk_store;
+
+static size_t emv_pk_store_hash(const unsigned char *rid, unsigned char idx)
 {
-	struct emv_pk *pk = NULL;
+	uint32_t h = 2166136261u;
+	for (int i = 0; i < 5; i++)
+		h = (h ^ rid[i]) * 16777619u;
+	return (h ^ idx) * 16777619u;
+}
 
-/*	if (!pk) {
-		char *fname = emv_pk_get_ca_pk_file(NULL, rid, idx);
-		if (fname) {
-			pk = emv_pk_get_ca_pk_from_file(fname, rid, idx);
-			free(fname);
-		}
+static int *emv_pk_store_slot(const unsigned char *rid, unsigned char idx)
+{
+	size_t i = emv_pk_store_hash(rid, idx) & capk_store.mask;
+	for (;; i = (i + 1) & capk_store.mask) {
+		int e = capk_store.index[i];
+		if (e < 0)
+			return &capk_store.index[i];
+		const struct emv_pk *pk = capk_store.entries[e].pk;
+		if (pk->index == idx && !memcmp(pk->rid, rid, 5))
+			return &capk_store.index[i];
 	}
+}
 
-	if (!pk) {
-		char *fname = emv_pk_get_ca_pk_rid_file(NULL, rid);
-		if (fname) {
-			pk = emv_pk_get_ca_pk_from_file(fname, rid, idx);
-			free(fname);
-		}
+void emv_pk_store_free(void)
+{
+	for (size_t i = 0; i < capk_store.count; i++)
+		emv_pk_free(capk_store.entries[i].pk);
+	free(capk_store.entries);
+	free(capk_store.index);
+	memset(&capk_store, 0, sizeof(capk_store));
+}
+
+static const char *emv_pk_default_file(char *fname, size_t size)
+{
+	snprintf(fname, size, "%s%s", get_my_executable_directory(), "emv/capk.txt");
+	return fname;
+}
+
+int emv_pk_store_load(const char *fname)
+{
+	char deffname[1024];
+
+	emv_pk_store_free();
+
+	if (!fname)
+		fname = emv_pk_default_file(deffname, sizeof(deffname));
+
+	FILE *f = fopen(fname, "r");
+	if (!f) {
+		perror("fopen");
+		return -1;
 	}
-*/
-	if (!pk) {
-		const char *relfname = "emv/capk.txt"; 
 
-		char fname[strlen(get_my_executable_directory()) + strlen(relfname) + 1];
-		strcpy(fname, get_my_executable_directory());
-		strcat(fname, relfname);
+	size_t size = 0;
+	char buf[2048];
+	while (fgets(buf, sizeof(buf), f)) {
+		struct emv_pk *pk = emv_pk_parse_pk(buf);
+		if (!pk)
+			continue;
+
+		if (capk_store.count == size) {
+			size = size ? size * 2 : 32;
+			struct emv_pk_store_entry *entries = realloc(capk_store.entries, size * sizeof(*entries));
+			if (!entries) {
+				emv_pk_free(pk);
+				break;
+			}
+			capk_store.entries = entries;
+		}
+		capk_store.entries[capk_store.count].pk = pk;
+		capk_store.entries[capk_store.count].verified = emv_pk_verify(pk);
+		if (capk_store.entries[capk_store.count].verified)
+			emv_pk_prepare(pk);
+		capk_store.count++;
+	}
+	fclose(f);
 
-		pk = emv_pk_get_ca_pk_from_file(fname, rid, idx);
+	size_t slots = 16;
+	while (slots < capk_store.count * 2)
+		slots <<= 1;
+	capk_store.index = malloc(slots * sizeof(int));
+	if (!capk_store.index) {
+		emv_pk_store_free();
+		return -1;
+	}
+	memset(capk_store.index, 0xff, slots * sizeof(int));
+	capk_store.mask = slots - 1;
+
+	for (size_t i = 0; i < capk_store.count; i++) {
+		const struct emv_pk *pk = capk_store.entries[i].pk;
+		int *slot = emv_pk_store_slot(pk->rid, pk->index);
+		if (*slot < 0)
+			*slot = i;
 	}
+
+	// a missing or unreadable file is tried again on the next lookup
+	capk_store.loaded = true;
+	return capk_store.count;
+}
+
+const struct emv_pk *emv_pk_store_get(const unsigned char *rid, unsigned char idx, bool verbose)
+{
+	if (!capk_store.loaded)
+		emv_pk_store_load(NULL);
+	if (!capk_store.index)
+		return NULL;
+
+	int e = *emv_pk_store_slot(rid, idx);
+	if (e < 0)
+		return NULL;
+
+	const struct emv_pk_store_entry *entry = &capk_store.entries[e];
+	if (verbose)
+		printf("Verifying CA PK for %02hhx:%02hhx:%02hhx:%02hhx:%02hhx IDX %02hhx %zd bits...%s\n",
+				rid[0],
+				rid[1],
+				rid[2],
+				rid[3],
+				rid[4],
+				idx,
+				entry->pk->mlen * 8,
+				entry->verified ? "OK" : "Failed!");
+
+	return entry->verified ? entry->pk : NULL;
+}
+
+struct emv_pk *emv_pk_clone(const struct emv_pk *pk)
+{
 	if (!pk)
 		return NULL;
 
-	printf("Verifying CA PK for %02hhx:%02hhx:%02hhx:%02hhx:%02hhx IDX %02hhx %zd bits...",
-				pk->rid[0],
-				pk->rid[1],
-				pk->rid[2],
-				pk->rid[3],
-				pk->rid[4],
-				pk->index,
-				pk->mlen * 8);
-	if (emv_pk_verify(pk)) {
-		printf("OK\n");
-
-		return pk;
-	}
+	struct emv_pk *r = emv_pk_new(pk->mlen, pk->elen);
+	if (!r)
+		return NULL;
 
-	printf("Failed!\n");
-	emv_pk_free(pk);
+	unsigned char *modulus = r->modulus;
+	memcpy(r, pk, sizeof(*r));
+	r->modulus = modulus;
+	r->cp = NULL;
+	memcpy(r->modulus, pk->modulus, pk->mlen);
 
-	return NULL;
+	return r;
+}
+
+struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx)
+{
+	return emv_pk_clone(emv_pk_store_get(rid, idx, true));
 }
@@ -19,6 +19,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+struct crypto_pk;
+
 struct emv_pk {
 	unsigned char rid[5];
 	unsigned char index;
@@ -32,6 +34,7 @@ struct emv_pk {
 	size_t mlen;
 	unsigned char *modulus;
 	unsigned int expire;
+	struct crypto_pk *cp;	/* opened by emv_pk_prepare(), NULL: opened on every use */
 };
 
 #define EXPIRE(yy, mm, dd)	0x ## yy ## mm ## dd
@@ -41,8 +44,19 @@ struct emv_pk *emv_pk_new(size_t modlen, size_t explen);
 void emv_pk_free(struct emv_pk *pk);
 char *emv_pk_dump_pk(const struct emv_pk *pk);
 bool emv_pk_verify(const struct emv_pk *pk);
+bool emv_pk_prepare(struct emv_pk *pk);
 
 char *emv_pk_get_ca_pk_file(const char *dirname, const unsigned char *rid, unsigned char idx);
 char *emv_pk_get_ca_pk_rid_file(const char *dirname, const unsigned char *rid);
 struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx);
+struct emv_pk *emv_pk_clone(const struct emv_pk *pk);
+
+/* CA public key store, loaded and hash checked once.
+ * emv_pk_store_get() loads emv/capk.txt on first use and returns a key
+ * owned by the store, NULL if it is unknown or failed the hash check.
+ * Store keys are prepared, so their Montgomery constants are computed once.
+ */
+int emv_pk_store_load(const char *fname);
+const struct emv_pk *emv_pk_store_get(const unsigned char *rid, unsigned char idx, bool verbose);
+void emv_pk_store_free(void);
 #endif
@@ -19,8 +19,8 @@
 
 #include "emv_pki.h"
 #include "crypto.h"
-#include "dump.h"
 #include "util.h"
+#include "ui.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,6 +32,26 @@ static const struct tlv empty_tlv = {.tag = 0x0, .len = 0, .value = empty_tlv_va
 
 static size_t emv_pki_hash_psn[256] = { 0, 0, 11, 2, 17, 2, };
 
+// dump_buffer() layout,  through PrintAndLogEx so muted workers stay quiet
+static void emv_pki_dump(const unsigned char *data, size_t len)
+{
+	char line[100];
+	for (size_t i = 0; i < len; i += 16) {
+		int pos = snprintf(line, sizeof(line), "\t%02zx:", i);
+		for (size_t j = 0; j < 16; j++) {
+			if (i + j < len)
+				pos += snprintf(line + pos, sizeof(line) - pos, " %02hhx", data[i + j]);
+			else
+				pos += snprintf(line + pos, sizeof(line) - pos, "   ");
+		}
+		pos += snprintf(line + pos, sizeof(line) - pos, " |");
+		for (size_t j = 0; j < 16 && i + j < len; j++)
+			line[pos++] = (data[i + j] >= 0x20 && data[i + j] < 0x7f) ? data[i + j] : '.';
+		line[pos] = 0;
+		PrintAndLogEx(NORMAL, "%s", line);
+	}
+}
+
 static unsigned char *emv_pki_decode_message(const struct emv_pk *enc_pk,
 		uint8_t msgtype,
 		size_t *len,
@@ -48,37 +68,42 @@ static unsigned char *emv_pki_decode_message(const struct emv_pk *enc_pk,
 		return NULL;
 
 	if (!cert_tlv) {
-		printf("ERROR: Can't find certificate\n");
+		PrintAndLogEx(NORMAL, "ERROR: Can't find certificate");
 		return NULL;
 	}
 
 	if (cert_tlv->len != enc_pk->mlen) {
-		printf("ERROR: Certificate length (%zu) not equal key length (%zu)\n", cert_tlv->len, enc_pk->mlen);
+		PrintAndLogEx(NORMAL, "ERROR: Certificate length (%zu) not equal key length (%zu)", cert_tlv->len, enc_pk->mlen);
 		return NULL;
 	}
-	kcp = crypto_pk_open(enc_pk->pk_algo,
-			enc_pk->modulus, enc_pk->mlen,
-			enc_pk->exp, enc_pk->elen);
+	kcp = enc_pk->cp;
+	if (!kcp)
+		kcp = crypto_pk_open(enc_pk->pk_algo,
+				enc_pk->modulus, enc_pk->mlen,
+				enc_pk->exp, enc_pk->elen);
 	if (!kcp)
 		return NULL;
 
 	data = crypto_pk_encrypt(kcp, cert_tlv->value, cert_tlv->len, &data_len);
-	crypto_pk_close(kcp);
+	if (kcp != enc_pk->cp)
+		crypto_pk_close(kcp);
+	if (!data)
+		return NULL;
 
 /*	if (true){
-		printf("Recovered data:\n");
-		dump_buffer(data, data_len, stdout, 0);
+		PrintAndLogEx(NORMAL, "Recovered data:");
+		emv_pki_dump(data, data_len);
 	}*/
 	
 	if (data[data_len-1] != 0xbc || data[0] != 0x6a || data[1] != msgtype) {
-		printf("ERROR: Certificate format\n");
+		PrintAndLogEx(NORMAL, "ERROR: Certificate format");
 		free(data);
 		return NULL;
 	}
 
 	size_t hash_pos = emv_pki_hash_psn[msgtype];
 	if (hash_pos == 0 || hash_pos > data_len){
-		printf("ERROR: Cant get hash position in the certificate\n");
+		PrintAndLogEx(NORMAL, "ERROR: Cant get hash position in the certificate");
 		free(data);
 		return NULL;
 	}
@@ -86,7 +111,7 @@ static unsigned char *emv_pki_decode_message(const struct emv_pk *enc_pk,
 	struct crypto_hash *ch;
 	ch = crypto_hash_open(data[hash_pos]);
 	if (!ch) {
-		printf("ERROR: Cant do hash\n");
+		PrintAndLogEx(NORMAL, "ERROR: Cant do hash");
 		free(data);
 		return NULL;
 	}
@@ -105,9 +130,9 @@ static unsigned char *emv_pki_decode_message(const struct emv_pk *enc_pk,
 	va_end(vl);
 
 	if (memcmp(data + data_len - 1 - hash_len, crypto_hash_read(ch), hash_len)) {
-		printf("ERROR: Calculated wrong hash\n");
-		printf("decoded:    %s\n",sprint_hex(data + data_len - 1 - hash_len, hash_len));
-		printf("calculated: %s\n",sprint_hex(crypto_hash_read(ch), hash_len));
+		PrintAndLogEx(NORMAL, "ERROR: Calculated wrong hash");
+		PrintAndLogEx(NORMAL, "decoded:    %s",sprint_hex(data + data_len - 1 - hash_len, hash_len));
+		PrintAndLogEx(NORMAL, "calculated: %s",sprint_hex(crypto_hash_read(ch), hash_len));
 		crypto_hash_close(ch);
 		free(data);
 		return NULL;
@@ -176,7 +201,7 @@ static struct emv_pk *emv_pki_decode_key_ex(const struct emv_pk *enc_pk,
 	else if (msgtype == 4)
 		pan_length = 10;
 	else {
-		printf("ERROR: Message type must be 2 or 4\n");
+		PrintAndLogEx(NORMAL, "ERROR: Message type must be 2 or 4");
 		return NULL;
 	}
 
@@ -187,13 +212,13 @@ static struct emv_pk *emv_pki_decode_key_ex(const struct emv_pk *enc_pk,
 			add_tlv,
 			NULL);
 	if (!data || data_len < 11 + pan_length) {
-		printf("ERROR: Can't decode message\n");
+		PrintAndLogEx(NORMAL, "ERROR: Can't decode message");
 		return NULL;
 	}
 
 	if (showData){ 
-		printf("Recovered data:\n");
-		dump_buffer(data, data_len, stdout, 0);
+		PrintAndLogEx(NORMAL, "Recovered data:");
+		emv_pki_dump(data, data_len);
 	}
 
 	/* Perform the rest of checks here */
@@ -208,7 +233,7 @@ static struct emv_pk *emv_pki_decode_key_ex(const struct emv_pk *enc_pk,
 
 	if (((msgtype == 2) && (pan2_len < 4 || pan2_len > pan_len)) ||
 	    ((msgtype == 4) && (pan2_len != pan_len))) {
-		printf("ERROR: Invalid PAN lengths\n");
+		PrintAndLogEx(NORMAL, "ERROR: Invalid PAN lengths");
 		free(data);
 
 		return NULL;
@@ -217,9 +242,9 @@ static struct emv_pk *emv_pki_decode_key_ex(const struct emv_pk *enc_pk,
 	unsigned i;
 	for (i = 0; i < pan2_len; i++)
 		if (emv_cn_get(pan_tlv, i) != emv_cn_get(&pan2_tlv, i)) {
-			printf("ERROR: PAN data mismatch\n");
-			printf("tlv  pan=%s\n", sprint_hex(pan_tlv->value, pan_tlv->len));
-			printf("cert pan=%s\n", sprint_hex(pan2_tlv.value, pan2_tlv.len));
+			PrintAndLogEx(NORMAL, "ERROR: PAN data mismatch");
+			PrintAndLogEx(NORMAL, "tlv  pan=%s", sprint_hex(pan_tlv->value, pan_tlv->len));
+			PrintAndLogEx(NORMAL, "cert pan=%s", sprint_hex(pan2_tlv.value, pan2_tlv.len));
 			free(data);
 
 			return NULL;
@@ -227,7 +252,7 @@ static struct emv_pk *emv_pki_decode_key_ex(const struct emv_pk *enc_pk,
 
 	pk_len = data[9 + pan_length];
 	if (pk_len > data_len - 11 - pan_length + rem_tlv->len) {
-		printf("ERROR: Invalid pk length\n");
+		PrintAndLogEx(NORMAL, "ERROR: Invalid pk length");
 		free(data);
 		return NULL;
 	}
@@ -258,6 +283,9 @@ static struct emv_pk *emv_pki_decode_key_ex(const struct emv_pk *enc_pk,
 
 	free(data);
 
+	/* issuer key verifies the ICC certificate and SSAD, ICC key the SDAD */
+	emv_pk_prepare(pk);
+
 	return pk;
 }
 
@@ -314,8 +342,8 @@ struct tlvdb *emv_pki_recover_dac_ex(const struct emv_pk *enc_pk, const struct t
 		return NULL;
 
 	if (showData){
-		printf("Recovered data:\n");
-		dump_buffer(data, data_len, stdout, 0);
+		PrintAndLogEx(NORMAL, "Recovered data:");
+		emv_pki_dump(data, data_len);
 	}
 
 	struct tlvdb *dac_db = tlvdb_fixed(0x9f45, 2, data+3);
@@ -349,8 +377,8 @@ struct tlvdb *emv_pki_recover_idn_ex(const struct emv_pk *enc_pk, const struct t
 	}
 
 	if (showData){
-		printf("Recovered data:\n");
-		dump_buffer(data, data_len, stdout, 0);
+		PrintAndLogEx(NORMAL, "Recovered data:");
+		emv_pki_dump(data, data_len);
 	}
 
 	size_t idn_len = data[4];
@@ -387,8 +415,8 @@ struct tlvdb *emv_pki_recover_atc_ex(const struct emv_pk *enc_pk, const struct t
 	}
 
 	if (showData){
-		printf("Recovered data:\n");
-		dump_buffer(data, data_len, stdout, 0);
+		PrintAndLogEx(NORMAL, "Recovered data:");
+		emv_pki_dump(data, data_len);
 	}
 
 	size_t idn_len = data[4];
@@ -451,23 +479,23 @@ struct tlvdb *emv_pki_perform_cda_ex(const struct emv_pk *enc_pk, const struct t
 			un_tlv,
 			NULL);
 	if (!data || data_len < 3) {
-		printf("ERROR: can't decode message. len %zu\n", data_len);
+		PrintAndLogEx(NORMAL, "ERROR: can't decode message. len %zu", data_len);
 		return NULL;
 	}
 
 	if (showData){
-		printf("Recovered data:\n");
-		dump_buffer(data, data_len, stdout, 0);
+		PrintAndLogEx(NORMAL, "Recovered data:");
+		emv_pki_dump(data, data_len);
 	}
 
 	if (data[3] < 30 || data[3] > data_len - 4) {
-		printf("ERROR: Invalid data length\n");
+		PrintAndLogEx(NORMAL, "ERROR: Invalid data length");
 		free(data);
 		return NULL;
 	}
 
 	if (!cid_tlv || cid_tlv->len != 1 || cid_tlv->value[0] != data[5 + data[4]]) {
-		printf("ERROR: CID mismatch\n");
+		PrintAndLogEx(NORMAL, "ERROR: CID mismatch");
 		free(data);
 		return NULL;
 	}
@@ -475,7 +503,7 @@ struct tlvdb *emv_pki_perform_cda_ex(const struct emv_pk *enc_pk, const struct t
 	struct crypto_hash *ch;
 	ch = crypto_hash_open(enc_pk->hash_algo);
 	if (!ch) {
-		printf("ERROR: can't create hash\n");
+		PrintAndLogEx(NORMAL, "ERROR: can't create hash");
 		free(data);
 		return NULL;
 	}
@@ -490,7 +518,7 @@ struct tlvdb *emv_pki_perform_cda_ex(const struct emv_pk *enc_pk, const struct t
 	tlvdb_visit(this_db, tlv_hash, ch, 0);
 
 	if (memcmp(data + 5 + data[4] + 1 + 8, crypto_hash_read(ch), 20)) {
-		printf("ERROR: calculated hash error\n");
+		PrintAndLogEx(NORMAL, "ERROR: calculated hash error");
 		crypto_hash_close(ch);
 		free(data);
 		return NULL;
@@ -499,7 +527,7 @@ struct tlvdb *emv_pki_perform_cda_ex(const struct emv_pk *enc_pk, const struct t
 
 	size_t idn_len = data[4];
 	if (idn_len > data[3] - 1) {
-		printf("ERROR: Invalid IDN length\n");
+		PrintAndLogEx(NORMAL, "ERROR: Invalid IDN length");
 		free(data);
 		return NULL;
 	}
@@ -9,6 +9,8 @@
 //-----------------------------------------------------------------------------
 
 #include "emvcore.h"
+#include "emvreplay.h"
+#include "emvsim.h"
 
 // Got from here. Thanks)
 // https://eftlab.co.uk/index.php/site-map/knowledge-base/211-emv-aid-rid-pix
@@ -86,6 +88,16 @@ void SetAPDULogging(bool logging) {
 	APDULogging = logging;
 }
 
+static __thread struct emv_replay_run *APDUReplay = NULL;
+void SetAPDUReplay(struct emv_replay_run *run) {
+	APDUReplay = run;
+}
+
+static __thread struct emv_sim_card *APDUSim = NULL;
+void SetAPDUSim(struct emv_sim_card *card) {
+	APDUSim = card;
+}
+
 enum CardPSVendor GetCardPSVendor(uint8_t * AID, size_t AIDlen) {
 	char buf[100] = {0};
 	if (AIDlen < 1)
@@ -113,7 +125,7 @@ static bool print_cb(void *data, const struct tlv *tlv, int level, bool is_leaf)
 
 void TLVPrintFromBuffer(uint8_t *data, int datalen) {
 	struct tlvdb *t = NULL;
-	t = tlvdb_parse_multi(data, datalen);
+	t = tlvdb_parse_multi_ex(data, datalen, TLVDB_MULTI | TLVDB_NOCOPY);
 	if (t) {
 		PrintAndLogEx(NORMAL, "-------------------- TLV decoded --------------------");
 		
@@ -228,7 +240,7 @@ int EMVExchangeEx(bool ActivateField, bool LeaveFieldON, sAPDU apdu, uint8_t *Re
 	if (sw)	*sw = 0;
 	uint16_t isw = 0;
 	
-	if (ActivateField)
+	if (ActivateField && !APDUReplay && !APDUSim)
 		DropField();
 	
 	// COMPUTE APDU
@@ -240,7 +252,13 @@ int EMVExchangeEx(bool ActivateField, bool LeaveFieldON, sAPDU apdu, uint8_t *Re
 		PrintAndLogEx(NORMAL, ">>>> %s", sprint_hex(data, 6 + apdu.Lc));
 
 	// 6 byes + data = INS + CLA + P1 + P2 + Lc + <data = Nc> + Le
-	int res = ExchangeAPDU14a(data, 6 + apdu.Lc, ActivateField, LeaveFieldON, Result, (int)MaxResultLen, (int *)ResultLen);
+	int res;
+	if (APDUReplay)
+		res = EMVReplayExchange(APDUReplay, data, 6 + apdu.Lc, Result, MaxResultLen, ResultLen);
+	else if (APDUSim)
+		res = EMVSimExchange(APDUSim, data, 6 + apdu.Lc, Result, MaxResultLen, ResultLen);
+	else
+		res = ExchangeAPDU14a(data, 6 + apdu.Lc, ActivateField, LeaveFieldON, Result, (int)MaxResultLen, (int *)ResultLen);
 	
 	if (res) {
 		return res;
@@ -367,45 +385,132 @@ int EMVSearchPSE(bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct t
 	return res;
 }
 
-int EMVSearch(bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct tlvdb *tlv) {
+// SELECT of AIDlist[i],  retried on link errors.  1 on a proxmark error
+static int EMVSearchOne(int i, bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct tlvdb *tlv) {
 	uint8_t aidbuf[APDU_AID_LEN] = {0};
 	int aidlen = 0;
 	uint8_t data[APDU_RES_LEN] = {0};
 	size_t datalen = 0;
 	uint16_t sw = 0;
-	
 	int res = 0;
-	int retrycnt = 0;
-	for(int i = 0; i < AIDlistLen; i ++) {
-		param_gethex_to_eol(AIDlist[i].aid, 0, aidbuf, sizeof(aidbuf), &aidlen);
-		res = EMVSelect((i == 0) ? ActivateField : false, (i == AIDlistLen - 1) ? LeaveFieldON : true, aidbuf, aidlen, data, sizeof(data), &datalen, &sw, tlv);
+
+	param_gethex_to_eol(AIDlist[i].aid, 0, aidbuf, sizeof(aidbuf), &aidlen);
+	for (int retrycnt = 0; retrycnt < 3; retrycnt++) {
+		res = EMVSelect(ActivateField, LeaveFieldON, aidbuf, aidlen, data, sizeof(data), &datalen, &sw, tlv);
 		// retry if error and not returned sw error
-		if (res && res != 5) {
-			if (++retrycnt < 3){
-				i--;
-			} else {
-				// card select error, proxmark error
-				if (res == 1) {
-					PrintAndLogEx(WARNING, "Exit...");
-					return 1;
-				}
-				
-				retrycnt = 0;
-				PrintAndLogEx(FAILED, "Retry failed [%s]. Skiped...", AIDlist[i].aid);
-			}
-			continue;
+		if (!res || res == 5)
+			break;
+	}
+
+	if (res && res != 5) {
+		// card select error, proxmark error
+		if (res == 1) {
+			PrintAndLogEx(WARNING, "Exit...");
+			return 1;
 		}
-		retrycnt = 0;
-		
-		if (res)
-			continue;
-		
-		if (decodeTLV){
-			PrintAndLogEx(NORMAL, "%s:", AIDlist[i].aid);
-			TLVPrintFromBuffer(data, datalen);
+		PrintAndLogEx(FAILED, "Retry failed [%s]. Skiped...", AIDlist[i].aid);
+		return 0;
+	}
+
+	if (!res && decodeTLV) {
+		PrintAndLogEx(NORMAL, "%s:", AIDlist[i].aid);
+		TLVPrintFromBuffer(data, datalen);
+	}
+	return 0;
+}
+
+int EMVSearchEach(bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct tlvdb *tlv) {
+	for(int i = 0; i < AIDlistLen; i ++) {
+		if (EMVSearchOne(i, (i == 0) ? ActivateField : false, (i == AIDlistLen - 1) ? LeaveFieldON : true, decodeTLV, tlv))
+			return 1;
+	}
+
+	return 0;
+}
+
+// an application the probe found,  handled as EMVExchangeEx() does a 9000 answer
+static void EMVSearchHit(int i, uint8_t *data, size_t datalen, bool decodeTLV, struct tlvdb *tlv) {
+	if (APDULogging) {
+		uint8_t apdu[6 + APDU_AID_LEN] = {0x00, 0xa4, 0x04, 0x00};
+		int aidlen = 0;
+		param_gethex_to_eol(AIDlist[i].aid, 0, apdu + 5, APDU_AID_LEN, &aidlen);
+		apdu[4] = aidlen;
+		PrintAndLogEx(NORMAL, ">>>> %s", sprint_hex(apdu, 6 + aidlen));
+		PrintAndLogEx(NORMAL, "<<<< %s90 00 ", sprint_hex(data, datalen));
+	}
+
+	if (tlv) {
+		struct tlvdb *t = tlvdb_parse_multi(data, datalen);
+		tlvdb_add(tlv, t);
+	}
+
+	if (decodeTLV) {
+		PrintAndLogEx(NORMAL, "%s:", AIDlist[i].aid);
+		TLVPrintFromBuffer(data, datalen);
+	}
+}
+
+// the proxmark SELECTs the whole AIDlist by itself and only sends back the hits
+int EMVSearch(bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct tlvdb *tlv) {
+	uint8_t list[USB_CMD_DATA_SIZE];
+	uint8_t hits[USB_CMD_DATA_SIZE];
+	int first = 0;
+
+	if (APDUReplay)
+		return EMVSearchEach(ActivateField, LeaveFieldON, decodeTLV, tlv);
+
+	if (ActivateField && !APDUSim)
+		DropField();
+
+	while (first < AIDlistLen) {
+		// as many AIDs as fit one command
+		size_t listlen = 0;
+		int n = 0;
+		while (first + n < AIDlistLen && n < AIDPROBE_MAX_COUNT) {
+			uint8_t aidbuf[APDU_AID_LEN] = {0};
+			int aidlen = 0;
+			param_gethex_to_eol(AIDlist[first + n].aid, 0, aidbuf, sizeof(aidbuf), &aidlen);
+			if (listlen + 1 + aidlen > sizeof(list))
+				break;
+			list[listlen++] = aidlen;
+			memcpy(list + listlen, aidbuf, aidlen);
+			listlen += aidlen;
+			n++;
+		}
+
+		int hitslen = 0, status = AIDPROBE_OK;
+		int probed;
+		if (APDUSim)
+			probed = EMVSimProbe(APDUSim, list, listlen, hits, &hitslen, &status);
+		else
+			probed = ExchangeAIDProbe14a(list, listlen, n, ActivateField, hits, &hitslen, &status);
+		if (probed < 0 || status == AIDPROBE_FORMAT) {
+			PrintAndLogEx(WARNING, "Exit...");
+			return 1;
+		}
+		ActivateField = false;
+
+		for (int pos = 0; pos + 3 <= hitslen; ) {
+			size_t datalen = hits[pos + 1] | (hits[pos + 2] << 8);
+			if (pos + 3 + datalen > hitslen)
+				break;
+			EMVSearchHit(first + hits[pos], hits + pos + 3, datalen, decodeTLV, tlv);
+			pos += 3 + datalen;
+		}
+
+		first += probed;
+
+		// no answer to this one,  it gets the retries of a plain SELECT
+		if (status == AIDPROBE_LINK && first < AIDlistLen) {
+			if (EMVSearchOne(first, false, true, decodeTLV, tlv))
+				return 1;
+			first++;
 		}
 	}
 
+	if (!LeaveFieldON && !APDUSim)
+		DropField();
+
 	return 0;
 }
 
@@ -473,7 +578,7 @@ int MSCComputeCryptoChecksum(bool LeaveFieldON, uint8_t *UDOL, uint8_t UDOLlen,
 }
 
 // Authentication 
-static struct emv_pk *get_ca_pk(struct tlvdb *db) {
+static const struct emv_pk *get_ca_pk(struct tlvdb *db) {
 	const struct tlv *df_tlv = tlvdb_get(db, 0x84, NULL);
 	const struct tlv *caidx_tlv = tlvdb_get(db, 0x8f, NULL);
 
@@ -481,12 +586,49 @@ static struct emv_pk *get_ca_pk(struct tlvdb *db) {
 		return NULL;
 
 	PrintAndLogEx(NORMAL, "CA public key index 0x%0x", caidx_tlv->value[0]);
-	return emv_pk_get_ca_pk(df_tlv->value, caidx_tlv->value[0]);
+	return emv_pk_store_get(df_tlv->value, caidx_tlv->value[0], !PrintAndLogMuted());
+}
+
+// EMV 4.3 book3 10.3, page 96
+// records of SFI 1..10 add the value of their 70 template,  others the whole record
+bool ODAiListAddRecord(uint8_t SFI, const uint8_t *rec, size_t reclen, uint8_t *ODAiList, size_t *ODAiListLen, size_t ODAiListMax) {
+	if (SFI < 11) {
+		const unsigned char *abuf = rec;
+		size_t elmlen = reclen;
+		struct tlv e;
+		if (!tlv_parse_tl(&abuf, &elmlen, &e) || e.tag != 0x70)
+			return false;
+		rec += reclen - elmlen;
+		reclen = elmlen;
+	}
+
+	if (*ODAiListLen + reclen > ODAiListMax)
+		return false;
+
+	memcpy(&ODAiList[*ODAiListLen], rec, reclen);
+	*ODAiListLen += reclen;
+	return true;
+}
+
+// the list goes to the tree as tag 21 (not a standard tag).
+// 9F4A Static Data Authentication Tag List adds the AIP,  the only tag allowed in it.
+void ODAiListAddToTLV(struct tlvdb *tlv, uint8_t *ODAiList, size_t ODAiListLen, size_t ODAiListMax) {
+	const struct tlv *sdatl = tlvdb_get(tlv, 0x9f4a, NULL);
+	const struct tlv *aip = tlvdb_get(tlv, 0x82, NULL);
+	if (sdatl && sdatl->len == 1 && sdatl->value[0] == 0x82 && aip && ODAiListLen + aip->len <= ODAiListMax) {
+		memcpy(&ODAiList[ODAiListLen], aip->value, aip->len);
+		ODAiListLen += aip->len;
+	}
+
+	if (ODAiListLen) {
+		tlvdb_add(tlv, tlvdb_fixed(0x21, ODAiListLen, ODAiList));
+		PrintAndLogEx(NORMAL, "* Input list for Offline Data Authentication added to TLV. len=%d \n", ODAiListLen);
+	}
 }
 
 int trSDA(struct tlvdb *tlv) {
 
-	struct emv_pk *pk = get_ca_pk(tlv);
+	const struct emv_pk *pk = get_ca_pk(tlv);
 	if (!pk) {
 		PrintAndLogEx(WARNING, "Error: Key not found. Exit.");
 		return 2;
@@ -494,7 +636,6 @@ int trSDA(struct tlvdb *tlv) {
 	
 	struct emv_pk *issuer_pk = emv_pki_recover_issuer_cert(pk, tlv);
 	if (!issuer_pk) {
-		emv_pk_free(pk);
 		PrintAndLogEx(WARNING, "Error: Issuer certificate not found. Exit.");
 		return 2;
 	}
@@ -514,7 +655,6 @@ int trSDA(struct tlvdb *tlv) {
 	const struct tlv *sda_tlv = tlvdb_get(tlv, 0x21, NULL);
 	if (!sda_tlv || sda_tlv->len < 1) {
 		emv_pk_free(issuer_pk);
-		emv_pk_free(pk);
 		PrintAndLogEx(WARNING, "Error: Can't find input list for Offline Data Authentication. Exit.");
 		return 3;
 	}
@@ -526,13 +666,11 @@ int trSDA(struct tlvdb *tlv) {
 		tlvdb_add(tlv, dac_db);
 	} else {
 		emv_pk_free(issuer_pk);
-		emv_pk_free(pk);
 		PrintAndLogEx(WARNING, "Error: SSAD verify error");
 		return 4;
 	}
 	
 	emv_pk_free(issuer_pk);
-	emv_pk_free(pk);
 	return 0;
 }
 
@@ -544,7 +682,7 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 	size_t len = 0;
 	uint16_t sw = 0;
 
-	struct emv_pk *pk = get_ca_pk(tlv);
+	const struct emv_pk *pk = get_ca_pk(tlv);
 	if (!pk) {
 		PrintAndLogEx(WARNING, "Error: Key not found. Exit.");
 		return 2;
@@ -552,14 +690,12 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 
 	const struct tlv *sda_tlv = tlvdb_get(tlv, 0x21, NULL);
 	if (!sda_tlv || sda_tlv->len < 1) {
-		emv_pk_free(pk);
 		PrintAndLogEx(WARNING, "Error: Can't find input list for Offline Data Authentication. Exit.");
 		return 3;
 	}
 
 	struct emv_pk *issuer_pk = emv_pki_recover_issuer_cert(pk, tlv);
 	if (!issuer_pk) {
-		emv_pk_free(pk);
 		PrintAndLogEx(WARNING, "Error: Issuer certificate not found. Exit.");
 		return 2;
 	}
@@ -577,7 +713,6 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 				
 	struct emv_pk *icc_pk = emv_pki_recover_icc_cert(issuer_pk, tlv, sda_tlv);
 	if (!icc_pk) {
-		emv_pk_free(pk);
 		emv_pk_free(issuer_pk);
 		PrintAndLogEx(WARNING, "Error: ICC setrificate not found. Exit.");
 		return 2;
@@ -618,10 +753,9 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 	if (sdad_tlv) {
 		PrintAndLogEx(NORMAL, "\n* * Got Signed Dynamic Application Data (9F4B) form GPO. Maybe fDDA...");
 
-		const struct tlvdb *atc_db = emv_pki_recover_atc_ex(icc_pk, tlv, true);
+		struct tlvdb *atc_db = emv_pki_recover_atc_ex(icc_pk, tlv, !PrintAndLogMuted());
 		if (!atc_db) {
 			PrintAndLogEx(WARNING, "Error: Can't recover IDN (ICC Dynamic Number)");
-			emv_pk_free(pk);
 			emv_pk_free(issuer_pk);
 			emv_pk_free(icc_pk);
 			return 8;
@@ -639,9 +773,10 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 			} else {
 				PrintAndLogEx(WARNING, "Error: fDDA verified, but ATC in the certificate and ATC in the record not the same.");
 			}
+			tlvdb_free(atc_db);
 		} else {
 			PrintAndLogEx(NORMAL, "\nERROR: fDDA (fast DDA) verify error");
-			emv_pk_free(pk);
+			tlvdb_free(atc_db);
 			emv_pk_free(issuer_pk);
 			emv_pk_free(icc_pk);
 			return 9;
@@ -654,7 +789,6 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 			tlvdb_add(tlv, dac_db);
 		} else {
 			PrintAndLogEx(WARNING, "Error: SSAD verify error");
-			emv_pk_free(pk);
 			emv_pk_free(issuer_pk);
 			emv_pk_free(icc_pk);
 			return 4;
@@ -670,7 +804,6 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 		struct tlv *ddol_data_tlv = dol_process(ddol_tlv, tlv, 0);
 		if (!ddol_data_tlv) {
 			PrintAndLogEx(WARNING, "Error: Can't create DDOL TLV");
-			emv_pk_free(pk);
 			emv_pk_free(issuer_pk);
 			emv_pk_free(icc_pk);
 			return 5;
@@ -683,7 +816,6 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 		if (res) {	
 			PrintAndLogEx(WARNING, "Internal Authenticate error(%d): %4x. Exit...", res, sw);
 			free(ddol_data_tlv);
-			emv_pk_free(pk);
 			emv_pk_free(issuer_pk);
 			emv_pk_free(icc_pk);
 			return 6;
@@ -707,7 +839,6 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 			if(!dda_db) {
 				PrintAndLogEx(WARNING, "Error: Can't parse Internal Authenticate result as TLV");
 				free(ddol_data_tlv);
-				emv_pk_free(pk);
 				emv_pk_free(issuer_pk);
 				emv_pk_free(icc_pk);
 				return 7;
@@ -718,17 +849,15 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 				TLVPrintFromTLV(dda_db);
 		}
 
-		struct tlvdb *idn_db = emv_pki_recover_idn_ex(icc_pk, dda_db, ddol_data_tlv, true);
+		// dda_db is part of the tree now,  freed with it
+		struct tlvdb *idn_db = emv_pki_recover_idn_ex(icc_pk, dda_db, ddol_data_tlv, !PrintAndLogMuted());
 		free(ddol_data_tlv);
 		if (!idn_db) {
 			PrintAndLogEx(WARNING, "Error: Can't recover IDN (ICC Dynamic Number)");
-			tlvdb_free(dda_db);
-			emv_pk_free(pk);
 			emv_pk_free(issuer_pk);
 			emv_pk_free(icc_pk);
 			return 8;
 		}
-		tlvdb_free(dda_db);
 
 		// 9f4c ICC Dynamic Number
 		const struct tlv *idn_tlv = tlvdb_get(idn_db, 0x9f4c, NULL);
@@ -736,19 +865,16 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 			PrintAndLogEx(NORMAL, "\nIDN (ICC Dynamic Number) [%zu] %s", idn_tlv->len, sprint_hex_inrow(idn_tlv->value, idn_tlv->len));
 			PrintAndLogEx(NORMAL, "DDA verified OK.");
 			tlvdb_add(tlv, idn_db);
-			tlvdb_free(idn_db);
 		} else {
 			PrintAndLogEx(NORMAL, "\nERROR: DDA verify error");
 			tlvdb_free(idn_db);
 
-			emv_pk_free(pk);
 			emv_pk_free(issuer_pk);
 			emv_pk_free(icc_pk);
 			return 9;
 		}
 	}
 	
-	emv_pk_free(pk);
 	emv_pk_free(issuer_pk);
 	emv_pk_free(icc_pk);
 	return 0;
@@ -756,7 +882,7 @@ int trDDA(bool decodeTLV, struct tlvdb *tlv) {
 
 int trCDA(struct tlvdb *tlv, struct tlvdb *ac_tlv, struct tlv *pdol_data_tlv, struct tlv *ac_data_tlv) {
 
-	struct emv_pk *pk = get_ca_pk(tlv);
+	const struct emv_pk *pk = get_ca_pk(tlv);
 	if (!pk) {
 		PrintAndLogEx(WARNING, "Error: Key not found. Exit.");
 		return 2;
@@ -765,14 +891,12 @@ int trCDA(struct tlvdb *tlv, struct tlvdb *ac_tlv, struct tlv *pdol_data_tlv, st
 	const struct tlv *sda_tlv = tlvdb_get(tlv, 0x21, NULL);
 	if (!sda_tlv || sda_tlv->len < 1) {
 		PrintAndLogEx(WARNING, "Error: Can't find input list for Offline Data Authentication. Exit.");
-		emv_pk_free(pk);
 		return 3;
 	}
 
 	struct emv_pk *issuer_pk = emv_pki_recover_issuer_cert(pk, tlv);
 	if (!issuer_pk) {
 		PrintAndLogEx(WARNING, "Error: Issuer certificate not found. Exit.");
-		emv_pk_free(pk);
 		return 2;
 	}
 	PrintAndLogEx(SUCCESS, "Issuer PK recovered. RID %02hhx:%02hhx:%02hhx:%02hhx:%02hhx IDX %02hhx CSN %02hhx:%02hhx:%02hhx\n",
@@ -790,7 +914,6 @@ int trCDA(struct tlvdb *tlv, struct tlvdb *ac_tlv, struct tlv *pdol_data_tlv, st
 	struct emv_pk *icc_pk = emv_pki_recover_icc_cert(issuer_pk, tlv, sda_tlv);
 	if (!icc_pk) {
 		PrintAndLogEx(WARNING, "Error: ICC setrificate not found. Exit.");
-		emv_pk_free(pk);
 		emv_pk_free(issuer_pk);
 		return 2;
 	}
@@ -806,17 +929,19 @@ int trCDA(struct tlvdb *tlv, struct tlvdb *ac_tlv, struct tlv *pdol_data_tlv, st
 			icc_pk->serial[2]
 			);
 
-	struct tlvdb *dac_db = emv_pki_recover_dac(issuer_pk, tlv, sda_tlv);
-	if (dac_db) {
-		const struct tlv *dac_tlv = tlvdb_get(dac_db, 0x9f45, NULL);
-		PrintAndLogEx(NORMAL, "SSAD verified OK. (%02hhx:%02hhx)", dac_tlv->value[0], dac_tlv->value[1]);
-		tlvdb_add(tlv, dac_db);
-	} else {
-		PrintAndLogEx(WARNING, "Error: SSAD verify error");
-		emv_pk_free(pk);
-		emv_pk_free(issuer_pk);
-		emv_pk_free(icc_pk);
-		return 4;
+	// the ICC certificate already covers the static data,  SSAD is optional with CDA
+	if (tlvdb_get(tlv, 0x93, NULL)) {
+		struct tlvdb *dac_db = emv_pki_recover_dac(issuer_pk, tlv, sda_tlv);
+		if (dac_db) {
+			const struct tlv *dac_tlv = tlvdb_get(dac_db, 0x9f45, NULL);
+			PrintAndLogEx(NORMAL, "SSAD verified OK. (%02hhx:%02hhx)", dac_tlv->value[0], dac_tlv->value[1]);
+			tlvdb_add(tlv, dac_db);
+		} else {
+			PrintAndLogEx(WARNING, "Error: SSAD verify error");
+			emv_pk_free(issuer_pk);
+			emv_pk_free(icc_pk);
+			return 4;
+		}
 	}
 	
 	PrintAndLogEx(NORMAL, "\n* * Check Signed Dynamic Application Data (SDAD)");
@@ -824,7 +949,7 @@ int trCDA(struct tlvdb *tlv, struct tlvdb *ac_tlv, struct tlv *pdol_data_tlv, st
 			pdol_data_tlv, // pdol
 			ac_data_tlv,   // cdol1
 			NULL,          // cdol2 
-			true);
+			!PrintAndLogMuted());
 	if (idn_db) {
 		const struct tlv *idn_tlv = tlvdb_get(idn_db, 0x9f4c, NULL);
 		PrintAndLogEx(NORMAL, "\nIDN (ICC Dynamic Number) [%zu] %s", idn_tlv->len, sprint_hex_inrow(idn_tlv->value, idn_tlv->len));
@@ -832,9 +957,11 @@ int trCDA(struct tlvdb *tlv, struct tlvdb *ac_tlv, struct tlv *pdol_data_tlv, st
 		tlvdb_add(tlv, idn_db);
 	} else {
 		PrintAndLogEx(NORMAL, "\nERROR: CDA verify error");
+		emv_pk_free(issuer_pk);
+		emv_pk_free(icc_pk);
+		return 5;
 	}
 
-	emv_pk_free(pk);
 	emv_pk_free(issuer_pk);
 	emv_pk_free(icc_pk);
 	return 0;
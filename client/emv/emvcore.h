@@ -67,10 +67,20 @@ extern struct tlvdb *GetPANFromTrack2(const struct tlv *track2);
 extern struct tlvdb *GetdCVVRawFromTrack2(const struct tlv *track2);
 
 extern void SetAPDULogging(bool logging);
+// offline replay,  per thread.  APDUs are answered from the recording and the field is left alone
+struct emv_replay_run;
+extern void SetAPDUReplay(struct emv_replay_run *run);
+// simulated card,  per thread.  APDUs and AID probes go to the simulator
+struct emv_sim_card;
+extern void SetAPDUSim(struct emv_sim_card *card);
+
+extern int EMVExchange(bool LeaveFieldON, sAPDU apdu, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen, uint16_t *sw, struct tlvdb *tlv);
 
 // search application
 extern int EMVSearchPSE(bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct tlvdb *tlv);
 extern int EMVSearch(bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct tlvdb *tlv);
+// one SELECT round trip per AID,  replays take this one
+extern int EMVSearchEach(bool ActivateField, bool LeaveFieldON, bool decodeTLV, struct tlvdb *tlv);
 extern int EMVSelectPSE(bool ActivateField, bool LeaveFieldON, uint8_t PSENum, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen, uint16_t *sw);
 extern int EMVSelect(bool ActivateField, bool LeaveFieldON, uint8_t *AID, size_t AIDLen, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen, uint16_t *sw, struct tlvdb *tlv);
 // select application
@@ -85,6 +95,9 @@ extern int EMVAC(bool LeaveFieldON, uint8_t RefControl, uint8_t *CDOL, size_t CD
 extern int EMVInternalAuthenticate(bool LeaveFieldON, uint8_t *DDOL, size_t DDOLLen, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen, uint16_t *sw, struct tlvdb *tlv);
 // Mastercard
 int MSCComputeCryptoChecksum(bool LeaveFieldON, uint8_t *UDOL, uint8_t UDOLlen, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen, uint16_t *sw, struct tlvdb *tlv);
+// Input list for Offline Data Authentication
+extern bool ODAiListAddRecord(uint8_t SFI, const uint8_t *rec, size_t reclen, uint8_t *ODAiList, size_t *ODAiListLen, size_t ODAiListMax);
+extern void ODAiListAddToTLV(struct tlvdb *tlv, uint8_t *ODAiList, size_t ODAiListLen, size_t ODAiListMax);
 // Auth
 extern int trSDA(struct tlvdb *tlv);
 extern int trDDA(bool decodeTLV, struct tlvdb *tlv);
@@ -0,0 +1,561 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// EMV offline transaction replay
+//-----------------------------------------------------------------------------
+
+#include "emvreplay.h"
+
+#include <pthread.h>
+#include "emvcore.h"
+#include "crc16.h"
+#include "util_posix.h"
+
+static const char *replay_pse[] = {"2PAY.SYS.DDF01", "1PAY.SYS.DDF01"};
+
+static const unsigned char replay_default_ddol[] = {0x9f, 0x37, 0x04};
+
+void EMVReplayFree(struct emv_replay *rec) {
+	if (!rec)
+		return;
+	for (size_t i = 0; i < rec->count; i++) {
+		free(rec->apdu[i].cmd);
+		free(rec->apdu[i].resp);
+	}
+	free(rec->apdu);
+	free(rec->name);
+	free(rec);
+}
+
+static bool replay_add(struct emv_replay *rec, size_t *size, const uint8_t *cmd, size_t cmdlen, const uint8_t *resp, size_t resplen) {
+	// a command needs its header,  a response its status word
+	if (cmdlen < 4 || resplen < 2)
+		return true;
+
+	if (rec->count == *size) {
+		size_t nsize = *size ? *size * 2 : 16;
+		struct emv_replay_apdu *apdu = realloc(rec->apdu, nsize * sizeof(*apdu));
+		if (!apdu)
+			return false;
+		rec->apdu = apdu;
+		*size = nsize;
+	}
+
+	struct emv_replay_apdu *a = &rec->apdu[rec->count];
+	a->cmd = malloc(cmdlen);
+	a->resp = malloc(resplen);
+	if (!a->cmd || !a->resp) {
+		free(a->cmd);
+		free(a->resp);
+		return false;
+	}
+	memcpy(a->cmd, cmd, cmdlen);
+	a->cmdlen = cmdlen;
+	memcpy(a->resp, resp, resplen);
+	a->resplen = resplen;
+	rec->count++;
+	return true;
+}
+
+// `hf emv exec -a` log,  a ">>>>" line followed by its "<<<<" line
+static bool replay_parse_log(struct emv_replay *rec, const char *text) {
+	uint8_t cmd[APDU_RES_LEN], resp[APDU_RES_LEN];
+	int cmdlen = 0, resplen = 0;
+	size_t size = 0;
+	char line[1024];
+
+	while (*text) {
+		size_t n = strcspn(text, "\r\n");
+		size_t l = n < sizeof(line) - 1 ? n : sizeof(line) - 1;
+		memcpy(line, text, l);
+		line[l] = 0;
+		text += n;
+		text += strspn(text, "\r\n");
+
+		char *p;
+		if ((p = strstr(line, ">>>>"))) {
+			if (param_gethex_to_eol(p + 4, 0, cmd, sizeof(cmd), &cmdlen))
+				cmdlen = 0;
+		} else if ((p = strstr(line, "<<<<"))) {
+			bool ok = cmdlen && !param_gethex_to_eol(p + 4, 0, resp, sizeof(resp), &resplen);
+			if (ok && !replay_add(rec, &size, cmd, cmdlen, resp, resplen))
+				return false;
+			cmdlen = 0;
+		}
+	}
+	return true;
+}
+
+// binary trace,  ISO14443-4 I-blocks with their chaining undone
+static bool replay_parse_trace(struct emv_replay *rec, const uint8_t *trace, size_t len) {
+	uint8_t msg[2][APDU_RES_LEN];
+	size_t msglen[2] = {0, 0};
+	bool done[2] = {false, false};
+	bool havecmd = false;
+	size_t size = 0;
+	size_t pos = 0;
+
+	while (pos + 8 <= len) {
+		uint16_t data_len = trace[pos + 6] | (trace[pos + 7] << 8);
+		bool isResponse = data_len & 0x8000;
+		data_len &= 0x7fff;
+		pos += 8;
+		if (data_len == 0 || pos + data_len + (data_len - 1) / 8 + 1 > len)
+			break;
+		const uint8_t *frame = trace + pos;
+		pos += data_len + (data_len - 1) / 8 + 1;
+
+		// I-block,  PCB [CID] [NAD] INF CRC
+		if (data_len < 3 || (frame[0] & 0xe2) != 0x02 || !check_crc(CRC_14443_A, frame, data_len))
+			continue;
+		size_t hdr = 1 + ((frame[0] & 0x08) ? 1 : 0) + ((frame[0] & 0x04) ? 1 : 0);
+		if (hdr + 2 > data_len)
+			continue;
+
+		int dir = isResponse ? 1 : 0;
+		size_t inflen = data_len - hdr - 2;
+		if (done[dir]) {
+			msglen[dir] = 0;
+			done[dir] = false;
+		}
+		if (msglen[dir] + inflen > sizeof(msg[dir])) {
+			msglen[dir] = 0;
+			continue;
+		}
+		memcpy(msg[dir] + msglen[dir], frame + hdr, inflen);
+		msglen[dir] += inflen;
+		if (frame[0] & 0x10)
+			continue;
+
+		done[dir] = true;
+		if (!isResponse) {
+			havecmd = true;
+		} else if (havecmd) {
+			if (!replay_add(rec, &size, msg[0], msglen[0], msg[1], msglen[1]))
+				return false;
+			havecmd = false;
+		}
+	}
+	return true;
+}
+
+struct emv_replay *EMVReplayParse(const char *name, const uint8_t *buf, size_t len) {
+	struct emv_replay *rec = calloc(1, sizeof(*rec));
+	char *text = malloc(len + 1);
+	if (!rec || !text) {
+		free(rec);
+		free(text);
+		return NULL;
+	}
+	if (!name)
+		name = "";
+	rec->name = malloc(strlen(name) + 1);
+	if (rec->name)
+		strcpy(rec->name, name);
+
+	memcpy(text, buf, len);
+	text[len] = 0;
+	bool isLog = strlen(text) == len && strstr(text, ">>>>");
+
+	bool res = isLog ? replay_parse_log(rec, text) : replay_parse_trace(rec, buf, len);
+	free(text);
+	if (!res || !rec->name) {
+		EMVReplayFree(rec);
+		return NULL;
+	}
+	return rec;
+}
+
+struct emv_replay *EMVReplayLoad(const char *fname) {
+	FILE *f = fopen(fname, "rb");
+	if (!f)
+		return NULL;
+
+	fseek(f, 0, SEEK_END);
+	long fsize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (fsize <= 0) {
+		fclose(f);
+		return NULL;
+	}
+
+	uint8_t *buf = malloc(fsize);
+	if (!buf) {
+		fclose(f);
+		return NULL;
+	}
+	size_t len = fread(buf, 1, fsize, f);
+	fclose(f);
+
+	struct emv_replay *rec = EMVReplayParse(fname, buf, len);
+	free(buf);
+	return rec;
+}
+
+// CLA INS P1 P2 and the Lc data,  Le and the exec style trailing 00 do not count
+static void replay_apdu_data(const uint8_t *apdu, size_t len, const uint8_t **data, size_t *datalen) {
+	*data = NULL;
+	*datalen = 0;
+	if (len > 5 && apdu[4] && 5 + (size_t)apdu[4] <= len) {
+		*data = apdu + 5;
+		*datalen = apdu[4];
+	}
+}
+
+static bool replay_apdu_match(const struct emv_replay_apdu *a, const uint8_t *apdu, size_t apdulen, bool headerOnly) {
+	if (memcmp(a->cmd, apdu, 4))
+		return false;
+	if (headerOnly)
+		return true;
+
+	const uint8_t *d1, *d2;
+	size_t l1, l2;
+	replay_apdu_data(a->cmd, a->cmdlen, &d1, &l1);
+	replay_apdu_data(apdu, apdulen, &d2, &l2);
+	return l1 == l2 && (l1 == 0 || !memcmp(d1, d2, l1));
+}
+
+int EMVReplayExchange(struct emv_replay_run *run, const uint8_t *apdu, size_t apdulen, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen) {
+	const struct emv_replay *rec = run->rec;
+	*ResultLen = 0;
+	if (apdulen < 4)
+		return 1;
+
+	// the same command first,  then one that only differs in its data
+	for (int headerOnly = 0; headerOnly < 2; headerOnly++) {
+		for (size_t i = 0; i < rec->count; i++) {
+			const struct emv_replay_apdu *a = &rec->apdu[i];
+			if (run->used[i] || !replay_apdu_match(a, apdu, apdulen, headerOnly))
+				continue;
+			if (a->resplen > MaxResultLen)
+				return 2;
+			run->used[i] = 1;
+			memcpy(Result, a->resp, a->resplen);
+			*ResultLen = a->resplen;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// same layout as the dol_process() result,  one free() releases it
+static struct tlv *replay_tlv(tlv_tag_t tag, const uint8_t *data, size_t len) {
+	struct tlv *tlv = malloc(sizeof(*tlv) + len);
+	if (!tlv)
+		return NULL;
+	tlv->tag = tag;
+	tlv->len = len;
+	tlv->value = (unsigned char *)(tlv + 1);
+	if (len)
+		memcpy(tlv + 1, data, len);
+	return tlv;
+}
+
+// terminal data the card asked for,  taken back out of the DOL data sent.
+// Added behind what the tree already holds,  so the first value wins.
+static void replay_terminal_data(struct tlvdb *tlvRoot, const struct tlv *dol, const uint8_t *data, size_t len) {
+	struct tlvdb *db = dol_parse(dol, data, len);
+	if (db)
+		tlvdb_add(tlvRoot, db);
+}
+
+// AFL lists the record among the ones for offline data authentication
+static bool replay_oda_record(struct tlvdb *tlvRoot, uint8_t SFI, uint8_t n) {
+	const struct tlv *AFL = tlvdb_get(tlvRoot, 0x94, NULL);
+	if (!AFL || AFL->len % 4)
+		return false;
+
+	for (int i = 0; i < AFL->len / 4; i++) {
+		uint8_t SFIstart = AFL->value[i * 4 + 1];
+		uint8_t SFIend = AFL->value[i * 4 + 2];
+		uint8_t SFIoffline = AFL->value[i * 4 + 3];
+		if ((AFL->value[i * 4 + 0] >> 3) == SFI && n >= SFIstart && n <= SFIend)
+			return n < SFIstart + SFIoffline;
+	}
+	return false;
+}
+
+static bool replay_is_pse(const uint8_t *data, size_t len) {
+	for (size_t i = 0; i < sizeof(replay_pse) / sizeof(replay_pse[0]); i++)
+		if (len == strlen(replay_pse[i]) && !memcmp(data, replay_pse[i], len))
+			return true;
+	return false;
+}
+
+static int replay_offline_auth(struct tlvdb *tlvRoot, uint8_t *ODAiList, size_t ODAiListLen, size_t ODAiListMax, bool internalAuth, bool decodeTLV, struct emv_replay_result *result) {
+	ODAiListAddToTLV(tlvRoot, ODAiList, ODAiListLen, ODAiListMax);
+
+	const struct tlv *AIPtlv = tlvdb_get(tlvRoot, 0x82, NULL);
+	if (!AIPtlv || AIPtlv->len < 2) {
+		PrintAndLogEx(WARNING, "Error: AIP not found.");
+		return 6;
+	}
+	result->AIP = AIPtlv->value[0] + AIPtlv->value[1] * 0x100;
+	PrintAndLogEx(NORMAL, "* * AIP=%04x", result->AIP);
+
+	if (result->AIP & 0x0040) {
+		PrintAndLogEx(NORMAL, "\n* SDA");
+		result->sda = trSDA(tlvRoot);
+	}
+
+	// DDA with internal authenticate,  or fDDA with 9F4B from the GPO
+	if ((result->AIP & 0x0020) && (internalAuth || tlvdb_get(tlvRoot, 0x9f4b, NULL))) {
+		PrintAndLogEx(NORMAL, "\n* DDA");
+		result->dda = trDDA(decodeTLV, tlvRoot);
+	}
+	return 0;
+}
+
+int EMVReplayTransaction(const struct emv_replay *rec, bool quiet, bool decodeTLV, struct emv_replay_result *result) {
+	uint8_t buf[APDU_RES_LEN] = {0};
+	size_t len = 0;
+	uint16_t sw = 0;
+	uint8_t ODAiList[4096];
+	size_t ODAiListLen = 0;
+	bool gpo = false, oda = false, internalAuth = false, cdaReq = false, next = false;
+	struct tlvdb *tlvApp = NULL;
+	struct tlvdb *ac_tlv = NULL;
+	struct tlv *pdol_data_tlv = NULL;
+	struct tlv *cdol_data_tlv = NULL;
+	int res = 0;
+
+	memset(result, 0, sizeof(*result));
+	result->sda = result->dda = result->cda = EMVREPLAY_NOTDONE;
+
+	struct emv_replay_run run = {rec, calloc(rec->count ? rec->count : 1, 1)};
+	if (!run.used)
+		return result->res = 1;
+
+	bool muted = PrintAndLogMuted();
+	SetPrintAndLogMuted(muted || quiet);
+	SetAPDUReplay(&run);
+
+	const char *alr = "Root terminal TLV tree";
+	struct tlvdb *tlvRoot = tlvdb_fixed(1, strlen(alr), (const unsigned char *)alr);
+
+	for (size_t i = 0; i < rec->count && !res && !next; i++) {
+		const uint8_t *cmd = rec->apdu[i].cmd;
+		const uint8_t *data;
+		size_t datalen;
+
+		if (run.used[i])
+			continue;
+		replay_apdu_data(cmd, rec->apdu[i].cmdlen, &data, &datalen);
+		sAPDU apdu = {cmd[0], cmd[1], cmd[2], cmd[3], datalen, (uint8_t *)data};
+
+		switch (cmd[1]) {
+			case 0xa4: {
+				// a select after the GPO starts the next transaction
+				if (gpo) {
+					next = true;
+					break;
+				}
+				if (EMVExchange(true, apdu, buf, sizeof(buf), &len, &sw, NULL) || replay_is_pse(data, datalen))
+					break;
+
+				PrintAndLogEx(NORMAL, "\n* Selected AID:%s", sprint_hex_inrow(data, datalen));
+				if (decodeTLV)
+					TLVPrintFromBuffer(buf, len);
+				tlvdb_free(tlvApp);
+				tlvApp = tlvdb_parse_multi(buf, len);
+				result->AIDlen = datalen < sizeof(result->AID) ? datalen : sizeof(result->AID);
+				memcpy(result->AID, data, result->AIDlen);
+				break;
+			}
+			case 0xa8: {
+				if (gpo)
+					break;
+				if (!tlvApp) {
+					PrintAndLogEx(WARNING, "Error: GPO without a selected application.");
+					res = 2;
+					break;
+				}
+				tlvdb_add(tlvRoot, tlvApp);
+				tlvApp = NULL;
+
+				// 83 [PDOL data]
+				const unsigned char *tlvbuf = data;
+				size_t left = datalen;
+				struct tlv pdol;
+				if (!data || !tlv_parse_tl(&tlvbuf, &left, &pdol) || pdol.tag != 0x83 || pdol.len > left) {
+					PrintAndLogEx(WARNING, "Error: GPO command data is not a 83 template.");
+					res = 3;
+					break;
+				}
+				pdol_data_tlv = replay_tlv(0x83, tlvbuf, pdol.len);
+				replay_terminal_data(tlvRoot, tlvdb_get(tlvRoot, 0x9f38, NULL), tlvbuf, pdol.len);
+				PrintAndLogEx(NORMAL, "\n* GPO. PDOL data[%d]: %s", pdol.len, sprint_hex(tlvbuf, pdol.len));
+
+				if (EMVExchange(true, apdu, buf, sizeof(buf), &len, &sw, tlvRoot)) {
+					PrintAndLogEx(WARNING, "GPO error: %4x.", sw);
+					res = 4;
+					break;
+				}
+				gpo = true;
+				if (decodeTLV)
+					TLVPrintFromBuffer(buf, len);
+
+				// response format 1 [id:80  2b AIP + x4b AFL]
+				if (buf[0] == 0x80) {
+					if (len < 4 || (len - 4) % 4) {
+						PrintAndLogEx(WARNING, "Error: GPO response format1 parsing error. length=%d", len);
+					} else {
+						tlvdb_add(tlvRoot, tlvdb_fixed(0x82, 2, buf + 2));
+						tlvdb_add(tlvRoot, tlvdb_fixed(0x94, len - 4, buf + 2 + 2));
+					}
+				}
+				break;
+			}
+			case 0xb2: {
+				if (!gpo || oda)
+					break;
+				uint8_t SFI = cmd[3] >> 3;
+				PrintAndLogEx(NORMAL, "* * * SFI[%02x] %d", SFI, cmd[2]);
+				if (EMVExchange(true, apdu, buf, sizeof(buf), &len, &sw, tlvRoot))
+					break;
+				if (decodeTLV)
+					TLVPrintFromBuffer(buf, len);
+				if (replay_oda_record(tlvRoot, SFI, cmd[2]) && !ODAiListAddRecord(SFI, buf, len, ODAiList, &ODAiListLen, sizeof(ODAiList)))
+					PrintAndLogEx(WARNING, "Error SFI[%02x]. Creating input list for Offline Data Authentication error.", SFI);
+				break;
+			}
+			case 0x88: {
+				// trDDA sends it,  the DDOL data gives the terminal values back
+				if (!gpo || oda)
+					break;
+				const struct tlv *ddol = tlvdb_get(tlvRoot, 0x9f49, NULL);
+				const struct tlv defddol = {.tag = 0x9f49, .len = sizeof(replay_default_ddol), .value = replay_default_ddol};
+				replay_terminal_data(tlvRoot, ddol ? ddol : &defddol, data, datalen);
+				internalAuth = true;
+				break;
+			}
+			case 0x84:
+			case 0xae:
+			case 0x2a: {
+				if (!gpo)
+					break;
+				if (!oda) {
+					oda = true;
+					res = replay_offline_auth(tlvRoot, ODAiList, ODAiListLen, sizeof(ODAiList), internalAuth, decodeTLV, result);
+					if (res)
+						break;
+				}
+
+				if (cmd[1] == 0xae) {
+					// CDOL2 answers are not checked
+					if (ac_tlv)
+						break;
+					replay_terminal_data(tlvRoot, tlvdb_get(tlvRoot, 0x8c, NULL), data, datalen);
+					cdol_data_tlv = replay_tlv(0x01, data, datalen);
+					cdaReq = cmd[2] & EMVAC_CDAREQ;
+					PrintAndLogEx(NORMAL, "\n* AC1. CDOL1 data[%d]: %s", datalen, sprint_hex(data, datalen));
+				}
+
+				if (EMVExchange(true, apdu, buf, sizeof(buf), &len, &sw, tlvRoot))
+					break;
+				if (decodeTLV)
+					TLVPrintFromBuffer(buf, len);
+
+				if (cmd[1] == 0x84 && len >= 4)
+					tlvdb_add(tlvRoot, tlvdb_fixed(0x9f4c, len, buf));
+				if (cmd[1] == 0xae) {
+					ac_tlv = tlvdb_parse_multi(buf, len);
+					if (!ac_tlv && cdaReq) {
+						PrintAndLogEx(WARNING, "Error: can't parse the AC answer as TLV.");
+						result->cda = EMVREPLAY_BADAC;
+					}
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	if (!res && !gpo) {
+		PrintAndLogEx(WARNING, "Error: no GPO in the recording.");
+		res = 4;
+	}
+	if (!res && !oda)
+		res = replay_offline_auth(tlvRoot, ODAiList, ODAiListLen, sizeof(ODAiList), internalAuth, decodeTLV, result);
+
+	if (!res && ac_tlv && cdaReq) {
+		PrintAndLogEx(NORMAL, "\n* CDA:");
+		result->cda = trCDA(tlvRoot, ac_tlv, pdol_data_tlv, cdol_data_tlv);
+	}
+
+	tlvdb_free(ac_tlv);
+	tlvdb_free(tlvApp);
+	tlvdb_free(tlvRoot);
+	free(pdol_data_tlv);
+	free(cdol_data_tlv);
+	free(run.used);
+
+	SetAPDUReplay(NULL);
+	SetPrintAndLogMuted(muted);
+
+	return result->res = res;
+}
+
+struct replay_batch {
+	pthread_mutex_t lock;
+	size_t next;
+	size_t jobs;
+	size_t count;
+	struct emv_replay **recs;
+	struct emv_replay_result *results;
+};
+
+static void *replay_worker(void *arg) {
+	struct replay_batch *b = arg;
+
+	for (;;) {
+		pthread_mutex_lock(&b->lock);
+		size_t job = b->next++;
+		pthread_mutex_unlock(&b->lock);
+		if (job >= b->jobs)
+			break;
+
+		struct emv_replay_result result;
+		size_t n = job % b->count;
+		EMVReplayTransaction(b->recs[n], true, false, &result);
+		// every round gives the same answer,  keep the first
+		if (job < b->count)
+			b->results[n] = result;
+	}
+	return NULL;
+}
+
+int EMVReplayBatch(struct emv_replay **recs, size_t count, int rounds, int threads, struct emv_replay_result *results) {
+	if (!count || rounds < 1)
+		return 0;
+
+	// the CA key store is only read from the workers.  Without capk.txt every
+	// lookup tries to load it again,  so one worker.
+	if (emv_pk_store_load(NULL) < 0)
+		threads = 1;
+
+	if (threads < 1)
+		threads = num_CPUs();
+	if ((size_t)threads > count * rounds)
+		threads = count * rounds;
+
+	struct replay_batch b = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.next = 0,
+		.jobs = count * rounds,
+		.count = count,
+		.recs = recs,
+		.results = results,
+	};
+
+	pthread_t thread_id[threads];
+	for (int i = 0; i < threads; i++)
+		pthread_create(&thread_id[i], NULL, replay_worker, &b);
+	for (int i = 0; i < threads; i++)
+		pthread_join(thread_id[i], NULL);
+
+	return count * rounds;
+}
@@ -0,0 +1,69 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// EMV offline transaction replay
+// A recorded transaction is run through the same TLV tree and SDA/DDA/CDA
+// code as `hf emv exec`, the card answers come from the recording.
+// Recordings are either the `hf emv exec -a` log (">>>>" / "<<<<" lines)
+// or a binary ISO14443-4 trace as written by `trace save`.
+//-----------------------------------------------------------------------------
+
+#ifndef EMVREPLAY_H__
+#define EMVREPLAY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct emv_replay_apdu {
+	uint8_t *cmd;
+	size_t cmdlen;
+	uint8_t *resp;		// with SW1 SW2
+	size_t resplen;
+};
+
+// read only once loaded,  any number of threads may replay it at once
+struct emv_replay {
+	char *name;
+	size_t count;
+	struct emv_replay_apdu *apdu;
+};
+
+// one replay of a recording,  remembers which exchanges were answered
+struct emv_replay_run {
+	const struct emv_replay *rec;
+	uint8_t *used;
+};
+
+// ODA results are the trSDA/trDDA/trCDA return value,  or
+#define EMVREPLAY_NOTDONE	-1	// AIP or recording does not call for it
+#define EMVREPLAY_BADAC		1	// CDA asked for,  but the AC answer is no TLV
+
+struct emv_replay_result {
+	int res;			// 0 if the transaction could be rebuilt
+	uint16_t AIP;
+	uint8_t AID[16];
+	size_t AIDlen;
+	int sda;
+	int dda;
+	int cda;
+};
+
+struct emv_replay *EMVReplayParse(const char *name, const uint8_t *buf, size_t len);
+struct emv_replay *EMVReplayLoad(const char *fname);
+void EMVReplayFree(struct emv_replay *rec);
+
+// answer one APDU from the recording,  0 if found
+int EMVReplayExchange(struct emv_replay_run *run, const uint8_t *apdu, size_t apdulen, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen);
+
+// rebuild the transaction and verify it offline.  quiet runs silent,  as the
+// replay workers do.  Returns result->res.
+int EMVReplayTransaction(const struct emv_replay *rec, bool quiet, bool decodeTLV, struct emv_replay_result *result);
+
+// replay count recordings rounds times each on threads workers (0: one per CPU).
+// results[i] is for recs[i].  Returns the number of transactions run.
+int EMVReplayBatch(struct emv_replay **recs, size_t count, int rounds, int threads, struct emv_replay_result *results);
+
+#endif
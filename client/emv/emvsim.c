@@ -0,0 +1,152 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// EMV card simulator for application selection
+//-----------------------------------------------------------------------------
+
+#include "emvsim.h"
+
+#include <string.h>
+#include "aidprobe.h"
+#include "usb_cmd.h"
+#include "util.h"
+
+// 9 bits a byte at 106 kbit/s
+#define EMVSIM_AIR_US_PER_BYTE	85
+
+// BER-TLV length
+static size_t EMVSimLen(size_t len, uint8_t *out) {
+	if (len < 0x80) {
+		out[0] = len;
+		return 1;
+	}
+	if (len < 0x100) {
+		out[0] = 0x81;
+		out[1] = len;
+		return 2;
+	}
+	out[0] = 0x82;
+	out[1] = len >> 8;
+	out[2] = len & 0xFF;
+	return 3;
+}
+
+static size_t EMVSimLenLen(size_t len) {
+	uint8_t tmp[3];
+	return EMVSimLen(len, tmp);
+}
+
+// FCI template of an application: 6F [84 AID] [A5 [50 label] [87 priority]
+// [BF0C [DF20 discretionary data]]]
+static size_t EMVSimFCI(const struct emv_sim_app *app, const uint8_t *aid, size_t aidlen, uint8_t *out) {
+	size_t lablen = strlen(app->label);
+	size_t ddlen = app->discretionary ? 2 + EMVSimLenLen(app->discretionary) + app->discretionary : 0;
+	size_t a5len = 2 + lablen + 3 + (ddlen ? 2 + EMVSimLenLen(ddlen) + ddlen : 0);
+	size_t pos = 0;
+
+	out[pos++] = 0x6F;
+	pos += EMVSimLen(2 + aidlen + 1 + EMVSimLenLen(a5len) + a5len, out + pos);
+	out[pos++] = 0x84;
+	out[pos++] = aidlen;
+	memcpy(out + pos, aid, aidlen);
+	pos += aidlen;
+	out[pos++] = 0xA5;
+	pos += EMVSimLen(a5len, out + pos);
+	out[pos++] = 0x50;
+	out[pos++] = lablen;
+	memcpy(out + pos, app->label, lablen);
+	pos += lablen;
+	out[pos++] = 0x87;
+	out[pos++] = 0x01;
+	out[pos++] = app->priority;
+	if (ddlen) {
+		out[pos++] = 0xBF;
+		out[pos++] = 0x0C;
+		pos += EMVSimLen(ddlen, out + pos);
+		out[pos++] = 0xDF;
+		out[pos++] = 0x20;
+		pos += EMVSimLen(app->discretionary, out + pos);
+		memset(out + pos, 0x00, app->discretionary);
+		pos += app->discretionary;
+	}
+	return pos;
+}
+
+// the card answer with SW,  or 0 when it stays mute
+static size_t EMVSimAnswer(struct emv_sim_card *card, const uint8_t *apdu, size_t apdulen, uint8_t *out) {
+	size_t len = 2;
+
+	card->apdus++;
+	if (card->mute_apdu && card->apdus == card->mute_apdu)
+		return 0;
+
+	out[0] = 0x6D;
+	out[1] = 0x00;
+
+	// SELECT by name,  an application matches if its AID starts with the name
+	if (apdulen >= 5 && apdu[1] == 0xA4 && apdu[2] == 0x04 && apdulen >= 5 + apdu[4]) {
+		out[0] = 0x6A;
+		out[1] = 0x82;
+		for (size_t i = 0; i < card->count; i++) {
+			uint8_t aid[AIDPROBE_MAX_AID];
+			int aidlen = 0;
+			param_gethex_to_eol(card->apps[i].aid, 0, aid, sizeof(aid), &aidlen);
+			if (apdu[4] <= aidlen && !memcmp(aid, apdu + 5, apdu[4])) {
+				len = EMVSimFCI(&card->apps[i], aid, aidlen, out);
+				out[len++] = 0x90;
+				out[len++] = 0x00;
+				break;
+			}
+		}
+	}
+
+	card->us += card->card_us + EMVSIM_AIR_US_PER_BYTE * (apdulen + 3 + len + 3);
+	return len;
+}
+
+void EMVSimReset(struct emv_sim_card *card) {
+	card->roundtrips = 0;
+	card->apdus = 0;
+	card->us = 0;
+}
+
+int EMVSimExchange(struct emv_sim_card *card, const uint8_t *apdu, size_t apdulen, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen) {
+	uint8_t resp[AIDPROBE_RESP_MAX];
+
+	card->roundtrips++;
+	card->us += card->usb_us;
+
+	*ResultLen = 0;
+	size_t len = EMVSimAnswer(card, apdu, apdulen, resp);
+	if (!len)
+		return 1;
+	if (len > MaxResultLen)
+		return 2;
+
+	memcpy(Result, resp, len);
+	*ResultLen = len;
+	return 0;
+}
+
+// the firmware side of the probe,  the answer gets a CRC the loop does not look at
+static int EMVSimProbeExchange(void *ctx, uint8_t *cmd, uint16_t cmdlen, uint8_t *resp) {
+	size_t len = EMVSimAnswer(ctx, cmd, cmdlen, resp);
+	if (!len)
+		return 0;
+	resp[len++] = 0x00;
+	resp[len++] = 0x00;
+	return len;
+}
+
+int EMVSimProbe(struct emv_sim_card *card, const uint8_t *list, size_t listlen, uint8_t *hits, int *hitslen, int *status) {
+	size_t outlen = 0;
+
+	card->roundtrips++;
+	card->us += card->usb_us;
+
+	int count = aidprobe_run(list, listlen, EMVSimProbeExchange, card, hits, USB_CMD_DATA_SIZE, &outlen, status);
+	*hitslen = outlen;
+	return count;
+}
@@ -0,0 +1,50 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// EMV card simulator for application selection.  It answers SELECT by name
+// from a list of applications,  either one APDU per proxmark round trip or
+// through the firmware AID probe loop,  and adds up a modelled time for both.
+//-----------------------------------------------------------------------------
+
+#ifndef EMVSIM_H__
+#define EMVSIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct emv_sim_app {
+	const char *aid;		// hex
+	const char *label;
+	uint8_t priority;
+	uint16_t discretionary;	// bytes of issuer discretionary data in the FCI,  0 none
+};
+
+struct emv_sim_card {
+	const struct emv_sim_app *apps;
+	size_t count;
+
+	// time model in us: one client <-> proxmark round trip,  the card working
+	// on one APDU,  and 106 kbit/s on air for every byte with PCB and CRC
+	uint32_t usb_us;
+	uint32_t card_us;
+
+	// the n-th APDU the card sees gets no answer,  0 for never
+	uint32_t mute_apdu;
+
+	uint32_t roundtrips;
+	uint32_t apdus;
+	uint64_t us;
+};
+
+void EMVSimReset(struct emv_sim_card *card);
+
+// one APDU over the proxmark,  ExchangeAPDU14a() return codes
+int EMVSimExchange(struct emv_sim_card *card, const uint8_t *apdu, size_t apdulen, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen);
+
+// an AID list through the firmware probe loop,  ExchangeAIDProbe14a() return codes
+int EMVSimProbe(struct emv_sim_card *card, const uint8_t *list, size_t listlen, uint8_t *hits, int *hitslen, int *status);
+
+#endif
@@ -0,0 +1,101 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// AID probe tests on the card simulator
+//-----------------------------------------------------------------------------
+
+#include "aidprobe_test.h"
+
+#include "../emvcore.h"
+#include "../emvsim.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+// the CB FCI is 256 bytes,  its length does not fit a byte
+static const struct emv_sim_app aidprobe_apps[] = {
+	{"A0000000031010", "VISA CREDIT", 1, 0},
+	{"A0000000043060", "MAESTRO", 2, 0},
+	{"A0000000421010", "CB", 3, 226},
+};
+
+// USB full speed round trip of 2 ms,  3 ms for the card to answer a SELECT
+#define AIDPROBE_USB_US		2000
+#define AIDPROBE_CARD_US	3000
+
+// the AIDs of the FCIs the search put in the tree,  as a hex string
+static int aidprobe_search(struct emv_sim_card *card, bool probe, char *found, size_t foundsize) {
+	const char *al = "Applets list";
+	struct tlvdb *t = tlvdb_fixed(1, strlen(al), (const unsigned char *)al);
+
+	EMVSimReset(card);
+	SetAPDUSim(card);
+	int res = probe ? EMVSearch(true, false, false, t) : EMVSearchEach(true, false, false, t);
+	SetAPDUSim(NULL);
+
+	found[0] = 0;
+	for (struct tlvdb *ttmp = tlvdb_find(t, 0x6f); ttmp; ttmp = tlvdb_find_next(ttmp, 0x6f)) {
+		const struct tlv *tgAID = tlvdb_get_inchild(ttmp, 0x84, NULL);
+		if (!tgAID)
+			break;
+		size_t len = strlen(found);
+		snprintf(found + len, foundsize - len, "%s ", sprint_hex_inrow(tgAID->value, tgAID->len));
+	}
+	tlvdb_free(t);
+	return res;
+}
+
+int exec_aidprobe_test(bool verbose)
+{
+	const char *expect = "A0000000031010 A0000000043060 A0000000421010 ";
+	struct emv_sim_card card = {
+		.apps = aidprobe_apps,
+		.count = sizeof(aidprobe_apps) / sizeof(aidprobe_apps[0]),
+		.usb_us = AIDPROBE_USB_US,
+		.card_us = AIDPROBE_CARD_US,
+	};
+	char each[256], probe[256];
+
+	fprintf(stdout, "\n");
+
+	if (aidprobe_search(&card, false, each, sizeof(each))) {
+		fprintf(stderr, "AID search, one select per round trip: failed\n");
+		return 1;
+	}
+	uint32_t each_rt = card.roundtrips, each_apdus = card.apdus;
+	uint64_t each_us = card.us;
+
+	if (aidprobe_search(&card, true, probe, sizeof(probe))) {
+		fprintf(stderr, "AID search, probe: failed\n");
+		return 1;
+	}
+	uint32_t probe_rt = card.roundtrips, probe_apdus = card.apdus;
+	uint64_t probe_us = card.us;
+
+	if (verbose)
+		fprintf(stdout, "found: %s\n", probe);
+	if (strcmp(each, expect) || strcmp(probe, expect) || each_apdus != probe_apdus) {
+		fprintf(stderr, "AID search, probe against one select per round trip: failed\n");
+		return 1;
+	}
+	fprintf(stdout, "AID search, probe against one select per round trip: passed\n");
+
+	// no answer to one SELECT in the middle of the list,  it is retried on its own
+	card.mute_apdu = 20;
+	if (aidprobe_search(&card, true, probe, sizeof(probe)) || strcmp(probe, expect) || card.apdus != each_apdus + 1) {
+		fprintf(stderr, "AID search, probe with a lost answer: failed\n");
+		return 1;
+	}
+	card.mute_apdu = 0;
+	fprintf(stdout, "AID search, probe with a lost answer: passed\n");
+
+	fprintf(stdout, "AID search of %" PRIu32 " AIDs (model: %d ms USB round trip, %d ms per SELECT, 106 kbit/s):\n",
+			each_apdus, AIDPROBE_USB_US / 1000, AIDPROBE_CARD_US / 1000);
+	fprintf(stdout, "  one select per round trip %3" PRIu32 " round trips %6.1f ms\n", each_rt, each_us / 1000.0);
+	fprintf(stdout, "  probe on the proxmark     %3" PRIu32 " round trips %6.1f ms\n", probe_rt, probe_us / 1000.0);
+	return 0;
+}
@@ -0,0 +1,125 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// APDU status word lookup tests
+//-----------------------------------------------------------------------------
+
+#include "apdu_test.h"
+
+#include "../apduinfo.h"
+#include "cmdhflist.h"
+#include "util_posix.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+extern const APDUCode APDUCodeTable[];
+extern const size_t APDUCodeTableLen;
+extern int CodeCmp(const char *code1, const char *code2);
+
+// the lookup as it was done before the index: format and scan the whole table
+static const APDUCode *apdu_scan(uint8_t sw1, uint8_t sw2)
+{
+	char buf[6] = {0};
+	int mineq = 100;
+	int mineqindx = 0;
+
+	sprintf(&buf[0], "%02X", sw1);
+	sprintf(&buf[2], "%02X", sw2);
+
+	for (int i = 0; i < APDUCodeTableLen; i++) {
+		int res = CodeCmp(APDUCodeTable[i].ID, buf);
+		if (res == 0)
+			return &APDUCodeTable[i];
+		if (res > 0 && mineq > res) {
+			mineq = res;
+			mineqindx = i;
+		}
+	}
+	return &APDUCodeTable[mineqindx];
+}
+
+// I-block responses PCB data SW1 SW2 CRC,  status words as a card answers them
+#define APDU_TEST_FRAMES	20000
+
+static void apdu_make_trace(uint8_t *frames)
+{
+	static const uint16_t sws[] = {
+		0x9000, 0x9000, 0x9000, 0x9000, 0x6A82, 0x6A83, 0x6283, 0x6985,
+		0x6D00, 0x6E00, 0x6CFF, 0x6110, 0x63C2, 0x6700, 0x9F10, 0x6B00
+	};
+	for (int i = 0; i < APDU_TEST_FRAMES; i++) {
+		uint8_t *f = frames + 8 * i;
+		uint16_t sw = (i % 7) ? sws[i % 16] : (rand() & 0xFFFF);
+		f[0] = 0x02 | (i & 1);
+		f[1] = i & 0xFF;
+		f[2] = i >> 8;
+		f[3] = 0x00;
+		f[4] = sw >> 8;
+		f[5] = sw & 0xFF;
+		f[6] = 0x00;
+		f[7] = 0x00;
+	}
+}
+
+int exec_apdu_test(bool verbose)
+{
+	fprintf(stdout, "\n");
+
+	// every status word must resolve to what the scan gives
+	for (int sw = 0; sw < 0x10000; sw++) {
+		const APDUCode *ref = apdu_scan(sw >> 8, sw & 0xFF);
+		const APDUCode *cd = GetAPDUCode(sw >> 8, sw & 0xFF);
+		if (cd != ref) {
+			fprintf(stderr, "APDU status word %04X: %s, expected %s\n", sw, cd->ID, ref->ID);
+			fprintf(stderr, "APDU status word lookup: failed\n");
+			return 1;
+		}
+	}
+	fprintf(stdout, "APDU status word lookup (65536 codes, %zu entries): passed\n", APDUCodeTableLen);
+
+	if (strcmp(GetAPDUCodeDescription(0x90, 0x00), "Command successfully executed (OK).") ||
+		strcmp(GetAPDUCode(0x61, 0x10)->ID, "61XX") ||
+		strcmp(GetAPDUCode(0x62, 0xC3)->ID, "62CX")) {
+		fprintf(stderr, "APDU status word descriptions: failed\n");
+		return 1;
+	}
+	fprintf(stdout, "APDU status word descriptions: passed\n");
+
+	// annotate the responses of a long 7816 trace,  once per lookup
+	uint8_t *frames = calloc(APDU_TEST_FRAMES, 8);
+	if (!frames)
+		return 1;
+	apdu_make_trace(frames);
+
+	char exp[80];
+	int rounds = 20;
+	uint64_t t1 = msclock();
+	for (int r = 0; r < rounds; r++) {
+		for (int i = 0; i < APDU_TEST_FRAMES; i++) {
+			const uint8_t *f = frames + 8 * i;
+			snprintf(exp, sizeof(exp), "%02X%02X %s", f[4], f[5], apdu_scan(f[4], f[5])->Description);
+		}
+	}
+	uint64_t scanms = msclock() - t1;
+
+	t1 = msclock();
+	for (int r = 0; r < rounds; r++)
+		for (int i = 0; i < APDU_TEST_FRAMES; i++)
+			annotateIso7816Response(exp, sizeof(exp), frames + 8 * i, 8);
+	uint64_t indexms = msclock() - t1;
+
+	double frames_total = (double)rounds * APDU_TEST_FRAMES;
+	fprintf(stdout, "7816 trace annotation (%.0f responses): scan %" PRIu64 " ms, index %" PRIu64 " ms",
+			frames_total, scanms, indexms);
+	if (indexms)
+		fprintf(stdout, " (%.1fx)", (double)scanms / indexms);
+	fprintf(stdout, "\n");
+
+	free(frames);
+	return 0;
+}
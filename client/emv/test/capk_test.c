@@ -0,0 +1,185 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// CA public key store tests
+//-----------------------------------------------------------------------------
+
+#include "capk_test.h"
+#include "cda_test.h"
+
+#include "../emv_pk.h"
+#include "../emvreplay.h"
+#include "proxmark3.h"
+#include "util_posix.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+// CA keys of the sda/dda/cda test vectors
+extern struct emv_pk vsdc_01;
+extern struct emv_pk mchip_05;
+extern struct emv_pk c_mchip_05;
+
+// the lookup as it was done before the store: scan and parse the file, then check the hash
+static struct emv_pk *capk_scan(const char *fname, const unsigned char *rid, unsigned char idx, bool verify)
+{
+	FILE *f = fopen(fname, "r");
+	if (!f)
+		return NULL;
+
+	char buf[2048];
+	while (fgets(buf, sizeof(buf), f)) {
+		struct emv_pk *pk = emv_pk_parse_pk(buf);
+		if (!pk)
+			continue;
+		if (memcmp(pk->rid, rid, 5) || pk->index != idx) {
+			emv_pk_free(pk);
+			continue;
+		}
+		fclose(f);
+		if (verify && !emv_pk_verify(pk)) {
+			emv_pk_free(pk);
+			return NULL;
+		}
+		return pk;
+	}
+	fclose(f);
+	return NULL;
+}
+
+static bool capk_same(const struct emv_pk *a, const struct emv_pk *b)
+{
+	if (!a || !b)
+		return a == b;
+	return a->mlen == b->mlen && a->elen == b->elen &&
+		!memcmp(a->rid, b->rid, 5) && a->index == b->index &&
+		!memcmp(a->modulus, b->modulus, a->mlen) && !memcmp(a->exp, b->exp, a->elen);
+}
+
+int exec_capk_test(bool verbose)
+{
+	char fname[1024];
+	snprintf(fname, sizeof(fname), "%s%s", get_my_executable_directory(), "emv/capk.txt");
+
+	fprintf(stdout, "\n");
+
+	int count = emv_pk_store_load(fname);
+	if (count <= 0) {
+		fprintf(stderr, "CAPK store load (%s): failed\n", fname);
+		return 1;
+	}
+
+	// every key of the file must resolve to what the plain scan gives
+	struct emv_pk **keys = calloc(count, sizeof(struct emv_pk *));
+	int nkeys = 0;
+	FILE *f = fopen(fname, "r");
+	if (!keys || !f) {
+		free(keys);
+		if (f) fclose(f);
+		return 1;
+	}
+	char buf[2048];
+	while (nkeys < count && fgets(buf, sizeof(buf), f)) {
+		struct emv_pk *pk = emv_pk_parse_pk(buf);
+		if (pk)
+			keys[nkeys++] = pk;
+	}
+	fclose(f);
+
+	int ret = nkeys != count;
+	for (int i = 0; i < nkeys && !ret; i++) {
+		struct emv_pk *ref = capk_scan(fname, keys[i]->rid, keys[i]->index, true);
+		if (!capk_same(ref, emv_pk_store_get(keys[i]->rid, keys[i]->index, false)))
+			ret = 1;
+		emv_pk_free(ref);
+	}
+	const unsigned char norid[5] = {0xa0, 0x00, 0x00, 0x00, 0x00};
+	if (emv_pk_store_get(norid, 0x01, false))
+		ret = 1;
+	if (ret) {
+		fprintf(stderr, "CAPK store lookup: failed\n");
+		goto out;
+	}
+	fprintf(stdout, "CAPK store lookup (%d keys): passed\n", count);
+
+	const struct emv_pk *vectors[] = {&vsdc_01, &mchip_05, &c_mchip_05};
+	for (int i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+		if (!capk_same(vectors[i], emv_pk_store_get(vectors[i]->rid, vectors[i]->index, verbose))) {
+			fprintf(stderr, "CAPK store test vector keys: failed\n");
+			ret = 1;
+			goto out;
+		}
+	}
+	fprintf(stdout, "CAPK store test vector keys: passed\n");
+
+	// lookup latency over all keys of the file, scan + hash check per lookup against the store
+	int scanrounds = 10, storerounds = 10000;
+	uint64_t t1 = msclock();
+	for (int r = 0; r < scanrounds; r++)
+		for (int i = 0; i < nkeys; i++)
+			emv_pk_free(capk_scan(fname, keys[i]->rid, keys[i]->index, true));
+	uint64_t scanms = msclock() - t1;
+
+	const struct emv_pk * volatile sink;
+	t1 = msclock();
+	for (int r = 0; r < storerounds; r++)
+		for (int i = 0; i < nkeys; i++)
+			sink = emv_pk_store_get(keys[i]->rid, keys[i]->index, false);
+	uint64_t storems = msclock() - t1;
+	(void)sink;
+
+	double scanus = 1000.0 * scanms / (scanrounds * nkeys);
+	double storeus = 1000.0 * storems / ((double)storerounds * nkeys);
+	fprintf(stdout, "CAPK lookup latency: file scan %.1f us, store %.3f us", scanus, storeus);
+	if (storeus > 0)
+		fprintf(stdout, " (%.0fx)", scanus / storeus);
+	fprintf(stdout, "\n");
+
+	// offline SDA, DDA and CDA each start with one CA key lookup
+	fprintf(stdout, "CA key lookups of the sda, dda and cda vectors: %.1f us -> %.3f us\n",
+			3 * scanus, 3 * storeus);
+
+	// an offline hf emv exec (hf emv replay) of the CDA vector card,  its CA key
+	// is in capk.txt.  Before the store the transaction also scanned the file.
+	struct emv_replay *rec = cda_test_recording();
+	if (!rec) {
+		fprintf(stderr, "CAPK offline exec: no recording\n");
+		ret = 1;
+		goto out;
+	}
+	int txrounds = 200;
+	struct emv_replay_result r;
+	t1 = msclock();
+	for (int i = 0; i < txrounds; i++) {
+		EMVReplayTransaction(rec, true, false, &r);
+		if (r.res || r.cda)
+			break;
+	}
+	uint64_t txms = msclock() - t1;
+	EMVReplayFree(rec);
+	if (r.res || r.cda) {
+		fprintf(stderr, "CAPK offline exec: res %d CDA %d\n", r.res, r.cda);
+		ret = 1;
+		goto out;
+	}
+
+	t1 = msclock();
+	for (int i = 0; i < txrounds; i++)
+		emv_pk_free(capk_scan(fname, c_mchip_05.rid, c_mchip_05.index, true));
+	uint64_t keyms = msclock() - t1;
+
+	double txus = 1000.0 * txms / txrounds;
+	double oldus = txus - storeus + 1000.0 * keyms / txrounds;
+	fprintf(stdout, "CAPK offline exec: %.1f us a transaction,  %.1f us with the file scan (%.1f%% less)\n",
+			txus, oldus, oldus > 0 ? 100.0 * (oldus - txus) / oldus : 0.0);
+
+out:
+	for (int i = 0; i < nkeys; i++)
+		emv_pk_free(keys[i]);
+	free(keys);
+	return ret;
+}
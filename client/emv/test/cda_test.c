@@ -22,10 +22,14 @@
 #include "../dump.h"
 #include "../tlv.h"
 #include "../emv_pki.h"
+#include "../emvreplay.h"
+#include "crc16.h"
+#include "util_posix.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 struct emv_pk c_mchip_05 = {
 	.rid = { 0xa0, 0x00, 0x00, 0x00, 0x04, },
@@ -419,6 +423,246 @@ static int cda_test_pk(bool verbose)
 	return 0;
 }
 
+/* The vectors above as a recorded M/Chip transaction: SELECT, GPO without
+ * PDOL, three records and GENERATE AC asking for CDA.  CDOL1 carries the
+ * unpredictable number 12345779 the SDAD was signed over.
+ */
+struct cda_exchange {
+	unsigned char cmd[64];
+	size_t cmdlen;
+	unsigned char resp[260];
+	size_t resplen;
+};
+
+static size_t cda_put(unsigned char *buf, size_t pos, const unsigned char *data, size_t len)
+{
+	memcpy(buf + pos, data, len);
+	return pos + len;
+}
+
+static size_t cda_test_exchanges(struct cda_exchange *x)
+{
+	static const unsigned char select_cmd[] = {0x00, 0xa4, 0x04, 0x00, 0x07, 0xa0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10, 0x00};
+	static const unsigned char select_resp[] = {0x6f, 0x1a, 0x84, 0x07, 0xa0, 0x00, 0x00, 0x00, 0x04, 0x10, 0x10,
+		0xa5, 0x0f, 0x50, 0x0a, 'M', 'A', 'S', 'T', 'E', 'R', 'C', 'A', 'R', 'D', 0x87, 0x01, 0x01, 0x90, 0x00};
+	static const unsigned char gpo_cmd[] = {0x80, 0xa8, 0x00, 0x00, 0x02, 0x83, 0x00, 0x00};
+	static const unsigned char gpo_resp[] = {0x80, 0x0a, 0x39, 0x00, 0x08, 0x01, 0x01, 0x01, 0x10, 0x01, 0x02, 0x00, 0x90, 0x00};
+	static const unsigned char sw_ok[] = {0x90, 0x00};
+	size_t n = 0, pos;
+
+	memcpy(x[n].cmd, select_cmd, sizeof(select_cmd));
+	x[n].cmdlen = sizeof(select_cmd);
+	memcpy(x[n].resp, select_resp, sizeof(select_resp));
+	x[n++].resplen = sizeof(select_resp);
+
+	memcpy(x[n].cmd, gpo_cmd, sizeof(gpo_cmd));
+	x[n].cmdlen = sizeof(gpo_cmd);
+	memcpy(x[n].resp, gpo_resp, sizeof(gpo_resp));
+	x[n++].resplen = sizeof(gpo_resp);
+
+	// SFI 1 record 1, signed static data.  The AIP at its end comes from 9F4A
+	x[n].cmdlen = cda_put(x[n].cmd, 0, (unsigned char[]){0x00, 0xb2, 0x01, 0x0c, 0x00}, 5);
+	pos = cda_put(x[n].resp, 0, (unsigned char[]){0x70, 0x81, sizeof(c_ssd1) - 2}, 3);
+	pos = cda_put(x[n].resp, pos, c_ssd1, sizeof(c_ssd1) - 2);
+	x[n].resplen = cda_put(x[n].resp, pos, sw_ok, 2);
+	n++;
+
+	// SFI 2 record 1, CA key index and issuer certificate
+	x[n].cmdlen = cda_put(x[n].cmd, 0, (unsigned char[]){0x00, 0xb2, 0x01, 0x14, 0x00}, 5);
+	pos = cda_put(x[n].resp, 0, (unsigned char[]){0x70, 0x81, 0xe0, 0x8f, 0x01, 0x05, 0x90, 0x81, sizeof(c_issuer_cert)}, 9);
+	pos = cda_put(x[n].resp, pos, c_issuer_cert, sizeof(c_issuer_cert));
+	pos = cda_put(x[n].resp, pos, (unsigned char[]){0x9f, 0x32, 0x01, 0x03, 0x92, sizeof(c_issuer_rem)}, 6);
+	pos = cda_put(x[n].resp, pos, c_issuer_rem, sizeof(c_issuer_rem));
+	x[n].resplen = cda_put(x[n].resp, pos, sw_ok, 2);
+	n++;
+
+	// SFI 2 record 2, ICC certificate
+	x[n].cmdlen = cda_put(x[n].cmd, 0, (unsigned char[]){0x00, 0xb2, 0x02, 0x14, 0x00}, 5);
+	pos = cda_put(x[n].resp, 0, (unsigned char[]){0x70, 0x81, 0xb8, 0x9f, 0x46, 0x81, sizeof(c_icc_cert)}, 7);
+	pos = cda_put(x[n].resp, pos, c_icc_cert, sizeof(c_icc_cert));
+	pos = cda_put(x[n].resp, pos, (unsigned char[]){0x9f, 0x47, 0x01, 0x03}, 4);
+	x[n].resplen = cda_put(x[n].resp, pos, sw_ok, 2);
+	n++;
+
+	// GENERATE AC, TC + CDA request
+	pos = cda_put(x[n].cmd, 0, (unsigned char[]){0x80, 0xae, 0x50, 0x00, sizeof(c_crm1)}, 5);
+	pos = cda_put(x[n].cmd, pos, c_crm1, sizeof(c_crm1));
+	x[n].cmdlen = cda_put(x[n].cmd, pos, (unsigned char[]){0x00}, 1);
+	pos = cda_put(x[n].resp, 0, (unsigned char[]){0x77, 0x81, 0x91, 0x9f, 0x27, 0x01, 0x40, 0x9f, 0x36, 0x02, 0x00, 0x10,
+		0x9f, 0x4b, sizeof(c_sdad_cr)}, 15);
+	pos = cda_put(x[n].resp, pos, c_sdad_cr, sizeof(c_sdad_cr));
+	pos = cda_put(x[n].resp, pos, (unsigned char[]){0x9f, 0x10, 0x12,
+		0x00, 0x10, 0x90, 0x40, 0x01, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff}, 21);
+	x[n].resplen = cda_put(x[n].resp, pos, sw_ok, 2);
+	n++;
+
+	return n;
+}
+
+// as `hf emv exec -a` logs it
+static size_t cda_test_log(const struct cda_exchange *x, size_t n, char *log, size_t size)
+{
+	size_t pos = snprintf(log, size, "\n* Selecting AID:A0000000041010\n");
+	for (size_t i = 0; i < n; i++) {
+		pos += snprintf(log + pos, size - pos, ">>>> ");
+		for (size_t j = 0; j < x[i].cmdlen; j++)
+			pos += snprintf(log + pos, size - pos, "%02x ", x[i].cmd[j]);
+		pos += snprintf(log + pos, size - pos, "\r\n<<<< ");
+		for (size_t j = 0; j < x[i].resplen; j++)
+			pos += snprintf(log + pos, size - pos, "%02x ", x[i].resp[j]);
+		pos += snprintf(log + pos, size - pos, "\n");
+	}
+	return pos;
+}
+
+static size_t cda_trace_frame(unsigned char *trace, size_t pos, bool isResponse, unsigned char pcb, const unsigned char *inf, size_t inflen)
+{
+	unsigned char frame[64];
+	size_t len = 0;
+
+	frame[len++] = pcb;
+	memcpy(frame + len, inf, inflen);
+	len += inflen;
+	if (pcb != 0x26) {
+		compute_crc(CRC_14443_A, frame, len, &frame[len], &frame[len + 1]);
+		len += 2;
+	}
+
+	uint16_t data_len = len | (isResponse ? 0x8000 : 0);
+	memset(trace + pos, 0, 6);
+	trace[pos + 6] = data_len & 0xff;
+	trace[pos + 7] = data_len >> 8;
+	memcpy(trace + pos + 8, frame, len);
+	memset(trace + pos + 8 + len, 0, (len - 1) / 8 + 1);
+	return pos + 8 + len + (len - 1) / 8 + 1;
+}
+
+// as `trace save` writes it,  card answers chained in 32 byte blocks
+static size_t cda_test_trace(const struct cda_exchange *x, size_t n, unsigned char *trace)
+{
+	unsigned char block = 0;
+	size_t pos = cda_trace_frame(trace, 0, false, 0x26, NULL, 0);
+	pos = cda_trace_frame(trace, pos, true, 0x05, (unsigned char[]){0x78, 0x80, 0x70, 0x02}, 4);
+
+	for (size_t i = 0; i < n; i++) {
+		pos = cda_trace_frame(trace, pos, false, 0x02 | block, x[i].cmd, x[i].cmdlen);
+		for (size_t done = 0; done < x[i].resplen; ) {
+			size_t l = x[i].resplen - done > 32 ? 32 : x[i].resplen - done;
+			bool more = done + l < x[i].resplen;
+			pos = cda_trace_frame(trace, pos, true, 0x02 | block | (more ? 0x10 : 0), x[i].resp + done, l);
+			done += l;
+			block ^= 1;
+			if (more)
+				pos = cda_trace_frame(trace, pos, false, 0xa2 | block, NULL, 0);
+		}
+		// S(WTX) in between,  not part of any APDU
+		pos = cda_trace_frame(trace, pos, true, 0xf2, (unsigned char[]){0x01}, 1);
+		pos = cda_trace_frame(trace, pos, false, 0xf2, (unsigned char[]){0x01}, 1);
+	}
+	return pos;
+}
+
+struct emv_replay *cda_test_recording(void)
+{
+	struct cda_exchange x[8];
+	size_t n = cda_test_exchanges(x);
+	char *log = malloc(16384);
+	if (!log)
+		return NULL;
+
+	struct emv_replay *rec = EMVReplayParse("log", (unsigned char *)log, cda_test_log(x, n, log, 16384));
+	free(log);
+	return rec;
+}
+
+static int cda_test_replay(bool verbose)
+{
+	struct cda_exchange x[8];
+	struct emv_replay_result r[2];
+	struct emv_replay *rec[2] = {NULL, NULL};
+	int res = 2;
+
+	size_t n = cda_test_exchanges(x);
+	char *log = malloc(16384);
+	unsigned char *trace = malloc(16384);
+	if (!log || !trace)
+		goto out;
+
+	rec[0] = EMVReplayParse("log", (unsigned char *)log, cda_test_log(x, n, log, 16384));
+	rec[1] = EMVReplayParse("trace", trace, cda_test_trace(x, n, trace));
+	for (int i = 0; i < 2; i++) {
+		if (!rec[i] || rec[i]->count != n) {
+			fprintf(stderr, "Recording %d: %zu exchanges instead of %zu\n", i, rec[i] ? rec[i]->count : 0, n);
+			goto out;
+		}
+		for (size_t j = 0; j < n; j++) {
+			if (rec[i]->apdu[j].cmdlen != x[j].cmdlen || memcmp(rec[i]->apdu[j].cmd, x[j].cmd, x[j].cmdlen) ||
+				rec[i]->apdu[j].resplen != x[j].resplen || memcmp(rec[i]->apdu[j].resp, x[j].resp, x[j].resplen)) {
+				fprintf(stderr, "Recording %d: exchange %zu differs\n", i, j);
+				goto out;
+			}
+		}
+	}
+
+	EMVReplayTransaction(rec[0], !verbose, false, &r[0]);
+	if (r[0].res || r[0].cda || r[0].sda != EMVREPLAY_NOTDONE || r[0].dda != EMVREPLAY_NOTDONE || r[0].AIP != 0x0039) {
+		fprintf(stderr, "Replay: res %d AIP %04x SDA %d DDA %d CDA %d\n", r[0].res, r[0].AIP, r[0].sda, r[0].dda, r[0].cda);
+		goto out;
+	}
+
+	// another amount in CDOL1 than the card signed
+	rec[1]->apdu[n - 1].cmd[10] ^= 0x01;
+	EMVReplayTransaction(rec[1], true, false, &r[1]);
+	rec[1]->apdu[n - 1].cmd[10] ^= 0x01;
+	if (r[1].res || r[1].cda == 0) {
+		fprintf(stderr, "Replay of a changed CDOL1 passed CDA\n");
+		goto out;
+	}
+
+	uint64_t t = msclock();
+	int total = EMVReplayBatch(rec, 2, 50, 2, r);
+	t = msclock() - t;
+	if (r[0].res || r[0].cda || r[1].res || r[1].cda) {
+		fprintf(stderr, "Batch replay: CDA %d %d\n", r[0].cda, r[1].cda);
+		goto out;
+	}
+	if (verbose)
+		printf("Batch replay: %d transactions in %" PRIu64 " ms\n", total, t);
+
+	res = 0;
+out:
+	EMVReplayFree(rec[0]);
+	EMVReplayFree(rec[1]);
+	free(log);
+	free(trace);
+	return res;
+}
+
+// the chain again,  CA key opened for every certificate and then prepared once
+static int cda_test_bench(void)
+{
+	const int rounds = 200;
+
+	uint64_t ms = msclock();
+	for (int i = 0; i < rounds; i++)
+		if (cda_test_pk(false))
+			return 1;
+	ms = msclock() - ms;
+
+	emv_pk_prepare(&c_mchip_05);
+	uint64_t msp = msclock();
+	for (int i = 0; i < rounds; i++)
+		if (cda_test_pk(false))
+			break;
+	msp = msclock() - msp;
+	crypto_pk_close(c_mchip_05.cp);
+	c_mchip_05.cp = NULL;
+
+	printf("CDA test pk: %d runs in %" PRIu64 " ms,  %" PRIu64 " ms with the CA key prepared\n", rounds, ms, msp);
+
+	return 0;
+}
+
 int exec_cda_test(bool verbose)
 {
 	int ret;
@@ -438,5 +682,18 @@ int exec_cda_test(bool verbose)
 	}
 	fprintf(stdout, "CDA test pk: passed\n");
 
+	ret = cda_test_bench();
+	if (ret) {
+		fprintf(stderr, "CDA test pk benchmark: failed\n");
+		return ret;
+	}
+
+	ret = cda_test_replay(verbose);
+	if (ret) {
+		fprintf(stderr, "CDA replay test: failed\n");
+		return ret;
+	}
+	fprintf(stdout, "CDA replay test: passed\n");
+
 	return 0;
 }
@@ -15,4 +15,8 @@
 
 #include <stdbool.h> 
  
+struct emv_replay;
+
 extern int exec_cda_test(bool verbose);
+// the log recording of the CDA vector transaction,  free with EMVReplayFree()
+extern struct emv_replay *cda_test_recording(void);
@@ -18,8 +18,10 @@
 #endif
 
 #include "../crypto.h"
+#include "../crypto_mont.h"
 #include "../dump.h"
 #include "util_posix.h"
+#include "rsa.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -300,6 +302,106 @@ close_pub:
 	return ret;
 }
 
+// the verify of an opened key against polarssl rsa_public() on the same key.
+// e=3 takes the Montgomery path,  e=65537 rsa_public() with R^2 mod N set up.
+static int test_mont(unsigned int keylength, unsigned int exp, bool verbose)
+{
+	const int rounds = 1000;
+	int ret = 1;
+	unsigned char *mod, *e;
+	size_t modlen, elen;
+	unsigned char *in = NULL, *out = NULL, *out2 = NULL;
+	struct crypto_mont mont;
+	struct crypto_pk *kcp = NULL;
+	rsa_context rsa;
+
+	printf("Testing RSA verify %u bit e=%u ", keylength, exp);
+
+	struct crypto_pk *pk = crypto_pk_genkey(PK_RSA, 1, keylength, exp);
+	if (!pk) {
+		fprintf(stderr, "ERROR: key generation error.\n");
+		return 1;
+	}
+	mod = crypto_pk_get_parameter(pk, 0, &modlen);
+	e = crypto_pk_get_parameter(pk, 1, &elen);
+	crypto_pk_close(pk);
+
+	rsa_init(&rsa, RSA_PKCS_V15, 0);
+	rsa.len = modlen;
+	mpi_read_binary(&rsa.N, mod, modlen);
+	mpi_read_binary(&rsa.E, e, elen);
+
+	if (crypto_mont_init(&mont, mod, modlen, e, elen) != (exp == 3)) {
+		fprintf(stderr, "ERROR: crypto_mont_init.\n");
+		goto out;
+	}
+
+	// input equal to the modulus is refused,  as rsa_public() does
+	unsigned char tmp[MONT_MAX_BITS / 8];
+	if (exp == 3 && crypto_mont_public(&mont, mod, tmp)) {
+		fprintf(stderr, "ERROR: crypto_mont_public accepted N.\n");
+		goto out;
+	}
+
+	kcp = crypto_pk_open(PK_RSA, mod, modlen, e, elen);
+	if (!kcp) {
+		fprintf(stderr, "ERROR: crypto_pk_open.\n");
+		goto out;
+	}
+
+	in = malloc(rounds * modlen);
+	out = malloc(rounds * modlen);
+	out2 = malloc(rounds * modlen);
+	for (size_t j = 0; j < rounds * modlen; j++)
+		in[j] = rand();
+	for (int i = 0; i < rounds; i++)
+		in[i * modlen] %= mod[0];
+
+	uint64_t mont_ms = msclock();
+	for (int i = 0; i < rounds; i++) {
+		size_t clen;
+		unsigned char *c = crypto_pk_encrypt(kcp, in + i * modlen, modlen, &clen);
+		if (!c || clen != modlen) {
+			fprintf(stderr, "ERROR: crypto_pk_encrypt.\n");
+			free(c);
+			goto out;
+		}
+		memcpy(out + i * modlen, c, modlen);
+		free(c);
+	}
+	mont_ms = msclock() - mont_ms;
+
+	uint64_t rsa_ms = msclock();
+	for (int i = 0; i < rounds; i++)
+		rsa_public(&rsa, in + i * modlen, out2 + i * modlen);
+	rsa_ms = msclock() - rsa_ms;
+
+	for (int i = 0; i < rounds; i++)
+		if (memcmp(out + i * modlen, out2 + i * modlen, modlen)) {
+			fprintf(stderr, "ERROR: verify result differs from rsa_public.\n");
+			if (verbose) {
+				dump_buffer(out + i * modlen, modlen, stderr, 0);
+				dump_buffer(out2 + i * modlen, modlen, stderr, 0);
+			}
+			goto out;
+		}
+
+	printf("passed. (%d verifies %"PRIu64" ms %s, rsa_public %"PRIu64" ms) \n", rounds, mont_ms,
+		exp == 3 ? "Montgomery" : "prepared key", rsa_ms);
+	ret = 0;
+out:
+	if (kcp)
+		crypto_pk_close(kcp);
+	rsa_free(&rsa);
+	free(in);
+	free(out);
+	free(out2);
+	free(mod);
+	free(e);
+
+	return ret;
+}
+
 int exec_crypto_test(bool verbose)
 {
 	unsigned int keylengths[] = {1024, 1152, 1408, 1984, 2048, 3072, 4096};
@@ -323,5 +425,16 @@ int exec_crypto_test(bool verbose)
 		}
 	}
 
+	// the key sizes and exponents EMV uses
+	unsigned int montlengths[] = {1024, 1152, 1408, 1984};
+	for (i = 0; i < sizeof(montlengths) / sizeof(montlengths[0]); i++) {
+		unsigned int kl = montlengths[i];
+		ret = test_mont(kl, 3, verbose) || test_mont(kl, 65537, verbose);
+		if (ret) {
+			fprintf(stderr, "Crypto Montgomery[%d] test: failed\n", kl);
+			return ret;
+		}
+	}
+
 	return 0;
 }
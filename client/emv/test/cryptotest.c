@@ -22,6 +22,10 @@
 #include "sda_test.h"
 #include "dda_test.h"
 #include "cda_test.h"
+#include "capk_test.h"
+#include "tlv_test.h"
+#include "apdu_test.h"
+#include "aidprobe_test.h"
 
 int ExecuteCryptoTests(bool verbose) {
 	int res;
@@ -51,6 +55,18 @@ int ExecuteCryptoTests(bool verbose) {
 	res = exec_cda_test(verbose);
 	if (res) TestFail = true;
 
+	res = exec_capk_test(verbose);
+	if (res) TestFail = true;
+
+	res = exec_tlv_test(verbose);
+	if (res) TestFail = true;
+
+	res = exec_apdu_test(verbose);
+	if (res) TestFail = true;
+
+	res = exec_aidprobe_test(verbose);
+	if (res) TestFail = true;
+
 	res = exec_crypto_test(verbose);
 	if (res) TestFail = true;
 
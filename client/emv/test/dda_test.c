@@ -24,10 +24,12 @@
 #include "../dump.h"
 #include "../tlv.h"
 #include "../emv_pki.h"
+#include "util_posix.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 struct emv_pk mchip_05 = {
 	.rid = { 0xa0, 0x00, 0x00, 0x00, 0x04, },
@@ -367,6 +369,31 @@ static int dda_test_pk(bool verbose)
 	return 0;
 }
 
+// the chain again,  CA key opened for every certificate and then prepared once
+static int dda_test_bench(void)
+{
+	const int rounds = 200;
+
+	uint64_t ms = msclock();
+	for (int i = 0; i < rounds; i++)
+		if (dda_test_pk(false))
+			return 1;
+	ms = msclock() - ms;
+
+	emv_pk_prepare(&mchip_05);
+	uint64_t msp = msclock();
+	for (int i = 0; i < rounds; i++)
+		if (dda_test_pk(false))
+			break;
+	msp = msclock() - msp;
+	crypto_pk_close(mchip_05.cp);
+	mchip_05.cp = NULL;
+
+	printf("DDA test pk: %d runs in %" PRIu64 " ms,  %" PRIu64 " ms with the CA key prepared\n", rounds, ms, msp);
+
+	return 0;
+}
+
 int exec_dda_test(bool verbose)
 {
 	int ret;
@@ -386,5 +413,11 @@ int exec_dda_test(bool verbose)
 	}
 	fprintf(stdout, "DDA test pk: passed\n");
 
+	ret = dda_test_bench();
+	if (ret) {
+		fprintf(stderr, "DDA test pk benchmark: failed\n");
+		return ret;
+	}
+
 	return 0;
 }
@@ -22,10 +22,12 @@
 #include "../dump.h"
 #include "../tlv.h"
 #include "../emv_pki.h"
+#include "util_posix.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 
 struct emv_pk vsdc_01 = {
 	.rid = { 0xa0, 0x00, 0x00, 0x00, 0x03, },
@@ -254,6 +256,31 @@ static int sda_test_pk(bool verbose)
 	return 0;
 }
 
+// the chain again,  CA key opened for every certificate and then prepared once
+static int sda_test_bench(void)
+{
+	const int rounds = 200;
+
+	uint64_t ms = msclock();
+	for (int i = 0; i < rounds; i++)
+		if (sda_test_pk(false))
+			return 1;
+	ms = msclock() - ms;
+
+	emv_pk_prepare(&vsdc_01);
+	uint64_t msp = msclock();
+	for (int i = 0; i < rounds; i++)
+		if (sda_test_pk(false))
+			break;
+	msp = msclock() - msp;
+	crypto_pk_close(vsdc_01.cp);
+	vsdc_01.cp = NULL;
+
+	printf("SDA test pk: %d runs in %" PRIu64 " ms,  %" PRIu64 " ms with the CA key prepared\n", rounds, ms, msp);
+
+	return 0;
+}
+
 int exec_sda_test(bool verbose)
 {
 	int ret;
@@ -273,5 +300,11 @@ int exec_sda_test(bool verbose)
 	}
 	fprintf(stdout, "SDA test pk: passed\n");
 
+	ret = sda_test_bench();
+	if (ret) {
+		fprintf(stderr, "SDA test pk benchmark: failed\n");
+		return ret;
+	}
+
 	return 0;
 }
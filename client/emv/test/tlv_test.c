@@ -0,0 +1,215 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// TLV database tests
+//-----------------------------------------------------------------------------
+
+#include "tlv_test.h"
+
+#include "../tlv.h"
+#include "proxmark3.h"
+#include "util_posix.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+#define TLV_TEST_MAXTAGS 64
+
+// tag lists from traces/EMV, one "0xTAG:HEXVALUE" per line
+static const char *tlv_test_files[] = {
+	"mastercardtags.txt", "visaCVN17.txt", "visaDCVV.txt",
+	"visaEMV.txt", "visaFDDA.txt", "visatags.txt",
+};
+
+typedef struct {
+	tlv_tag_t tag[TLV_TEST_MAXTAGS];
+	int count;
+	unsigned char buf[2048];
+	size_t len;
+} tlv_test_dump_t;
+
+static bool tlv_test_put(tlv_test_dump_t *d, const struct tlv *tlv)
+{
+	size_t len;
+	unsigned char *enc = tlv_encode(tlv, &len);
+	if (!enc || d->len + len > sizeof(d->buf)) {
+		free(enc);
+		return false;
+	}
+	memcpy(d->buf + d->len, enc, len);
+	d->len += len;
+	free(enc);
+	return true;
+}
+
+// the tags as a 70 record template followed by the same tags at top level
+static bool tlv_test_load(const char *fname, tlv_test_dump_t *d)
+{
+	FILE *f = fopen(fname, "r");
+	if (!f)
+		return false;
+
+	unsigned char flat[1024], values[TLV_TEST_MAXTAGS][128];
+	size_t vlen[TLV_TEST_MAXTAGS];
+	char line[300];
+
+	d->count = 0;
+	d->len = 0;
+	while (d->count < TLV_TEST_MAXTAGS && fgets(line, sizeof(line), f)) {
+		unsigned int tag;
+		char hex[260];
+		if (sscanf(line, "0x%x:%256s", &tag, hex) != 2)
+			continue;
+		size_t n = 0;
+		for (unsigned int b; n < sizeof(values[0]) && sscanf(hex + 2 * n, "%2x", &b) == 1; n++)
+			values[d->count][n] = b;
+		vlen[d->count] = n;
+		d->tag[d->count++] = tag;
+	}
+	fclose(f);
+
+	size_t flen = 0;
+	for (int i = 0; i < d->count; i++) {
+		struct tlv tlv = {d->tag[i], vlen[i], values[i]};
+		if (!tlv_test_put(d, &tlv))
+			return false;
+	}
+	flen = d->len;
+	if (flen > sizeof(flat))
+		return false;
+	memcpy(flat, d->buf, flen);
+
+	struct tlv record = {0x70, flen, flat};
+	d->len = 0;
+	if (!tlv_test_put(d, &record))
+		return false;
+	memcpy(d->buf + d->len, flat, flen);
+	d->len += flen;
+	return d->count > 0;
+}
+
+static int tlv_test_occurrences(const struct tlvdb *db, tlv_tag_t tag)
+{
+	int n = 0;
+	for (const struct tlv *t = tlvdb_get(db, tag, NULL); t; t = tlvdb_get(db, tag, t))
+		n++;
+	return n;
+}
+
+// every lookup must give the same node with and without index, and
+// tags must be found through a tlvdb_fixed() root they were added to
+static int tlv_test_check(const tlv_test_dump_t *d)
+{
+	struct tlvdb *indexed = tlvdb_parse_multi(d->buf, d->len);
+	struct tlvdb *linear = tlvdb_parse_multi_ex(d->buf, d->len, TLVDB_MULTI | TLVDB_NOCOPY);
+	struct tlvdb *chained = tlvdb_fixed(0x01, 1, (const unsigned char *)"x");
+	tlvdb_add(chained, tlvdb_parse_multi(d->buf, d->len));
+	tlvdb_add(chained, tlvdb_fixed(0xdf7f, 1, (const unsigned char *)"y"));
+	int ret = !indexed || !linear;
+
+	for (int i = 0; i < d->count && !ret; i++) {
+		const struct tlv *a = tlvdb_get(indexed, d->tag[i], NULL);
+		const struct tlv *b = tlvdb_get(linear, d->tag[i], NULL);
+		const struct tlv *c = tlvdb_get(chained, d->tag[i], NULL);
+		int dup = 0;
+		for (int j = 0; j < d->count; j++)
+			dup += d->tag[j] == d->tag[i];
+
+		if (!a || !tlv_equal(a, b) || !tlv_equal(a, c) || b->value < d->buf || b->value >= d->buf + d->len)
+			ret = 1;
+		// once in the record, once at top level
+		if (tlv_test_occurrences(indexed, d->tag[i]) != 2 * dup || tlv_test_occurrences(chained, d->tag[i]) != 2 * dup)
+			ret = 1;
+	}
+	if (tlvdb_get(indexed, 0xdf7f, NULL) || tlvdb_get(linear, 0xdf7f, NULL) || !tlvdb_get(chained, 0xdf7f, NULL))
+		ret = 1;
+	if (!ret && !tlv_equal(tlvdb_get(indexed, 0x70, NULL), tlvdb_get(linear, 0x70, NULL)))
+		ret = 1;
+
+	tlvdb_free(indexed);
+	tlvdb_free(linear);
+	tlvdb_free(chained);
+	return ret;
+}
+
+static void tlv_test_bench(const tlv_test_dump_t *dumps, int ndumps, int flags, int rounds, double *parsens, double *getns)
+{
+	struct tlvdb *db[ndumps];
+	const struct tlv * volatile sink;
+	uint64_t gets = 0;
+
+	uint64_t t1 = msclock();
+	for (int r = 0; r < rounds; r++)
+		for (int i = 0; i < ndumps; i++)
+			tlvdb_free(tlvdb_parse_multi_ex(dumps[i].buf, dumps[i].len, flags));
+	*parsens = 1e6 * (msclock() - t1) / ((double)rounds * ndumps);
+
+	for (int i = 0; i < ndumps; i++)
+		db[i] = tlvdb_parse_multi_ex(dumps[i].buf, dumps[i].len, flags);
+	t1 = msclock();
+	for (int r = 0; r < rounds; r++) {
+		for (int i = 0; i < ndumps; i++) {
+			for (int j = 0; j < dumps[i].count; j++)
+				sink = tlvdb_get(db[i], dumps[i].tag[j], NULL);
+			// a miss walks the whole db
+			sink = tlvdb_get(db[i], 0xdf7f, NULL);
+			gets += dumps[i].count + 1;
+		}
+	}
+	*getns = 1e6 * (msclock() - t1) / (double)gets;
+	for (int i = 0; i < ndumps; i++)
+		tlvdb_free(db[i]);
+	(void)sink;
+}
+
+int exec_tlv_test(bool verbose)
+{
+	tlv_test_dump_t *dumps = calloc(sizeof(tlv_test_files) / sizeof(tlv_test_files[0]), sizeof(tlv_test_dump_t));
+	int ndumps = 0, ret = 0;
+	if (!dumps)
+		return 1;
+
+	fprintf(stdout, "\n");
+	for (int i = 0; i < sizeof(tlv_test_files) / sizeof(tlv_test_files[0]); i++) {
+		char fname[1024];
+		snprintf(fname, sizeof(fname), "%s../traces/EMV/%s", get_my_executable_directory(), tlv_test_files[i]);
+		if (!tlv_test_load(fname, &dumps[ndumps]))
+			continue;
+		if (tlv_test_check(&dumps[ndumps])) {
+			fprintf(stderr, "TLV db test %s: failed\n", tlv_test_files[i]);
+			ret = 1;
+			goto out;
+		}
+		if (verbose)
+			fprintf(stdout, "TLV db test %s (%d tags, %zu bytes): passed\n", tlv_test_files[i], dumps[ndumps].count, dumps[ndumps].len);
+		ndumps++;
+	}
+	if (!ndumps) {
+		fprintf(stdout, "TLV db test: traces/EMV not found, skipped\n");
+		goto out;
+	}
+	fprintf(stdout, "TLV db test (%d dumps): passed\n", ndumps);
+
+	static const struct {
+		const char *name;
+		int flags;
+	} modes[] = {
+		{"copy", TLVDB_MULTI},
+		{"copy + index", TLVDB_MULTI | TLVDB_INDEX},
+		{"zero copy", TLVDB_MULTI | TLVDB_NOCOPY},
+		{"zero copy + index", TLVDB_MULTI | TLVDB_NOCOPY | TLVDB_INDEX},
+	};
+	for (int i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		double parsens, getns;
+		tlv_test_bench(dumps, ndumps, modes[i].flags, 100000, &parsens, &getns);
+		fprintf(stdout, "TLV db %-18s parse %7.0f ns/dump, tlvdb_get %5.1f ns\n", modes[i].name, parsens, getns);
+	}
+
+out:
+	free(dumps);
+	return ret;
+}
@@ -41,11 +41,14 @@
 //	const typeof( ((type *)0)->member ) *__mptr = (ptr);	
 //        (type *)( (char *)__mptr - offsetof(type,member) );})
 
+struct tlvdb_arena;
+
 struct tlvdb {
 	struct tlv tag;
 	struct tlvdb *next;
 	struct tlvdb *parent;
 	struct tlvdb *children;
+	struct tlvdb_arena *arena;	// NULL for nodes allocated one by one
 };
 
 struct tlvdb_root {
@@ -54,6 +57,20 @@ struct tlvdb_root {
 	unsigned char buf[0];
 };
 
+// A parsed buffer lives in one allocation: the nodes in parse (depth
+// first) order, this header, the optional tag index and the optional copy
+// of the source buffer.  The first node is at the start of the block, like
+// the root of a tlvdb_fixed().  Nodes are released all at once by
+// tlvdb_free() when it walks off the last top level node.
+struct tlvdb_arena {
+	struct tlvdb *node;		// start of the allocation
+	size_t count;
+	size_t used;
+	struct tlvdb *last;		// last top level node of the parse
+	const struct tlvdb **index;	// first node of each tag, open addressing, NULL if no index
+	size_t mask;
+};
+
 static tlv_tag_t tlv_parse_tag(const unsigned char **buf, size_t *len)
 {
 	tlv_tag_t tag;
@@ -121,15 +138,51 @@ bool tlv_parse_tl(const unsigned char **buf, size_t *len, struct tlv *tlv)
 	return true;
 }
 
-static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent);
+// number of elements in buf, constructed values are stepped into rather
+// than over.  Exact for well formed data, the parse checks the rest.
+static size_t tlv_count(const unsigned char *buf, size_t len)
+{
+	const unsigned char *end = buf + len;
+	size_t count = 0;
+
+	while (buf < end) {
+		bool constructed = *buf & TLV_TAG_COMPLEX;
+		if ((*buf++ & TLV_TAG_VALUE_MASK) == TLV_TAG_VALUE_CONT)
+			buf++;
+		if (buf >= end)
+			break;
+		size_t l = *buf++;
+		if (l & TLV_LEN_LONG) {
+			if (buf >= end)
+				break;
+			l = *buf++;
+		}
+		count++;
+		if (!constructed)
+			buf += l;
+	}
+	return count;
+}
+
+static size_t tlvdb_index_slot(const struct tlvdb_arena *arena, tlv_tag_t tag)
+{
+	size_t i = ((uint32_t)tag * 2654435761u) >> 8;
+	for (i &= arena->mask; arena->index[i] && arena->index[i]->tag.tag != tag; i = (i + 1) & arena->mask)
+		;
+	return i;
+}
 
-static bool tlvdb_parse_one(struct tlvdb *tlvdb,
+static struct tlvdb *tlvdb_parse_children(struct tlvdb_arena *arena, struct tlvdb *parent);
+
+static bool tlvdb_parse_one(struct tlvdb_arena *arena,
+		struct tlvdb *tlvdb,
 		struct tlvdb *parent,
 		const unsigned char **tmp,
 		size_t *left)
 {
 	tlvdb->next = tlvdb->children = NULL;
 	tlvdb->parent = parent;
+	tlvdb->arena = arena;
 
 	tlvdb->tag.tag = tlv_parse_tag(tmp, left);
 	if (tlvdb->tag.tag == TLV_TAG_INVALID)
@@ -147,8 +200,14 @@ static bool tlvdb_parse_one(struct tlvdb *tlvdb,
 	*tmp += tlvdb->tag.len;
 	*left -= tlvdb->tag.len;
 
+	if (arena->index) {
+		size_t i = tlvdb_index_slot(arena, tlvdb->tag.tag);
+		if (!arena->index[i])
+			arena->index[i] = tlvdb;
+	}
+
 	if (tlv_is_constructed(&tlvdb->tag) && (tlvdb->tag.len != 0)) {
-		tlvdb->children = tlvdb_parse_children(tlvdb);
+		tlvdb->children = tlvdb_parse_children(arena, tlvdb);
 		if (!tlvdb->children)
 			goto err;
 	} else {
@@ -161,99 +220,103 @@ err:
 	return false;
 }
 
-static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent)
+static struct tlvdb *tlvdb_parse_children(struct tlvdb_arena *arena, struct tlvdb *parent)
 {
 	const unsigned char *tmp = parent->tag.value;
 	size_t left = parent->tag.len;
 	struct tlvdb *tlvdb, *first = NULL, *prev = NULL;
 
 	while (left != 0) {
-		tlvdb = malloc(sizeof(*tlvdb));
+		if (arena->used == arena->count)
+			return NULL;
+		tlvdb = &arena->node[arena->used++];
 		if (prev)
 			prev->next = tlvdb;
 		else
 			first = tlvdb;
 		prev = tlvdb;
 
-		if (!tlvdb_parse_one(tlvdb, parent, &tmp, &left))
-			goto err;
-
-		tlvdb->parent = parent;
+		if (!tlvdb_parse_one(arena, tlvdb, parent, &tmp, &left))
+			return NULL;
 	}
 
 	return first;
-
-err:
-	tlvdb_free(first);
-
-	return NULL;
 }
 
-struct tlvdb *tlvdb_parse(const unsigned char *buf, size_t len)
+struct tlvdb *tlvdb_parse_multi_ex(const unsigned char *buf, size_t len, int flags)
 {
-	struct tlvdb_root *root;
+	struct tlvdb_arena *arena;
 	const unsigned char *tmp;
-	size_t left;
+	size_t left, count = 0, slots = 0;
 
 	if (!len || !buf)
 		return NULL;
 
-	root = malloc(sizeof(*root) + len);
-	root->len = len;
-	memcpy(root->buf, buf, len);
+	count = tlv_count(buf, len);
+	if (!count)
+		return NULL;
 
-	tmp = root->buf;
+	if (flags & TLVDB_INDEX)
+		for (slots = 8; slots < count * 2; slots <<= 1)
+			;
+
+	size_t nodes = count * sizeof(struct tlvdb) + sizeof(*arena);
+	size_t size = nodes + slots * sizeof(struct tlvdb *) + ((flags & TLVDB_NOCOPY) ? 0 : len);
+	struct tlvdb *block = malloc(size);
+	if (!block)
+		return NULL;
+
+	arena = (struct tlvdb_arena *)(block + count);
+	arena->node = block;
+	arena->count = count;
+	arena->used = 0;
+	arena->last = NULL;
+	arena->index = slots ? (const struct tlvdb **)((unsigned char *)block + nodes) : NULL;
+	arena->mask = slots - 1;
+	if (slots)
+		memset(arena->index, 0, slots * sizeof(struct tlvdb *));
+
+	if (flags & TLVDB_NOCOPY) {
+		tmp = buf;
+	} else {
+		unsigned char *copy = (unsigned char *)block + nodes + slots * sizeof(struct tlvdb *);
+		memcpy(copy, buf, len);
+		tmp = copy;
+	}
 	left = len;
 
-	if (!tlvdb_parse_one(&root->db, NULL, &tmp, &left))
-		goto err;
+	while (left != 0) {
+		if (arena->used == arena->count)
+			goto err;
+		struct tlvdb *db = &arena->node[arena->used++];
+		if (!tlvdb_parse_one(arena, db, NULL, &tmp, &left))
+			goto err;
+		if (arena->last)
+			arena->last->next = db;
+		arena->last = db;
+		if (!(flags & TLVDB_MULTI))
+			break;
+	}
 
 	if (left)
 		goto err;
 
-	return &root->db;
+	return block;
 
 err:
-	tlvdb_free(&root->db);
+	free(block);
 
 	return NULL;
 }
 
-struct tlvdb *tlvdb_parse_multi(const unsigned char *buf, size_t len)
+struct tlvdb *tlvdb_parse(const unsigned char *buf, size_t len)
 {
-	struct tlvdb_root *root;
-	const unsigned char *tmp;
-	size_t left;
-
-	if (!len || !buf)
-		return NULL;
-
-	root = malloc(sizeof(*root) + len);
-	root->len = len;
-	memcpy(root->buf, buf, len);
-
-	tmp = root->buf;
-	left = len;
-
-	if (!tlvdb_parse_one(&root->db, NULL, &tmp, &left))
-		goto err;
-
-	while (left != 0) {
-		struct tlvdb *db = malloc(sizeof(*db));
-		if (!tlvdb_parse_one(db, NULL, &tmp, &left)) {
-			free (db);
-			goto err;
-		}
-
-		tlvdb_add(&root->db, db);
-	}
-
-	return &root->db;
-
-err:
-	tlvdb_free(&root->db);
+	return tlvdb_parse_multi_ex(buf, len, TLVDB_INDEX);
+}
 
-	return NULL;
+struct tlvdb *tlvdb_parse_multi(const unsigned char *buf, size_t len)
+{
+	return tlvdb_parse_multi_ex(buf, len, TLVDB_MULTI | TLVDB_INDEX);
 }
 
 struct tlvdb *tlvdb_fixed(tlv_tag_t tag, size_t len, const unsigned char *value)
@@ -264,6 +327,7 @@ struct tlvdb *tlvdb_fixed(tlv_tag_t tag, size_t len, const unsigned char *value)
 	memcpy(root->buf, value, len);
 
 	root->db.parent = root->db.next = root->db.children = NULL;
+	root->db.arena = NULL;
 	root->db.tag.tag = tag;
 	root->db.tag.len = len;
 	root->db.tag.value = root->buf;
@@ -278,6 +342,7 @@ struct tlvdb *tlvdb_external(tlv_tag_t tag, size_t len, const unsigned char *val
 	root->len = 0;
 
 	root->db.parent = root->db.next = root->db.children = NULL;
+	root->db.arena = NULL;
 	root->db.tag.tag = tag;
 	root->db.tag.len = len;
 	root->db.tag.value = value;
@@ -294,6 +359,13 @@ void tlvdb_free(struct tlvdb *tlvdb)
 
 	for (; tlvdb; tlvdb = next) {
 		next = tlvdb->next;
+		if (tlvdb->arena) {
+			// the top level nodes of a parse are contiguous in the list,
+			// the arena goes when the walk leaves them
+			if (!next || next->arena != tlvdb->arena)
+				free(tlvdb->arena->node);
+			continue;
+		}
 		tlvdb_free(tlvdb->children);
 		free(tlvdb);
 	}
@@ -380,6 +452,17 @@ const struct tlv *tlvdb_get(const struct tlvdb *tlvdb, tlv_tag_t tag, const stru
 
 
 	while (tlvdb) {
+		// entering an indexed parse at its first node: one probe answers
+		// for all of its nodes, on a miss carry on after its last one
+		const struct tlvdb_arena *arena = tlvdb->arena;
+		if (arena && arena->index && tlvdb == arena->node) {
+			const struct tlvdb *hit = arena->index[tlvdb_index_slot(arena, tag)];
+			if (hit)
+				return &hit->tag;
+			tlvdb = arena->last->next;
+			continue;
+		}
+
 		if (tlvdb->tag.tag == tag)
 			return &tlvdb->tag;
 
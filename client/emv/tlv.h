@@ -37,6 +37,15 @@ struct tlvdb *tlvdb_fixed(tlv_tag_t tag, size_t len, const unsigned char *value)
 struct tlvdb *tlvdb_external(tlv_tag_t tag, size_t len, const unsigned char *value);
 struct tlvdb *tlvdb_parse(const unsigned char *buf, size_t len);
 struct tlvdb *tlvdb_parse_multi(const unsigned char *buf, size_t len);
+
+// tlvdb_parse_multi_ex() flags
+#define TLVDB_MULTI	0x01	// parse every top level element, not only the first
+#define TLVDB_NOCOPY	0x02	// values point into buf, which must outlive the db
+#define TLVDB_INDEX	0x04	// tag index, tlvdb_get() from the db's first node is O(1)
+
+// One allocation holds all the nodes of the parse.  The index knows the
+// parsed nodes only, do not tlvdb_add() below a parsed child node.
+struct tlvdb *tlvdb_parse_multi_ex(const unsigned char *buf, size_t len, int flags);
 void tlvdb_free(struct tlvdb *tlvdb);
 
 struct tlvdb *tlvdb_find(struct tlvdb *tlvdb, tlv_tag_t tag);
@@ -8,6 +8,7 @@
 // Graph utilities
 //-----------------------------------------------------------------------------
 #include "graph.h"
+#include "graphlod.h"		// graphlod_touch
 
 int GraphBuffer[MAX_GRAPH_TRACE_LEN];
 int GraphTraceLen;
@@ -23,6 +24,7 @@ void AppendGraph(int redraw, int clock, int bit) {
 	for (i = (int)(clock / 2); i < clock; ++i)
 		GraphBuffer[GraphTraceLen++] = bit ^ 1;
 
+	graphlod_touch();
 	if (redraw)
 		RepaintGraphWindow();
 }
@@ -32,6 +34,7 @@ int ClearGraph(int redraw) {
 	int gtl = GraphTraceLen;
 	memset(GraphBuffer, 0x00, GraphTraceLen);
 	GraphTraceLen = 0;
+	graphlod_touch();
 	if (redraw)
 		RepaintGraphWindow();
 	return gtl;
@@ -52,6 +55,7 @@ void save_restoreGB(uint8_t saveOpt) {
 		memcpy(GraphBuffer, SavedGB, sizeof(GraphBuffer));
 		GraphTraceLen = SavedGBlen;
 		GridOffset = SavedGridOffsetAdj;
+		graphlod_touch();
 		RepaintGraphWindow();
 	}
 	return;
@@ -70,6 +74,7 @@ void setGraphBuf(uint8_t *buf, size_t size) {
 		GraphBuffer[i] = buf[i] - 128;
 
 	GraphTraceLen = size;
+	graphlod_touch();
 	RepaintGraphWindow();
 	return;
 }
@@ -82,6 +87,8 @@ size_t getFromGraphBuf(uint8_t *buf) {
 		if (GraphBuffer[i] < -127) GraphBuffer[i] = -127;
 		buf[i] = (uint8_t)(GraphBuffer[i] + 128);
 	}
+	// the trim may have changed samples
+	graphlod_touch();
 	return i;
 }
 
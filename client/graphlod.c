@@ -0,0 +1,376 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Level of detail min/max pyramid for the plot window
+//-----------------------------------------------------------------------------
+#include "graphlod.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <inttypes.h>
+#include "ui.h"
+#include "util.h"
+#include "util_posix.h"
+
+// bumped from the worker thread,  read by the gui thread on paint
+static volatile uint32_t graphlod_gen = 1;
+
+void graphlod_touch(void) {
+	graphlod_gen++;
+}
+
+void graphlod_init(graphlod_t *lod) {
+	memset(lod, 0, sizeof(*lod));
+}
+
+void graphlod_free(graphlod_t *lod) {
+	for (int k = 0; k < GRAPHLOD_MAX_LEVELS; k++)
+		free(lod->level[k]);
+	free(lod->prefix);
+	graphlod_init(lod);
+}
+
+static inline void span_pair(graphlod_span_t *d, int a, int b) {
+	d->min = (a < b) ? a : b;
+	d->max = (a < b) ? b : a;
+}
+
+static inline void span_merge(graphlod_span_t *d, const graphlod_span_t *a, const graphlod_span_t *b) {
+	d->min = (a->min < b->min) ? a->min : b->min;
+	d->max = (a->max > b->max) ? a->max : b->max;
+}
+
+static bool graphlod_alloc(graphlod_t *lod, int len) {
+	graphlod_free(lod);
+	lod->prefix = calloc(len + 1, sizeof(int64_t));
+	if (!lod->prefix) return false;
+
+	int n = len / 2;
+	for (int k = 0; k < GRAPHLOD_MAX_LEVELS && n > 0; k++, n /= 2) {
+		lod->level[k] = calloc(n, sizeof(graphlod_span_t));
+		if (!lod->level[k]) {
+			graphlod_free(lod);
+			return false;
+		}
+		lod->count[k] = n;
+		lod->levels = k + 1;
+	}
+	return true;
+}
+
+// rebuild level k buckets lo..hi (inclusive) from level k-1
+static void graphlod_rebuild(graphlod_t *lod, int k, int lo, int hi) {
+	graphlod_span_t *src = lod->level[k - 1];
+	graphlod_span_t *dst = lod->level[k];
+	for (int i = lo; i <= hi; i++)
+		span_merge(&dst[i], &src[2 * i], &src[2 * i + 1]);
+}
+
+int graphlod_update(graphlod_t *lod, const int *buf, int len, bool force) {
+
+	bool full = (buf != lod->buf || len != lod->len || !lod->prefix);
+
+	if (!full && !force && lod->gen == graphlod_gen)
+		return 0;
+
+	lod->gen = graphlod_gen;
+
+	if (full) {
+		lod->buf = NULL;
+		lod->len = 0;
+		if (len <= 0 || !buf) {
+			graphlod_free(lod);
+			return 0;
+		}
+		if (!graphlod_alloc(lod, len))
+			return 0;
+		lod->buf = buf;
+		lod->len = len;
+	}
+
+	// level 0 and the prefix sums in one pass,  remember which buckets moved
+	int64_t sum = 0;
+	int lo = INT_MAX, hi = -1;
+	int64_t *prefix = lod->prefix;
+	graphlod_span_t *l0 = lod->level[0];
+	prefix[0] = 0;
+	for (int i = 0; i < lod->count[0]; i++) {
+		int a = buf[2 * i], b = buf[2 * i + 1];
+		graphlod_span_t s;
+		span_pair(&s, a, b);
+		if (full || s.min != l0[i].min || s.max != l0[i].max) {
+			l0[i] = s;
+			if (i < lo) lo = i;
+			hi = i;
+		}
+		sum += a;
+		prefix[2 * i + 1] = sum;
+		sum += b;
+		prefix[2 * i + 2] = sum;
+	}
+	if (len & 1)
+		prefix[len] = sum + buf[len - 1];
+
+	if (hi < 0)
+		return 0;
+
+	int rebuilt = hi - lo + 1;
+	for (int k = 1; k < lod->levels; k++) {
+		lo >>= 1;
+		hi >>= 1;
+		if (hi >= lod->count[k]) hi = lod->count[k] - 1;
+		if (lo > hi) break;
+		graphlod_rebuild(lod, k, lo, hi);
+	}
+	return rebuilt;
+}
+
+static inline void take_sample(int v, int *min, int *max) {
+	if (v < *min) *min = v;
+	if (v > *max) *max = v;
+}
+
+static inline void take_span(const graphlod_span_t *s, int *min, int *max) {
+	if (s->min < *min) *min = s->min;
+	if (s->max > *max) *max = s->max;
+}
+
+bool graphlod_range(const graphlod_t *lod, int from, int to, int *min, int *max) {
+
+	if (from < 0) from = 0;
+	if (to > lod->len) to = lod->len;
+
+	*min = INT_MAX;
+	*max = INT_MIN;
+	if (from >= to) return false;
+
+	const int *buf = lod->buf;
+
+	// unaligned ends from the samples,  then walk up the levels taking the
+	// unaligned buckets on each side until the range closes
+	if (from & 1) take_sample(buf[from++], min, max);
+	if (to & 1 && to > from) take_sample(buf[--to], min, max);
+
+	int i = from >> 1, j = to >> 1;
+	for (int k = 0; k < lod->levels && i < j; k++) {
+		const graphlod_span_t *l = lod->level[k];
+		if (k == lod->levels - 1) {
+			for (; i < j; i++)
+				take_span(&l[i], min, max);
+			break;
+		}
+		if (i & 1) take_span(&l[i++], min, max);
+		if (j & 1 && j > i) take_span(&l[--j], min, max);
+		i >>= 1;
+		j >>= 1;
+	}
+	return true;
+}
+
+int64_t graphlod_sum(const graphlod_t *lod, int from, int to) {
+	if (from < 0) from = 0;
+	if (to > lod->len) to = lod->len;
+	if (from >= to) return 0;
+	return lod->prefix[to] - lod->prefix[from];
+}
+
+int graphlod_columns(const graphlod_t *lod, int start, double pixelsPerPoint, int width, graphlod_span_t *out) {
+
+	if (pixelsPerPoint <= 0 || start < 0 || start >= lod->len)
+		return 0;
+
+	double step = 1.0 / pixelsPerPoint;
+	int c;
+	for (c = 0; c < width; c++) {
+		int s0 = start + (int)(c * step);
+		int s1 = start + (int)((c + 1) * step);
+		if (s0 >= lod->len) break;
+		if (s1 <= s0) s1 = s0 + 1;
+
+		graphlod_range(lod, s0, s1, &out[c].min, &out[c].max);
+		if (c > 0)
+			take_sample(lod->buf[s0 - 1], &out[c].min, &out[c].max);
+	}
+	return c;
+}
+
+//-----------------------------------------------------------------------------
+// Headless benchmark.  Emulates the coordinate work of Plot::paintEvent for a
+// single graph,  points go to an array instead of a QPainterPath.
+//-----------------------------------------------------------------------------
+#define BENCH_HEIGHT 440
+
+static inline int bench_y(int v, int maxVal) {
+	int z = BENCH_HEIGHT / 2;
+	if (maxVal == 0) ++maxVal;
+	return -(z * v) / maxVal + z;
+}
+
+static inline int bench_absmax(int vMin, int vMax) {
+	int m = abs(vMin) > abs(vMax) ? abs(vMin) : abs(vMax);
+	return (int)(m * 1.25 + 1);
+}
+
+// old paint: rescan for max, then one path point per visible sample
+static int bench_frame_naive(const int *buf, int len, int start, double ppp, int width, int *pts, int64_t *chk) {
+	int vMin = INT_MAX, vMax = INT_MIN;
+	int i;
+	for (i = start; i < len && (int)((i - start) * ppp) < width; i++)
+		take_sample(buf[i], &vMin, &vMax);
+	int absVMax = bench_absmax(vMin, vMax);
+
+	int n = 0;
+	int64_t mean = 0;
+	for (i = start; i < len && (int)((i - start) * ppp) < width; i++) {
+		int x = (int)((i - start) * ppp);
+		pts[2 * n] = x;
+		pts[2 * n + 1] = bench_y(buf[i], absVMax);
+		mean += buf[i];
+		n++;
+	}
+	*chk += pts[2 * (n - 1) + 1] + mean / n;
+	return n;
+}
+
+// new paint: pyramid max, one vertical span per pixel column when zoomed out
+static int bench_frame_lod(graphlod_t *lod, const int *buf, int len, int start, double ppp, int width, int *pts, graphlod_span_t *cols, int64_t *chk) {
+	graphlod_update(lod, buf, len, false);
+
+	int end = start + (int)(width / ppp);
+	if (end > len) end = len;
+	int vMin, vMax;
+	graphlod_range(lod, start, end, &vMin, &vMax);
+	int absVMax = bench_absmax(vMin, vMax);
+
+	int n = 0;
+	if (ppp < 1.0) {
+		int ncols = graphlod_columns(lod, start, ppp, width, cols);
+		for (int c = 0; c < ncols; c++) {
+			pts[2 * n] = c;
+			pts[2 * n + 1] = bench_y(cols[c].max, absVMax);
+			n++;
+			pts[2 * n] = c;
+			pts[2 * n + 1] = bench_y(cols[c].min, absVMax);
+			n++;
+		}
+	} else {
+		for (int i = start; i < end; i++) {
+			pts[2 * n] = (int)((i - start) * ppp);
+			pts[2 * n + 1] = bench_y(buf[i], absVMax);
+			n++;
+		}
+	}
+	*chk += n + graphlod_sum(lod, start, end) / (end - start);
+	return n;
+}
+
+int graphlod_bench(const int *buf, int len, int width, int rounds) {
+
+	int *synth = NULL;
+	if (len <= 0 || !buf) {
+		// 125kHz carrier-ish: 8 sample period, slow AM and some noise
+		len = 40000 * 8;
+		synth = calloc(len, sizeof(int));
+		if (!synth) return 1;
+		srand(0x1234);
+		for (int i = 0; i < len; i++)
+			synth[i] = (int)(100 * sin(i * M_PI / 4) * (0.6 + 0.4 * sin(i * M_PI / 2048))) + (rand() % 16) - 8;
+		buf = synth;
+	}
+	if (width < 16) width = 16;
+	if (rounds < 1) rounds = 1;
+
+	int *pts = calloc(2 * (len + 2 * width), sizeof(int));
+	graphlod_span_t *cols = calloc(width, sizeof(graphlod_span_t));
+	if (!pts || !cols) {
+		free(pts);
+		free(cols);
+		free(synth);
+		return 1;
+	}
+
+	graphlod_t lod;
+	graphlod_init(&lod);
+
+	uint64_t t = msclock();
+	for (int r = 0; r < rounds; r++)
+		graphlod_update(&lod, buf, len, true);
+	uint64_t tbuild = msclock() - t;
+
+	// pyramid answers must match a plain scan
+	int bad = 0;
+	for (int r = 0; r < 2000; r++) {
+		int from = rand() % len;
+		int to = from + 1 + rand() % ((r & 1) ? 64 : len - from);
+		if (to > len) to = len;
+		int mn, mx, rmn = INT_MAX, rmx = INT_MIN;
+		int64_t rsum = 0;
+		graphlod_range(&lod, from, to, &mn, &mx);
+		for (int i = from; i < to; i++) {
+			take_sample(buf[i], &rmn, &rmx);
+			rsum += buf[i];
+		}
+		if (mn != rmn || mx != rmx || graphlod_sum(&lod, from, to) != rsum)
+			bad++;
+	}
+
+	PrintAndLogEx(NORMAL, "samples %d, width %d px, %d frames per zoom level", len, width, rounds);
+	PrintAndLogEx(NORMAL, "pyramid rebuild   %6.3f ms,  %d levels", (double)tbuild / rounds, lod.levels);
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "  px/sample | visible | naive pts | lod pts | naive ms/frame | lod ms/frame");
+	PrintAndLogEx(NORMAL, "  ----------+---------+-----------+---------+----------------+-------------");
+
+	static const double zooms[] = { 0.0025, 0.01, 0.05, 0.25, 1, 4, 16 };
+	int64_t chk = 0;
+	for (size_t z = 0; z < sizeof(zooms) / sizeof(zooms[0]); z++) {
+		double ppp = zooms[z];
+		// page through the trace like holding the right arrow key
+		int visible = (int)(width / ppp);
+		if (visible > len) visible = len;
+		int stepping = visible / 8 + 1;
+
+		int npts = 0, lpts = 0;
+		t = msclock();
+		for (int r = 0, start = 0; r < rounds; r++, start = (start + stepping) % (len - visible + 1))
+			npts = bench_frame_naive(buf, len, start, ppp, width, pts, &chk);
+		uint64_t tn = msclock() - t;
+
+		t = msclock();
+		for (int r = 0, start = 0; r < rounds; r++, start = (start + stepping) % (len - visible + 1))
+			lpts = bench_frame_lod(&lod, buf, len, start, ppp, width, pts, cols, &chk);
+		uint64_t tl = msclock() - t;
+
+		PrintAndLogEx(NORMAL, "  %9.4f | %7d | %9d | %7d | %14.3f | %12.3f",
+			ppp, visible, npts, lpts, (double)tn / rounds, (double)tl / rounds);
+	}
+
+	// touching the buffer costs one level 0 scan plus the changed buckets
+	int *copy = calloc(len, sizeof(int));
+	if (copy) {
+		memcpy(copy, buf, len * sizeof(int));
+		graphlod_update(&lod, copy, len, true);
+		t = msclock();
+		int rebuilt = 0;
+		for (int r = 0; r < rounds; r++) {
+			copy[(r * 7919) % len] += 1;
+			graphlod_touch();
+			rebuilt += graphlod_update(&lod, copy, len, false);
+		}
+		uint64_t tu = msclock() - t;
+		PrintAndLogEx(NORMAL, "");
+		PrintAndLogEx(NORMAL, "incremental update %6.3f ms,  %d buckets rebuilt per change", (double)tu / rounds, rebuilt / rounds);
+		free(copy);
+	}
+
+	PrintAndLogEx(NORMAL, "range queries      %s", bad ? _RED_(failed) : _GREEN_(ok));
+	PrintAndLogEx(DEBUG, "checksum %" PRId64, chk);
+	graphlod_free(&lod);
+	free(pts);
+	free(cols);
+	free(synth);
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Level of detail for the plot window.
+// A min/max pyramid over a sample buffer,  level k holds the min/max of
+// buckets of 2^(k+1) samples.  Any sample range is answered in O(log n) so a
+// paint only costs one vertical span per pixel column,  whatever the zoom.
+//-----------------------------------------------------------------------------
+
+#ifndef GRAPHLOD_H__
+#define GRAPHLOD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GRAPHLOD_MAX_LEVELS 24
+
+typedef struct {
+	int min;
+	int max;
+} graphlod_span_t;
+
+typedef struct {
+	const int *buf;
+	int len;
+	uint32_t gen;                       // graphlod_touch() generation the pyramid was built at
+	int levels;
+	int count[GRAPHLOD_MAX_LEVELS];
+	graphlod_span_t *level[GRAPHLOD_MAX_LEVELS];
+	int64_t *prefix;                    // prefix[i] = sum of buf[0..i-1],  for the mean
+} graphlod_t;
+
+// mark every pyramid stale,  call after the sample buffers changed
+void graphlod_touch(void);
+
+void graphlod_init(graphlod_t *lod);
+void graphlod_free(graphlod_t *lod);
+// bring the pyramid up to date with buf,  only changed buckets are rebuilt.
+// Nothing is scanned if buf/len are the same and graphlod_touch() was not
+// called since the last update.  Returns the number of level 0 buckets rebuilt.
+int graphlod_update(graphlod_t *lod, const int *buf, int len, bool force);
+
+// min/max and sum of buf[from..to-1]
+bool graphlod_range(const graphlod_t *lod, int from, int to, int *min, int *max);
+int64_t graphlod_sum(const graphlod_t *lod, int from, int to);
+
+// fill one span per pixel column,  column c covers samples
+// start + c / pixelsPerPoint .. start + (c + 1) / pixelsPerPoint.
+// Spans are widened to the last sample of the previous column so that the
+// columns join up.  Returns the number of columns filled.
+int graphlod_columns(const graphlod_t *lod, int start, double pixelsPerPoint, int width, graphlod_span_t *out);
+
+// headless render benchmark,  per-sample path vs pyramid columns at several
+// zoom levels.  Uses buf if len > 0,  else a synthetic full size trace.
+int graphlod_bench(const int *buf, int len, int width, int rounds);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
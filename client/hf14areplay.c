@@ -0,0 +1,865 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// ISO 14443 type A decoder replay,  see hf14areplay.h
+//-----------------------------------------------------------------------------
+
+#include "hf14areplay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iso14443a_decode.h"
+#include "sniffreplay.h"
+#include "tracecompact.h"		// TRACELOG_HDR
+#include "parity.h"
+#include "util.h"
+#include "util_posix.h"			// msclock
+#include "ui.h"
+
+// as SniffIso14443a
+#define REPLAY_DELAY_TAG		(3 + 14 + 8)
+#define REPLAY_DELAY_READER		(2 + 3 + 8)
+
+// Uart.len is 16 bits,  Uart.parityLen 8 bits.  Buffers of that size take any
+// sample file,  the firmware ones are MAX_FRAME_SIZE.
+static uint8_t replayCmd[0x10000], replayCmdPar[0x100];
+static uint8_t replayResp[0x10000], replayRespPar[0x100];
+
+//-----------------------------------------------------------------------------
+// The reference,  the decoders of armsrc/iso14443a.c before the byte tables,
+// nibble by nibble.  There is no SSC clock here,  the replay always passes the
+// timestamp.
+//-----------------------------------------------------------------------------
+static tUart refUart;
+static tDemod refDemod;
+
+static const bool ref_Mod_Miller_LUT[] = {
+	false,  true, false, true,  false, false, false, true,
+	false,  true, false, false, false, false, false, false
+};
+#define ref_IsMillerModulationNibble1(b) (ref_Mod_Miller_LUT[(b & 0x000000F0) >> 4])
+#define ref_IsMillerModulationNibble2(b) (ref_Mod_Miller_LUT[(b & 0x0000000F)])
+
+static void ref_UartReset(void) {
+	refUart.state = STATE_UNSYNCD;
+	refUart.bitCount = 0;
+	refUart.len = 0;
+	refUart.parityLen = 0;
+	refUart.shiftReg = 0;
+	refUart.parityBits = 0;
+	refUart.startTime = 0;
+	refUart.endTime = 0;
+	refUart.fourBits = 0x00000000;
+	refUart.posCnt = 0;
+	refUart.syncBit = 9999;
+}
+
+static void ref_UartInit(uint8_t *data, uint8_t *parity) {
+	refUart.output = data;
+	refUart.parity = parity;
+	ref_UartReset();
+}
+
+static bool ref_MillerDecoding(uint8_t bit, uint32_t non_real_time) {
+	refUart.fourBits = (refUart.fourBits << 8) | bit;
+
+	if (refUart.state == STATE_UNSYNCD) {
+		refUart.syncBit = 9999;
+		#define REF_STARTBIT_MASK		0x07FFEF80
+		#define REF_STARTBIT_PATTERN	0x07FF8F80
+		if		((refUart.fourBits & (REF_STARTBIT_MASK >> 0)) == REF_STARTBIT_PATTERN >> 0) refUart.syncBit = 7;
+		else if ((refUart.fourBits & (REF_STARTBIT_MASK >> 1)) == REF_STARTBIT_PATTERN >> 1) refUart.syncBit = 6;
+		else if ((refUart.fourBits & (REF_STARTBIT_MASK >> 2)) == REF_STARTBIT_PATTERN >> 2) refUart.syncBit = 5;
+		else if ((refUart.fourBits & (REF_STARTBIT_MASK >> 3)) == REF_STARTBIT_PATTERN >> 3) refUart.syncBit = 4;
+		else if ((refUart.fourBits & (REF_STARTBIT_MASK >> 4)) == REF_STARTBIT_PATTERN >> 4) refUart.syncBit = 3;
+		else if ((refUart.fourBits & (REF_STARTBIT_MASK >> 5)) == REF_STARTBIT_PATTERN >> 5) refUart.syncBit = 2;
+		else if ((refUart.fourBits & (REF_STARTBIT_MASK >> 6)) == REF_STARTBIT_PATTERN >> 6) refUart.syncBit = 1;
+		else if ((refUart.fourBits & (REF_STARTBIT_MASK >> 7)) == REF_STARTBIT_PATTERN >> 7) refUart.syncBit = 0;
+
+		if (refUart.syncBit != 9999) {
+			refUart.startTime = non_real_time;
+			refUart.startTime -= refUart.syncBit;
+			refUart.endTime = refUart.startTime;
+			refUart.state = STATE_START_OF_COMMUNICATION;
+		}
+	} else {
+
+		if (ref_IsMillerModulationNibble1(refUart.fourBits >> refUart.syncBit)) {
+			if (ref_IsMillerModulationNibble2(refUart.fourBits >> refUart.syncBit)) {	// both halves - error
+				ref_UartReset();
+			} else {																// first half,  Sequence Z,  "0"
+				if (refUart.state == STATE_MILLER_X) {								// must not follow after X
+					ref_UartReset();
+				} else {
+					refUart.bitCount++;
+					refUart.shiftReg = (refUart.shiftReg >> 1);
+					refUart.state = STATE_MILLER_Z;
+					refUart.endTime = refUart.startTime + 8 * (9 * refUart.len + refUart.bitCount + 1) - 6;
+					if (refUart.bitCount >= 9) {
+						refUart.output[refUart.len++] = (refUart.shiftReg & 0xff);
+						refUart.parityBits <<= 1;
+						refUart.parityBits |= ((refUart.shiftReg >> 8) & 0x01);
+						refUart.bitCount = 0;
+						refUart.shiftReg = 0;
+						if ((refUart.len & 0x0007) == 0) {
+							refUart.parity[refUart.parityLen++] = refUart.parityBits;
+							refUart.parityBits = 0;
+						}
+					}
+				}
+			}
+		} else {
+			if (ref_IsMillerModulationNibble2(refUart.fourBits >> refUart.syncBit)) {	// second half,  Sequence X,  "1"
+				refUart.bitCount++;
+				refUart.shiftReg = (refUart.shiftReg >> 1) | 0x100;
+				refUart.state = STATE_MILLER_X;
+				refUart.endTime = refUart.startTime + 8 * (9 * refUart.len + refUart.bitCount + 1) - 2;
+				if (refUart.bitCount >= 9) {
+					refUart.output[refUart.len++] = (refUart.shiftReg & 0xff);
+					refUart.parityBits <<= 1;
+					refUart.parityBits |= ((refUart.shiftReg >> 8) & 0x01);
+					refUart.bitCount = 0;
+					refUart.shiftReg = 0;
+					if ((refUart.len & 0x0007) == 0) {
+						refUart.parity[refUart.parityLen++] = refUart.parityBits;
+						refUart.parityBits = 0;
+					}
+				}
+			} else {																// none,  Sequence Y
+				if (refUart.state == STATE_MILLER_Z || refUart.state == STATE_MILLER_Y) {	// Y after "0",  EOC
+					refUart.state = STATE_UNSYNCD;
+					refUart.bitCount--;
+					refUart.shiftReg <<= 1;
+					if (refUart.bitCount > 0) {
+						refUart.shiftReg >>= (9 - refUart.bitCount);
+						refUart.output[refUart.len++] = (refUart.shiftReg & 0xff);
+						refUart.parityBits <<= 1;
+						refUart.parityBits <<= (8 - (refUart.len&0x0007));
+						refUart.parity[refUart.parityLen++] = refUart.parityBits;
+						return true;
+					} else if (refUart.len & 0x0007) {
+						refUart.parityBits <<= (8 - (refUart.len&0x0007));
+						refUart.parity[refUart.parityLen++] = refUart.parityBits;
+					}
+					if (refUart.len) {
+						return true;
+					} else {
+						ref_UartReset();
+					}
+				}
+				if (refUart.state == STATE_START_OF_COMMUNICATION) {				// must not follow directly after SOC
+					ref_UartReset();
+				} else {															// "0"
+					refUart.bitCount++;
+					refUart.shiftReg = (refUart.shiftReg >> 1);
+					refUart.state = STATE_MILLER_Y;
+					if (refUart.bitCount >= 9) {
+						refUart.output[refUart.len++] = (refUart.shiftReg & 0xff);
+						refUart.parityBits <<= 1;
+						refUart.parityBits |= ((refUart.shiftReg >> 8) & 0x01);
+						refUart.bitCount = 0;
+						refUart.shiftReg = 0;
+						if ((refUart.len & 0x0007) == 0) {
+							refUart.parity[refUart.parityLen++] = refUart.parityBits;
+							refUart.parityBits = 0;
+						}
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+static const bool ref_Mod_Manchester_LUT[] = {
+	false, false, false, false, false, false, false, true,
+	false, false, false, true,  false, true,  true,  true
+};
+#define ref_IsManchesterModulationNibble1(b) (ref_Mod_Manchester_LUT[(b & 0x00F0) >> 4])
+#define ref_IsManchesterModulationNibble2(b) (ref_Mod_Manchester_LUT[(b & 0x000F)])
+
+static void ref_DemodReset(void) {
+	refDemod.state = DEMOD_UNSYNCD;
+	refDemod.len = 0;
+	refDemod.parityLen = 0;
+	refDemod.shiftReg = 0;
+	refDemod.parityBits = 0;
+	refDemod.collisionPos = 0;
+	refDemod.twoBits = 0xFFFF;
+	refDemod.highCnt = 0;
+	refDemod.startTime = 0;
+	refDemod.endTime = 0;
+	refDemod.bitCount = 0;
+	refDemod.syncBit = 0xFFFF;
+	refDemod.samples = 0;
+}
+
+static void ref_DemodInit(uint8_t *data, uint8_t *parity) {
+	refDemod.output = data;
+	refDemod.parity = parity;
+	ref_DemodReset();
+}
+
+static int ref_ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_time) {
+	refDemod.twoBits = (refDemod.twoBits << 8) | bit;
+
+	if (refDemod.state == DEMOD_UNSYNCD) {
+
+		if (refDemod.highCnt < 2) {											// wait for a stable unmodulated signal
+			if (refDemod.twoBits == 0x0000) {
+				refDemod.highCnt++;
+			} else {
+				refDemod.highCnt = 0;
+			}
+		} else {
+			refDemod.syncBit = 0xFFFF;
+			if 		((refDemod.twoBits & 0x7700) == 0x7000) refDemod.syncBit = 7;
+			else if ((refDemod.twoBits & 0x3B80) == 0x3800) refDemod.syncBit = 6;
+			else if ((refDemod.twoBits & 0x1DC0) == 0x1C00) refDemod.syncBit = 5;
+			else if ((refDemod.twoBits & 0x0EE0) == 0x0E00) refDemod.syncBit = 4;
+			else if ((refDemod.twoBits & 0x0770) == 0x0700) refDemod.syncBit = 3;
+			else if ((refDemod.twoBits & 0x03B8) == 0x0380) refDemod.syncBit = 2;
+			else if ((refDemod.twoBits & 0x01DC) == 0x01C0) refDemod.syncBit = 1;
+			else if ((refDemod.twoBits & 0x00EE) == 0x00E0) refDemod.syncBit = 0;
+			if (refDemod.syncBit != 0xFFFF) {
+				refDemod.startTime = non_real_time;
+				refDemod.startTime -= refDemod.syncBit;
+				refDemod.bitCount = offset;
+				refDemod.state = DEMOD_MANCHESTER_DATA;
+			}
+		}
+	} else {
+
+		if (ref_IsManchesterModulationNibble1(refDemod.twoBits >> refDemod.syncBit)) {		// first half
+			if (ref_IsManchesterModulationNibble2(refDemod.twoBits >> refDemod.syncBit)) {	// and second,  collision
+				if (!refDemod.collisionPos) {
+					refDemod.collisionPos = (refDemod.len << 3) + refDemod.bitCount;
+				}
+			}																	// Sequence D,  1
+			refDemod.bitCount++;
+			refDemod.shiftReg = (refDemod.shiftReg >> 1) | 0x100;
+			if (refDemod.bitCount == 9) {
+				refDemod.output[refDemod.len++] = (refDemod.shiftReg & 0xff);
+				refDemod.parityBits <<= 1;
+				refDemod.parityBits |= ((refDemod.shiftReg >> 8) & 0x01);
+				refDemod.bitCount = 0;
+				refDemod.shiftReg = 0;
+				if ((refDemod.len & 0x0007) == 0) {
+					refDemod.parity[refDemod.parityLen++] = refDemod.parityBits;
+					refDemod.parityBits = 0;
+				}
+			}
+			refDemod.endTime = refDemod.startTime + 8 * (9 * refDemod.len + refDemod.bitCount + 1) - 4;
+		} else {
+			if (ref_IsManchesterModulationNibble2(refDemod.twoBits >> refDemod.syncBit)) {	// second half,  Sequence E,  0
+				refDemod.bitCount++;
+				refDemod.shiftReg = (refDemod.shiftReg >> 1);
+				if (refDemod.bitCount >= 9) {
+					refDemod.output[refDemod.len++] = (refDemod.shiftReg & 0xff);
+					refDemod.parityBits <<= 1;
+					refDemod.parityBits |= ((refDemod.shiftReg >> 8) & 0x01);
+					refDemod.bitCount = 0;
+					refDemod.shiftReg = 0;
+					if ((refDemod.len & 0x0007) == 0) {
+						refDemod.parity[refDemod.parityLen++] = refDemod.parityBits;
+						refDemod.parityBits = 0;
+					}
+				}
+				refDemod.endTime = refDemod.startTime + 8 * (9 * refDemod.len + refDemod.bitCount + 1);
+			} else {															// none,  EOC
+				if (refDemod.bitCount > 0) {
+					refDemod.shiftReg >>= (9 - refDemod.bitCount);
+					refDemod.output[refDemod.len++] = refDemod.shiftReg & 0xff;
+					refDemod.parityBits <<= 1;
+					refDemod.parityBits <<= (8 - (refDemod.len&0x0007));
+					refDemod.parity[refDemod.parityLen++] = refDemod.parityBits;
+					return true;
+				} else if (refDemod.len & 0x0007) {
+					refDemod.parityBits <<= (8 - (refDemod.len&0x0007));
+					refDemod.parity[refDemod.parityLen++] = refDemod.parityBits;
+				}
+				if (refDemod.len) {
+					return true;
+				} else {
+					ref_DemodReset();
+				}
+			}
+		}
+	}
+	return false;
+}
+
+// the decoders or the reference
+static void replayInit(bool reference) {
+	if (reference) {
+		ref_DemodInit(replayResp, replayRespPar);
+		ref_UartInit(replayCmd, replayCmdPar);
+	} else {
+		DemodInit(replayResp, replayRespPar);
+		UartInit(replayCmd, replayCmdPar);
+	}
+}
+
+static void replayReset(bool reference) {
+	if (reference) {
+		ref_UartReset();
+		ref_DemodReset();
+	} else {
+		UartReset();
+		DemodReset();
+	}
+}
+
+int hf14a_replay(const uint8_t *samples, size_t len, bool reference, hf14a_replay_t *r) {
+	memset(r, 0, sizeof(*r));
+
+	replayInit(reference);
+	tUart *uart = reference ? &refUart : GetUart();
+	tDemod *demod = reference ? &refDemod : GetDemod();
+
+	uint8_t previous_data = 0;
+	bool TagIsActive = false;
+	bool ReaderIsActive = false;
+
+	// the loop of SniffIso14443a,  without trigger
+	for (uint32_t rsamples = 0; rsamples < len; rsamples++) {
+		uint8_t data = samples[rsamples];
+
+		// Need two samples to feed Miller and Manchester-Decoder
+		if (rsamples & 0x01) {
+
+			if (!TagIsActive) {
+				uint8_t readerdata = (previous_data & 0xF0) | (data >> 4);
+				bool done = reference ? ref_MillerDecoding(readerdata, (rsamples-1)*4) : MillerDecoding(readerdata, (rsamples-1)*4);
+				if (done) {
+					r->reader++;
+					r->bits += uart->len * 9;
+					if (!sniffreplay_log(&r->trace, &r->traceLen, &r->traceSize, replayCmd, uart->len, uart->startTime*16 - REPLAY_DELAY_READER, uart->endTime*16 - REPLAY_DELAY_READER, uart->parity, true))
+						return 1;
+					replayReset(reference);
+				}
+				ReaderIsActive = (uart->state != STATE_UNSYNCD);
+			}
+
+			if (!ReaderIsActive) {
+				uint8_t tagdata = (previous_data << 4) | (data & 0x0F);
+				int done = reference ? ref_ManchesterDecoding(tagdata, 0, (rsamples-1)*4) : ManchesterDecoding(tagdata, 0, (rsamples-1)*4);
+				if (done) {
+					r->tag++;
+					r->bits += demod->len * 9;
+					if (demod->collisionPos)
+						r->collisions++;
+					if (!sniffreplay_log(&r->trace, &r->traceLen, &r->traceSize, replayResp, demod->len, demod->startTime*16 - REPLAY_DELAY_TAG, demod->endTime*16 - REPLAY_DELAY_TAG, demod->parity, false))
+						return 1;
+					replayReset(reference);
+				}
+				TagIsActive = (demod->state != DEMOD_UNSYNCD);
+			}
+		}
+		previous_data = data;
+	}
+	return 0;
+}
+
+void hf14a_replay_free(hf14a_replay_t *r) {
+	free(r->trace);
+	memset(r, 0, sizeof(*r));
+}
+
+//-----------------------------------------------------------------------------
+// Synthetic sniff sessions.  Each frame is encoded tick by tick the way the
+// FPGA sees it,  pauses of 2 or 3 ticks,  with noise a 2 tick pause moves by a
+// tick and the tag subcarrier loses a tick of a half bit.  The decoders take both.
+//-----------------------------------------------------------------------------
+typedef struct {
+	bool tag;
+	uint16_t bits;				// data bits,  full bytes get a parity bit each
+	const char *data;
+	const char *par;			// parity bytes,  NULL odd parity
+	const char *collide;		// a second tag answering,  NULL none
+} replayFrame_t;
+
+// MIFARE Classic 1k,  select,  authentication,  read,  write and halt.  The
+// encrypted frames carry their own parity.
+static const replayFrame_t replayMifare[] = {
+	{false, 7,   "26", NULL, NULL},
+	{true,  16,  "04 00", NULL, NULL},
+	{false, 16,  "93 20", NULL, NULL},
+	{true,  40,  "1A 2B 3C 4D 40", NULL, NULL},
+	{false, 72,  "93 70 1A 2B 3C 4D 40 25 F9", NULL, NULL},
+	{true,  24,  "08 B6 DD", NULL, NULL},
+	{false, 32,  "60 04 D1 3D", NULL, NULL},
+	{true,  32,  "01 20 01 45", NULL, NULL},
+	{false, 64,  "A1 B2 C3 D4 E5 F6 07 18", "5A", NULL},
+	{true,  32,  "E2 5C 80 0A", "A0", NULL},
+	{false, 32,  "9F 52 6D 4E", "30", NULL},
+	{true,  144, "32 96 C0 7F 11 4B AA 30 5E 61 0F D3 77 A2 C9 08 E4 1D", "6B C5 40", NULL},
+	{false, 32,  "A0 04 7B F7", NULL, NULL},
+	{true,  4,   "0A", NULL, NULL},
+	{false, 144, "00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F 77 F5", NULL, NULL},
+	{true,  4,   "0A", NULL, NULL},
+	{false, 32,  "30 04 26 EE", NULL, NULL},
+	{true,  144, "00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F 77 F5", NULL, NULL},
+	{false, 32,  "E0 80 31 73", NULL, NULL},
+	{true,  64,  "06 75 77 81 02 80 02 F0", NULL, NULL},
+	{false, 32,  "50 00 57 CD", NULL, NULL},
+};
+
+// two tags in the field,  the UIDs collide
+static const replayFrame_t replayCollision[] = {
+	{false, 7,   "52", NULL, NULL},
+	{true,  16,  "04 00", NULL, NULL},
+	{false, 16,  "93 20", NULL, NULL},
+	{true,  40,  "1A 2B 3C 4D 40", NULL, "1A 2B 7C 4D 00"},
+	{false, 16,  "93 20", NULL, NULL},
+	{true,  40,  "1A 2B 3C 4D 40", NULL, NULL},
+};
+
+typedef struct {
+	const replayFrame_t *frames;
+	uint32_t n;
+} replaySession_t;
+
+static const replaySession_t replaySessions[] = {
+	{replayMifare, sizeof(replayMifare) / sizeof(replayMifare[0])},
+	{replayCollision, sizeof(replayCollision) / sizeof(replayCollision[0])},
+};
+#define REPLAY_SESSIONS		(sizeof(replaySessions) / sizeof(replaySessions[0]))
+
+// the files in traces/iso14443a
+static const sniffreplay_file_t replayFiles[] = {
+	{"mifare_classic", 0, 2, 3, 0},
+	{"mifare_classic_noise", 0, 3, 5, 0x1D2C3B4A},
+	{"collision", 1, 2, 0, 0x5EED},
+};
+#define REPLAY_FILES		(sizeof(replayFiles) / sizeof(replayFiles[0]))
+
+// ticks between frames,  about 90 us as FDT and reader guard time
+#define REPLAY_GAP			80
+#define REPLAY_LEAD			64
+
+// odd parity bits,  MSB first,  as GetParity() of the firmware
+static void replayParity(const uint8_t *data, int len, uint8_t *par) {
+	for (int i = 0; i < len; i++)
+		par[i / 8] |= oddparity8(data[i]) << (7 - (i & 7));
+}
+
+// one bit period of the reader,  the pause at tick pos of 8
+static void replayPause(sniffreplay_ticks_t *t, int pos, bool noise) {
+	uint8_t *p = t->reader + t->len;
+	if (noise && t->seed && t->pause == 2 && (sniffreplay_rand(t) & 3) == 0)
+		pos += (pos == 0) ? 1 : -1;							// 10011111,  11100111
+	for (int i = 0; i < t->pause; i++)
+		p[pos + i] = 0;
+}
+
+// one bit period of the tag,  the modulated half at pos 0 or 4
+static void replayHalf(sniffreplay_ticks_t *t, int pos, bool noise) {
+	uint8_t *p = t->tag + t->len;
+	memset(p + pos, 1, 4);
+	if (noise && t->seed && (sniffreplay_rand(t) & 3) == 0)
+		p[pos + (sniffreplay_rand(t) & 3)] = 0;
+}
+
+// the frame bits,  data LSB first and the parity after each full byte
+static uint16_t replayBits(const replayFrame_t *f, const char *hex, uint8_t *bits) {
+	uint8_t data[32] = {0}, par[4] = {0};
+	int len = 0, plen = 0;
+	param_gethex_to_eol(hex, 0, data, sizeof(data), &len);
+	if (f->par)
+		param_gethex_to_eol(f->par, 0, par, sizeof(par), &plen);
+	else
+		replayParity(data, len, par);
+
+	uint16_t n = 0;
+	for (uint16_t i = 0; i < f->bits; i++) {
+		bits[n++] = (data[i / 8] >> (i & 7)) & 1;
+		if ((i & 7) == 7 && f->bits >= 8)
+			bits[n++] = (par[i / 64] >> (7 - (i / 8 & 7))) & 1;
+	}
+	return n;
+}
+
+static bool replayFrame(sniffreplay_ticks_t *t, const replayFrame_t *f) {
+	uint8_t bits[300], bits2[300];
+	uint16_t n = replayBits(f, f->data, bits);
+	if (f->collide)
+		replayBits(f, f->collide, bits2);
+
+	// SOC,  the bits,  EOC and an idle bit
+	if (!sniffreplay_grow(t, (n + 4) * 8))
+		return false;
+
+	if (f->tag) {
+		replayHalf(t, 0, false);							// Sequence D,  SOC
+		t->len += 8;
+		for (uint16_t i = 0; i < n; i++) {
+			bool one = bits[i], zero = !bits[i];
+			if (f->collide) {
+				one |= bits2[i];
+				zero |= !bits2[i];
+			}
+			if (one) replayHalf(t, 0, true);				// Sequence D
+			if (zero) replayHalf(t, 4, true);				// Sequence E
+			t->len += 8;
+		}
+		t->len += 16;										// Sequence F,  EOC
+		return true;
+	}
+
+	replayPause(t, 0, false);								// Sequence Z,  SOC
+	t->len += 8;
+	bool last = false;
+	for (uint16_t i = 0; i <= n; i++) {
+		bool bit = (i < n) ? bits[i] : false;				// a logic "0" and Y for EOC
+		if (bit)
+			replayPause(t, 4, true);						// Sequence X
+		else if (!last)
+			replayPause(t, 0, true);						// Sequence Z,  Y after a "1"
+		last = bit;
+		t->len += 8;
+	}
+	t->len += 16;											// Sequence Y
+	return true;
+}
+
+size_t hf14a_replay_session(uint8_t **samples, int session, uint8_t pause, uint8_t phase, uint32_t seed) {
+	*samples = NULL;
+	if (session < 0 || session >= (int)REPLAY_SESSIONS)
+		return 0;
+
+	sniffreplay_ticks_t t = {0};
+	t.pause = pause;
+	t.seed = seed;
+	const replaySession_t *s = &replaySessions[session];
+	bool ok = sniffreplay_grow(&t, REPLAY_LEAD + phase);
+	t.len += REPLAY_LEAD + phase;
+	for (uint32_t i = 0; ok && i < s->n; i++) {
+		ok = replayFrame(&t, &s->frames[i]) && sniffreplay_grow(&t, REPLAY_GAP);
+		t.len += REPLAY_GAP;
+	}
+
+	return sniffreplay_samples(&t, ok, samples);
+}
+
+//-----------------------------------------------------------------------------
+// tests
+//-----------------------------------------------------------------------------
+
+// the frames of a session as the decoders give them
+static bool replayExpect(const replaySession_t *s, const uint8_t *trace, uint32_t traceLen, bool verbose) {
+	uint32_t pos = 0;
+	for (uint32_t i = 0; i < s->n; i++) {
+		const replayFrame_t *f = &s->frames[i];
+		uint8_t data[32] = {0}, data2[32] = {0}, par[4] = {0}, par2[4] = {0};
+		int len = 0, plen = 0;
+		param_gethex_to_eol(f->data, 0, data, sizeof(data), &len);
+		if (f->par)
+			param_gethex_to_eol(f->par, 0, par, sizeof(par), &plen);
+		else if (f->bits >= 8)
+			replayParity(data, len, par);
+		// a collision bit is decoded as a "1"
+		if (f->collide) {
+			param_gethex_to_eol(f->collide, 0, data2, sizeof(data2), &len);
+			replayParity(data2, len, par2);
+			for (int j = 0; j < len; j++)
+				data[j] |= data2[j];
+			for (int j = 0; j < 4; j++)
+				par[j] |= par2[j];
+		}
+		uint16_t bytes = (f->bits + 7) / 8;
+
+		if (pos + TRACELOG_HDR > traceLen) {
+			if (verbose) PrintAndLogEx(WARNING, "frame %u missing", i);
+			return false;
+		}
+		const uint8_t *rec = trace + pos;
+		uint16_t rlen = (rec[6] | (rec[7] << 8)) & 0x7FFF;
+		bool rtag = rec[7] & 0x80;
+		if (rtag != f->tag || rlen != bytes || memcmp(rec + TRACELOG_HDR, data, bytes) ||
+			memcmp(rec + TRACELOG_HDR + bytes, par, tracelog_paritybytes(bytes))) {
+			if (verbose) PrintAndLogEx(WARNING, "frame %u: got %s %s", i, rtag ? "Tag" : "Rdr", sprint_hex(rec + TRACELOG_HDR, rlen));
+			return false;
+		}
+		pos += TRACELOG_HDR + rlen + tracelog_paritybytes(rlen);
+	}
+	if (pos != traceLen) {
+		if (verbose) PrintAndLogEx(WARNING, "%u bytes of frames too many", traceLen - pos);
+		return false;
+	}
+	return true;
+}
+
+// the start of frame i
+static uint32_t replayStart(const hf14a_replay_t *r, uint32_t i) {
+	uint32_t pos = 0;
+	while (i--) {
+		uint16_t len = (r->trace[pos + 6] | (r->trace[pos + 7] << 8)) & 0x7FFF;
+		pos += TRACELOG_HDR + len + tracelog_paritybytes(len);
+	}
+	uint32_t ts;
+	memcpy(&ts, r->trace + pos, 4);
+	return ts;
+}
+
+// the decoders and the reference on the same samples
+static bool replaySame(const uint8_t *samples, size_t len, hf14a_replay_t *r) {
+	hf14a_replay_t ref = {0};
+	bool ok = hf14a_replay(samples, len, false, r) == 0 && hf14a_replay(samples, len, true, &ref) == 0;
+	ok = ok && r->traceLen == ref.traceLen && memcmp(r->trace, ref.trace, r->traceLen) == 0;
+	hf14a_replay_free(&ref);
+	return ok;
+}
+
+// all sessions,  both pause widths,  every phase of a bit period,  clean and noisy,
+// as the reference.  A shift of the session moves every frame by as many ticks.
+static bool replaySynthetic(bool verbose) {
+	uint32_t runs = 0, failed = 0, differs = 0;
+	for (int s = 0; s < (int)REPLAY_SESSIONS; s++) {
+		hf14a_replay_t ref = {0};
+		for (uint8_t pause = 2; pause <= 3; pause++) {
+			for (uint8_t phase = 0; phase < 8; phase++) {
+				for (uint32_t seed = 0; seed < 4; seed++) {
+					uint8_t *samples;
+					hf14a_replay_t r = {0};
+					size_t len = hf14a_replay_session(&samples, s, pause, phase, seed * 0x9E3779B9);
+					bool same = len && replaySame(samples, len, &r);
+					free(samples);
+					differs += !same;
+					if (!same && verbose) PrintAndLogEx(WARNING, "session %d pause %u phase %u seed %u differs from the reference", s, pause, phase, seed);
+					bool ok = same && replayExpect(&replaySessions[s], r.trace, r.traceLen, verbose);
+					ok = ok && (s != 1 || r.collisions == 1);
+					if (ok && ref.trace == NULL) {
+						ref = r;
+						r.trace = NULL;
+					} else if (ok) {
+						for (uint32_t i = 0; ok && i < replaySessions[s].n; i++)
+							ok = (replayStart(&r, i) - replayStart(&ref, i) == phase * 16u);
+						if (!ok && verbose) PrintAndLogEx(WARNING, "timing off");
+					}
+					if (!ok) {
+						failed++;
+						if (verbose) PrintAndLogEx(WARNING, "session %d pause %u phase %u seed %u failed", s, pause, phase, seed);
+					}
+					runs++;
+					hf14a_replay_free(&r);
+				}
+			}
+		}
+		hf14a_replay_free(&ref);
+	}
+	PrintAndLogEx(failed ? FAILED : SUCCESS, "synthetic sessions: %u of %u as the reference,  %u of %u decoded", runs - differs, runs, runs - failed, runs);
+	return failed == 0;
+}
+
+// both decoders the same state
+static bool replayUartSame(const tUart *uart) {
+	return uart->state == refUart.state && uart->shiftReg == refUart.shiftReg && uart->bitCount == refUart.bitCount &&
+		uart->len == refUart.len && uart->posCnt == refUart.posCnt && uart->syncBit == refUart.syncBit &&
+		uart->parityBits == refUart.parityBits && uart->parityLen == refUart.parityLen && uart->fourBits == refUart.fourBits &&
+		uart->startTime == refUart.startTime && uart->endTime == refUart.endTime;
+}
+
+static bool replayDemodSame(const tDemod *demod) {
+	return demod->state == refDemod.state && demod->twoBits == refDemod.twoBits && demod->highCnt == refDemod.highCnt &&
+		demod->bitCount == refDemod.bitCount && demod->collisionPos == refDemod.collisionPos && demod->syncBit == refDemod.syncBit &&
+		demod->parityBits == refDemod.parityBits && demod->parityLen == refDemod.parityLen && demod->shiftReg == refDemod.shiftReg &&
+		demod->samples == refDemod.samples && demod->len == refDemod.len &&
+		demod->startTime == refDemod.startTime && demod->endTime == refDemod.endTime;
+}
+
+// call by call,  the state after each call and every frame.  The sessions clean
+// and with flipped bits,  then random samples from idle to anything.
+static bool replayRandom(bool verbose) {
+	static uint8_t cmd[0x1000], cmdPar[0x200], resp[0x1000], respPar[0x200];
+	static uint8_t refcmd[0x1000], refcmdPar[0x200], refresp[0x1000], refrespPar[0x200];
+	uint32_t seed = 0xC0FFEE, calls = 0, frames = 0, failed = 0;
+	tUart *uart = GetUart();
+	tDemod *demod = GetDemod();
+	for (int run = 0; run < (int)REPLAY_SESSIONS * 4 + 8 && !failed; run++) {
+		uint8_t *samples = NULL;
+		size_t len = 0;
+		if (run < (int)REPLAY_SESSIONS * 4) {
+			len = hf14a_replay_session(&samples, run / 4, 2 + (run & 1), run & 7, 0);
+			// half of them with a bit flipped in about one byte of 64
+			for (size_t i = 0; (run & 2) && i < len; i++) {
+				seed = seed * 1103515245 + 12345;
+				if (((seed >> 8) & 0x3F) == 0)
+					samples[i] ^= 1 << ((seed >> 16) & 7);
+			}
+		} else {
+			// idle field and no modulation,  more and more random bytes in it
+			int density = run - REPLAY_SESSIONS * 4;
+			len = 100000;
+			samples = malloc(len);
+			for (size_t i = 0; samples && i < len; i++) {
+				seed = seed * 1103515245 + 12345;
+				uint32_t rnd = seed >> 8;
+				samples[i] = ((rnd & 7) < (uint32_t)density) ? rnd >> 8 : 0xF0;
+			}
+		}
+		if (samples == NULL || len == 0) {
+			free(samples);
+			failed++;
+			break;
+		}
+
+		UartInit(cmd, cmdPar);
+		DemodInit(resp, respPar);
+		ref_UartInit(refcmd, refcmdPar);
+		ref_DemodInit(refresp, refrespPar);
+		for (size_t i = 1; i < len; i += 2) {
+			uint8_t readerdata = (samples[i - 1] & 0xF0) | (samples[i] >> 4);
+			uint8_t tagdata = (samples[i - 1] << 4) | (samples[i] & 0x0F);
+
+			bool got = MillerDecoding(readerdata, i * 4);
+			bool want = ref_MillerDecoding(readerdata, i * 4);
+			bool ok = got == want && replayUartSame(uart) && memcmp(cmd, refcmd, uart->len) == 0 &&
+				memcmp(cmdPar, refcmdPar, uart->parityLen) == 0;
+			if (got || uart->len > 0xF00) {
+				frames += got;
+				UartReset();
+				ref_UartReset();
+			}
+
+			int gotd = ManchesterDecoding(tagdata, 0, i * 4);
+			int wantd = ref_ManchesterDecoding(tagdata, 0, i * 4);
+			ok = ok && gotd == wantd && replayDemodSame(demod) && memcmp(resp, refresp, demod->len) == 0 &&
+				memcmp(respPar, refrespPar, demod->parityLen) == 0;
+			if (gotd || demod->len > 0xF00) {
+				frames += (gotd != 0);
+				DemodReset();
+				ref_DemodReset();
+			}
+			calls += 2;
+			if (!ok) {
+				failed++;
+				if (verbose) PrintAndLogEx(WARNING, "run %d sample %u differs from the reference", run, (uint32_t)i);
+				break;
+			}
+		}
+		free(samples);
+	}
+	PrintAndLogEx(failed ? FAILED : SUCCESS, "random samples: %u calls,  %u frames,  %s", calls, frames, failed ? "differs from the reference" : "as the reference");
+	return failed == 0;
+}
+
+static int replayDecode(const uint8_t *samples, size_t len, uint8_t **trace, uint32_t *traceLen) {
+	hf14a_replay_t r;
+	if (hf14a_replay(samples, len, false, &r))
+		return 1;
+	*trace = r.trace;
+	*traceLen = r.traceLen;
+	return 0;
+}
+
+// the sample files decode to the frames of their session,  as the reference
+static bool replayCheck(const uint8_t *samples, size_t len, const uint8_t *trace, uint32_t traceLen, const sniffreplay_file_t *f, bool verbose) {
+	hf14a_replay_t ref;
+	bool ok = hf14a_replay(samples, len, true, &ref) == 0 && ref.traceLen == traceLen && memcmp(ref.trace, trace, traceLen) == 0;
+	hf14a_replay_free(&ref);
+	if (!ok && verbose) PrintAndLogEx(WARNING, "%s differs from the reference", f->name);
+	return ok && replayExpect(&replaySessions[f->session], trace, traceLen, verbose);
+}
+
+static const sniffreplay_files_t replayFileSet = {
+	replayFiles, REPLAY_FILES, hf14a_replay_session, replayDecode, replayCheck
+};
+
+int hf14a_replay_write(const char *dir) {
+	return sniffreplay_write_files(&replayFileSet, dir);
+}
+
+int hf14a_replay_test(const char *dir, bool verbose) {
+	bool ok = replaySynthetic(verbose);
+	ok = replayRandom(verbose) && ok;
+	if (dir)
+		ok = sniffreplay_check_files(&replayFileSet, dir, verbose) && ok;
+	return ok ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// bench
+//-----------------------------------------------------------------------------
+void hf14a_replay_bench(const uint8_t *samples, size_t len, uint32_t rounds) {
+	uint32_t calls = len / 2;
+	uint8_t *readerdata = malloc(calls);
+	uint8_t *tagdata = malloc(calls);
+	if (readerdata == NULL || tagdata == NULL || calls == 0) {
+		free(readerdata);
+		free(tagdata);
+		return;
+	}
+	// the decoder input of the sniff loop
+	for (uint32_t i = 0; i < calls; i++) {
+		readerdata[i] = (samples[2 * i] & 0xF0) | (samples[2 * i + 1] >> 4);
+		tagdata[i] = (samples[2 * i] << 4) | (samples[2 * i + 1] & 0x0F);
+	}
+
+	hf14a_replay_t r;
+	if (hf14a_replay(samples, len, false, &r)) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the trace");
+		free(readerdata);
+		free(tagdata);
+		return;
+	}
+	double airms = sniffreplay_bench_head(len, r.reader, r.tag, rounds);
+
+	static const char *names[] = {"Miller", "Miller reference", "Manchester", "Manchester reference", "sniff loop", "sniff loop reference"};
+	for (int d = 0; d < 6; d++) {
+		bool reference = d & 1;
+		uint64_t ms = msclock(), cycles = sniffreplay_cycles();
+		uint64_t bits = 0;
+		uint32_t done = 0;
+		for (uint32_t round = 0; round < rounds; round++) {
+			if (d < 2) {
+				// the reader channel alone,  the tag frames are noise to it
+				UartInit(replayCmd, replayCmdPar);
+				ref_UartInit(replayCmd, replayCmdPar);
+				for (uint32_t i = 0; i < calls; i++) {
+					if (reference) {
+						if (ref_MillerDecoding(readerdata[i], i * 8)) {
+							bits += refUart.len * 9;
+							ref_UartReset();
+						}
+					} else if (MillerDecoding(readerdata[i], i * 8)) {
+						bits += GetUart()->len * 9;
+						UartReset();
+					}
+				}
+			} else if (d < 4) {
+				DemodInit(replayResp, replayRespPar);
+				ref_DemodInit(replayResp, replayRespPar);
+				for (uint32_t i = 0; i < calls; i++) {
+					if (reference) {
+						if (ref_ManchesterDecoding(tagdata[i], 0, i * 8)) {
+							bits += refDemod.len * 9;
+							ref_DemodReset();
+						}
+					} else if (ManchesterDecoding(tagdata[i], 0, i * 8)) {
+						bits += GetDemod()->len * 9;
+						DemodReset();
+					}
+				}
+			} else {
+				hf14a_replay_t rr;
+				if (hf14a_replay(samples, len, reference, &rr))
+					break;
+				bits += rr.bits;
+				hf14a_replay_free(&rr);
+			}
+			done++;
+		}
+		ms = msclock() - ms;
+		cycles = sniffreplay_cycles() - cycles;
+
+		sniffreplay_bench_row(names[d], ms, cycles, calls, done, bits, airms);
+	}
+	sniffreplay_bench_foot("the firmware has 128 carrier cycles,  453 ARM cycles at 48 MHz,  a call");
+	hf14a_replay_free(&r);
+	free(readerdata);
+	free(tagdata);
+}
@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// ISO 14443 type A decoder replay,  the firmware Miller / Manchester decoders
+// run on recorded FPGA sniff samples
+//-----------------------------------------------------------------------------
+
+#ifndef HF14AREPLAY_H__
+#define HF14AREPLAY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sniffreplay.h"
+
+// the samples of the FPGA sniffer mode,  see sniffreplay.h
+#define HF14A_REPLAY_TICKS		SNIFFREPLAY_TICKS
+
+typedef struct {
+	uint8_t *trace;				// BigBuf trace format,  as SniffIso14443a logs it
+	uint32_t traceLen;
+	uint32_t traceSize;
+	uint32_t reader;			// frames decoded
+	uint32_t tag;
+	uint32_t collisions;		// tag frames with a collision
+	uint64_t bits;				// decoded,  with parity
+} hf14a_replay_t;
+
+// the SniffIso14443a loop on samples,  reference the decoders as they were before
+// the byte tables.  Returns 0,  or 1 no memory.  r->trace is allocated,  free it
+// with hf14a_replay_free().
+extern int hf14a_replay(const uint8_t *samples, size_t len, bool reference, hf14a_replay_t *r);
+extern void hf14a_replay_free(hf14a_replay_t *r);
+
+// A built-in sniff session as sample bytes,  0 MIFARE Classic,  1 a UID collision.
+// The reader pauses are 2 or 3 ticks wide,  phase ticks go before the first frame,
+// seed 0 no noise.  Returns the length,  free *samples.
+#define HF14A_REPLAY_SESSIONS	2
+extern size_t hf14a_replay_session(uint8_t **samples, int session, uint8_t pause, uint8_t phase, uint32_t seed);
+
+// the synthetic sessions,  the decoders against the reference on random samples
+// and the sample files in dir,  NULL skips them
+extern int hf14a_replay_test(const char *dir, bool verbose);
+// writes the sample files of the test into dir,  name.raw and name.trace
+extern int hf14a_replay_write(const char *dir);
+// cycles and throughput of the decoders and the reference on samples
+extern void hf14a_replay_bench(const uint8_t *samples, size_t len, uint32_t rounds);
+
+#endif
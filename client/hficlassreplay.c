@@ -0,0 +1,979 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// iClass decoder replay,  see hficlassreplay.h
+//-----------------------------------------------------------------------------
+
+#include "hficlassreplay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iclass_decode.h"
+#include "sniffreplay.h"
+#include "tracecompact.h"		// TRACELOG_HDR
+#include "util.h"
+#include "util_posix.h"			// msclock
+#include "ui.h"
+
+//-----------------------------------------------------------------------------
+// The reference,  the decoders of armsrc/iclass.c before the lookup tables,
+// bit by bit.  The statics of uart_bit() and uart_samples() are file statics
+// here,  so every replay starts from power up.
+//-----------------------------------------------------------------------------
+typedef struct {
+	bool synced;
+	bool frame;
+	bool frame_done;
+	uint8_t *buf;
+	int len;
+} refUart_t;
+static refUart_t refUart;
+
+static uint8_t refBitBuf, refBitN, refMsgByte;
+static int refMsgN;
+static uint32_t refSampleBuf;
+static int refWindow, refDropNext;
+
+static void ref_uart_reset(void) {
+	refUart.frame_done = false;
+	refUart.synced = false;
+	refUart.frame = false;
+}
+
+static void ref_uart_init(uint8_t *data) {
+	refUart.buf = data;
+	refUart.len = 0;
+	refBitBuf = 0xff;
+	refBitN = refMsgByte = 0;
+	refMsgN = 0;
+	refSampleBuf = 0;
+	refWindow = refDropNext = 0;
+	ref_uart_reset();
+}
+
+static void ref_uart_bit(uint8_t bit) {
+	refBitBuf <<= 1;
+	refBitBuf |= bit ? 1 : 0;
+
+	if (!refUart.frame) {
+		if (refBitBuf == 0x7b) {	// 0b0111 1011
+			refUart.frame = true;
+			refBitN = 0;
+			refUart.len = 0;
+			refMsgN = 0;
+		}
+	} else {
+		refBitN++;
+		if (refBitN == 8) {
+			refMsgByte >>= 2;
+			switch (refBitBuf) {
+				case 0xbf:    // 0 - 1011 1111
+					break;
+				case 0xef:    // 1 - 1110 1111
+					refMsgByte |= (1<<6);
+					break;
+				case 0xfb:    // 2 - 1111 1011
+					refMsgByte |= (2<<6);
+					break;
+				case 0xfe:    // 3 - 1111 1110
+					refMsgByte |= (3<<6);
+					break;
+				case 0xdf:    // eof - 1101 1111
+					refUart.frame = false;
+					refUart.synced = false;
+					refUart.frame_done = true;
+					break;
+				default:
+					refUart.frame = false;
+					refUart.synced = false;
+			}
+
+			if (refUart.frame) {   // data bits
+				refMsgN += 2;
+				if (refMsgN >= 8) {
+					refUart.buf[refUart.len++] = refMsgByte;
+					refMsgN = 0;
+				}
+			}
+			refBitN = 0;
+			refBitBuf = 0xff;
+		}
+	}
+}
+
+static void ref_uart_samples(uint8_t byte) {
+	uint32_t falling;
+	int lz;
+
+	if (!refUart.synced) {
+		if (byte == 0xFF)
+			return;
+		refSampleBuf = 0xFFFFFFFF;
+		refWindow = 0;
+		refDropNext = 0;
+		refUart.synced = true;
+	}
+
+	refSampleBuf <<= 8;
+	refSampleBuf |= byte;
+
+	if (refDropNext) {
+		refDropNext = 0;
+		return;
+	}
+
+again:
+	falling = ~refSampleBuf & ((refSampleBuf >> 1) ^ refSampleBuf) & (0xFF << refWindow);
+
+	ref_uart_bit(!falling);
+
+	if (!falling)
+		return;
+
+	lz = __builtin_clz(falling) - 24 + refWindow;
+
+	// aim to get falling edge on fourth-leftmost bit of window
+	refWindow += 3 - lz;
+
+	if (refWindow < 0) {
+		refWindow += 8;
+		refDropNext = 1;
+	} else if (refWindow >= 8) {
+		refWindow -= 8;
+		goto again;
+	}
+}
+
+typedef struct {
+	int state;					// the states and subs of tDemodIclass
+	int bitCount;
+	int posCount;
+	int syncBit;
+	uint16_t shiftReg;
+	uint32_t buffer;
+	uint32_t buffer2;
+	uint32_t buffer3;
+	int buff;
+	int samples;
+	int len;
+	int sub;
+	uint8_t *output;
+} refDemod_t;
+static refDemod_t refDemod;
+
+static void ref_DemodReset(void) {
+	refDemod.bitCount = 0;
+	refDemod.posCount = 0;
+	refDemod.syncBit = 0;
+	refDemod.shiftReg = 0;
+	refDemod.buffer = 0;
+	refDemod.buffer2 = 0;
+	refDemod.buffer3 = 0;
+	refDemod.buff = 0;
+	refDemod.samples = 0;
+	refDemod.len = 0;
+	refDemod.sub = SUB_NONE;
+	refDemod.state = DEMOD_UNSYNCD;
+}
+
+static void ref_DemodInit(uint8_t *data) {
+	refDemod.output = data;
+	ref_DemodReset();
+}
+
+static void ref_uart_debug(int error, int bit) {
+	refDemod.output[refDemod.len++] = 0xBB;
+	refDemod.output[refDemod.len++] = error & 0xFF;
+	refDemod.output[refDemod.len++] = 0xBB;
+	refDemod.output[refDemod.len++] = bit & 0xFF;
+	refDemod.output[refDemod.len++] = refDemod.buffer & 0xFF;
+	refDemod.output[refDemod.len++] = refDemod.buffer2 & 0xFF;
+	refDemod.output[refDemod.len++] = refDemod.syncBit & 0xFF;
+	refDemod.output[refDemod.len++] = 0xBB;
+}
+
+static int ref_ManchesterDecoding_iclass(uint32_t v) {
+	int bit;
+	int modulation;
+	int error = 0;
+
+	bit = refDemod.buffer;
+	refDemod.buffer = refDemod.buffer2;
+	refDemod.buffer2 = refDemod.buffer3;
+	refDemod.buffer3 = v;
+
+	// too few bits?
+	if (refDemod.buff < 3) {
+		refDemod.buff++;
+		return false;
+	}
+
+	if (refDemod.state == DEMOD_UNSYNCD) {
+		refDemod.output[refDemod.len] = 0xfa;
+		refDemod.syncBit = 0;
+		refDemod.posCount = 1;		// This is the first half bit period, so after syncing handle the second part
+
+		if (bit & 0x08)
+			refDemod.syncBit = 0x08;
+
+		if (bit & 0x04) {
+			if (refDemod.syncBit)
+				bit <<= 4;
+
+			refDemod.syncBit = 0x04;
+		}
+
+		if (bit & 0x02) {
+			if (refDemod.syncBit)
+				bit <<= 2;
+
+			refDemod.syncBit = 0x02;
+		}
+
+		if (bit & 0x01 && refDemod.syncBit)
+			refDemod.syncBit = 0x01;
+
+		if (refDemod.syncBit) {
+			refDemod.len = 0;
+			refDemod.state = DEMOD_START_OF_COMMUNICATION;
+			refDemod.sub = SUB_FIRST_HALF;
+			refDemod.bitCount = 0;
+			refDemod.shiftReg = 0;
+			refDemod.samples = 0;
+
+			if (refDemod.posCount) {
+
+				switch (refDemod.syncBit) {
+					case 0x08: refDemod.samples = 3; break;
+					case 0x04: refDemod.samples = 2; break;
+					case 0x02: refDemod.samples = 1; break;
+					case 0x01: refDemod.samples = 0; break;
+				}
+				// SOF must be long burst... otherwise stay unsynced!!!
+				if (!(refDemod.buffer & refDemod.syncBit) || !(refDemod.buffer2 & refDemod.syncBit))
+					refDemod.state = DEMOD_UNSYNCD;
+
+			} else {
+				// SOF must be long burst... otherwise stay unsynced!!!
+				if (!(refDemod.buffer2 & refDemod.syncBit) || !(refDemod.buffer3 & refDemod.syncBit)) {
+					refDemod.state = DEMOD_UNSYNCD;
+					error = 0x88;
+					ref_uart_debug(error, bit);
+					return false;
+				}
+			}
+			error = 0;
+		}
+		return false;
+	}
+
+	modulation = bit & refDemod.syncBit;
+	modulation |= ((bit << 1) ^ ((refDemod.buffer & 0x08) >> 3)) & refDemod.syncBit;
+	refDemod.samples += 4;
+
+	if (refDemod.posCount == 0) {
+		refDemod.posCount = 1;
+		refDemod.sub = (modulation) ? SUB_FIRST_HALF : SUB_NONE;
+		return false;
+	}
+
+	refDemod.posCount = 0;
+
+	if (modulation) {
+		if (refDemod.sub == SUB_FIRST_HALF)
+			refDemod.sub = SUB_BOTH;
+		else
+			refDemod.sub = SUB_SECOND_HALF;
+	}
+
+	if (refDemod.sub == SUB_NONE) {
+		if (refDemod.state == DEMOD_SOF_COMPLETE) {
+			refDemod.output[refDemod.len] = 0x0f;
+			refDemod.len++;
+			refDemod.state = DEMOD_UNSYNCD;
+			return true;
+		} else {
+			refDemod.state = DEMOD_ERROR_WAIT;
+			error = 0x33;
+		}
+	}
+
+	switch (refDemod.state) {
+		case DEMOD_START_OF_COMMUNICATION:
+			if (refDemod.sub == SUB_BOTH) {
+				refDemod.state = DEMOD_START_OF_COMMUNICATION2;
+				refDemod.posCount = 1;
+				refDemod.sub = SUB_NONE;
+			} else {
+				refDemod.output[refDemod.len] = 0xab;
+				refDemod.state = DEMOD_ERROR_WAIT;
+				error = 0xd2;
+			}
+			break;
+		case DEMOD_START_OF_COMMUNICATION2:
+			if (refDemod.sub == SUB_SECOND_HALF) {
+				refDemod.state = DEMOD_START_OF_COMMUNICATION3;
+			} else {
+				refDemod.output[refDemod.len] = 0xab;
+				refDemod.state = DEMOD_ERROR_WAIT;
+				error = 0xd3;
+			}
+			break;
+		case DEMOD_START_OF_COMMUNICATION3:
+			if (refDemod.sub == SUB_SECOND_HALF) {
+				refDemod.state = DEMOD_SOF_COMPLETE;
+			} else {
+				refDemod.output[refDemod.len] = 0xab;
+				refDemod.state = DEMOD_ERROR_WAIT;
+				error = 0xd4;
+			}
+			break;
+		case DEMOD_SOF_COMPLETE:
+		case DEMOD_MANCHESTER_D:
+		case DEMOD_MANCHESTER_E:
+			if (refDemod.sub == SUB_SECOND_HALF) {
+				refDemod.bitCount++;
+				refDemod.shiftReg = (refDemod.shiftReg >> 1) ^ 0x100;
+				refDemod.state = DEMOD_MANCHESTER_D;
+			} else if (refDemod.sub == SUB_FIRST_HALF) {
+				refDemod.bitCount++;
+				refDemod.shiftReg >>= 1;
+				refDemod.state = DEMOD_MANCHESTER_E;
+			} else if (refDemod.sub == SUB_BOTH) {
+				refDemod.state = DEMOD_MANCHESTER_F;
+			} else {
+				refDemod.state = DEMOD_ERROR_WAIT;
+				error = 0x55;
+			}
+			break;
+		case DEMOD_MANCHESTER_F:
+			if (refDemod.len > 0 || refDemod.bitCount > 0) {
+				if (refDemod.bitCount > 1) {
+					refDemod.shiftReg >>= (9 - refDemod.bitCount);
+					refDemod.output[refDemod.len] = refDemod.shiftReg & 0xff;
+					refDemod.len++;
+				}
+				refDemod.state = DEMOD_UNSYNCD;
+				return true;
+			} else {
+				refDemod.output[refDemod.len] = 0xad;
+				refDemod.state = DEMOD_ERROR_WAIT;
+				error = 0x03;
+			}
+			break;
+		case DEMOD_ERROR_WAIT:
+			refDemod.state = DEMOD_UNSYNCD;
+			break;
+		default:
+			refDemod.output[refDemod.len] = 0xdd;
+			refDemod.state = DEMOD_UNSYNCD;
+			break;
+	}
+
+	if (refDemod.bitCount >= 8) {
+		refDemod.shiftReg >>= 1;
+		refDemod.output[refDemod.len] = (refDemod.shiftReg & 0xff);
+		refDemod.len++;
+		refDemod.bitCount = 0;
+		refDemod.shiftReg = 0;
+	}
+
+	if (error) {
+		ref_uart_debug(error, bit);
+		return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// the replay
+//-----------------------------------------------------------------------------
+int hficlass_replay(const uint8_t *samples, size_t len, bool reference, hficlass_replay_t *r) {
+	memset(r, 0, sizeof(*r));
+
+	// neither decoder checks the length,  a frame of a sample file can take all
+	// of it.  The firmware buffers are ICLASS_BUFFER_SIZE.
+	uint8_t *cmd = malloc(len / 8 + 16);
+	uint8_t *resp = malloc(len / 4 + 16);
+	if (cmd == NULL || resp == NULL) {
+		free(cmd);
+		free(resp);
+		return 1;
+	}
+
+	tUartIclass uart;
+	tDemodIclass demod;
+	if (reference) {
+		ref_uart_init(cmd);
+		ref_DemodInit(resp);
+	} else {
+		uart_init(&uart, cmd);
+		DemodIclassInit(&demod, resp);
+	}
+
+	uint32_t previous_data = 0;
+	uint32_t time_start = 0, time_stop = 0;
+	uint32_t sniffCounter = 0;
+	bool TagIsActive = false;
+	bool ReaderIsActive = false;
+	int div = 0;
+	uint8_t foo = 0;
+	int ret = 0;
+
+	// the loop of SniffIClass,  data points to the next sample.  A tick is the
+	// SSP clock.
+	for (size_t i = 0; i + 1 < len && ret == 0; i++) {
+		previous_data <<= 8;
+		previous_data |= samples[i];
+
+		sniffCounter++;
+		uint8_t data = samples[i + 1];
+
+		if (data & 0xF)
+			foo ^= (1 << (3 - div));
+		div++;
+
+		// every odd sample
+		if (sniffCounter & 0x01) {
+			if (!TagIsActive) {
+				uint8_t reader_byte = (previous_data & 0xF0) | (data >> 4);
+				bool done;
+				int flen;
+				if (reference) {
+					ref_uart_samples(reader_byte);
+					done = refUart.frame_done;
+					flen = refUart.len;
+				} else {
+					uart_samples(&uart, reader_byte);
+					done = uart.frame_done;
+					flen = uart.len;
+				}
+				if (done) {
+					time_stop = sniffCounter * HFICLASS_REPLAY_TICKS;
+					r->reader++;
+					r->bits += flen * 8;
+					if (!sniffreplay_log(&r->trace, &r->traceLen, &r->traceSize, cmd, flen, time_start, time_stop, NULL, true))
+						ret = 1;
+					if (reference) {
+						ref_DemodReset();
+						ref_uart_reset();
+					} else {
+						DemodIclassReset(&demod);
+						uart_reset(&uart);
+					}
+				} else {
+					time_start = sniffCounter * HFICLASS_REPLAY_TICKS;
+				}
+				ReaderIsActive = reference ? refUart.frame_done : uart.frame_done;
+			}
+		}
+		// every four sample
+		if ((sniffCounter % 4) == 0) {
+			if (!ReaderIsActive) {
+				bool done = reference ? ref_ManchesterDecoding_iclass(foo) : ManchesterDecoding_iclass(&demod, foo);
+				if (done) {
+					int flen = reference ? refDemod.len : demod.len;
+					time_stop = sniffCounter * HFICLASS_REPLAY_TICKS;
+					r->tag++;
+					r->bits += flen * 8;
+					if (flen >= 8 && resp[flen - 8] == 0xBB && resp[flen - 6] == 0xBB && resp[flen - 1] == 0xBB)
+						r->errors++;
+					if (!sniffreplay_log(&r->trace, &r->traceLen, &r->traceSize, resp, flen, time_start, time_stop, NULL, false))
+						ret = 1;
+					if (reference) {
+						ref_DemodReset();
+						ref_uart_reset();
+					} else {
+						DemodIclassReset(&demod);
+						uart_reset(&uart);
+					}
+				} else {
+					time_start = sniffCounter * HFICLASS_REPLAY_TICKS;
+				}
+				TagIsActive = reference ? (refDemod.state != DEMOD_UNSYNCD) : (demod.state != DEMOD_UNSYNCD);
+			}
+			foo = 0;
+			div = 0;
+		}
+	}
+	free(cmd);
+	free(resp);
+	return ret;
+}
+
+void hficlass_replay_free(hficlass_replay_t *r) {
+	free(r->trace);
+	memset(r, 0, sizeof(*r));
+}
+
+//-----------------------------------------------------------------------------
+// Synthetic sniff sessions.  Each frame is encoded tick by tick the way the
+// FPGA sees it.  The reader pauses sit at the start of a slot of 8 ticks,  the
+// tag subcarrier fills halves of 16 ticks.  With noise a pause starts a tick
+// late and the tag loses a sample byte of a half.
+//-----------------------------------------------------------------------------
+typedef struct {
+	bool tag;
+	const char *data;			// NULL,  a tag answer of only a SOF
+	int16_t error;				// a half bit period without modulation at this bit,  -1 none
+} replayFrame_t;
+
+// ACTALL,  IDENTIFY,  SELECT,  READCHECK,  CHECK and two READs
+static const replayFrame_t replayRead[] = {
+	{false, "0A", -1},
+	{true,  NULL, -1},
+	{false, "0C", -1},
+	{true,  "E0 83 5D F1 FE 5F 02 7C 55 3F", -1},
+	{false, "81 E0 83 5D F1 FE 5F 02 7C", -1},
+	{true,  "03 1F EC 8A F7 FF 12 E0 AE 86", -1},
+	{false, "88 02", -1},
+	{true,  "FE FF FF FF FF FF FF FF", -1},
+	{false, "05 00 00 00 00 9F 3A 61 A8", -1},
+	{true,  "5E 4C 2D 0B", -1},
+	{false, "0C 01 FA 22", -1},
+	{true,  "12 FF FF FF 7F 1F FF 3C 8C 87", -1},
+	{false, "0C 06 45 56", -1},
+	{true,  "03 03 03 03 00 03 E0 17 43 23", -1},
+};
+
+// the tag answer to IDENTIFY breaks off,  the decoder logs its debug bytes
+static const replayFrame_t replayError[] = {
+	{false, "0A", -1},
+	{true,  NULL, -1},
+	{false, "0C", -1},
+	{true,  "E0 83 5D F1 FE 5F 02 7C 55 3F", 21},
+	{false, "0C", -1},
+	{true,  "E0 83 5D F1 FE 5F 02 7C 55 3F", -1},
+};
+
+typedef struct {
+	const replayFrame_t *frames;
+	uint32_t n;
+} replaySession_t;
+
+static const replaySession_t replaySessions[] = {
+	{replayRead, sizeof(replayRead) / sizeof(replayRead[0])},
+	{replayError, sizeof(replayError) / sizeof(replayError[0])},
+};
+#define REPLAY_SESSIONS		(sizeof(replaySessions) / sizeof(replaySessions[0]))
+
+// the files in traces/iclass
+static const sniffreplay_file_t replayFiles[] = {
+	{"iclass_read", 0, 6, 3, 0},
+	{"iclass_read_noise", 0, 5, 9, 0x1D2C3B4A},
+	{"iclass_error", 1, 7, 0, 0x5EED},
+};
+#define REPLAY_FILES		(sizeof(replayFiles) / sizeof(replayFiles[0]))
+
+// ticks,  the tag answers 330 us after the reader,  the reader waits 500 us
+#define REPLAY_TOUT			280
+#define REPLAY_GAP			420
+#define REPLAY_LEAD			64
+#define REPLAY_SLOT			8
+#define REPLAY_HALF			16
+
+// 8 slots of the reader,  a pause at the start of slot a and of slot b
+static void replaySlots(sniffreplay_ticks_t *t, int a, int b) {
+	for (int s = 0; s < 8; s++) {
+		if (s != a && s != b)
+			continue;
+		uint8_t *p = t->reader + t->len + s * REPLAY_SLOT;
+		int pos = 0, width = t->pause;
+		if (t->seed && (sniffreplay_rand(t) & 3) == 0) {
+			pos = 1;
+			width--;
+		}
+		memset(p + pos, 0, width);
+	}
+	t->len += 8 * REPLAY_SLOT;
+}
+
+// the tag subcarrier,  fc/32,  for a half bit period
+static void replayHalf(sniffreplay_ticks_t *t, bool modulated) {
+	if (modulated) {
+		uint8_t *p = t->tag + t->len;
+		for (int i = 0; i < REPLAY_HALF; i++)
+			p[i] = !((t->len + i) & 1);
+		if (t->seed && (sniffreplay_rand(t) & 3) == 0) {
+			// the subcarrier starts or stops a sample byte early
+			memset(p + ((sniffreplay_rand(t) & 1) ? 0 : REPLAY_HALF - HFICLASS_REPLAY_TICKS), 0, HFICLASS_REPLAY_TICKS);
+		}
+	}
+	t->len += REPLAY_HALF;
+}
+
+static bool replayFrame(sniffreplay_ticks_t *t, const replayFrame_t *f) {
+	uint8_t data[32] = {0};
+	int len = 0;
+	if (f->data)
+		param_gethex_to_eol(f->data, 0, data, sizeof(data), &len);
+
+	if (!f->tag) {
+		// SOF,  4 symbols a byte,  the low bits first,  EOF
+		if (!sniffreplay_grow(t, (len * 4 + 2) * 8 * REPLAY_SLOT))
+			return false;
+		replaySlots(t, 0, 5);
+		for (int i = 0; i < len * 4; i++)
+			replaySlots(t, ((data[i / 4] >> (2 * (i & 3))) & 3) * 2 + 1, -1);
+		replaySlots(t, 2, -1);
+		return true;
+	}
+
+	// SOF,  2 halves a bit,  the low bit first,  EOF
+	if (!sniffreplay_grow(t, (5 + len * 16 + 8 + 4) * REPLAY_HALF + REPLAY_HALF))
+		return false;
+	replayHalf(t, true);
+	replayHalf(t, true);
+	replayHalf(t, true);
+	replayHalf(t, false);
+	replayHalf(t, true);
+	if (f->data == NULL)
+		return true;
+	for (int i = 0; i < len * 8; i++) {
+		bool bit = (data[i / 8] >> (i & 7)) & 1;
+		if (i == f->error) {
+			replayHalf(t, false);
+			replayHalf(t, false);
+			continue;
+		}
+		replayHalf(t, !bit);
+		replayHalf(t, bit);
+	}
+	replayHalf(t, true);
+	replayHalf(t, false);
+	replayHalf(t, true);
+	replayHalf(t, true);
+	replayHalf(t, true);
+	return true;
+}
+
+size_t hficlass_replay_session(uint8_t **samples, int session, uint8_t pause, uint8_t phase, uint32_t seed) {
+	*samples = NULL;
+	if (session < 0 || session >= (int)REPLAY_SESSIONS || pause < 2 || pause > REPLAY_SLOT)
+		return 0;
+
+	sniffreplay_ticks_t t = {0};
+	t.pause = pause;
+	t.seed = seed;
+	const replaySession_t *s = &replaySessions[session];
+	bool ok = sniffreplay_grow(&t, REPLAY_LEAD + phase);
+	t.len += REPLAY_LEAD + phase;
+	for (uint32_t i = 0; ok && i < s->n; i++) {
+		uint32_t gap = s->frames[i].tag ? REPLAY_GAP : REPLAY_TOUT;
+		ok = replayFrame(&t, &s->frames[i]) && sniffreplay_grow(&t, gap);
+		t.len += gap;
+	}
+
+	return sniffreplay_samples(&t, ok, samples);
+}
+
+//-----------------------------------------------------------------------------
+// tests
+//-----------------------------------------------------------------------------
+
+// the frames of a session as the decoders give them.  A tag answer with an error
+// is the bytes before it and the 8 debug bytes,  BB 33 BB ..,  and what the
+// decoder makes of the rest of the answer.
+static bool replayExpect(const replaySession_t *s, hficlass_replay_t *r, bool verbose) {
+	uint32_t pos = 0;
+	for (uint32_t i = 0; i < s->n; i++) {
+		const replayFrame_t *f = &s->frames[i];
+		uint8_t data[32] = {0x0F};
+		int len = 1;
+		if (f->data)
+			param_gethex_to_eol(f->data, 0, data, sizeof(data), &len);
+		if (f->error >= 0)
+			len = f->error / 8;
+
+		if (pos + TRACELOG_HDR > r->traceLen) {
+			if (verbose) PrintAndLogEx(WARNING, "frame %u missing", i);
+			return false;
+		}
+		uint8_t *rec = r->trace + pos;
+		uint16_t rlen = (rec[6] | (rec[7] << 8)) & 0x7FFF;
+		bool rtag = rec[7] & 0x80;
+		bool ok = (rtag == f->tag) && memcmp(rec + TRACELOG_HDR, data, len) == 0;
+		if (f->error >= 0)
+			ok = ok && rlen == len + 8 && rec[TRACELOG_HDR + len] == 0xBB && rec[TRACELOG_HDR + len + 1] == 0x33;
+		else
+			ok = ok && rlen == len;
+		if (!ok) {
+			if (verbose) PrintAndLogEx(WARNING, "frame %u: got %s %s", i, rtag ? "Tag" : "Rdr", sprint_hex(rec + TRACELOG_HDR, rlen));
+			return false;
+		}
+		pos += TRACELOG_HDR + rlen + tracelog_paritybytes(rlen);
+
+		// the decoder syncs again on the rest of the answer
+		while (f->error >= 0 && pos + TRACELOG_HDR <= r->traceLen && (r->trace[pos + 7] & 0x80)) {
+			rlen = (r->trace[pos + 6] | (r->trace[pos + 7] << 8)) & 0x7FFF;
+			pos += TRACELOG_HDR + rlen + tracelog_paritybytes(rlen);
+		}
+	}
+	if (pos != r->traceLen) {
+		if (verbose) PrintAndLogEx(WARNING, "%u bytes of frames too many", r->traceLen - pos);
+		return false;
+	}
+	return true;
+}
+
+// the decoders and the reference on the same samples
+static bool replaySame(const uint8_t *samples, size_t len, hficlass_replay_t *r) {
+	hficlass_replay_t ref = {0};
+	bool ok = hficlass_replay(samples, len, false, r) == 0 && hficlass_replay(samples, len, true, &ref) == 0;
+	ok = ok && r->traceLen == ref.traceLen && memcmp(r->trace, ref.trace, r->traceLen) == 0;
+	hficlass_replay_free(&ref);
+	return ok;
+}
+
+// all sessions,  every pause width,  every phase of a half bit period,  clean and
+// noisy.  The clean ones decode to the frames,  all of them as the reference.
+static bool replaySynthetic(bool verbose) {
+	uint32_t runs = 0, differs = 0, clean = 0, noisy = 0;
+	for (int s = 0; s < (int)REPLAY_SESSIONS; s++) {
+		for (uint8_t pause = 4; pause <= REPLAY_SLOT; pause++) {
+			for (uint8_t phase = 0; phase < REPLAY_HALF; phase++) {
+				for (uint32_t seed = 0; seed < 2; seed++) {
+					uint8_t *samples;
+					hficlass_replay_t r = {0};
+					size_t len = hficlass_replay_session(&samples, s, pause, phase, seed * 0x9E3779B9);
+					if (len == 0 || !replaySame(samples, len, &r)) {
+						differs++;
+						if (verbose) PrintAndLogEx(WARNING, "session %d pause %u phase %u seed %u differs from the reference", s, pause, phase, seed);
+					} else if (replayExpect(&replaySessions[s], &r, verbose && seed == 0)) {
+						clean += (seed == 0);
+						noisy += (seed != 0);
+					} else if (seed == 0 && verbose) {
+						PrintAndLogEx(WARNING, "session %d pause %u phase %u not decoded", s, pause, phase);
+					}
+					free(samples);
+					runs++;
+					hficlass_replay_free(&r);
+				}
+			}
+		}
+	}
+	bool ok = (differs == 0 && clean == runs / 2);
+	PrintAndLogEx(ok ? SUCCESS : FAILED, "synthetic sessions: %u of %u as the reference,  %u of %u clean and %u of %u noisy ones decoded",
+		runs - differs, runs, clean, runs / 2, noisy, runs / 2);
+	return ok;
+}
+
+// uart_samples() from every state it keeps between calls,  the last sample byte,
+// the window and drop_next,  on every byte
+static bool replayWindows(bool verbose) {
+	uint8_t cmd[16], refcmd[16];
+	uint32_t failed = 0;
+	for (uint32_t st = 0; st < 256 * 8 * 2; st++) {
+		for (uint32_t byte = 0; byte < 256; byte++) {
+			tUartIclass uart;
+			uart_init(&uart, cmd);
+			ref_uart_init(refcmd);
+			uart.synced = refUart.synced = true;
+			uart.samples = 0xFF00 | (st & 0xFF);
+			refSampleBuf = 0xFFFFFF00 | (st & 0xFF);
+			uart.window = refWindow = (st >> 8) & 7;
+			refDropNext = st >> 11;
+			uart.drop_next = refDropNext;
+
+			uart_samples(&uart, byte);
+			ref_uart_samples(byte);
+			if (uart.window != refWindow || uart.drop_next != refDropNext || uart.slots != refBitBuf || uart.frame != refUart.frame) {
+				if (verbose && failed == 0) PrintAndLogEx(WARNING, "window %u drop %u last %02X byte %02X differs from the reference", (st >> 8) & 7, st >> 11, st & 0xFF, byte);
+				failed++;
+			}
+		}
+	}
+	PrintAndLogEx(failed ? FAILED : SUCCESS, "reader windows: %u of %u steps as the reference", 256 * 8 * 2 * 256 - failed, 256 * 8 * 2 * 256);
+	return failed == 0;
+}
+
+// call by call on random samples,  the state after each call and every frame.
+// The densities of field drops and tag modulation go from idle to none.
+static bool replayRandom(bool verbose) {
+	uint8_t cmd[0x1000], resp[0x1000], refcmd[0x1000], refresp[0x1000];
+	uint32_t seed = 0xC0FFEE, calls = 0, frames = 0, failed = 0;
+	for (int density = 0; density < 8; density++) {
+		tUartIclass uart;
+		tDemodIclass demod;
+		uart_init(&uart, cmd);
+		DemodIclassInit(&demod, resp);
+		ref_uart_init(refcmd);
+		ref_DemodInit(refresp);
+		for (uint32_t i = 0; i < 200000 && !failed; i++) {
+			seed = seed * 1103515245 + 12345;
+			uint32_t rnd = seed >> 8;
+			seed = seed * 1103515245 + 12345;
+			uint32_t rnd2 = seed >> 8;
+			// mostly field,  pauses a few samples wide.  Dense ones anything.
+			uint8_t byte = 0xFF;
+			if ((rnd & 7) < (uint32_t)density)
+				byte = (0xFF << ((rnd >> 3) & 7)) | (0xFF >> (((rnd >> 6) & 7) + 1));
+			if (density >= 6 && (rnd2 & 1))
+				byte = rnd2 >> 8;
+			uint8_t nibble = ((rnd >> 9) & 7) < (uint32_t)density ? (rnd >> 12) & 0x0F : 0;
+			if (density == 7)
+				nibble = (((rnd >> 16) & 3) == 0) ? 0 : 0x0F ^ ((rnd >> 18) & ((rnd >> 22) & 0x0F));
+
+			uart_samples(&uart, byte);
+			ref_uart_samples(byte);
+			bool ok = uart.synced == refUart.synced && uart.frame == refUart.frame && uart.frame_done == refUart.frame_done &&
+				uart.len == refUart.len && memcmp(cmd, refcmd, uart.len) == 0;
+			if (uart.frame_done) {
+				frames++;
+				uart_reset(&uart);
+				ref_uart_reset();
+			}
+			if (uart.len > 0x800) {
+				uart_init(&uart, cmd);
+				ref_uart_init(refcmd);
+			}
+
+			int got = ManchesterDecoding_iclass(&demod, nibble);
+			int want = ref_ManchesterDecoding_iclass(nibble);
+			ok = ok && got == want && (int)demod.state == refDemod.state && (int)demod.sub == refDemod.sub &&
+				demod.len == refDemod.len && demod.bitCount == refDemod.bitCount && demod.shiftReg == refDemod.shiftReg &&
+				memcmp(resp, refresp, demod.len) == 0;
+			if (got || demod.len > 0x800) {
+				frames += got;
+				DemodIclassReset(&demod);
+				ref_DemodReset();
+			}
+			calls++;
+			if (!ok) {
+				failed++;
+				if (verbose) PrintAndLogEx(WARNING, "density %d call %u differs from the reference", density, i);
+			}
+		}
+	}
+	PrintAndLogEx(failed ? FAILED : SUCCESS, "random samples: %u calls,  %u frames,  %s", calls, frames, failed ? "differs from the reference" : "as the reference");
+	return failed == 0;
+}
+
+static int replayDecode(const uint8_t *samples, size_t len, uint8_t **trace, uint32_t *traceLen) {
+	hficlass_replay_t r;
+	if (hficlass_replay(samples, len, false, &r))
+		return 1;
+	*trace = r.trace;
+	*traceLen = r.traceLen;
+	return 0;
+}
+
+// the sample files decode as the reference
+static bool replayCheck(const uint8_t *samples, size_t len, const uint8_t *trace, uint32_t traceLen, const sniffreplay_file_t *f, bool verbose) {
+	hficlass_replay_t ref;
+	bool ok = hficlass_replay(samples, len, true, &ref) == 0 && ref.traceLen == traceLen && memcmp(ref.trace, trace, traceLen) == 0;
+	hficlass_replay_free(&ref);
+	return ok;
+}
+
+static const sniffreplay_files_t replayFileSet = {
+	replayFiles, REPLAY_FILES, hficlass_replay_session, replayDecode, replayCheck
+};
+
+int hficlass_replay_write(const char *dir) {
+	return sniffreplay_write_files(&replayFileSet, dir);
+}
+
+int hficlass_replay_test(const char *dir, bool verbose) {
+	bool ok = replaySynthetic(verbose);
+	ok = replayWindows(verbose) && ok;
+	ok = replayRandom(verbose) && ok;
+	if (dir)
+		ok = sniffreplay_check_files(&replayFileSet, dir, verbose) && ok;
+	return ok ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// bench
+//-----------------------------------------------------------------------------
+void hficlass_replay_bench(const uint8_t *samples, size_t len, uint32_t rounds) {
+	uint32_t rcalls = len / 2, tcalls = len / 4;
+	uint8_t *readerdata = malloc(rcalls);
+	uint8_t *tagdata = malloc(tcalls);
+	uint8_t *cmd = malloc(len / 8 + 16);
+	uint8_t *resp = malloc(len / 4 + 16);
+	hficlass_replay_t r = {0};
+	if (readerdata == NULL || tagdata == NULL || cmd == NULL || resp == NULL || tcalls == 0 || hficlass_replay(samples, len, false, &r)) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the bench");
+		goto out;
+	}
+	// the decoder input of the sniff loop
+	for (uint32_t i = 0; i < rcalls; i++)
+		readerdata[i] = (samples[2 * i] & 0xF0) | (samples[2 * i + 1] >> 4);
+	for (uint32_t i = 0; i < tcalls; i++) {
+		tagdata[i] = 0;
+		for (int j = 0; j < 4; j++)
+			tagdata[i] |= (samples[4 * i + j] & 0x0F) ? (8 >> j) : 0;
+	}
+
+	double airms = sniffreplay_bench_head(len, r.reader, r.tag, rounds);
+
+	static const char *names[] = {"1 out of 4", "1 out of 4 reference", "Manchester", "Manchester reference", "sniff loop", "sniff loop reference"};
+	for (int d = 0; d < 6; d++) {
+		bool reference = d & 1;
+		uint64_t ms = msclock(), cycles = sniffreplay_cycles();
+		uint64_t bits = 0;
+		uint32_t done = 0, calls = (d < 2) ? rcalls : (d < 4) ? tcalls : len;
+		for (uint32_t round = 0; round < rounds; round++) {
+			if (d < 2) {
+				// the reader channel alone,  the tag frames are quiet to it
+				tUartIclass uart;
+				uart_init(&uart, cmd);
+				ref_uart_init(cmd);
+				for (uint32_t i = 0; i < rcalls; i++) {
+					if (reference) {
+						ref_uart_samples(readerdata[i]);
+						if (refUart.frame_done) {
+							bits += refUart.len * 8;
+							ref_uart_reset();
+						}
+					} else {
+						uart_samples(&uart, readerdata[i]);
+						if (uart.frame_done) {
+							bits += uart.len * 8;
+							uart_reset(&uart);
+						}
+					}
+				}
+			} else if (d < 4) {
+				tDemodIclass demod;
+				DemodIclassInit(&demod, resp);
+				ref_DemodInit(resp);
+				for (uint32_t i = 0; i < tcalls; i++) {
+					if (reference) {
+						if (ref_ManchesterDecoding_iclass(tagdata[i])) {
+							bits += refDemod.len * 8;
+							ref_DemodReset();
+						}
+					} else if (ManchesterDecoding_iclass(&demod, tagdata[i])) {
+						bits += demod.len * 8;
+						DemodIclassReset(&demod);
+					}
+				}
+			} else {
+				hficlass_replay_t rr;
+				if (hficlass_replay(samples, len, reference, &rr))
+					break;
+				bits += rr.bits;
+				hficlass_replay_free(&rr);
+			}
+			done++;
+		}
+		ms = msclock() - ms;
+		cycles = sniffreplay_cycles() - cycles;
+
+		sniffreplay_bench_row(names[d], ms, cycles, calls, done, bits, airms);
+		if (bits == 0 && r.reader + r.tag)
+			PrintAndLogEx(WARNING, "no frames decoded");
+	}
+	sniffreplay_bench_foot("a sniff loop call is a sample byte,  the firmware has 64 carrier cycles,  226 ARM cycles at 48 MHz,  for it");
+out:
+	hficlass_replay_free(&r);
+	free(readerdata);
+	free(tagdata);
+	free(cmd);
+	free(resp);
+}
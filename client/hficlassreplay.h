@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// iClass decoder replay,  the firmware 1 out of 4 / Manchester decoders run on
+// recorded FPGA sniff samples
+//-----------------------------------------------------------------------------
+
+#ifndef HFICLASSREPLAY_H__
+#define HFICLASSREPLAY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sniffreplay.h"
+
+// the samples of the FPGA sniffer mode of 'hf iclass sniff',  see sniffreplay.h
+#define HFICLASS_REPLAY_TICKS	SNIFFREPLAY_TICKS
+
+typedef struct {
+	uint8_t *trace;				// BigBuf trace format,  as SniffIClass logs it
+	uint32_t traceLen;
+	uint32_t traceSize;
+	uint32_t reader;			// frames decoded
+	uint32_t tag;
+	uint32_t errors;			// tag frames that are the debug bytes of an error
+	uint64_t bits;
+} hficlass_replay_t;
+
+// the SniffIClass loop on samples,  reference the decoders as they were before
+// the lookup tables.  Returns 0,  or 1 no memory.  r->trace is allocated,  free
+// it with hficlass_replay_free().
+extern int hficlass_replay(const uint8_t *samples, size_t len, bool reference, hficlass_replay_t *r);
+extern void hficlass_replay_free(hficlass_replay_t *r);
+
+// A built-in sniff session as sample bytes,  0 a read of a block,  1 a tag answer
+// with a Manchester error.  Pauses are pause ticks wide,  phase ticks go before
+// the first frame,  seed 0 no noise.  Returns the length,  free *samples.
+#define HFICLASS_REPLAY_SESSIONS	2
+extern size_t hficlass_replay_session(uint8_t **samples, int session, uint8_t pause, uint8_t phase, uint32_t seed);
+
+// the synthetic sessions,  the decoders against the reference on random samples
+// and the sample files in dir,  NULL skips them
+extern int hficlass_replay_test(const char *dir, bool verbose);
+// writes the sample files of the test into dir,  name.raw and name.trace
+extern int hficlass_replay_write(const char *dir);
+// throughput of the decoders and the reference on samples
+extern void hficlass_replay_bench(const uint8_t *samples, size_t len, uint32_t rounds);
+
+#endif
@@ -0,0 +1,272 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Hitag2 key search.
+//
+// Like hardnested_bf_core.c this file is compiled several times, once for each
+// instruction set.  A vector holds one cipher bit of 64 to 512 keys.
+//
+// The state is not shifted,  round r writes bit s[48 + r] and the state is the
+// window s[r + 1 .. r + 48].  Key bit i (from the msb) is state bit 32 + i for
+// i < 16,  the others go into the feedback of init round i - 16.  So the first
+// key bits are enumerated depth first,  every node costs one scalar f20 and a
+// broadcast,  and only the last lanebits key bits differ between the lanes of
+// the vectors.  Output rounds stop as soon as no lane matches the keystream.
+//-----------------------------------------------------------------------------
+
+#include "hitag2_bs_core.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// this needs to be compiled several times for each instruction set.
+// For each instruction set, define a dedicated function name:
+#if defined (__AVX512F__)
+#define HT2_CORE hitag2_bs_core_AVX512
+#define HT2_NAME "AVX512"
+#define HT2_LANEBITS 9
+#elif defined (__AVX2__)
+#define HT2_CORE hitag2_bs_core_AVX2
+#define HT2_NAME "AVX2"
+#define HT2_LANEBITS 8
+#elif defined (__AVX__)
+#define HT2_CORE hitag2_bs_core_AVX
+#define HT2_NAME "AVX"
+#define HT2_LANEBITS 7
+#elif defined (__SSE2__)
+#define HT2_CORE hitag2_bs_core_SSE2
+#define HT2_NAME "SSE2"
+#define HT2_LANEBITS 7
+#elif defined (__MMX__)
+#define HT2_CORE hitag2_bs_core_MMX
+#define HT2_NAME "MMX"
+#define HT2_LANEBITS 6
+#else
+#define HT2_CORE hitag2_bs_core_NOSIMD
+#define HT2_NAME "NOSIMD"
+#define HT2_LANEBITS 6
+#endif
+
+#define HT2_LANES (1 << HT2_LANEBITS)
+#define VECTOR_SIZE (HT2_LANES / 8)
+typedef uint32_t __attribute__((aligned(VECTOR_SIZE))) __attribute__((vector_size(VECTOR_SIZE))) bs_t;
+typedef union {
+	bs_t v;
+	uint64_t w[HT2_LANES / 64];
+} bs_lanes_t;
+
+extern const hitag2_bs_core_t hitag2_bs_core_AVX512, hitag2_bs_core_AVX2, hitag2_bs_core_AVX, hitag2_bs_core_SSE2, hitag2_bs_core_MMX, hitag2_bs_core_NOSIMD;
+
+#define i4(x,a,b,c,d)	((uint32_t)((((x)>>(a))&1)+(((x)>>(b))&1)*2+(((x)>>(c))&1)*4+(((x)>>(d))&1)*8))
+
+static inline uint32_t f20(const uint64_t x) {
+	uint32_t i5;
+
+	i5 = ((0x2C79 >> i4(x, 1, 2, 4, 5)) & 1) * 1
+	   + ((0x6671 >> i4(x, 7,11,13,14)) & 1) * 2
+	   + ((0x6671 >> i4(x,16,20,22,25)) & 1) * 4
+	   + ((0x6671 >> i4(x,27,28,30,32)) & 1) * 8
+	   + ((0x2C79 >> i4(x,33,42,43,45)) & 1) * 16;
+
+	return (0x7907287B >> i5) & 1;
+}
+
+// the filter functions as gates,  inputs in the order of the i4() above
+static inline bs_t f4a(bs_t a, bs_t b, bs_t c, bs_t d) {
+	return ~(((a | b) & c) ^ (a | d) ^ b);
+}
+
+static inline bs_t f4b(bs_t a, bs_t b, bs_t c, bs_t d) {
+	return ~(((d | c) & (a ^ b)) ^ (d | a | b));
+}
+
+static inline bs_t f5c(bs_t a, bs_t b, bs_t c, bs_t d, bs_t e) {
+	return ~((((((c ^ e) | d) & a) ^ b) & (c ^ b)) ^ (((d ^ e) | a) & ((d ^ b) | c)));
+}
+
+static inline bs_t f20_bs(const bs_t *x) {
+	return f5c(f4a(x[ 1], x[ 2], x[ 4], x[ 5]),
+	           f4b(x[ 7], x[11], x[13], x[14]),
+	           f4b(x[16], x[20], x[22], x[25]),
+	           f4b(x[27], x[28], x[30], x[32]),
+	           f4a(x[33], x[42], x[43], x[45]));
+}
+
+static inline bs_t lfsr_bs(const bs_t *x) {
+	return x[ 0] ^ x[ 2] ^ x[ 3] ^ x[ 6] ^ x[ 7] ^ x[ 8] ^ x[16] ^ x[22]
+	     ^ x[23] ^ x[26] ^ x[30] ^ x[41] ^ x[42] ^ x[43] ^ x[46] ^ x[47];
+}
+
+static inline bool bs_any(bs_t v) {
+	bs_lanes_t u;
+	u.v = v;
+	uint64_t r = 0;
+	for (int i = 0; i < HT2_LANES / 64; i++)
+		r |= u.w[i];
+	return r != 0;
+}
+
+typedef struct {
+	bs_t s[48 + 32 + 32];
+	bs_t lane[HT2_LANEBITS];	// lane l holds key bit 48 - lanebits + t in bit lanebits - 1 - t of l
+	bs_t nr[32];
+	bs_t ks[32];
+	bs_t ones;
+	uint32_t nR;
+	uint64_t key;
+	uint64_t tried;
+	hitag2_bs_hit_t *hit;
+	void *ctx;
+	volatile const bool *stop;
+} ht2_search_t;
+
+static void ht2_leaf(ht2_search_t *c) {
+	bs_t *s = c->s;
+
+	for (int r = 32 - HT2_LANEBITS; r < 32; r++)
+		s[48 + r] = f20_bs(&s[r + 1]) ^ c->nr[r] ^ c->lane[r - (32 - HT2_LANEBITS)];
+
+	c->tried += HT2_LANES;
+
+	bs_t match = c->ones;
+	for (int t = 0; t < 32; t++) {
+		if (t >= 2)
+			s[78 + t] = lfsr_bs(&s[30 + t]);
+		match &= ~(f20_bs(&s[33 + t]) ^ c->ks[t]);
+		if (!bs_any(match))
+			return;
+	}
+
+	bs_lanes_t u;
+	u.v = match;
+	for (int i = 0; i < HT2_LANES / 64; i++)
+		for (int b = 0; b < 64; b++)
+			if ((u.w[i] >> b) & 1)
+				c->hit(c->key | (uint64_t)(64 * i + b), c->ctx);
+}
+
+// x is the scalar state with key bits 0 .. i-1 in,  key bit i next
+static void ht2_dfs(ht2_search_t *c, int i, uint64_t x) {
+	if (*c->stop)
+		return;
+
+	if (i == 48 - HT2_LANEBITS) {
+		ht2_leaf(c);
+		return;
+	}
+
+	uint64_t bit = (uint64_t)1 << (47 - i);
+	if (i < 16) {
+		c->s[32 + i] = ~c->ones;
+		ht2_dfs(c, i + 1, x);
+		c->s[32 + i] = c->ones;
+		c->key |= bit;
+		ht2_dfs(c, i + 1, x | ((uint64_t)1 << (32 + i)));
+	} else {
+		x >>= 1;
+		uint64_t f = f20(x) ^ ((c->nR >> (47 - i)) & 1);
+		c->s[32 + i] = f ? c->ones : ~c->ones;
+		ht2_dfs(c, i + 1, x | (f << 47));
+		c->s[32 + i] = f ? ~c->ones : c->ones;
+		c->key |= bit;
+		ht2_dfs(c, i + 1, x | ((f ^ 1) << 47));
+	}
+	c->key &= ~bit;
+}
+
+static uint64_t ht2_search(const hitag2_bs_job_t *job, hitag2_bs_hit_t *hit, void *ctx, volatile const bool *stop) {
+	if (job->fixed > 48 - HT2_LANEBITS)
+		return 0;
+
+	ht2_search_t search;
+	ht2_search_t *c = &search;
+
+	bs_t zero = {0};
+	c->ones = ~zero;
+	c->nR = job->nR;
+	c->hit = hit;
+	c->ctx = ctx;
+	c->stop = stop;
+	c->tried = 0;
+
+	for (int i = 0; i < 32; i++) {
+		c->s[i] = ((job->uid >> (31 - i)) & 1) ? c->ones : zero;
+		c->nr[i] = ((job->nR >> (31 - i)) & 1) ? c->ones : zero;
+		c->ks[i] = ((job->ks >> (31 - i)) & 1) ? c->ones : zero;
+	}
+
+	for (int t = 0; t < HT2_LANEBITS; t++) {
+		bs_lanes_t u;
+		for (int i = 0; i < HT2_LANES / 64; i++) {
+			u.w[i] = 0;
+			for (int b = 0; b < 64; b++)
+				u.w[i] |= (uint64_t)(((64 * i + b) >> (HT2_LANEBITS - 1 - t)) & 1) << b;
+		}
+		c->lane[t] = u.v;
+	}
+
+	// the given key bits,  then the search below them
+	uint64_t x = 0;
+	for (int i = 0; i < 32; i++)
+		x |= (uint64_t)((job->uid >> (31 - i)) & 1) << i;
+
+	c->key = job->key & ~((1ULL << (48 - job->fixed)) - 1) & 0xFFFFFFFFFFFFULL;
+	for (int i = 0; i < job->fixed; i++) {
+		uint64_t k = (c->key >> (47 - i)) & 1;
+		if (i < 16) {
+			x |= k << (32 + i);
+		} else {
+			x >>= 1;
+			k ^= f20(x) ^ ((job->nR >> (47 - i)) & 1);
+			x |= k << 47;
+		}
+		c->s[32 + i] = k ? c->ones : zero;
+	}
+
+	ht2_dfs(c, job->fixed, x);
+
+	return c->tried;
+}
+
+const hitag2_bs_core_t HT2_CORE = {
+	HT2_NAME,
+	HT2_LANEBITS,
+	ht2_search
+};
+
+#ifndef __MMX__
+
+// determine the available instruction sets at runtime
+int hitag2_bs_cores(const hitag2_bs_core_t **cores) {
+	int n = 0;
+
+#if defined (__i386__) || defined (__x86_64__)
+	#if !defined(__APPLE__) || (defined(__APPLE__) && (__clang_major__ > 8 || __clang_major__ == 8 && __clang_minor__ >= 1))
+		#if (__GNUC__ >= 5) && (__GNUC__ > 5 || __GNUC_MINOR__ > 2)
+	if (__builtin_cpu_supports("avx512f")) cores[n++] = &hitag2_bs_core_AVX512;
+		#endif
+	if (__builtin_cpu_supports("avx2")) cores[n++] = &hitag2_bs_core_AVX2;
+	if (__builtin_cpu_supports("avx")) cores[n++] = &hitag2_bs_core_AVX;
+	if (__builtin_cpu_supports("sse2")) cores[n++] = &hitag2_bs_core_SSE2;
+	if (__builtin_cpu_supports("mmx")) cores[n++] = &hitag2_bs_core_MMX;
+	#endif
+#endif
+	cores[n++] = &hitag2_bs_core_NOSIMD;
+
+	return n;
+}
+
+const hitag2_bs_core_t *hitag2_bs_get_core(void) {
+	static const hitag2_bs_core_t *core = NULL;
+	if (!core) {
+		const hitag2_bs_core_t *cores[6];
+		hitag2_bs_cores(cores);
+		core = cores[0];
+	}
+	return core;
+}
+
+#endif
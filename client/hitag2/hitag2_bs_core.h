@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Hitag2 key search.  Compiled once per instruction set (see
+// Makefile, MULTIARCHSRCS) and selected at runtime like the hardnested cores.
+//-----------------------------------------------------------------------------
+
+#ifndef HITAG2_BS_CORE_H__
+#define HITAG2_BS_CORE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint32_t uid;
+	uint32_t nR;		// as sent
+	uint32_t ks;		// first 32 keystream bits,  ~aR
+	uint64_t key;		// the first 'fixed' key bits,  counted from the msb,  are given
+	uint8_t fixed;		// at most 48 - lanebits
+} hitag2_bs_job_t;
+
+// a key giving ks,  called from the searching thread
+typedef void hitag2_bs_hit_t(uint64_t key, void *ctx);
+
+typedef struct {
+	const char *name;
+	uint8_t lanebits;	// 2^lanebits keys go through the cipher together
+	// every key of the job,  stops early when *stop is set.  Returns the number of keys tried
+	uint64_t (*search)(const hitag2_bs_job_t *job, hitag2_bs_hit_t *hit, void *ctx, volatile const bool *stop);
+} hitag2_bs_core_t;
+
+// the cores this CPU can run,  fastest first.  Returns how many, at most 6
+extern int hitag2_bs_cores(const hitag2_bs_core_t **cores);
+extern const hitag2_bs_core_t *hitag2_bs_get_core(void);
+
+#endif
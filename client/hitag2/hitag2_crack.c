@@ -0,0 +1,253 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Hitag2 key recovery from reader authentications.
+//
+// The key space below the given bits is cut into jobs of 2^24 keys or less,
+// the threads take them in order.  The cores filter on the first pair,  a
+// 32 bit check,  the few keys left are checked against all pairs here.
+//-----------------------------------------------------------------------------
+
+#include "hitag2_crack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hitag2_crypto.h"
+#include "ui.h"
+#include "util.h"
+#include "util_posix.h"
+
+#define HT2_JOB_BITS		24
+#define HT2_PROGRESS_MS		10000
+
+bool hitag2_nrar_frame(hitag2_nrar_parser_t *p, bool isResponse, int bits, const uint8_t *frame, hitag2_nrar_t *out) {
+	if (isResponse) {
+		p->have_uid = (bits == 32);
+		if (p->have_uid)
+			p->uid = bytes_to_num((uint8_t *)frame, 4);
+		return false;
+	}
+
+	bool found = p->have_uid && bits == 64;
+	if (found) {
+		out->uid = p->uid;
+		out->nR = bytes_to_num((uint8_t *)frame, 4);
+		out->aR = bytes_to_num((uint8_t *)frame + 4, 4);
+	}
+	p->have_uid = false;
+	return found;
+}
+
+int hitag2_nrar_from_trace(const uint8_t *trace, size_t len, hitag2_nrar_t *pairs, int max) {
+	hitag2_nrar_parser_t p = {0};
+	int n = 0;
+
+	for (size_t i = 0; i + 9 <= len && n < max; ) {
+		// timestamp,  msb set on tag frames,  4 bytes parity
+		bool isResponse = trace[i + 3] & 0x80;
+		int bits = trace[i + 8];
+		size_t flen = (bits + 7) / 8;
+		const uint8_t *frame = trace + i + 9;
+
+		if (flen > 100 || i + 9 + flen > len)
+			break;
+		// rest of the buffer was never written
+		if (flen >= 4 && frame[0] == 0x44 && frame[1] == 0x44 && frame[3] == 0x44)
+			break;
+
+		if (hitag2_nrar_frame(&p, isResponse, bits, frame, &pairs[n]))
+			n++;
+		i += 9 + flen;
+	}
+	return n;
+}
+
+int hitag2_nrar_from_list(const char *filename, hitag2_nrar_t *pairs, int max) {
+	FILE *f = fopen(filename, "r");
+	if (!f)
+		return -1;
+
+	hitag2_nrar_parser_t p = {0};
+	char line[1024];
+	int n = 0;
+
+	while (n < max && fgets(line, sizeof(line), f)) {
+		int delta, bits, pos = 0;
+		if (sscanf(line, " +%d: %d:%n", &delta, &bits, &pos) != 2 || pos == 0)
+			continue;
+
+		char *c = line + pos;
+		while (*c == ' ')
+			c++;
+		bool isResponse = !strncmp(c, "TAG", 3);
+		if (isResponse)
+			c += 3;
+
+		uint8_t frame[100];
+		int flen = 0;
+		for (char *tok = strtok(c, " !\r\n"); tok && flen < (int)sizeof(frame); tok = strtok(NULL, " !\r\n"))
+			frame[flen++] = strtoul(tok, NULL, 16);
+
+		if (flen != (bits + 7) / 8)
+			continue;
+		if (hitag2_nrar_frame(&p, isResponse, bits, frame, &pairs[n]))
+			n++;
+	}
+	fclose(f);
+	return n;
+}
+
+typedef struct {
+	pthread_mutex_t lock;
+	const hitag2_bs_core_t *core;
+	const hitag2_nrar_t *pairs;
+	int npairs;
+	uint64_t key;			// the given bits
+	uint64_t mask;
+	uint8_t jobfixed;
+	uint64_t jobs;
+	uint64_t next;
+	uint64_t done;
+	uint64_t tried;
+	uint64_t *keys;
+	int maxkeys;
+	int found;
+	volatile bool stop;
+} ht2_crack_t;
+
+static void ht2_crack_hit(uint64_t key, void *ctx) {
+	ht2_crack_t *s = ctx;
+
+	if ((key & s->mask) != s->key)
+		return;
+	for (int i = 0; i < s->npairs; i++)
+		if (hitag2_authenticator(key, s->pairs[i].uid, s->pairs[i].nR) != s->pairs[i].aR)
+			return;
+
+	pthread_mutex_lock(&s->lock);
+	if (s->found < s->maxkeys)
+		s->keys[s->found] = key;
+	s->found++;
+	pthread_mutex_unlock(&s->lock);
+}
+
+static void *ht2_crack_thread(void *arg) {
+	ht2_crack_t *s = arg;
+	hitag2_bs_job_t job = {
+		.uid = s->pairs[0].uid,
+		.nR = s->pairs[0].nR,
+		.ks = ~s->pairs[0].aR,
+		.fixed = s->jobfixed
+	};
+
+	for (;;) {
+		pthread_mutex_lock(&s->lock);
+		uint64_t j = s->next;
+		if (j < s->jobs && !s->stop)
+			s->next++;
+		pthread_mutex_unlock(&s->lock);
+		if (j >= s->jobs || s->stop)
+			break;
+
+		job.key = s->key | (j << (48 - s->jobfixed));
+		uint64_t tried = s->core->search(&job, ht2_crack_hit, s, &s->stop);
+
+		pthread_mutex_lock(&s->lock);
+		s->tried += tried;
+		s->done++;
+		pthread_mutex_unlock(&s->lock);
+	}
+	return NULL;
+}
+
+int hitag2_crack(const hitag2_nrar_t *pairs, int npairs, uint64_t key, int fixed, const hitag2_crack_opts_t *opts,
+                 uint64_t *keys, int maxkeys, hitag2_crack_stats_t *stats) {
+	ht2_crack_t s;
+	memset(&s, 0, sizeof(s));
+
+	if (npairs < 1 || fixed < 0 || fixed > 48)
+		return -1;
+	for (int i = 1; i < npairs; i++)
+		if (pairs[i].uid != pairs[0].uid)
+			return -1;
+
+	s.core = (opts && opts->core) ? opts->core : hitag2_bs_get_core();
+	s.pairs = pairs;
+	s.npairs = npairs;
+	s.mask = HITAG2_KEY_MASK & ~((1ULL << (48 - fixed)) - 1);
+	s.key = key & s.mask;
+	s.keys = keys;
+	s.maxkeys = maxkeys;
+
+	// the cores take at most 48 - lanebits given bits,  the hits are filtered on the rest
+	int searchfixed = fixed;
+	if (searchfixed > 48 - s.core->lanebits)
+		searchfixed = 48 - s.core->lanebits;
+	s.jobfixed = searchfixed;
+	if (48 - s.jobfixed > HT2_JOB_BITS)
+		s.jobfixed = 48 - HT2_JOB_BITS;
+	if (s.jobfixed > 48 - s.core->lanebits)
+		s.jobfixed = 48 - s.core->lanebits;
+	// job numbers go in below the given bits
+	s.jobs = 1ULL << (s.jobfixed - searchfixed);
+
+	int nthreads = (opts && opts->threads > 0) ? opts->threads : num_CPUs();
+	if ((uint64_t)nthreads > s.jobs)
+		nthreads = s.jobs;
+	bool verbose = opts && opts->verbose;
+
+	pthread_mutex_init(&s.lock, NULL);
+	pthread_t *threads = calloc(nthreads, sizeof(pthread_t));
+	if (!threads) {
+		pthread_mutex_destroy(&s.lock);
+		return -1;
+	}
+
+	uint64_t start = msclock();
+	for (int i = 0; i < nthreads; i++)
+		pthread_create(&threads[i], NULL, ht2_crack_thread, &s);
+
+	if (verbose) {
+		uint64_t last = start;
+		for (;;) {
+			msleep(10);
+			pthread_mutex_lock(&s.lock);
+			uint64_t done = s.done, tried = s.tried;
+			int found = s.found;
+			pthread_mutex_unlock(&s.lock);
+			if (done == s.jobs)
+				break;
+			if (ukbhit() > 0) {
+				int gc = getchar(); (void)gc;
+				PrintAndLogEx(WARNING, "\naborted via keyboard!");
+				s.stop = true;
+				break;
+			}
+			uint64_t now = msclock();
+			if (now - last >= HT2_PROGRESS_MS && now > start) {
+				double rate = (double)tried * 1000.0 / (now - start);
+				double left = ((double)(s.jobs - done) / s.jobs) * (double)(1ULL << (48 - searchfixed));
+				PrintAndLogEx(NORMAL, "%5.1f%%  %7.1f Mkeys/s  %d key(s)  about %.0f s to go",
+					100.0 * done / s.jobs, rate / 1e6, found, rate > 0 ? left / rate : 0);
+				last = now;
+			}
+		}
+	}
+
+	for (int i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&s.lock);
+
+	if (stats) {
+		stats->tried = s.tried;
+		stats->msecs = msclock() - start;
+		stats->found = s.found;
+		stats->aborted = s.stop;
+	}
+	return s.found < maxkeys ? s.found : maxkeys;
+}
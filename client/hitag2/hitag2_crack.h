@@ -0,0 +1,54 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Hitag2 key recovery from reader authentications (UID, nR, aR),  a threaded
+// search over the bitsliced cores in hitag2_bs_core.c
+//-----------------------------------------------------------------------------
+
+#ifndef HITAG2_CRACK_H__
+#define HITAG2_CRACK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hitag2_bs_core.h"
+
+typedef struct {
+	uint32_t uid;
+	uint32_t nR;
+	uint32_t aR;
+} hitag2_nrar_t;
+
+typedef struct {
+	const hitag2_bs_core_t *core;	// NULL for the fastest
+	int threads;			// <= 0 for one per CPU
+	bool verbose;			// progress every few seconds,  a key press aborts
+} hitag2_crack_opts_t;
+
+typedef struct {
+	uint64_t tried;			// keys through the cipher
+	uint64_t msecs;
+	int found;			// keys matching every pair,  may be more than were stored
+	bool aborted;
+} hitag2_crack_stats_t;
+
+// Picks out the reader answers to a tag UID: a 32 bit tag frame followed by a
+// 64 bit reader frame.  Feed the frames in order,  returns true on a new pair
+typedef struct {
+	bool have_uid;
+	uint32_t uid;
+} hitag2_nrar_parser_t;
+
+bool hitag2_nrar_frame(hitag2_nrar_parser_t *p, bool isResponse, int bits, const uint8_t *frame, hitag2_nrar_t *out);
+// BigBuf trace as downloaded by 'lf hitag list' / the file it writes.  Return the number of pairs
+int hitag2_nrar_from_trace(const uint8_t *trace, size_t len, hitag2_nrar_t *pairs, int max);
+int hitag2_nrar_from_list(const char *filename, hitag2_nrar_t *pairs, int max);
+
+// Every key with the first 'fixed' bits (from the msb) of key that fits all pairs.
+// All pairs must have the same UID,  two are usually enough for a single key
+int hitag2_crack(const hitag2_nrar_t *pairs, int npairs, uint64_t key, int fixed, const hitag2_crack_opts_t *opts,
+                 uint64_t *keys, int maxkeys, hitag2_crack_stats_t *stats);
+
+#endif
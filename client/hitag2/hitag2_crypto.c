@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Hitag2 cipher for the client.
+//
+// Based on the software optimized Hitag2 by I.C. Wiener 2006-2007
+// (cryptolib.com/ciphers/hitag2/),  released into the public domain by its
+// author,  like the copy in armsrc/hitag2.c.  There the 48 bit state holds
+// the bits in the order they are sent,  the first one in bit 0.
+//-----------------------------------------------------------------------------
+
+#include "hitag2_crypto.h"
+
+#define i4(x,a,b,c,d)	((uint32_t)((((x)>>(a))&1)+(((x)>>(b))&1)*2+(((x)>>(c))&1)*4+(((x)>>(d))&1)*8))
+
+static const uint32_t ht2_f4a = 0x2C79;		// 0010 1100 0111 1001
+static const uint32_t ht2_f4b = 0x6671;		// 0110 0110 0111 0001
+static const uint32_t ht2_f5c = 0x7907287B;	// 0111 1001 0000 0111 0010 1000 0111 1011
+
+static uint32_t f20(const uint64_t x) {
+	uint32_t i5;
+
+	i5 = ((ht2_f4a >> i4(x, 1, 2, 4, 5)) & 1) * 1
+	   + ((ht2_f4b >> i4(x, 7,11,13,14)) & 1) * 2
+	   + ((ht2_f4b >> i4(x,16,20,22,25)) & 1) * 4
+	   + ((ht2_f4b >> i4(x,27,28,30,32)) & 1) * 8
+	   + ((ht2_f4a >> i4(x,33,42,43,45)) & 1) * 16;
+
+	return (ht2_f5c >> i5) & 1;
+}
+
+// first bit sent to bit 0
+static uint64_t air_to_state(uint64_t v, int bits) {
+	uint64_t r = 0;
+	for (int i = 0; i < bits; i++)
+		r |= ((v >> (bits - 1 - i)) & 1) << i;
+	return r;
+}
+
+uint64_t hitag2_init(uint64_t key, uint32_t uid, uint32_t nR) {
+	uint64_t k = air_to_state(key & HITAG2_KEY_MASK, 48);
+	uint64_t iv = air_to_state(nR, 32);
+	uint64_t x = ((k & 0xFFFF) << 32) + air_to_state(uid, 32);
+
+	for (int i = 0; i < 32; i++) {
+		x >>= 1;
+		x += (uint64_t)(f20(x) ^ (((iv >> i) ^ (k >> (i + 16))) & 1)) << 47;
+	}
+	return x;
+}
+
+uint32_t hitag2_bit(uint64_t *state) {
+	uint64_t x = *state;
+
+	x = (x >>  1) +
+	 ((((x >>  0) ^ (x >>  2) ^ (x >>  3) ^ (x >>  6)
+	  ^ (x >>  7) ^ (x >>  8) ^ (x >> 16) ^ (x >> 22)
+	  ^ (x >> 23) ^ (x >> 26) ^ (x >> 30) ^ (x >> 41)
+	  ^ (x >> 42) ^ (x >> 43) ^ (x >> 46) ^ (x >> 47)) & 1) << 47);
+
+	*state = x;
+	return f20(x);
+}
+
+uint32_t hitag2_bits(uint64_t *state, int n) {
+	uint32_t r = 0;
+	while (n--)
+		r = (r << 1) | hitag2_bit(state);
+	return r;
+}
+
+uint32_t hitag2_authenticator(uint64_t key, uint32_t uid, uint32_t nR) {
+	uint64_t state = hitag2_init(key, uid, nR);
+	return ~hitag2_bits(&state, 32);
+}
+
+void hitag2_crypt(uint64_t *state, uint8_t *data, size_t bits) {
+	for (size_t i = 0; i < bits; i++)
+		data[i / 8] ^= hitag2_bit(state) << (7 - (i % 8));
+}
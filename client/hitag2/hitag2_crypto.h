@@ -0,0 +1,30 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Hitag2 cipher for the client,  same cipher as armsrc/hitag2.c.
+// Keys, UIDs and nonces are numbers written the way they go over the air:
+// the first byte sent is the most significant,  e.g. key 4F4E4D494B52 is
+// the tag memory bytes 4F 4E 4D 49 4B 52.
+//-----------------------------------------------------------------------------
+
+#ifndef HITAG2_CRYPTO_H__
+#define HITAG2_CRYPTO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HITAG2_KEY_MASK		0xFFFFFFFFFFFFULL
+
+// cipher state after the reader nonce nR (as sent,  encrypted) went in
+uint64_t hitag2_init(uint64_t key, uint32_t uid, uint32_t nR);
+// next keystream bit / the next n <= 32 bits,  first one is the msb
+uint32_t hitag2_bit(uint64_t *state);
+uint32_t hitag2_bits(uint64_t *state, int n);
+// the reader answer aR,  the inverted first 32 keystream bits
+uint32_t hitag2_authenticator(uint64_t key, uint32_t uid, uint32_t nR);
+// xor the keystream over a frame,  bits counted from the msb of data[0]
+void hitag2_crypt(uint64_t *state, uint8_t *data, size_t bits);
+
+#endif
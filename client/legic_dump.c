@@ -0,0 +1,96 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Offline LEGIC Prime dump checks,  MCC and segment header crcs
+//
+// Same decoding as CmdLegicInfo(),  without the printing.  A segment header is
+// 5 bytes xored with the MCC:  len lo, flag | len hi, wrp, wrc, crc.  The length
+// counts the header,  the crc is CRC8Legic over the uid and the 4 plain bytes.
+//-----------------------------------------------------------------------------
+
+#include "legic_dump.h"
+
+#include <string.h>
+#include "crc.h"
+
+#define LEGIC_DUMP_SEGSTART		22
+#define LEGIC_DUMP_MAXSEG		127
+
+static legic_dump_type_t legic_dump_type(const uint8_t *data, size_t len) {
+	if (len < 9)
+		return LEGIC_DUMP_IM;
+
+	uint16_t dcf = (data[6] << 8) | data[5];
+	if (dcf == 0xFFFF)
+		return LEGIC_DUMP_NM;
+	if (dcf > 60000)
+		return LEGIC_DUMP_MASTER;
+	if (data[7] == 0x9F && data[8] == 0xFF)
+		return LEGIC_DUMP_IMS;
+	return LEGIC_DUMP_IM;
+}
+
+bool legic_dump_check(uint8_t *data, size_t len, bool deobfuscate, legic_dump_info_t *info) {
+	memset(info, 0, sizeof(legic_dump_info_t));
+
+	if (len < 5) {
+		info->truncated = true;
+		return false;
+	}
+
+	uint8_t mcc = data[4];
+	info->mcc = mcc;
+	info->mcc_ok = (CRC8Legic(data, 4) == mcc);
+	info->type = legic_dump_type(data, len);
+	info->end = (len < LEGIC_DUMP_SEGSTART) ? len : LEGIC_DUMP_SEGSTART;
+
+	// MIM22 has no room for segments
+	if (info->type != LEGIC_DUMP_IMS || len <= LEGIC_DUMP_SEGSTART)
+		return info->mcc_ok;
+
+	// uid, then the plain header
+	uint8_t crcbytes[8];
+	memcpy(crcbytes, data, 4);
+
+	size_t i = LEGIC_DUMP_SEGSTART;
+	bool last = false;
+	while (!last && info->segments < LEGIC_DUMP_MAXSEG) {
+		if (i + 5 > len)
+			break;
+
+		for (int j = 0; j < 4; j++)
+			crcbytes[4 + j] = data[i + j] ^ mcc;
+
+		uint16_t seglen = ((crcbytes[5] & 0x0F) << 8) | crcbytes[4];
+		last = (crcbytes[5] >> 4) & 0x8;
+
+		info->segments++;
+		if (CRC8Legic(crcbytes, 8) == (uint8_t)(data[i + 4] ^ mcc))
+			info->segments_ok++;
+
+		if (seglen < 5 || i + seglen > len) {
+			last = false;
+			break;
+		}
+
+		if (deobfuscate)
+			for (size_t k = i; k < i + seglen; k++)
+				data[k] ^= mcc;
+
+		i += seglen;
+	}
+
+	info->end = i;
+	info->truncated = !last;
+	return info->mcc_ok && info->segments_ok == info->segments && !info->truncated;
+}
+
+size_t legic_dump_check_batch(uint8_t *dumps, size_t dumplen, size_t n, bool deobfuscate, legic_dump_info_t *infos) {
+	size_t good = 0;
+	for (size_t i = 0; i < n; i++)
+		if (legic_dump_check(dumps + i * dumplen, dumplen, deobfuscate, &infos[i]))
+			good++;
+	return good;
+}
@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Offline LEGIC Prime dump checks,  MCC and segment header crcs
+//-----------------------------------------------------------------------------
+
+#ifndef LEGIC_DUMP_H__
+#define LEGIC_DUMP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LEGIC_DUMP_MAXSIZE		1024	// MIM1024
+
+typedef enum {
+	LEGIC_DUMP_NM = 0,		// new media
+	LEGIC_DUMP_MASTER,		// IAM, SAM, GAM, XAM
+	LEGIC_DUMP_IM,
+	LEGIC_DUMP_IMS,			// segmented
+} legic_dump_type_t;
+
+typedef struct {
+	legic_dump_type_t type;
+	uint8_t mcc;
+	bool mcc_ok;
+	uint16_t segments;		// headers seen
+	uint16_t segments_ok;	// headers with good crc
+	uint16_t end;			// first byte after the last segment
+	bool truncated;			// a segment runs past the dump,  or no last segment
+} legic_dump_info_t;
+
+// checks one dump.  With deobfuscate the segments are xored with the MCC in place,
+// the result looks like the `hf legic info` output.  Returns true if all crcs are good.
+extern bool legic_dump_check(uint8_t *data, size_t len, bool deobfuscate, legic_dump_info_t *info);
+
+// n dumps of dumplen bytes back to back,  one info each.  Returns the number of good dumps.
+extern size_t legic_dump_check_batch(uint8_t *dumps, size_t dumplen, size_t n, bool deobfuscate, legic_dump_info_t *infos);
+
+#endif
@@ -0,0 +1,334 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample compression test and benchmark,  see lfcompresstest.h
+//-----------------------------------------------------------------------------
+
+// this define is needed for scandir/alphasort to work
+#define _GNU_SOURCE
+#include "lfcompresstest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "scandir.h"
+#include "lfcompress.h"
+#include "util.h"
+#include "util_posix.h"			// msclock
+#include "ui.h"
+
+size_t lfcompress_load(const char *filename, uint8_t **samples) {
+	*samples = NULL;
+	FILE *f = fopen(filename, "r");
+	if (f == NULL)
+		return 0;
+
+	size_t n = 0, size = 4096;
+	uint8_t *buf = malloc(size);
+	char line[80];
+	while (buf && fgets(line, sizeof(line), f)) {
+		if (n == size) {
+			uint8_t *tmp = realloc(buf, size * 2);
+			if (tmp == NULL) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = tmp;
+			size *= 2;
+		}
+		// some traces were saved after a filter,  clamp them to the ADC range
+		int v = atoi(line);
+		if (v < -128) v = -128;
+		if (v > 127) v = 127;
+		buf[n++] = v + 128;
+	}
+	fclose(f);
+	if (buf == NULL || n == 0) {
+		free(buf);
+		return 0;
+	}
+	*samples = buf;
+	return n;
+}
+
+// the stored values,  as DoAcquisition gives them to the encoder
+static void lfc_quantize(const uint8_t *in, uint8_t *out, size_t len, uint8_t bps) {
+	for (size_t i = 0; i < len; i++)
+		out[i] = in[i] >> (8 - bps);
+}
+
+// encodes len samples into buf,  returns the stream length,  *coded the samples in it
+static uint32_t lfc_encode(const uint8_t *in, size_t len, uint8_t *buf, uint32_t size, uint32_t *coded) {
+	lfcompress_t c;
+	lfcompress_init(&c, buf, size);
+	for (size_t i = 0; i < len; i++) {
+		if (!lfcompress_push(&c, in[i]))
+			break;
+	}
+	*coded = c.samples;
+	return lfcompress_finish(&c);
+}
+
+// Round trip of the samples into a size byte buffer.  The stream has to fit,
+// the decoded samples are the first ones coded and no more.
+static bool lfc_roundtrip(const uint8_t *in, size_t len, uint32_t size, bool verbose, const char *desc) {
+	uint8_t *buf = calloc(size, 1);
+	uint8_t *out = calloc(len + 1, 1);
+	bool ok = false;
+	if (buf == NULL || out == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the test");
+		goto out;
+	}
+
+	uint32_t coded;
+	uint32_t blen = lfc_encode(in, len, buf, size, &coded);
+	size_t n = lfcompress_decode(buf, blen, out, len + 1);
+	if (blen > size) {
+		if (verbose) PrintAndLogEx(WARNING, "%s: stream of %u bytes in a %u byte buffer", desc, blen, size);
+	} else if (coded < len && size >= LFC_PUSH_ROOM + 2 && blen + LFC_PUSH_ROOM + 2 <= size && coded < LFC_MAX_SAMPLES) {
+		if (verbose) PrintAndLogEx(WARNING, "%s: stopped at %u of %u samples,  %u of %u bytes", desc, coded, (uint32_t)len, blen, size);
+	} else if (n != coded) {
+		if (verbose) PrintAndLogEx(WARNING, "%s: %u samples decoded,  %u coded", desc, (uint32_t)n, coded);
+	} else if (memcmp(in, out, n)) {
+		size_t i = 0;
+		while (in[i] == out[i]) i++;
+		if (verbose) PrintAndLogEx(WARNING, "%s: sample %u is %02x,  not %02x", desc, (uint32_t)i, out[i], in[i]);
+	} else {
+		ok = true;
+	}
+
+	// a shorter max stops the decoder right there
+	if (ok && n > 1 && lfcompress_decode(buf, blen, out, n / 2) != n / 2) {
+		if (verbose) PrintAndLogEx(WARNING, "%s: decoding %u samples went past them", desc, (uint32_t)(n / 2));
+		ok = false;
+	}
+out:
+	free(buf);
+	free(out);
+	return ok;
+}
+
+// runs,  pairs,  deltas and literals around every token limit
+static size_t lfc_synthetic(uint8_t *s, size_t size, int kind, uint8_t bps, uint32_t seed) {
+	uint8_t mask = (1 << bps) - 1;
+	uint32_t lfsr = seed * 2654435761u + 1;
+	size_t n = 0;
+	uint8_t v = 0;
+
+	while (n < size) {
+		lfsr = lfsr * 1103515245 + 12345;
+		uint32_t r = lfsr >> 8;
+		switch (kind) {
+			case 0: {
+				// runs of every length around LFC_RUN_MAX
+				uint32_t len = 1 + (r % (3 * LFC_RUN_MAX));
+				v = (v + 1 + (r >> 12) % 200) & mask;
+				while (len-- && n < size)
+					s[n++] = v;
+				continue;
+			}
+			case 1:
+				// deltas around the pair range
+				v = (v + (int)(r % 11) - 5) & mask;
+				break;
+			case 2:
+				// deltas around the single and literal range
+				v = (v + (int)(r % 133) - 66) & mask;
+				break;
+			case 3:
+				// everything
+				v = r & mask;
+				break;
+			default: {
+				// an ASK like square wave with a noisy edge,  as the tags give it
+				int level = ((n / 32) & 1) ? 220 : 30;
+				int noise = (int)(r % 7) - 3;
+				if ((r >> 16) & 1) noise = 0;
+				v = ((uint8_t)(level + noise)) >> (8 - bps);
+				break;
+			}
+		}
+		s[n++] = v;
+	}
+	return n;
+}
+
+static bool lfc_is_pm3(const char *name) {
+	size_t len = strlen(name);
+	return len > 4 && strcmp(name + len - 4, ".pm3") == 0;
+}
+
+int lfcompress_test(const char *dir, bool verbose) {
+	static const uint8_t bpss[] = {8, 6, 4, 2, 1};
+	const size_t len = 20000;
+	int failed = 0;
+
+	uint8_t *s = malloc(LFC_MAX_SAMPLES + 100);
+	if (s == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the test");
+		return 1;
+	}
+
+	PrintAndLogEx(NORMAL, "LF sample compression test");
+
+	// synthetic streams,  at every bits per sample and buffer sizes down to a byte
+	uint32_t runs = 0, bad = 0;
+	char desc[FILE_PATH_SIZE + 32];
+	for (size_t b = 0; b < sizeof(bpss); b++) {
+		for (int kind = 0; kind < 5; kind++) {
+			for (uint32_t seed = 1; seed <= 8; seed++) {
+				size_t n = lfc_synthetic(s, len, kind, bpss[b], seed);
+				snprintf(desc, sizeof(desc), "stream %d seed %u at %u bps", kind, seed, bpss[b]);
+				runs++;
+				if (!lfc_roundtrip(s, n, n * 2 + 8, verbose, desc)) bad++;
+				for (uint32_t size = 1; size < 80; size += 1 + (seed & 1)) {
+					runs++;
+					if (!lfc_roundtrip(s, n, size, verbose, desc)) bad++;
+				}
+			}
+		}
+	}
+	PrintAndLogEx(NORMAL, "  synthetic streams............%u / %u  %s", runs - bad, runs, (bad) ? _RED_(fail) : _GREEN_(ok));
+	if (bad) failed++;
+
+	// no more than the graph buffer takes
+	memset(s, 0x55, LFC_MAX_SAMPLES + 100);
+	{
+		uint8_t buf[40000];
+		uint32_t coded;
+		lfc_encode(s, LFC_MAX_SAMPLES + 100, buf, sizeof(buf), &coded);
+		bool ok = (coded == LFC_MAX_SAMPLES) && lfc_roundtrip(s, LFC_MAX_SAMPLES, sizeof(buf), verbose, "max samples");
+		PrintAndLogEx(NORMAL, "  max samples..................%u  %s", coded, (ok) ? _GREEN_(ok) : _RED_(fail));
+		if (!ok) failed++;
+	}
+
+	// every trace at every bits per sample,  into BigBuf and a quarter of it
+	if (dir) {
+		struct dirent **namelist;
+		int n = scandir(dir, &namelist, NULL, alphasort);
+		if (n < 0) {
+			PrintAndLogEx(WARNING, "  couldn't open %s", dir);
+			failed++;
+		} else {
+			uint32_t files = 0;
+			runs = bad = 0;
+			for (int i = 0; i < n; i++) {
+				if (lfc_is_pm3(namelist[i]->d_name)) {
+					char path[FILE_PATH_SIZE];
+					snprintf(path, sizeof(path), "%s%s", dir, namelist[i]->d_name);
+					uint8_t *samples;
+					size_t slen = lfcompress_load(path, &samples);
+					if (slen) {
+						files++;
+						for (size_t b = 0; b < sizeof(bpss); b++) {
+							lfc_quantize(samples, s, slen, bpss[b]);
+							snprintf(desc, sizeof(desc), "%s at %u bps", namelist[i]->d_name, bpss[b]);
+							runs += 2;
+							if (!lfc_roundtrip(s, slen, 40000, verbose, desc)) bad++;
+							if (!lfc_roundtrip(s, slen, 10000, verbose, desc)) bad++;
+						}
+						free(samples);
+					}
+				}
+				free(namelist[i]);
+			}
+			free(namelist);
+			PrintAndLogEx(NORMAL, "  traces.......................%u files,  %u / %u  %s", files, runs - bad, runs, (bad || !files) ? _RED_(fail) : _GREEN_(ok));
+			if (bad || !files) failed++;
+		}
+	}
+
+	free(s);
+	PrintAndLogEx((failed) ? WARNING : SUCCESS, "Tests %s", (failed) ? _RED_(failed) : _GREEN_(passed));
+	return failed;
+}
+
+// one trace,  returns the sample count,  0 when it could not be loaded
+static size_t lfc_bench_file(const char *path, const char *name, uint8_t bps, uint32_t rounds, uint64_t *total, uint64_t *total_packed, uint64_t *total_coded) {
+	uint8_t *samples;
+	size_t len = lfcompress_load(path, &samples);
+	if (len == 0)
+		return 0;
+
+	uint8_t *buf = malloc(len * 2 + 8);
+	uint8_t *out = malloc(len);
+	if (buf == NULL || out == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the bench");
+		free(samples); free(buf); free(out);
+		return 0;
+	}
+	lfc_quantize(samples, samples, len, bps);
+
+	uint32_t coded, blen = 0;
+	uint64_t tenc = msclock();
+	for (uint32_t r = 0; r < rounds; r++)
+		blen = lfc_encode(samples, len, buf, len * 2 + 8, &coded);
+	tenc = msclock() - tenc;
+
+	size_t n = 0;
+	uint64_t tdec = msclock();
+	for (uint32_t r = 0; r < rounds; r++)
+		n = lfcompress_decode(buf, blen, out, len);
+	tdec = msclock() - tdec;
+
+	bool ok = (n == len) && (memcmp(samples, out, len) == 0);
+	uint32_t packed = (len * bps + 7) / 8;
+	double calls = (double)len * rounds;
+	PrintAndLogEx(NORMAL, "%-36s | %7u | %6u | %6u | %5.2f | %8.2f | %8.2f | %s",
+		name, (uint32_t)len, packed, blen, (double)packed / blen,
+		tenc * 1e6 / calls, tdec * 1e6 / calls, (ok) ? _GREEN_(ok) : _RED_(fail));
+
+	*total += len;
+	*total_packed += packed;
+	*total_coded += blen;
+	free(samples);
+	free(buf);
+	free(out);
+	return (ok) ? len : 0;
+}
+
+int lfcompress_bench(const char *dir, const char *filename, uint8_t bps, uint32_t rounds) {
+	uint64_t total = 0, total_packed = 0, total_coded = 0;
+	int failed = 0;
+
+	PrintAndLogEx(NORMAL, "LF sample compression at %u bits per sample,  %u rounds", bps, rounds);
+	PrintAndLogEx(NORMAL, "packed is the size without compression,  as the bits per sample pack into BigBuf");
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "%-36s | samples | packed |  coded | ratio | enc ns/s | dec ns/s | result", "trace");
+	PrintAndLogEx(NORMAL, "-------------------------------------+---------+--------+--------+-------+----------+----------+-------");
+
+	if (filename) {
+		const char *name = strrchr(filename, '/');
+		if (lfc_bench_file(filename, (name) ? name + 1 : filename, bps, rounds, &total, &total_packed, &total_coded) == 0)
+			failed++;
+	} else {
+		struct dirent **namelist;
+		int n = scandir(dir, &namelist, NULL, alphasort);
+		if (n < 0) {
+			PrintAndLogEx(FAILED, "couldn't open %s", dir);
+			return 1;
+		}
+		for (int i = 0; i < n; i++) {
+			if (lfc_is_pm3(namelist[i]->d_name)) {
+				char path[FILE_PATH_SIZE];
+				snprintf(path, sizeof(path), "%s%s", dir, namelist[i]->d_name);
+				if (lfc_bench_file(path, namelist[i]->d_name, bps, rounds, &total, &total_packed, &total_coded) == 0)
+					failed++;
+			}
+			free(namelist[i]);
+		}
+		free(namelist);
+	}
+
+	if (total_coded) {
+		PrintAndLogEx(NORMAL, "-------------------------------------+---------+--------+--------+-------+----------+----------+-------");
+		PrintAndLogEx(NORMAL, "%-36s | %7" PRIu64 " | %6" PRIu64 " | %6" PRIu64 " | %5.2f |", "all", total, total_packed, total_coded, (double)total_packed / total_coded);
+		PrintAndLogEx(NORMAL, "");
+		PrintAndLogEx(NORMAL, "BigBuf holds about %" PRIu64 " samples of the like compressed,  %u packed", 40000 * total / total_coded, 40000 * 8 / bps);
+	}
+	return failed;
+}
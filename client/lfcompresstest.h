@@ -0,0 +1,28 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample compression test and benchmark,  the DoAcquisition encoder on
+// recorded .pm3 traces
+//-----------------------------------------------------------------------------
+
+#ifndef LFCOMPRESSTEST_H__
+#define LFCOMPRESSTEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Loads a .pm3 trace,  one sample a line,  -128..127,  as the device samples
+// 0..255.  Returns the samples,  0 on errors.  Free *samples.
+extern size_t lfcompress_load(const char *filename, uint8_t **samples);
+
+// the synthetic streams and every .pm3 file in dir at all bits per sample,
+// NULL skips the files
+extern int lfcompress_test(const char *dir, bool verbose);
+// compression ratio and encode / decode cost per sample of the .pm3 files in
+// dir,  or of filename,  at bits per sample
+extern int lfcompress_bench(const char *dir, const char *filename, uint8_t bps, uint32_t rounds);
+
+#endif
@@ -0,0 +1,447 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample preprocessing filters on GraphBuffer style int arrays.
+//
+// A filter chain is split in passes at each filter needing whole trace
+// statistics (hpf needs the mean, norm needs min/max).  Within a pass all
+// filters run block by block while the block is still in cache, and the
+// statistics for the next pass are collected from the blocks as they come out.
+// So a chain costs 1 + number of hpf/norm passes instead of 1-2 passes per filter.
+//
+// The hold of the threshold filters is a serial scan,  it is done with masks
+// instead of a branch since the branch mispredicts on noisy samples.
+//
+// Filters are in place.  Each stage keeps its carry between blocks and reports
+// how many leading samples are final,  askedgedetect writes one sample behind
+// its input and dirthreshold only finalizes sample 0 after sample 1.
+//
+// askedgedetect on its own is already a single pass,  the classify and hold
+// stages of the chain only slow it down,  so it keeps the plain loop.
+//-----------------------------------------------------------------------------
+
+#include "lffilter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <inttypes.h>
+#include "lffilter_core.h"
+#include "ui.h"
+#include "util.h"
+#include "util_posix.h"
+
+#define LFF_BLOCK        4096
+#define LFF_STATS_SKIP   10     // hpf and norm ignore the first samples for their statistics
+#define LFF_LOWPASS_DEF  4
+
+typedef struct {
+	int64_t sum;
+	int min;
+	int max;
+} lff_stats_t;
+
+typedef struct {
+	lffilter_op_t op;
+	bool active;
+	size_t done;   // input samples consumed
+	size_t out;    // leading samples final
+	int carry;     // previous input sample (dirthreshold, edge) or filter register (lowpass)
+	int hold;      // last output (dirthreshold, edge) or filter shift (lowpass)
+	int mean;
+	int mid;
+	int range;
+} lff_stage_t;
+
+static bool lff_global(uint8_t type) {
+	return (type == LFF_HPF || type == LFF_NORM);
+}
+
+static void lff_stats_add(const lffilter_kernels_t *k, lff_stats_t *st, const int *data, size_t from, size_t to) {
+	if (from < LFF_STATS_SKIP) from = LFF_STATS_SKIP;
+	if (to <= from) return;
+	st->sum += k->sum(data + from, to - from);
+	k->minmax(data + from, to - from, &st->min, &st->max);
+}
+
+static void lff_stage_setup(lff_stage_t *s, const lffilter_op_t *op, const lff_stats_t *st, size_t len) {
+	memset(s, 0, sizeof(lff_stage_t));
+	s->op = *op;
+	s->active = true;
+
+	switch (op->type) {
+		case LFF_HPF:
+			if (len <= LFF_STATS_SKIP)
+				s->active = false;
+			else
+				s->mean = (int)(st->sum / (int64_t)(len - LFF_STATS_SKIP));
+			break;
+		case LFF_NORM:
+			if (len <= LFF_STATS_SKIP || st->max == st->min) {
+				s->active = false;
+			} else {
+				s->mid = (st->max + st->min) / 2;
+				s->range = st->max - st->min;
+			}
+			break;
+		case LFF_DIRTHRESHOLD:
+		case LFF_EDGE:
+			if (len < 2) s->active = false;
+			break;
+		case LFF_LOWPASS:
+			s->hold = (op->a >= 0 && op->a <= 8) ? op->a : LFF_LOWPASS_DEF;
+			break;
+		default:
+			s->active = false;
+			break;
+	}
+}
+
+// consume input samples up to ready,  returns number of leading samples which are final
+static size_t lff_stage_process(const lffilter_kernels_t *k, lff_stage_t *s, int *data, size_t ready, size_t len, int8_t *code) {
+
+	if (!s->active) {
+		s->done = s->out = ready;
+		return ready;
+	}
+
+	size_t from = s->done;
+
+	switch (s->op.type) {
+		case LFF_HPF:
+			k->sub(data + from, ready - from, s->mean);
+			s->out = ready;
+			break;
+		case LFF_NORM:
+			k->norm(data + from, ready - from, s->mid, s->range);
+			s->out = ready;
+			break;
+		case LFF_LOWPASS: {
+			int32_t filter_reg = s->carry;
+			int16_t input, output;
+			for (size_t i = from; i < ready; i++) {
+				input = data[i];
+				filter_reg = filter_reg - (filter_reg >> s->hold) + input;
+				output = filter_reg >> s->hold;
+				data[i] = output;
+			}
+			s->carry = filter_reg;
+			s->out = ready;
+			break;
+		}
+		case LFF_DIRTHRESHOLD: {
+			if (from == 0) {
+				if (ready == 0) break;
+				s->carry = data[0];
+				s->hold = 0;
+				from = 1;
+			}
+			if (ready > from) {
+				size_t n = ready - from;
+				k->dir_classify(data + from, code, n, s->carry, s->op.a, s->op.b);
+				s->carry = data[ready - 1];
+				int hold = s->hold;
+				for (size_t j = 0; j < n; j++) {
+					int c = code[j], m = -(c != 0);
+					hold = (c & m) | (hold & ~m);
+					data[from + j] = hold;
+				}
+				s->hold = hold;
+				// align with first edited sample
+				if (from == 1)
+					data[0] = data[1];
+			}
+			s->out = (ready >= 2) ? ready : 0;
+			break;
+		}
+		case LFF_EDGE: {
+			if (from == 0) {
+				if (ready == 0) break;
+				s->carry = data[0];
+				s->hold = 0;
+				from = 1;
+			}
+			if (ready > from) {
+				size_t n = ready - from;
+				k->edge_classify(data + from, code, n, s->carry, s->op.a);
+				s->carry = data[ready - 1];
+				int hold = s->hold;
+				for (size_t j = 0; j < n; j++) {
+					int c = code[j] * 127, m = -(c != 0);
+					hold = (c & m) | (hold & ~m);
+					data[from + j - 1] = hold;
+				}
+				s->hold = hold;
+			}
+			// the last sample is left as is
+			s->out = (ready == len) ? len : ready - 1;
+			break;
+		}
+	}
+	s->done = (ready > from) ? ready : from;
+	return s->out;
+}
+
+static void lff_edge_single(int *data, size_t len, int threshold) {
+	int last = 0;
+	for (size_t i = 1; i < len; i++) {
+		int d = data[i] - data[i-1];
+		if (d >= threshold)
+			last = 127;
+		else if (d <= -threshold)
+			last = -127;
+		data[i-1] = last;
+	}
+}
+
+int lffilter_run(int *data, size_t len, const lffilter_op_t *ops, size_t nops) {
+
+	if (nops > LFF_MAX_CHAIN) return -1;
+	if (data == NULL || len == 0 || nops == 0) return 0;
+
+	if (nops == 1 && ops[0].type == LFF_EDGE) {
+		lff_edge_single(data, len, ops[0].a);
+		return 0;
+	}
+
+	const lffilter_kernels_t *k = lffilter_get_kernels();
+
+	int8_t *code = calloc(LFF_BLOCK + LFF_MAX_CHAIN + 1, sizeof(int8_t));
+	if (!code) return -1;
+
+	lff_stage_t stages[LFF_MAX_CHAIN];
+	lff_stats_t st = { 0, INT_MAX, INT_MIN };
+
+	if (lff_global(ops[0].type))
+		lff_stats_add(k, &st, data, 0, len);
+
+	size_t i = 0;
+	while (i < nops) {
+		// this pass runs up to the next filter needing statistics
+		size_t j = i + 1;
+		while (j < nops && !lff_global(ops[j].type))
+			j++;
+
+		for (size_t m = i; m < j; m++)
+			lff_stage_setup(&stages[m - i], &ops[m], &st, len);
+
+		bool collect = (j < nops);
+		lff_stats_t next = { 0, INT_MAX, INT_MIN };
+		size_t collected = 0;
+
+		for (size_t pos = 0; pos < len; ) {
+			size_t end = MIN(pos + LFF_BLOCK, len);
+			size_t ready = end;
+			for (size_t m = i; m < j; m++)
+				ready = lff_stage_process(k, &stages[m - i], data, ready, len, code);
+
+			if (collect) {
+				lff_stats_add(k, &next, data, collected, ready);
+				collected = ready;
+			}
+			pos = end;
+		}
+		st = next;
+		i = j;
+	}
+
+	free(code);
+	return 0;
+}
+
+void lffilter_hpf(int *data, size_t len) {
+	lffilter_op_t op = { LFF_HPF, 0, 0 };
+	lffilter_run(data, len, &op, 1);
+}
+
+void lffilter_norm(int *data, size_t len) {
+	lffilter_op_t op = { LFF_NORM, 0, 0 };
+	lffilter_run(data, len, &op, 1);
+}
+
+void lffilter_dirthreshold(const int *in, int *out, size_t len, int8_t up, int8_t down) {
+	lffilter_op_t op = { LFF_DIRTHRESHOLD, up, down };
+	if (in != out)
+		memcpy(out, in, len * sizeof(int));
+	lffilter_run(out, len, &op, 1);
+}
+
+void lffilter_edge(const int *in, int *out, size_t len, int threshold) {
+	lffilter_op_t op = { LFF_EDGE, threshold, 0 };
+	if (in != out)
+		memcpy(out, in, len * sizeof(int));
+	lffilter_run(out, len, &op, 1);
+}
+
+const char *lffilter_kernel_name(void) {
+	return lffilter_get_kernels()->name;
+}
+
+//-----------------------------------------------------------------------------
+// self test and benchmark
+// the original one filter at a time implementations are kept as reference
+//-----------------------------------------------------------------------------
+static void ref_hpf(int *data, int len) {
+	int i, accum = 0;
+	if (len <= LFF_STATS_SKIP) return;
+	for (i = 10; i < len; ++i)
+		accum += data[i];
+	accum /= (len - 10);
+	for (i = 0; i < len; ++i)
+		data[i] -= accum;
+}
+
+static void ref_norm(int *data, int len) {
+	int i, max = INT_MIN, min = INT_MAX;
+	if (len <= LFF_STATS_SKIP) return;
+	for (i = 10; i < len; ++i) {
+		if (data[i] > max) max = data[i];
+		if (data[i] < min) min = data[i];
+	}
+	if (max != min) {
+		for (i = 0; i < len; ++i)
+			data[i] = ((long)(data[i] - ((max + min) / 2)) * 256) / (max - min);
+	}
+}
+
+static void ref_dirthreshold(int *data, size_t len, int8_t up, int8_t down) {
+	int lastValue = data[0];
+	data[0] = 0;
+	for (size_t i = 1; i < len; ++i) {
+		if (data[i] >= up && data[i] > lastValue) {
+			lastValue = data[i];
+			data[i] = 1;
+		} else if (data[i] <= down && data[i] < lastValue) {
+			lastValue = data[i];
+			data[i] = -1;
+		} else {
+			lastValue = data[i];
+			data[i] = data[i-1];
+		}
+	}
+	data[0] = data[1];
+}
+
+static void ref_edge(int *data, int len, int threshold) {
+	int last = 0;
+	for (int i = 1; i < len; i++) {
+		if (data[i] - data[i-1] >= threshold)
+			last = 127;
+		else if (data[i] - data[i-1] <= -1 * threshold)
+			last = -127;
+		data[i-1] = last;
+	}
+}
+
+static void ref_lowpass(int *data, size_t len, uint8_t k) {
+	int32_t filter_reg = 0;
+	int16_t input, output;
+	int8_t shift = (k <= 8) ? k : LFF_LOWPASS_DEF;
+	for (size_t i = 0; i < len; ++i) {
+		input = data[i];
+		filter_reg = filter_reg - (filter_reg >> shift) + input;
+		output = filter_reg >> shift;
+		data[i] = output;
+	}
+}
+
+static void ref_run(int *data, size_t len, const lffilter_op_t *ops, size_t nops) {
+	for (size_t i = 0; i < nops; i++) {
+		switch (ops[i].type) {
+			case LFF_HPF:          ref_hpf(data, len); break;
+			case LFF_NORM:         ref_norm(data, len); break;
+			case LFF_DIRTHRESHOLD: if (len > 1) ref_dirthreshold(data, len, ops[i].a, ops[i].b); break;
+			case LFF_EDGE:         ref_edge(data, len, ops[i].a); break;
+			case LFF_LOWPASS:      ref_lowpass(data, len, ops[i].a); break;
+		}
+	}
+}
+
+// noisy ask like wave with a dc offset,  deterministic
+static void lff_test_signal(int *data, size_t len) {
+	uint32_t lfsr = 0x12345678;
+	for (size_t i = 0; i < len; i++) {
+		lfsr = lfsr * 1103515245 + 12345;
+		int noise = (int)((lfsr >> 16) % 31) - 15;
+		int carrier = ((i / 4) & 1) ? 90 : -90;
+		int envelope = ((i / 256) & 1) ? 1 : 3;
+		data[i] = 20 + carrier / envelope + noise;
+	}
+}
+
+static const struct {
+	const char *desc;
+	size_t nops;
+	lffilter_op_t ops[6];
+} lff_tests[] = {
+	{ "hpf",                       1, { {LFF_HPF, 0, 0} } },
+	{ "norm",                      1, { {LFF_NORM, 0, 0} } },
+	{ "dirthreshold 20 -20",       1, { {LFF_DIRTHRESHOLD, 20, -20} } },
+	{ "askedgedetect 25",          1, { {LFF_EDGE, 25, 0} } },
+	{ "lowpass 4",                 1, { {LFF_LOWPASS, 4, 0} } },
+	{ "hpf norm edge",             3, { {LFF_HPF, 0, 0}, {LFF_NORM, 0, 0}, {LFF_EDGE, 30, 0} } },
+	{ "lowpass hpf norm dir",      4, { {LFF_LOWPASS, 2, 0}, {LFF_HPF, 0, 0}, {LFF_NORM, 0, 0}, {LFF_DIRTHRESHOLD, 40, -40} } },
+	{ "hpf edge dir lowpass norm", 5, { {LFF_HPF, 0, 0}, {LFF_EDGE, 25, 0}, {LFF_DIRTHRESHOLD, 10, -10}, {LFF_LOWPASS, 3, 0}, {LFF_NORM, 0, 0} } },
+};
+
+int lffilter_selftest(size_t len, bool verbose) {
+	const size_t rounds = 20;
+	int failed = 0;
+
+	int *src = calloc(len, sizeof(int));
+	int *ref = calloc(len, sizeof(int));
+	int *res = calloc(len, sizeof(int));
+	if (!src || !ref || !res) {
+		free(src); free(ref); free(res);
+		return 1;
+	}
+
+	lff_test_signal(src, len);
+
+	PrintAndLogEx(NORMAL, "LF filter chain test, %u samples, %s kernels", len, lffilter_kernel_name());
+	PrintAndLogEx(NORMAL, "  %-27s | ref ms | chain ms | Msmpl/s | result", "chain");
+	PrintAndLogEx(NORMAL, "  ----------------------------+--------+----------+---------+-------");
+
+	for (size_t t = 0; t < sizeof(lff_tests) / sizeof(lff_tests[0]); t++) {
+
+		// also check odd lengths around the block boundaries
+		size_t lens[] = { len, len - 1, 4097, 11, 2, 1 };
+		bool ok = true;
+		for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+			memcpy(ref, src, lens[l] * sizeof(int));
+			memcpy(res, src, lens[l] * sizeof(int));
+			ref_run(ref, lens[l], lff_tests[t].ops, lff_tests[t].nops);
+			lffilter_run(res, lens[l], lff_tests[t].ops, lff_tests[t].nops);
+			if (memcmp(ref, res, lens[l] * sizeof(int))) {
+				if (verbose) PrintAndLogEx(WARNING, "%s differs at length %u", lff_tests[t].desc, lens[l]);
+				ok = false;
+			}
+		}
+
+		uint64_t tref = msclock();
+		for (size_t r = 0; r < rounds; r++) {
+			memcpy(ref, src, len * sizeof(int));
+			ref_run(ref, len, lff_tests[t].ops, lff_tests[t].nops);
+		}
+		tref = msclock() - tref;
+
+		uint64_t tchain = msclock();
+		for (size_t r = 0; r < rounds; r++) {
+			memcpy(res, src, len * sizeof(int));
+			lffilter_run(res, len, lff_tests[t].ops, lff_tests[t].nops);
+		}
+		tchain = msclock() - tchain;
+
+		double rate = (tchain) ? (double)(len * rounds) / (tchain * 1000.0) : 0;
+		PrintAndLogEx(NORMAL, "  %-27s | %6" PRIu64 " | %8" PRIu64 " | %7.1f | %s",
+			lff_tests[t].desc, tref, tchain, rate, (ok) ? _GREEN_(ok) : _RED_(fail));
+		if (!ok) failed++;
+	}
+
+	free(src);
+	free(ref);
+	free(res);
+	return failed;
+}
@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample preprocessing filters on GraphBuffer style int arrays.
+// A chain of filters is applied block wise in as few passes as possible,
+// only filters needing whole trace statistics (hpf, norm) start a new pass.
+//-----------------------------------------------------------------------------
+
+#ifndef LFFILTER_H__
+#define LFFILTER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define LFF_HPF           0   // remove DC offset,  mean of samples 10..len
+#define LFF_NORM          1   // normalize max/min of samples 10..len to +/-128
+#define LFF_DIRTHRESHOLD  2   // a = up threshold,  b = down threshold
+#define LFF_EDGE          3   // a = edge threshold
+#define LFF_LOWPASS       4   // a = shift k,  same as iceSimple_Filter
+
+#define LFF_MAX_CHAIN     16
+
+typedef struct {
+	uint8_t type;
+	int a;
+	int b;
+} lffilter_op_t;
+
+extern int lffilter_run(int *data, size_t len, const lffilter_op_t *ops, size_t nops);
+
+extern void lffilter_hpf(int *data, size_t len);
+extern void lffilter_norm(int *data, size_t len);
+extern void lffilter_dirthreshold(const int *in, int *out, size_t len, int8_t up, int8_t down);
+extern void lffilter_edge(const int *in, int *out, size_t len, int threshold);
+
+extern const char *lffilter_kernel_name(void);
+extern int lffilter_selftest(size_t len, bool verbose);
+
+#endif
@@ -0,0 +1,139 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample filter kernels.
+//
+// Like hardnested_bitarray_core.c this file is compiled several times, once for
+// each instruction set.  The loops are kept branch free over flat int arrays so
+// the compiler vectorizes them with the instruction set given on the command line.
+// Anything with a sample to sample dependency (the hold of the threshold filters,
+// IIR filters) stays in lffilter.c
+//-----------------------------------------------------------------------------
+
+#include "lffilter_core.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+// this needs to be compiled several times for each instruction set.
+// For each instruction set, define a dedicated function name:
+#if defined (__AVX512F__)
+#define LFF_KERNELS lffilter_kernels_AVX512
+#define LFF_NAME "AVX512"
+#define LFF(x) x##_AVX512
+#elif defined (__AVX2__)
+#define LFF_KERNELS lffilter_kernels_AVX2
+#define LFF_NAME "AVX2"
+#define LFF(x) x##_AVX2
+#elif defined (__AVX__)
+#define LFF_KERNELS lffilter_kernels_AVX
+#define LFF_NAME "AVX"
+#define LFF(x) x##_AVX
+#elif defined (__SSE2__)
+#define LFF_KERNELS lffilter_kernels_SSE2
+#define LFF_NAME "SSE2"
+#define LFF(x) x##_SSE2
+#elif defined (__MMX__)
+#define LFF_KERNELS lffilter_kernels_MMX
+#define LFF_NAME "MMX"
+#define LFF(x) x##_MMX
+#else
+#define LFF_KERNELS lffilter_kernels_NOSIMD
+#define LFF_NAME "NOSIMD"
+#define LFF(x) x##_NOSIMD
+#endif
+
+extern const lffilter_kernels_t lffilter_kernels_AVX512, lffilter_kernels_AVX2, lffilter_kernels_AVX, lffilter_kernels_SSE2, lffilter_kernels_MMX, lffilter_kernels_NOSIMD;
+
+static int64_t LFF(sum)(const int *restrict in, size_t n) {
+	int64_t sum = 0;
+	for (size_t i = 0; i < n; i++)
+		sum += in[i];
+	return sum;
+}
+
+static void LFF(minmax)(const int *restrict in, size_t n, int *min, int *max) {
+	int lo = *min, hi = *max;
+	for (size_t i = 0; i < n; i++) {
+		lo = (in[i] < lo) ? in[i] : lo;
+		hi = (in[i] > hi) ? in[i] : hi;
+	}
+	*min = lo;
+	*max = hi;
+}
+
+static void LFF(sub)(int *restrict data, size_t n, int v) {
+	for (size_t i = 0; i < n; i++)
+		data[i] -= v;
+}
+
+// ((x - mid) * 256) / range, truncated like the integer division in CmdNorm.
+// Both operands are exact in a double (|n| < 2^53) so the truncated quotient is exact too.
+static void LFF(norm)(int *restrict data, size_t n, int mid, int range) {
+	double r = range;
+	for (size_t i = 0; i < n; i++)
+		data[i] = (int)(((double)(data[i] - mid) * 256.0) / r);
+}
+
+static void LFF(dir_classify)(const int *restrict in, int8_t *restrict code, size_t n, int prev, int up, int down) {
+	if (n == 0) return;
+	code[0] = (in[0] >= up && in[0] > prev) ? 1 : (in[0] <= down && in[0] < prev) ? -1 : 0;
+	for (size_t i = 1; i < n; i++) {
+		int8_t u = (in[i] >= up) & (in[i] > in[i-1]);
+		int8_t d = (in[i] <= down) & (in[i] < in[i-1]);
+		code[i] = u - (d & !u);
+	}
+}
+
+static void LFF(edge_classify)(const int *restrict in, int8_t *restrict code, size_t n, int prev, int threshold) {
+	if (n == 0) return;
+	int diff = in[0] - prev;
+	code[0] = (diff >= threshold) ? 1 : (diff <= -threshold) ? -1 : 0;
+	for (size_t i = 1; i < n; i++) {
+		int dd = in[i] - in[i-1];
+		int8_t u = (dd >= threshold);
+		int8_t d = (dd <= -threshold);
+		code[i] = u - (d & !u);
+	}
+}
+
+const lffilter_kernels_t LFF_KERNELS = {
+	LFF_NAME,
+	LFF(sum),
+	LFF(minmax),
+	LFF(sub),
+	LFF(norm),
+	LFF(dir_classify),
+	LFF(edge_classify)
+};
+
+#ifndef __MMX__
+
+// determine the available instruction set at runtime and return the matching kernels
+const lffilter_kernels_t *lffilter_get_kernels(void) {
+	static const lffilter_kernels_t *kernels = NULL;
+	if (kernels) return kernels;
+
+#if defined (__i386__) || defined (__x86_64__)
+	#if !defined(__APPLE__) || (defined(__APPLE__) && (__clang_major__ > 8 || __clang_major__ == 8 && __clang_minor__ >= 1))
+		#if (__GNUC__ >= 5) && (__GNUC__ > 5 || __GNUC_MINOR__ > 2)
+	if (__builtin_cpu_supports("avx512f")) kernels = &lffilter_kernels_AVX512;
+	else if (__builtin_cpu_supports("avx2")) kernels = &lffilter_kernels_AVX2;
+		#else
+	if (__builtin_cpu_supports("avx2")) kernels = &lffilter_kernels_AVX2;
+		#endif
+	else if (__builtin_cpu_supports("avx")) kernels = &lffilter_kernels_AVX;
+	else if (__builtin_cpu_supports("sse2")) kernels = &lffilter_kernels_SSE2;
+	else if (__builtin_cpu_supports("mmx")) kernels = &lffilter_kernels_MMX;
+	else
+	#endif
+#endif
+		kernels = &lffilter_kernels_NOSIMD;
+
+	return kernels;
+}
+
+#endif
@@ -0,0 +1,31 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample filter kernels.  Compiled once per instruction set (see Makefile,
+// MULTIARCHSRCS) and selected at runtime like the hardnested cores.
+//-----------------------------------------------------------------------------
+
+#ifndef LFFILTER_CORE_H__
+#define LFFILTER_CORE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+	const char *name;
+	// reductions
+	int64_t (*sum)(const int *in, size_t n);
+	void    (*minmax)(const int *in, size_t n, int *min, int *max);
+	// point wise
+	void    (*sub)(int *data, size_t n, int v);
+	void    (*norm)(int *data, size_t n, int mid, int range);
+	// edge classification, code[j] is +1 / -1 / 0 (hold) from in[j] and in[j-1], in[-1] is prev
+	void    (*dir_classify)(const int *in, int8_t *code, size_t n, int prev, int up, int down);
+	void    (*edge_classify)(const int *in, int8_t *code, size_t n, int prev, int threshold);
+} lffilter_kernels_t;
+
+extern const lffilter_kernels_t *lffilter_get_kernels(void);
+
+#endif
@@ -0,0 +1,282 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample packing test and benchmark,  see lfpacktest.h
+//-----------------------------------------------------------------------------
+
+#include "lfpacktest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "lfpack.h"
+#include "lfcompress.h"
+#include "util.h"
+#include "util_posix.h"			// msclock
+#include "ui.h"
+
+//-----------------------------------------------------------------------------
+// reference,  the storing part of DoAcquisition as it was before lfpack.c,
+// the samples come from in[] instead of the SSC
+//-----------------------------------------------------------------------------
+typedef struct {
+	uint8_t * buffer;
+	uint32_t numbits;
+	uint32_t position;
+} ref_BitstreamOut;
+
+static void ref_pushBit( ref_BitstreamOut* stream, uint8_t bit) {
+	int bytepos = stream->position >> 3; // divide by 8
+	int bitpos = stream->position & 7;
+	*(stream->buffer+bytepos) |= (bit > 0) <<  (7 - bitpos);
+	stream->position++;
+	stream->numbits++;
+}
+
+static uint32_t ref_acquisition(const uint8_t *in, size_t len, uint8_t *dest, int bufsize, uint8_t decimation, uint32_t bits_per_sample, bool averaging, bool compression, uint32_t *saved, size_t *taken) {
+	if (bits_per_sample < 1) bits_per_sample = 1;
+	if (bits_per_sample > 8) bits_per_sample = 8;
+
+	if (decimation < 1) decimation = 1;
+
+	// Use a bit stream to handle the output
+	ref_BitstreamOut data = { dest , 0, 0};
+	lfcompress_t lfc;
+	lfcompress_init(&lfc, dest, bufsize);
+	int sample_counter = 0;
+	uint8_t sample = 0;
+	//If we want to do averaging
+	uint32_t sample_sum =0 ;
+	uint32_t sample_total_saved = 0;
+
+	size_t i;
+	for (i = 0; i < len; i++) {
+		sample = in[i];
+
+		if (averaging)
+			sample_sum += sample;
+
+		//Check decimation
+		if (decimation > 1)	{
+			sample_counter++;
+			if (sample_counter < decimation) continue;
+			sample_counter = 0;
+		}
+
+		//Averaging
+		if (averaging && decimation > 1) {
+			sample = sample_sum / decimation;
+			sample_sum =0;
+		}
+
+		//Store the sample
+		if (compression) {
+			if (!lfcompress_push(&lfc, sample >> (8 - bits_per_sample))) break;
+			sample_total_saved ++;
+			continue;
+		}
+		sample_total_saved ++;
+		if (bits_per_sample == 8){
+			dest[sample_total_saved-1] = sample;
+			data.numbits = sample_total_saved << 3;//Get the return value correct
+			if (sample_total_saved >= bufsize) break;
+
+		} else {
+			ref_pushBit(&data, sample & 0x80);
+			if (bits_per_sample > 1)	ref_pushBit(&data, sample & 0x40);
+			if (bits_per_sample > 2)	ref_pushBit(&data, sample & 0x20);
+			if (bits_per_sample > 3)	ref_pushBit(&data, sample & 0x10);
+			if (bits_per_sample > 4)	ref_pushBit(&data, sample & 0x08);
+			if (bits_per_sample > 5)	ref_pushBit(&data, sample & 0x04);
+			if (bits_per_sample > 6)	ref_pushBit(&data, sample & 0x02);
+			//Not needed, 8bps is covered above
+			//if (bits_per_sample > 7)	ref_pushBit(&data, sample & 0x01);
+			if ((data.numbits >> 3) +1  >= bufsize) break;
+		}
+	}
+
+	if (compression)
+		data.numbits = lfcompress_finish(&lfc) << 3;
+
+	*saved = sample_total_saved;
+	*taken = (i < len) ? i + 1 : len;
+	return data.numbits;
+}
+
+// the same with lfpack.c,  block the loop of the mode as DoAcquisition runs it
+// now,  else lfpack_put a sample at a time
+static uint32_t pack_acquisition(const uint8_t *in, size_t len, uint8_t *dest, int bufsize, uint8_t decimation, uint32_t bits_per_sample, bool averaging, bool compression, bool block, uint32_t *saved, size_t *taken) {
+	lfpack_t pack;
+	lfpack_init(&pack, dest, bufsize, (bits_per_sample > 8) ? 8 : bits_per_sample, decimation, averaging, compression);
+	if (block) {
+		*taken = lfpack_block(&pack, in, len);
+	} else {
+		size_t i;
+		for (i = 0; i < len; i++) {
+			if (!lfpack_put(&pack, in[i]))
+				break;
+		}
+		*taken = (i < len) ? i + 1 : len;
+	}
+	*saved = pack.saved;
+	return lfpack_finish(&pack);
+}
+
+// random samples and an ASK like wave with noisy levels,  deterministic
+static void lfpack_samples(uint8_t *s, size_t len, int kind) {
+	uint32_t lfsr = 0x12345678 + kind;
+	for (size_t i = 0; i < len; i++) {
+		lfsr = lfsr * 1103515245 + 12345;
+		if (kind == 0) {
+			s[i] = lfsr >> 24;
+		} else {
+			int level = ((i / 40) & 1) ? 230 : 20;
+			s[i] = level + (int)((lfsr >> 16) % 9) - 4;
+		}
+	}
+}
+
+// sum * recip >> 32 against sum / decimation,  for every sum an average can have
+static bool lfpack_test_division(bool verbose) {
+	for (uint32_t d = 2; d < 256; d++) {
+		lfpack_t p;
+		uint8_t buf[1];
+		lfpack_init(&p, buf, sizeof(buf), 8, d, true, false);
+		for (uint32_t sum = 0; sum <= 255 * d; sum++) {
+			uint32_t q = ((uint64_t)sum * p.recip) >> 32;
+			if (q != sum / d) {
+				if (verbose) PrintAndLogEx(WARNING, "%u / %u is %u,  not %u", sum, d, q, sum / d);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int lfpack_test(bool verbose) {
+	static const uint8_t decimations[] = {1, 2, 3, 5, 8, 255};
+	static const int bufsizes[] = {1, 2, 3, 4, 5, 9, 33, 257, 40000};
+	const size_t len = 60000;
+	const int guard = 8;
+	int failed = 0;
+
+	uint8_t *s = malloc(len);
+	uint8_t *ref = malloc(40000 + guard);
+	uint8_t *res = malloc(40000 + guard);
+	if (s == NULL || ref == NULL || res == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the test");
+		free(s); free(ref); free(res);
+		return 1;
+	}
+
+	PrintAndLogEx(NORMAL, "LF sample packing test");
+
+	bool ok = lfpack_test_division(verbose);
+	PrintAndLogEx(NORMAL, "  averaging division...........%s", (ok) ? _GREEN_(ok) : _RED_(fail));
+	if (!ok) failed++;
+
+	uint32_t runs = 0, bad = 0;
+	for (int kind = 0; kind < 2; kind++) {
+		lfpack_samples(s, len, kind);
+		for (uint8_t bps = 1; bps <= 8; bps++) {
+			for (size_t d = 0; d < sizeof(decimations); d++) {
+				for (int mode = 0; mode < 4; mode++) {
+					bool averaging = mode & 1, compression = mode & 2;
+					for (size_t b = 0; b < sizeof(bufsizes) / sizeof(bufsizes[0]); b++) {
+						int size = bufsizes[b];
+						uint32_t rsaved, psaved;
+						size_t rtaken, ptaken;
+						memset(ref, 0, size + guard);
+						uint32_t rbits = ref_acquisition(s, len, ref, size, decimations[d], bps, averaging, compression, &rsaved, &rtaken);
+						for (int block = 0; block < 2; block++) {
+							memset(res, 0, size + guard);
+							uint32_t pbits = pack_acquisition(s, len, res, size, decimations[d], bps, averaging, compression, block, &psaved, &ptaken);
+							runs++;
+							if (rbits != pbits || rsaved != psaved || rtaken != ptaken || memcmp(ref, res, size + guard)) {
+								bad++;
+								if (verbose)
+									PrintAndLogEx(WARNING, "samples %d,  %u bps,  decimation %u,  averaging %u,  compression %u,  %d bytes,  %s: bits %u / %u,  saved %u / %u,  taken %u / %u",
+										kind, bps, decimations[d], averaging, compression, size, (block) ? "block" : "put",
+										rbits, pbits, rsaved, psaved, (uint32_t)rtaken, (uint32_t)ptaken);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	PrintAndLogEx(NORMAL, "  against pushBit..............%u / %u  %s", runs - bad, runs, (bad) ? _RED_(fail) : _GREEN_(ok));
+	if (bad) failed++;
+
+	free(s);
+	free(ref);
+	free(res);
+	PrintAndLogEx((failed) ? WARNING : SUCCESS, "Tests %s", (failed) ? _RED_(failed) : _GREEN_(passed));
+	return failed;
+}
+
+int lfpack_bench(uint32_t rounds) {
+	static const struct {
+		uint8_t bps;
+		uint8_t decimation;
+		bool averaging;
+	} configs[] = {
+		{8, 1, false}, {4, 1, false}, {2, 1, false}, {1, 1, false}, {3, 1, false},
+		{8, 2, false}, {4, 2, false}, {8, 3, true}, {4, 3, true}, {1, 4, true},
+	};
+	const size_t len = 40000 * 8;
+
+	// a buffer that does not fill,  every sample goes through
+	uint8_t *s = malloc(len);
+	uint8_t *buf = malloc(len);
+	if (s == NULL || buf == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the bench");
+		free(s); free(buf);
+		return 1;
+	}
+	lfpack_samples(s, len, 0);
+	// pushBit ORs into the buffer,  it is not cleared between rounds
+	memset(buf, 0, len);
+
+	PrintAndLogEx(NORMAL, "LF sample packing,  %u samples,  %u rounds", (uint32_t)len, rounds);
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "bps | decimation | averaging | pushBit ns/s | put ns/s | block ns/s | speedup");
+	PrintAndLogEx(NORMAL, "----+------------+-----------+--------------+----------+------------+--------");
+
+	int failed = 0;
+	for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+		uint32_t saved;
+		size_t taken;
+		uint32_t rbits = 0, pbits = 0;
+
+		uint64_t tref = msclock();
+		for (uint32_t r = 0; r < rounds; r++) {
+			rbits = ref_acquisition(s, len, buf, len, configs[c].decimation, configs[c].bps, configs[c].averaging, false, &saved, &taken);
+		}
+		tref = msclock() - tref;
+
+		uint64_t tput = msclock();
+		for (uint32_t r = 0; r < rounds; r++)
+			pbits = pack_acquisition(s, len, buf, len, configs[c].decimation, configs[c].bps, configs[c].averaging, false, false, &saved, &taken);
+		tput = msclock() - tput;
+		if (rbits != pbits) failed++;
+
+		uint64_t tblock = msclock();
+		for (uint32_t r = 0; r < rounds; r++)
+			pbits = pack_acquisition(s, len, buf, len, configs[c].decimation, configs[c].bps, configs[c].averaging, false, true, &saved, &taken);
+		tblock = msclock() - tblock;
+		if (rbits != pbits) failed++;
+
+		double calls = (double)len * rounds;
+		PrintAndLogEx(NORMAL, " %u  | %10u | %9s | %12.2f | %8.2f | %10.2f | %5.1fx",
+			configs[c].bps, configs[c].decimation, (configs[c].averaging) ? "yes" : "no",
+			tref * 1e6 / calls, tput * 1e6 / calls, tblock * 1e6 / calls, (tblock) ? (double)tref / tblock : 0);
+	}
+
+	free(s);
+	free(buf);
+	return failed;
+}
@@ -0,0 +1,22 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample packing test and benchmark,  the DoAcquisition storing of samples
+// against the bit by bit pushBit version it replaced
+//-----------------------------------------------------------------------------
+
+#ifndef LFPACKTEST_H__
+#define LFPACKTEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// every bits per sample,  decimation and averaging on synthetic samples and
+// buffer sizes,  the same BigBuf contents,  bits,  samples stored and taken
+extern int lfpack_test(bool verbose);
+// throughput of both,  rounds over a max graph length of samples
+extern int lfpack_bench(uint32_t rounds);
+
+#endif
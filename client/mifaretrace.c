@@ -0,0 +1,398 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// MIFARE Classic trace decryption,  key recovery for one auth session
+//
+// The nested search cuts the nonce range into chunks,  the pool threads take
+// them in order.  A match only stops the chunks after it,  so the lowest
+// matching nonce wins like in the old serial loop.  Every thread keeps its
+// recovered state,  the winner's state is handed back and the caller needs no
+// second lfsr_recovery64 to decrypt or to get the key.  The key is rolled back
+// with the nonce from nt_enc,  not with the candidate.
+//
+// Hardened cards give no usable distance to the last nonce,  but ar and at are
+// prng successors of nt and only depend on its low 16 bits.  So the hard search
+// runs over those 2^16 values,  the seven ar/at parity bits leave about 512 of
+// them for lfsr_recovery64.  Rolling the state back through nr_enc and nt_enc
+// gives nt,  which has to match the low bits and the nt parity.
+//-----------------------------------------------------------------------------
+
+#include "mifaretrace.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "mifarehost.h"		// mf_crypto1_decrypt
+#include "mifaredefault.h"
+#include "crc16.h"
+#include "util.h"
+#include "util_posix.h"
+
+#define MF_TRACE_CHUNK		512
+
+typedef struct {
+	uint8_t buf[32];				// trial decryption
+	struct Crypto1State state;
+	uint32_t candidates;
+} mf_trace_worker_t;
+
+struct mf_trace_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t work;			// a search is posted
+	pthread_cond_t idle;			// a thread is done with it
+	int threads;					// including the caller
+	pthread_t *tids;
+	mf_trace_worker_t *workers;		// the caller's is the last one
+	uint32_t generation;
+	int busy;
+	bool quit;
+
+	// the posted search
+	TAuthData *ad;
+	uint8_t *cmd;
+	uint8_t cmdsize;
+	uint8_t *parity;
+	bool hard;
+	int range;
+	uint32_t nt;					// first candidate
+	int next;						// next chunk
+	volatile int best;				// lowest matching candidate
+	uint32_t best_nt;
+	struct Crypto1State best_state;
+};
+
+// the state after the auth,  as if the reader had the key
+static void mf_trace_key_state(uint64_t key, TAuthData *ad, struct Crypto1State *s) {
+	struct Crypto1State *pcs = crypto1_create(key);
+	crypto1_word(pcs, ad->nt ^ ad->uid, 0);
+	crypto1_word(pcs, ad->nr_enc, 1);
+	crypto1_word(pcs, 0, 0);
+	crypto1_word(pcs, 0, 0);
+	*s = *pcs;
+	crypto1_destroy(pcs);
+}
+
+// same as GetCrypto1ProbableKey(),  from the recovered state
+static uint64_t mf_trace_state_key(struct Crypto1State s, TAuthData *ad, uint32_t nt) {
+	uint64_t key = 0;
+	lfsr_rollback_word(&s, 0, 0);
+	lfsr_rollback_word(&s, 0, 0);
+	lfsr_rollback_word(&s, ad->nr_enc, 1);
+	lfsr_rollback_word(&s, ad->uid ^ nt, 0);
+	crypto1_get_lfsr(&s, &key);
+	return key;
+}
+
+static bool mf_trace_check_key(uint64_t key, TAuthData *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, mf_trace_auth_t *res) {
+	TAuthData t = *ad;
+	if (!NestedCheckKey(key, &t, cmd, cmdsize, parity))
+		return false;
+
+	res->key = key;
+	res->nt = t.nt;
+	res->ks2 = t.ks2;
+	res->ks3 = t.ks3;
+	mf_trace_key_state(key, &t, &res->state);
+	return true;
+}
+
+// hard candidates only have the low 16 bits of nt,  the rest comes from the rollback
+static bool mf_trace_try_nt(mf_trace_pool_t *p, mf_trace_worker_t *w, uint32_t *ntx) {
+	uint32_t ks2 = p->ad->ar_enc ^ prng_successor(*ntx, 64);
+	uint32_t ks3 = p->ad->at_enc ^ prng_successor(*ntx, 96);
+
+	struct Crypto1State *pcs = lfsr_recovery64(ks2, ks3);
+	if (!pcs)
+		return false;
+	w->state = *pcs;
+	crypto1_destroy(pcs);
+
+	// the real nonce,  a nested candidate may only share its low bits
+	struct Crypto1State r = w->state;
+	lfsr_rollback_word(&r, 0, 0);
+	lfsr_rollback_word(&r, 0, 0);
+	lfsr_rollback_word(&r, p->ad->nr_enc, 1);
+	uint32_t nt = p->ad->nt_enc ^ lfsr_rollback_word(&r, p->ad->uid ^ p->ad->nt_enc, 1);
+	if ((nt & 0xFFFF) != (*ntx & 0xFFFF) || !NTParityChk(p->ad, nt))
+		return false;
+	*ntx = nt;
+
+	struct Crypto1State s = w->state;
+	memcpy(w->buf, p->cmd, p->cmdsize);
+	mf_crypto1_decrypt(&s, w->buf, p->cmdsize, 0);
+
+	return CheckCrypto1Parity(p->cmd, p->cmdsize, w->buf, p->parity) && check_crc(CRC_14443_A, w->buf, p->cmdsize);
+}
+
+static void mf_trace_search_part(mf_trace_pool_t *p, mf_trace_worker_t *w) {
+	for (;;) {
+		pthread_mutex_lock(&p->lock);
+		int start = p->next++ * MF_TRACE_CHUNK;
+		pthread_mutex_unlock(&p->lock);
+		if (start >= p->range || start > p->best)
+			break;
+
+		int end = start + MF_TRACE_CHUNK;
+		if (end > p->range)
+			end = p->range;
+
+		uint32_t nt = p->hard ? (uint32_t)start : prng_successor(p->nt, start);
+		for (int i = start; i < end && i < p->best; i++, nt = p->hard ? nt + 1 : prng_successor(nt, 1)) {
+			if (p->hard) {
+				if (!ArAtParityChk(p->ad, prng_successor(nt, 64), prng_successor(nt, 96)))
+					continue;
+			} else {
+				if (!NTParityChk(p->ad, nt))
+					continue;
+			}
+
+			w->candidates++;
+			uint32_t ntx = nt;
+			if (!mf_trace_try_nt(p, w, &ntx))
+				continue;
+
+			pthread_mutex_lock(&p->lock);
+			if (i < p->best) {
+				p->best = i;
+				p->best_nt = ntx;
+				p->best_state = w->state;
+			}
+			pthread_mutex_unlock(&p->lock);
+			break;
+		}
+	}
+}
+
+static void *mf_trace_thread(void *arg) {
+	mf_trace_pool_t *p = arg;
+
+	pthread_mutex_lock(&p->lock);
+	int id = p->busy++;
+	uint32_t seen = p->generation;
+	for (;;) {
+		while (p->generation == seen && !p->quit)
+			pthread_cond_wait(&p->work, &p->lock);
+		if (p->quit)
+			break;
+		seen = p->generation;
+		pthread_mutex_unlock(&p->lock);
+
+		mf_trace_search_part(p, &p->workers[id]);
+
+		pthread_mutex_lock(&p->lock);
+		if (--p->busy == 0)
+			pthread_cond_signal(&p->idle);
+	}
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+mf_trace_pool_t *mf_trace_pool_create(int threads) {
+	mf_trace_pool_t *p = calloc(1, sizeof(mf_trace_pool_t));
+	if (!p)
+		return NULL;
+
+	if (threads <= 0)
+		threads = num_CPUs();
+	p->workers = calloc(threads, sizeof(mf_trace_worker_t));
+	p->tids = calloc(threads, sizeof(pthread_t));
+	if (!p->workers || !p->tids) {
+		free(p->workers);
+		free(p->tids);
+		free(p);
+		return NULL;
+	}
+
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->work, NULL);
+	pthread_cond_init(&p->idle, NULL);
+
+	// the threads number themselves with busy,  wait until all have started
+	p->threads = 1;
+	for (int i = 0; i < threads - 1; i++)
+		if (pthread_create(&p->tids[i], NULL, mf_trace_thread, p) == 0)
+			p->threads++;
+
+	pthread_mutex_lock(&p->lock);
+	while (p->busy < p->threads - 1) {
+		pthread_mutex_unlock(&p->lock);
+		msleep(1);
+		pthread_mutex_lock(&p->lock);
+	}
+	p->busy = 0;
+	pthread_mutex_unlock(&p->lock);
+	return p;
+}
+
+void mf_trace_pool_free(mf_trace_pool_t *p) {
+	if (!p)
+		return;
+
+	pthread_mutex_lock(&p->lock);
+	p->quit = true;
+	pthread_cond_broadcast(&p->work);
+	pthread_mutex_unlock(&p->lock);
+
+	for (int i = 0; i < p->threads - 1; i++)
+		pthread_join(p->tids[i], NULL);
+
+	pthread_cond_destroy(&p->idle);
+	pthread_cond_destroy(&p->work);
+	pthread_mutex_destroy(&p->lock);
+	free(p->tids);
+	free(p->workers);
+	free(p);
+}
+
+int mf_trace_pool_threads(mf_trace_pool_t *p) {
+	return p ? p->threads : 1;
+}
+
+static bool mf_trace_search(mf_trace_pool_t *p, bool hard, TAuthData *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, mf_trace_auth_t *res) {
+	mf_trace_worker_t *self = &p->workers[p->threads - 1];
+
+	pthread_mutex_lock(&p->lock);
+	p->ad = ad;
+	p->cmd = cmd;
+	p->cmdsize = cmdsize;
+	p->parity = parity;
+	p->hard = hard;
+	p->range = hard ? MF_TRACE_HARD_RANGE : MF_TRACE_NESTED_RANGE;
+	p->nt = prng_successor(ad->nt, MF_TRACE_NESTED_DIST);
+	p->next = 0;
+	p->best = p->range;
+	for (int i = 0; i < p->threads; i++)
+		p->workers[i].candidates = 0;
+	p->busy = p->threads - 1;
+	p->generation++;
+	pthread_cond_broadcast(&p->work);
+	pthread_mutex_unlock(&p->lock);
+
+	mf_trace_search_part(p, self);
+
+	pthread_mutex_lock(&p->lock);
+	while (p->busy)
+		pthread_cond_wait(&p->idle, &p->lock);
+	pthread_mutex_unlock(&p->lock);
+
+	for (int i = 0; i < p->threads; i++)
+		res->candidates += p->workers[i].candidates;
+
+	if (p->best == p->range)
+		return false;
+
+	res->nt = p->best_nt;
+	res->ks2 = ad->ar_enc ^ prng_successor(p->best_nt, 64);
+	res->ks3 = ad->at_enc ^ prng_successor(p->best_nt, 96);
+	res->state = p->best_state;
+	res->key = mf_trace_state_key(p->best_state, ad, p->best_nt);
+	return true;
+}
+
+bool mf_trace_resolve(mf_trace_pool_t *pool, TAuthData *ad, uint64_t lastkey, bool hard, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, mf_trace_auth_t *res) {
+	memset(res, 0, sizeof(mf_trace_auth_t));
+	uint64_t start = msclock();
+
+	if (ad->first_auth) {
+		res->nt = ad->nt;
+		res->ks2 = ad->ar_enc ^ prng_successor(ad->nt, 64);
+		res->ks3 = ad->at_enc ^ prng_successor(ad->nt, 96);
+		struct Crypto1State *pcs = lfsr_recovery64(res->ks2, res->ks3);
+		if (pcs) {
+			res->state = *pcs;
+			crypto1_destroy(pcs);
+			res->key = mf_trace_state_key(res->state, ad, ad->nt);
+			res->src = MF_TRACE_KEY_FIRST;
+		}
+	} else if (lastkey && mf_trace_check_key(lastkey, ad, cmd, cmdsize, parity, res)) {
+		res->src = MF_TRACE_KEY_LAST;
+	} else {
+		for (int i = 0; i < MIFARE_DEFAULTKEYS_SIZE; i++) {
+			if (mf_trace_check_key(g_mifare_default_keys[i], ad, cmd, cmdsize, parity, res)) {
+				res->src = MF_TRACE_KEY_DEFAULT;
+				break;
+			}
+		}
+
+		bool nested = validate_prng_nonce(ad->nt);
+		if (res->src == MF_TRACE_KEY_NONE && (nested || hard)) {
+			mf_trace_pool_t *p = pool ? pool : mf_trace_pool_create(1);
+			if (p && nested && mf_trace_search(p, false, ad, cmd, cmdsize, parity, res))
+				res->src = MF_TRACE_KEY_NESTED;
+			if (p && res->src == MF_TRACE_KEY_NONE && hard) {
+				res->hard = true;
+				if (mf_trace_search(p, true, ad, cmd, cmdsize, parity, res))
+					res->src = MF_TRACE_KEY_HARD;
+			}
+			if (!pool)
+				mf_trace_pool_free(p);
+		}
+	}
+
+	res->msecs = msclock() - start;
+	return res->src != MF_TRACE_KEY_NONE;
+}
+
+// encrypts n bytes,  feeding in.  The parity bits go msb first like in the trace
+static void mf_trace_encrypt(struct Crypto1State *s, uint8_t *data, const uint8_t *in, int n, uint8_t *par) {
+	memset(par, 0, (n + 7) / 8);
+	for (int i = 0; i < n; i++) {
+		uint8_t b = data[i];
+		data[i] ^= crypto1_byte(s, in ? in[i] : 0, 0);
+		par[i / 8] |= (oddparity8(b) ^ filter(s->odd)) << (7 - i % 8);
+	}
+}
+
+bool mf_trace_hard_selftest(mf_trace_pool_t *pool, uint64_t key, uint64_t *msecs, uint32_t *candidates) {
+	TAuthData ad;
+	memset(&ad, 0, sizeof(ad));
+	uint8_t b[8], in[8], par[2];
+
+	// a nonce the weak prng can't make,  so only the hard search finds it
+	uint32_t nt;
+	do {
+		nt = (rand() & 0xFFFF) << 16 | (rand() & 0xFFFF);
+	} while (validate_prng_nonce(nt));
+	uint32_t nr = (rand() & 0xFFFF) << 16 | (rand() & 0xFFFF);
+	ad.uid = (rand() & 0xFFFF) << 16 | (rand() & 0xFFFF);
+	ad.nt = prng_successor(nt, 1000);
+
+	struct Crypto1State *s = crypto1_create(key);
+	num_to_bytes(nt, 4, b);
+	num_to_bytes(ad.uid ^ nt, 4, in);
+	mf_trace_encrypt(s, b, in, 4, par);
+	ad.nt_enc = bytes_to_num(b, 4);
+	ad.nt_enc_par = par[0];
+
+	num_to_bytes(nr, 4, b);
+	num_to_bytes(prng_successor(nt, 64), 4, b + 4);
+	memcpy(in, b, 4);
+	memset(in + 4, 0, 4);
+	mf_trace_encrypt(s, b, in, 8, par);
+	ad.nr_enc = bytes_to_num(b, 4);
+	ad.ar_enc = bytes_to_num(b + 4, 4);
+	ad.ar_enc_par = par[0] << 4;
+
+	num_to_bytes(prng_successor(nt, 96), 4, b);
+	mf_trace_encrypt(s, b, NULL, 4, par);
+	ad.at_enc = bytes_to_num(b, 4);
+	ad.at_enc_par = par[0];
+
+	// READBLOCK(4)
+	uint8_t cmd[4] = {ISO14443A_CMD_READBLOCK, 4};
+	compute_crc(CRC_14443_A, cmd, 2, &cmd[2], &cmd[3]);
+	uint8_t cmdpar[1];
+	mf_trace_encrypt(s, cmd, NULL, 4, cmdpar);
+	crypto1_destroy(s);
+
+	mf_trace_auth_t res;
+	memset(&res, 0, sizeof(res));
+	uint64_t start = msclock();
+	bool found = mf_trace_search(pool, true, &ad, cmd, sizeof(cmd), cmdpar, &res);
+	*msecs = msclock() - start;
+	*candidates = res.candidates;
+
+	return found && res.key == key && res.nt == nt;
+}
@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// MIFARE Classic trace decryption,  key recovery for one auth session
+//-----------------------------------------------------------------------------
+
+#ifndef MIFARETRACE_H__
+#define MIFARETRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cmdhflist.h"		// TAuthData
+#include "crapto1/crapto1.h"
+
+// nested auths are searched 91 .. 91 + 16382 prng steps after the last nonce
+#define MF_TRACE_NESTED_DIST	91
+#define MF_TRACE_NESTED_RANGE	16383
+// hard search,  the low 16 bits of nt
+#define MF_TRACE_HARD_RANGE		0x10000
+
+typedef enum {
+	MF_TRACE_KEY_NONE = 0,
+	MF_TRACE_KEY_FIRST,		// plain auth,  key rolled back from the keystream
+	MF_TRACE_KEY_LAST,		// last used key
+	MF_TRACE_KEY_DEFAULT,	// one of g_mifare_default_keys
+	MF_TRACE_KEY_NESTED,	// nonce search after the last nonce
+	MF_TRACE_KEY_HARD,		// search over all nonces,  hardened cards
+} mf_trace_key_t;
+
+typedef struct {
+	mf_trace_key_t src;
+	uint64_t key;
+	uint32_t nt;					// tag nonce,  decrypted
+	uint32_t ks2;
+	uint32_t ks3;
+	struct Crypto1State state;		// after the auth,  ready for the first data frame
+	uint32_t candidates;			// nonces passing the parity check
+	bool hard;						// the hard search ran
+	uint64_t msecs;
+} mf_trace_auth_t;
+
+typedef struct mf_trace_pool mf_trace_pool_t;
+
+// threads <= 0 uses all CPUs.  The caller is one of the threads.
+extern mf_trace_pool_t *mf_trace_pool_create(int threads);
+extern void mf_trace_pool_free(mf_trace_pool_t *pool);
+extern int mf_trace_pool_threads(mf_trace_pool_t *pool);
+
+// keys of the auth in ad,  cmd/parity is the first encrypted frame after it.
+// Tries lastkey (0 = none),  the default keys,  the nested nonces,  then with
+// hard all nonces.  The hard search takes about 512 lfsr_recovery64.
+extern bool mf_trace_resolve(mf_trace_pool_t *pool, TAuthData *ad, uint64_t lastkey, bool hard, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, mf_trace_auth_t *res);
+
+// synthetic hardened card session with a known key,  times the hard search.
+// Returns true if the key was found.
+extern bool mf_trace_hard_selftest(mf_trace_pool_t *pool, uint64_t key, uint64_t *msecs, uint32_t *candidates);
+
+#endif
@@ -29,6 +29,7 @@ void WorkerThread::run() {
 
 extern "C" void ShowGraphWindow(void)
 {
+	graphlod_touch();
 	if (!gui)
 		return;
 
@@ -45,6 +46,8 @@ extern "C" void HideGraphWindow(void)
 
 extern "C" void RepaintGraphWindow(void)
 {
+	// the plot pyramids rescan the buffers on next paint
+	graphlod_touch();
 	if (!gui)
 		return;
 
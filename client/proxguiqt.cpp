@@ -265,8 +265,9 @@ QColor Plot::getColor(int graphNum)
 	}
 }
 
-void Plot::setMaxAndStart(int *buffer, int len, QRect plotRect)
+void Plot::setMaxAndStart(graphlod_t *lod, QRect plotRect)
 {
+	int len = lod->len;
 	if (len == 0) return;
 	startMax = (len - (int)((plotRect.right() - plotRect.left() - 40) / GraphPixelsPerPoint));
 	if (startMax < 0) {
@@ -276,14 +277,11 @@ void Plot::setMaxAndStart(int *buffer, int len, QRect plotRect)
 		GraphStart = startMax;
 	}
 	if (GraphStart > len) return;
-	int vMin = INT_MAX, vMax = INT_MIN, v = 0;
-	int sample_index = GraphStart ;
-	for ( ; sample_index < len && xCoordOf(sample_index,plotRect) < plotRect.right() ; sample_index++) {
 
-		v = buffer[sample_index];
-		if (v < vMin) vMin = v;
-		if (v > vMax) vMax = v;
-	}
+	// visible samples are those with xCoordOf(i) < plotRect.right()
+	int end = GraphStart + (int)ceil((plotRect.right() - plotRect.left()) / GraphPixelsPerPoint);
+	int vMin, vMax;
+	graphlod_range(lod, GraphStart, end, &vMin, &vMax);
 
 	g_absVMax = 0;
 	if (fabs( (double) vMin) > g_absVMax) g_absVMax = (int)fabs( (double) vMin);
@@ -320,24 +318,33 @@ void Plot::PlotDemod(uint8_t *buffer, size_t len, QRect plotRect, QRect annotati
 	penPath.moveTo(x, y);
 	delta_x = 0;
 	int clk = first_delta_x;
-	for(int i = BitStart; i < (int)len && xCoordOf(delta_x+DemodStart, plotRect) < plotRect.right(); i++) {
-		for (int ii = 0; ii < (clk) && i < (int)len && xCoordOf(DemodStart+delta_x+ii, plotRect) < plotRect.right() ; ii++ ) {
-			x = xCoordOf(DemodStart+delta_x+ii, plotRect);
-			v = buffer[i]*200-100;
-
-			y = yCoordOf( v, plotRect, absVMax);
-
+	// samples with xCoordOf() < plotRect.right()
+	int visible = (int)ceil((plotRect.right() - plotRect.left()) / GraphPixelsPerPoint) - (DemodStart - GraphStart);
+	for(int i = BitStart; i < (int)len && delta_x < visible; i++) {
+		// a bit is flat, only its first and last visible sample go into the path
+		int n = clk;
+		if (n > visible - delta_x) n = visible - delta_x;
+		v = buffer[i]*200-100;
+		y = yCoordOf( v, plotRect, absVMax);
+		if (n > 0) {
+			penPath.lineTo(xCoordOf(DemodStart+delta_x, plotRect), y);
+			x = xCoordOf(DemodStart+delta_x+n-1, plotRect);
 			penPath.lineTo(x, y);
+		}
 
-			if(GraphPixelsPerPoint > 10) {
+		if(GraphPixelsPerPoint > 10) {
+			for (int ii = 0; ii < n; ii++) {
+				x = xCoordOf(DemodStart+delta_x+ii, plotRect);
 				QRect f(QPoint(x - 3, y - 3),QPoint(x + 3, y + 3));
 				painter->fillRect(f, QColor(100, 255, 100));
 			}
-			if (ii == (int)clk/2) {
-				//print label
-				sprintf(str, "%u",buffer[i]);
-				painter->drawText(x-8, y + ((buffer[i] > 0) ? 18 : -6), str);
-			}
+		}
+		// labels would overlap when zoomed out
+		if (clk/2 < n && clk * GraphPixelsPerPoint >= 8) {
+			//print label
+			x = xCoordOf(DemodStart+delta_x+clk/2, plotRect);
+			sprintf(str, "%u",buffer[i]);
+			painter->drawText(x-8, y + ((buffer[i] > 0) ? 18 : -6), str);
 		}
 		delta_x += clk;
 		clk = grid_delta_x;
@@ -347,33 +354,49 @@ void Plot::PlotDemod(uint8_t *buffer, size_t len, QRect plotRect, QRect annotati
 	painter->drawPath(penPath);
 }
 
-void Plot::PlotGraph(int *buffer, int len, QRect plotRect, QRect annotationRect, QPainter *painter, int graphNum) {
+void Plot::PlotGraph(graphlod_t *lod, QRect plotRect, QRect annotationRect, QPainter *painter, int graphNum) {
+	int len = lod->len;
+	const int *buffer = lod->buf;
 	if (len == 0) return;
 	// clock_t begin = clock();
 	QPainterPath penPath;
 	int vMin = INT_MAX, vMax = INT_MIN, vMean = 0, v = 0, i = 0;
 	int x = xCoordOf(GraphStart, plotRect);
 	int y = yCoordOf(buffer[GraphStart], plotRect, g_absVMax);
-	penPath.moveTo(x, y);
-	for(i = GraphStart; i < len && xCoordOf(i, plotRect) < plotRect.right(); i++) {
 
-		x = xCoordOf(i, plotRect);
-		v = buffer[i];
+	if (GraphPixelsPerPoint < 1) {
+		// zoomed out, one vertical min/max span per pixel column from the pyramid
+		int width = plotRect.right() - x;
+		graphlod_span_t *cols = new graphlod_span_t[width > 0 ? width : 1];
+		int ncols = graphlod_columns(lod, GraphStart, GraphPixelsPerPoint, width, cols);
+		for (int c = 0; c < ncols; c++) {
+			penPath.moveTo(x + c, yCoordOf(cols[c].max, plotRect, g_absVMax));
+			penPath.lineTo(x + c, yCoordOf(cols[c].min, plotRect, g_absVMax));
+		}
+		delete[] cols;
+		i = GraphStart + (int)ceil(ncols / GraphPixelsPerPoint);
+		if (i > len) i = len;
+	} else {
+		penPath.moveTo(x, y);
+		for(i = GraphStart; i < len && xCoordOf(i, plotRect) < plotRect.right(); i++) {
+
+			x = xCoordOf(i, plotRect);
+			v = buffer[i];
 
-		y = yCoordOf( v, plotRect, g_absVMax);
+			y = yCoordOf( v, plotRect, g_absVMax);
 
-		penPath.lineTo(x, y);
+			penPath.lineTo(x, y);
 
-		if (GraphPixelsPerPoint > 10) {
-			QRect f(QPoint(x - 3, y - 3),QPoint(x + 3, y + 3));
-			painter->fillRect(f, QColor(100, 255, 100));
+			if (GraphPixelsPerPoint > 10) {
+				QRect f(QPoint(x - 3, y - 3),QPoint(x + 3, y + 3));
+				painter->fillRect(f, QColor(100, 255, 100));
+			}
 		}
-		// catch stats
-		if (v < vMin) vMin = v;
-		if (v > vMax) vMax = v;
-		vMean += v;
 	}
-	vMean /= (i - GraphStart);
+	// catch stats
+	graphlod_range(lod, GraphStart, i, &vMin, &vMax);
+	if (i > GraphStart)
+		vMean = (int)(graphlod_sum(lod, GraphStart, i) / (i - GraphStart));
 
 	painter->setPen(getColor(graphNum));
 
@@ -483,8 +506,9 @@ void Plot::paintEvent(QPaintEvent *event)
 	//Black foreground
 	painter.fillRect(plotRect, QColor(0, 0, 0));
 
-	//init graph variables
-	setMaxAndStart(GraphBuffer,GraphTraceLen,plotRect);
+	//init graph variables,  the pyramids only rescan after graphlod_touch()
+	graphlod_update(&lodGraph, GraphBuffer, GraphTraceLen, false);
+	setMaxAndStart(&lodGraph, plotRect);
 
 	// center line
 	int zeroHeight = plotRect.top() + (plotRect.bottom() - plotRect.top()) / 2;
@@ -494,14 +518,15 @@ void Plot::paintEvent(QPaintEvent *event)
 	plotGridLines(&painter, plotRect);
 
 	//Start painting graph
-	PlotGraph(GraphBuffer, GraphTraceLen,plotRect,infoRect,&painter,0);
+	PlotGraph(&lodGraph, plotRect,infoRect,&painter,0);
 	if (showDemod && DemodBufferLen	> 8) {
 		PlotDemod(DemodBuffer, DemodBufferLen,plotRect,infoRect,&painter,2,g_DemodStartIdx);
 	}
 	if (g_useOverlays) {
 		//init graph variables
-		setMaxAndStart(s_Buff,GraphTraceLen,plotRect);
-		PlotGraph(s_Buff, GraphTraceLen,plotRect,infoRect,&painter,1);
+		graphlod_update(&lodOverlay, s_Buff, GraphTraceLen, false);
+		setMaxAndStart(&lodOverlay, plotRect);
+		PlotGraph(&lodOverlay, plotRect,infoRect,&painter,1);
 	}
 	// End graph drawing
 
@@ -559,6 +584,15 @@ Plot::Plot(QWidget *parent) : QWidget(parent), GraphStart(0), GraphPixelsPerPoin
 	setWindowTitle(tr("Sliders"));
 	
 	master = parent;
+
+	graphlod_init(&lodGraph);
+	graphlod_init(&lodOverlay);
+}
+
+Plot::~Plot(void)
+{
+	graphlod_free(&lodGraph);
+	graphlod_free(&lodOverlay);
 }
 
 void Plot::closeEvent(QCloseEvent *event)
@@ -22,6 +22,7 @@
 #include <QtGui>
 
 #include "ui/ui_overlays.h"
+#include "graphlod.h"
 
 class ProxWidget;
 
@@ -36,17 +37,20 @@ class Plot: public QWidget
 		double GraphPixelsPerPoint;
 		int CursorAPos;
 		int CursorBPos;
-		void PlotGraph(int *buffer, int len, QRect r,QRect r2, QPainter* painter, int graphNum);
+		graphlod_t lodGraph;    // min/max pyramids of GraphBuffer and s_Buff
+		graphlod_t lodOverlay;
+		void PlotGraph(graphlod_t *lod, QRect r,QRect r2, QPainter* painter, int graphNum);
 		void PlotDemod(uint8_t *buffer, size_t len, QRect r,QRect r2, QPainter* painter, int graphNum, int plotOffset);
 		void plotGridLines(QPainter* painter,QRect r);
 		int xCoordOf(int i, QRect r );
 		int yCoordOf(int v, QRect r, int maxVal);
 		int valueOf_yCoord(int y, QRect r, int maxVal);
-		void setMaxAndStart(int *buffer, int len, QRect plotRect);
+		void setMaxAndStart(graphlod_t *lod, QRect plotRect);
 		QColor getColor(int graphNum);
 
 	public:
 		Plot(QWidget *parent = 0);
+		~Plot(void);
 
 	protected:
 		void paintEvent(QPaintEvent *event);
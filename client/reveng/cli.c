@@ -52,6 +52,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include "getopt.h"
 #ifdef _WIN32
 #  include <io.h>
@@ -66,6 +67,7 @@
 static FILE *oread(const char *);
 static poly_t rdpoly(const char *, int, int);
 static void usage(void);
+static void usrch(unsigned long done, unsigned long total, int found, void *ctx);
 
 static const char *myname = "reveng"; /* name of our program */
 
@@ -85,6 +87,8 @@ int reveng_main(int argc, char *argv[]) {
 	poly_t apoly, crc, qpoly = PZERO, *apolys, *pptr = NULL, *qptr = NULL;
 	model_t pset = model, *candmods, *mptr;
 	char *string;
+	reveng_opts_t sopts = {0, 0, 0, usrch, NULL};
+	time_t slast = 0;
 
 	myname = argv[0];
 
@@ -98,7 +102,7 @@ int reveng_main(int argc, char *argv[]) {
 	pos=0;
 	optind=1;
 	do {
-		c=getopt(argc, argv, "?A:BDFGLMP:SVXa:bcdefhi:k:lm:p:q:rstuvw:x:yz");
+		c=getopt(argc, argv, "?A:BDFGLMP:SVXa:bcdefhi:j:k:lm:n:p:q:rstuvw:x:yz");
 		switch(c) {
 			case 'A': /* A: bits per output character */
 			case 'a': /* a: bits per character */
@@ -153,6 +157,12 @@ int reveng_main(int argc, char *argv[]) {
 				return 0;
 				//exit(EXIT_FAILURE);
 				break;
+			case 'j': /* j: search threads */
+				sopts.threads = atoi(optarg);
+				break;
+			case 'n': /* n: stop search after n models */
+				sopts.maxresults = atoi(optarg);
+				break;
 			case 'i': /* i: Init value */
 				pptr = &model.init;
 				rflags |= R_HAVEI;
@@ -457,7 +467,8 @@ ipqx:
 			}
 			pass = 0;
 			do {
-				mptr = candmods = reveng(&model, qpoly, rflags, args, apolys);
+				sopts.ctx = &slast;
+				mptr = candmods = reveng_mt(&model, qpoly, rflags, args, apolys, &sopts);
 				if(mptr && plen(mptr->spoly))
 					uflags |= C_RESULT;
 				while(mptr && plen(mptr->spoly)) {
@@ -528,6 +539,20 @@ uprog(const poly_t gpoly, int flags, unsigned long seq) {
 	free(string);
 }
 
+static void
+usrch(unsigned long done, unsigned long total, int found, void *ctx) {
+	/* Progress callback for the threaded search, at most every 5 seconds */
+	time_t *last = (time_t *) ctx, now = time(NULL);
+
+	if(!*last)
+		*last = now;
+	if(now - *last < 5 || done == total)
+		return;
+	*last = now;
+	fprintf(stderr, "%s: searching: %lu/%lu units (%lu%%)  %d found\n",
+			myname, done, total, done * 100UL / total, found);
+}
+
 static poly_t
 rdpoly(const char *name, int flags, int bperhx) {
 	/* read poly from file in chunks and report errors */
@@ -583,13 +608,16 @@ usage(void) {
 			"\t-cdDesvhu? [-bBfFGlLMrStVXyz]\n"
 			"\t\t[-a BITS] [-A OBITS] [-i INIT] [-k KPOLY] [-m MODEL]\n"
 			"\t\t[-p POLY] [-P RPOLY] [-q QPOLY] [-w WIDTH] [-x XOROUT]\n"
+			"\t\t[-j THREADS] [-n COUNT]\n"
 			"\t\t[STRING...]\n"
 			"Options:\n"
 			"\t-a BITS\t\tbits per character (1 to %d)\n"
 			"\t-A OBITS\tbits per output character (1 to %d)\n"
 			"\t-i INIT\t\tinitial register value\n"
+			"\t-j THREADS\tsearch threads (default one per CPU)\n"
 			"\t-k KPOLY\tgenerator in Koopman notation (implies WIDTH)\n"
 			"\t-m MODEL\tpreset CRC algorithm\n"
+			"\t-n COUNT\tstop the search after COUNT models\n"
 			"\t-p POLY\t\tgenerator or search range start polynomial\n"
 			"\t-P RPOLY\treversed generator polynomial (implies WIDTH)\n",
 			BMP_BIT, BMP_BIT);
@@ -612,6 +640,7 @@ usage(void) {
 			"\t-D list preset algorithms\t-e echo (and reformat) input\n"
 			"\t-s search for algorithm\t\t-v calculate reversed CRCs\n"
 			"\t-g search for alg given hex+crc\t-h | -u | -? show this help\n"
+			"\t-T [BYTES] test and benchmark the table driven engine on BYTES long input\n"
 			"Common Use Examples:\n"
 			"\t   reveng -g 01020304e3\n"
 			"\t      Searches for a known/common crc preset that computes the crc\n"
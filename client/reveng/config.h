@@ -74,15 +74,27 @@
  * and bmpsub, global objects initialised at run time.
  */
 
-/* Size in bits of a bmp_t.  Not necessarily a power of two. */
+/* Size in bits of a bmp_t.  Not necessarily a power of two.
+ * unsigned long is 64 bits on LP64 targets,  the code assumes every bit
+ * of a bmp_t is used so this has to follow the platform.
+ */
 
+#include <limits.h>
+#if ULONG_MAX > 0xffffffffUL
+#define BMP_BIT   64
+#else
 #define BMP_BIT   32
+#endif
 
 /* The highest power of two that is strictly less than BMP_BIT.
  * Initialises the index of a binary search for set bits in a bmp_t.
  */
 
+#if ULONG_MAX > 0xffffffffUL
+#define BMP_SUB   32
+#else
 #define BMP_SUB   16
+#endif
 
 /*****************************************
  *					 *
@@ -49,6 +49,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
 
 #define FILE void
 #include "reveng.h"
@@ -61,13 +68,274 @@ static void chkres(int *resc, model_t **result, const poly_t divisor, const poly
 
 static const poly_t pzero = PZERO;
 
+/* Polynomial search work units.
+ * The search range is split on the R_UNITBITS terms below the leading
+ * terms its start and end have in common, so a narrow -p/-q range is
+ * divided as finely as a full one.  Threads pull units in ascending order
+ * and keep their own result list per unit; the lists are joined in unit
+ * order afterwards so the output is the same as a serial search.
+ */
+#define R_UNITBITS 12
+#define R_MAXUBITS (sizeof(unsigned long) * 8UL - 2UL)
+
+typedef struct {
+	const model_t *guess;
+	const poly_t *qpoly;
+	int rflags;
+	int args;
+	const poly_t *argpolys;
+	const poly_t *pworks;
+	const reveng_opts_t *opts;
+	unsigned long width, ubits, first, last;
+	pthread_mutex_t lock;
+	unsigned long next, done, prefix, seq;
+	int found, prefixfound;
+	volatile int stop;
+	int *unitresc;
+	model_t **unitres;
+} rsearch_t;
+
+static int
+ncpus(void) {
+	/* Logical CPUs, the default number of search threads */
+#if defined(_WIN32)
+	SYSTEM_INFO sysinfo;
+
+	GetSystemInfo(&sysinfo);
+	return (int) sysinfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (int) n : 1;
+#else
+	return 1;
+#endif
+}
+
+static int
+pbit(const poly_t poly, unsigned long i) {
+	/* Coefficient of the i-th term from the top */
+	return (int) ((poly.bitmap[i / BMP_BIT] >> (BMP_BIT - 1 - i % BMP_BIT)) & 1UL);
+}
+
+static unsigned long
+pgetpfx(const poly_t poly, unsigned long bits) {
+	/* Read the top bits terms of poly as an integer */
+	unsigned long i, pfx = 0UL;
+
+	for(i = 0UL; i < bits && i < poly.length; ++i)
+		pfx = (pfx << 1) | (unsigned long) pbit(poly, i);
+	for(; i < bits; ++i)
+		pfx <<= 1;
+	return(pfx);
+}
+
+static void
+psetpfx(poly_t *poly, unsigned long width, unsigned long bits, unsigned long pfx) {
+	/* Make poly a width term poly with pfx in the top bits terms */
+	unsigned long i;
+
+	palloc(poly, width);
+	for(i = 0UL; i < bits; ++i)
+		if(pfx >> (bits - 1UL - i) & 1UL)
+			poly->bitmap[i / BMP_BIT] |= BMP_C(1) << (BMP_BIT - 1 - i % BMP_BIT);
+}
+
+static void
+srchunit(rsearch_t *s, unsigned long unit, unsigned long *spin, int *resc, model_t **result) {
+	/* Search the polys of one work unit, low term clear on entry.
+	 * spin counts the polys tried by the calling thread.
+	 */
+	const model_t *guess = s->guess;
+	const poly_t *wptr;
+	poly_t gpoly = PZERO, uend = PZERO, rem;
+	int hasend = unit < (1UL << s->ubits) - 1UL;
+
+	if(unit == s->first) {
+		gpoly = pclone(guess->spoly);
+		if(plen(gpoly))
+			pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
+	} else
+		psetpfx(&gpoly, s->width, s->ubits, unit);
+	if(hasend)
+		psetpfx(&uend, s->width, s->ubits, unit + 1UL);
+
+	while(!s->stop && piter(&gpoly)
+			&& (~s->rflags & R_HAVEQ || pcmp(&gpoly, s->qpoly) < 0)
+			&& (!hasend || pcmp(&gpoly, &uend) < 0)) {
+		/* For each possible poly of this size, try
+		 * dividing all the differences in the list.
+		 */
+		if(!((*spin)++ & R_SPMASK) && !(s->opts && s->opts->quiet)) {
+			pthread_mutex_lock(&s->lock);
+			uprog(gpoly, guess->flags, s->seq++);
+			pthread_mutex_unlock(&s->lock);
+		}
+		for(wptr = s->pworks; plen(*wptr); ++wptr) {
+			/* straight divide message by poly, don't multiply by x^n */
+			rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
+			if(ptst(rem)) {
+				pfree(&rem);
+				break;
+			} else
+				pfree(&rem);
+		}
+		/* If gpoly divides all the differences, it is a
+		 * candidate.  Search for an Init value for this
+		 * poly or if Init is known, log the result.
+		 */
+		if(!plen(*wptr)) {
+			/* gpoly is a candidate poly */
+			if(s->rflags & R_HAVEI && s->rflags & R_HAVEX)
+				chkres(resc, result, gpoly, guess->init, guess->flags, guess->xorout, s->args, s->argpolys);
+			else if(s->rflags & R_HAVEI)
+				calout(resc, result, gpoly, guess->init, guess->flags, s->args, s->argpolys);
+			else if(s->rflags & R_HAVEX)
+				calini(resc, result, gpoly, guess->flags, guess->xorout, s->args, s->argpolys);
+			else
+				engini(resc, result, gpoly, guess->flags, s->args, s->argpolys);
+		}
+		if(!piter(&gpoly))
+			break;
+	}
+	pfree(&gpoly);
+	pfree(&uend);
+}
+
+static void *
+srchthread(void *arg) {
+	rsearch_t *s = (rsearch_t *) arg;
+	unsigned long unit, spin = 0UL;
+	int resc;
+	model_t *result;
+
+	for(;;) {
+		pthread_mutex_lock(&s->lock);
+		if(s->stop || s->next > s->last) {
+			pthread_mutex_unlock(&s->lock);
+			break;
+		}
+		unit = s->next++;
+		pthread_mutex_unlock(&s->lock);
+
+		resc = 0;
+		result = NULL;
+		srchunit(s, unit, &spin, &resc, &result);
+
+		pthread_mutex_lock(&s->lock);
+		s->unitres[unit - s->first] = result;
+		s->unitresc[unit - s->first] = resc;
+		s->found += resc;
+		++s->done;
+		/* stop once the units before any still running hold the count,
+		 * so the first models are those of a serial search
+		 */
+		while(s->prefix < s->last - s->first + 1UL && s->unitresc[s->prefix] >= 0)
+			s->prefixfound += s->unitresc[s->prefix++];
+		if(s->opts && s->opts->maxresults > 0 && s->prefixfound >= s->opts->maxresults)
+			s->stop = 1;
+		if(s->opts && s->opts->progress)
+			s->opts->progress(s->done, s->last - s->first + 1UL, s->found, s->opts->ctx);
+		pthread_mutex_unlock(&s->lock);
+	}
+	return NULL;
+}
+
+static void
+psearch(int *resc, model_t **result, const model_t *guess, const poly_t *qpoly, int rflags, int args, const poly_t *argpolys, const poly_t *pworks, const reveng_opts_t *opts) {
+	/* Brute force search for the poly over a pool of threads */
+	rsearch_t s;
+	pthread_t *threads;
+	unsigned long units, u, same;
+	int nthreads, i, j, limit, haveq;
+
+	memset(&s, 0, sizeof(s));
+	s.guess = guess;
+	s.qpoly = qpoly;
+	s.rflags = rflags;
+	s.args = args;
+	s.argpolys = argpolys;
+	s.pworks = pworks;
+	s.opts = opts;
+	s.width = plen(guess->spoly);
+	haveq = rflags & R_HAVEQ && plen(*qpoly) == s.width;
+
+	/* split the range below the leading terms its ends share */
+	for(same = 0UL; same < s.width; ++same)
+		if(pbit(guess->spoly, same) != (haveq ? pbit(*qpoly, same) : 1))
+			break;
+	s.ubits = same + R_UNITBITS;
+	if(s.ubits > R_MAXUBITS)
+		s.ubits = R_MAXUBITS;
+	if(s.ubits > s.width - 1UL)
+		s.ubits = s.width ? s.width - 1UL : 0UL;
+	s.first = pgetpfx(guess->spoly, s.ubits);
+	s.last = haveq ? pgetpfx(*qpoly, s.ubits) : (1UL << s.ubits) - 1UL;
+	if(s.last < s.first)
+		return;
+	s.next = s.first;
+	units = s.last - s.first + 1UL;
+
+	s.unitres = calloc(units, sizeof(model_t *));
+	s.unitresc = calloc(units, sizeof(int));
+	if(!s.unitres || !s.unitresc) {
+		free(s.unitres);
+		free(s.unitresc);
+		uerror("cannot allocate search units");
+		return;
+	}
+	/* -1 until the unit is searched */
+	for(u = 0UL; u < units; ++u)
+		s.unitresc[u] = -1;
+	pthread_mutex_init(&s.lock, NULL);
+
+	nthreads = opts && opts->threads > 0 ? opts->threads : ncpus();
+	if((unsigned long) nthreads > units)
+		nthreads = (int) units;
+	threads = nthreads > 1 ? calloc(nthreads, sizeof(pthread_t)) : NULL;
+	if(threads) {
+		for(i = 0; i < nthreads; ++i)
+			pthread_create(&threads[i], NULL, srchthread, &s);
+		for(i = 0; i < nthreads; ++i)
+			pthread_join(threads[i], NULL);
+		free(threads);
+	} else
+		srchthread(&s);
+
+	pthread_mutex_destroy(&s.lock);
+
+	/* join the unit lists in search order, trimmed to the requested count */
+	limit = opts && opts->maxresults > 0 ? opts->maxresults : -1;
+	for(u = 0UL; u < units; ++u) {
+		for(j = 0; j < s.unitresc[u]; ++j) {
+			if(limit >= 0 && *resc >= limit) {
+				mfree(&s.unitres[u][j]);
+				continue;
+			}
+			if(!(*result = realloc(*result, ++*resc * sizeof(model_t)))) {
+				uerror("cannot reallocate result array");
+				*resc = 0;
+				break;
+			}
+			(*result)[*resc - 1] = s.unitres[u][j];
+		}
+		free(s.unitres[u]);
+	}
+	free(s.unitres);
+	free(s.unitresc);
+}
+
 model_t *
 reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys) {
+	return reveng_mt(guess, qpoly, rflags, args, argpolys, NULL);
+}
+
+model_t *
+reveng_mt(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys, const reveng_opts_t *opts) {
 	/* Complete the parameters of a model by calculation or brute search. */
-	poly_t *pworks, *wptr, rem, gpoly;
+	poly_t *pworks, *wptr;
 	model_t *result = NULL, *rptr;
-	int resc = 0;
-	unsigned long spin = 0, seq = 0;
+	int resc = 0, i;
 
 	if(~rflags & R_HAVEP) {
 		/* The poly is not known.
@@ -78,52 +346,9 @@ reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const pol
 			free(pworks);
 			goto requit;
 		}
-		/* Initialise the guessed poly to the starting value. */
-		gpoly = pclone(guess->spoly);
-		/* Clear the least significant term, to be set in the
-		 * loop. qpoly does not need fixing as it is only
-		 * compared with odd polys.
+		psearch(&resc, &result, guess, &qpoly, rflags, args, argpolys, pworks, opts);
+		/* Finished with the differences list, free it.
 		 */
-		if(plen(gpoly))
-			pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
-
-		while(piter(&gpoly) && (~rflags & R_HAVEQ || pcmp(&gpoly, &qpoly) < 0)) {
-			/* For each possible poly of this size, try
-			 * dividing all the differences in the list.
-			 */
-			if(!(spin++ & R_SPMASK)) {
-				uprog(gpoly, guess->flags, seq++);
-			}
-			for(wptr = pworks; plen(*wptr); ++wptr) {
-				/* straight divide message by poly, don't multiply by x^n */
-				rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
-				if(ptst(rem)) {
-					pfree(&rem);
-					break;
-				} else
-					pfree(&rem);
-			}
-			/* If gpoly divides all the differences, it is a
-			 * candidate.  Search for an Init value for this
-			 * poly or if Init is known, log the result.
-			 */
-			if(!plen(*wptr)) {
-				/* gpoly is a candidate poly */
-				if(rflags & R_HAVEI && rflags & R_HAVEX)
-					chkres(&resc, &result, gpoly, guess->init, guess->flags, guess->xorout, args, argpolys);
-				else if(rflags & R_HAVEI)
-					calout(&resc, &result, gpoly, guess->init, guess->flags, args, argpolys);
-				else if(rflags & R_HAVEX)
-					calini(&resc, &result, gpoly, guess->flags, guess->xorout, args, argpolys);
-				else
-					engini(&resc, &result, gpoly, guess->flags, args, argpolys);
-			}
-			if(!piter(&gpoly))
-				break;
-		}
-		/* Finished with gpoly and the differences list, free them.
-		 */
-		pfree(&gpoly);
 		for(wptr = pworks; plen(*wptr); ++wptr)
 			pfree(wptr);
 		free(pworks);
@@ -142,6 +367,10 @@ reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const pol
 		engini(&resc, &result, guess->spoly, guess->flags, args, argpolys);
 
 requit:
+	/* notify the models found, in search order */
+	for(i = 0; i < resc && !(opts && opts->quiet); ++i)
+		ufound(result + i);
+
 	if(!(result = realloc(result, ++resc * sizeof(model_t)))) {
 		uerror("cannot reallocate result array");
 		return NULL;
@@ -492,7 +721,4 @@ chkres(int *resc, model_t **result, const poly_t divisor, const poly_t init, int
 
 	/* compute check value for this model */
 	mcheck(rptr);
-
-	/* callback to notify new model */
-	ufound(rptr);
 }
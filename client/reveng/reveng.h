@@ -205,7 +205,23 @@ extern void mmatch(model_t *model, int flags);
 
 #define R_SPMASK 0x7FFFFFFUL
 
+/* Options for the threaded polynomial search.
+ * threads <= 0 uses one thread per logical CPU.  The search stops once
+ * maxresults models are found, 0 is unlimited.  progress, if set, is
+ * called after each work unit with the units done, the unit total and
+ * the models found so far; calls are serialised.  quiet suppresses the
+ * uprog() progress reports and the ufound() notification of each model.
+ */
+typedef struct {
+	int threads;
+	int maxresults;
+	int quiet;
+	void (*progress)(unsigned long done, unsigned long total, int found, void *ctx);
+	void *ctx;
+} reveng_opts_t;
+
 extern model_t *reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys);
+extern model_t *reveng_mt(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys, const reveng_opts_t *opts);
 
 /* cli.c */
 #define C_INFILE  1
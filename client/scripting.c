@@ -282,10 +282,7 @@ static int l_aes128decrypt_cbc(lua_State *L) {
 		aes_key[i / 2] = tmp & 0xFF;
 	}
 
-    aes_context ctx;
-    aes_init(&ctx);
-	aes_setkey_dec(&ctx, aes_key, 128);
-	aes_crypt_cbc(&ctx, AES_DECRYPT, sizeof(indata), iv, indata, outdata );
+	bc_aes128_cbc(aes_key, BC_DECRYPT, iv, indata, outdata, sizeof(indata));
     //Push decrypted array as a string
 	lua_pushlstring(L,(const char *)&outdata, sizeof(outdata));
 	return 1;// return 1 to signal one return value
@@ -311,10 +308,7 @@ static int l_aes128decrypt_ecb(lua_State *L) {
 		sscanf(&p_key[i], "%02x", &tmp);
 		aes_key[i / 2] = tmp & 0xFF;
 	}
-    aes_context ctx;
-    aes_init(&ctx);
-	aes_setkey_dec(&ctx, aes_key, 128);
-	aes_crypt_ecb(&ctx, AES_DECRYPT, indata, outdata );
+	bc_aes128_ecb(aes_key, BC_DECRYPT, indata, outdata, sizeof(indata));
 
     //Push decrypted array as a string
 	lua_pushlstring(L,(const char *)&outdata, sizeof(outdata));
@@ -343,10 +337,7 @@ static int l_aes128encrypt_cbc(lua_State *L) {
 		aes_key[i / 2] = tmp & 0xFF;
 	}
 
-    aes_context ctx;
-    aes_init(&ctx);
-	aes_setkey_enc(&ctx, aes_key, 128);
-	aes_crypt_cbc(&ctx, AES_ENCRYPT, sizeof(indata), iv, indata, outdata );
+	bc_aes128_cbc(aes_key, BC_ENCRYPT, iv, indata, outdata, sizeof(indata));
 	//Push encrypted array as a string
 	lua_pushlstring(L,(const char *)&outdata, sizeof(outdata));
 	return 1;// return 1 to signal one return value
@@ -372,10 +363,7 @@ static int l_aes128encrypt_ecb(lua_State *L) {
 		sscanf(&p_key[i], "%02x", &tmp);
 		aes_key[i / 2] = tmp & 0xFF;
 	}	
-    aes_context ctx;
-    aes_init(&ctx);
-	aes_setkey_enc(&ctx, aes_key, 128);
-	aes_crypt_ecb(&ctx, AES_ENCRYPT, indata, outdata );
+	bc_aes128_ecb(aes_key, BC_ENCRYPT, indata, outdata, sizeof(indata));
 	//Push encrypted array as a string
 	lua_pushlstring(L,(const char *)&outdata, sizeof(outdata));
 	return 1;// return 1 to signal one return value
@@ -24,6 +24,7 @@
 #include "crc64.h"
 #include "sha1.h"
 #include "aes.h"
+#include "blockcipher.h"
 #include "cmdcrc.h"
 #include "cmdhfmfhard.h"
 #include "cmdhfmfu.h"
@@ -0,0 +1,225 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Sniff sample replay,  see sniffreplay.h
+//-----------------------------------------------------------------------------
+
+#include "sniffreplay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>		// __rdtsc
+#endif
+#include "tracecompact.h"		// tracelog_put
+#include "ui.h"
+
+#define SNIFFREPLAY_TRACE_CHUNK		0x10000
+
+//-----------------------------------------------------------------------------
+// synthetic sessions
+//-----------------------------------------------------------------------------
+uint32_t sniffreplay_rand(sniffreplay_ticks_t *t) {
+	t->seed = t->seed * 1103515245 + 12345;
+	return t->seed >> 16;
+}
+
+bool sniffreplay_grow(sniffreplay_ticks_t *t, size_t n) {
+	if (t->len + n > t->size) {
+		size_t size = (t->size + n) * 2;
+		uint8_t *reader = realloc(t->reader, size);
+		if (reader == NULL)
+			return false;
+		t->reader = reader;
+		uint8_t *tag = realloc(t->tag, size);
+		if (tag == NULL)
+			return false;
+		t->tag = tag;
+		t->size = size;
+	}
+	memset(t->reader + t->len, 1, n);
+	memset(t->tag + t->len, 0, n);
+	return true;
+}
+
+size_t sniffreplay_samples(sniffreplay_ticks_t *t, bool ok, uint8_t **samples) {
+	*samples = NULL;
+	size_t len = ok ? (t->len + SNIFFREPLAY_TICKS - 1) / SNIFFREPLAY_TICKS : 0;
+	uint8_t *out = ok ? calloc(len, sizeof(uint8_t)) : NULL;
+	ok = out && sniffreplay_grow(t, SNIFFREPLAY_TICKS);
+	for (size_t i = 0; ok && i < len * SNIFFREPLAY_TICKS; i++) {
+		uint8_t shift = 3 - (i % SNIFFREPLAY_TICKS);
+		out[i / SNIFFREPLAY_TICKS] |= (t->reader[i] << (shift + 4)) | (t->tag[i] << shift);
+	}
+	free(t->reader);
+	free(t->tag);
+	memset(t, 0, sizeof(*t));
+	if (!ok) {
+		free(out);
+		return 0;
+	}
+	*samples = out;
+	return len;
+}
+
+bool sniffreplay_log(uint8_t **trace, uint32_t *traceLen, uint32_t *traceSize, const uint8_t *data, uint16_t len,
+					 uint32_t start, uint32_t end, const uint8_t *parity, bool readerToTag) {
+	uint32_t recordLen = TRACELOG_HDR + len + tracelog_paritybytes(len);
+	if (*traceLen + recordLen > *traceSize) {
+		uint32_t size = *traceSize + SNIFFREPLAY_TRACE_CHUNK + recordLen;
+		uint8_t *buf = realloc(*trace, size);
+		if (buf == NULL)
+			return false;
+		*trace = buf;
+		*traceSize = size;
+	}
+	tracelog_put(*trace + *traceLen, data, len, start, end - start, parity, readerToTag);
+	*traceLen += recordLen;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// sample files
+//-----------------------------------------------------------------------------
+static uint8_t *sniffreplay_read_file(const char *filename, size_t *len) {
+	FILE *f = fopen(filename, "rb");
+	if (f == NULL)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *buf = (size > 0) ? malloc(size) : NULL;
+	if (buf && fread(buf, 1, size, f) != (size_t)size) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	*len = buf ? size : 0;
+	return buf;
+}
+
+static bool sniffreplay_write_file(const char *filename, const uint8_t *data, size_t len) {
+	FILE *f = fopen(filename, "wb");
+	if (f == NULL)
+		return false;
+	bool ok = fwrite(data, 1, len, f) == len;
+	return (fclose(f) == 0) && ok;
+}
+
+// reader and tag frames of a trace
+static void sniffreplay_frames(const uint8_t *trace, uint32_t traceLen, uint32_t *reader, uint32_t *tag) {
+	*reader = *tag = 0;
+	for (uint32_t pos = 0; pos + TRACELOG_HDR <= traceLen; ) {
+		uint16_t len = (trace[pos + 6] | (trace[pos + 7] << 8)) & 0x7FFF;
+		if (trace[pos + 7] & 0x80)
+			(*tag)++;
+		else
+			(*reader)++;
+		pos += TRACELOG_HDR + len + tracelog_paritybytes(len);
+	}
+}
+
+bool sniffreplay_check_files(const sniffreplay_files_t *p, const char *dir, bool verbose) {
+	char filename[512];
+	uint32_t found = 0, failed = 0;
+	for (uint32_t i = 0; i < p->n; i++) {
+		const sniffreplay_file_t *rf = &p->files[i];
+		size_t len, tlen;
+		snprintf(filename, sizeof(filename), "%s%s.raw", dir, rf->name);
+		uint8_t *samples = sniffreplay_read_file(filename, &len);
+		snprintf(filename, sizeof(filename), "%s%s.trace", dir, rf->name);
+		uint8_t *trace = sniffreplay_read_file(filename, &tlen);
+		if (samples == NULL || trace == NULL) {
+			free(samples);
+			free(trace);
+			continue;
+		}
+		found++;
+
+		uint8_t *rtrace = NULL;
+		uint32_t rlen = 0, reader = 0, tag = 0;
+		bool ok = (p->decode(samples, len, &rtrace, &rlen) == 0) && rlen == tlen && memcmp(rtrace, trace, tlen) == 0;
+		ok = ok && (p->check == NULL || p->check(samples, len, rtrace, rlen, rf, verbose));
+		sniffreplay_frames(rtrace, rlen, &reader, &tag);
+		if (verbose || !ok)
+			PrintAndLogEx(ok ? SUCCESS : FAILED, "%-22s %6u samples  %2u + %2u frames  %s", rf->name, (uint32_t)len, reader, tag, ok ? "ok" : "differs");
+		failed += !ok;
+		free(rtrace);
+		free(samples);
+		free(trace);
+	}
+	if (found == 0) {
+		PrintAndLogEx(WARNING, "no sample files in %s,  skipped", dir);
+		return true;
+	}
+	PrintAndLogEx(failed ? FAILED : SUCCESS, "sample files: %u of %u decoded as saved", found - failed, found);
+	return failed == 0;
+}
+
+int sniffreplay_write_files(const sniffreplay_files_t *p, const char *dir) {
+	char filename[512];
+	for (uint32_t i = 0; i < p->n; i++) {
+		const sniffreplay_file_t *rf = &p->files[i];
+		uint8_t *samples, *trace = NULL;
+		uint32_t tlen = 0;
+		size_t len = p->session(&samples, rf->session, rf->pause, rf->phase, rf->seed);
+		if (len == 0 || p->decode(samples, len, &trace, &tlen)) {
+			free(samples);
+			PrintAndLogEx(FAILED, "Cannot allocate memory for the samples");
+			return 2;
+		}
+		snprintf(filename, sizeof(filename), "%s%s.raw", dir, rf->name);
+		bool ok = sniffreplay_write_file(filename, samples, len);
+		snprintf(filename, sizeof(filename), "%s%s.trace", dir, rf->name);
+		ok = ok && sniffreplay_write_file(filename, trace, tlen);
+		free(trace);
+		free(samples);
+		if (!ok) {
+			PrintAndLogEx(FAILED, "Cannot write %s", filename);
+			return 1;
+		}
+		PrintAndLogEx(SUCCESS, "%s%s.raw / .trace", dir, rf->name);
+	}
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+// bench
+//-----------------------------------------------------------------------------
+uint64_t sniffreplay_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+double sniffreplay_bench_head(size_t len, uint32_t reader, uint32_t tag, uint32_t rounds) {
+	// a tick is 16 carrier cycles
+	double airms = (double)len * SNIFFREPLAY_TICKS * 16 * 1000 / 13560000;
+	PrintAndLogEx(NORMAL, "%u samples,  %.1f ms air time,  %u reader and %u tag frames,  %u rounds", (uint32_t)len, airms, reader, tag, rounds);
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "decoder              |      ms | ns / call | cycles / call | ns / bit | x real time");
+	PrintAndLogEx(NORMAL, "---------------------+---------+-----------+---------------+----------+------------");
+	return airms;
+}
+
+void sniffreplay_bench_row(const char *name, uint64_t ms, uint64_t cycles, uint32_t calls, uint32_t done, uint64_t bits, double airms) {
+	double n = (double)calls * (done ? done : 1);
+	char cyc[16] = "-";
+	if (cycles)
+		snprintf(cyc, sizeof(cyc), "%.1f", cycles / n);
+	PrintAndLogEx(NORMAL, "%-20s | %7"PRIu64" | %9.2f | %13s | %8.2f | %11.0f",
+		name, ms, ms * 1e6 / n, cyc,
+		bits ? ms * 1e6 / bits : 0.0,
+		ms ? airms * done / ms : 0.0);
+}
+
+void sniffreplay_bench_foot(const char *budget) {
+	PrintAndLogEx(NORMAL, "");
+	PrintAndLogEx(NORMAL, "%s", budget);
+}
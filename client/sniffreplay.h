@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Sniff sample replay,  what the 14443A and iClass decoder replays share:  the
+// synthetic sessions tick by tick,  the trace they log,  the sample files and
+// the bench table
+//-----------------------------------------------------------------------------
+
+#ifndef SNIFFREPLAY_H__
+#define SNIFFREPLAY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A sample file is what the FPGA sniffer modes give the ARM,  one byte per 4 ticks
+// (16 carrier cycles each):  the reader field in the high nibble,  1 = field,  the
+// tag load modulation in the low nibble,  1 = modulated.  The oldest tick is the
+// highest bit of a nibble.
+#define SNIFFREPLAY_TICKS		4				// ticks per sample byte
+
+// a synthetic session,  one tick a byte
+typedef struct {
+	uint8_t *reader;			// 1 field
+	uint8_t *tag;				// 1 modulated
+	size_t len;
+	size_t size;
+	uint8_t pause;
+	uint32_t seed;				// 0 no noise
+} sniffreplay_ticks_t;
+
+// the noise of a session,  from its seed
+extern uint32_t sniffreplay_rand(sniffreplay_ticks_t *t);
+// room for n more ticks,  field and no modulation.  t->len stays.
+extern bool sniffreplay_grow(sniffreplay_ticks_t *t, size_t n);
+// the ticks as sample bytes if ok,  frees them.  Returns the length,  0 no memory.
+extern size_t sniffreplay_samples(sniffreplay_ticks_t *t, bool ok, uint8_t **samples);
+
+// a frame appended to an allocated trace in the BigBuf format,  false no memory
+extern bool sniffreplay_log(uint8_t **trace, uint32_t *traceLen, uint32_t *traceSize, const uint8_t *data, uint16_t len,
+							uint32_t start, uint32_t end, const uint8_t *parity, bool readerToTag);
+
+// a sample file of the tests,  name.raw the samples,  name.trace the frames
+typedef struct {
+	const char *name;
+	uint8_t session;
+	uint8_t pause;
+	uint8_t phase;
+	uint32_t seed;
+} sniffreplay_file_t;
+
+typedef struct {
+	const sniffreplay_file_t *files;
+	uint32_t n;
+	size_t (*session)(uint8_t **samples, int session, uint8_t pause, uint8_t phase, uint32_t seed);
+	// the samples as an allocated trace.  Returns 0,  or 1 no memory.
+	int (*decode)(const uint8_t *samples, size_t len, uint8_t **trace, uint32_t *traceLen);
+	// the trace of the samples of file f is right,  NULL only the saved trace counts
+	bool (*check)(const uint8_t *samples, size_t len, const uint8_t *trace, uint32_t traceLen, const sniffreplay_file_t *f, bool verbose);
+} sniffreplay_files_t;
+
+// the sample files in dir against their saved traces
+extern bool sniffreplay_check_files(const sniffreplay_files_t *p, const char *dir, bool verbose);
+// writes the sample files into dir.  Returns 0,  1 cannot write,  2 no memory.
+extern int sniffreplay_write_files(const sniffreplay_files_t *p, const char *dir);
+
+// the TSC,  0 where there is none
+extern uint64_t sniffreplay_cycles(void);
+// the head of the bench table,  returns the air time of the samples in ms
+extern double sniffreplay_bench_head(size_t len, uint32_t reader, uint32_t tag, uint32_t rounds);
+// a row of it,  calls a round,  done rounds and the bits they decoded
+extern void sniffreplay_bench_row(const char *name, uint64_t ms, uint64_t cycles, uint32_t calls, uint32_t done, uint64_t bits, double airms);
+// the firmware budget of a call under the table
+extern void sniffreplay_bench_foot(const char *budget);
+
+#endif
@@ -0,0 +1,481 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Indexed trace files,  several captures with a record offset index
+//
+// A raw BigBuf trace can only be walked from its first record.  The indexed
+// file keeps the offset of every record and where each capture starts,  so a
+// listing can start anywhere.  It is mapped,  nothing is read until listed.
+// Offsets are 64 bit on disk,  a loaded trace is limited to 4 GB.
+//-----------------------------------------------------------------------------
+
+#include "tracefile.h"
+#include "tracestream.h"
+#include "tracecompact.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// on disk sizes,  the structs have no padding
+#define TRACEFILE_HEADER_SIZE	32
+#define TRACEFILE_SESSION_SIZE	24
+
+static void tracefile_put32(uint8_t *p, uint32_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static void tracefile_put64(uint8_t *p, uint64_t v) {
+	tracefile_put32(p, v);
+	tracefile_put32(p + 4, v >> 32);
+}
+
+static uint32_t tracefile_get32(const uint8_t *p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t tracefile_get64(const uint8_t *p) {
+	return tracefile_get32(p) | (uint64_t)tracefile_get32(p + 4) << 32;
+}
+
+// the file can be used in place
+static bool tracefile_host_le(void) {
+	const uint16_t one = 1;
+	return *(const uint8_t *)&one == 1;
+}
+
+static void tracefile_get_header(const uint8_t *p, tracefile_header_t *h) {
+	memcpy(h->magic, p, sizeof(h->magic));
+	h->version = tracefile_get32(p + 8);
+	h->sessions = tracefile_get32(p + 12);
+	h->records = tracefile_get64(p + 16);
+	h->datalen = tracefile_get64(p + 24);
+}
+
+static void tracefile_get_session(const uint8_t *p, tracefile_session_t *s) {
+	s->record = tracefile_get64(p);
+	s->offset = tracefile_get64(p + 8);
+	s->protocol = tracefile_get32(p + 16);
+	s->reserved = tracefile_get32(p + 20);
+}
+
+// the header is good and the file holds all it describes
+static bool tracefile_check_header(const tracefile_header_t *h, uint64_t filelen) {
+	uint64_t size = TRACEFILE_HEADER_SIZE + (uint64_t)h->sessions * TRACEFILE_SESSION_SIZE
+		+ h->records * sizeof(uint64_t) + h->datalen;
+	return h->version == TRACEFILE_VERSION && h->datalen <= UINT32_MAX && h->records <= h->datalen / TRACEFILE_RECORD_HDR
+		&& h->sessions <= h->datalen && size <= filelen;
+}
+
+uint32_t tracefile_record_len(const uint8_t *rec) {
+	uint16_t data_len = (rec[6] | rec[7] << 8) & 0x7FFF;
+	// same as tracelist_decode(),  an empty record still has a parity byte
+	return TRACEFILE_RECORD_HDR + data_len + (data_len - 1) / 8 + 1;
+}
+
+// complete records in data,  and their length
+static uint32_t tracefile_count(const uint8_t *data, uint32_t len, uint32_t *used) {
+	uint32_t n = 0, pos = 0;
+	while (pos + TRACEFILE_RECORD_HDR <= len) {
+		uint32_t rlen = tracefile_record_len(data + pos);
+		if (pos + rlen > len)
+			break;
+		pos += rlen;
+		n++;
+	}
+	*used = pos;
+	return n;
+}
+
+// a mapped trace becomes a heap one before it grows
+static int tracefile_unmap(tracefile_t *t) {
+	if (!t->map)
+		return 0;
+
+	uint8_t *data = malloc(t->len ? t->len : 1);
+	uint64_t *index = malloc((t->records ? t->records : 1) * sizeof(uint64_t));
+	tracefile_session_t *sessions = malloc((t->nsessions ? t->nsessions : 1) * sizeof(tracefile_session_t));
+	if (!data || !index || !sessions) {
+		free(data);
+		free(index);
+		free(sessions);
+		return 3;
+	}
+	memcpy(data, t->data, t->len);
+	memcpy(index, t->index, t->records * sizeof(uint64_t));
+	memcpy(sessions, t->sessions, t->nsessions * sizeof(tracefile_session_t));
+
+#if !defined(_WIN32)
+	munmap(t->map, t->maplen);
+#endif
+	t->map = NULL;
+	t->maplen = 0;
+	t->data = data;
+	t->index = index;
+	t->sessions = sessions;
+	return 0;
+}
+
+int tracefile_append_raw(tracefile_t *t, const uint8_t *data, uint32_t len, uint32_t protocol) {
+	// a compact trace is kept classic
+	if (tracecompact_is(data, len)) {
+		uint32_t classiclen = tracecompact_decode(data, len, NULL);
+		if (classiclen == 0)
+			return 2;
+		uint8_t *classic = malloc(classiclen);
+		if (!classic)
+			return 3;
+		tracecompact_decode(data, len, classic);
+		int res = tracefile_append_raw(t, classic, classiclen, protocol);
+		free(classic);
+		return res;
+	}
+
+	uint32_t used;
+	uint32_t n = tracefile_count(data, len, &used);
+	if (len == 0)
+		return 2;
+	if ((uint64_t)t->len + len > UINT32_MAX)
+		return 2;
+	if (tracefile_unmap(t))
+		return 3;
+
+	uint8_t *d = realloc(t->data, t->len + len);
+	if (!d)
+		return 3;
+	t->data = d;
+	uint64_t *index = realloc(t->index, (t->records + n + 1) * sizeof(uint64_t));
+	if (!index)
+		return 3;
+	t->index = index;
+	tracefile_session_t *sessions = realloc(t->sessions, (t->nsessions + 1) * sizeof(tracefile_session_t));
+	if (!sessions)
+		return 3;
+	t->sessions = sessions;
+
+	memcpy(t->data + t->len, data, len);
+	t->sessions[t->nsessions].record = t->records;
+	t->sessions[t->nsessions].offset = t->len;
+	t->sessions[t->nsessions].protocol = protocol;
+	t->sessions[t->nsessions].reserved = 0;
+	t->nsessions++;
+
+	uint32_t pos = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		t->index[t->records + i] = t->len + pos;
+		pos += tracefile_record_len(data + pos);
+	}
+	t->records += n;
+	t->len += len;
+	return 0;
+}
+
+int tracefile_append(tracefile_t *t, const tracefile_t *src) {
+	for (uint32_t s = 0; s < src->nsessions; s++) {
+		uint32_t start, end;
+		tracefile_session_bytes(src, s, &start, &end);
+		if (start == end)
+			continue;
+		int res = tracefile_append_raw(t, src->data + start, end - start, src->sessions[s].protocol);
+		if (res)
+			return res;
+	}
+	return 0;
+}
+
+// sessions in order,  the index is checked when used
+static bool tracefile_check_sessions(const tracefile_t *t) {
+	for (uint32_t s = 0; s < t->nsessions; s++) {
+		const tracefile_session_t *cur = &t->sessions[s];
+		if (cur->record > t->records || cur->offset > t->len)
+			return false;
+		if (s && (cur->record < cur[-1].record || cur->offset < cur[-1].offset))
+			return false;
+	}
+	return true;
+}
+
+#if !defined(_WIN32)
+static int tracefile_map(tracefile_t *t, const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return 1;
+
+	struct stat st;
+	if (fstat(fd, &st) || (uint64_t)st.st_size < TRACEFILE_HEADER_SIZE) {
+		close(fd);
+		return 2;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 3;
+
+	tracefile_header_t h;
+	tracefile_get_header(map, &h);
+	if (!tracefile_check_header(&h, st.st_size)) {
+		munmap(map, st.st_size);
+		return 2;
+	}
+
+	uint64_t hdr = TRACEFILE_HEADER_SIZE + (uint64_t)h.sessions * TRACEFILE_SESSION_SIZE;
+	t->map = map;
+	t->maplen = st.st_size;
+	t->sessions = (tracefile_session_t *)((uint8_t *)map + TRACEFILE_HEADER_SIZE);
+	t->nsessions = h.sessions;
+	t->index = (uint64_t *)((uint8_t *)map + hdr);
+	t->records = h.records;
+	t->data = (uint8_t *)map + hdr + h.records * sizeof(uint64_t);
+	t->len = h.datalen;
+
+	if (!tracefile_check_sessions(t)) {
+		tracefile_free(t);
+		return 2;
+	}
+	return 0;
+}
+#endif
+
+static int tracefile_read(const char *filename, uint8_t **data, size_t *len) {
+	FILE *f = fopen(filename, "rb");
+	if (!f)
+		return 1;
+
+	fseek(f, 0, SEEK_END);
+	long fsize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (fsize < 4) {
+		fclose(f);
+		return 2;
+	}
+
+	*data = malloc(fsize);
+	if (!*data) {
+		fclose(f);
+		return 3;
+	}
+	*len = fread(*data, 1, fsize, f);
+	fclose(f);
+	return 0;
+}
+
+int tracefile_load(tracefile_t *t, const char *filename) {
+	memset(t, 0, sizeof(tracefile_t));
+
+	FILE *f = fopen(filename, "rb");
+	if (!f)
+		return 1;
+	char magic[8] = {0};
+	size_t n = fread(magic, 1, sizeof(magic), f);
+	fclose(f);
+
+	bool indexed = (n == sizeof(magic) && memcmp(magic, TRACEFILE_MAGIC, sizeof(magic)) == 0);
+#if !defined(_WIN32)
+	if (indexed && tracefile_host_le())
+		return tracefile_map(t, filename);
+#endif
+
+	uint8_t *data = NULL;
+	size_t len = 0;
+	int res = tracefile_read(filename, &data, &len);
+	if (res)
+		return res;
+
+	if (indexed) {
+		// no mmap,  the sessions decoded and the index built again
+		tracefile_t m = {0};
+		tracefile_header_t h;
+		if (len < TRACEFILE_HEADER_SIZE) {
+			free(data);
+			return 2;
+		}
+		tracefile_get_header(data, &h);
+		if (!tracefile_check_header(&h, len)) {
+			free(data);
+			return 2;
+		}
+		uint64_t hdr = TRACEFILE_HEADER_SIZE + (uint64_t)h.sessions * TRACEFILE_SESSION_SIZE;
+		m.sessions = malloc((h.sessions ? h.sessions : 1) * sizeof(tracefile_session_t));
+		if (!m.sessions) {
+			free(data);
+			return 3;
+		}
+		for (uint32_t s = 0; s < h.sessions; s++)
+			tracefile_get_session(data + TRACEFILE_HEADER_SIZE + s * TRACEFILE_SESSION_SIZE, &m.sessions[s]);
+		m.nsessions = h.sessions;
+		m.records = h.records;
+		m.data = data + hdr + h.records * sizeof(uint64_t);
+		m.len = h.datalen;
+		res = tracefile_check_sessions(&m) ? tracefile_append(t, &m) : 2;
+		free(m.sessions);
+	} else {
+		res = (len > UINT32_MAX) ? 2 : tracefile_append_raw(t, data, len, TRACEFILE_PROTO_ANY);
+	}
+	free(data);
+	if (res)
+		tracefile_free(t);
+	return res;
+}
+
+int tracefile_save(const tracefile_t *t, const char *filename) {
+	FILE *f = fopen(filename, "wb");
+	if (!f)
+		return 1;
+
+	uint8_t buf[TRACEFILE_HEADER_SIZE + 512 * sizeof(uint64_t)];
+	memcpy(buf, TRACEFILE_MAGIC, 8);
+	tracefile_put32(buf + 8, TRACEFILE_VERSION);
+	tracefile_put32(buf + 12, t->nsessions);
+	tracefile_put64(buf + 16, t->records);
+	tracefile_put64(buf + 24, t->len);
+	bool ok = fwrite(buf, 1, TRACEFILE_HEADER_SIZE, f) == TRACEFILE_HEADER_SIZE;
+
+	for (uint32_t s = 0; ok && s < t->nsessions; s++) {
+		tracefile_put64(buf, t->sessions[s].record);
+		tracefile_put64(buf + 8, t->sessions[s].offset);
+		tracefile_put32(buf + 16, t->sessions[s].protocol);
+		tracefile_put32(buf + 20, t->sessions[s].reserved);
+		ok = fwrite(buf, 1, TRACEFILE_SESSION_SIZE, f) == TRACEFILE_SESSION_SIZE;
+	}
+	for (uint32_t i = 0; ok && i < t->records; ) {
+		uint32_t n = 0;
+		for (; n < sizeof(buf) / sizeof(uint64_t) && i < t->records; n++, i++)
+			tracefile_put64(buf + n * sizeof(uint64_t), t->index[i]);
+		ok = fwrite(buf, sizeof(uint64_t), n, f) == n;
+	}
+	ok = ok && fwrite(t->data, 1, t->len, f) == t->len;
+	fclose(f);
+	return ok ? 0 : 1;
+}
+
+void tracefile_free(tracefile_t *t) {
+	if (t->map) {
+#if !defined(_WIN32)
+		munmap(t->map, t->maplen);
+#endif
+	} else {
+		free(t->data);
+		free(t->index);
+		free(t->sessions);
+	}
+	memset(t, 0, sizeof(tracefile_t));
+}
+
+void tracefile_session_range(const tracefile_t *t, uint32_t s, uint32_t *first, uint32_t *end) {
+	*first = t->sessions[s].record;
+	*end = (s + 1 < t->nsessions) ? t->sessions[s + 1].record : t->records;
+}
+
+void tracefile_session_bytes(const tracefile_t *t, uint32_t s, uint32_t *start, uint32_t *end) {
+	*start = t->sessions[s].offset;
+	*end = (s + 1 < t->nsessions) ? t->sessions[s + 1].offset : t->len;
+}
+
+uint32_t tracefile_offset(const tracefile_t *t, uint32_t record) {
+	if (record >= t->records)
+		return t->len;
+	return (t->index[record] < t->len) ? t->index[record] : t->len;
+}
+
+uint32_t tracefile_timestamp(const tracefile_t *t, uint32_t record) {
+	uint32_t pos = tracefile_offset(t, record);
+	if (pos + TRACEFILE_RECORD_HDR > t->len)
+		return 0;
+	return tracefile_get32(t->data + pos);
+}
+
+uint32_t tracefile_find_time(const tracefile_t *t, uint32_t s, uint32_t ticks) {
+	uint32_t first, end;
+	tracefile_session_range(t, s, &first, &end);
+	uint32_t ts0 = tracefile_timestamp(t, first);
+
+	uint32_t lo = first, hi = end;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (tracefile_timestamp(t, mid) - ts0 < ticks)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+int tracefile_rx_open(tracefile_rx_t *rx, FILE *f) {
+	memset(rx, 0, sizeof(tracefile_rx_t));
+	rx->carry = malloc(TRACESTREAM_CHUNK + 0x10000);
+	if (!rx->carry)
+		return 3;
+	rx->f = f;
+	rx->sync = true;
+	return 0;
+}
+
+int tracefile_rx_feed(tracefile_rx_t *rx, uint32_t arg0, uint32_t arg1, uint32_t arg2, const uint8_t *data) {
+	uint32_t len = arg1 & TRACESTREAM_LENMASK;
+	if (len > TRACESTREAM_CHUNK)
+		len = TRACESTREAM_CHUNK;
+
+	rx->dropped = arg2;
+	if (arg1 & TRACESTREAM_END) {
+		rx->devrecords = data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+		// packets lost at the end,  a cut record
+		rx->lost += (uint32_t)(arg0 - rx->offset) + rx->carrylen;
+		rx->carrylen = 0;
+		rx->done = true;
+		return 1;
+	}
+
+	// a lost packet,  the records up to the next half are gone
+	if (arg0 != rx->offset) {
+		rx->lost += (uint32_t)(arg0 - rx->offset) + rx->carrylen;
+		rx->carrylen = 0;
+		rx->sync = false;
+	}
+	rx->offset = arg0 + len;
+
+	if (!rx->sync) {
+		if (!(arg1 & TRACESTREAM_HALF)) {
+			rx->lost += len;
+			return 0;
+		}
+		rx->sync = true;
+	}
+
+	memcpy(rx->carry + rx->carrylen, data, len);
+	rx->carrylen += len;
+
+	uint32_t pos = 0;
+	while (pos + TRACEFILE_RECORD_HDR <= rx->carrylen) {
+		uint32_t rlen = tracefile_record_len(rx->carry + pos);
+		if (pos + rlen > rx->carrylen)
+			break;
+		pos += rlen;
+		rx->records++;
+	}
+
+	if (pos) {
+		if (fwrite(rx->carry, 1, pos, rx->f) != pos)
+			return -1;
+		rx->bytes += pos;
+		rx->carrylen -= pos;
+		memmove(rx->carry, rx->carry + pos, rx->carrylen);
+	}
+	return 0;
+}
+
+void tracefile_rx_free(tracefile_rx_t *rx) {
+	free(rx->carry);
+	rx->carry = NULL;
+}
@@ -0,0 +1,99 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Indexed trace files,  several captures with a record offset index
+//-----------------------------------------------------------------------------
+
+#ifndef TRACEFILE_H__
+#define TRACEFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// little endian on disk,  the fields written byte by byte:
+//   header,  sessions[header.sessions],  index[header.records],  records
+// index holds the offset of each record from the first one.  The records are
+// the BigBuf trace format:  timestamp 4,  duration 2,  len 2 (msb = tag),  data,  parity.
+// A little endian host maps the file and uses it in place.
+#define TRACEFILE_MAGIC			"PM3TRACE"
+#define TRACEFILE_VERSION		1
+#define TRACEFILE_PROTO_ANY		0xFFFFFFFF
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t sessions;
+	uint64_t records;
+	uint64_t datalen;
+} tracefile_header_t;
+
+typedef struct {
+	uint64_t record;		// first record
+	uint64_t offset;		// first byte,  felica traces are not records
+	uint32_t protocol;		// `trace list` protocol or TRACEFILE_PROTO_ANY
+	uint32_t reserved;
+} tracefile_session_t;
+
+typedef struct {
+	uint8_t *data;
+	uint32_t len;
+	uint64_t *index;
+	uint32_t records;
+	tracefile_session_t *sessions;
+	uint32_t nsessions;
+	// a mapped file,  data/index/sessions point into it until something is appended
+	void *map;
+	size_t maplen;
+} tracefile_t;
+
+// record header,  the length of a whole record
+#define TRACEFILE_RECORD_HDR	8
+extern uint32_t tracefile_record_len(const uint8_t *rec);
+
+// raw BigBuf data or an indexed file.  The indexed file is mapped,  raw data is read.
+// Returns 0,  or 1 can't open,  2 bad file,  3 no memory
+extern int tracefile_load(tracefile_t *t, const char *filename);
+// appends raw data as a new session,  copies it.  The complete records are indexed.
+// A compact trace (tracecompact.h) is decoded to the classic records first.
+extern int tracefile_append_raw(tracefile_t *t, const uint8_t *data, uint32_t len, uint32_t protocol);
+// appends all sessions of another trace
+extern int tracefile_append(tracefile_t *t, const tracefile_t *src);
+extern int tracefile_save(const tracefile_t *t, const char *filename);
+extern void tracefile_free(tracefile_t *t);
+
+// records [first, end) of session s
+extern void tracefile_session_range(const tracefile_t *t, uint32_t s, uint32_t *first, uint32_t *end);
+// bytes [start, end) of session s,  with any incomplete record at its end
+extern void tracefile_session_bytes(const tracefile_t *t, uint32_t s, uint32_t *start, uint32_t *end);
+extern uint32_t tracefile_offset(const tracefile_t *t, uint32_t record);
+extern uint32_t tracefile_timestamp(const tracefile_t *t, uint32_t record);
+// first record of session s at or after ticks from the session start,  timestamps are
+// increasing within a capture
+extern uint32_t tracefile_find_time(const tracefile_t *t, uint32_t s, uint32_t ticks);
+
+// sniff stream receiver,  appends the records of a streamed sniff to a raw trace file.
+// A lost packet loses the records up to the next half,  see tracestream.h
+typedef struct {
+	FILE *f;
+	uint8_t *carry;			// start of a record cut by a chunk
+	uint32_t carrylen;
+	uint32_t offset;		// next stream offset
+	bool sync;
+	bool done;
+	uint32_t records;		// written
+	uint64_t bytes;
+	uint64_t lost;			// bytes skipped after a lost packet
+	uint32_t dropped;		// by the device,  both halves full
+	uint32_t devrecords;	// logged by the device,  from the end packet
+} tracefile_rx_t;
+
+extern int tracefile_rx_open(tracefile_rx_t *rx, FILE *f);
+// one packet.  Returns 0,  1 after the end packet,  -1 on a write error
+extern int tracefile_rx_feed(tracefile_rx_t *rx, uint32_t arg0, uint32_t arg1, uint32_t arg2, const uint8_t *data);
+extern void tracefile_rx_free(tracefile_rx_t *rx);
+
+#endif
@@ -0,0 +1,683 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Trace listing,  records decoded to lines and written as text,  JSON or CSV
+//
+// The records are cut in batches.  Worker threads decode the batches,  crc
+// checks and annotations,  into a ring of slots.  One writer thread takes the
+// slots in batch order and writes them,  so the output is the same as a
+// serial listing.  mf keeps the auth state from record to record and topaz
+// merges reader frames over records,  they are decoded by the calling thread
+// only.  The writer still runs beside it.
+//-----------------------------------------------------------------------------
+
+#include "tracelist.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include "protocols.h"
+#include "parity.h"			// oddparity
+#include "cmdhflist.h"		// annotations
+#include "iso15693tools.h"	// ISO15693 crc
+#include "util.h"
+#include "ui.h"
+
+#define TRACELIST_BATCH		512		// records
+#define TRACELIST_SLOTS		4		// per worker
+
+static bool is_last_record(uint32_t tracepos, uint8_t *trace, uint32_t traceLen) {
+	return(tracepos + sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t) >= traceLen);
+}
+
+static bool next_record_is_response(uint32_t tracepos, uint8_t *trace) {
+	uint16_t next_records_datalen = *((uint16_t *)(trace + tracepos + sizeof(uint32_t) + sizeof(uint16_t)));
+	return(next_records_datalen & 0x8000);
+}
+
+static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint32_t *tracepos, uint32_t traceLen,
+								uint8_t *trace, const uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
+
+	uint32_t last_timestamp = timestamp + *duration;
+
+	if ((*data_len != 1) || (frame[0] == TOPAZ_WUPA) || (frame[0] == TOPAZ_REQA)) return false;
+
+	memcpy(topaz_reader_command, frame, *data_len);
+
+	while (!is_last_record(*tracepos, trace, traceLen) && !next_record_is_response(*tracepos, trace)) {
+		uint32_t next_timestamp = *((uint32_t *)(trace + *tracepos));
+		*tracepos += sizeof(uint32_t);
+		uint16_t next_duration = *((uint16_t *)(trace + *tracepos));
+		*tracepos += sizeof(uint16_t);
+		uint16_t next_data_len = *((uint16_t *)(trace + *tracepos)) & 0x7FFF;
+		*tracepos += sizeof(uint16_t);
+		uint8_t *next_frame = (trace + *tracepos);
+		*tracepos += next_data_len;
+		if ((next_data_len == 1) && (*data_len + next_data_len <= TRACELIST_TOPAZ_LEN)) {
+			memcpy(topaz_reader_command + *data_len, next_frame, next_data_len);
+			*data_len += next_data_len;
+			last_timestamp = next_timestamp + next_duration;
+		} else {
+			// rewind and exit
+			*tracepos = *tracepos - next_data_len - sizeof(uint16_t) - sizeof(uint16_t) - sizeof(uint32_t);
+			break;
+		}
+		uint16_t next_parity_len = (next_data_len-1)/8 + 1;
+		*tracepos += next_parity_len;
+	}
+
+	*duration = last_timestamp - timestamp;
+
+	return true;
+}
+
+uint32_t tracelist_decode(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, trace_line_t *tl) {
+	tl->valid = false;
+
+	// sanity check
+	if (tracepos + sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t) > traceLen) return traceLen;
+
+	uint32_t first_timestamp = *((uint32_t *)(trace));
+	uint32_t timestamp = *((uint32_t *)(trace + tracepos));
+	tracepos += 4;
+
+	uint32_t duration = *((uint16_t *)(trace + tracepos));
+	tracepos += 2;
+
+	uint16_t data_len = *((uint16_t *)(trace + tracepos));
+	tracepos += 2;
+
+	bool isResponse = data_len & 0x8000;
+	data_len &= 0x7fff;
+	uint16_t parity_len = (data_len-1)/8 + 1;
+
+	if (tracepos + data_len + parity_len > traceLen) {
+		return traceLen;
+	}
+	const uint8_t *frame = trace + tracepos;
+	tracepos += data_len;
+	const uint8_t *parityBytes = trace + tracepos;
+	tracepos += parity_len;
+
+	if (protocol == TOPAZ && !isResponse) {
+		// topaz reader commands come in 1 or 9 separate frames with 7 or 8 Bits each.
+		// merge them:
+		if (merge_topaz_reader_frames(timestamp, &duration, &tracepos, traceLen, trace, frame, tl->topaz, &data_len)) {
+			frame = tl->topaz;
+		}
+	}
+
+	if (data_len == 0)
+		return tracepos;
+
+	//Check the CRC status
+	//0 CRC-command, CRC not ok
+	//1 CRC-command, CRC ok
+	//2 Not crc-command
+	uint8_t crcStatus = 2;
+
+	if (data_len > 2) {
+		switch (protocol) {
+			case ICLASS:
+				crcStatus = iclass_CRC_check(isResponse, (uint8_t *)frame, data_len);
+				break;
+			case ISO_14443B:
+			case TOPAZ:
+			case FELICA:
+				crcStatus = iso14443B_CRC_check((uint8_t *)frame, data_len);
+				break;
+			case PROTO_MIFARE:
+			case ISO_14443A:
+			case MFDES:
+				crcStatus = iso14443A_CRC_check(isResponse, (uint8_t *)frame, data_len);
+				break;
+			case ISO_15693:
+				crcStatus = iso15693_CRC_check((uint8_t *)frame, data_len);
+				break;
+			default:
+				break;
+		}
+	}
+
+	tl->valid = true;
+	tl->isResponse = isResponse;
+	tl->start = timestamp - first_timestamp;
+	tl->end = timestamp + duration - first_timestamp;
+	tl->len = data_len;
+	tl->frame = frame;
+	tl->parity = parityBytes;
+	tl->crc = crcStatus;
+	tl->explanation[0] = '\0';
+	tl->note[0] = '\0';
+	tl->mfDataLen = 0;
+	tl->mfExplanation[0] = '\0';
+	tl->fdt = false;
+
+	// Always annotate LEGIC read/tag
+	if ( protocol == LEGIC )
+		annotateLegic(tl->explanation, sizeof(tl->explanation), (uint8_t *)frame, data_len);
+
+	if ( protocol == PROTO_MIFARE )
+		annotateMifare(tl->explanation, sizeof(tl->explanation), (uint8_t *)frame, data_len, (uint8_t *)parityBytes, parity_len, isResponse);
+
+	if (!isResponse)	{
+		uint8_t *cmd = (uint8_t *)frame;
+		switch(protocol) {
+			case ICLASS:		annotateIclass(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			case ISO_14443A:	annotateIso14443a(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			case MFDES:			annotateMfDesfire(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			case ISO_14443B:	annotateIso14443b(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			case TOPAZ:			annotateTopaz(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			case ISO_7816_4:	annotateIso7816(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			case ISO_15693:		annotateIso15693(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			case FELICA:		annotateFelica(tl->explanation, sizeof(tl->explanation), cmd, data_len); break;
+			default:			break;
+		}
+	}
+
+	if (isResponse && protocol == ISO_7816_4)
+		annotateIso7816Response(tl->explanation, sizeof(tl->explanation), (uint8_t *)frame, data_len);
+
+	// only the mf annotation leads to an auth session
+	if (protocol == PROTO_MIFARE) {
+		size_t mfDataLen = 0;
+		if (DecodeMifareData((uint8_t *)frame, data_len, (uint8_t *)parityBytes, isResponse, tl->mfData, &mfDataLen, tl->note, sizeof(tl->note))) {
+			tl->mfDataLen = mfDataLen;
+			if (!isResponse)
+				annotateIso14443a(tl->mfExplanation, sizeof(tl->mfExplanation), tl->mfData, mfDataLen);
+			tl->mfCrc = iso14443A_CRC_check(isResponse, tl->mfData, mfDataLen);
+		}
+	}
+
+	if (is_last_record(tracepos, trace, traceLen)) return traceLen;
+
+	if (showWaitCycles && !isResponse && next_record_is_response(tracepos, trace)) {
+		tl->fdt = true;
+		tl->fdtNext = *((uint32_t *)(trace + tracepos)) - first_timestamp;
+	}
+
+	return tracepos;
+}
+
+//-----------------------------------------------------------------------------
+// writers
+//-----------------------------------------------------------------------------
+static bool parity_error(const tracelist_t *tl, const trace_line_t *line, int j) {
+	uint8_t protocol = tl->protocol;
+	if (protocol == LEGIC || protocol == ISO_14443B || protocol == ISO_7816_4)
+		return false;
+	if (!line->isResponse && protocol != ISO_14443A)
+		return false;
+	uint8_t parityBits = line->parity[j >> 3];
+	return oddparity8(line->frame[j]) != ((parityBits >> (7-(j&0x0007))) & 0x01);
+}
+
+static const char *crc_str(uint8_t crc) {
+	return (crc == 0 ? "!crc" : (crc == 1 ? " ok " : "    "));
+}
+
+static void emit(tracelist_t *tl, const char *s) {
+	if (tl->f)
+		fprintf(tl->f, "%s\n", s);
+	else
+		PrintAndLogEx(NORMAL, "%s", s);
+}
+
+static void write_text(tracelist_t *tl, const trace_line_t *line) {
+	char rows[TRACELIST_MAX_ROWS + 1][110];
+	char out[256];
+
+	//--- Draw the data column
+	int data_len = line->len;
+	for (int j = 0; j < data_len && j/18 < TRACELIST_MAX_ROWS; j++) {
+		snprintf(rows[j/18]+(( j % 18) * 4), 110, parity_error(tl, line, j) ? "%02x! " : "%02x  ", line->frame[j]);
+	}
+
+	if (tl->markCRCBytes) {
+		//CRC-command
+		if ((line->crc == 0 || line->crc == 1) && data_len / 18 <= TRACELIST_MAX_ROWS) {
+			char *pos1 = rows[(data_len-2)/18]+(((data_len-2) % 18) * 4);
+			(*pos1) = '[';
+			char *pos2 = rows[(data_len)/18]+(((data_len) % 18) * 4);
+			sprintf(pos2, "%c", ']');
+		}
+	}
+
+	const char *crc = crc_str(line->crc);
+	int num_lines = MIN((data_len - 1)/18 + 1, TRACELIST_MAX_ROWS);
+	for (int j = 0; j < num_lines ; j++) {
+		if (j == 0) {
+			snprintf(out, sizeof(out), " %10u | %10u | %s |%-72.109s | %s| %s",
+				line->start,
+				line->end,
+				(line->isResponse ? "Tag" : "Rdr"),
+				rows[j],
+				(j == num_lines-1) ? crc : "    ",
+				(j == num_lines-1) ? line->explanation : "");
+		} else {
+			snprintf(out, sizeof(out), "            |            |     |%-72.109s | %s| %s",
+				rows[j],
+				(j == num_lines-1) ? crc : "    ",
+				(j == num_lines-1) ? line->explanation : "");
+		}
+		emit(tl, out);
+	}
+
+	if (line->note[0])
+		emit(tl, line->note);
+
+	if (line->mfDataLen) {
+		char hex[32 * 4 + 1];
+		hex_to_buffer((uint8_t *)hex, line->mfData, line->mfDataLen, sizeof(hex) - 1, 0, 2, true);
+		snprintf(out, sizeof(out), "            |            |  *  |%-72s | %-4s| %s",
+			hex,
+			crc_str(line->mfCrc),
+			line->mfExplanation);
+		emit(tl, out);
+	}
+
+	if (line->fdt) {
+		snprintf(out, sizeof(out), " %10u | %10u | %s |fdt (Frame Delay Time): %d",
+			line->end,
+			line->fdtNext,
+			"   ",
+			(line->fdtNext - line->end));
+		emit(tl, out);
+	}
+}
+
+// the key line is made for the table,  drop the column marks
+static void note_trim(const char *note, char *out, size_t size) {
+	while (*note == ' ' || *note == '|' || *note == '*')
+		note++;
+	size_t n = strlen(note);
+	while (n && (note[n-1] == ' ' || note[n-1] == '|' || note[n-1] == '\n'))
+		n--;
+	if (n >= size)
+		n = size - 1;
+	memcpy(out, note, n);
+	out[n] = '\0';
+}
+
+static void buf_printf(tracelist_buf_t *b, const char *fmt, ...) {
+	for (;;) {
+		va_list args;
+		va_start(args, fmt);
+		int n = b->s ? vsnprintf(b->s + b->len, b->size - b->len, fmt, args) : -1;
+		va_end(args);
+		if (n >= 0 && b->len + n < b->size) {
+			b->len += n;
+			return;
+		}
+		size_t size = b->size ? b->size * 2 : 1024;
+		if (n >= 0 && size < b->len + n + 1)
+			size = b->len + n + 1;
+		char *s = realloc(b->s, size);
+		if (s == NULL)
+			return;
+		b->s = s;
+		b->size = size;
+	}
+}
+
+// frames are up to 32k bytes
+static void buf_hex(tracelist_buf_t *b, const uint8_t *data, size_t len) {
+	static const char hex[] = "0123456789abcdef";
+	if (b->len + 2 * len + 1 > b->size)
+		buf_printf(b, "%*s", (int)(2 * len), "");
+	else
+		b->len += 2 * len;
+	if (b->s == NULL)
+		return;
+	char *p = b->s + b->len - 2 * len;
+	for (size_t i = 0; i < len; i++) {
+		*p++ = hex[data[i] >> 4];
+		*p++ = hex[data[i] & 0x0F];
+	}
+	*p = '\0';
+}
+
+static void buf_json_str(tracelist_buf_t *b, const char *s) {
+	buf_printf(b, "\"");
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			buf_printf(b, "\\%c", *s);
+		else if ((uint8_t)*s < 0x20)
+			buf_printf(b, "\\u%04x", (uint8_t)*s);
+		else
+			buf_printf(b, "%c", *s);
+	}
+	buf_printf(b, "\"");
+}
+
+static void buf_csv_str(tracelist_buf_t *b, const char *s) {
+	buf_printf(b, "\"");
+	for (; *s; s++)
+		buf_printf(b, (*s == '"') ? "\"\"" : "%c", *s);
+	buf_printf(b, "\"");
+}
+
+static const char *crc_name(uint8_t crc) {
+	return (crc == 0 ? "fail" : (crc == 1 ? "ok" : ""));
+}
+
+static void format_json(tracelist_t *tl, tracelist_buf_t *b, uint32_t session, const trace_line_t *line) {
+	char note[sizeof(line->note)];
+	note_trim(line->note, note, sizeof(note));
+
+	buf_printf(b, "  {\"session\": %u, \"start\": %u, \"end\": %u, \"src\": \"%s\", \"data\": \"",
+		session, line->start, line->end, line->isResponse ? "tag" : "reader");
+	buf_hex(b, line->frame, line->len);
+	buf_printf(b, "\", \"parity_errors\": [");
+	for (int j = 0, n = 0; j < line->len; j++) {
+		if (parity_error(tl, line, j))
+			buf_printf(b, n++ ? ", %d" : "%d", j);
+	}
+	buf_printf(b, "], \"crc\": \"%s\", \"annotation\": ", crc_name(line->crc));
+	buf_json_str(b, line->explanation);
+	if (note[0]) {
+		buf_printf(b, ", \"key\": ");
+		buf_json_str(b, note);
+	}
+	if (line->mfDataLen) {
+		buf_printf(b, ", \"decrypted\": \"");
+		buf_hex(b, line->mfData, line->mfDataLen);
+		buf_printf(b, "\", \"decrypted_crc\": \"%s\", \"decrypted_annotation\": ", crc_name(line->mfCrc));
+		buf_json_str(b, line->mfExplanation);
+	}
+	if (line->fdt)
+		buf_printf(b, ", \"fdt\": %d", (int)(line->fdtNext - line->end));
+	buf_printf(b, "}");
+}
+
+static void format_csv(tracelist_t *tl, tracelist_buf_t *b, uint32_t session, const trace_line_t *line) {
+	char note[sizeof(line->note)];
+	note_trim(line->note, note, sizeof(note));
+
+	buf_printf(b, "%u,%u,%u,%s,", session, line->start, line->end, line->isResponse ? "tag" : "reader");
+	buf_hex(b, line->frame, line->len);
+	buf_printf(b, ",");
+	for (int j = 0, n = 0; j < line->len; j++) {
+		if (parity_error(tl, line, j))
+			buf_printf(b, n++ ? " %d" : "%d", j);
+	}
+	buf_printf(b, ",%s,", crc_name(line->crc));
+	buf_csv_str(b, line->explanation);
+	buf_printf(b, ",");
+	buf_csv_str(b, note);
+	buf_printf(b, ",");
+	buf_hex(b, line->mfData, line->mfDataLen);
+	buf_printf(b, ",%s,", line->mfDataLen ? crc_name(line->mfCrc) : "");
+	buf_csv_str(b, line->mfExplanation);
+	buf_printf(b, ",");
+	if (line->fdt)
+		buf_printf(b, "%d", (int)(line->fdtNext - line->end));
+}
+
+void tracelist_write(tracelist_t *tl, uint32_t session, const trace_line_t *line) {
+	if (!line->valid)
+		return;
+
+	switch (tl->format) {
+		case TRACELIST_TEXT:
+			write_text(tl, line);
+			break;
+		case TRACELIST_JSON: {
+			// the object before gets its comma when the next one comes
+			tl->out.len = 0;
+			format_json(tl, &tl->out, session, line);
+			if (tl->lines) {
+				buf_printf(&tl->held, ",");
+				emit(tl, tl->held.s);
+			}
+			tracelist_buf_t tmp = tl->held;
+			tl->held = tl->out;
+			tl->out = tmp;
+			break;
+		}
+		case TRACELIST_CSV:
+			tl->out.len = 0;
+			format_csv(tl, &tl->out, session, line);
+			emit(tl, tl->out.s);
+			break;
+	}
+	tl->lines++;
+}
+
+void tracelist_text(tracelist_t *tl, const char *s) {
+	if (tl->format == TRACELIST_TEXT)
+		emit(tl, s);
+}
+
+void tracelist_begin(tracelist_t *tl) {
+	tl->lines = 0;
+	memset(&tl->out, 0, sizeof(tl->out));
+	memset(&tl->held, 0, sizeof(tl->held));
+	if (tl->format == TRACELIST_TEXT) {
+		emit(tl, "      Start |        End | Src | Data (! denotes parity error)                                           | CRC | Annotation");
+		emit(tl, "------------+------------+-----+-------------------------------------------------------------------------+-----+--------------------");
+	} else if (tl->format == TRACELIST_JSON)
+		emit(tl, "[");
+	else if (tl->format == TRACELIST_CSV)
+		emit(tl, "session,start,end,src,data,parity_errors,crc,annotation,key,decrypted,decrypted_crc,decrypted_annotation,fdt");
+}
+
+void tracelist_end(tracelist_t *tl) {
+	if (tl->format == TRACELIST_JSON) {
+		if (tl->lines)
+			emit(tl, tl->held.s);
+		emit(tl, "]");
+	}
+	if (tl->f)
+		fflush(tl->f);
+	free(tl->out.s);
+	free(tl->held.s);
+	memset(&tl->out, 0, sizeof(tl->out));
+	memset(&tl->held, 0, sizeof(tl->held));
+}
+
+//-----------------------------------------------------------------------------
+// pipeline
+//-----------------------------------------------------------------------------
+typedef struct {
+	uint32_t batch;				// batch held or expected next
+	bool ready;
+	uint32_t count;
+	trace_line_t *lines;
+} tracelist_slot_t;
+
+typedef struct {
+	tracelist_t *tl;
+	uint32_t session;
+	uint8_t *trace;
+	uint32_t traceLen;
+	uint32_t tracepos;
+	uint32_t stop;
+	const uint64_t *offsets;
+	uint64_t base;
+	uint32_t records;
+	uint32_t batches;			// parallel,  0 = decoded by the caller until stop
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32_t next;				// next batch to decode
+	bool done;					// sequential,  no more batches
+	uint32_t last;				// sequential,  batches made
+	uint32_t nslots;
+	tracelist_slot_t *slots;
+} tracelist_pipe_t;
+
+static tracelist_slot_t *slot_acquire(tracelist_pipe_t *p, uint32_t batch) {
+	tracelist_slot_t *slot = &p->slots[batch % p->nslots];
+	pthread_mutex_lock(&p->lock);
+	while (slot->batch != batch || slot->ready)
+		pthread_cond_wait(&p->cond, &p->lock);
+	pthread_mutex_unlock(&p->lock);
+	return slot;
+}
+
+static void slot_publish(tracelist_pipe_t *p, tracelist_slot_t *slot) {
+	pthread_mutex_lock(&p->lock);
+	slot->ready = true;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+}
+
+static void *decode_worker(void *arg) {
+	tracelist_pipe_t *p = (tracelist_pipe_t *)arg;
+	tracelist_t *tl = p->tl;
+
+	for (;;) {
+		pthread_mutex_lock(&p->lock);
+		uint32_t batch = p->next++;
+		pthread_mutex_unlock(&p->lock);
+		if (batch >= p->batches)
+			break;
+
+		tracelist_slot_t *slot = slot_acquire(p, batch);
+
+		uint32_t rec = batch * TRACELIST_BATCH;
+		uint32_t recend = rec + TRACELIST_BATCH;
+		uint32_t pos = p->offsets[rec] - p->base;
+		uint32_t end = (recend < p->records) ? p->offsets[recend] - p->base : p->stop;
+
+		slot->count = 0;
+		while (pos < end && slot->count < TRACELIST_BATCH) {
+			pos = tracelist_decode(pos, p->traceLen, p->trace, tl->protocol, tl->showWaitCycles, &slot->lines[slot->count]);
+			if (slot->lines[slot->count].valid)
+				slot->count++;
+		}
+		slot_publish(p, slot);
+	}
+	return NULL;
+}
+
+// stateful protocols,  one decoder walks the records
+static void decode_sequential(tracelist_pipe_t *p) {
+	tracelist_t *tl = p->tl;
+	uint32_t pos = p->tracepos;
+	uint32_t batch = 0;
+
+	while (pos < p->stop) {
+		tracelist_slot_t *slot = slot_acquire(p, batch);
+		slot->count = 0;
+		while (pos < p->stop && slot->count < TRACELIST_BATCH) {
+			pos = tracelist_decode(pos, p->traceLen, p->trace, tl->protocol, tl->showWaitCycles, &slot->lines[slot->count]);
+			if (slot->lines[slot->count].valid)
+				slot->count++;
+		}
+		slot_publish(p, slot);
+		batch++;
+	}
+
+	pthread_mutex_lock(&p->lock);
+	p->last = batch;
+	p->done = true;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+}
+
+static void *write_worker(void *arg) {
+	tracelist_pipe_t *p = (tracelist_pipe_t *)arg;
+
+	for (uint32_t batch = 0; ; batch++) {
+		tracelist_slot_t *slot = &p->slots[batch % p->nslots];
+
+		pthread_mutex_lock(&p->lock);
+		while (!(slot->batch == batch && slot->ready)) {
+			if (p->batches ? batch >= p->batches : (p->done && batch >= p->last))
+				break;
+			pthread_cond_wait(&p->cond, &p->lock);
+		}
+		bool ready = slot->batch == batch && slot->ready;
+		pthread_mutex_unlock(&p->lock);
+		if (!ready)
+			break;
+
+		for (uint32_t i = 0; i < slot->count; i++)
+			tracelist_write(p->tl, p->session, &slot->lines[i]);
+
+		pthread_mutex_lock(&p->lock);
+		slot->ready = false;
+		slot->batch = batch + p->nslots;
+		pthread_cond_broadcast(&p->cond);
+		pthread_mutex_unlock(&p->lock);
+	}
+	return NULL;
+}
+
+void tracelist_run(tracelist_t *tl, uint32_t session, uint8_t *trace, uint32_t traceLen, uint32_t tracepos, uint32_t stop,
+	const uint64_t *offsets, uint64_t base, uint32_t records) {
+
+	bool sequential = (tl->protocol == PROTO_MIFARE || tl->protocol == TOPAZ || offsets == NULL || records == 0);
+	int threads = (tl->threads > 0) ? tl->threads : num_CPUs();
+
+	// small listings,  not worth the threads
+	if (threads == 1 || stop - tracepos < 64 * 1024) {
+		trace_line_t line;
+		while (tracepos < stop) {
+			tracepos = tracelist_decode(tracepos, traceLen, trace, tl->protocol, tl->showWaitCycles, &line);
+			tracelist_write(tl, session, &line);
+		}
+		return;
+	}
+
+	tracelist_pipe_t p = {0};
+	p.tl = tl;
+	p.session = session;
+	p.trace = trace;
+	p.traceLen = traceLen;
+	p.tracepos = tracepos;
+	p.stop = stop;
+	p.offsets = offsets;
+	p.base = base;
+	p.records = records;
+	p.batches = sequential ? 0 : (records + TRACELIST_BATCH - 1) / TRACELIST_BATCH;
+	int workers = sequential ? 1 : threads;
+	p.nslots = TRACELIST_SLOTS * workers;
+
+	p.slots = calloc(p.nslots, sizeof(tracelist_slot_t));
+	if (p.slots == NULL) {
+		PrintAndLogEx(FAILED, "Cannot allocate memory for the listing");
+		return;
+	}
+	for (uint32_t i = 0; i < p.nslots; i++) {
+		p.slots[i].batch = i;
+		p.slots[i].lines = malloc(TRACELIST_BATCH * sizeof(trace_line_t));
+		if (p.slots[i].lines == NULL) {
+			PrintAndLogEx(FAILED, "Cannot allocate memory for the listing");
+			for (uint32_t j = 0; j < i; j++)
+				free(p.slots[j].lines);
+			free(p.slots);
+			return;
+		}
+	}
+	pthread_mutex_init(&p.lock, NULL);
+	pthread_cond_init(&p.cond, NULL);
+
+	pthread_t writer;
+	pthread_t *ids = calloc(workers, sizeof(pthread_t));
+	pthread_create(&writer, NULL, write_worker, &p);
+
+	if (sequential) {
+		decode_sequential(&p);
+	} else {
+		// the caller is the last worker
+		for (int i = 0; i < workers - 1; i++)
+			pthread_create(&ids[i], NULL, decode_worker, &p);
+		decode_worker(&p);
+		for (int i = 0; i < workers - 1; i++)
+			pthread_join(ids[i], NULL);
+	}
+	pthread_join(writer, NULL);
+
+	free(ids);
+	for (uint32_t i = 0; i < p.nslots; i++)
+		free(p.slots[i].lines);
+	free(p.slots);
+	pthread_cond_destroy(&p.cond);
+	pthread_mutex_destroy(&p.lock);
+}
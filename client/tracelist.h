@@ -0,0 +1,83 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Trace listing,  records decoded to lines and written as text,  JSON or CSV
+//-----------------------------------------------------------------------------
+
+#ifndef TRACELIST_H__
+#define TRACELIST_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACELIST_MAX_ROWS		18		// text,  18 rows of 18 bytes are shown
+#define TRACELIST_TOPAZ_LEN		16
+
+// one record,  decoded and annotated.  Timestamps are relative to the session start.
+typedef struct {
+	bool valid;						// false for an empty or cut record,  nothing is listed
+	bool isResponse;
+	uint32_t start;
+	uint32_t end;
+	uint16_t len;
+	const uint8_t *frame;			// into the trace,  or topaz
+	uint8_t topaz[TRACELIST_TOPAZ_LEN];	// merged topaz reader frames
+	const uint8_t *parity;
+	uint8_t crc;					// 0 bad,  1 ok,  2 no crc
+	char explanation[80];
+	char note[160];					// mf,  the key line of an auth session
+	uint8_t mfData[32];				// mf,  decrypted
+	uint8_t mfDataLen;
+	uint8_t mfCrc;
+	char mfExplanation[80];
+	bool fdt;						// a response follows,  with f
+	uint32_t fdtNext;				// its start
+} trace_line_t;
+
+typedef enum {
+	TRACELIST_TEXT = 0,
+	TRACELIST_JSON,
+	TRACELIST_CSV,
+} tracelist_format_t;
+
+typedef struct {
+	char *s;
+	size_t len;
+	size_t size;
+} tracelist_buf_t;
+
+typedef struct {
+	uint8_t protocol;
+	bool showWaitCycles;
+	bool markCRCBytes;
+	tracelist_format_t format;
+	FILE *f;						// NULL,  to the console
+	int threads;					// <= 0 all CPUs
+	uint64_t lines;					// written,  counted from tracelist_begin()
+	tracelist_buf_t out;
+	tracelist_buf_t held;			// json,  the last object waits for its comma
+} tracelist_t;
+
+// decodes the record at tracepos,  the next position is returned.  Keeps the mf
+// auth state of the calling thread,  the other protocols have no state.
+extern uint32_t tracelist_decode(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, trace_line_t *tl);
+// writes a decoded line
+extern void tracelist_write(tracelist_t *tl, uint32_t session, const trace_line_t *line);
+
+// a line of the text listing,  dropped by the other formats
+extern void tracelist_text(tracelist_t *tl, const char *s);
+
+// the column header,  or the start of the JSON array
+extern void tracelist_begin(tracelist_t *tl);
+extern void tracelist_end(tracelist_t *tl);
+
+// lists [tracepos, stop) of a session.  offsets are the record positions of the
+// range if known,  NULL walks the records.  Worker threads decode batches of records,
+// one writer thread writes them in order.  mf and topaz are decoded in the calling thread.
+extern void tracelist_run(tracelist_t *tl, uint32_t session, uint8_t *trace, uint32_t traceLen, uint32_t tracepos, uint32_t stop,
+	const uint64_t *offsets, uint64_t base, uint32_t records);
+
+#endif
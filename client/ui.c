@@ -47,11 +47,23 @@ void PrintAndLogOptions(char *str[][2], size_t size, size_t space) {
     }
     PrintAndLogEx(NORMAL, buff);
 }
+// worker threads that verify in bulk turn their own output off
+static __thread bool print_muted = false;
+void SetPrintAndLogMuted(bool muted) {
+	print_muted = muted;
+}
+bool PrintAndLogMuted(void) {
+	return print_muted;
+}
+
 void PrintAndLogEx(logLevel_t level, char *fmt, ...) {
 
 	// skip debug messages if client debugging is turned off i.e. 'DATA SETDEBUG 0' 
 	if (g_debugMode	== 0 && level == DEBUG)
 		return;
+
+	if (print_muted)
+		return;
 	
 	char buffer[MAX_PRINT_BUFFER] = {0};
 	char buffer2[MAX_PRINT_BUFFER] = {0};
@@ -37,6 +37,9 @@ extern void PrintAndLog(char *fmt, ...);
 void PrintAndLogOptions(char *str[][2], size_t size, size_t space);
 void PrintAndLogEx(logLevel_t level, char *fmt, ...);
 extern void SetLogFilename(char *fn);
+// per thread,  PrintAndLogEx() drops everything while muted
+extern void SetPrintAndLogMuted(bool muted);
+extern bool PrintAndLogMuted(void);
 
 extern double CursorScaleFactor;
 extern int PlotGridX, PlotGridY, PlotGridXdefault, PlotGridYdefault, CursorCPos, CursorDPos, GridOffset;
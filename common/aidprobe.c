@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// EMV application discovery in one go,  see aidprobe.h
+//-----------------------------------------------------------------------------
+
+#include "aidprobe.h"
+#include <string.h>
+
+int aidprobe_run(const uint8_t *list, size_t listlen, aidprobe_exchange_t exchange, void *ctx, uint8_t *out, size_t outsize, size_t *outlen, int *status) {
+	uint8_t apdu[6 + AIDPROBE_MAX_AID];
+	uint8_t resp[AIDPROBE_RESP_MAX];
+	size_t pos = 0;
+	int count = 0;
+
+	*outlen = 0;
+	*status = AIDPROBE_OK;
+
+	while (pos < listlen) {
+		uint8_t aidlen = list[pos];
+		if (!aidlen || aidlen > AIDPROBE_MAX_AID || pos + 1 + aidlen > listlen || count == AIDPROBE_MAX_COUNT) {
+			*status = AIDPROBE_FORMAT;
+			break;
+		}
+
+		// SELECT by name,  first or only occurrence
+		apdu[0] = 0x00;
+		apdu[1] = 0xA4;
+		apdu[2] = 0x04;
+		apdu[3] = 0x00;
+		apdu[4] = aidlen;
+		memcpy(apdu + 5, list + pos + 1, aidlen);
+		apdu[5 + aidlen] = 0x00;
+
+		// SW1 SW2 CRC at least
+		int len = exchange(ctx, apdu, 6 + aidlen, resp);
+		if (len < 4 || len > AIDPROBE_RESP_MAX) {
+			*status = AIDPROBE_LINK;
+			break;
+		}
+
+		if (resp[len - 4] == 0x90 && resp[len - 3] == 0x00) {
+			size_t datalen = len - 4;
+			if (*outlen + 3 + datalen > outsize) {
+				*status = AIDPROBE_FULL;
+				break;
+			}
+			out[(*outlen)++] = count;
+			out[(*outlen)++] = datalen & 0xFF;
+			out[(*outlen)++] = datalen >> 8;
+			memcpy(out + *outlen, resp, datalen);
+			*outlen += datalen;
+		}
+
+		pos += 1 + aidlen;
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,37 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// EMV application discovery in one go.  The reader SELECTs every AID of a
+// list by itself and only answers with SW 9000 go back.  The same loop runs
+// in the firmware and in the client side card simulator.
+//-----------------------------------------------------------------------------
+
+#ifndef AIDPROBE_H__
+#define AIDPROBE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// request:  the AIDs,  each as <len> <aid bytes>
+// response: one record per hit,  <index in the request> <len, 2 bytes little endian>
+//           <answer without SW>.  A full FCI is 256 bytes.
+#define AIDPROBE_MAX_AID	16
+#define AIDPROBE_MAX_COUNT	255
+#define AIDPROBE_RESP_MAX	260
+
+#define AIDPROBE_OK			0	// the whole list was probed
+#define AIDPROBE_LINK		1	// no or a broken answer to the AID after the probed ones
+#define AIDPROBE_FULL		2	// no room for the next hit,  probe again from there
+#define AIDPROBE_FORMAT		3	// bad request
+
+// the iso14_apdu() contract: APDU in,  answer without PCB but with CRC and
+// its length back,  0 on no answer,  -1 on a CRC error.  A chained answer comes
+// back joined,  at most AIDPROBE_RESP_MAX bytes.
+typedef int (*aidprobe_exchange_t)(void *ctx, uint8_t *cmd, uint16_t cmdlen, uint8_t *resp);
+
+// returns how many AIDs of the list were probed
+int aidprobe_run(const uint8_t *list, size_t listlen, aidprobe_exchange_t exchange, void *ctx, uint8_t *out, size_t outsize, size_t *outlen, int *status);
+
+#endif
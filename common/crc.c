@@ -108,21 +108,67 @@ uint32_t CRC8Mad(uint8_t *buff, size_t size) {
 		crc_update2(&crc, buff[i], 8);
 	return reflect8(crc_finish(&crc));
 }
-// width=4  poly=0xC, reversed poly=0x7  init=0x5   refin=true  refout=true  xorout=0x0000  check=  name="CRC-4/LEGIC"
+// the LEGIC crc tables,  one byte per lookup.
+// crc8: reflected register of poly 0x63,  legic_crc8_table[i] is i shifted through 8 times.
+// crc4: the lsb first register of crc4_legic,  8 data bits shifted through from state i.
+static const uint8_t legic_crc8_table[256] = {
+	0x00, 0x13, 0x26, 0x35, 0x4c, 0x5f, 0x6a, 0x79, 0x98, 0x8b, 0xbe, 0xad, 0xd4, 0xc7, 0xf2, 0xe1,
+	0xbd, 0xae, 0x9b, 0x88, 0xf1, 0xe2, 0xd7, 0xc4, 0x25, 0x36, 0x03, 0x10, 0x69, 0x7a, 0x4f, 0x5c,
+	0xf7, 0xe4, 0xd1, 0xc2, 0xbb, 0xa8, 0x9d, 0x8e, 0x6f, 0x7c, 0x49, 0x5a, 0x23, 0x30, 0x05, 0x16,
+	0x4a, 0x59, 0x6c, 0x7f, 0x06, 0x15, 0x20, 0x33, 0xd2, 0xc1, 0xf4, 0xe7, 0x9e, 0x8d, 0xb8, 0xab,
+	0x63, 0x70, 0x45, 0x56, 0x2f, 0x3c, 0x09, 0x1a, 0xfb, 0xe8, 0xdd, 0xce, 0xb7, 0xa4, 0x91, 0x82,
+	0xde, 0xcd, 0xf8, 0xeb, 0x92, 0x81, 0xb4, 0xa7, 0x46, 0x55, 0x60, 0x73, 0x0a, 0x19, 0x2c, 0x3f,
+	0x94, 0x87, 0xb2, 0xa1, 0xd8, 0xcb, 0xfe, 0xed, 0x0c, 0x1f, 0x2a, 0x39, 0x40, 0x53, 0x66, 0x75,
+	0x29, 0x3a, 0x0f, 0x1c, 0x65, 0x76, 0x43, 0x50, 0xb1, 0xa2, 0x97, 0x84, 0xfd, 0xee, 0xdb, 0xc8,
+	0xc6, 0xd5, 0xe0, 0xf3, 0x8a, 0x99, 0xac, 0xbf, 0x5e, 0x4d, 0x78, 0x6b, 0x12, 0x01, 0x34, 0x27,
+	0x7b, 0x68, 0x5d, 0x4e, 0x37, 0x24, 0x11, 0x02, 0xe3, 0xf0, 0xc5, 0xd6, 0xaf, 0xbc, 0x89, 0x9a,
+	0x31, 0x22, 0x17, 0x04, 0x7d, 0x6e, 0x5b, 0x48, 0xa9, 0xba, 0x8f, 0x9c, 0xe5, 0xf6, 0xc3, 0xd0,
+	0x8c, 0x9f, 0xaa, 0xb9, 0xc0, 0xd3, 0xe6, 0xf5, 0x14, 0x07, 0x32, 0x21, 0x58, 0x4b, 0x7e, 0x6d,
+	0xa5, 0xb6, 0x83, 0x90, 0xe9, 0xfa, 0xcf, 0xdc, 0x3d, 0x2e, 0x1b, 0x08, 0x71, 0x62, 0x57, 0x44,
+	0x18, 0x0b, 0x3e, 0x2d, 0x54, 0x47, 0x72, 0x61, 0x80, 0x93, 0xa6, 0xb5, 0xcc, 0xdf, 0xea, 0xf9,
+	0x52, 0x41, 0x74, 0x67, 0x1e, 0x0d, 0x38, 0x2b, 0xca, 0xd9, 0xec, 0xff, 0x86, 0x95, 0xa0, 0xb3,
+	0xef, 0xfc, 0xc9, 0xda, 0xa3, 0xb0, 0x85, 0x96, 0x77, 0x64, 0x51, 0x42, 0x3b, 0x28, 0x1d, 0x0e
+};
+
+static const uint8_t legic_crc4_table[256] = {
+	0x00, 0x07, 0x0e, 0x09, 0x05, 0x02, 0x0b, 0x0c, 0x0a, 0x0d, 0x04, 0x03, 0x0f, 0x08, 0x01, 0x06,
+	0x0d, 0x0a, 0x03, 0x04, 0x08, 0x0f, 0x06, 0x01, 0x07, 0x00, 0x09, 0x0e, 0x02, 0x05, 0x0c, 0x0b,
+	0x03, 0x04, 0x0d, 0x0a, 0x06, 0x01, 0x08, 0x0f, 0x09, 0x0e, 0x07, 0x00, 0x0c, 0x0b, 0x02, 0x05,
+	0x0e, 0x09, 0x00, 0x07, 0x0b, 0x0c, 0x05, 0x02, 0x04, 0x03, 0x0a, 0x0d, 0x01, 0x06, 0x0f, 0x08,
+	0x06, 0x01, 0x08, 0x0f, 0x03, 0x04, 0x0d, 0x0a, 0x0c, 0x0b, 0x02, 0x05, 0x09, 0x0e, 0x07, 0x00,
+	0x0b, 0x0c, 0x05, 0x02, 0x0e, 0x09, 0x00, 0x07, 0x01, 0x06, 0x0f, 0x08, 0x04, 0x03, 0x0a, 0x0d,
+	0x05, 0x02, 0x0b, 0x0c, 0x00, 0x07, 0x0e, 0x09, 0x0f, 0x08, 0x01, 0x06, 0x0a, 0x0d, 0x04, 0x03,
+	0x08, 0x0f, 0x06, 0x01, 0x0d, 0x0a, 0x03, 0x04, 0x02, 0x05, 0x0c, 0x0b, 0x07, 0x00, 0x09, 0x0e,
+	0x0c, 0x0b, 0x02, 0x05, 0x09, 0x0e, 0x07, 0x00, 0x06, 0x01, 0x08, 0x0f, 0x03, 0x04, 0x0d, 0x0a,
+	0x01, 0x06, 0x0f, 0x08, 0x04, 0x03, 0x0a, 0x0d, 0x0b, 0x0c, 0x05, 0x02, 0x0e, 0x09, 0x00, 0x07,
+	0x0f, 0x08, 0x01, 0x06, 0x0a, 0x0d, 0x04, 0x03, 0x05, 0x02, 0x0b, 0x0c, 0x00, 0x07, 0x0e, 0x09,
+	0x02, 0x05, 0x0c, 0x0b, 0x07, 0x00, 0x09, 0x0e, 0x08, 0x0f, 0x06, 0x01, 0x0d, 0x0a, 0x03, 0x04,
+	0x0a, 0x0d, 0x04, 0x03, 0x0f, 0x08, 0x01, 0x06, 0x00, 0x07, 0x0e, 0x09, 0x05, 0x02, 0x0b, 0x0c,
+	0x07, 0x00, 0x09, 0x0e, 0x02, 0x05, 0x0c, 0x0b, 0x0d, 0x0a, 0x03, 0x04, 0x08, 0x0f, 0x06, 0x01,
+	0x09, 0x0e, 0x07, 0x00, 0x0c, 0x0b, 0x02, 0x05, 0x03, 0x04, 0x0d, 0x0a, 0x06, 0x01, 0x08, 0x0f,
+	0x04, 0x03, 0x0a, 0x0d, 0x01, 0x06, 0x0f, 0x08, 0x0e, 0x09, 0x00, 0x07, 0x0b, 0x0c, 0x05, 0x02
+};
+
+// width=4  poly=0xC, reversed poly=0x7  init=0x5   refin=false  refout=false  xorout=0x0000  check=  name="CRC-4/LEGIC"
+// data goes in lsb first,  as the reader sends it.  Same as crc_update() on crc_init(4, 0x19 >> 1, 0x5, 0).
+uint32_t crc4_legic(uint32_t data, uint8_t bits) {
+	uint8_t state = 0x5;
+	for (; bits >= 8; bits -= 8, data >>= 8)
+		state = legic_crc4_table[(state ^ data) & 0xFF];
+	for (; bits > 0; bits--, data >>= 1)
+		state = (state >> 1) ^ (((state ^ data) & 1) ? 0xC : 0);
+	return state;
+}
+// crc4 of a READ command,  cmd[0] address,  cmd[1] the byte read.  (8bit address)
 uint32_t CRC4Legic(uint8_t *cmd, size_t size) {
- 	crc_t crc;
- 	crc_init_ref(&crc, 4, 0x19 >> 1, 0x5, 0, true, true);
-	crc_update2(&crc, 1, 1); /* CMD_READ */
-	crc_update2(&crc, cmd[0], 8);
-	crc_update2(&crc, cmd[1], 8);
-	return reflect(crc_finish(&crc), 4);	
+	(void)size;
+	return crc4_legic(((uint32_t)cmd[1] << 9) | ((uint32_t)cmd[0] << 1) | 1, 17);
 }
 // width=8  poly=0x63, reversed poly=0x8D  init=0x55  refin=true  refout=true  xorout=0x0000  check=0xC6  name="CRC-8/LEGIC"
 // the CRC needs to be reversed before returned.
 uint32_t CRC8Legic(uint8_t *buff, size_t size) {
-	crc_t crc;
-	crc_init_ref(&crc, 8, 0x63, 0x55, 0, true, true);
-	for ( int i = 0; i < size; ++i)
-		crc_update2(&crc, buff[i], 8);
-	return reflect8(crc_finish(&crc));
+	uint8_t crc = 0x55;
+	for (size_t i = 0; i < size; ++i)
+		crc = legic_crc8_table[crc ^ buff[i]];
+	return reflect8(crc);
 }
\ No newline at end of file
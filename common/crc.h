@@ -56,9 +56,12 @@ uint32_t CRC8Maxim(uint8_t *buff, size_t size);
 // Calculate CRC-8 Mifare MAD checksum
 uint32_t CRC8Mad(uint8_t *buff, size_t size);
 
-// Calculate CRC-4/Legic checksum
+// Calculate CRC-4/Legic checksum of a READ command
 uint32_t CRC4Legic(uint8_t *buff, size_t size);
 
+// Calculate CRC-4/Legic over bits of data, lsb first
+uint32_t crc4_legic(uint32_t data, uint8_t bits);
+
 // Calculate CRC-8/Legic checksum
 uint32_t CRC8Legic(uint8_t *buff, size_t size);
 
@@ -258,9 +258,51 @@ uint16_t crc16_iclass(uint8_t const *d, size_t n) {
 	return crc16_fast(d, n, 0x4807, true, true);
 }
 
+// generate_table(CRC16_POLY_LEGIC, true),  own copy so it does not depend on init_table()
+static const uint16_t crc16_legic_table[256] = {
+	0x0000, 0x0b11, 0x1622, 0x1d33, 0x2c44, 0x2755, 0x3a66, 0x3177,
+	0x5888, 0x5399, 0x4eaa, 0x45bb, 0x74cc, 0x7fdd, 0x62ee, 0x69ff,
+	0x77d7, 0x7cc6, 0x61f5, 0x6ae4, 0x5b93, 0x5082, 0x4db1, 0x46a0,
+	0x2f5f, 0x244e, 0x397d, 0x326c, 0x031b, 0x080a, 0x1539, 0x1e28,
+	0x2969, 0x2278, 0x3f4b, 0x345a, 0x052d, 0x0e3c, 0x130f, 0x181e,
+	0x71e1, 0x7af0, 0x67c3, 0x6cd2, 0x5da5, 0x56b4, 0x4b87, 0x4096,
+	0x5ebe, 0x55af, 0x489c, 0x438d, 0x72fa, 0x79eb, 0x64d8, 0x6fc9,
+	0x0636, 0x0d27, 0x1014, 0x1b05, 0x2a72, 0x2163, 0x3c50, 0x3741,
+	0x52d2, 0x59c3, 0x44f0, 0x4fe1, 0x7e96, 0x7587, 0x68b4, 0x63a5,
+	0x0a5a, 0x014b, 0x1c78, 0x1769, 0x261e, 0x2d0f, 0x303c, 0x3b2d,
+	0x2505, 0x2e14, 0x3327, 0x3836, 0x0941, 0x0250, 0x1f63, 0x1472,
+	0x7d8d, 0x769c, 0x6baf, 0x60be, 0x51c9, 0x5ad8, 0x47eb, 0x4cfa,
+	0x7bbb, 0x70aa, 0x6d99, 0x6688, 0x57ff, 0x5cee, 0x41dd, 0x4acc,
+	0x2333, 0x2822, 0x3511, 0x3e00, 0x0f77, 0x0466, 0x1955, 0x1244,
+	0x0c6c, 0x077d, 0x1a4e, 0x115f, 0x2028, 0x2b39, 0x360a, 0x3d1b,
+	0x54e4, 0x5ff5, 0x42c6, 0x49d7, 0x78a0, 0x73b1, 0x6e82, 0x6593,
+	0x6363, 0x6872, 0x7541, 0x7e50, 0x4f27, 0x4436, 0x5905, 0x5214,
+	0x3beb, 0x30fa, 0x2dc9, 0x26d8, 0x17af, 0x1cbe, 0x018d, 0x0a9c,
+	0x14b4, 0x1fa5, 0x0296, 0x0987, 0x38f0, 0x33e1, 0x2ed2, 0x25c3,
+	0x4c3c, 0x472d, 0x5a1e, 0x510f, 0x6078, 0x6b69, 0x765a, 0x7d4b,
+	0x4a0a, 0x411b, 0x5c28, 0x5739, 0x664e, 0x6d5f, 0x706c, 0x7b7d,
+	0x1282, 0x1993, 0x04a0, 0x0fb1, 0x3ec6, 0x35d7, 0x28e4, 0x23f5,
+	0x3ddd, 0x36cc, 0x2bff, 0x20ee, 0x1199, 0x1a88, 0x07bb, 0x0caa,
+	0x6555, 0x6e44, 0x7377, 0x7866, 0x4911, 0x4200, 0x5f33, 0x5422,
+	0x31b1, 0x3aa0, 0x2793, 0x2c82, 0x1df5, 0x16e4, 0x0bd7, 0x00c6,
+	0x6939, 0x6228, 0x7f1b, 0x740a, 0x457d, 0x4e6c, 0x535f, 0x584e,
+	0x4666, 0x4d77, 0x5044, 0x5b55, 0x6a22, 0x6133, 0x7c00, 0x7711,
+	0x1eee, 0x15ff, 0x08cc, 0x03dd, 0x32aa, 0x39bb, 0x2488, 0x2f99,
+	0x18d8, 0x13c9, 0x0efa, 0x05eb, 0x349c, 0x3f8d, 0x22be, 0x29af,
+	0x4050, 0x4b41, 0x5672, 0x5d63, 0x6c14, 0x6705, 0x7a36, 0x7127,
+	0x6f0f, 0x641e, 0x792d, 0x723c, 0x434b, 0x485a, 0x5569, 0x5e78,
+	0x3787, 0x3c96, 0x21a5, 0x2ab4, 0x1bc3, 0x10d2, 0x0de1, 0x06f0
+};
+
 // This CRC-16 is used in Legic Advant systems. 
 // poly=0xB400,  init=depends  refin=true  refout=true  xorout=0x0000  check=  name="CRC-16/LEGIC"
 uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc) {
 	uint16_t initial = uidcrc << 8 | uidcrc;
-	return crc16_fast(d, n, initial, true, true);
+	if (n == 0)
+		return ~initial;
+
+	uint16_t crc = reflect16(initial);
+	while (n--)
+		crc = (crc >> 8) ^ crc16_legic_table[(crc & 0xFF) ^ *d++];
+	return crc;
 }
@@ -0,0 +1,397 @@
+//-----------------------------------------------------------------------------
+// Gerhard de Koning Gans - May 2008
+// Gerhard de Koning Gans - June 2012
+//
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// iClass reader 1 out of 4 and tag Manchester decoders,  see iclass_decode.h
+//-----------------------------------------------------------------------------
+
+#include "iclass_decode.h"
+
+#ifdef ON_DEVICE
+# include "apps.h"			// Dbprintf
+#endif
+
+//=============================================================================
+// READER TO CARD,  1 out of 4
+//=============================================================================
+// uart_samples() gets the reader field 8 samples,  one bit slot of 128/fc,  at a
+// time and finds the falling edge of a pause.  uart_bit() gets a 0 for a slot
+// with an edge,  8 slots are a symbol:
+//   SOF 0111 1011,  0 1011 1111,  1 1110 1111,  2 1111 1011,  3 1111 1110,
+//   EOF 1101 1111
+//-----------------------------------------------------------------------------
+
+// The highest falling edge,  a 1 followed by a 0,  in bits 0..7 of 9 samples.
+// -1 no edge.
+static const int8_t Iclass_Falling_LUT[512] = {
+	-1, -1,  0, -1,  1,  1,  0, -1,  2,  2,  2,  2,  1,  1,  0, -1,
+	 3,  3,  3,  3,  3,  3,  3,  3,  2,  2,  2,  2,  1,  1,  0, -1,
+	 4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,
+	 3,  3,  3,  3,  3,  3,  3,  3,  2,  2,  2,  2,  1,  1,  0, -1,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,
+	 3,  3,  3,  3,  3,  3,  3,  3,  2,  2,  2,  2,  1,  1,  0, -1,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,
+	 3,  3,  3,  3,  3,  3,  3,  3,  2,  2,  2,  2,  1,  1,  0, -1,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,  6,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,
+	 3,  3,  3,  3,  3,  3,  3,  3,  2,  2,  2,  2,  1,  1,  0, -1
+};
+
+// 8 slots to a symbol,  0..3 the two data bits,  4 EOF,  5 not a symbol
+#define ICLASS_SYM_EOF		4
+#define ICLASS_SYM_BAD		5
+static const uint8_t Iclass_Symbol_LUT[256] = {
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  0,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  4,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  1,
+	 5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  5,  2,  5,  5,  3,  5
+};
+
+void uart_reset(tUartIclass *uart) {
+	uart->frame_done = false;
+	uart->synced = false;
+	uart->frame = false;
+}
+
+void uart_init(tUartIclass *uart, uint8_t *data) {
+	uart->buf = data;
+	uart->len = 0;
+	uart->slots = 0xff;
+	uart->n_slots = 0;
+	uart->msg_byte = 0;
+	uart->n_msg_bits = 0;
+	uart_reset(uart);
+}
+
+static inline void uart_bit(tUartIclass *uart, uint8_t bit) {
+	uart->slots = (uart->slots << 1) | bit;
+
+	if (!uart->frame) {
+		if (uart->slots == 0x7b) {	// 0b0111 1011
+			uart->frame = true;
+			uart->n_slots = 0;
+			uart->len = 0;
+			uart->n_msg_bits = 0;
+		}
+		return;
+	}
+
+	if (++uart->n_slots < 8)
+		return;
+
+	uint8_t sym = Iclass_Symbol_LUT[uart->slots];
+	uart->msg_byte >>= 2;
+	if (sym < ICLASS_SYM_EOF) {	// data bits
+		uart->msg_byte |= sym << 6;
+		uart->n_msg_bits += 2;
+		if (uart->n_msg_bits >= 8) {
+			uart->buf[uart->len++] = uart->msg_byte;
+			uart->n_msg_bits = 0;
+		}
+	} else if (sym == ICLASS_SYM_EOF) {
+		uart->frame = false;
+		uart->synced = false;
+		uart->frame_done = true;
+	} else {
+		uart->frame = false;
+		uart->synced = false;
+#ifdef ON_DEVICE
+		Dbprintf("[-] bad %02X at %d:%d", uart->slots, uart->len, uart->n_msg_bits);
+#endif
+	}
+	uart->n_slots = 0;
+	uart->slots = 0xff;
+}
+
+RAMFUNC void uart_samples(tUartIclass *uart, uint8_t byte) {
+	int8_t edge;
+
+	if (!uart->synced) {
+		if (byte == 0xFF)
+			return;
+		uart->samples = 0xFFFF;
+		uart->window = 0;
+		uart->drop_next = false;
+		uart->synced = true;
+	}
+
+	uart->samples = (uart->samples << 8) | byte;
+
+	if (uart->drop_next) {
+		uart->drop_next = false;
+		return;
+	}
+
+again:
+	edge = Iclass_Falling_LUT[(uart->samples >> uart->window) & 0x1FF];
+
+	uart_bit(uart, edge < 0);
+
+	if (edge < 0)
+		return;
+
+	// aim to get falling edge on fourth-leftmost bit of window
+	uart->window += edge - 4;
+
+	if (uart->window < 0) {
+		uart->window += 8;
+		uart->drop_next = true;
+	} else if (uart->window >= 8) {
+		uart->window -= 8;
+		goto again;
+	}
+}
+
+//=============================================================================
+// CARD TO READER,  ISO15693-2 Manchester
+//=============================================================================
+// A call is half a bit period,  4 samples.  The decoder looks three calls ahead
+// for the SOF,  demod->buffer keeps the nibbles.
+//-----------------------------------------------------------------------------
+
+// The sample a modulation is synced to in the first modulated nibble,  as bits
+// 0..3,  0 no sync.
+static const uint8_t Iclass_Sync_LUT[16] = {
+	0, 0, 2, 1, 4, 1, 2, 2, 8, 1, 2, 2, 4, 4, 4, 4
+};
+
+void DemodIclassReset(tDemodIclass *demod) {
+	demod->bitCount = 0;
+	demod->posCount = 0;
+	demod->syncBit = 0;
+	demod->shiftReg = 0;
+	demod->buffer = 0;
+	demod->buff = 0;
+	demod->samples = 0;
+	demod->len = 0;
+	demod->sub = SUB_NONE;
+	demod->state = DEMOD_UNSYNCD;
+}
+
+void DemodIclassInit(tDemodIclass *demod, uint8_t *data) {
+	demod->output = data;
+	DemodIclassReset(demod);
+}
+
+// UART debug
+// it adds the debug values which will be put in the tracelog,
+// visible on client when running  'hf list iclass'
+static void uart_debug(tDemodIclass *demod, int error, int bit) {
+	demod->output[demod->len++] = 0xBB;
+	demod->output[demod->len++] = error & 0xFF;
+	demod->output[demod->len++] = 0xBB;
+	demod->output[demod->len++] = bit & 0xFF;
+	demod->output[demod->len++] = (demod->buffer >> 8) & 0x0F;
+	// Look harder ;-)
+	demod->output[demod->len++] = (demod->buffer >> 4) & 0x0F;
+	demod->output[demod->len++] = demod->syncBit & 0xFF;
+	demod->output[demod->len++] = 0xBB;
+}
+
+/*
+* Timings:
+*  ISO 15693-2
+*           Tout = 330 µs, Tprog 1 = 4 to 15 ms, Tslot = 330 µs + (number of slots x 160 µs)
+*
+*  So for current implementation in ISO15693, its 330 µs from end of reader, to start of card.
+*/
+RAMFUNC int ManchesterDecoding_iclass(tDemodIclass *demod, uint32_t v) {
+	int bit;
+	int error = 0;
+
+	demod->buffer = (demod->buffer << 4) | (v & 0x0F);
+	bit = demod->buffer >> 12;
+
+	// too few bits?
+	if (demod->buff < 3) {
+		demod->buff++;
+		return false;
+	}
+
+	if (demod->state == DEMOD_UNSYNCD) {
+		demod->syncBit = Iclass_Sync_LUT[bit];
+		if (!demod->syncBit)
+			return false;
+
+		// This is the first half bit period, so after syncing handle the second part
+		demod->posCount = 1;
+		demod->state = DEMOD_START_OF_COMMUNICATION;
+		demod->sub = SUB_FIRST_HALF;
+		demod->bitCount = 0;
+		demod->shiftReg = 0;
+		demod->len = 0;
+		switch (demod->syncBit) {
+			case 0x08: demod->samples = 3; break;
+			case 0x04: demod->samples = 2; break;
+			case 0x02: demod->samples = 1; break;
+			default:   demod->samples = 0; break;
+		}
+		// SOF must be long burst... otherwise stay unsynced!!!
+		if (!(demod->buffer & (demod->syncBit << 8)) || !(demod->buffer & (demod->syncBit << 4)))
+			demod->state = DEMOD_UNSYNCD;
+		return false;
+	}
+
+	// state is DEMOD is in SYNC from here on.
+
+	// the sync sample or the one after it,  in this nibble or the msb of the next
+	bool modulation = (demod->buffer >> 11) & (demod->syncBit * 3);
+	demod->samples += 4;
+
+	if (demod->posCount == 0) {
+		demod->posCount = 1;
+		demod->sub = (modulation) ? SUB_FIRST_HALF : SUB_NONE;
+		return false;
+	}
+
+	demod->posCount = 0;
+
+	if (modulation) {
+		if (demod->sub == SUB_FIRST_HALF)
+			demod->sub = SUB_BOTH;
+		else
+			demod->sub = SUB_SECOND_HALF;
+	}
+
+	if (demod->sub == SUB_NONE) {
+		if (demod->state == DEMOD_SOF_COMPLETE) {
+			demod->output[demod->len] = 0x0f;
+			demod->len++;
+			demod->state = DEMOD_UNSYNCD;
+			return true;
+		} else {
+			demod->state = DEMOD_ERROR_WAIT;
+			error = 0x33;
+		}
+	}
+
+	switch (demod->state) {
+
+		case DEMOD_START_OF_COMMUNICATION:
+			if (demod->sub == SUB_BOTH) {
+				demod->state = DEMOD_START_OF_COMMUNICATION2;
+				demod->posCount = 1;
+				demod->sub = SUB_NONE;
+			} else {
+				demod->state = DEMOD_ERROR_WAIT;
+				error = 0xd2;
+			}
+			break;
+
+		case DEMOD_START_OF_COMMUNICATION2:
+			if (demod->sub == SUB_SECOND_HALF) {
+				demod->state = DEMOD_START_OF_COMMUNICATION3;
+			} else {
+				demod->state = DEMOD_ERROR_WAIT;
+				error = 0xd3;
+			}
+			break;
+
+		case DEMOD_START_OF_COMMUNICATION3:
+			if (demod->sub == SUB_SECOND_HALF) {
+				demod->state = DEMOD_SOF_COMPLETE;
+			} else {
+				demod->state = DEMOD_ERROR_WAIT;
+				error = 0xd4;
+			}
+			break;
+
+		case DEMOD_SOF_COMPLETE:
+		case DEMOD_MANCHESTER_D:
+		case DEMOD_MANCHESTER_E:
+			// OPPOSITE FROM ISO14443 - 11110000 = 0 (1 in 14443)
+			//                          00001111 = 1 (0 in 14443)
+			if (demod->sub == SUB_SECOND_HALF) {
+				demod->bitCount++;
+				demod->shiftReg = (demod->shiftReg >> 1) ^ 0x100;
+				demod->state = DEMOD_MANCHESTER_D;
+			} else if (demod->sub == SUB_FIRST_HALF) {
+				demod->bitCount++;
+				demod->shiftReg >>= 1;
+				demod->state = DEMOD_MANCHESTER_E;
+			} else if (demod->sub == SUB_BOTH) {
+				demod->state = DEMOD_MANCHESTER_F;
+			} else {
+				demod->state = DEMOD_ERROR_WAIT;
+				error = 0x55;
+			}
+			break;
+
+		case DEMOD_MANCHESTER_F:
+			// Tag response does not need to be a complete byte!
+			if (demod->len > 0 || demod->bitCount > 0) {
+				if (demod->bitCount > 1) {  // was > 0, do not interpret last closing bit, is part of EOF
+					demod->shiftReg >>= (9 - demod->bitCount);	// right align data
+					demod->output[demod->len] = demod->shiftReg & 0xff;
+					demod->len++;
+				}
+
+				demod->state = DEMOD_UNSYNCD;
+				return true;
+			} else {
+				demod->state = DEMOD_ERROR_WAIT;
+				error = 0x03;
+			}
+			break;
+
+		case DEMOD_ERROR_WAIT:
+			demod->state = DEMOD_UNSYNCD;
+			break;
+
+		default:
+			demod->state = DEMOD_UNSYNCD;
+			break;
+	}
+
+	if (demod->bitCount >= 8) {
+		demod->shiftReg >>= 1;
+		demod->output[demod->len] = (demod->shiftReg & 0xff);
+		demod->len++;
+		demod->bitCount = 0;
+		demod->shiftReg = 0;
+	}
+
+	if (error) {
+		uart_debug(demod, error, bit);
+		return true;
+	}
+
+	return false;
+}
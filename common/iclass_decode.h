@@ -0,0 +1,92 @@
+//-----------------------------------------------------------------------------
+// Gerhard de Koning Gans - May 2008
+// Gerhard de Koning Gans - June 2012
+//
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// iClass reader 1 out of 4 and tag Manchester decoders.  Runs in the firmware
+// and in the client,  where `hf iclass decode` replays recorded FPGA samples
+// through it.
+//-----------------------------------------------------------------------------
+
+#ifndef ICLASS_DECODE_H__
+#define ICLASS_DECODE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ON_DEVICE
+# include "common.h"		// RAMFUNC
+#else
+# ifndef RAMFUNC
+#  define RAMFUNC
+# endif
+#endif
+
+/*
+* Abrasive's uart implementation
+* https://github.com/abrasive/proxmark3/commit/2b8bff7daea8ae1193bf7ee29b1fa46e95218902
+*/
+typedef struct {
+	bool synced;
+	bool frame;
+	bool frame_done;
+	uint8_t *buf;
+	int len;
+	// uart_samples,  the last two sample bytes and where the bit slot starts in them
+	uint16_t samples;
+	int8_t window;
+	bool drop_next;
+	// uart_bit,  one bit a slot,  1 no falling edge
+	uint8_t slots;
+	uint8_t n_slots;
+	uint8_t msg_byte;
+	uint8_t n_msg_bits;
+} tUartIclass;
+
+typedef struct {
+	enum {
+		DEMOD_UNSYNCD,
+		DEMOD_START_OF_COMMUNICATION,
+		DEMOD_START_OF_COMMUNICATION2,
+		DEMOD_START_OF_COMMUNICATION3,
+		DEMOD_SOF_COMPLETE,
+		DEMOD_MANCHESTER_D,
+		DEMOD_MANCHESTER_E,
+		DEMOD_END_OF_COMMUNICATION,
+		DEMOD_END_OF_COMMUNICATION2,
+		DEMOD_MANCHESTER_F,
+		DEMOD_ERROR_WAIT
+	}		state;
+	int		bitCount;
+	int		posCount;
+	int		syncBit;
+	uint16_t	shiftReg;
+	uint16_t	buffer;		// the last four nibbles,  the oldest in bits 15..12
+	int		buff;
+	int		samples;
+	int		len;
+	enum {
+		SUB_NONE,
+		SUB_FIRST_HALF,
+		SUB_SECOND_HALF,
+		SUB_BOTH
+	}		sub;
+	uint8_t	*output;
+} tDemodIclass;
+
+extern void uart_reset(tUartIclass *uart);
+extern void uart_init(tUartIclass *uart, uint8_t *data);
+// byte holds the reader field of one bit slot,  8 samples,  the oldest in bit 7.
+// A frame is in uart->buf when uart->frame_done.
+extern RAMFUNC void uart_samples(tUartIclass *uart, uint8_t byte);
+
+extern void DemodIclassReset(tDemodIclass *demod);
+extern void DemodIclassInit(tDemodIclass *demod, uint8_t *data);
+// v holds the tag modulation of half a bit period,  4 samples,  the oldest in
+// bit 3.  True with a frame,  or the debug bytes of an error,  in demod->output.
+extern RAMFUNC int ManchesterDecoding_iclass(tDemodIclass *demod, uint32_t v);
+
+#endif
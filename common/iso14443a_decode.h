@@ -0,0 +1,101 @@
+//-----------------------------------------------------------------------------
+// Merlok - June 2011
+// Gerhard de Koning Gans - May 2008
+// Hagen Fritsch - June 2010
+//
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// ISO 14443 type A Miller and Manchester decoders.  Runs in the firmware and in
+// the client,  where `hf 14a decode` replays recorded FPGA samples through it.
+//-----------------------------------------------------------------------------
+
+#ifndef ISO14443A_DECODE_H__
+#define ISO14443A_DECODE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ON_DEVICE
+# include "common.h"		// RAMFUNC
+#else
+# ifndef RAMFUNC
+#  define RAMFUNC
+# endif
+#endif
+
+typedef struct {
+	enum {
+		DEMOD_UNSYNCD,
+		// DEMOD_HALF_SYNCD,
+		// DEMOD_MOD_FIRST_HALF,
+		// DEMOD_NOMOD_FIRST_HALF,
+		DEMOD_MANCHESTER_DATA
+	} state;
+	uint16_t twoBits;
+	uint16_t highCnt;
+	uint16_t bitCount;
+	uint16_t collisionPos;
+	uint16_t syncBit;
+	uint8_t  parityBits;
+	uint8_t  parityLen;
+	uint16_t shiftReg;
+	uint16_t samples;
+	uint16_t len;
+	uint32_t startTime, endTime;
+	uint8_t  *output;
+	uint8_t  *parity;
+} tDemod;
+/*
+typedef enum {
+	MOD_NOMOD = 0,
+	MOD_SECOND_HALF,
+	MOD_FIRST_HALF,
+	MOD_BOTH_HALVES
+	} Modulation_t;
+*/
+
+typedef struct {
+	enum {
+		STATE_UNSYNCD,
+		STATE_START_OF_COMMUNICATION,
+		STATE_MILLER_X,
+		STATE_MILLER_Y,
+		STATE_MILLER_Z,
+		// DROP_NONE,
+		// DROP_FIRST_HALF,
+		} state;
+	uint16_t shiftReg;
+	int16_t	 bitCount;
+	uint16_t len;
+	//uint16_t byteCntMax;
+	uint16_t posCnt;
+	uint16_t syncBit;
+	uint8_t  parityBits;
+	uint8_t  parityLen;
+	uint32_t fourBits;
+	uint32_t startTime, endTime;
+    uint8_t *output;
+	uint8_t *parity;
+} tUart;
+
+// the modulation in the two halves of one bit period,  8 samples
+#define ISO14A_MOD_NONE		0
+#define ISO14A_MOD_SECOND	1
+#define ISO14A_MOD_FIRST	2
+#define ISO14A_MOD_BOTH		3
+
+extern tDemod* GetDemod(void);
+extern void DemodReset(void);
+extern void DemodInit(uint8_t *data, uint8_t *parity);
+extern tUart* GetUart(void);
+extern void UartReset(void);
+extern void UartInit(uint8_t *data, uint8_t *parity);
+
+// bit holds the next 8 samples,  the oldest in bit 7.  non_real_time is the
+// timestamp of the samples,  0 and the firmware reads the SSC clock.
+extern RAMFUNC bool MillerDecoding(uint8_t bit, uint32_t non_real_time);
+extern RAMFUNC int ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_time);
+
+#endif
@@ -18,6 +18,73 @@ struct lfsr {
 	uint32_t c;
 } lfsr;
 
+// Both lfsr are maximal length,  every state but 0 is on one cycle of 127 (a)
+// or 255 (b) steps.  exp[i] is the state i steps after 1,  log[] the inverse,
+// so n steps are one lookup:  exp[(log[x] + n) % period]
+static const uint8_t lfsr_a_exp[127] = {
+	0x01, 0x40, 0x60, 0x70, 0x78, 0x7c, 0x7e, 0x7f, 0x3f, 0x5f, 0x2f, 0x57, 0x2b, 0x55, 0x2a, 0x15,
+	0x4a, 0x65, 0x32, 0x19, 0x4c, 0x66, 0x73, 0x39, 0x5c, 0x6e, 0x77, 0x3b, 0x5d, 0x2e, 0x17, 0x4b,
+	0x25, 0x52, 0x69, 0x34, 0x1a, 0x0d, 0x46, 0x63, 0x31, 0x58, 0x6c, 0x76, 0x7b, 0x3d, 0x5e, 0x6f,
+	0x37, 0x5b, 0x2d, 0x56, 0x6b, 0x35, 0x5a, 0x6d, 0x36, 0x1b, 0x4d, 0x26, 0x13, 0x49, 0x24, 0x12,
+	0x09, 0x44, 0x62, 0x71, 0x38, 0x1c, 0x0e, 0x07, 0x43, 0x21, 0x50, 0x68, 0x74, 0x7a, 0x7d, 0x3e,
+	0x1f, 0x4f, 0x27, 0x53, 0x29, 0x54, 0x6a, 0x75, 0x3a, 0x1d, 0x4e, 0x67, 0x33, 0x59, 0x2c, 0x16,
+	0x0b, 0x45, 0x22, 0x11, 0x48, 0x64, 0x72, 0x79, 0x3c, 0x1e, 0x0f, 0x47, 0x23, 0x51, 0x28, 0x14,
+	0x0a, 0x05, 0x42, 0x61, 0x30, 0x18, 0x0c, 0x06, 0x03, 0x41, 0x20, 0x10, 0x08, 0x04, 0x02
+};
+
+static const uint8_t lfsr_a_log[128] = {
+	0x00, 0x00, 0x7e, 0x78, 0x7d, 0x71, 0x77, 0x47, 0x7c, 0x40, 0x70, 0x60, 0x76, 0x25, 0x46, 0x6a,
+	0x7b, 0x63, 0x3f, 0x3c, 0x6f, 0x0f, 0x5f, 0x1e, 0x75, 0x13, 0x24, 0x39, 0x45, 0x59, 0x69, 0x50,
+	0x7a, 0x49, 0x62, 0x6c, 0x3e, 0x20, 0x3b, 0x52, 0x6e, 0x54, 0x0e, 0x0c, 0x5e, 0x32, 0x1d, 0x0a,
+	0x74, 0x28, 0x12, 0x5c, 0x23, 0x35, 0x38, 0x30, 0x44, 0x17, 0x58, 0x1b, 0x68, 0x2d, 0x4f, 0x08,
+	0x01, 0x79, 0x72, 0x48, 0x41, 0x61, 0x26, 0x6b, 0x64, 0x3d, 0x10, 0x1f, 0x14, 0x3a, 0x5a, 0x51,
+	0x4a, 0x6d, 0x21, 0x53, 0x55, 0x0d, 0x33, 0x0b, 0x29, 0x5d, 0x36, 0x31, 0x18, 0x1c, 0x2e, 0x09,
+	0x02, 0x73, 0x42, 0x27, 0x65, 0x11, 0x15, 0x5b, 0x4b, 0x22, 0x56, 0x34, 0x2a, 0x37, 0x19, 0x2f,
+	0x03, 0x43, 0x66, 0x16, 0x4c, 0x57, 0x2b, 0x1a, 0x04, 0x67, 0x4d, 0x2c, 0x05, 0x4e, 0x06, 0x07
+};
+
+static const uint8_t lfsr_b_exp[255] = {
+	0x01, 0x80, 0xc0, 0xe0, 0xf0, 0xf8, 0x7c, 0x3e, 0x1f, 0x8f, 0x47, 0x23, 0x91, 0x48, 0xa4, 0x52,
+	0x29, 0x14, 0x8a, 0x45, 0x22, 0x11, 0x88, 0x44, 0xa2, 0xd1, 0x68, 0xb4, 0x5a, 0xad, 0x56, 0xab,
+	0xd5, 0xea, 0x75, 0x3a, 0x9d, 0x4e, 0x27, 0x13, 0x89, 0xc4, 0x62, 0x31, 0x98, 0x4c, 0x26, 0x93,
+	0x49, 0x24, 0x92, 0xc9, 0xe4, 0x72, 0x39, 0x1c, 0x0e, 0x07, 0x03, 0x81, 0x40, 0x20, 0x10, 0x08,
+	0x84, 0x42, 0x21, 0x90, 0xc8, 0x64, 0xb2, 0xd9, 0xec, 0xf6, 0x7b, 0x3d, 0x9e, 0xcf, 0x67, 0x33,
+	0x99, 0xcc, 0xe6, 0x73, 0xb9, 0xdc, 0xee, 0xf7, 0xfb, 0xfd, 0x7e, 0x3f, 0x9f, 0x4f, 0xa7, 0xd3,
+	0x69, 0x34, 0x9a, 0x4d, 0xa6, 0x53, 0xa9, 0xd4, 0x6a, 0xb5, 0xda, 0x6d, 0xb6, 0x5b, 0x2d, 0x96,
+	0x4b, 0x25, 0x12, 0x09, 0x04, 0x82, 0xc1, 0x60, 0x30, 0x18, 0x8c, 0xc6, 0x63, 0xb1, 0x58, 0xac,
+	0xd6, 0x6b, 0x35, 0x1a, 0x8d, 0x46, 0xa3, 0x51, 0xa8, 0x54, 0xaa, 0x55, 0x2a, 0x95, 0xca, 0x65,
+	0x32, 0x19, 0x0c, 0x06, 0x83, 0x41, 0xa0, 0xd0, 0xe8, 0x74, 0xba, 0x5d, 0xae, 0xd7, 0xeb, 0xf5,
+	0xfa, 0x7d, 0xbe, 0xdf, 0x6f, 0xb7, 0xdb, 0xed, 0x76, 0xbb, 0xdd, 0x6e, 0x37, 0x1b, 0x0d, 0x86,
+	0x43, 0xa1, 0x50, 0x28, 0x94, 0x4a, 0xa5, 0xd2, 0xe9, 0xf4, 0x7a, 0xbd, 0x5e, 0x2f, 0x97, 0xcb,
+	0xe5, 0xf2, 0xf9, 0xfc, 0xfe, 0xff, 0x7f, 0xbf, 0x5f, 0xaf, 0x57, 0x2b, 0x15, 0x0a, 0x85, 0xc2,
+	0xe1, 0x70, 0x38, 0x9c, 0xce, 0xe7, 0xf3, 0x79, 0x3c, 0x1e, 0x0f, 0x87, 0xc3, 0x61, 0xb0, 0xd8,
+	0x6c, 0x36, 0x9b, 0xcd, 0x66, 0xb3, 0x59, 0x2c, 0x16, 0x8b, 0xc5, 0xe2, 0xf1, 0x78, 0xbc, 0xde,
+	0xef, 0x77, 0x3b, 0x1d, 0x8e, 0xc7, 0xe3, 0x71, 0xb8, 0x5c, 0x2e, 0x17, 0x0b, 0x05, 0x02
+};
+
+static const uint8_t lfsr_b_log[256] = {
+	0x00, 0x00, 0xfe, 0x3a, 0x74, 0xfd, 0x93, 0x39, 0x3f, 0x73, 0xcd, 0xfc, 0x92, 0xae, 0x38, 0xda,
+	0x3e, 0x15, 0x72, 0x27, 0x11, 0xcc, 0xe8, 0xfb, 0x79, 0x91, 0x83, 0xad, 0x37, 0xf3, 0xd9, 0x08,
+	0x3d, 0x42, 0x14, 0x0b, 0x31, 0x71, 0x2e, 0x26, 0xb3, 0x10, 0x8c, 0xcb, 0xe7, 0x6e, 0xfa, 0xbd,
+	0x78, 0x2b, 0x90, 0x4f, 0x61, 0x82, 0xe1, 0xac, 0xd2, 0x36, 0x23, 0xf2, 0xd8, 0x4b, 0x07, 0x5b,
+	0x3c, 0x95, 0x41, 0xb0, 0x17, 0x13, 0x85, 0x0a, 0x0d, 0x30, 0xb5, 0x70, 0x2d, 0x63, 0x25, 0x5d,
+	0xb2, 0x87, 0x0f, 0x65, 0x89, 0x8b, 0x1e, 0xca, 0x7e, 0xe6, 0x1c, 0x6d, 0xf9, 0x9b, 0xbc, 0xc8,
+	0x77, 0xdd, 0x2a, 0x7c, 0x45, 0x8f, 0xe4, 0x4e, 0x1a, 0x60, 0x68, 0x81, 0xe0, 0x6b, 0xab, 0xa4,
+	0xd1, 0xf7, 0x35, 0x53, 0x99, 0x22, 0xa8, 0xf1, 0xed, 0xd7, 0xba, 0x4a, 0x06, 0xa1, 0x5a, 0xc6,
+	0x01, 0x3b, 0x75, 0x94, 0x40, 0xce, 0xaf, 0xdb, 0x16, 0x28, 0x12, 0xe9, 0x7a, 0x84, 0xf4, 0x09,
+	0x43, 0x0c, 0x32, 0x2f, 0xb4, 0x8d, 0x6f, 0xbe, 0x2c, 0x50, 0x62, 0xe2, 0xd3, 0x24, 0x4c, 0x5c,
+	0x96, 0xb1, 0x18, 0x86, 0x0e, 0xb6, 0x64, 0x5e, 0x88, 0x66, 0x8a, 0x1f, 0x7f, 0x1d, 0x9c, 0xc9,
+	0xde, 0x7d, 0x46, 0xe5, 0x1b, 0x69, 0x6c, 0xa5, 0xf8, 0x54, 0x9a, 0xa9, 0xee, 0xbb, 0xa2, 0xc7,
+	0x02, 0x76, 0xcf, 0xdc, 0x29, 0xea, 0x7b, 0xf5, 0x44, 0x33, 0x8e, 0xbf, 0x51, 0xe3, 0xd4, 0x4d,
+	0x97, 0x19, 0xb7, 0x5f, 0x67, 0x20, 0x80, 0x9d, 0xdf, 0x47, 0x6a, 0xa6, 0x55, 0xaa, 0xef, 0xa3,
+	0x03, 0xd0, 0xeb, 0xf6, 0x34, 0xc0, 0x52, 0xd5, 0x98, 0xb8, 0x21, 0x9e, 0x48, 0xa7, 0x56, 0xf0,
+	0x04, 0xec, 0xc1, 0xd6, 0xb9, 0x9f, 0x49, 0x57, 0x05, 0xc2, 0xa0, 0x58, 0xc3, 0x59, 0xc4, 0xc5
+};
+
+#define LFSR_A_STEP(a)	(((a) >> 1 | ((a) ^ (a) >> 6) << 6) & 0x7F)
+#define LFSR_B_STEP(b)	((uint8_t)((b) >> 1 | ((b) ^ (b) >> 2 ^ (b) >> 3 ^ (b) >> 7) << 7))
+#define LFSR_BIT(a, b)	((b) >> (7 - (((a) & 4) | ((a) >> 2 & 2) | ((a) >> 4 & 1))) & 1)
+
 // Normal init is set following variables with a random value IV
 // a == iv
 // b == iv << 1 | 1
@@ -35,15 +102,42 @@ void legic_prng_init(uint8_t iv) {
 		lfsr.b = (iv << 1) | 1;
 }
 
-void legic_prng_forward(int count) {
+static void lfsr_jump(uint8_t *a, uint8_t *b, uint32_t count) {
 	if (count == 0) return;
+
+	// a 8 bit iv leaves bit 7 in a until the first step
+	if (*a & 0x80) {
+		*a = LFSR_A_STEP(*a);
+		*b = LFSR_B_STEP(*b);
+		count--;
+	}
+
+	// a and b are 0 or on their cycle
+	if (*a) {
+		uint32_t i = lfsr_a_log[*a] + count % 127;
+		*a = lfsr_a_exp[i < 127 ? i : i - 127];
+	}
+	if (*b) {
+		uint32_t i = lfsr_b_log[*b] + count % 255;
+		*b = lfsr_b_exp[i < 255 ? i : i - 255];
+	}
+}
+
+void legic_prng_forward(int count) {
+	if (count <= 0) return;
 	
 	lfsr.c += count;
-	while(count--) {
-		// According: http://www.proxmark.org/forum/viewtopic.php?pid=5437#p5437
-		lfsr.a = (lfsr.a >> 1 | (lfsr.a ^ lfsr.a >> 6) << 6) & 0x7F;
-		lfsr.b = lfsr.b >> 1 | (lfsr.b ^ lfsr.b >> 2 ^ lfsr.b >> 3 ^ lfsr.b >> 7) << 7;
+
+	// According: http://www.proxmark.org/forum/viewtopic.php?pid=5437#p5437
+	// a few steps are cheaper stepped than looked up
+	if (count < 4 && !(lfsr.a & 0x80)) {
+		while (count--) {
+			lfsr.a = LFSR_A_STEP(lfsr.a);
+			lfsr.b = LFSR_B_STEP(lfsr.b);
+		}
+		return;
 	}
+	lfsr_jump(&lfsr.a, &lfsr.b, count);
 }
 
 uint32_t legic_prng_count() {
@@ -51,15 +145,34 @@ uint32_t legic_prng_count() {
 }
 
 uint8_t legic_prng_get_bit() {
-	uint8_t idx = 7 - ( (lfsr.a & 4) | (lfsr.a >> 2 & 2) | (lfsr.a >> 4 & 1) );
-	return lfsr.b >> idx & 1;
+	return LFSR_BIT(lfsr.a, lfsr.b);
 }
 
 uint32_t legic_prng_get_bits(uint8_t len){
-	uint32_t a = 0;
+	uint8_t a = lfsr.a, b = lfsr.b;
+	uint32_t bits = 0;
 	for(uint8_t i = 0; i < len; ++i) {
-		a |= legic_prng_get_bit() << i;
-		legic_prng_forward(1);
+		bits |= (uint32_t)LFSR_BIT(a, b) << i;
+		a = LFSR_A_STEP(a);
+		b = LFSR_B_STEP(b);
 	}
-	return a;
-}
\ No newline at end of file
+	lfsr.a = a;
+	lfsr.b = b;
+	lfsr.c += len;
+	return bits;
+}
+
+void legic_prng_keystream(uint8_t iv, uint32_t offset, uint8_t *out, uint32_t len) {
+	uint8_t a = iv, b = iv ? (iv << 1) | 1 : 0;
+	lfsr_jump(&a, &b, offset);
+
+	for (uint32_t i = 0; i < len; i++) {
+		uint8_t bits = 0;
+		for (uint8_t j = 0; j < 8; j++) {
+			bits |= LFSR_BIT(a, b) << j;
+			a = LFSR_A_STEP(a);
+			b = LFSR_B_STEP(b);
+		}
+		out[i] = bits;
+	}
+}
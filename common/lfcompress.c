@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample compression,  see lfcompress.h
+//-----------------------------------------------------------------------------
+
+#include "lfcompress.h"
+
+void lfcompress_init(lfcompress_t *c, uint8_t *buf, uint32_t size) {
+	c->buf = buf;
+	c->size = size;
+	c->len = 0;
+	c->samples = 0;
+	c->prev = 0;
+	c->run = 0;
+	c->pending = false;
+	c->held = 0;
+}
+
+static void lfcompress_single(lfcompress_t *c, uint8_t sample) {
+	int8_t d = (int8_t)(sample - c->prev);
+	if (d >= -LFC_DELTA_MAX && d <= LFC_DELTA_MAX) {
+		c->buf[c->len++] = LFC_DELTA | (d & 0x7F);
+	} else {
+		c->buf[c->len++] = LFC_LITERAL;
+		c->buf[c->len++] = sample;
+	}
+	c->prev = sample;
+}
+
+static void lfcompress_flush(lfcompress_t *c) {
+	if (c->run) {
+		c->buf[c->len++] = LFC_RUN | c->run;
+		c->run = 0;
+	}
+	if (c->pending) {
+		lfcompress_single(c, c->held);
+		c->pending = false;
+	}
+}
+
+bool lfcompress_push(lfcompress_t *c, uint8_t sample) {
+	// keep room for this one and lfcompress_finish
+	if (c->len + LFC_PUSH_ROOM + 2 > c->size || c->samples >= LFC_MAX_SAMPLES)
+		return false;
+
+	c->samples++;
+
+	if (c->run) {
+		if (sample == c->prev) {
+			if (++c->run == LFC_RUN_MAX) {
+				c->buf[c->len++] = LFC_RUN | LFC_RUN_MAX;
+				c->run = 0;
+			}
+			return true;
+		}
+		c->buf[c->len++] = LFC_RUN | c->run;
+		c->run = 0;
+	}
+
+	if (c->pending) {
+		int8_t d = (int8_t)(sample - c->held);
+		c->pending = false;
+		if (d >= LFC_PAIR_MIN && d <= LFC_PAIR_MAX) {
+			int8_t h = (int8_t)(c->held - c->prev);
+			c->buf[c->len++] = LFC_PAIR | ((h - LFC_PAIR_MIN) << 3) | (d - LFC_PAIR_MIN);
+			c->prev = sample;
+			return true;
+		}
+		lfcompress_single(c, c->held);
+	}
+
+	int8_t d = (int8_t)(sample - c->prev);
+	if (d == 0) {
+		c->run = 1;
+	} else if (d >= LFC_PAIR_MIN && d <= LFC_PAIR_MAX) {
+		c->held = sample;
+		c->pending = true;
+	} else {
+		lfcompress_single(c, sample);
+	}
+	return true;
+}
+
+uint32_t lfcompress_finish(lfcompress_t *c) {
+	lfcompress_flush(c);
+	if (c->len < c->size)
+		c->buf[c->len++] = LFC_END;
+	return c->len;
+}
+
+size_t lfcompress_decode(const uint8_t *in, size_t len, uint8_t *out, size_t max) {
+	uint8_t prev = 0;
+	size_t n = 0;
+
+	for (size_t i = 0; i < len && n < max; i++) {
+		uint8_t t = in[i];
+		switch (t & 0xC0) {
+			case LFC_RUN: {
+				if (t == LFC_END)
+					return n;
+				for (uint8_t r = t & 0x3F; r && n < max; r--)
+					out[n++] = prev;
+				break;
+			}
+			case LFC_PAIR:
+				prev += ((t >> 3) & 7) + LFC_PAIR_MIN;
+				out[n++] = prev;
+				if (n == max)
+					return n;
+				prev += (t & 7) + LFC_PAIR_MIN;
+				out[n++] = prev;
+				break;
+			default:
+				if (t == LFC_LITERAL) {
+					if (++i == len)
+						return n;
+					prev = in[i];
+				} else {
+					prev += (int8_t)(t << 1) >> 1;
+				}
+				out[n++] = prev;
+				break;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample compression,  delta and run length coded while DoAcquisition
+// samples.  Runs in the firmware and in the client,  getSamples decodes it.
+//-----------------------------------------------------------------------------
+
+#ifndef LFCOMPRESS_H__
+#define LFCOMPRESS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// A sample is coded against the one before it,  the first one against 0.
+// One byte tokens,  the stream ends with LFC_END or the buffer:
+//   00000000   end
+//   00nnnnnn   the sample before n times more,  n 1..63
+//   01aaabbb   two samples,  deltas a - 4 and b - 4,  -4..3 each
+//   1ddddddd   one sample,  delta d -63..63,  7 bits two's complement
+//   11000000   (delta -64) one sample,  the literal value is in the next byte
+// Samples are the bits_per_sample wide values,  a delta is in quantization steps.
+#define LFC_END				0x00
+#define LFC_RUN				0x00
+#define LFC_PAIR			0x40
+#define LFC_DELTA			0x80
+#define LFC_LITERAL			0xC0
+#define LFC_RUN_MAX			63
+#define LFC_PAIR_MIN		-4
+#define LFC_PAIR_MAX		3
+#define LFC_DELTA_MAX		63
+
+// a push writes at most this many bytes,  lfcompress_finish two
+#define LFC_PUSH_ROOM		3
+// the client graph buffer,  MAX_GRAPH_TRACE_LEN
+#define LFC_MAX_SAMPLES		(40000 * 8)
+
+typedef struct {
+	uint8_t *buf;
+	uint32_t size;			// of buf
+	uint32_t len;			// bytes coded
+	uint32_t samples;		// samples taken,  a pending one included
+	uint8_t prev;			// last sample coded
+	uint8_t run;			// samples equal to prev not coded yet
+	bool pending;			// held,  it may pair with the next one
+	uint8_t held;
+} lfcompress_t;
+
+extern void lfcompress_init(lfcompress_t *c, uint8_t *buf, uint32_t size);
+// false when the buffer is full,  the sample was not taken
+extern bool lfcompress_push(lfcompress_t *c, uint8_t sample);
+// codes what is held and the end token,  returns the stream length
+extern uint32_t lfcompress_finish(lfcompress_t *c);
+
+// Decodes at most max samples of the stream into out.  Returns the samples.
+extern size_t lfcompress_decode(const uint8_t *in, size_t len, uint8_t *out, size_t max);
+
+#endif
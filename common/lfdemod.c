@@ -1814,6 +1814,522 @@ int pskRawDemod(uint8_t *dest, size_t *size, int *clock, int *invert) {
 }
 
 
+//**********************************************************************************************
+//-----------------Streaming Demod Section------------------------------------------------------
+//**********************************************************************************************
+// The demods above need the whole capture in memory and make several passes over it.
+// The streaming demod below consumes samples chunk by chunk (as they arrive from the device)
+// with O(1) state per modulation and emits bits as soon as they are decodable.
+// Every decision is taken per sample,  so the output does not depend on how the samples are chunked.
+// Each modulation takes the same per sample decisions as its whole capture demod
+// (cleanAskRawDemod + manrawdecode / askdemod_ext,  nrzRawDemod,  fskdemod,  pskRawDemod_ext).
+// What those find with a pass over the capture (clock,  thresholds,  start,  phase,  manchester
+// alignment) lfstream_train finds on the first chunk.  Trained on the whole capture,  the
+// bits are the same as the whole capture demod gives.
+
+typedef struct {
+	uint8_t *bits;
+	size_t max;
+	size_t cnt;
+} lfs_out_t;
+
+static void lfs_frame_bit(lfstream_t *s, uint8_t bit) {
+
+	if (s->framePos) {
+		if (bit == 7) {
+			s->framePos = 0;
+			s->shiftLen = 0;
+			return;
+		}
+		s->frame[s->framePos++] = bit;
+		if (s->framePos == s->frameLen) {
+			s->frames++;
+			if (s->onFrame)
+				s->onFrame(s->frame, s->frameLen, s->ctx);
+			s->framePos = 0;
+			s->shiftLen = 0;
+		}
+		return;
+	}
+
+	if (bit == 7) {
+		s->shiftLen = 0;
+		return;
+	}
+
+	s->shift = (s->shift << 1) | bit;
+	if (s->shiftLen < 32) s->shiftLen++;
+	if (s->shiftLen < s->preambleLen) return;
+
+	uint32_t mask = (s->preambleLen == 32) ? 0xFFFFFFFF : ((1UL << s->preambleLen) - 1);
+	if ((s->shift & mask) != s->preamble) return;
+
+	for (uint8_t i = 0; i < s->preambleLen; i++)
+		s->frame[i] = (s->preamble >> (s->preambleLen - 1 - i)) & 1;
+	s->framePos = s->preambleLen;
+}
+
+static void lfs_out(lfstream_t *s, uint8_t bit, lfs_out_t *o) {
+	s->bits++;
+	s->lastBit = bit;
+	if (bit == 7) s->errors++;
+
+	if (o->bits) {
+		if (o->cnt < o->max)
+			o->bits[o->cnt++] = bit;
+		else
+			s->overflow++;
+	}
+
+	if (s->frameLen)
+		lfs_frame_bit(s, bit);
+}
+
+static void lfs_out_n(lfstream_t *s, uint8_t bit, uint32_t n, lfs_out_t *o) {
+	while (n--)
+		lfs_out(s, bit, o);
+}
+
+// ask half bits,  paired up for manchester like manrawdecode.  It decodes the pairs
+// starting before the last three half bits,  so a pair goes out three half bits late.
+static void lfs_half(lfstream_t *s, uint8_t h, lfs_out_t *o) {
+	if (s->mod == LFS_ASK_RAW) {
+		lfs_out(s, h, o);
+		return;
+	}
+
+	if (s->halfCnt >= 3 && ((s->halfCnt - 3) & 1) == s->align) {
+		uint8_t a = s->halves[0], b = s->halves[1];
+		if (a == 1 && b == 0)
+			lfs_out(s, 0, o);
+		else if (a == 0 && b == 1)
+			lfs_out(s, 1, o);
+		else
+			lfs_out(s, 7, o);
+	}
+	s->halves[0] = s->halves[1];
+	s->halves[1] = s->halves[2];
+	s->halves[2] = h;
+	s->halfCnt++;
+}
+
+// ask,  strong clipped waves,  like cleanAskRawDemod
+static void lfs_ask_clean_sample(lfstream_t *s, uint8_t smp, uint32_t k, lfs_out_t *o) {
+	int clk = s->clk;
+	bool high = (smp >= s->high), low = (smp <= s->low);
+
+	if (k == 0) {
+		s->level = high;
+		s->run = 1;
+		return;
+	}
+
+	if ((high && s->level) || (low && !s->level)) {
+		s->run++;
+	} else if (high || low) { //transition
+		uint8_t h = (s->level) ? s->invert : s->invert ^ 1;
+		if (s->run > (uint32_t)(clk - (clk/4) - 1)) {           //full clock
+			if (s->run > (uint32_t)(clk + (clk/4) + 1)) {       //too many samples
+				lfs_half(s, 7, o);
+			} else {
+				lfs_half(s, h, o);
+				lfs_half(s, h, o);
+			}
+			s->level ^= 1;
+			s->run = 0;
+		} else if (s->run > (uint32_t)((clk/2) - (clk/4) - 1)) { //half clock
+			lfs_half(s, h, o);
+			s->level ^= 1;
+			s->run = 0;
+		} else {
+			//transition bit oops
+			s->run++;
+		}
+	} else { //haven't hit new high or new low yet
+		s->run++;
+	}
+}
+
+// ask,  weak waves,  like askdemod_ext.  Samples the peak once per clock (and once per
+// half clock for ask/raw),  starting from the clock start DetectASKClock found.
+static void lfs_ask_weak_sample(lfstream_t *s, uint8_t smp, uint32_t k, lfs_out_t *o) {
+	int clk = s->clk;
+	int tol = (clk <= 32) ? 1 : 0;
+
+	if (k < s->start) return;
+
+	// unsigned like the size_t - int of askdemod_ext,  a clock bit ahead of k is far away
+	uint32_t d = (uint32_t)((int32_t)k - s->last);
+	if (d >= (uint32_t)(clk - tol)) {
+		if (smp >= s->high) {
+			lfs_out(s, s->invert, o);
+		} else if (smp <= s->low) {
+			lfs_out(s, s->invert ^ 1, o);
+		} else if (d >= (uint32_t)(clk + tol)) {
+			if (s->bits > 0)
+				lfs_out(s, 7, o);
+		} else { //in tolerance - looking for peak
+			return;
+		}
+		s->midBit = false;
+		s->last += clk;
+	} else if (d >= (uint32_t)(clk/2 - tol) && !s->midBit && s->mod == LFS_ASK_RAW) {
+		if (smp >= s->high) {
+			lfs_out(s, s->invert, o);
+		} else if (smp <= s->low) {
+			lfs_out(s, s->invert ^ 1, o);
+		} else if (d >= (uint32_t)(clk/2 + tol)) {
+			lfs_out(s, s->lastBit, o);
+		} else { //in tolerance - looking for peak
+			return;
+		}
+		s->midBit = true;
+	}
+}
+
+// nrz,  like nrzRawDemod,  thresholded wave from sample 20 on
+static void lfs_nrz_sample(lfstream_t *s, uint8_t smp, uint32_t k, lfs_out_t *o) {
+	int clk = s->clk;
+
+	if (k < 20) return;
+
+	uint8_t bit = s->level;
+	if (smp >= s->high) bit = 1;
+	if (smp <= s->low) bit = 0;
+
+	//if transition detected or large number of same bits - store the passed bits
+	if (k > 20 && (bit != s->level || (k - s->last) == (uint32_t)(10 * clk))) {
+		lfs_out_n(s, s->level ^ s->invert, (k - s->last + (clk/4)) / clk, o);
+		s->last = k - 1;
+	}
+	s->level = bit;
+}
+
+// fsk,  the waves runs of the same class to bits like aggregate_bits
+static void lfs_fsk_wave(lfstream_t *s, uint8_t w, lfs_out_t *o) {
+	uint8_t clk = s->clk;
+
+	if (!s->runValid) {
+		s->runValid = true;
+		s->runVal = w;
+		s->run = 1;
+		return;
+	}
+
+	s->run++;
+	if (w == s->runVal) return;
+
+	uint32_t n = (s->run * ((s->runVal) ? s->fclow : s->fchigh) + clk/2) / clk;
+	if (n == 0) n = 1;
+	lfs_out_n(s, s->runVal ^ s->invert, n, o);
+	s->run = 0;
+	s->runVal = w;
+}
+
+// fsk_wave_demod may still drop the first three waves or fix the last one
+static void lfs_fsk_wave_add(lfstream_t *s, uint8_t w, lfs_out_t *o) {
+	s->waves[s->wavePending++] = w;
+	s->waveCnt++;
+	if (s->waveCnt < 3) return;
+	// keep the last one
+	for (uint8_t i = 0; i + 1 < s->wavePending; i++)
+		lfs_fsk_wave(s, s->waves[i], o);
+	s->waves[0] = s->waves[s->wavePending - 1];
+	s->wavePending = 1;
+}
+
+// fsk,  like fsk_wave_demod,  a 1 for each short wave (fclow),  a 0 for each long wave (fchigh)
+static void lfs_fsk_sample(lfstream_t *s, uint8_t smp, uint32_t k, lfs_out_t *o) {
+	uint8_t fchigh = s->fchigh, fclow = s->fclow;
+
+	if (k < s->start) return;
+
+	// the first compare is against the raw sample,  as fsk_wave_demod does
+	if (k == s->start) {
+		s->level = smp;
+		s->last = k;
+		return;
+	}
+
+	uint8_t lvl = (smp >= FSK_PSK_THRESHOLD);
+	if (s->level < lvl) {
+		uint32_t pre = s->waveLens[0];
+		s->waveLens[0] = s->waveLens[1];
+		s->waveLens[1] = k - s->last;
+		uint32_t last = s->waveLens[0], cur = s->waveLens[1];
+		if (cur < (uint32_t)(fclow - 2)) {
+			//do nothing with extra garbage
+		} else if (cur < (uint32_t)(fchigh - 1)) {
+			//correct previous 9 wave surrounded by 8 waves (or 6 surrounded by 5)
+			if (s->waveCnt > 1 && last > (uint32_t)(fchigh - 2) && pre < (uint32_t)(fchigh - 1))
+				s->waves[s->wavePending - 1] = 1;
+			lfs_fsk_wave_add(s, 1, o);
+		} else if (cur > (uint32_t)(fchigh + 1) && s->waveCnt < 3) {
+			//beginning garbage,  reset
+			s->waveCnt = 0;
+			s->wavePending = 0;
+		} else if (cur == (uint32_t)(fclow + 1) && last == (uint32_t)(fclow - 1)) {
+			// had a 7 then a 9 should be two 8's (or 4 then a 6 should be two 5's)
+			lfs_fsk_wave_add(s, 1, o);
+		} else {
+			lfs_fsk_wave_add(s, 0, o);
+		}
+		s->last = k;
+	}
+	s->level = lvl;
+}
+
+// psk1,  like pskRawDemod_ext.  The top edge of a wave at i needs the samples up to i+2.
+static void lfs_psk_sample(lfstream_t *s, uint8_t smp, uint32_t k, lfs_out_t *o) {
+	uint8_t fc = s->fclow;
+	uint16_t tol = fc/2;
+
+	if (!s->synced) {
+		// the bits before the first phase shift,  then the first read bit
+		s->synced = true;
+		lfs_out_n(s, s->prePhase, s->last / s->clk, o);
+		lfs_out(s, s->phase, o);
+	}
+
+	uint32_t i = k - 2;
+	if (k >= 2 && i >= s->start && s->prev[0] + fc < s->prev[1] && s->prev[1] >= smp) {
+		uint32_t p = i + 1;
+		if (s->waveStart == 0) {
+			s->waveStart = p;
+		} else {
+			uint16_t waveLen = p - s->waveStart;
+			bool keep = false;
+			if (waveLen > fc) {
+				//this wave is a phase shift
+				if (p >= s->last + s->clk - tol) { //should be a clock bit
+					s->phase ^= 1;
+					lfs_out(s, s->phase, o);
+					s->last += s->clk;
+				} else if (i < s->last + 10 + fc) {
+					//noise after a phase shift - ignore
+				} else { //phase shift before supposed to based on clock
+					lfs_out(s, 7, o);
+				}
+			} else if (p > s->last + s->clk + tol + fc) {
+				//no phase shift but clock bit
+				s->last += s->clk;
+				lfs_out(s, s->phase, o);
+			} else if (waveLen < fc - 1) {
+				//wave is smaller than field clock,  keep wave start
+				keep = true;
+			}
+			if (!keep)
+				s->waveStart = p;
+		}
+	}
+	s->prev[0] = s->prev[1];
+	s->prev[1] = smp;
+}
+
+static void lfs_sample(lfstream_t *s, uint8_t smp, uint32_t k, lfs_out_t *o) {
+	switch (s->mod) {
+		case LFS_ASK_RAW:
+		case LFS_ASK_MAN:
+			if (s->clean)
+				lfs_ask_clean_sample(s, smp, k, o);
+			else
+				lfs_ask_weak_sample(s, smp, k, o);
+			break;
+		case LFS_NRZ:
+			lfs_nrz_sample(s, smp, k, o);
+			break;
+		case LFS_FSK:
+			lfs_fsk_sample(s, smp, k, o);
+			break;
+		case LFS_PSK1:
+			lfs_psk_sample(s, smp, k, o);
+			break;
+	}
+}
+
+// mod = LFS_*,  clk = 0 and fc = 0 are learned by lfstream_train
+void lfstream_init(lfstream_t *s, uint8_t mod, int clk, int invert, uint8_t fchigh, uint8_t fclow) {
+	memset(s, 0, sizeof(lfstream_t));
+	s->mod = mod;
+	s->clk = clk;
+	s->invert = (invert == 1);
+	s->fchigh = fchigh;
+	s->fclow = fclow;
+	// thresholds around the 128 mid level until trained
+	s->high = 148;
+	s->low = 108;
+	s->clean = true;
+	// samples the whole capture demods leave at the end,  they are held back until
+	// the next ones come in
+	switch (mod) {
+		case LFS_NRZ:
+		case LFS_FSK:
+			s->lag = 20;
+			break;
+		case LFS_PSK1:
+			s->lag = 1;
+			break;
+	}
+}
+
+// manchester alignment of manrawdecode,  the one of the two with fewer 00 / 11 pairs
+static void lfs_train_align(lfstream_t *s, uint8_t *samples, size_t size) {
+	uint8_t half[512];
+	uint32_t err[2] = {0, 0}, n = 0;
+	uint8_t last[3] = {0, 0, 0};
+	lfstream_t t = *s;
+	t.mod = LFS_ASK_RAW;
+	t.frameLen = 0;
+
+	for (size_t i = 0; i < size; i += 256) {
+		size_t cnt = lfstream_push(&t, samples + i, (size - i < 256) ? size - i : 256, half, sizeof(half));
+		for (size_t j = 0; j < cnt; j++, n++) {
+			if (n && last[2] == half[j])
+				err[(n - 1) & 1]++;
+			last[0] = last[1];
+			last[1] = last[2];
+			last[2] = half[j];
+		}
+	}
+	// manrawdecode counts the pairs starting before the last three
+	if (n >= 3 && last[0] == last[1]) err[(n - 3) & 1]--;
+	if (n >= 2 && last[1] == last[2]) err[(n - 2) & 1]--;
+	s->align = (err[1] < err[0]) ? 1 : 0;
+}
+
+// learn clock,  field clocks,  thresholds and where the demod starts from a first chunk
+// of samples,  the same way the whole capture demods do.
+// samples are not consumed,  push them afterwards.
+bool lfstream_train(lfstream_t *s, uint8_t *samples, size_t size) {
+	if (justNoise(samples, size)) return false;
+
+	switch (s->mod) {
+		case LFS_ASK_RAW:
+		case LFS_ASK_MAN: {
+			int clk = s->clk;
+			int start = DetectASKClock(samples, size, &clk, 100);
+			if (clk == 0 || start < 0) return false;
+			s->clk = clk;
+			s->start = start;
+			s->last = start - clk;
+			if (getHiLo(samples, (size < 1024) ? size : 1024, &s->high, &s->low, 75, 75) < 1) return false;
+			s->clean = DetectCleanAskWave(samples, size, s->high, s->low);
+			if (s->mod == LFS_ASK_MAN && s->clean)
+				lfs_train_align(s, samples, size);
+			break;
+		}
+		case LFS_NRZ: {
+			size_t start = 0;
+			s->clk = DetectNRZClock(samples, size, s->clk, &start);
+			if (s->clk == 0) return false;
+			size_t gLen = (size < 4096) ? size - 20 : 4096;
+			if (getHiLo(samples, gLen, &s->high, &s->low, 75, 75) < 1) return false;
+			break;
+		}
+		case LFS_FSK: {
+			// field clocks and clock like fsk rawdemod
+			if (size < 1024) return false;
+			if (s->fchigh == 0 || s->fclow == 0) {
+				uint16_t fcs = countFC(samples, size, 1);
+				s->fchigh = (fcs) ? fcs >> 8 : 10;
+				s->fclow = (fcs) ? fcs & 0xFF : 8;
+			}
+			if (s->clk == 0) {
+				int firstClockEdge = 0;
+				s->clk = detectFSKClk(samples, size, s->fchigh, s->fclow, &firstClockEdge);
+				if (s->clk == 0) s->clk = 50;
+			}
+			s->start = findModStart(samples, size, s->fchigh);
+			break;
+		}
+		case LFS_PSK1: {
+			if (size < 170) return false;
+			size_t first = 0;
+			uint8_t phase = s->invert, fc = 0;
+			uint16_t waveLen = 0;
+			int clk = DetectPSKClock(samples, size, s->clk, &first, &phase, &fc);
+			if (clk <= 0) return false;
+			s->clk = clk;
+			// a given clock skips the phase shift and field clock detection
+			s->prePhase = phase ^ 1;
+			if (first == 0) {
+				first = pskFindFirstPhaseShift(samples, size, &phase, findModStart(samples, size, fc), fc, &waveLen);
+				s->prePhase = phase ^ 1;
+				if (first == 0) {
+					first = 160;
+					s->prePhase = phase;
+				}
+			}
+			s->fclow = fc;
+			s->phase = phase;
+			s->last = first;
+			s->start = first + waveLen - 1;
+			break;
+		}
+		default:
+			return false;
+	}
+	return true;
+}
+
+// emit a frame callback each time preamble is seen followed by frameLen - pLen bits.
+bool lfstream_set_frame(lfstream_t *s, const uint8_t *preamble, uint8_t pLen, uint16_t frameLen, lfstream_frame_cb cb, void *ctx) {
+	if (pLen == 0 || pLen > 32 || frameLen <= pLen || frameLen > LFS_MAX_FRAME) return false;
+
+	s->preamble = 0;
+	for (uint8_t i = 0; i < pLen; i++)
+		s->preamble = (s->preamble << 1) | (preamble[i] & 1);
+	s->preambleLen = pLen;
+	s->frameLen = frameLen;
+	s->framePos = 0;
+	s->shiftLen = 0;
+	s->onFrame = cb;
+	s->ctx = ctx;
+	return true;
+}
+
+// push a chunk of samples,  returns number of bits written to bits (may be NULL when only frames are wanted).
+// bits not fitting in maxBits are counted in s->overflow.
+size_t lfstream_push(lfstream_t *s, const uint8_t *samples, size_t len, uint8_t *bits, size_t maxBits) {
+	lfs_out_t o = { bits, maxBits, 0 };
+
+	if (s->clk == 0 || s->mod > LFS_PSK1) return 0;
+
+	for (size_t i = 0; i < len; i++, s->idx++) {
+		if (s->lag == 0) {
+			lfs_sample(s, samples[i], s->idx, &o);
+			continue;
+		}
+		// the sample lag ago goes in,  the new one takes its place
+		if (s->idx >= s->lag)
+			lfs_sample(s, s->delay[s->delayPos], s->idx - s->lag, &o);
+		s->delay[s->delayPos] = samples[i];
+		if (++s->delayPos == s->lag) s->delayPos = 0;
+	}
+	return o.cnt;
+}
+
+// end of the samples,  emits what the whole capture demod gives at the end.  That is
+// the last run of fsk waves and the waves fsk_wave_demod held.  The samples still held
+// back are the ones the whole capture demods leave out too.
+size_t lfstream_finish(lfstream_t *s, uint8_t *bits, size_t maxBits) {
+	lfs_out_t o = { bits, maxBits, 0 };
+
+	if (s->mod != LFS_FSK || s->clk == 0) return 0;
+
+	for (uint8_t i = 0; i < s->wavePending; i++)
+		lfs_fsk_wave(s, s->waves[i], &o);
+	s->wavePending = 0;
+
+	// if valid extra bits at the end were all the same frequency - add them in
+	if (s->runValid && s->run > (uint32_t)(s->clk / s->fchigh)) {
+		uint8_t clk = s->clk;
+		lfs_out_n(s, s->runVal ^ s->invert, (s->run * ((s->runVal) ? s->fclow : s->fchigh) + clk/2) / clk, &o);
+	}
+	s->runValid = false;
+	return o.cnt;
+}
+
 //**********************************************************************************************
 //-----------------Tag format detection section-------------------------------------------------
 //**********************************************************************************************
@@ -72,6 +72,84 @@ extern void     psk2TOpsk1(uint8_t *bits, size_t size);
 extern void     psk1TOpsk2(uint8_t *bits, size_t size);
 extern size_t   removeParity(uint8_t *bits, size_t startIdx, uint8_t pLen, uint8_t pType, size_t bLen);
 
+//streaming demod
+// incremental demodulator, samples are pushed chunk by chunk and bits are emitted
+// as soon as they are decodable.  State is O(1) except the optional frame window.
+// Trained on the whole capture the bits are the ones of askdemod_ext,  nrzRawDemod,
+// fskdemod and pskRawDemod_ext.
+#define LFS_ASK_RAW   0
+#define LFS_ASK_MAN   1
+#define LFS_NRZ       2
+#define LFS_FSK       3
+#define LFS_PSK1      4
+
+#define LFS_MAX_FRAME 256
+#define LFS_MAX_LAG   20
+
+typedef void (*lfstream_frame_cb)(const uint8_t *frame, size_t len, void *ctx);
+
+typedef struct {
+	// config,  FSK uses fchigh/fclow as field clocks,  PSK uses fclow as carrier
+	uint8_t  mod;
+	uint8_t  invert;
+	uint16_t clk;
+	uint8_t  fchigh;
+	uint8_t  fclow;
+	int      high;
+	int      low;
+	// learned by lfstream_train
+	bool     clean;      // ask,  clipped waves,  cleanAskRawDemod instead of peak sampling
+	uint8_t  align;      // ask/manchester,  half bit the pairs start on
+	uint32_t start;      // ask: first clock peak,  fsk: modulation start,  psk: first wave looked at
+	uint8_t  prePhase;   // psk,  bits before the first phase shift
+	// sample state
+	uint32_t idx;        // absolute sample index
+	uint8_t  lag;        // samples held back,  the whole capture demods look this far ahead
+	uint8_t  delayPos;
+	uint8_t  delay[LFS_MAX_LAG];
+	uint8_t  level;      // last thresholded level
+	int32_t  last;       // ask / psk: last clock bit,  nrz / fsk: last transition
+	uint32_t run;        // ask: samples since the transition,  fsk: waves in the run
+	bool     synced;     // psk,  bits before the first phase shift are out
+	bool     midBit;
+	uint8_t  lastBit;    // last bit out
+	// manchester pairing
+	uint8_t  halves[3];
+	uint32_t halfCnt;
+	// fsk waves
+	uint32_t waveLens[2];
+	uint8_t  waves[3];   // not yet aggregated,  fsk_wave_demod may still change them
+	uint8_t  wavePending;
+	uint32_t waveCnt;
+	uint8_t  runVal;
+	bool     runValid;
+	// psk
+	uint8_t  prev[2];
+	uint32_t waveStart;
+	uint8_t  phase;
+	// frame detection
+	uint32_t preamble;
+	uint8_t  preambleLen;
+	uint32_t shift;
+	uint8_t  shiftLen;
+	uint16_t frameLen;
+	uint16_t framePos;
+	uint8_t  frame[LFS_MAX_FRAME];
+	lfstream_frame_cb onFrame;
+	void    *ctx;
+	// statistics
+	uint32_t bits;
+	uint32_t errors;
+	uint32_t frames;
+	uint32_t overflow;
+} lfstream_t;
+
+extern void     lfstream_init(lfstream_t *s, uint8_t mod, int clk, int invert, uint8_t fchigh, uint8_t fclow);
+extern bool     lfstream_train(lfstream_t *s, uint8_t *samples, size_t size);
+extern bool     lfstream_set_frame(lfstream_t *s, const uint8_t *preamble, uint8_t pLen, uint16_t frameLen, lfstream_frame_cb cb, void *ctx);
+extern size_t   lfstream_push(lfstream_t *s, const uint8_t *samples, size_t len, uint8_t *bits, size_t maxBits);
+extern size_t   lfstream_finish(lfstream_t *s, uint8_t *bits, size_t maxBits);
+
 //tag specific
 extern int detectAWID(uint8_t *dest, size_t *size, int *waveStartIdx);
 extern int Em410xDecode(uint8_t *dest, size_t *size, size_t *startIdx, uint32_t *hi, uint64_t *lo);
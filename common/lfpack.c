@@ -0,0 +1,85 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample storing of DoAcquisition,  see lfpack.h
+//-----------------------------------------------------------------------------
+
+#include "lfpack.h"
+
+void lfpack_init(lfpack_t *p, uint8_t *buf, uint32_t size, uint8_t bits_per_sample, uint8_t decimation, bool averaging, bool compression) {
+	if (bits_per_sample < 1) bits_per_sample = 1;
+	if (bits_per_sample > 8) bits_per_sample = 8;
+	if (decimation < 1) decimation = 1;
+
+	uint8_t dec = LFPACK_DEC_NONE;
+	if (decimation > 1)
+		dec = (averaging) ? LFPACK_DEC_AVERAGE : LFPACK_DEC_KEEP;
+	uint8_t store = (bits_per_sample == 8) ? LFPACK_STORE_BYTE : LFPACK_STORE_BITS;
+	if (compression)
+		store = LFPACK_STORE_CODED;
+
+	p->buf = buf;
+	p->size = size;
+	p->mode = LFPACK_MODE(dec, store);
+	p->bps = bits_per_sample;
+	p->shift = 8 - bits_per_sample;
+	p->decimation = decimation;
+	p->count = 0;
+	p->sum = 0;
+	p->recip = 0xFFFFFFFF / decimation + 1;
+	p->acc = 0;
+	p->nacc = 0;
+	p->pos = 0;
+	p->numbits = 0;
+	p->maxbits = (size > 0) ? (size - 1) << 3 : 0;
+	p->saved = 0;
+	lfcompress_init(&p->lfc, buf, size);
+}
+
+bool lfpack_put(lfpack_t *p, uint8_t sample) {
+	return lfpack_put_mode(p, p->mode, sample);
+}
+
+#define LFPACK_BLOCK(dec, store) \
+	case LFPACK_MODE(dec, store): \
+		while (i < len) { \
+			if (!lfpack_put_mode(&l, LFPACK_MODE(dec, store), in[i++])) \
+				break; \
+		} \
+		break;
+
+uint32_t lfpack_block(lfpack_t *p, const uint8_t *in, uint32_t len) {
+	// a local copy,  the byte stores to buf can't alias it and the state stays in registers
+	lfpack_t l = *p;
+	uint32_t i = 0;
+	switch (l.mode) {
+		LFPACK_BLOCK(LFPACK_DEC_NONE, LFPACK_STORE_BYTE)
+		LFPACK_BLOCK(LFPACK_DEC_NONE, LFPACK_STORE_BITS)
+		LFPACK_BLOCK(LFPACK_DEC_NONE, LFPACK_STORE_CODED)
+		LFPACK_BLOCK(LFPACK_DEC_KEEP, LFPACK_STORE_BYTE)
+		LFPACK_BLOCK(LFPACK_DEC_KEEP, LFPACK_STORE_BITS)
+		LFPACK_BLOCK(LFPACK_DEC_KEEP, LFPACK_STORE_CODED)
+		LFPACK_BLOCK(LFPACK_DEC_AVERAGE, LFPACK_STORE_BYTE)
+		LFPACK_BLOCK(LFPACK_DEC_AVERAGE, LFPACK_STORE_BITS)
+		LFPACK_BLOCK(LFPACK_DEC_AVERAGE, LFPACK_STORE_CODED)
+	}
+	*p = l;
+	return i;
+}
+
+uint32_t lfpack_finish(lfpack_t *p) {
+	switch (p->mode % 3) {
+		case LFPACK_STORE_BYTE:
+			return p->saved << 3;
+		case LFPACK_STORE_CODED:
+			return lfcompress_finish(&p->lfc) << 3;
+	}
+	if (p->nacc) {
+		uint32_t w = p->acc << (32 - p->nacc);
+		for (uint8_t i = 0; i < p->nacc; i += 8, w <<= 8)
+			p->buf[p->pos + (i >> 3)] = w >> 24;
+	}
+	return p->numbits;
+}
@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// LF sample storing of DoAcquisition,  decimation,  averaging and packing the
+// bits per sample into BigBuf.  Runs in the firmware and in the client,  where
+// 'data pack' checks it against the bit by bit pushBit version.
+//-----------------------------------------------------------------------------
+
+#ifndef LFPACK_H__
+#define LFPACK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lfcompress.h"
+
+// how a sample is kept
+#define LFPACK_DEC_NONE		0			// every sample
+#define LFPACK_DEC_KEEP		1			// the last one of decimation samples
+#define LFPACK_DEC_AVERAGE	2			// the average of decimation samples
+// how a kept one is stored
+#define LFPACK_STORE_BYTE	0			// 8 bits per sample,  a byte each
+#define LFPACK_STORE_BITS	1			// the upper bits_per_sample bits,  msb first
+#define LFPACK_STORE_CODED	2			// lfcompress.h
+#define LFPACK_MODE(dec, store)		((dec) * 3 + (store))
+
+typedef struct {
+	uint8_t *buf;
+	uint32_t size;			// of buf
+	uint8_t mode;			// LFPACK_MODE
+	uint8_t bps;
+	uint8_t shift;			// 8 - bps
+	uint8_t decimation;
+	uint8_t count;			// samples of the decimation group seen
+	uint32_t sum;
+	uint32_t recip;			// 2^32 / decimation rounded up,  sum * recip >> 32 = sum / decimation
+	// STORE_BITS,  bits gather in acc and go out a word at a time
+	uint32_t acc;
+	uint8_t nacc;			// bits in acc
+	uint32_t pos;			// bytes written
+	uint32_t numbits;
+	uint32_t maxbits;		// a buffer full of bits,  one byte short as pushBit left it
+	uint32_t saved;			// samples stored
+	lfcompress_t lfc;
+} lfpack_t;
+
+extern void lfpack_init(lfpack_t *p, uint8_t *buf, uint32_t size, uint8_t bits_per_sample, uint8_t decimation, bool averaging, bool compression);
+// One ADC sample.  False when the buffer is full,  sampling stops.
+extern bool lfpack_put(lfpack_t *p, uint8_t sample);
+// The samples of in until the buffer is full,  one loop per mode.  Returns the
+// samples taken,  the one that filled the buffer included.
+extern uint32_t lfpack_block(lfpack_t *p, const uint8_t *in, uint32_t len);
+// writes the bits still in acc,  returns the number of bits stored
+extern uint32_t lfpack_finish(lfpack_t *p);
+
+static inline bool lfpack_byte(lfpack_t *p, uint8_t sample) {
+	p->buf[p->saved++] = sample;
+	return p->saved < p->size;
+}
+
+// A word holds 32 bits,  the oldest in bit 31.  When a sample does not fit
+// whole,  its upper bits fill the word and the rest starts the next one.  Bits
+// above nacc in acc are left overs,  they shift out before the word is written.
+static inline bool lfpack_bits(lfpack_t *p, uint8_t sample) {
+	uint32_t v = sample >> p->shift;
+	uint8_t n = p->nacc + p->bps;
+	if (n < 32) {
+		p->acc = (p->acc << p->bps) | v;
+		p->nacc = n;
+	} else {
+		uint8_t over = n - 32;
+		uint32_t w = (p->acc << (p->bps - over)) | (v >> over);
+		uint8_t *dst = p->buf + p->pos;
+		dst[0] = w >> 24;
+		dst[1] = w >> 16;
+		dst[2] = w >> 8;
+		dst[3] = w;
+		p->pos += 4;
+		p->acc = v;
+		p->nacc = over;
+	}
+	p->saved++;
+	p->numbits += p->bps;
+	return p->numbits < p->maxbits;
+}
+
+static inline bool lfpack_coded(lfpack_t *p, uint8_t sample) {
+	if (!lfcompress_push(&p->lfc, sample >> p->shift))
+		return false;
+	p->saved++;
+	return true;
+}
+
+// true when the sample ends a decimation group
+static inline bool lfpack_keep(lfpack_t *p) {
+	if (++p->count < p->decimation)
+		return false;
+	p->count = 0;
+	return true;
+}
+
+static inline bool lfpack_average(lfpack_t *p, uint8_t *sample) {
+	p->sum += *sample;
+	if (++p->count < p->decimation)
+		return false;
+	// sum is 16 bits,  the 32 bit reciprocal divides it exactly
+	*sample = ((uint64_t)p->sum * p->recip) >> 32;
+	p->count = 0;
+	p->sum = 0;
+	return true;
+}
+
+// lfpack_put with the mode a constant,  a sampling loop around it is one of
+// its own for that mode
+static inline __attribute__((always_inline)) bool lfpack_put_mode(lfpack_t *p, const uint8_t mode, uint8_t sample) {
+	switch (mode) {
+		case LFPACK_MODE(LFPACK_DEC_NONE, LFPACK_STORE_BYTE):
+			return lfpack_byte(p, sample);
+		case LFPACK_MODE(LFPACK_DEC_NONE, LFPACK_STORE_BITS):
+			return lfpack_bits(p, sample);
+		case LFPACK_MODE(LFPACK_DEC_NONE, LFPACK_STORE_CODED):
+			return lfpack_coded(p, sample);
+
+		case LFPACK_MODE(LFPACK_DEC_KEEP, LFPACK_STORE_BYTE):
+			return !lfpack_keep(p) || lfpack_byte(p, sample);
+		case LFPACK_MODE(LFPACK_DEC_KEEP, LFPACK_STORE_BITS):
+			return !lfpack_keep(p) || lfpack_bits(p, sample);
+		case LFPACK_MODE(LFPACK_DEC_KEEP, LFPACK_STORE_CODED):
+			return !lfpack_keep(p) || lfpack_coded(p, sample);
+
+		case LFPACK_MODE(LFPACK_DEC_AVERAGE, LFPACK_STORE_BYTE):
+			return !lfpack_average(p, &sample) || lfpack_byte(p, sample);
+		case LFPACK_MODE(LFPACK_DEC_AVERAGE, LFPACK_STORE_BITS):
+			return !lfpack_average(p, &sample) || lfpack_bits(p, sample);
+		case LFPACK_MODE(LFPACK_DEC_AVERAGE, LFPACK_STORE_CODED):
+			return !lfpack_average(p, &sample) || lfpack_coded(p, sample);
+	}
+	return false;
+}
+
+#endif
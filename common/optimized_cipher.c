@@ -58,13 +58,18 @@
   For a thorough documentation, check out the MAC-calculation within cipher.c instead.
 
   -- MHS 2015
+
+  Later the successor got cheaper for the simulation,  where the tag MAC has to be ready
+  within the response window:
+  * select(x, y, r) == select(0, 0, r) ^ 3x ^ 2y,  so the key index is one lookup in a
+    256 byte table,  the same for every key.
+  * The T and B feedbacks are parities,  folded down to a nibble and looked up in 0x6996.
+  * The state stays in locals for a whole input byte and the output,  no State copies.
+  "hf iclass loclass b" on the client compares it to cipher.c and times both.
 **/
 
 #include "optimized_cipher.h"
-
-#define opt_T(s) (0x1 & ((s->t >> 15) ^ (s->t >> 14)^ (s->t >> 10)^ (s->t >> 8)^ (s->t >> 5)^ (s->t >> 4)^ (s->t >> 1)^ s->t))
-
-#define opt_B(s) (((s->b >> 6) ^ (s->b >> 5) ^ (s->b >> 4) ^ (s->b)) & 0x1)
+#include <string.h>
 
 #define opt__select(x,y,r)  (4 & (((r & (r << 2)) >> 5) ^ ((r & ~(r << 2)) >> 4) ^ ( (r | r << 2) >> 3)))\
 	|(2 & (((r | r << 2) >> 6) ^ ( (r | r << 2) >> 1) ^ (r >> 5) ^ r ^ ((x^y) << 1)))\
@@ -96,82 +101,103 @@ uint8_t xopt__select(bool x, bool y, uint8_t r)
 }
 */
 
-void opt_successor(const uint8_t* k, State *s, bool y, State* successor) {
-	uint8_t Tt = 1 & opt_T(s);
-
-	successor->t = (s->t >> 1);
-	successor->t |= (Tt ^ (s->r >> 7 & 0x1) ^ (s->r >> 3 & 0x1)) << 15;
-
-	successor->b = s->b >> 1;
-	successor->b |= (opt_B(s) ^ (s->r & 0x1)) << 7;
+// opt__select(0, 0, r),  the other x, y only flip the low bits
+static const uint8_t opt_select_table[256] = {
+	0, 3, 2, 1, 2, 3, 0, 1, 4, 7, 7, 4, 6, 7, 5, 4,
+	1, 2, 3, 0, 2, 3, 0, 1, 5, 6, 6, 5, 6, 7, 5, 4,
+	6, 5, 4, 7, 4, 5, 6, 7, 6, 5, 5, 6, 4, 5, 7, 6,
+	7, 4, 5, 6, 4, 5, 6, 7, 7, 4, 4, 7, 4, 5, 7, 6,
+	6, 5, 4, 7, 4, 5, 6, 7, 2, 1, 1, 2, 0, 1, 3, 2,
+	3, 0, 1, 2, 0, 1, 2, 3, 7, 4, 4, 7, 4, 5, 7, 6,
+	0, 3, 2, 1, 2, 3, 0, 1, 0, 3, 3, 0, 2, 3, 1, 0,
+	5, 6, 7, 4, 6, 7, 4, 5, 5, 6, 6, 5, 6, 7, 5, 4,
+	2, 1, 0, 3, 0, 1, 2, 3, 6, 5, 5, 6, 4, 5, 7, 6,
+	3, 0, 1, 2, 0, 1, 2, 3, 7, 4, 4, 7, 4, 5, 7, 6,
+	2, 1, 0, 3, 0, 1, 2, 3, 2, 1, 1, 2, 0, 1, 3, 2,
+	3, 0, 1, 2, 0, 1, 2, 3, 3, 0, 0, 3, 0, 1, 3, 2,
+	4, 7, 6, 5, 6, 7, 4, 5, 0, 3, 3, 0, 2, 3, 1, 0,
+	1, 2, 3, 0, 2, 3, 0, 1, 5, 6, 6, 5, 6, 7, 5, 4,
+	4, 7, 6, 5, 6, 7, 4, 5, 4, 7, 7, 4, 6, 7, 5, 4,
+	1, 2, 3, 0, 2, 3, 0, 1, 1, 2, 2, 1, 2, 3, 1, 0
+};
+
+// t taps 15 14 10 8 5 4 1 0,  b taps 6 5 4 0.  Bit 15 of t is the newest,  it is kept
+// out of the fold so the other taps do not wait for the previous step.
+#define opt_parity4(x)	((0x6996 >> ((x) & 0xF)) & 1)
+#define opt_T16(t)		(opt_parity4(((t) & 0x3) ^ (((t) >> 4) & 0x3) ^ (((t) >> 8) & 0x5) ^ (((t) >> 12) & 0x4)) ^ ((t) >> 15))
+#define opt_B8(b)		opt_parity4(((b) & 0x71) ^ (((b) & 0x71) >> 4))
+
+// the key byte for m = 3x ^ 2y,  from the key itself or the per key table
+#define opt_KEY_RAW(k, m, r)	(k)[opt_select_table[r] ^ (m)]
+#define opt_KEY_TAB(kt, m, r)	(kt)->ksel[m][r]
+
+// opt_successor() on the locals l, r, b, t.  y2 is the input bit times 2
+#define opt_STEP(KEY, k, y2) do { \
+		uint8_t _Tt = opt_T16(t); \
+		uint8_t _r = r; \
+		t = (t >> 1) | (uint16_t)((_Tt ^ (_r >> 7) ^ (_r >> 3)) & 1) << 15; \
+		b = (b >> 1) | (uint8_t)((opt_B8(b) ^ _r) << 7); \
+		r = (KEY(k, (_Tt * 3) ^ (y2), _r) ^ b) + l; \
+		l = r + _r; \
+	} while (0)
+
+#define opt_LOAD(s)		uint8_t l = (s)->l, r = (s)->r, b = (s)->b; uint16_t t = (s)->t
+#define opt_STORE(s)	do { (s)->l = l; (s)->r = r; (s)->b = b; (s)->t = t; } while (0)
+
+// a byte at a time,  msb first
+#define opt_SUC_BODY(KEY, k, s, in, length, add32Zeroes) do { \
+		opt_LOAD(s); \
+		for (int _i = 0; _i < (length); _i++) { \
+			uint8_t head = (in)[_i]; \
+			opt_STEP(KEY, k, (head >> 6) & 2); \
+			opt_STEP(KEY, k, (head >> 5) & 2); \
+			opt_STEP(KEY, k, (head >> 4) & 2); \
+			opt_STEP(KEY, k, (head >> 3) & 2); \
+			opt_STEP(KEY, k, (head >> 2) & 2); \
+			opt_STEP(KEY, k, (head >> 1) & 2); \
+			opt_STEP(KEY, k, head & 2); \
+			opt_STEP(KEY, k, (head << 1) & 2); \
+		} \
+		/* For tag MAC, an additional 32 zeroes */ \
+		if (add32Zeroes) \
+			for (int _i = 0; _i < 32; _i++) \
+				opt_STEP(KEY, k, 0); \
+		opt_STORE(s); \
+	} while (0)
+
+#define opt_OUTPUT_BODY(KEY, k, s, buffer) do { \
+		opt_LOAD(s); \
+		for (int _times = 0; _times < 4; _times++) { \
+			uint8_t bout = 0; \
+			for (int _bit = 0; _bit < 8; _bit++) { \
+				bout = (bout << 1) | ((r >> 2) & 1); \
+				opt_STEP(KEY, k, 0); \
+			} \
+			(buffer)[_times] = bout; \
+		} \
+		opt_STORE(s); \
+	} while (0)
 
-	successor->r = (k[opt__select(Tt,y,s->r)] ^ successor->b) + s->l ;
-	successor->l = successor->r+s->r;
+void opt_successor(const uint8_t* k, State *s, bool y, State* successor) {
+	opt_LOAD(s);
+	opt_STEP(opt_KEY_RAW, k, y << 1);
+	opt_STORE(successor);
 }
 
 void opt_suc(const uint8_t* k,State* s, uint8_t *in, uint8_t length, bool add32Zeroes) {
-	State x2;
-	int i;
-	uint8_t head = 0;
-	for (i = 0; i < length; i++) {
-		head = 1 & (in[i] >> 7);
-		opt_successor(k, s, head, &x2);
-
-		head = 1 & (in[i] >> 6);
-		opt_successor(k, &x2, head, s);
-
-		head = 1 & (in[i] >> 5);
-		opt_successor(k, s, head, &x2);
-
-		head = 1 & (in[i] >> 4);
-		opt_successor(k, &x2, head, s);
-
-		head = 1 & (in[i] >> 3);
-		opt_successor(k, s, head, &x2);
-
-		head = 1 & (in[i] >> 2);
-		opt_successor(k, &x2, head, s);
-
-		head = 1 & (in[i] >> 1);
-		opt_successor(k, s, head, &x2);
-
-		head = 1 & in[i];
-		opt_successor(k, &x2, head, s);
-	}
-	
-	//For tag MAC, an additional 32 zeroes
-	if (add32Zeroes) {
-		for (i = 0; i < 16; i++) {
-			opt_successor(k, s, 0, &x2);
-			opt_successor(k, &x2, 0, s);
-		}
-	}
+	opt_SUC_BODY(opt_KEY_RAW, k, s, in, length, add32Zeroes);
 }
 
 void opt_output(const uint8_t* k,State* s,  uint8_t *buffer) {
-	uint8_t times = 0;
-	uint8_t bout = 0;
-	State temp = {0,0,0,0};
-	for ( ; times < 4; times++) {
-		bout =0;
-		bout |= (s->r & 0x4) << 5;
-		opt_successor(k, s, 0, &temp);
-		bout |= (temp.r & 0x4) << 4;
-		opt_successor(k, &temp, 0, s);
-		bout |= (s->r & 0x4) << 3;
-		opt_successor(k, s, 0, &temp);
-		bout |= (temp.r & 0x4) << 2;
-		opt_successor(k, &temp, 0, s);
-		bout |= (s->r & 0x4) << 1;
-		opt_successor(k, s, 0, &temp);
-		bout |= (temp.r & 0x4) ;
-		opt_successor(k, &temp, 0, s);
-		bout |= (s->r & 0x4) >> 1;
-		opt_successor(k, s, 0, &temp);
-		bout |= (temp.r & 0x4) >> 2;
-		opt_successor(k, &temp, 0, s);
-		buffer[times] = bout;
-	}
+	opt_OUTPUT_BODY(opt_KEY_RAW, k, s, buffer);
+}
+
+static void opt_suc_key(const opt_key_t *key, State *s, const uint8_t *in, uint8_t length, bool add32Zeroes) {
+	opt_SUC_BODY(opt_KEY_TAB, key, s, in, length, add32Zeroes);
+}
+
+static void opt_output_key(const opt_key_t *key, State *s, uint8_t *buffer) {
+	opt_OUTPUT_BODY(opt_KEY_TAB, key, s, buffer);
 }
 
 void opt_MAC(uint8_t* k, uint8_t* input, uint8_t* out) {
@@ -265,3 +291,38 @@ void opt_doTagMAC_2(State _init,  uint8_t* nr, uint8_t mac[4], const uint8_t* di
 	opt_reverse_arraybytecpy(mac, dest,4);
 	return;
 }
+
+/**
+ * Fills the per key table,  ksel[m][r] = k[select(x, y, r)] with m = 3x ^ 2y.
+ * Saves a lookup per cipher step when one key is used for many MACs,  like the simulation.
+ */
+void opt_init_key(opt_key_t *key, const uint8_t *div_key_p) {
+	memcpy(key->k, div_key_p, 8);
+	for (int m = 0; m < 4; m++)
+		for (int r = 0; r < 256; r++)
+			key->ksel[m][r] = div_key_p[opt_select_table[r] ^ m];
+}
+
+State opt_doTagMAC_1_key(uint8_t *cc_p, const opt_key_t *key) {
+	uint8_t cc_nr[8];
+	opt_reverse_arraybytecpy(cc_nr, cc_p, 8);
+	State _init  =  {
+			((key->k[0] ^ 0x4c) + 0xEC) & 0xFF,// l
+			((key->k[0] ^ 0x4c) + 0x21) & 0xFF,// r
+			0x4c, // b
+			0xE012 // t
+			};
+	opt_suc_key(key, &_init, cc_nr, 8, false);
+	return _init;
+}
+
+void opt_doTagMAC_2_key(State _init, uint8_t *nr, uint8_t mac[4], const opt_key_t *key) {
+	uint8_t _nr[4];
+	opt_reverse_arraybytecpy(_nr, nr, 4);
+	opt_suc_key(key, &_init, _nr, 4, true);
+
+	uint8_t dest [] = {0,0,0,0};
+	opt_output_key(key, &_init, dest);
+	//The output MAC must also be reversed
+	opt_reverse_arraybytecpy(mac, dest, 4);
+}
@@ -20,6 +20,14 @@ typedef struct {
 	uint16_t t;
 } State;
 
+/**
+ * Per key table for the cipher steps,  see opt_init_key()
+ **/
+typedef struct {
+	uint8_t k[8];
+	uint8_t ksel[4][256];
+} opt_key_t;
+
 /** The reader MAC is MAC(key, CC * NR )
  **/
 void opt_doReaderMAC(uint8_t *cc_nr_p, uint8_t *div_key_p, uint8_t mac[4]);
@@ -48,4 +56,11 @@ State opt_doTagMAC_1(uint8_t *cc_p, const uint8_t *div_key_p);
  */
 void opt_doTagMAC_2(State _init, uint8_t* nr, uint8_t mac[4], const uint8_t* div_key_p);
 
+/**
+ * The same two parts with a key table from opt_init_key(),  for many MACs with one key.
+ */
+void opt_init_key(opt_key_t *key, const uint8_t *div_key_p);
+State opt_doTagMAC_1_key(uint8_t *cc_p, const opt_key_t *key);
+void opt_doTagMAC_2_key(State _init, uint8_t *nr, uint8_t mac[4], const opt_key_t *key);
+
 #endif // OPTIMIZED_CIPHER_H
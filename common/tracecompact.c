@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Compact trace decoder,  see tracecompact.h
+//-----------------------------------------------------------------------------
+
+#include "tracecompact.h"
+
+bool tracecompact_is(const uint8_t *trace, uint32_t len) {
+	return len >= TRACECOMPACT_MAGIC_LEN && memcmp(trace, TRACECOMPACT_MAGIC, TRACECOMPACT_MAGIC_LEN) == 0;
+}
+
+static bool get_varint(const uint8_t *trace, uint32_t len, uint32_t *pos, uint32_t *v) {
+	*v = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (*pos >= len)
+			return false;
+		uint8_t b = trace[(*pos)++];
+		*v |= (uint32_t)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+uint32_t tracecompact_decode(const uint8_t *trace, uint32_t len, uint8_t *out) {
+	uint32_t pos = TRACECOMPACT_MAGIC_LEN;
+	uint32_t outlen = 0;
+	uint32_t start = 0;
+
+	while (pos < len) {
+		uint8_t flags = trace[pos++];
+		uint32_t datalen = flags & TRACECOMPACT_LEN_MASK;
+		uint8_t par = (flags & TRACECOMPACT_PAR_MASK) >> TRACECOMPACT_PAR_SHIFT;
+		uint32_t delta, duration, more = 0;
+
+		if (datalen == TRACECOMPACT_LEN_MASK && !get_varint(trace, len, &pos, &more))
+			break;
+		datalen += more;
+		if (!get_varint(trace, len, &pos, &delta) || !get_varint(trace, len, &pos, &duration))
+			break;
+		if (datalen > 0x7FFF || duration > 0xFFFF || par > TRACECOMPACT_PAR_RAW)
+			break;
+
+		uint16_t num_paritybytes = tracelog_paritybytes(datalen);
+		uint32_t reclen = datalen + ((par == TRACECOMPACT_PAR_RAW) ? num_paritybytes : 0);
+		if (pos + reclen > len)
+			break;
+
+		start += delta;
+		if (out) {
+			const uint8_t *data = trace + pos;
+			uint8_t *p = out + outlen;
+			if (par == TRACECOMPACT_PAR_RAW) {
+				p = tracelog_put(p, data, datalen, start, duration, data + datalen, !(flags & TRACECOMPACT_RESPONSE));
+			} else {
+				p = tracelog_put(p, data, datalen, start, duration, NULL, !(flags & TRACECOMPACT_RESPONSE));
+				uint8_t *parity = p - num_paritybytes;
+				if (par == TRACECOMPACT_PAR_ODD)
+					for (uint32_t j = 0; j < datalen; j++)
+						parity[j / 8] |= oddparity8(data[j]) << (7 - (j & 7));
+			}
+		}
+		pos += reclen;
+		outlen += TRACELOG_HDR + datalen + num_paritybytes;
+	}
+	return outlen;
+}
@@ -0,0 +1,146 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Trace record writers,  the classic BigBuf format and the compact one.  The
+// writers are inline,  LogTrace() runs them in the sniff loop.
+//-----------------------------------------------------------------------------
+
+#ifndef TRACECOMPACT_H__
+#define TRACECOMPACT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "parity.h"
+
+// classic record:
+//   32 bits timestamp (little endian)
+//   16 bits duration (little endian)
+//   16 bits data length (little endian, Highest Bit used as readerToTag flag)
+//   y Bytes data
+//   x Bytes parity (one byte per 8 bytes data)
+#define TRACELOG_HDR			8
+
+// compact trace,  starts with the magic.  As a classic record it would be
+// 0x7fff bytes long,  more than BigBuf holds.  Then per record:
+//   1 byte    bit 7 tag to reader,  bits 6..5 parity,  bits 4..0 length,  31 = more follows
+//   varint    length - 31,  with 31 in the length bits
+//   varint    start - start of the record before,  the first one from 0
+//   varint    duration
+//   y Bytes   data
+//   x Bytes   parity,  TRACECOMPACT_PAR_RAW only
+// A varint is 7 bits a byte,  low bits first,  bit 7 set when another byte follows.
+#define TRACECOMPACT_MAGIC		"PM3\x01\xff\xff\xff\xff"
+#define TRACECOMPACT_MAGIC_LEN	8
+#define TRACECOMPACT_MAX_HDR	(1 + 3 + 5 + 3)
+
+#define TRACECOMPACT_RESPONSE	0x80
+#define TRACECOMPACT_PAR_SHIFT	5
+#define TRACECOMPACT_PAR_MASK	0x60
+#define TRACECOMPACT_PAR_NONE	0		// no parity,  or all zero
+#define TRACECOMPACT_PAR_ODD	1		// odd parity of each byte,  made again by the decoder
+#define TRACECOMPACT_PAR_RAW	2		// parity bytes follow
+#define TRACECOMPACT_LEN_MASK	0x1F
+
+static inline uint16_t tracelog_paritybytes(uint16_t len) {
+	return (len - 1) / 8 + 1;
+}
+
+// classic record at p,  returns the end.  An aligned header is two word writes,
+// both ends are little endian.
+static inline uint8_t *tracelog_put(uint8_t *p, const uint8_t *data, uint16_t len, uint32_t start, uint16_t duration, const uint8_t *parity, bool readerToTag) {
+	uint16_t lenflag = len | (readerToTag ? 0 : 0x8000);
+	if (((uintptr_t)p & 3) == 0) {
+		((uint32_t *)p)[0] = start;
+		((uint32_t *)p)[1] = duration | ((uint32_t)lenflag << 16);
+		p += TRACELOG_HDR;
+	} else {
+		*p++ = start;
+		*p++ = start >> 8;
+		*p++ = start >> 16;
+		*p++ = start >> 24;
+		*p++ = duration;
+		*p++ = duration >> 8;
+		*p++ = lenflag;
+		*p++ = lenflag >> 8;
+	}
+
+	if (data != NULL && len != 0)
+		memcpy(p, data, len);
+	p += len;
+
+	uint16_t num_paritybytes = tracelog_paritybytes(len);
+	if (parity != NULL)
+		memcpy(p, parity, num_paritybytes);
+	else
+		memset(p, 0x00, num_paritybytes);
+	return p + num_paritybytes;
+}
+
+static inline uint8_t *tracecompact_varint(uint8_t *p, uint32_t v) {
+	while (v > 0x7F) {
+		*p++ = v | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+
+// the parity mode of a frame,  one pass over the parity bytes
+static inline uint8_t tracecompact_parity(const uint8_t *data, uint16_t len, const uint8_t *parity) {
+	if (parity == NULL)
+		return TRACECOMPACT_PAR_NONE;
+
+	bool zero = true, odd = (data != NULL);
+	uint16_t num_paritybytes = tracelog_paritybytes(len);
+	for (uint16_t i = 0; i < num_paritybytes; i++) {
+		if (parity[i])
+			zero = false;
+		if (odd) {
+			uint8_t p = 0;
+			for (uint16_t j = i * 8; j < len && j < i * 8 + 8; j++)
+				p |= oddparity8(data[j]) << (7 - (j & 7));
+			odd = (p == parity[i]);
+		}
+		if (!zero && !odd)
+			return TRACECOMPACT_PAR_RAW;
+	}
+	return zero ? TRACECOMPACT_PAR_NONE : TRACECOMPACT_PAR_ODD;
+}
+
+// compact record at p,  returns the end.  last is the start of the record
+// before,  0 at the trace start.  Room for TRACECOMPACT_MAX_HDR + len + parity
+// bytes is needed.
+static inline uint8_t *tracecompact_put(uint8_t *p, uint32_t *last, const uint8_t *data, uint16_t len, uint32_t start, uint16_t duration, const uint8_t *parity, bool readerToTag) {
+	uint8_t par = tracecompact_parity(data, len, parity);
+
+	*p++ = (readerToTag ? 0 : TRACECOMPACT_RESPONSE) | (par << TRACECOMPACT_PAR_SHIFT) | (len < TRACECOMPACT_LEN_MASK ? len : TRACECOMPACT_LEN_MASK);
+	if (len >= TRACECOMPACT_LEN_MASK)
+		p = tracecompact_varint(p, len - TRACECOMPACT_LEN_MASK);
+	p = tracecompact_varint(p, start - *last);
+	p = tracecompact_varint(p, duration);
+	*last = start;
+
+	if (data != NULL && len != 0)
+		memcpy(p, data, len);
+	else
+		memset(p, 0x00, len);
+	p += len;
+
+	if (par == TRACECOMPACT_PAR_RAW) {
+		uint16_t num_paritybytes = tracelog_paritybytes(len);
+		memcpy(p, parity, num_paritybytes);
+		p += num_paritybytes;
+	}
+	return p;
+}
+
+// client side
+extern bool tracecompact_is(const uint8_t *trace, uint32_t len);
+// the classic trace of a compact one,  out may be NULL to get the length.
+// A record cut at the end is left out.
+extern uint32_t tracecompact_decode(const uint8_t *trace, uint32_t len, uint8_t *out);
+
+#endif
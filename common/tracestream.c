@@ -0,0 +1,87 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Sniff trace streaming,  see tracestream.h
+//-----------------------------------------------------------------------------
+
+#include "tracestream.h"
+#include <string.h>
+
+void tracestream_init(tracestream_t *ts, uint8_t *buf, uint16_t size) {
+	memset(ts, 0, sizeof(tracestream_t));
+	ts->buf = buf;
+	ts->half = size / 2;
+}
+
+// the filled half waits for the USB,  the other one is filled next
+static void tracestream_swap(tracestream_t *ts) {
+	ts->ready[ts->fill] = true;
+	if (!ts->ready[ts->fill ^ 1]) {
+		ts->out = ts->fill;
+		ts->sent = 0;
+	}
+	ts->fill ^= 1;
+	ts->len[ts->fill] = 0;
+}
+
+uint8_t *tracestream_reserve(tracestream_t *ts, uint16_t len) {
+	if (len > ts->half) {
+		ts->dropped++;
+		return NULL;
+	}
+
+	if (ts->len[ts->fill] + len > ts->half) {
+		if (ts->ready[ts->fill ^ 1]) {
+			ts->dropped++;
+			return NULL;
+		}
+		tracestream_swap(ts);
+	}
+
+	uint8_t *p = ts->buf + ts->fill * ts->half + ts->len[ts->fill];
+	ts->len[ts->fill] += len;
+	ts->records++;
+	return p;
+}
+
+bool tracestream_flush(tracestream_t *ts) {
+	if (ts->len[ts->fill] == 0)
+		return true;
+	if (ts->ready[ts->fill ^ 1])
+		return false;
+	tracestream_swap(ts);
+	return true;
+}
+
+bool tracestream_next(tracestream_t *ts, uint8_t **data, uint32_t *arg0, uint32_t *arg1, uint32_t *arg2) {
+	if (!ts->ready[ts->out])
+		return false;
+
+	uint16_t len = ts->len[ts->out] - ts->sent;
+	if (len > TRACESTREAM_CHUNK)
+		len = TRACESTREAM_CHUNK;
+
+	*data = ts->buf + ts->out * ts->half + ts->sent;
+	*arg0 = ts->offset;
+	*arg1 = len | (ts->sent ? 0 : TRACESTREAM_HALF);
+	*arg2 = ts->dropped;
+	return true;
+}
+
+void tracestream_sent(tracestream_t *ts) {
+	uint16_t len = ts->len[ts->out] - ts->sent;
+	if (len > TRACESTREAM_CHUNK)
+		len = TRACESTREAM_CHUNK;
+
+	ts->sent += len;
+	ts->offset += len;
+	if (ts->sent < ts->len[ts->out])
+		return;
+
+	// done,  the other half may be waiting already
+	ts->ready[ts->out] = false;
+	ts->out ^= 1;
+	ts->sent = 0;
+}
@@ -0,0 +1,55 @@
+//-----------------------------------------------------------------------------
+// This code is licensed to you under the terms of the GNU GPL, version 2 or,
+// at your option, any later version. See the LICENSE.txt file for the text of
+// the license.
+//-----------------------------------------------------------------------------
+// Sniff trace streaming,  the device side double buffer.  Runs in the firmware
+// and in the client side simulated feed.
+//-----------------------------------------------------------------------------
+
+#ifndef TRACESTREAM_H__
+#define TRACESTREAM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The trace area is split in two halves.  LogTrace fills one,  the full one goes
+// to the client in chunks while the sniff loop is idle.  A record that finds both
+// halves full is dropped and counted.
+//
+// One packet per chunk:
+//   arg0 = stream offset of the chunk
+//   arg1 = chunk length | flags
+//   arg2 = records dropped so far
+// The stream is the raw BigBuf trace format.  A half always starts at a record,
+// the client syncs again there after a lost packet.
+#define TRACESTREAM_CHUNK		512				// USB_CMD_DATA_SIZE
+#define TRACESTREAM_HALF		0x80000000		// the chunk starts a half
+#define TRACESTREAM_END			0x40000000		// last packet,  no data
+#define TRACESTREAM_LENMASK		0x0000FFFF
+// a half not full yet goes out after this long
+#define TRACESTREAM_FLUSH_MS	500
+
+typedef struct {
+	uint8_t *buf;
+	uint16_t half;			// size of one half
+	uint16_t len[2];		// bytes in each half
+	bool ready[2];			// full,  waiting to go out
+	uint8_t fill;			// half being filled
+	uint8_t out;			// half going out
+	uint16_t sent;			// bytes of the out half sent
+	uint32_t offset;		// stream offset of the next byte sent
+	uint32_t records;
+	uint32_t dropped;
+} tracestream_t;
+
+extern void tracestream_init(tracestream_t *ts, uint8_t *buf, uint16_t size);
+// room for a record of len bytes,  NULL when it is dropped
+extern uint8_t *tracestream_reserve(tracestream_t *ts, uint16_t len);
+// the half being filled goes out as it is.  False if the other one still waits.
+extern bool tracestream_flush(tracestream_t *ts);
+// next chunk to send,  false if nothing is ready.  Call tracestream_sent() after it went out.
+extern bool tracestream_next(tracestream_t *ts, uint8_t **data, uint32_t *arg0, uint32_t *arg1, uint32_t *arg2);
+extern void tracestream_sent(tracestream_t *ts);
+
+#endif
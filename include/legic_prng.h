@@ -15,5 +15,8 @@ extern void legic_prng_forward(int count);
 extern uint32_t legic_prng_count();
 extern uint8_t legic_prng_get_bit();
 extern uint32_t legic_prng_get_bits(uint8_t len);
+// len bytes of keystream,  the bits legic_prng_get_bits(8) gives after
+// legic_prng_init(iv) legic_prng_forward(offset).  Leaves the prng alone
+extern void legic_prng_keystream(uint8_t iv, uint32_t offset, uint8_t *out, uint32_t len);
 #endif
 
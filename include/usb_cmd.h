@@ -41,6 +41,7 @@ typedef struct{
 	bool averaging;
 	int divisor;
 	int trigger_threshold;
+	bool compression;
 } sample_config;
 
 // For the bootloader
@@ -66,6 +67,7 @@ typedef struct{
 
 #define CMD_DOWNLOAD_EML_BIGBUF											  0x0110
 #define CMD_DOWNLOADED_EML_BIGBUF										  0x0111
+#define CMD_DOWNLOADED_TRACE_STREAM										  0x0112
 
 // RDV40, Flash memory operations
 #define CMD_READ_FLASH_MEM												  0x0120
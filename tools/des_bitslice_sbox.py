@@ -0,0 +1,163 @@
+#!/usr/bin/python
+
+#  des_bitslice_sbox.py - generate the gate level DES S-boxes used by the
+#  bitsliced DES in client/blockcipher.c
+#
+#  Every S-box output is built as a decision diagram over the six input
+#  bits with nodes shared between the four outputs,  a node whose branches
+#  are complements becomes one XOR.  The input order giving the fewest
+#  gates is searched for each S-box.
+#
+#    python tools/des_bitslice_sbox.py > client/des_bitslice_sbox.h
+#
+#  This code is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; either version 2 of the License, or
+#  (at your option) any later version.
+
+import itertools
+
+SBOX = [
+	[14, 4,13, 1, 2,15,11, 8, 3,10, 6,12, 5, 9, 0, 7,  0,15, 7, 4,14, 2,13, 1,10, 6,12,11, 9, 5, 3, 8,
+	  4, 1,14, 8,13, 6, 2,11,15,12, 9, 7, 3,10, 5, 0, 15,12, 8, 2, 4, 9, 1, 7, 5,11, 3,14,10, 0, 6,13],
+	[15, 1, 8,14, 6,11, 3, 4, 9, 7, 2,13,12, 0, 5,10,  3,13, 4, 7,15, 2, 8,14,12, 0, 1,10, 6, 9,11, 5,
+	  0,14, 7,11,10, 4,13, 1, 5, 8,12, 6, 9, 3, 2,15, 13, 8,10, 1, 3,15, 4, 2,11, 6, 7,12, 0, 5,14, 9],
+	[10, 0, 9,14, 6, 3,15, 5, 1,13,12, 7,11, 4, 2, 8, 13, 7, 0, 9, 3, 4, 6,10, 2, 8, 5,14,12,11,15, 1,
+	 13, 6, 4, 9, 8,15, 3, 0,11, 1, 2,12, 5,10,14, 7,  1,10,13, 0, 6, 9, 8, 7, 4,15,14, 3,11, 5, 2,12],
+	[ 7,13,14, 3, 0, 6, 9,10, 1, 2, 8, 5,11,12, 4,15, 13, 8,11, 5, 6,15, 0, 3, 4, 7, 2,12, 1,10,14, 9,
+	 10, 6, 9, 0,12,11, 7,13,15, 1, 3,14, 5, 2, 8, 4,  3,15, 0, 6,10, 1,13, 8, 9, 4, 5,11,12, 7, 2,14],
+	[ 2,12, 4, 1, 7,10,11, 6, 8, 5, 3,15,13, 0,14, 9, 14,11, 2,12, 4, 7,13, 1, 5, 0,15,10, 3, 9, 8, 6,
+	  4, 2, 1,11,10,13, 7, 8,15, 9,12, 5, 6, 3, 0,14, 11, 8,12, 7, 1,14, 2,13, 6,15, 0, 9,10, 4, 5, 3],
+	[12, 1,10,15, 9, 2, 6, 8, 0,13, 3, 4,14, 7, 5,11, 10,15, 4, 2, 7,12, 9, 5, 6, 1,13,14, 0,11, 3, 8,
+	  9,14,15, 5, 2, 8,12, 3, 7, 0, 4,10, 1,13,11, 6,  4, 3, 2,12, 9, 5,15,10,11,14, 1, 7, 6, 0, 8,13],
+	[ 4,11, 2,14,15, 0, 8,13, 3,12, 9, 7, 5,10, 6, 1, 13, 0,11, 7, 4, 9, 1,10,14, 3, 5,12, 2,15, 8, 6,
+	  1, 4,11,13,12, 3, 7,14,10,15, 6, 8, 0, 5, 9, 2,  6,11,13, 8, 1, 4,10, 7, 9, 5, 0,15,14, 2, 3,12],
+	[13, 2, 8, 4, 6,15,11, 1,10, 9, 3,14, 5, 0,12, 7,  1,15,13, 8,10, 3, 7, 4,12, 5, 6,11, 0,14, 9, 2,
+	  7,11, 4, 1, 9,12,14, 2, 0, 6,10,13,15, 3, 5, 8,  2, 1,14, 7, 4,10, 8,13,15,12, 9, 0, 3, 5, 6,11],
+]
+
+N = 64
+ZERO = tuple([0] * N)
+ONE = tuple([1] * N)
+
+
+def sbox_out(s, x, o):
+	# x = b1..b6 with b1 the msb,  row is b1 b6,  column b2..b5.  o = 0 is the msb
+	row = ((x >> 4) & 2) | (x & 1)
+	col = (x >> 1) & 0xf
+	return (SBOX[s][row * 16 + col] >> (3 - o)) & 1
+
+
+def var_tt(i):
+	return tuple((idx >> (5 - i)) & 1 for idx in range(N))
+
+
+def invert(t):
+	return tuple(1 - v for v in t)
+
+
+def synth(s, order):
+	# x<i> is S-box input b<order[i] + 1>,  split on x0 first
+	avail = dict((var_tt(i), 'x%d' % i) for i in range(6))
+	gates = []
+
+	def new(expr, t):
+		name = 't%d' % len(gates)
+		gates.append((name, expr))
+		avail[t] = name
+		return name
+
+	def get(t):
+		if t in avail:
+			return avail[t]
+		if invert(t) in avail:
+			return new('~%s' % avail[invert(t)], t)
+		return None
+
+	def mk(t, level):
+		r = get(t)
+		if r is not None:
+			return r
+		bit = 1 << (5 - level)
+		v = 'x%d' % level
+		lo = tuple(t[idx & ~bit] for idx in range(N))
+		hi = tuple(t[idx | bit] for idx in range(N))
+		if lo == hi:
+			return mk(lo, level + 1)
+		if hi == invert(lo):
+			if lo == ONE:
+				return new('~%s' % v, t)
+			return new('%s ^ %s' % (mk(lo, level + 1), v), t)
+		if lo == ZERO:
+			return new('%s & %s' % (mk(hi, level + 1), v), t)
+		if hi == ONE:
+			return new('%s | %s' % (mk(lo, level + 1), v), t)
+		if hi == ZERO:
+			return new('%s & ~%s' % (mk(lo, level + 1), v), t)
+		if lo == ONE:
+			return new('%s | ~%s' % (mk(hi, level + 1), v), t)
+		l = mk(lo, level + 1)
+		h = mk(hi, level + 1)
+		x = tuple(a ^ b for a, b in zip(lo, hi))
+		xn = get(x) or new('%s ^ %s' % (l, h), x)
+		a = tuple(p & q for p, q in zip(x, var_tt(level)))
+		an = get(a) or new('%s & %s' % (xn, v), a)
+		return new('%s ^ %s' % (l, an), t)
+
+	outs = []
+	for o in range(4):
+		t = []
+		for idx in range(N):
+			x = 0
+			for i, b in enumerate(order):
+				x |= ((idx >> (5 - i)) & 1) << (5 - b)
+			t.append(sbox_out(s, x, o))
+		outs.append(mk(tuple(t), 0))
+
+	# drop the gates nothing ended up using
+	live = set(outs)
+	for name, expr in reversed(gates):
+		if name in live:
+			live.update(w.strip('~') for w in expr.split() if w.strip('~')[0] in 'tx')
+	gates = [(name, expr) for name, expr in gates if name in live]
+	return gates, outs
+
+
+def main():
+	print('//-----------------------------------------------------------------------------')
+	print('// This code is licensed to you under the terms of the GNU GPL, version 2 or,')
+	print('// at your option, any later version. See the LICENSE.txt file for the text of')
+	print('// the license.')
+	print('//-----------------------------------------------------------------------------')
+	print('// DES S-boxes as gates for the bitsliced DES.  Generated, do not edit:')
+	print('//   python tools/des_bitslice_sbox.py > client/des_bitslice_sbox.h')
+	print('// in[0..5] are S-box inputs b1..b6,  out[0..3] the outputs,  msb first.')
+	print('//-----------------------------------------------------------------------------')
+	print('')
+	print('#ifndef DES_BITSLICE_SBOX_H__')
+	print('#define DES_BITSLICE_SBOX_H__')
+	total = 0
+	for s in range(8):
+		best = None
+		for order in itertools.permutations(range(6)):
+			gates, outs = synth(s, order)
+			if best is None or len(gates) < len(best[1]):
+				best = (order, gates, outs)
+		order, gates, outs = best
+		total += len(gates)
+		print('')
+		print('// %d gates' % len(gates))
+		print('static inline void des_bs_s%d(const bs_t *in, bs_t *out) {' % (s + 1))
+		print('\tconst bs_t %s;' % ', '.join('x%d = in[%d]' % (i, b) for i, b in enumerate(order)))
+		for name, expr in gates:
+			print('\tconst bs_t %s = %s;' % (name, expr))
+		for o in range(4):
+			print('\tout[%d] = %s;' % (o, outs[o]))
+		print('}')
+	print('')
+	print('// %d gates in all' % total)
+	print('#endif')
+
+
+if __name__ == '__main__':
+	main()